@@ -48,6 +48,9 @@ H3D_IMPL bool h3dextImportTexture( Horde3D::ResHandle texRes, int texID )
 		return false;
 	}
 
+	// Raw GL calls bypass the render device, so the context has to be taken over explicitly
+	Modules::renderer().acquireRenderContext();
+
 	TextureResourceEx* texEx = static_cast<TextureResourceEx*>(res);
 	texEx->importTexGL( texID, 0, 0 );
 	return true;
@@ -36,6 +36,11 @@ namespace Horde3DOverlays {
 		OverlayRenderer::release();
 	}
 
+	void ExtOverlays::onFrameSnapshot()
+	{
+		OverlayRenderer::snapshotOverlays();
+	}
+
 }  // namespace
 
 
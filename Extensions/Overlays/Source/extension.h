@@ -24,6 +24,7 @@ namespace Horde3DOverlays {
 		virtual const char *getName() const { return "Overlays"; }
 		virtual bool init();
 		virtual void release();
+		virtual void onFrameSnapshot();
 	};
 
 }
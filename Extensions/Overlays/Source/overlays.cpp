@@ -40,6 +40,8 @@ InfoBox OverlayRenderer::_infoBox;
 
 std::vector< OverlayBatch > OverlayRenderer::_overlayBatches = {};
 OverlayVert *OverlayRenderer::_overlayVerts = nullptr;
+std::vector< OverlayBatch > OverlayRenderer::_renderBatches = {};
+OverlayVert *OverlayRenderer::_renderVerts = nullptr;
 
 
 
@@ -72,8 +74,8 @@ bool OverlayRenderer::init()
 
 	// Create vertex layout
 	VertexLayoutAttrib attribsOverlay[ 2 ] = {
-		{ "vertPos", 0, 2, 0 },
-		{ "texCoords0", 0, 2, 8 }
+		{ "vertPos", 0, 2, 0, VAFMT_FLOAT },
+		{ "texCoords0", 0, 2, 8, VAFMT_FLOAT }
 	};
 	_vlOverlay = Modules::renderer().getRenderDevice()->registerVertexLayout( 2, attribsOverlay );
 
@@ -90,6 +92,7 @@ bool OverlayRenderer::init()
 
 	_overlayBatches.reserve( 64 );
 	_overlayVerts = new OverlayVert[ MaxNumOverlayVerts ];
+	_renderVerts = new OverlayVert[ MaxNumOverlayVerts ];
 	_overlayVB = rdi->createVertexBuffer( MaxNumOverlayVerts * sizeof( OverlayVert ), 0x0 );
 
 	// Create geometry bindings
@@ -118,8 +121,10 @@ void OverlayRenderer::release()
 
 	rdi->destroyGeometry( _overlayGeo );
 	delete[] _overlayVerts;
+	delete[] _renderVerts;
 
 	_overlayBatches.clear();
+	_renderBatches.clear();
 	_overlayVB = 0;
 	_vlOverlay = -1;
 }
@@ -159,12 +164,28 @@ void OverlayRenderer::clearOverlays()
 }
 
 
-void OverlayRenderer::drawOverlays( const string &shaderContext )
+void OverlayRenderer::snapshotOverlays()
 {
 	uint32 numOverlayVerts = 0;
 	if ( !_overlayBatches.empty() )
 		numOverlayVerts = _overlayBatches.back().firstVert + _overlayBatches.back().vertCount;
 
+	_renderBatches = _overlayBatches;
+	memcpy( _renderVerts, _overlayVerts, numOverlayVerts * sizeof( OverlayVert ) );
+}
+
+
+void OverlayRenderer::drawOverlays( const string &shaderContext )
+{
+	// With pipelined rendering the application may already fill the overlays of the next frame
+	const bool pipelined = Modules::renderer().isPipelined();
+	vector< OverlayBatch > &batches = pipelined ? _renderBatches : _overlayBatches;
+	OverlayVert *verts = pipelined ? _renderVerts : _overlayVerts;
+	
+	uint32 numOverlayVerts = 0;
+	if ( !batches.empty() )
+		numOverlayVerts = batches.back().firstVert + batches.back().vertCount;
+
 	if ( numOverlayVerts == 0 ) return;
 
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
@@ -172,7 +193,7 @@ void OverlayRenderer::drawOverlays( const string &shaderContext )
 	if ( curCamera == 0x0 ) return;
 
 	// Upload overlay vertices
-	rdi->updateBufferData( _overlayGeo, _overlayVB, 0, MaxNumOverlayVerts * sizeof( OverlayVert ), _overlayVerts );
+	rdi->updateBufferData( _overlayGeo, _overlayVB, 0, MaxNumOverlayVerts * sizeof( OverlayVert ), verts );
 
 	rdi->setGeometry( _overlayGeo );
 	ASSERT( QuadIdxBufCount >= MaxNumOverlayVerts * 6 );
@@ -183,9 +204,9 @@ void OverlayRenderer::drawOverlays( const string &shaderContext )
 	MaterialResource *curMatRes = 0x0;
 	ShaderCombination *curShader = 0x0;
 
-	for ( size_t i = 0, s = _overlayBatches.size(); i < s; ++i )
+	for ( size_t i = 0, s = batches.size(); i < s; ++i )
 	{
-		OverlayBatch &ob = _overlayBatches[ i ];
+		OverlayBatch &ob = batches[ i ];
 
 		if ( curMatRes != ob.materialRes )
 		{
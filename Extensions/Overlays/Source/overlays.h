@@ -75,6 +75,7 @@ public:
 	static void showOverlays( const float *verts, uint32 vertCount, float *colRGBA,
 							  Horde3D::MaterialResource *matRes, int flags );
 	static void clearOverlays();
+	static void snapshotOverlays();
 	static void drawOverlays( const std::string &shaderContext );
 
 	static void showText( const char *text, float x, float y, float size, float colR,
@@ -90,6 +91,8 @@ private:
 //	static std::vector< CachedUniformLocation >	_cachedLocations;
 	static std::vector< OverlayBatch >			_overlayBatches;
 	static OverlayVert							*_overlayVerts;
+	static std::vector< OverlayBatch >			_renderBatches;  // Copies drawn by the render thread
+	static OverlayVert							*_renderVerts;
 	static InfoBox								_infoBox;
 	static uint32								_overlayGeo;
 	static uint32								_overlayVB;
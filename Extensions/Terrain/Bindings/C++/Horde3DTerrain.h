@@ -35,6 +35,13 @@
 	The extension defines the uniform *terBlockParams* and the attribute *terHeight* that can be used
 	in a shader to render the terrain. To see how this is working in detail, have a look at the included
 	sample shader.
+
+	Alternatively a vertex shader can fetch the heights itself by declaring the sampler *terHeightMap*,
+	which is bound to the height map, and the uniform *terHeightParams* (height map size, inverse size,
+	skirt offset). In that case all blocks are drawn from a static grid and no vertex data is uploaded
+	per block. The y component of the grid position is 1 for skirt vertices. The included sample shader
+	uses this mode. Height maps are always kept completely in video memory, even when texture streaming
+	is enabled.
 */
 
 
@@ -69,17 +69,16 @@ OpenGL4
 // =================================================================================================
 
 #include "shaders/utilityLib/vertCommon.glsl"
+#include "shaders/utilityLib/vertTerrain.glsl"
 
 uniform mat4 viewProjMat;
-uniform vec4 terBlockParams;
 attribute vec3 vertPos;
-attribute float terHeight;
 varying vec4 pos, vsPos;
 varying vec2 texCoords;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, fetchHeight( vertPos ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	pos = calcWorldPos( newPos );
@@ -93,17 +92,16 @@ void main( void )
 // =================================================================================================
 
 #include "shaders/utilityLib/vertCommon.glsl"
+#include "shaders/utilityLib/vertTerrain.glsl"
 
 uniform mat4 viewProjMat;
-uniform vec4 terBlockParams;
 layout( location = 0 ) in vec3 vertPos;
-layout( location = 1 ) in float terHeight;
 out vec4 pos, vsPos;
 out vec2 texCoords;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, fetchHeight( vertPos ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	pos = calcWorldPos( newPos );
@@ -173,17 +171,16 @@ void main( void )
 // =================================================================================================
 
 #include "shaders/utilityLib/vertCommon.glsl"
+#include "shaders/utilityLib/vertTerrain.glsl"
 
 uniform mat4 viewProjMat;
 uniform vec4 lightPos;
-uniform vec4 terBlockParams;
 attribute vec3 vertPos;
-attribute float terHeight;
 varying float dist;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, fetchHeight( vertPos ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	vec4 pos = calcWorldPos( newPos );
@@ -196,17 +193,16 @@ void main( void )
 // =================================================================================================
 
 #include "shaders/utilityLib/vertCommon.glsl"
+#include "shaders/utilityLib/vertTerrain.glsl"
 
 uniform mat4 viewProjMat;
 uniform vec4 lightPos;
-uniform vec4 terBlockParams;
 layout( location = 0 ) in vec3 vertPos;
-layout( location = 1 ) in float terHeight;
 out float dist;
 
 void main( void )
 {
-	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, terHeight,
+	vec4 newPos = vec4( vertPos.x * terBlockParams.z + terBlockParams.x, fetchHeight( vertPos ),
 						vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );
 						
 	vec4 pos = calcWorldPos( newPos );
@@ -0,0 +1,30 @@
+// *************************************************************************************************
+// Horde3D Shader Utility Library
+// --------------------------------------
+//		- Terrain height functions -
+//
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// You may use the following code in projects based on the Horde3D graphics engine.
+//
+// *************************************************************************************************
+
+uniform vec4 terBlockParams;
+uniform sampler2D terHeightMap;
+uniform vec4 terHeightParams;
+
+
+float fetchHeight( vec3 gridPos )
+{
+	// Rounds to the nearest texel like the CPU side of the terrain; the last texel of the 16 bit
+	// height map is repeated on the far edges. Skirt vertices have gridPos.y = 1
+	vec2 texel = min( floor( (gridPos.xz * terBlockParams.z + terBlockParams.xy) * terHeightParams.x + 0.5 ),
+	                  terHeightParams.x - 1.0 );
+#if __VERSION__ >= 130
+	vec4 h = texelFetch( terHeightMap, ivec2( texel ), 0 );
+#else
+	vec4 h = texture2DLod( terHeightMap, (texel + 0.5) * terHeightParams.y, 0.0 );
+#endif
+	// High byte is stored in the red and low byte in the green channel
+	return max( (h.r * 65280.0 + h.g * 255.0) / 65535.0 - gridPos.y * terHeightParams.z, 0.0 );
+}
@@ -31,11 +31,13 @@ bool ExtTerrain::init()
 	Modules::renderer().registerRenderFunc( SNT_TerrainNode, TerrainNode::renderFunc );
 
 	TerrainNode::uni_terBlockParams = Modules::renderer().registerEngineUniform( "terBlockParams" );
+	TerrainNode::uni_terHeightMap = Modules::renderer().registerEngineUniform( "terHeightMap" );
+	TerrainNode::uni_terHeightParams = Modules::renderer().registerEngineUniform( "terHeightParams" );
 
 	// Create vertex layout
 	VertexLayoutAttrib attribs[2] = {
-		{"vertPos", 0, 3, 0},
-		{"terHeight", 1, 1, 0}
+		{"vertPos", 0, 3, 0, VAFMT_FLOAT},
+		{"terHeight", 1, 1, 0, VAFMT_FLOAT}
 	};
 	TerrainNode::vlTerrain = Modules::renderer().getRenderDevice()->registerVertexLayout( 2, attribs );
 
@@ -106,6 +108,7 @@ H3D_IMPL NodeHandle h3dextAddTerrainNode( NodeHandle parent, const char *name, R
 H3D_IMPL ResHandle h3dextCreateTerrainGeoRes( NodeHandle node, const char *name, float meshQuality )
 {
 	SceneNode *sn = Modules::sceneMan().resolveNodeHandle( node );
+	Modules::renderer().acquireRenderContext();
 	if( sn != 0x0 && sn->getType() == SNT_TerrainNode )
 		return ((TerrainNode *)sn)->createGeometryResource( safeStr( name ), 1.0f / meshQuality );
 	else
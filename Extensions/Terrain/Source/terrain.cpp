@@ -16,6 +16,7 @@
 #include "egRenderer.h"
 #include "egMaterial.h"
 #include "egCamera.h"
+#include "utPixel.h"
 
 #include "utDebug.h"
 
@@ -90,6 +91,8 @@ const char *fsTerrainDebugViewGLES3 =
 uint32 TerrainNode::vlTerrain;
 ShaderCombination TerrainNode::debugViewShader;
 int TerrainNode::uni_terBlockParams = -1;
+int TerrainNode::uni_terHeightMap = -1;
+int TerrainNode::uni_terHeightParams = -1;
 
 
 TerrainNode::TerrainNode( const TerrainNodeTpl &terrainTpl ) :
@@ -116,6 +119,12 @@ TerrainNode::TerrainNode( const TerrainNodeTpl &terrainTpl ) :
 
 TerrainNode::~TerrainNode()
 {
+	// Render proxies share the height data and the geometry of their node
+	if( _renderProxy ) return;
+	
+	// The proxy of the frame in flight may still draw with the shared data
+	Modules::renderer().syncRenderThread();
+	
 	delete[] _heightData;
 	delete[] _heightArray;
 }
@@ -176,9 +185,38 @@ void TerrainNode::onPostUpdate()
 }
 
 
+SceneNode *TerrainNode::createRenderProxy() const
+{
+	return new TerrainNode( *this );
+}
+
+
+void TerrainNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	SceneNode::updateRenderProxy( proxy );
+
+	TerrainNode &terrain = (TerrainNode &)proxy;
+	terrain._materialRes = _materialRes;
+	terrain._heightMapRes = _heightMapRes;
+	terrain._blockSize = _blockSize;
+	terrain._skirtHeight = _skirtHeight;
+	terrain._lodThreshold = _lodThreshold;
+	terrain._hmapSize = _hmapSize;
+	terrain._heightData = _heightData;
+	terrain._maxLevel = _maxLevel;
+	terrain._heightArray = _heightArray;
+	terrain._vertexBuffer = _vertexBuffer;
+	terrain._indexBuffer = _indexBuffer;
+	terrain._geometry = _geometry;
+	terrain._localBBox = _localBBox;
+	terrain._blockTree = _blockTree;
+}
+
+
 void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV, float maxU, float maxV,
                                     int level, float scale, const Vec3f &localCamPos, const Frustum *frust1,
-                                    const Frustum *frust2, int terBlockParamsUni )
+                                    const Frustum *frust2, int terBlockParamsUni, bool gpuHeights,
+                                    int terHeightParamsUni )
 {
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
@@ -213,6 +251,24 @@ void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV
 			float values[4] = { minU, minV, scale, scale };
 			rdi->setShaderConst( terBlockParamsUni, CONST_FLOAT4, values );  // Bias and scale
 		}
+
+		// Skirt can be smaller when camera is near
+		const float skirtHeight = terrain->_skirtHeight * dist;
+
+		if( gpuHeights )
+		{
+			// Heights are fetched by the vertex shader, the static grid is drawn without an upload
+			if( terHeightParamsUni >= 0 )
+			{
+				float values[4] = { (float)terrain->_hmapSize, 1.0f / terrain->_hmapSize, skirtHeight, 0 };
+				rdi->setShaderConst( terHeightParamsUni, CONST_FLOAT4, values );
+			}
+			
+			rdi->drawIndexed( PRIM_TRISTRIP, 0, terrain->getIndexCount(), 0, terrain->getVertexCount() );
+			Modules::stats().incStat( EngineStats::BatchCount, 1 );
+			Modules::stats().incStat( EngineStats::TriCount, (terrain->_blockSize + 1) * (terrain->_blockSize + 1) * 2.0f );
+			return;
+		}
 	
 		const uint32 size = terrain->_blockSize + 2;
 		const float invScale = 1.0f / ( terrain->_blockSize - 1 );
@@ -237,8 +293,6 @@ void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV
 				// Create skirt
 				if( v == 0 || v == size - 1 || u == 0 || u == size - 1 )
 				{
-					// Skirt can be smaller when camera is near
-					const float skirtHeight = terrain->_skirtHeight * dist;
 					*vertHeight = maxf( *vertHeight - skirtHeight, 0 );
 				}
 			}
@@ -279,13 +333,14 @@ void TerrainNode::drawTerrainBlock( TerrainNode *terrain, float minU, float minV
 		for( uint32 i = 0; i < 4; ++i )
 		{
 			drawTerrainBlock( terrain, blocks[i].x, blocks[i].y, blocks[i].z, blocks[i].w,
-			                  level + 1, scale, localCamPos, frust1, frust2, terBlockParamsUni );
+			                  level + 1, scale, localCamPos, frust1, frust2, terBlockParamsUni,
+			                  gpuHeights, terHeightParamsUni );
 		}
 	}
 }
 
 
-void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, const string &shaderContext, int theClass,
+void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, int shaderContext, int theClass,
                               bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
                               int occSet )
 {
@@ -351,7 +406,31 @@ void TerrainNode::renderFunc( uint32 firstItem, uint32 lastItem, const string &s
 			rdi->setShaderConst( curShader->uniLocs[ uni.nodeId ], CONST_FLOAT, &id );
 		}
 
-		drawTerrainBlock( terrain, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f, localCamPos, frust1, frust2, terBlockUni );
+		// The height map is not bound through the material, so keep it from being evicted by the
+		// texture memory budget
+		if( terrain->_heightMapRes != 0x0 )
+		{
+			uint32 frameID = Modules::renderer().getFrameID();
+			terrain->_heightMapRes->markUsed( frameID );
+
+			// Height maps that were reloaded with streaming need all mip levels again
+			if( terrain->_heightMapRes->isStreamed() ) terrain->_heightMapRes->requestMip( 0, frameID );
+		}
+
+		// Shaders that sample terHeightMap fetch the heights themselves (see terrain.shader)
+		bool gpuHeights = false;
+		int terHeightParamsUni = -1;
+		if( !debugView && curShader->uniLocs[ uni_terHeightMap ] >= 0 && terrain->_heightMapRes != 0x0 )
+		{
+			rdi->setShaderSampler( curShader->uniLocs[ uni_terHeightMap ], HeightMapTexUnit );
+			rdi->setTexture( HeightMapTexUnit, terrain->_heightMapRes->getTexObject(),
+			                 SS_FILTER_POINT | SS_ANISO1 | SS_ADDR_CLAMP, TextureUsage::Texture );
+			terHeightParamsUni = curShader->uniLocs[ uni_terHeightParams ];
+			gpuHeights = true;
+		}
+
+		drawTerrainBlock( terrain, 0.0f, 0.0f, 1.0f, 1.0f, 0, 1.0f, localCamPos, frust1, frust2, terBlockUni,
+		                  gpuHeights, terHeightParamsUni );
 
 // 		rdi->setVertexLayout( 0 );
 	}
@@ -366,6 +445,9 @@ bool TerrainNode::canAttach( SceneNode &parent ) const
 
 bool TerrainNode::updateHeightData( TextureResource &hmap )
 {
+	// Height data is shared with the render proxy; the height map is read back from the device
+	Modules::renderer().acquireRenderContext();
+	
 	delete[] _heightData; _heightData = 0x0;
 
 	// Depending on render backend we decide on pixel processing of the texture
@@ -383,53 +465,23 @@ bool TerrainNode::updateHeightData( TextureResource &hmap )
 	{
 		_hmapSize = hmap.getWidth();
 		_heightData = new uint16[ ( _hmapSize + 1 ) * ( _hmapSize + 1 ) ];
+
+		// Shaders fetch exact texels from the base level of the height map, so it must not be streamed
+		hmap.stopStreaming();
 		
 		unsigned char *pixels = (unsigned char *)hmap.mapStream(
 			TextureResData::ImageElem, 0, TextureResData::ImgPixelStream, true, false );
 		ASSERT( pixels != 0x0 );
 		
-		size_t height_data_index = 0;
-		size_t first_pixel_index = 0, second_pixel_index = 0;
-		for( uint32 i = 0; i < _hmapSize; ++i )
-		{
-			for( uint32 j = 0; j < _hmapSize; ++j )
-			{
-				// Decode 16 bit data from red and green channels
-				height_data_index = static_cast< size_t >( i * ( _hmapSize + 1 ) + j );
-
-				if ( isBGRA )
-				{
-					first_pixel_index = static_cast< size_t >( ( i * _hmapSize + j ) * 4 + 2 );
-					second_pixel_index = static_cast< size_t >( ( i * _hmapSize + j ) * 4 + 1 );
-				}
-				else
-				{
-					first_pixel_index = static_cast< size_t >( ( i * _hmapSize + j ) * 4 + 0 );
-					second_pixel_index = static_cast< size_t >( ( i * _hmapSize + j ) * 4 + 1 );
-				}
-
-				_heightData[ height_data_index ] = pixels[ first_pixel_index ] * 256 + pixels[ second_pixel_index ];
-			}
-		}
-		
-		// Fill in last rows (just repeat last texture pixels)
+		// Decode 16 bit data from red and green channels
+		int hiChannel = isBGRA ? 2 : 0;
 		for( uint32 i = 0; i < _hmapSize; ++i )
 		{
-			// Decode 16 bit data from red and green channels
-			height_data_index = static_cast< size_t >( i * ( _hmapSize + 1 ) + _hmapSize );
+			uint16 *row = &_heightData[i * (_hmapSize + 1)];
+			decodePixels16( &pixels[i * _hmapSize * 4], row, _hmapSize, hiChannel, 1 );
 
-			if ( isBGRA )
-			{
-				first_pixel_index = static_cast< size_t >( ( i * _hmapSize + _hmapSize - 1 ) * 4 + 2 );
-				second_pixel_index = static_cast< size_t >( ( i * _hmapSize + _hmapSize - 1 ) * 4 + 1 );
-			}
-			else
-			{
-				first_pixel_index = static_cast< size_t >( ( i * _hmapSize + _hmapSize - 1 ) * 4 + 0 );
-				second_pixel_index = static_cast< size_t >( ( i * _hmapSize + _hmapSize - 1 ) * 4 + 1 );
-			}
-
-			_heightData[ height_data_index ] = pixels[ first_pixel_index ] * 256 + pixels[ second_pixel_index ];
+			// Fill in last column (just repeat last texture pixel)
+			row[_hmapSize] = row[_hmapSize - 1];
 		}
 
 		for( uint32 i = 0; i < _hmapSize + 1; ++i )
@@ -438,11 +490,13 @@ bool TerrainNode::updateHeightData( TextureResource &hmap )
 		}
 
 		hmap.unmapStream();
+		_heightMapRes = &hmap;
 		return true;
 	}
 	else
 	{
 		// Init default data
+		_heightMapRes = 0x0;
 		_hmapSize = 32;
 		_heightData = new uint16[ (_hmapSize + 1) * (_hmapSize + 1)];
 		memset( _heightData, 0, (_hmapSize + 1) * (_hmapSize + 1) * sizeof( uint16 ) );
@@ -482,11 +536,12 @@ float *TerrainNode::createVertices()
 			*(posIterator + 1) = 0.0f;
 			*(posIterator + 2) = (v - 1) * invScale;
 
-			// Skirt vertices
+			// Skirt vertices; y marks them for shaders that fetch the heights on the GPU
 			if( u == 0 ) *(posIterator + 0) = 0;
 			if( v == 0 ) *(posIterator + 2) = 0;
 			if( u == size - 1 ) *(posIterator + 0) = 1.0f;
 			if( v == size - 1 ) *(posIterator + 2) = 1.0f;
+			if( u == 0 || v == 0 || u == size - 1 || v == size - 1 ) *(posIterator + 1) = 1.0f;
 
 			posIterator += 3;
 		}
@@ -535,6 +590,9 @@ uint16 *TerrainNode::createIndices()
 
 void TerrainNode::recreateVertexBuffer()
 {
+	// Geometry and height array are shared with the render proxy
+	Modules::renderer().acquireRenderContext();
+	
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
 // 	rdi->destroyBuffer( _vertexBuffer );
@@ -656,7 +714,7 @@ void TerrainNode::setParamI( int param, int value )
 	case TerrainNodeParams::HeightTexResI:
 		res = Modules::resMan().resolveResHandle( value );
 		if( res != 0x0 && res->getType() == ResourceTypes::Texture &&
-		    ((TextureResource *)res)->getTexType() != TextureTypes::Tex2D )
+		    ((TextureResource *)res)->getTexType() == TextureTypes::Tex2D )
 		{
 			bool result = updateHeightData( *((TextureResource *)res) );
 			recreateVertexBuffer();
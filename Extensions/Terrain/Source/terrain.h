@@ -25,6 +25,7 @@ using namespace Horde3D;
 
 
 const int SNT_TerrainNode = 100;
+const uint32 HeightMapTexUnit = 13;  // Units 0-11 are used by materials, 12 by the shadow map
 
 extern const char *vsTerrainDebugView;
 extern const char *fsTerrainDebugView;	
@@ -79,7 +80,7 @@ public:
 
 	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
-	static void renderFunc(uint32 firstItem, uint32 lastItem, const std::string &shaderContext, int theClass,
+	static void renderFunc(uint32 firstItem, uint32 lastItem, int shaderContext, int theClass,
 		bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
 
 	virtual bool canAttach( SceneNode &parent ) const;
@@ -90,15 +91,21 @@ public:
 
 	virtual bool checkIntersection( const Vec3f &rayOrig, const Vec3f &rayDir, Vec3f &intsPos ) const;
 
+	virtual SceneNode *createRenderProxy() const;
+	virtual void updateRenderProxy( SceneNode &proxy ) const;
+
 	ResHandle createGeometryResource( const std::string &name, float lodThreshold );
 	
+	// Rounds half texels up like the block vertices, so that block bounds contain the rendered heights
 	float getHeight( float x, float y )
-		{ return _heightData[ftoi_r( y * _hmapSize ) * (_hmapSize + 1) + ftoi_r( x * _hmapSize ) ] / 65535.0f; }
+		{ return _heightData[ftoi_t( y * _hmapSize + 0.5f ) * (_hmapSize + 1) + ftoi_t( x * _hmapSize + 0.5f )] / 65535.0f; }
 
 public:
 	static uint32 vlTerrain;
 	static ShaderCombination debugViewShader;
 	static int uni_terBlockParams;
+	static int uni_terHeightMap;
+	static int uni_terHeightParams;
 
 protected:
 	TerrainNode( const TerrainNodeTpl &terrainTpl );
@@ -119,7 +126,8 @@ protected:
 
 	static void drawTerrainBlock( TerrainNode *terrain, float minU, float minV, float maxU, float maxV,
 	                              int level, float scale, const Vec3f &localCamPos, const Frustum *frust1,
-	                              const Frustum *frust2, int uni_terBlockParams );
+	                              const Frustum *frust2, int uni_terBlockParams, bool gpuHeights,
+	                              int uni_terHeightParams );
 
 	uint32 calculateGeometryBlockCount( float lodThreshold, float minU, float minV,
 	                                    float maxU, float maxV, int level, float scale);
@@ -129,6 +137,7 @@ protected:
 
 protected:
 	PMaterialResource  _materialRes;
+	PTextureResource   _heightMapRes;  // Sampled by vertex shaders that fetch the heights on the GPU
 	uint32             _blockSize;
 	float              _skirtHeight;
 	float              _lodThreshold;
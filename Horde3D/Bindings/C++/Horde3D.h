@@ -106,6 +106,20 @@ struct H3DOptions
 		GatherTimeStats     - Enables or disables gathering of time stats that are useful for profiling (Values: 0, 1; Default: 1)
 		DebugRenderBackend  - Enables or disables logging of render backend diagnostic messages. May require additional actions on 
 							  application side, like creating a debug opengl context. (Values: 0, 1; Default: 0)
+		WorkerThreadCount   - Number of worker threads used by the engine job system; a negative value selects the number
+		                      of hardware threads minus one, 0 executes all jobs on the calling thread. Must not be changed
+		                      while rendering. (Values: -1..31; Default: -1)
+		PipelinedRendering  - Enables or disables rendering on a separate render thread. While enabled, h3dRender only
+		                      queues the camera and h3dFinalizeFrame hands a snapshot of the scene to the render thread,
+		                      so that it draws frame N while the application updates frame N+1. Requires a callback set
+		                      with h3dSetRenderThreadCallback. (Values: 0, 1; Default: 0)
+		TexStreamingBudget  - Video memory budget in Mb for streamed textures; 0 disables streaming. DDS and KTX textures
+		                      with mipmaps that are loaded while streaming is enabled initially only get their small mip
+		                      levels. Finer levels are loaded over the next frames when meshes that use the texture
+		                      cover enough pixels; least recently used textures are reduced again when the budget is
+		                      exceeded. Only the small mip levels are kept in system memory, finer levels are read
+		                      again with the function set by h3dSetTexStreamingReadFunc; textures are not streamed
+		                      without such a function. (Default: 0)
 	*/
 	enum List
 	{
@@ -123,7 +137,10 @@ struct H3DOptions
 		DebugViewMode,
 		DumpFailedShaders,
 		GatherTimeStats,
-		DebugRenderBackend
+		DebugRenderBackend,
+		WorkerThreadCount,
+		PipelinedRendering,
+		TexStreamingBudget
 	};
 };
 
@@ -146,6 +163,16 @@ struct H3DStats
 		TextureVMem       - Estimated amount of video memory used by textures (in Mb)
 		GeometryVMem      - Estimated amount of video memory used by geometry (in Mb),
 		ComputeGPUTime	  - GPU time in ms spent for processing compute shaders
+		CulledTriCount    - Number of triangles that were skipped by culling the clusters of large static meshes
+		TexStreamResidentMem  - Video memory used by streamed textures (in Mb)
+		TexStreamRequestedMem - Video memory that streamed textures would need for the mip levels requested in the
+		                        last frame (in Mb)
+		TexStreamEvictedMem   - Video memory that was freed by reducing streamed textures to stay within the budget (in Mb)
+		ShaderCacheHits       - Number of shader programs that were loaded from the shader cache
+		ShaderCacheMisses     - Number of shader programs that had to be compiled although the shader cache is enabled
+		ShaderCompileTime     - CPU time in ms spent for creating shader programs (compiling, linking and cache loading)
+		GeometrySharedMem     - CPU and video memory saved by geometry clones (e.g. of skinned or morphed models) sharing
+		                        index data, static vertex data and morph targets with their source geometry (in Mb)
 	*/
 	enum List
 	{
@@ -162,7 +189,15 @@ struct H3DStats
 		ParticleGPUTime,
 		TextureVMem,
 		GeometryVMem,
-		ComputeGPUTime
+		ComputeGPUTime,
+		CulledTriCount = 115,
+		TexStreamResidentMem,
+		TexStreamRequestedMem,
+		TexStreamEvictedMem,
+		ShaderCacheHits,
+		ShaderCacheMisses,
+		ShaderCompileTime,
+		GeometrySharedMem
 	};
 };
 
@@ -193,6 +228,23 @@ struct H3DDeviceCapabilities
 	};
 };
 
+struct H3DRenderThreadEvents
+{
+	/* Enum: H3DRenderThreadEvents
+	The events passed to the render thread callback.
+
+	AcquireContext  - The rendering context must be made current on the calling thread
+	ReleaseContext  - The rendering context must be released from the calling thread
+	PresentFrame    - The frame is complete and the back buffer can be swapped
+	*/
+	enum List
+	{
+		AcquireContext = 0,
+		ReleaseContext,
+		PresentFrame
+	};
+};
+
 struct H3DResTypes
 {
 	/* Enum: H3DResTypes
@@ -336,6 +388,10 @@ struct H3DGeoRes
 		GeoVertTanStream     - Vertex tangent frame data (float nx, ny, nz, tx, ty, tz, tw)
 		GeoVertStaticStream  - Vertex static attribute data (float u0, v0,
 		                         float4 jointIndices, float4 jointWeights, float u1, v1)
+		
+		Note: Geometry of version 6 without joints and morph targets keeps only positions and indices in
+		CPU memory; mapping the tangent and static streams returns NULL in that case. Cloning such a
+		geometry reads the streams back from video memory.
 	*/
 	enum List
 	{
@@ -989,6 +1045,12 @@ H3D_API void h3dClear();
 
 	Details:
 		If 0 is provided as function pointer, the callback is deleted.
+		
+		Messages can be written by any thread, but the callback is only invoked on the thread that
+		called h3dInit. Messages of that thread are reported when they are written. Messages from other
+		threads are reported with the next message of that thread or by h3dFinalizeFrame or h3dGetMessage,
+		so with a delay of up to one frame. The callback is called without internal locks held, so it
+		may use h3dGetMessage and other engine functions.
 
 	Parameters:
 		callaback  - function pointer to call
@@ -1073,6 +1135,82 @@ H3D_API float h3dGetStat( H3DStats::List param, bool reset );
 */
 H3D_API float h3dGetDeviceCapabilities( H3DDeviceCapabilities::List param );
 
+/* Function: h3dBeginProfileCapture
+		Starts recording of CPU profiling zones.
+
+	Details:
+		This function starts recording the nested profiling zones that the engine opens in the renderer,
+		the pipeline stages and commands, culling, material setup, shadow map updates, resource loading
+		and extension render functions. Zones of all threads are recorded. Events of a previous capture
+		that was not written are discarded. When no capture is active, the zones have almost no cost.
+
+	Parameters:
+		none
+
+	Returns:
+		nothing
+*/
+H3D_API void h3dBeginProfileCapture();
+
+/* Function: h3dEndProfileCapture
+		Stops recording of CPU profiling zones and writes them to a file.
+
+	Details:
+		This function stops the capture started with h3dBeginProfileCapture and writes all recorded zones
+		in the Chrome trace event JSON format. The file can be viewed in chrome://tracing or Perfetto.
+
+	Parameters:
+		fileName  - name of the trace file that is written
+
+	Returns:
+		true in case of success, otherwise false
+*/
+H3D_API bool h3dEndProfileCapture( const char *fileName );
+
+/* Function: h3dSetJobScheduler
+		Replaces the internal job system thread pool with a scheduler of the application.
+
+	Details:
+		The engine splits work like culling into jobs. By default these are executed by an internal
+		work-stealing thread pool. With this function an application can route the jobs to its own scheduler
+		instead. Each job is handed to dispatchFunc which must call jobFunc with jobData exactly once, either
+		immediately or later on any thread. While a scheduler is set, the internal worker threads are stopped.
+		Passing NULL restores the internal thread pool.
+		
+		*Important Note: This function must not be called while the engine is rendering*
+
+	Parameters:
+		dispatchFunc  - function that schedules a job or NULL to use the internal thread pool
+		userData      - pointer that is passed to dispatchFunc
+		
+	Returns:
+		nothing
+*/
+H3D_API void h3dSetJobScheduler( void (*dispatchFunc)( void (*jobFunc)( void *jobData ), void *jobData, void *userData ),
+                                 void *userData );
+
+/* Function: h3dSetRenderThreadCallback
+		Sets the function that manages the rendering context for pipelined rendering.
+
+	Details:
+		With pipelined rendering the context moves between the application thread and the render thread.
+		The callback is invoked with an H3DRenderThreadEvents value on the thread that has to make the
+		context current or release it. PresentFrame is sent on the render thread when all cameras queued
+		for a frame are rendered, so the application must not swap buffers itself while pipelining is
+		enabled. If the application calls a function that needs the device between frames, the engine
+		waits for the render thread and moves the context back to the application thread.
+		
+		*Important Note: The callback must be set before the PipelinedRendering option is enabled*
+
+	Parameters:
+		callback  - function that handles the render thread events
+		userData  - pointer that is passed to callback
+		
+	Returns:
+		nothing
+*/
+H3D_API void h3dSetRenderThreadCallback( void (*callback)( int event, void *userData ), void *userData );
+
 /* Group: General resource management functions */
 /* Function: h3dGetResType
 		Returns the type of a resource.
@@ -1228,6 +1366,30 @@ H3D_API bool h3dIsResLoaded( H3DRes res );
 */
 H3D_API bool h3dLoadResource( H3DRes res, const char *data, int size );
 
+/* Function: h3dGetResDependencies
+		Returns the resources that a resource depends on.
+	
+	Details:
+		This function writes the handles of the resources that were added by the engine while the data
+		of the specified resource was loaded (e.g. the shader and textures of a material or the geometry
+		and materials of a scene graph) to the given array. Dependencies that already existed when the
+		resource was loaded are included. At most maxCount handles are written. The list is recorded by
+		h3dLoadResource and is empty for resources that were not loaded yet. Handles of dependencies that
+		were released in the meantime are no longer valid.
+		
+		The function can be used to build a manifest of the resources required by a scene, so that the
+		data of all of them can be read at once instead of level by level.
+	
+	Parameters:
+		res           - handle to the resource
+		dependencies  - array where the handles will be stored (can be NULL)
+		maxCount      - size of the array
+		
+	Returns:
+		total number of dependencies
+*/
+H3D_API int h3dGetResDependencies( H3DRes res, H3DRes *dependencies, int maxCount );
+
 /* Function: h3dUnloadResource
 		Unloads a resource.
 	
@@ -1469,6 +1631,63 @@ H3D_API H3DRes h3dQueryUnloadedResource( int index );
 */
 H3D_API void h3dReleaseUnusedResources();
 
+/* Function: h3dSetResTypeMemoryBudget
+		Sets a memory budget for all resources of a specific type.
+	
+	Details:
+		This function sets the amount of memory (CPU and GPU memory combined) that loaded resources of
+		the specified type may use. When the budget is exceeded at the end of a frame, the least recently
+		used resources are unloaded until the budget is met again. Only resources that were loaded from
+		data, have no user handles and have not been used in the last frame are evicted; resources that
+		are still referenced by other engine objects are only evicted if the engine can render without them
+		(currently textures, which fall back to the default texture). Evicted resources are returned by
+		h3dQueryUnloadedResource and can be loaded again by the application. A budget of 0 disables
+		eviction for the type.
+	
+	Parameters:
+		type      - type of resources
+		budgetMb  - memory budget in megabytes or 0 for no budget
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+H3D_API bool h3dSetResTypeMemoryBudget( int type, int budgetMb );
+
+/* Function: h3dGetResMemoryUsage
+		Returns the memory used by a resource.
+	
+	Details:
+		This function returns the estimated amount of CPU and GPU memory in bytes used by the data of a
+		resource. Unloaded resources use no memory.
+	
+	Parameters:
+		res     - handle to the resource
+		cpuMem  - pointer to variable where CPU memory will be stored (can be NULL)
+		gpuMem  - pointer to variable where GPU memory will be stored (can be NULL)
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+H3D_API bool h3dGetResMemoryUsage( H3DRes res, int *cpuMem, int *gpuMem );
+
+/* Function: h3dListResourcesBySize
+		Lists resources sorted by their memory usage.
+	
+	Details:
+		This function writes the handles of the resources of the specified type to the given array, sorted
+		by the sum of their CPU and GPU memory usage with the largest resource first. At most maxCount
+		handles are written. If type is H3DResTypes::Undefined, resources of all types are listed.
+	
+	Parameters:
+		type       - type of resources or H3DResTypes::Undefined
+		resources  - array where the handles will be stored (can be NULL)
+		maxCount   - size of the array
+		
+	Returns:
+		total number of matching resources
+*/
+H3D_API int h3dListResourcesBySize( int type, H3DRes *resources, int maxCount );
+
 
 /* Group: Specific resource management functions */
 /* Function: h3dCreateTexture
@@ -1493,6 +1712,28 @@ H3D_API void h3dReleaseUnusedResources();
 */
 H3D_API H3DRes h3dCreateTexture( const char *name, int width, int height, int fmt, int flags );
 
+/* Function: h3dSetTexStreamingReadFunc
+		Sets the function that reads mip levels of streamed textures.
+	
+	Details:
+		Streamed textures keep only their small mip levels in system memory (see TexStreamingBudget). Finer
+		levels are read from the data the texture was loaded from when they are needed. The engine calls
+		readFunc with the name of the Texture resource, the byte offset and size of the image within the
+		resource data and a buffer that receives the data. The function returns false if the data can't
+		be read, in that case the texture keeps its current mip levels. With pipelined rendering readFunc
+		is called on the render thread. Textures that are loaded while no function is set are not streamed.
+		h3dutLoadResourcesFromDisk sets a function that reads from the content directories and pack files.
+	
+	Parameters:
+		readFunc  - function that reads part of the resource data or NULL
+		userData  - pointer that is passed to readFunc
+		
+	Returns:
+		nothing
+*/
+H3D_API void h3dSetTexStreamingReadFunc( bool (*readFunc)( const char *resName, int offset, int size, void *buffer,
+                                                           void *userData ), void *userData );
+
 /* Function: h3dSetShaderPreambles
 		Sets preambles of all Shader resources.
 	
@@ -1518,6 +1759,44 @@ H3D_API H3DRes h3dCreateTexture( const char *name, int width, int height, int fm
 H3D_API void h3dSetShaderPreambles( const char *vertPreamble, const char *fragPreamble, const char *geomPreamble,
 									const char *tessControlPreamble, const char *tessEvalPreamble, const char *computePreamble );
 
+/* Function: h3dSetShaderCachePath
+		Sets the directory of the shader program cache.
+	
+	Details:
+		This function enables the shader cache which stores linked shader programs as driver specific
+		binaries in the specified directory. When a shader combination with identical code is created again,
+		the program is loaded from the cache instead of being compiled, which reduces loading times
+		considerably. Cached binaries are bound to the GPU, driver version and render backend; binaries that
+		the driver rejects are silently recompiled and replaced. The directory has to exist already.
+		The cache is only used if the render device supports program binaries (see H3DStats for the hit rate).
+	
+	Parameters:
+		path  - directory of the cache files; empty string disables the cache (default: empty string)
+		
+	Returns:
+		nothing
+*/
+H3D_API void h3dSetShaderCachePath( const char *path );
+
+/* Function: h3dPrecompileShaders
+		Compiles the shader combinations of several materials in one batch.
+	
+	Details:
+		This function creates the shader combinations that are required by the specified materials before
+		they are rendered for the first time. All programs are submitted to the driver before any of them
+		is queried, so drivers supporting parallel shader compilation can compile them concurrently.
+		Materials or shaders that are not loaded yet are skipped; their combinations are compiled
+		once the shader is loaded.
+	
+	Parameters:
+		materialResources  - array of handles to Material resources
+		count              - number of handles in the array
+		
+	Returns:
+		true if all shader combinations were compiled successfully, otherwise false
+*/
+H3D_API bool h3dPrecompileShaders( const H3DRes *materialResources, int count );
+
 /* Function: h3dSetMaterialUniform
 		Sets a shader uniform of a Material resource.
 	
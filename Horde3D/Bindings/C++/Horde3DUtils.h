@@ -111,6 +111,15 @@ H3D_API void h3dutSetResourcePath( int type, const char *path );
 		directories on a data drive. Several search paths can be specified using the pipe character (|)
 		as separator. All resource names are directly converted to filenames and the function tries to
 		find them in the specified directories using the given order of the search paths.
+		Pack files mounted with h3dutMountPackFile are searched before the directories.
+		
+		The dependencies of every loaded resource are recorded in the prefetch manifest (see
+		h3dutSavePrefetchManifest). When a resource with known dependencies is loaded, the files of the
+		resource and all its transitive dependencies are read in parallel up front instead of being
+		discovered level by level while the data is parsed.
+		
+		The function also sets the read function for streamed textures (see h3dSetTexStreamingReadFunc),
+		so that finer mip levels are read from the same directories and pack files when they are needed.
 	
 	Parameters:
 		contentDir  - directories where data is located on the drive ((back-)slashes at end are removed)
@@ -120,6 +129,111 @@ H3D_API void h3dutSetResourcePath( int type, const char *path );
 */
 H3D_API bool h3dutLoadResourcesFromDisk( const char *contentDir );
 
+/* Function: h3dutLoadPrefetchManifest
+		Loads a prefetch manifest.
+	
+	Details:
+		This utility function loads the resource dependencies stored in a manifest file created with
+		h3dutSavePrefetchManifest and merges them with the dependencies that are already known. With the
+		manifest, h3dutLoadResourcesFromDisk can read all files required by a scene graph the first
+		time it is loaded.
+	
+	Parameters:
+		fileName  - name of the manifest file
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+H3D_API bool h3dutLoadPrefetchManifest( const char *fileName );
+
+/* Function: h3dutSavePrefetchManifest
+		Saves the prefetch manifest.
+	
+	Details:
+		This utility function writes the resource dependencies recorded by h3dutLoadResourcesFromDisk
+		(and loaded with h3dutLoadPrefetchManifest) to a text file. The manifest can be generated once,
+		e.g. by loading all scenes of an application, and shipped with the content.
+	
+	Parameters:
+		fileName  - name of the manifest file
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+H3D_API bool h3dutSavePrefetchManifest( const char *fileName );
+
+/* Function: h3dutGetPrefetchStats
+		Returns statistics of the last prefetch.
+	
+	Details:
+		This utility function returns how many files were read ahead by the last call to
+		h3dutLoadResourcesFromDisk and how many load waves that saved. A load wave is a dependency level
+		whose files could only be read after the previous level was parsed; with prefetching, all levels
+		of a resource are read at once.
+	
+	Parameters:
+		prefetchedFileCount  - pointer to variable where the number of prefetched files will be stored (can be NULL)
+		eliminatedWaveCount  - pointer to variable where the number of eliminated load waves will be stored (can be NULL)
+		
+	Returns:
+		nothing
+*/
+H3D_API void h3dutGetPrefetchStats( int *prefetchedFileCount, int *eliminatedWaveCount );
+
+/* Function: h3dutCreatePackFile
+		Creates a pack file from the files in content directories.
+	
+	Details:
+		This utility function stores all files found in the specified directories and their subdirectories
+		in a single pack file. Several search paths can be specified using the pipe character (|) as
+		separator; if a file exists in more than one directory, the one from the first search path is used,
+		like in h3dutLoadResourcesFromDisk. The files are stored under their path relative to the content
+		directory, so the pack keeps the directory layout and the resource paths set with h3dutSetResourcePath
+		apply to it as well. Hidden files are skipped. The data of each file is aligned to 64 bytes and
+		stored uncompressed.
+	
+	Parameters:
+		contentDir    - directories where data is located on the drive ((back-)slashes at end are removed)
+		packFileName  - name of the pack file that is created
+		
+	Returns:
+		true in case of success, otherwise false
+*/
+H3D_API bool h3dutCreatePackFile( const char *contentDir, const char *packFileName );
+
+/* Function: h3dutMountPackFile
+		Mounts a pack file for loading resources.
+	
+	Details:
+		This utility function maps a pack file created with h3dutCreatePackFile into memory. Subsequent
+		calls to h3dutLoadResourcesFromDisk look up resources in the mounted pack files (in the order
+		they were mounted) before searching the content directories and pass the data to the engine
+		directly from the mapped memory, without reading it into an intermediate buffer. Mounting a pack
+		that is already mounted has no effect.
+	
+	Parameters:
+		packFileName  - name of the pack file
+		
+	Returns:
+		true if the pack file is mounted, false if it could not be opened or is invalid
+*/
+H3D_API bool h3dutMountPackFile( const char *packFileName );
+
+/* Function: h3dutUnmountPackFile
+		Unmounts a pack file.
+	
+	Details:
+		This utility function unmaps a pack file mounted with h3dutMountPackFile. Resources that were
+		already loaded from it remain loaded.
+	
+	Parameters:
+		packFileName  - name of the pack file as passed to h3dutMountPackFile
+		
+	Returns:
+		true if the pack file was mounted, otherwise false
+*/
+H3D_API bool h3dutUnmountPackFile( const char *packFileName );
+
 /* Function: h3dutCreateGeometryRes
 		Creates a Geometry resource from specified vertex data.
 	
@@ -0,0 +1,168 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#if defined( _MSC_VER )
+#	if _MSC_VER >= 1400
+#		define _CRT_SECURE_NO_DEPRECATE
+#	endif
+#endif
+
+#include "cache.h"
+#include "utils.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+namespace Horde3D {
+namespace ColladaConverter {
+
+
+static const char *manifestHeader = "# ColladaConv conversion cache 1";
+
+
+uint64 hashData( const void *data, size_t size, uint64 hash )
+{
+	// 64 bit FNV-1a
+	const unsigned char *bytes = (const unsigned char *)data;
+	for( size_t i = 0; i < size; ++i )
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+uint64 hashString( const string &str, uint64 hash )
+{
+	return hashData( str.c_str(), str.length() + 1, hash );
+}
+
+
+bool hashFile( const string &fileName, uint64 &hash )
+{
+	FILE *f = fopen( fileName.c_str(), "rb" );
+	if( f == 0x0 ) return false;
+
+	char buf[65536];
+	size_t size;
+	while( (size = fread( buf, 1, sizeof( buf ), f )) > 0 )
+	{
+		hash = hashData( buf, size, hash );
+	}
+
+	fclose( f );
+	return true;
+}
+
+
+ConversionCache::ConversionCache( const string &manifestName ) :
+	_manifestName( manifestName )
+{
+}
+
+
+bool ConversionCache::load()
+{
+	lock_guard< mutex > lock( _mutex );
+	
+	ifstream inf( _manifestName.c_str() );
+	if( !inf.good() ) return false;
+
+	string line;
+	if( !getline( inf, line ) || line != manifestHeader ) return false;
+	
+	// Each line holds asset name, key and outputs separated by tabs
+	while( getline( inf, line ) )
+	{
+		vector< string > fields;
+		stringstream ss( line );
+		string field;
+		while( getline( ss, field, '\t' ) ) fields.push_back( field );
+		if( fields.size() < 2 ) continue;
+
+		Entry &entry = _entries[fields[0]];
+		entry.key = strtoull( fields[1].c_str(), 0x0, 16 );
+		entry.outputs.assign( fields.begin() + 2, fields.end() );
+	}
+
+	return true;
+}
+
+
+bool ConversionCache::save() const
+{
+	lock_guard< mutex > lock( _mutex );
+	
+	ofstream outf( _manifestName.c_str(), ios::out | ios::trunc );
+	if( !outf.good() )
+	{
+		log( "Failed to write conversion cache '" + _manifestName + "'" );
+		return false;
+	}
+
+	outf << manifestHeader << "\n";
+	for( map< string, Entry >::const_iterator itr = _entries.begin(); itr != _entries.end(); ++itr )
+	{
+		outf << itr->first << "\t" << hex << itr->second.key << dec;
+		for( size_t i = 0; i < itr->second.outputs.size(); ++i )
+			outf << "\t" << itr->second.outputs[i];
+		outf << "\n";
+	}
+
+	return outf.good();
+}
+
+
+bool ConversionCache::isUpToDate( const string &assetName, uint64 key ) const
+{
+	vector< string > outputs;
+	{
+		lock_guard< mutex > lock( _mutex );
+		
+		map< string, Entry >::const_iterator itr = _entries.find( assetName );
+		if( itr == _entries.end() || itr->second.key != key ) return false;
+		outputs = itr->second.outputs;
+	}
+	
+	for( size_t i = 0; i < outputs.size(); ++i )
+	{
+		ifstream inf( outputs[i].c_str() );
+		if( !inf.good() ) return false;
+	}
+
+	return true;
+}
+
+
+void ConversionCache::update( const string &assetName, uint64 key, const vector< string > &outputs )
+{
+	lock_guard< mutex > lock( _mutex );
+
+	Entry &entry = _entries[assetName];
+	entry.key = key;
+	entry.outputs = outputs;
+}
+
+
+void ConversionCache::remove( const string &assetName )
+{
+	lock_guard< mutex > lock( _mutex );
+	
+	_entries.erase( assetName );
+}
+
+
+} // namespace ColladaConverter
+} // namespace Horde3D
@@ -0,0 +1,60 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _cache_H_
+#define _cache_H_
+
+#include "utPlatform.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+
+namespace Horde3D {
+namespace ColladaConverter {
+
+
+uint64 hashData( const void *data, size_t size, uint64 hash = 14695981039346656037ULL );
+uint64 hashString( const std::string &str, uint64 hash = 14695981039346656037ULL );
+bool hashFile( const std::string &fileName, uint64 &hash );
+
+
+class ConversionCache
+{
+public:
+	ConversionCache( const std::string &manifestName );
+
+	bool load();
+	bool save() const;
+
+	// An asset is up to date if it was converted with the same key and all of its outputs still exist
+	bool isUpToDate( const std::string &assetName, uint64 key ) const;
+	void update( const std::string &assetName, uint64 key, const std::vector< std::string > &outputs );
+	void remove( const std::string &assetName );
+
+private:
+	struct Entry
+	{
+		uint64                      key;
+		std::vector< std::string >  outputs;
+	};
+
+	std::string                     _manifestName;
+	std::map< std::string, Entry >  _entries;
+	mutable std::mutex              _mutex;
+};
+
+
+} // namespace ColladaConverter
+} // namespace Horde3D
+
+#endif // _cache_H_
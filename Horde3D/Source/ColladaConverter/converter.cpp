@@ -24,6 +24,8 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <unordered_map>
+#include <chrono>
 
 using namespace std;
 namespace Horde3D {
@@ -48,8 +50,9 @@ inline void fwrite_le(const T* data, size_t count, FILE* f)
     }
 }
 
-Converter::Converter( ColladaDocument &doc, const string &outPath, const float *lodDists ) :
-	_daeDoc( doc )
+Converter::Converter( ColladaDocument &doc, const string &outPath, const float *lodDists, float weldEpsilon,
+                      const vector< float > &autoLodRatios ) :
+	_daeDoc( doc ), _weldEpsilon( weldEpsilon ), _autoLodRatios( autoLodRatios )
 {
 	_outPath = outPath;
 	
@@ -70,7 +73,7 @@ Converter::~Converter()
 }
 
 
-bool Converter::convertModel( bool optimize )
+bool Converter::convertModel( bool optimize, bool optimizeOverdraw )
 {
 	if( _daeDoc.scene == 0x0 ) return true;		// Nothing to convert
 	
@@ -93,7 +96,8 @@ bool Converter::convertModel( bool optimize )
 
 	// Process joints and meshes
 	processJoints();
-	processMeshes( optimize );
+	processMeshes( optimize, optimizeOverdraw );
+	if( !_autoLodRatios.empty() ) generateLods( optimize, optimizeOverdraw );
 	
 	return true;
 }
@@ -473,7 +477,63 @@ void Converter::processJoints()
 }
 
 
-void Converter::processMeshes( bool optimize )
+// Vertices are welded if they share the Collada position index (and hence skinning and morph data)
+// and have equal normals and texture coordinates; with a weld epsilon the attributes are compared
+// on a grid of that size
+struct VertexWeldKey
+{
+	unsigned int  posIndex;
+	float         attribs[15];
+
+	VertexWeldKey( const DaeTriGroup &triGroup, const IndexEntry &entry, float invEpsilon )
+	{
+		posIndex = entry.posIndex;
+		
+		Vec3f normal = triGroup.getNormal( entry.normIndex );
+		setAttrib( 0, normal, invEpsilon );
+		for( unsigned int i = 0; i < 4; ++i )
+			setAttrib( 3 + i * 3, triGroup.getTexCoords( entry.texIndex[i], i ), invEpsilon );
+	}
+
+	void setAttrib( unsigned int offset, const Vec3f &v, float invEpsilon )
+	{
+		for( unsigned int i = 0; i < 3; ++i )
+		{
+			// Adding zero turns -0 into +0 so that equal keys have equal hashes
+			if( invEpsilon > 0 ) attribs[offset + i] = floorf( v[i] * invEpsilon + 0.5f ) + 0.0f;
+			else attribs[offset + i] = v[i] + 0.0f;
+		}
+	}
+
+	bool operator==( const VertexWeldKey &key ) const
+	{
+		if( posIndex != key.posIndex ) return false;
+		for( unsigned int i = 0; i < 15; ++i )
+		{
+			if( attribs[i] != key.attribs[i] ) return false;
+		}
+		return true;
+	}
+};
+
+struct VertexWeldKeyHash
+{
+	size_t operator()( const VertexWeldKey &key ) const
+	{
+		// 64 bit FNV-1a
+		uint64 hash = 14695981039346656037ULL ^ key.posIndex;
+		for( unsigned int i = 0; i < 15; ++i )
+		{
+			uint32 bits;
+			memcpy( &bits, &key.attribs[i], sizeof( bits ) );
+			hash = (hash ^ bits) * 1099511628211ULL;
+		}
+		return (size_t)hash;
+	}
+};
+
+
+void Converter::processMeshes( bool optimize, bool optimizeOverdraw )
 {
 	// Note: At the moment the geometry for all nodes is copied and not referenced
 	for( unsigned int i = 0; i < _meshes.size(); ++i )
@@ -572,6 +632,8 @@ void Converter::processMeshes( bool optimize )
 		}
 		
 		unsigned int firstGeoVert = (unsigned int)_vertices.size();
+		unsigned int firstGeoIndex = (unsigned int)_indices.size();
+		chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
 		
 		for( unsigned int j = 0; j < geo->triGroups.size(); ++j )
 		{
@@ -596,34 +658,20 @@ void Converter::processMeshes( bool optimize )
 			oTriGroup->numPosIndices = (unsigned int)iTriGroup.vSource->posSource->floatArray.size() /
 			                          iTriGroup.vSource->posSource->paramsPerItem;
 			oTriGroup->posIndexToVertices = new vector< unsigned int >[oTriGroup->numPosIndices];
+
+			unordered_map< VertexWeldKey, unsigned int, VertexWeldKeyHash > weldMap;
+			weldMap.reserve( iTriGroup.indices.size() );
+			float invWeldEpsilon = _weldEpsilon > 0 ? 1.0f / _weldEpsilon : 0.0f;
 			
 			for( unsigned int k = 0; k < iTriGroup.indices.size(); ++k )
 			{
 				// Try to find vertex
-				vector< unsigned int > &vertList = oTriGroup->posIndexToVertices[iTriGroup.indices[k].posIndex];
-				bool found = false;
-				unsigned int index = (unsigned int)_vertices.size();
-				
-				// Only check vertices that have the same Collada position index
-				for( unsigned int l = 0; l < vertList.size(); ++l )
-				{
-					Vertex &v = _vertices[vertList[l]];
-					
-					if( v.storedPos == iTriGroup.getPos( iTriGroup.indices[k].posIndex ) &&
-						v.storedNormal == iTriGroup.getNormal( iTriGroup.indices[k].normIndex ) &&
-						v.texCoords[0] == iTriGroup.getTexCoords( iTriGroup.indices[k].texIndex[0], 0 ) &&
-						v.texCoords[1] == iTriGroup.getTexCoords( iTriGroup.indices[k].texIndex[1], 1 ) &&
-						v.texCoords[2] == iTriGroup.getTexCoords( iTriGroup.indices[k].texIndex[2], 2 ) &&
-						v.texCoords[3] == iTriGroup.getTexCoords( iTriGroup.indices[k].texIndex[3], 3 ) )
-	
-					{
-						found = true;
-						index = vertList[l];
-						break;
-					}
-				}
+				VertexWeldKey key( iTriGroup, iTriGroup.indices[k], invWeldEpsilon );
+				pair< unordered_map< VertexWeldKey, unsigned int, VertexWeldKeyHash >::iterator, bool > result =
+					weldMap.insert( make_pair( key, (unsigned int)_vertices.size() ) );
+				unsigned int index = result.first->second;
 
-				if( found )
+				if( !result.second )
 				{
 					_indices.push_back( index );	
 				}
@@ -655,27 +703,31 @@ void Converter::processMeshes( bool optimize )
 					// Skinning
 					if( skin != 0x0 && v.daePosIndex < (int)skin->vertWeights.size() )
 					{
-						DaeVertWeights vertWeights = skin->vertWeights[v.daePosIndex];
+						const DaeVertWeights &vertWeights = skin->vertWeights[v.daePosIndex];
 						
-						// Sort weights
+						// Select the four most significant weights; weights pushed beyond the fourth
+						// slot never move forward again, so this gives the same order as sorting all
+						// weights with the same swap scheme
+						const DaeWeight *topWeights[4];
+						unsigned int numTopWeights = 0;
 						for( unsigned int xx = 0; xx < vertWeights.size(); ++xx )
 						{
-							for( unsigned int yy = 0; yy < xx; ++yy )
+							const DaeWeight *weight = &vertWeights[xx];
+							for( unsigned int yy = 0; yy < numTopWeights; ++yy )
 							{
-								if( skin->weightArray->floatArray[(int)vertWeights[xx].weight] >
-								    skin->weightArray->floatArray[(int)vertWeights[yy].weight] )
+								if( skin->weightArray->floatArray[weight->weight] >
+								    skin->weightArray->floatArray[topWeights[yy]->weight] )
 								{
-									swap( vertWeights[xx], vertWeights[yy] );
+									swap( weight, topWeights[yy] );
 								}
 							}
+							if( numTopWeights < 4 ) topWeights[numTopWeights++] = weight;
 						}
 						
-						// Take the four most significant weights
-						for( unsigned int l = 0; l < vertWeights.size(); ++l )
+						for( unsigned int l = 0; l < numTopWeights; ++l )
 						{
-							if( l == 4 ) break;
-							v.weights[l] = skin->weightArray->floatArray[vertWeights[l].weight];
-							v.joints[l] = jointLookup[vertWeights[l].joint];
+							v.weights[l] = skin->weightArray->floatArray[topWeights[l]->weight];
+							v.joints[l] = jointLookup[topWeights[l]->joint];
 						}
 
 						// Normalize weights
@@ -712,7 +764,7 @@ void Converter::processMeshes( bool optimize )
 					_vertices.push_back( v );
 					_indices.push_back( index );
 
-					vertList.push_back( (unsigned int)_vertices.size() - 1 );
+					oTriGroup->posIndexToVertices[v.daePosIndex].push_back( index );
 				}
 			}
 
@@ -732,6 +784,14 @@ void Converter::processMeshes( bool optimize )
 
 		unsigned int numGeoVerts = (unsigned int)_vertices.size() - firstGeoVert;
 
+		{
+			stringstream ss;
+			ss << "Mesh '" << _meshes[i]->daeNode->id << "': " << numGeoVerts << " vertices, ";
+			ss << (_indices.size() - firstGeoIndex) / 3 << " triangles, built in " << fixed << setprecision( 2 );
+			ss << chrono::duration< double, milli >( chrono::steady_clock::now() - startTime ).count() << " ms";
+			log( ss.str() );
+		}
+
 		// Morph targets
 		if( morpher != 0x0 && morpher->targetArray != 0x0 )
 		{
@@ -819,81 +879,199 @@ void Converter::processMeshes( bool optimize )
 	// Calculate tangent space basis for base mesh
 	calcTangentSpaceBasis( _vertices );
 
-	// Calculate tangent space basis for morph targets
-	vector< Vertex > verts( _vertices );
-	for( unsigned int i = 0; i < _morphTargets.size(); ++i )
+	// Calculate tangent space basis for morph targets; each task works on its own copy
+	// of the vertices and handles every numTasks-th target
+	unsigned int numTasks = min( getJobCount(), (unsigned int)_morphTargets.size() );
+	parallelFor( numTasks, [&]( unsigned int task )
 	{
-		// Morph
-		for( unsigned int j = 0; j < _morphTargets[i].diffs.size(); ++j )
-		{	
-			verts[_morphTargets[i].diffs[j].vertIndex].pos += _morphTargets[i].diffs[j].posDiff;
-		}
+		vector< Vertex > verts( _vertices );
+		for( unsigned int i = task; i < _morphTargets.size(); i += numTasks )
+		{
+			// Morph
+			for( unsigned int j = 0; j < _morphTargets[i].diffs.size(); ++j )
+			{	
+				verts[_morphTargets[i].diffs[j].vertIndex].pos += _morphTargets[i].diffs[j].posDiff;
+			}
 
-		calcTangentSpaceBasis( verts );
+			calcTangentSpaceBasis( verts );
 
-		// Find basis differences and undo morphing
-		for( unsigned int j = 0; j < _morphTargets[i].diffs.size(); ++j )
-		{	
-			MorphDiff &md = _morphTargets[i].diffs[j];
-			
-			verts[md.vertIndex].pos -= md.posDiff;
-			md.normDiff = verts[md.vertIndex].normal - _vertices[md.vertIndex].normal;
-			md.tanDiff = verts[md.vertIndex].tangent - _vertices[md.vertIndex].tangent;
-			md.bitanDiff = verts[md.vertIndex].bitangent - _vertices[md.vertIndex].bitangent;
+			// Find basis differences and undo morphing
+			for( unsigned int j = 0; j < _morphTargets[i].diffs.size(); ++j )
+			{	
+				MorphDiff &md = _morphTargets[i].diffs[j];
+				
+				verts[md.vertIndex].pos -= md.posDiff;
+				md.normDiff = verts[md.vertIndex].normal - _vertices[md.vertIndex].normal;
+				md.tanDiff = verts[md.vertIndex].tangent - _vertices[md.vertIndex].tangent;
+				md.bitanDiff = verts[md.vertIndex].bitangent - _vertices[md.vertIndex].bitangent;
+			}
 		}
-	}
+	} );
 
-	// Optimization and clean up
-	float optEffBefore = 0, optEffAfter = 0;
-	unsigned int optNumCalls = 0;
+	// Optimization and clean up; triangle groups use disjoint index and vertex ranges,
+	// so they can be processed in parallel
+	vector< TriGroup * > triGroups;
 	for( unsigned int i = 0; i < _meshes.size(); ++i )
+		triGroups.insert( triGroups.end(), _meshes[i]->triGroups.begin(), _meshes[i]->triGroups.end() );
+	
+	vector< vector< unsigned int > > vertMaps( optimize ? triGroups.size() : 0 );
+	vector< float > optEffBefore( vertMaps.size() ), optEffAfter( vertMaps.size() );
+	
+	parallelFor( (unsigned int)triGroups.size(), [&]( unsigned int i )
 	{
-		for( unsigned int j = 0; j < _meshes[i]->triGroups.size(); ++j )
+		TriGroup *triGroup = triGroups[i];
+		
+		// Optimize order of indices for best vertex cache usage and remap vertices
+		if( optimize )
+		{
+			optEffBefore[i] = MeshOptimizer::calcCacheEfficiency( triGroup, _indices );
+			MeshOptimizer::optimizeIndexOrder( triGroup, _indices );
+			if( optimizeOverdraw ) MeshOptimizer::optimizeOverdraw( triGroup, _vertices, _indices, 1.05f );
+			optEffAfter[i] = MeshOptimizer::calcCacheEfficiency( triGroup, _indices );
+			MeshOptimizer::optimizeVertexFetch( triGroup, _vertices, _indices, vertMaps[i] );
+		}
+		
+		// Clean up
+		delete[] triGroup->posIndexToVertices;
+		triGroup->posIndexToVertices = 0x0;
+	} );
+
+	// Update morph target vertex indices according to vertex remapping
+	for( unsigned int i = 0; i < vertMaps.size(); ++i )
+	{
+		TriGroup *triGroup = triGroups[i];
+		
+		for( unsigned int k = 0; k < _morphTargets.size(); ++k )
 		{
-			// Optimize order of indices for best vertex cache usage and remap vertices
-			if( optimize )
+			for( unsigned int l = 0; l < _morphTargets[k].diffs.size(); ++l )
 			{
-				map< unsigned int, unsigned int > vertMap;
-				
-				++optNumCalls;
-				optEffBefore += MeshOptimizer::calcCacheEfficiency( _meshes[i]->triGroups[j], _indices );
-				MeshOptimizer::optimizeIndexOrder( _meshes[i]->triGroups[j], _vertices, _indices, vertMap );
-				optEffAfter += MeshOptimizer::calcCacheEfficiency( _meshes[i]->triGroups[j], _indices );
+				unsigned int &vertIndex = _morphTargets[k].diffs[l].vertIndex;
 
-				// Update morph target vertex indices according to vertex remapping
-				for( unsigned int k = 0; k < _morphTargets.size(); ++k )
+				if( vertIndex >= triGroup->vertRStart && vertIndex <= triGroup->vertREnd &&
+				    vertMaps[i][vertIndex - triGroup->vertRStart] != 0xffffffff )
 				{
-					for( unsigned int l = 0; l < _morphTargets[k].diffs.size(); ++l )
-					{
-						map< unsigned int, unsigned int >::iterator itr1 =
-							vertMap.find( _morphTargets[k].diffs[l].vertIndex );
-
-						if( itr1 != vertMap.end() )
-						{
-							_morphTargets[k].diffs[l].vertIndex = itr1->second;
-						}
-					}
+					vertIndex = triGroup->vertRStart + vertMaps[i][vertIndex - triGroup->vertRStart];
 				}
 			}
-			
-			// Clean up
-			delete[] _meshes[i]->triGroups[j]->posIndexToVertices;
-			_meshes[i]->triGroups[j]->posIndexToVertices = 0x0;
 		}
 	}
 
 	// Output info about optimization
-	/*if( optNumCalls > 0 )
+	/*if( !optEffBefore.empty() )
 	{
 		stringstream ss;
 		ss << fixed << setprecision( 3 );
-		ss << "Optimized geometry for vertex cache: from ATVR " << optEffBefore / optNumCalls;
-		ss << " to ATVR " << optEffAfter / optNumCalls;
+		ss << "Optimized geometry for vertex cache: from ATVR ";
+		ss << accumulate( optEffBefore.begin(), optEffBefore.end(), 0.0f ) / optEffBefore.size();
+		ss << " to ATVR " << accumulate( optEffAfter.begin(), optEffAfter.end(), 0.0f ) / optEffAfter.size();
 		log( ss.str() );
 	}*/
 }
 
 
+void Converter::generateLods( bool optimize, bool optimizeOverdraw )
+{
+	if( _maxLodLevel > 0 )
+	{
+		log( "Skipping automatic LOD generation since model has authored LOD meshes" );
+		return;
+	}
+
+	const unsigned int numLevels = min( (unsigned int)_autoLodRatios.size(), 4u );
+	const size_t numBaseMeshes = _meshes.size();
+	
+	// Simplify every triangle group of the base meshes for every level; the LOD groups share the
+	// vertices of their base group, so skinning and morph targets remain valid
+	vector< TriGroup * > baseGroups;
+	for( size_t i = 0; i < numBaseMeshes; ++i )
+		baseGroups.insert( baseGroups.end(), _meshes[i]->triGroups.begin(), _meshes[i]->triGroups.end() );
+
+	vector< vector< unsigned int > > lodIndices( baseGroups.size() * numLevels );
+	vector< float > lodErrors( lodIndices.size() );
+	
+	parallelFor( (unsigned int)lodIndices.size(), [&]( unsigned int i )
+	{
+		TriGroup *baseGroup = baseGroups[i / numLevels];
+		float ratio = _autoLodRatios[i % numLevels];
+		unsigned int targetCount = (unsigned int)(baseGroup->count / 3 * ratio) * 3;
+		
+		lodErrors[i] = MeshOptimizer::simplify( baseGroup, _vertices, _indices, targetCount, lodIndices[i] );
+	} );
+
+	// Create LOD meshes next to their base mesh
+	vector< unsigned int > numTris( numLevels + 1, 0 );
+	vector< float > maxErrors( numLevels + 1, 0 );
+	vector< TriGroup * > lodGroups;
+	size_t baseGroupIndex = 0;
+	
+	for( size_t i = 0; i < numBaseMeshes; ++i )
+	{
+		Mesh *mesh = _meshes[i];
+		for( unsigned int j = 0; j < mesh->triGroups.size(); ++j ) numTris[0] += mesh->triGroups[j]->count / 3;
+		
+		for( unsigned int level = 1; level <= numLevels; ++level )
+		{
+			Mesh *lodMesh = new Mesh();
+			(SceneNode &)*lodMesh = *mesh;
+			lodMesh->children.clear();
+			lodMesh->lodLevel = level;
+
+			for( unsigned int j = 0; j < mesh->triGroups.size(); ++j )
+			{
+				TriGroup *baseGroup = mesh->triGroups[j];
+				vector< unsigned int > &indices = lodIndices[(baseGroupIndex + j) * numLevels + level - 1];
+				
+				TriGroup *lodGroup = new TriGroup();
+				lodGroup->matName = baseGroup->matName;
+				lodGroup->first = (unsigned int)_indices.size();
+				lodGroup->count = (unsigned int)indices.size();
+				lodGroup->vertRStart = baseGroup->vertRStart;
+				lodGroup->vertREnd = baseGroup->vertREnd;
+				lodGroup->numPosIndices = 0;
+				_indices.insert( _indices.end(), indices.begin(), indices.end() );
+				
+				lodMesh->triGroups.push_back( lodGroup );
+				lodGroups.push_back( lodGroup );
+				numTris[level] += lodGroup->count / 3;
+				maxErrors[level] = max( maxErrors[level], lodErrors[(baseGroupIndex + j) * numLevels + level - 1] );
+			}
+
+			if( mesh->parent != 0x0 )
+			{
+				vector< SceneNode * > &siblings = mesh->parent->children;
+				siblings.insert( find( siblings.begin(), siblings.end(), mesh ) + level, lodMesh );
+			}
+			else
+			{
+				_nodes.push_back( lodMesh );
+			}
+			_meshes.push_back( lodMesh );
+		}
+		
+		baseGroupIndex += mesh->triGroups.size();
+	}
+
+	if( optimize )
+	{
+		parallelFor( (unsigned int)lodGroups.size(), [&]( unsigned int i )
+		{
+			MeshOptimizer::optimizeIndexOrder( lodGroups[i], _indices );
+			if( optimizeOverdraw ) MeshOptimizer::optimizeOverdraw( lodGroups[i], _vertices, _indices, 1.05f );
+		} );
+	}
+	
+	_maxLodLevel = numLevels;
+
+	for( unsigned int level = 1; level <= numLevels; ++level )
+	{
+		stringstream ss;
+		ss << "Generated LOD " << level << ": " << numTris[level] << " of " << numTris[0] << " triangles, "
+		   << "max error " << maxErrors[level];
+		log( ss.str() );
+	}
+}
+
+
 bool Converter::writeGeometry( const string &assetPath, const string &assetName ) const
 {
 	string fileName = _outPath + assetPath + assetName + ".geo";
@@ -1119,6 +1297,232 @@ bool Converter::writeGeometry( const string &assetPath, const string &assetName
 }
 
 
+static unsigned int packSNorm10_10_10_2( const Vec3f &v, float w )
+{
+	float comps[4] = { v.x, v.y, v.z, w };
+	unsigned int packed = 0;
+	for( unsigned int i = 0; i < 4; ++i )
+	{
+		float scale = i < 3 ? 511.0f : 1.0f;
+		int value = (int)floorf( clamp( comps[i], -1.0f, 1.0f ) * scale + 0.5f );
+		packed |= ((unsigned int)value & (i < 3 ? 0x3ff : 0x3)) << (i * 10);
+	}
+	return packed;
+}
+
+
+static unsigned short packUNorm16( float v )
+{
+	return (unsigned short)floorf( clamp( v, 0.0f, 1.0f ) * 65535.0f + 0.5f );
+}
+
+
+bool Converter::writeGeometryV6( const string &assetPath, const string &assetName, bool quantize ) const
+{
+	// Version 6 stores the vertex data in the layout of the runtime streams of the engine, so
+	// that it can be uploaded without decoding; the header is followed by an index of 16 byte
+	// aligned sections
+	string fileName = _outPath + assetPath + assetName + ".geo";
+	FILE *f = fopen( fileName.c_str(), "wb" );
+	if( f == 0x0 )
+	{	
+		log( "Failed to write " + fileName + " file" );
+		return false;
+	}
+
+	const unsigned int numVerts = (unsigned int)_vertices.size();
+	const bool indices16 = numVerts <= 65536;
+	
+	// Joints including default joint with identity matrix; static geometry has no joints, so that
+	// the engine does not keep CPU copies of its vertex data for skinning
+	vector< float > jointData( _joints.empty() ? 0 : (_joints.size() + 1) * 16 );
+	Matrix4f identity;
+	if( !_joints.empty() ) memcpy( &jointData[0], identity.x, 16 * sizeof( float ) );
+	for( unsigned int i = 0; i < _joints.size(); ++i )
+		memcpy( &jointData[(i + 1) * 16], _joints[i]->invBindMat.x, 16 * sizeof( float ) );
+
+	// Vertex streams: position; normal, tangent and handedness; texture coordinates and skinning data
+	vector< float > posData( numVerts * 3 ), tanData( numVerts * 7 ), staticData( numVerts * 12 );
+	for( unsigned int i = 0; i < numVerts; ++i )
+	{
+		const Vertex &v = _vertices[i];
+		
+		float *pos = &posData[i * 3];
+		pos[0] = v.pos.x; pos[1] = v.pos.y; pos[2] = v.pos.z;
+
+		float *tan = &tanData[i * 7];
+		tan[0] = v.normal.x; tan[1] = v.normal.y; tan[2] = v.normal.z;
+		tan[3] = v.tangent.x; tan[4] = v.tangent.y; tan[5] = v.tangent.z;
+		tan[6] = v.normal.cross( v.tangent ).dot( v.bitangent ) < 0 ? -1.0f : 1.0f;
+
+		float *st = &staticData[i * 12];
+		st[0] = v.texCoords[0].x; st[1] = v.texCoords[0].y;
+		for( unsigned int j = 0; j < 4; ++j )
+		{
+			st[2 + j] = v.joints[j] != 0x0 && !_joints.empty() ? (float)v.joints[j]->index : 0.0f;
+			st[6 + j] = _joints.empty() ? (j == 0 ? 1.0f : 0.0f) : v.weights[j];
+		}
+		st[10] = v.texCoords[1].x; st[11] = v.texCoords[1].y;
+	}
+
+	// Quantized streams: normal and tangent as signed normalized 10_10_10_2, texture coordinates as
+	// unsigned normalized 16 bit, joint indices and weights as bytes
+	if( quantize )
+	{
+		for( unsigned int i = 0; i < numVerts && quantize; ++i )
+		{
+			for( unsigned int j = 0; j < 2; ++j )
+			{
+				const Vec3f &uv = _vertices[i].texCoords[j];
+				if( uv.x < 0 || uv.x > 1 || uv.y < 0 || uv.y > 1 ) quantize = false;
+			}
+		}
+		if( !quantize ) log( "Texture coordinates outside of [0, 1]; vertex data is not quantized" );
+	}
+
+	vector< unsigned int > tanDataQuantized( quantize ? numVerts * 2 : 0 );
+	vector< unsigned short > uvDataQuantized( quantize ? numVerts * 4 : 0 );
+	vector< unsigned char > skinDataQuantized( quantize ? numVerts * 8 : 0 );
+	for( unsigned int i = 0; i < tanDataQuantized.size() / 2; ++i )
+	{
+		tanDataQuantized[i * 2] = packSNorm10_10_10_2( _vertices[i].normal, 0 );
+		tanDataQuantized[i * 2 + 1] = packSNorm10_10_10_2( _vertices[i].tangent, tanData[i * 7 + 6] );
+
+		const float *st = &staticData[i * 12];
+		uvDataQuantized[i * 4 + 0] = packUNorm16( st[0] );
+		uvDataQuantized[i * 4 + 1] = packUNorm16( st[1] );
+		uvDataQuantized[i * 4 + 2] = packUNorm16( st[10] );
+		uvDataQuantized[i * 4 + 3] = packUNorm16( st[11] );
+		for( unsigned int j = 0; j < 4; ++j )
+		{
+			skinDataQuantized[i * 8 + j] = (unsigned char)st[2 + j];
+			skinDataQuantized[i * 8 + 4 + j] = (unsigned char)floorf( clamp( st[6 + j], 0.0f, 1.0f ) * 255.0f + 0.5f );
+		}
+	}
+	if( quantize )
+	{
+		stringstream ss;
+		ss << "Quantized vertex data: " << numVerts * 36 / 1024 << " KB instead of " << numVerts * 88 / 1024 << " KB";
+		log( ss.str() );
+	}
+	
+	vector< unsigned short > indexData16( indices16 ? _indices.size() : 0 );
+	for( size_t i = 0; i < indexData16.size(); ++i ) indexData16[i] = (unsigned short)_indices[i];
+
+	// Morph targets: name, number of diffs and diffs of vertex index, position, normal and tangent
+	unsigned int morphSize = 0;
+	for( unsigned int i = 0; i < _morphTargets.size(); ++i )
+		morphSize += 256 + 4 + (unsigned int)_morphTargets[i].diffs.size() * 40;
+
+	// Clusters of large static triangle groups for culling at a finer granularity than meshes;
+	// skinned and morphed geometry is deformed at runtime, so its bounds are not known in advance
+	const unsigned int clusterTriCount = 128, minClusteredTriCount = 512;
+	vector< MeshCluster > clusters;
+	if( _joints.empty() && _morphTargets.empty() )
+	{
+		for( unsigned int i = 0; i < _meshes.size(); ++i )
+		{
+			for( unsigned int j = 0; j < _meshes[i]->triGroups.size(); ++j )
+			{
+				const TriGroup *triGroup = _meshes[i]->triGroups[j];
+				if( triGroup->count >= minClusteredTriCount * 3 )
+					MeshOptimizer::buildClusters( triGroup, _vertices, _indices, clusterTriCount, clusters );
+			}
+		}
+		std::sort( clusters.begin(), clusters.end(),
+			[]( const MeshCluster &a, const MeshCluster &b ) { return a.firstIndex < b.firstIndex; } );
+	}
+
+	// Build section index
+	const unsigned int numSections = 7;
+	unsigned int sectionSizes[numSections] = {
+		(unsigned int)jointData.size() * 4, (unsigned int)posData.size() * 4, numVerts * (quantize ? 8 : 28),
+		numVerts * (quantize ? 16 : 48), (unsigned int)_indices.size() * (indices16 ? 2 : 4), morphSize,
+		(unsigned int)clusters.size() * 40 };
+	unsigned int sectionOffsets[numSections];
+	unsigned int offset = 32 + numSections * 12;
+	for( unsigned int i = 0; i < numSections; ++i )
+	{
+		offset = (offset + 15) & ~15u;
+		sectionOffsets[i] = offset;
+		offset += sectionSizes[i];
+	}
+
+	// Write header
+	unsigned int flags = (indices16 ? 1u : 0u) | (quantize ? 2u : 0u);
+	unsigned int header[7] = { 6, flags, (unsigned int)jointData.size() / 16, numVerts,
+		(unsigned int)_indices.size(), (unsigned int)_morphTargets.size(), numSections };
+	fwrite_le( "H3DG", 4, f );
+	fwrite_le( header, 7, f );
+	for( unsigned int i = 0; i < numSections; ++i )
+	{
+		unsigned int entry[3] = { i, sectionOffsets[i], sectionSizes[i] };
+		fwrite_le( entry, 3, f );
+	}
+
+	// Write sections
+	auto pad = [f]( unsigned int offset )
+	{
+		while( (unsigned int)ftell( f ) < offset ) fputc( 0, f );
+	};
+	
+	pad( sectionOffsets[0] ); fwrite_le( jointData.data(), jointData.size(), f );
+	pad( sectionOffsets[1] ); fwrite_le( posData.data(), posData.size(), f );
+	pad( sectionOffsets[2] );
+	if( quantize ) fwrite_le( tanDataQuantized.data(), tanDataQuantized.size(), f );
+	else fwrite_le( tanData.data(), tanData.size(), f );
+	pad( sectionOffsets[3] );
+	if( quantize )
+	{
+		for( unsigned int i = 0; i < numVerts; ++i )
+		{
+			fwrite_le( &uvDataQuantized[i * 4], 2, f );
+			fwrite_le( &skinDataQuantized[i * 8], 8, f );
+			fwrite_le( &uvDataQuantized[i * 4 + 2], 2, f );
+		}
+	}
+	else
+	{
+		fwrite_le( staticData.data(), staticData.size(), f );
+	}
+	pad( sectionOffsets[4] );
+	if( indices16 ) fwrite_le( indexData16.data(), indexData16.size(), f );
+	else fwrite_le( _indices.data(), _indices.size(), f );
+	
+	pad( sectionOffsets[5] );
+	for( unsigned int i = 0; i < _morphTargets.size(); ++i )
+	{
+		fwrite_le( _morphTargets[i].name, 256, f );
+		unsigned int count = (unsigned int)_morphTargets[i].diffs.size();
+		fwrite_le( &count, 1, f );
+		
+		for( unsigned int j = 0; j < count; ++j )
+		{
+			const MorphDiff &md = _morphTargets[i].diffs[j];
+			float diffs[9] = { md.posDiff.x, md.posDiff.y, md.posDiff.z, md.normDiff.x, md.normDiff.y, md.normDiff.z,
+			                   md.tanDiff.x, md.tanDiff.y, md.tanDiff.z };
+			fwrite_le( &md.vertIndex, 1, f );
+			fwrite_le( diffs, 9, f );
+		}
+	}
+
+	pad( sectionOffsets[6] );
+	for( unsigned int i = 0; i < clusters.size(); ++i )
+	{
+		const MeshCluster &cl = clusters[i];
+		unsigned int range[2] = { cl.firstIndex, cl.indexCount };
+		float bounds[8] = { cl.center[0], cl.center[1], cl.center[2], cl.radius,
+		                    cl.coneAxis[0], cl.coneAxis[1], cl.coneAxis[2], cl.coneCutoff };
+		fwrite_le( range, 2, f );
+		fwrite_le( bounds, 8, f );
+	}
+	
+	fclose( f );
+
+	return true;
+}
+
+
 void Converter::writeSGNode( const string &assetPath, const string &modelName, SceneNode *node, unsigned int depth, ofstream &outf ) const
 {
 	Vec3f trans, rot, scale;
@@ -1259,18 +1663,27 @@ bool Converter::writeSceneGraph( const string &assetPath, const string &assetNam
 }
 
 
-bool Converter::writeModel( const std::string &assetPath, const std::string &assetName, const std::string &modelName ) const
+bool Converter::writeModel( const std::string &assetPath, const std::string &assetName, const std::string &modelName,
+                            unsigned int geoVersion, bool quantize ) const
 {
 	bool result = true;
 	
-	if( !writeGeometry( assetPath, assetName ) ) result = false;
+	if( geoVersion == 6 )
+	{
+		if( !writeGeometryV6( assetPath, assetName, quantize ) ) result = false;
+	}
+	else
+	{
+		if( !writeGeometry( assetPath, assetName ) ) result = false;
+	}
 	if( !writeSceneGraph( assetPath, assetName, modelName ) ) result = false;
 
 	return result;
 }
 
 
-bool Converter::writeMaterials( const string &assetPath, const string &modelName, bool replace ) const
+void Converter::buildMaterials( const string &assetPath, const string &modelName,
+                                vector< MaterialFile > &materials ) const
 {
 	for( unsigned int i = 0; i < _daeDoc.libMaterials.materials.size(); ++i )
 	{
@@ -1278,26 +1691,9 @@ bool Converter::writeMaterials( const string &assetPath, const string &modelName
 		
 		if( !material.used ) continue;
 		
-		string fileName = _outPath + assetPath + modelName + material.name + ".material.xml";
-		
-		if( !replace )
-		{
-			// Skip writing material file if it already exists
-			ifstream inf( fileName.c_str() );
-			if( inf.good() )
-			{	
-				log( "Skipping material '" + assetPath + modelName + material.name + ".material.xml'" );
-				continue;
-			}
-		}
-
-		ofstream outf;
-		outf.open( fileName.c_str(), ios::out );
-		if( !outf.good() )
-		{
-			log( "Failed writing .material.xml file" );
-			continue;
-		}
+		materials.push_back( MaterialFile() );
+		materials.back().fileName = assetPath + modelName + material.name + ".material.xml";
+		ostringstream outf;
 
 		outf << "<Material>\n";
 		
@@ -1348,10 +1744,59 @@ bool Converter::writeMaterials( const string &assetPath, const string &modelName
 		
 		outf << "</Material>\n";
 
+		materials.back().data = outf.str();
+	}
+}
+
+
+bool writeMaterialFiles( const string &outPath, const vector< MaterialFile > &materials, bool replace )
+{
+	bool result = true;
+	
+	// Same result as converting the assets one after another: a replaced material is the one of the
+	// last asset that uses it, otherwise the first asset creates it
+	unordered_map< string, size_t > owners;
+	for( size_t i = 0; i < materials.size(); ++i )
+	{
+		if( replace ) owners[materials[i].fileName] = i;
+		else owners.insert( make_pair( materials[i].fileName, i ) );
+	}
+	
+	for( size_t i = 0; i < materials.size(); ++i )
+	{
+		string fileName = outPath + materials[i].fileName;
+		
+		if( owners[materials[i].fileName] != i )
+		{
+			log( "Skipping material '" + materials[i].fileName + "' (written by another asset)" );
+			continue;
+		}
+		
+		if( !replace )
+		{
+			// Skip writing material file if it already exists
+			ifstream inf( fileName.c_str() );
+			if( inf.good() )
+			{	
+				log( "Skipping material '" + materials[i].fileName + "'" );
+				continue;
+			}
+		}
+
+		ofstream outf;
+		outf.open( fileName.c_str(), ios::out );
+		if( !outf.good() )
+		{
+			log( "Failed writing .material.xml file" );
+			result = false;
+			continue;
+		}
+
+		outf << materials[i].data;
 		outf.close();
 	}
 	
-	return true;
+	return result;
 }
 
 
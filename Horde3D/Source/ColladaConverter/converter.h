@@ -140,16 +140,30 @@ struct MorphTarget
 };
 
 
+struct MaterialFile
+{
+	std::string  fileName;  // Relative to output path
+	std::string  data;
+};
+
+// Writes materials in the given order; when several entries share a file, the last one is written
+// if existing files are replaced and the first one otherwise (as when converting them one by one)
+bool writeMaterialFiles( const std::string &outPath, const std::vector< MaterialFile > &materials, bool replace );
+
+
 class Converter
 {
 public:
-	Converter( ColladaDocument &doc, const std::string &outPath, const float *lodDists );
+	Converter( ColladaDocument &doc, const std::string &outPath, const float *lodDists, float weldEpsilon = 0,
+	           const std::vector< float > &autoLodRatios = std::vector< float >() );
 	~Converter();
 	
-	bool convertModel( bool optimize );
+	bool convertModel( bool optimize, bool optimizeOverdraw );
 	
-	bool writeModel( const std::string &assetPath, const std::string &assetName, const std::string &modelName ) const;
-	bool writeMaterials( const std::string &assetPath, const std::string &modelName, bool replace ) const;
+	bool writeModel( const std::string &assetPath, const std::string &assetName, const std::string &modelName,
+	                 unsigned int geoVersion = 5, bool quantize = false ) const;
+	void buildMaterials( const std::string &assetPath, const std::string &modelName,
+	                     std::vector< MaterialFile > &materials ) const;
 	bool hasAnimation() const;
 	bool writeAnimation( const std::string &assetPath, const std::string &assetName ) const;
 
@@ -162,8 +176,10 @@ private:
 	                        Matrix4f transAccum, std::vector< Matrix4f > animTransAccum );
 	void calcTangentSpaceBasis( std::vector< Vertex > &vertices ) const;
 	void processJoints();
-	void processMeshes( bool optimize );
+	void processMeshes( bool optimize, bool optimizeOverdraw );
+	void generateLods( bool optimize, bool optimizeOverdraw );
 	bool writeGeometry( const std::string &assetPath, const std::string &assetName ) const;
+	bool writeGeometryV6( const std::string &assetPath, const std::string &assetName, bool quantize ) const;
 	void writeSGNode( const std::string &assetPath, const std::string &modelName, SceneNode *node, unsigned int depth, std::ofstream &outf ) const;
 	bool writeSceneGraph( const std::string &assetPath, const std::string &assetName, const std::string &modelName ) const;
 	void writeAnimFrames( SceneNode &node, FILE *f ) const;
@@ -180,6 +196,8 @@ private:
 
 	std::string                  _outPath;
 	float                        _lodDist1, _lodDist2, _lodDist3, _lodDist4;
+	float                        _weldEpsilon;  // Tolerance for merging normals and texture coordinates
+	std::vector< float >         _autoLodRatios;  // Triangle ratios of generated LOD levels
 	unsigned int                 _frameCount;
 	unsigned int                 _maxLodLevel;
 	bool                         _animNotSampled;
@@ -68,19 +68,14 @@ struct DaeSource
 			if( str == 0x0 ) return false;
 			
 			if( isFloatArray )
-				floatArray.reserve( count );
+			{
+				parseFloatArray( str, floatArray, count );
+				floatArray.resize( count );  // Missing values are zero
+			}
 			else
-				stringArray.reserve( count );
-			
-			for( int i = 0; i < count; ++i )
 			{
-				if( isFloatArray )
-				{
-					float f;
-					parseFloat( str, f );
-					floatArray.push_back( f );
-				}
-				else
+				stringArray.reserve( count );
+				for( int i = 0; i < count; ++i )
 				{
 					parseString( str, name );
 					stringArray.push_back( name );
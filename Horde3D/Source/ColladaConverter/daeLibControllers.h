@@ -158,7 +158,7 @@ struct DaeSkin
 		if( str == 0x0 ) return false;
 		for( int i = 0; i < count; ++i )
 		{
-			int si;
+			int si = 0;
 			parseInt( str, si );
 
 			DaeVertWeights vertWeight;
@@ -179,7 +179,7 @@ struct DaeSkin
 			{
 				for( unsigned int k = 0; k < numInputs; ++k )
 				{
-					int si;
+					int si = 0;
 					parseInt( str, si );
 
 					if( k == jointOffset ) vertWeights[i][j].joint = si;
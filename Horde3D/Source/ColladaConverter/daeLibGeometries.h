@@ -177,20 +177,37 @@ struct DaeTriGroup
 			vcountStr = (char *)primitiveNode.getFirstChild( "vcount" ).getText();
 		}
 
+		// Triangle lists have a single p element with a known number of values
+		size_t numValues = 0;
+		if( primType == tTriangles )
+		{
+			numValues = (size_t)atoi( primitiveNode.getAttribute( "count", "0" ) ) * 3 * inputsPerVert;
+			indices.reserve( indices.size() + numValues / std::max( inputsPerVert, 1 ) );
+		}
+
 		// Parse actual primitive data
 		node1 = primitiveNode.getFirstChild( "p" );
 		while( !node1.isEmpty() )
 		{
 			char *str = (char *)node1.getText();
 			if( str == 0x0 ) return false;
+
+			// Large index lists are converted up front when multiple threads are available,
+			// otherwise values are parsed while they are processed
+			bool preparsed = getJobCount() > 1;
+			std::vector< int > values;
+			size_t valueIndex = 0;
+			if( preparsed ) parseIntArray( str, values, numValues );
 			
 			int           si;
 			unsigned int  curInput = 0, vertCnt = 0;
 			IndexEntry    indexEntry;
 			IndexEntry    firstIndex, lastIndex;
 			
-			while( parseInt( str, si ) )
+			while( preparsed ? valueIndex < values.size() : parseInt( str, si ) )
 			{
+				if( preparsed ) si = values[valueIndex++];
+				
 				// No else-if since offset sharing is possible
 				if( (int)curInput == vertexOffset )
 					indexEntry.posIndex = (unsigned)si;
@@ -210,7 +227,7 @@ struct DaeTriGroup
 					if( primType == tPolylist && vertCnt == numVerts )
 					{
 						vertCnt = 0;
-						parseInt( vcountStr, si );
+						if( !parseInt( vcountStr, si ) ) si = 0;
 						numVerts = (unsigned)si;
 					}
 					
@@ -13,6 +13,9 @@
 #include "daeMain.h"
 #include "utXML.h"
 #include "utils.h"
+#include <chrono>
+#include <sstream>
+#include <iomanip>
 
 using namespace std;
 namespace Horde3D {
@@ -28,13 +31,18 @@ ColladaDocument::ColladaDocument()
 
 bool ColladaDocument::parseFile( const string &fileName )
 {
-	// Parse Collada file
-	XMLDoc doc;
-	if( !doc.parseFile( fileName.c_str() ) )
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+	
+	// Parse Collada file in place
+	MappedFile file;
+	if( !file.open( fileName ) )
 	{
 		log( "Error: file '" + fileName + "' not found" );
 		return false;
 	}
+	
+	XMLDoc doc;
+	doc.parseString( file.getData() );
 
 	if( doc.hasError() )
 	{
@@ -129,6 +137,13 @@ bool ColladaDocument::parseFile( const string &fileName )
 	}
 	
 	if( !foundScene ) log( "Warning: No scene instance found" );
+
+	double seconds = chrono::duration< double >( chrono::steady_clock::now() - startTime ).count();
+	double megabytes = file.getSize() / (1024.0 * 1024.0);
+	stringstream ss;
+	ss << fixed << setprecision( 2 ) << "Parsed " << megabytes << " MB in " << seconds << " s";
+	if( seconds > 0 ) ss << " (" << setprecision( 1 ) << megabytes / seconds << " MB/s)";
+	log( ss.str() );
 	
 	return true;
 }
@@ -12,8 +12,14 @@
 
 #include "daeMain.h"
 #include "converter.h"
+#include "cache.h"
+#include "sceneCompiler.h"
 #include "utPlatform.h"
 #include <algorithm>
+#include <set>
+#include <sstream>
+#include <atomic>
+#include <thread>
 
 #ifdef PLATFORM_WIN
 #   define WIN32_LEAN_AND_MEAN 1
@@ -34,18 +40,26 @@ using namespace Horde3D;
 using namespace ColladaConverter;
 
 
+static const char *converterVersion = "2.0.0";
+
+// Part of the conversion cache keys; increase it whenever the converter writes different files for
+// the same input, so that cached assets are converted again
+static const unsigned int outputVersion = 2;
+
+
 struct AssetTypes
 {
 	enum List
 	{
 		Unknown,
 		Model,
-		Animation
+		Animation,
+		SceneGraph
 	};
 };
 
 
-void createAssetList( const string &basePath, const string &assetPath, vector< string > &assetList )
+void createAssetList( const string &basePath, const string &assetPath, const string &ext, vector< string > &assetList )
 {
 	vector< string >  directories;
 	vector< string >  files;
@@ -101,7 +115,7 @@ void createAssetList( const string &basePath, const string &assetPath, vector< s
 	{
 		size_t len = files[i].length();
 
-		if( len > 4 && _stricmp( files[i].c_str() + (len-4), ".dae" ) == 0 )
+		if( len > ext.length() && _stricmp( files[i].c_str() + (len - ext.length()), ext.c_str() ) == 0 )
 		{
 			assetList.push_back( assetPath + files[i] );
 		}
@@ -110,7 +124,7 @@ void createAssetList( const string &basePath, const string &assetPath, vector< s
 	// Search in subdirectories
 	for( unsigned int i = 0; i < directories.size(); ++i )
 	{
-		createAssetList( basePath, assetPath + directories[i] + "/", assetList );
+		createAssetList( basePath, assetPath + directories[i] + "/", ext, assetList );
 	}
 }
 
@@ -121,23 +135,31 @@ void printHelp()
 	log( "ColladaConv input [optional arguments]" );
 	log( "" );
 	log( "input             asset file or directory to be processed" );
-	log( "-type model|anim  asset type to be processed (default: model)" );
+	log( "-type model|anim|scene  asset type to be processed (default: model); scene compiles" );
+	log( "                  .scene.xml files to the binary scene graph format" );
 	log( "-base path        base path where the repository root is located" );
 	log( "-dest path        existing destination path where output is written" );
 	log( "-noGeoOpt         disable geometry optimization" );
-	log( "-overwriteMats    force update of existing materials" );
+	log( "-optOverdraw      reorder triangles to reduce overdraw (slightly less cache efficient)" );
+	log( "-overwriteMats    force update of existing materials (converts up-to-date models again)" );
 	log( "-addModelName     adds model name before material name" );
 	log( "-lodDist1 dist    distance for LOD1" );
 	log( "-lodDist2 dist    distance for LOD2" );
 	log( "-lodDist3 dist    distance for LOD3" );
 	log( "-lodDist4 dist    distance for LOD4" );
+	log( "-autoLod ratios   generate up to 4 LODs with the given triangle ratios (e.g. 0.5,0.25,0.1)" );
 	log( "-useMaterialId    use material id instead of material name" );
+	log( "-geoVersion 5|6   version of written geometry files (default: 5; 6 is faster to load)" );
+	log( "-quantize         write packed vertex attributes (implies -geoVersion 6)" );
+	log( "-weldEps eps      tolerance for merging vertex normals and texture coordinates (default: 0)" );
+	log( "-jobs count       number of threads used for conversion (default: 1, 0: all cores)" );
+	log( "-force            convert all assets even if they are up to date" );
 }
 
 
 int main( int argc, char **argv )
 {
-	log( "Horde3D ColladaConv - 2.0.0" );
+	log( string( "Horde3D ColladaConv - " ) + converterVersion );
 	log( "" );
 	
 	if( argc < 2 )
@@ -153,9 +175,13 @@ int main( int argc, char **argv )
 	vector< string > assetList;
 	string input = argv[1], basePath = "./", outPath = "./";
 	AssetTypes::List assetType = AssetTypes::Model;
-	bool geoOpt = true, overwriteMats = false, addModelName = false, useMaterialId = false;
+	bool geoOpt = true, optOverdraw = false, overwriteMats = false, addModelName = false, useMaterialId = false;
+	bool force = false;
 	float lodDists[4] = { 10, 20, 40, 80 };
-	string modelName = "";	
+	float weldEpsilon = 0;
+	vector< float > autoLodRatios;
+	unsigned int geoVersion = 5;
+	bool quantize = false;
 
 	// Make sure that first argument ist not an option
 	if( argv[1][0] == '-' )
@@ -175,6 +201,7 @@ int main( int argc, char **argv )
 		{
 			if( _stricmp( argv[++i], "model" ) == 0 ) assetType = AssetTypes::Model;
 			else if( _stricmp( argv[i], "anim" ) == 0 ) assetType = AssetTypes::Animation;
+			else if( _stricmp( argv[i], "scene" ) == 0 ) assetType = AssetTypes::SceneGraph;
 			else assetType = AssetTypes::Unknown;
 		}
 		else if( _stricmp( arg.c_str(), "-base" ) == 0 && argc > i + 1 )
@@ -189,6 +216,10 @@ int main( int argc, char **argv )
 		{
 			geoOpt = false;
 		}
+		else if( _stricmp( arg.c_str(), "-optOverdraw" ) == 0 )
+		{
+			optOverdraw = true;
+		}
 		else if( _stricmp( arg.c_str(), "-overwriteMats" ) == 0 )
 		{
 			overwriteMats = true;
@@ -203,6 +234,17 @@ int main( int argc, char **argv )
 			
 			lodDists[index] = toFloat( argv[++i] );
 		}
+		else if( _stricmp( arg.c_str(), "-autoLod" ) == 0 && argc > i + 1 )
+		{
+			stringstream ss( argv[++i] );
+			string ratio;
+			autoLodRatios.clear();
+			while( getline( ss, ratio, ',' ) && autoLodRatios.size() < 4 )
+			{
+				float value = toFloat( ratio.c_str() );
+				if( value > 0 && value < 1 ) autoLodRatios.push_back( value );
+			}
+		}
 		else if( _stricmp( arg.c_str(), "-addModelName" ) == 0 )
 		{
 			addModelName = true;
@@ -211,6 +253,28 @@ int main( int argc, char **argv )
 		{
 			useMaterialId = true;
 		}
+		else if( _stricmp( arg.c_str(), "-jobs" ) == 0 && argc > i + 1 )
+		{
+			int jobs = atoi( argv[++i] );
+			if( jobs <= 0 ) jobs = (int)thread::hardware_concurrency();
+			setJobCount( (unsigned int)max( jobs, 1 ) );
+		}
+		else if( _stricmp( arg.c_str(), "-geoVersion" ) == 0 && argc > i + 1 )
+		{
+			geoVersion = atoi( argv[++i] ) == 6 ? 6 : 5;
+		}
+		else if( _stricmp( arg.c_str(), "-quantize" ) == 0 )
+		{
+			quantize = true;
+		}
+		else if( _stricmp( arg.c_str(), "-weldEps" ) == 0 && argc > i + 1 )
+		{
+			weldEpsilon = max( toFloat( argv[++i] ), 0.0f );
+		}
+		else if( _stricmp( arg.c_str(), "-force" ) == 0 )
+		{
+			force = true;
+		}
 		else
 		{
 			log( std::string( "Invalid arguments: '" ) + arg.c_str() + std::string( "'" ) );
@@ -220,7 +284,9 @@ int main( int argc, char **argv )
 	}
 
 	// Check whether input is single file or directory and create asset input list
-	if( input.length() > 4 && _stricmp( input.c_str() + (input.length() - 4), ".dae" ) == 0 )
+	string assetExt = assetType == AssetTypes::SceneGraph ? ".scene.xml" : ".dae";
+	if( input.length() > assetExt.length() &&
+	    _stricmp( input.c_str() + (input.length() - assetExt.length()), assetExt.c_str() ) == 0 )
 	{
 		// Check if it's an absolute path
 		if( input[0] == '/' || input[1] == ':' || input[0] == '\\' )
@@ -235,7 +301,7 @@ int main( int argc, char **argv )
 	{
 		if( input == "." ) input = "";
 		else input = cleanPath( input ) + "/";
-		createAssetList( basePath, input, assetList );
+		createAssetList( basePath, input, assetExt, assetList );
 	}
 
 	// =============================================================================================
@@ -253,30 +319,85 @@ int main( int argc, char **argv )
 			log( "Processing MODELS - Path: " + input );
 		else if( assetType == AssetTypes::Animation )
 			log( "Processing ANIMATIONS - Path: " + input );
+		else if( assetType == AssetTypes::SceneGraph )
+			log( "Processing SCENE GRAPHS - Path: " + input );
 		log( "" );
 	}
 	
-	string tmpStr;
-	tmpStr.reserve( 256 );
+	// Assets are skipped if source and options did not change since the last conversion
+	// into the same destination; the options that influence the output are part of the key
+	ConversionCache cache( outPath + ".colladaconv.cache" );
+	if( !force ) cache.load();
+
+	stringstream options;
+	options << "ColladaConv " << converterVersion << "|" << outputVersion << "|" << assetType << "|" << geoOpt << optOverdraw << addModelName << useMaterialId;
+	for( unsigned int i = 0; i < 4; ++i ) options << "|" << lodDists[i];
+	if( quantize ) geoVersion = 6;
+	options << "|" << weldEpsilon << "|" << geoVersion << quantize;
+	for( unsigned int i = 0; i < autoLodRatios.size(); ++i ) options << "|lod" << autoLodRatios[i];
+	uint64 optionsHash = hashString( options.str() );
+
+	// References to scene graphs that are compiled in the same run are redirected to the binary files,
+	// so the compiled scene graphs depend on the whole set
+	set< string > binaryScenes( assetList.begin(), assetList.end() );
+	if( assetType == AssetTypes::SceneGraph )
+	{
+		for( set< string >::const_iterator itr = binaryScenes.begin(); itr != binaryScenes.end(); ++itr )
+			optionsHash = hashString( *itr, optionsHash );
+	}
+	
+	// Assets are independent of each other and converted in parallel; the log output of each
+	// asset is grouped to keep it readable
+	atomic< bool > failed( false );
+	atomic< unsigned int > numUpToDate( 0 ), numConverted( 0 );
+
+	// Assets can share material files, so these are written in input order after the conversion
+	// to get the same result for any number of jobs
+	vector< vector< MaterialFile > > assetMaterials( assetList.size() );
 	
-	for( unsigned int i = 0; i < assetList.size(); ++i )
+	parallelFor( (unsigned int)assetList.size(), [&]( unsigned int i )
 	{
+		if( failed ) return;
+		
+		beginLogGroup();
+		
 		if( assetType == AssetTypes::Model || assetType == AssetTypes::Animation )
 		{
 			string sourcePath = basePath + assetList[i];
 			string assetName = extractFileName( assetList[i], false );
+			string modelName = "";
 
 			if( addModelName )	
 				modelName = assetName + "_";
 
 			string assetPath = cleanPath( extractFilePath( assetList[i] ) );
 			if( !assetPath.empty() ) assetPath += "/";
+
+			uint64 key = hashString( assetList[i], optionsHash );
+			bool keyValid = hashFile( sourcePath, key );
 			
+			// Materials are built from the source document, so they can only be replaced by converting
+			// the model again
+			bool rebuildMaterials = overwriteMats && assetType == AssetTypes::Model;
+			if( keyValid && !force && !rebuildMaterials && cache.isUpToDate( assetList[i], key ) )
+			{
+				++numUpToDate;
+				endLogGroup();
+				return;
+			}
+			
+			vector< string > outputs;
 			ColladaDocument *daeDoc = new ColladaDocument();
 			
 			log( "Parsing dae asset '" + assetList[i] + "'..." );
 			if( !daeDoc->parseFile( sourcePath ) )
-				return 1;
+			{
+				cache.remove( assetList[i] );
+				delete daeDoc;
+				failed = true;
+				endLogGroup();
+				return;
+			}
 
 			// By default, material's names are used to make `.material.xml` filenames.
 			// These names might contains filesystem's reserved characters that might cause unexpected 
@@ -285,21 +406,28 @@ int main( int argc, char **argv )
 			// as `id` are less prone to contain reserved characters.
 			if( useMaterialId )
 			{
-				for( unsigned int i = 0; i < daeDoc->libMaterials.materials.size(); ++i )
+				for( unsigned int j = 0; j < daeDoc->libMaterials.materials.size(); ++j )
 				{
-					daeDoc->libMaterials.materials[i]->name = daeDoc->libMaterials.materials[i]->id;
+					daeDoc->libMaterials.materials[j]->name = daeDoc->libMaterials.materials[j]->id;
 				}
 			}
 			
 			if( assetType == AssetTypes::Model )
 			{
 				log( "Compiling model data..." );
-				Converter *converter = new Converter( *daeDoc, outPath, lodDists );
-				converter->convertModel( geoOpt );
+				Converter *converter = new Converter( *daeDoc, outPath, lodDists, weldEpsilon, autoLodRatios );
+				converter->convertModel( geoOpt, optOverdraw );
 				
 				createDirectories( outPath, assetPath );
-				converter->writeModel( assetPath, assetName, modelName );
-				converter->writeMaterials( assetPath, modelName, overwriteMats );
+				if( converter->writeModel( assetPath, assetName, modelName, geoVersion, quantize ) )
+				{
+					outputs.push_back( outPath + assetPath + assetName + ".geo" );
+					outputs.push_back( outPath + assetPath + assetName + ".scene.xml" );
+				}
+				else keyValid = false;
+				converter->buildMaterials( assetPath, modelName, assetMaterials[i] );
+				for( size_t j = 0; j < assetMaterials[i].size(); ++j )
+					outputs.push_back( outPath + assetMaterials[i][j].fileName );
 
 				delete converter; converter = 0x0;
 			}
@@ -307,12 +435,14 @@ int main( int argc, char **argv )
 			{	
 				log( "Compiling animation data..." );
 				Converter *converter = new Converter( *daeDoc, outPath, lodDists );
-				converter->convertModel( false );
+				converter->convertModel( false, false );
 				
 				if( converter->hasAnimation() )
 				{
 					createDirectories( outPath, assetPath );
-					converter->writeAnimation( assetPath, assetName );
+					if( converter->writeAnimation( assetPath, assetName ) )
+						outputs.push_back( outPath + assetPath + assetName + ".anim" );
+					else keyValid = false;
 				}
 				else
 				{
@@ -323,10 +453,59 @@ int main( int argc, char **argv )
 			}
 			
 			delete daeDoc; daeDoc = 0x0;
+
+			if( keyValid ) cache.update( assetList[i], key, outputs );
+			else cache.remove( assetList[i] );
+			++numConverted;
+		}
+		else if( assetType == AssetTypes::SceneGraph )
+		{
+			string assetPath = cleanPath( extractFilePath( assetList[i] ) );
+			if( !assetPath.empty() ) assetPath += "/";
+			string destName = getBinarySceneName( assetList[i] );
+
+			uint64 key = hashString( assetList[i], optionsHash );
+			bool keyValid = hashFile( basePath + assetList[i], key );
+			
+			if( keyValid && !force && cache.isUpToDate( assetList[i], key ) )
+			{
+				++numUpToDate;
+				endLogGroup();
+				return;
+			}
+
+			log( "Compiling scene graph '" + assetList[i] + "'..." );
+			createDirectories( outPath, assetPath );
+			if( compileSceneGraph( basePath + assetList[i], outPath + destName, binaryScenes ) )
+			{
+				vector< string > outputs( 1, outPath + destName );
+				if( keyValid ) cache.update( assetList[i], key, outputs );
+				else cache.remove( assetList[i] );
+				++numConverted;
+			}
+			else
+			{
+				cache.remove( assetList[i] );
+				failed = true;
+			}
 		}
 
 		log( "" );
-	}
+		endLogGroup();
+	} );
+
+	vector< MaterialFile > materials;
+	for( size_t i = 0; i < assetMaterials.size(); ++i )
+		materials.insert( materials.end(), assetMaterials[i].begin(), assetMaterials[i].end() );
+	writeMaterialFiles( outPath, materials, overwriteMats );
+
+	cache.save();
+	
+	stringstream summary;
+	summary << "Converted " << numConverted << " assets, skipped " << numUpToDate << " up-to-date assets";
+	log( summary.str() );
 	
+	if( failed ) return 1;
+
 	return 0;
 }
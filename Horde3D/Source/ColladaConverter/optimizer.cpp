@@ -13,31 +13,65 @@
 #include "optimizer.h"
 #include "converter.h"
 #include "utPlatform.h"
-#include <list>
 #include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace std;
 namespace Horde3D {
 namespace ColladaConverter {
 
 
-void OptVertex::updateScore( int cacheIndex )
+// The constants used here are coming from the paper
+static const unsigned int valenceTableSize = 32;
+static const unsigned int numScoreBuckets = 256;
+static const float maxTriScore = 3 * (0.75f + 2.0f);
+static const unsigned int invalidIndex = 0xffffffff;
+
+
+struct VertexScoreTables
 {
-	if( faces.empty() )
-	{	
-		score = 0;
-		return;
+	float  cacheScores[MeshOptimizer::maxCacheSize];
+	float  valenceScores[valenceTableSize];
+
+	VertexScoreTables()
+	{
+		for( int i = 0; i < MeshOptimizer::maxCacheSize; ++i )
+		{
+			if( i < 3 ) cacheScores[i] = 0.75f;  // Among three most recent vertices
+			else cacheScores[i] = powf( 1.0f - (float)(i - 3) / (MeshOptimizer::maxCacheSize - 3), 1.5f );
+		}
+		
+		valenceScores[0] = 0;
+		for( unsigned int i = 1; i < valenceTableSize; ++i )
+			valenceScores[i] = 2.0f * powf( (float)i, -0.5f );
 	}
+};
+
+static const VertexScoreTables scoreTables;
+
+
+static inline float calcVertexScore( int cachePos, unsigned int numLiveTris )
+{
+	// Vertices without remaining triangles are of no interest anymore
+	if( numLiveTris == 0 ) return 0;
 	
-	// The constants used here are coming from the paper
-	if( cacheIndex < 0 ) score = 0;				// Not in cache
-	else if( cacheIndex < 3 ) score = 0.75f;	// Among three most recent vertices
-	else score = pow( 1.0f - ((cacheIndex - 3) / MeshOptimizer::maxCacheSize), 1.5f );
+	float score = cachePos >= 0 ? scoreTables.cacheScores[cachePos] : 0;
+	
+	if( numLiveTris < valenceTableSize ) score += scoreTables.valenceScores[numLiveTris];
+	else score += 2.0f * powf( (float)numLiveTris, -0.5f );
 
-	score += 2.0f * pow( (float)faces.size(), -0.5f );
+	return score;
 }
 
 
+static inline unsigned int getScoreBucket( float score )
+{
+	unsigned int bucket = (unsigned int)(score * ((numScoreBuckets - 1) / maxTriScore));
+	return bucket < numScoreBuckets ? bucket : numScoreBuckets - 1;
+}
+
 
 unsigned int MeshOptimizer::removeDegeneratedTriangles( TriGroup *triGroup, vector< Vertex > &vertices,
                                                         vector< unsigned int > &indices )
@@ -66,138 +100,707 @@ unsigned int MeshOptimizer::removeDegeneratedTriangles( TriGroup *triGroup, vect
 }
 
 
-void MeshOptimizer::optimizeIndexOrder( TriGroup *triGroup, vector< Vertex > &vertices,
-                                        vector< unsigned int > &indices,
-                                        map< unsigned int, unsigned int > &vertMap )
+void MeshOptimizer::optimizeIndexOrder( TriGroup *triGroup, vector< unsigned int > &indices )
 {
 	// Implementation of Linear-Speed Vertex Cache Optimisation by Tom Forsyth
 	// (see http://home.comcast.net/~tom_forsyth/papers/fast_vert_cache_opt.html)
+	// Adjacency is stored in flat arrays and triangles are kept in buckets sorted by score,
+	// so that finding a new start triangle when the cache runs dry does not require a full search
 	
 	if( triGroup->count == 0 ) return;
+
+	const unsigned int numVerts = triGroup->vertREnd - triGroup->vertRStart + 1;
+	const unsigned int numTris = triGroup->count / 3;
+	unsigned int *groupIndices = &indices[triGroup->first];
+
+	vector< unsigned int > tris( triGroup->count );
+	for( unsigned int i = 0; i < triGroup->count; ++i )
+		tris[i] = groupIndices[i] - triGroup->vertRStart;
+
+	// Build vertex to triangle adjacency
+	vector< unsigned int > numLiveTris( numVerts, 0 );
+	vector< unsigned int > adjOffsets( numVerts + 1, 0 );
+	vector< unsigned int > adjTris( triGroup->count );
 	
-	vector< OptVertex > verts( triGroup->vertREnd - triGroup->vertRStart + 1 );
-	set< OptFace * > faces;
-	list< OptVertex * > cache;
+	for( unsigned int i = 0; i < triGroup->count; ++i ) ++numLiveTris[tris[i]];
+	for( unsigned int i = 0; i < numVerts; ++i ) adjOffsets[i + 1] = adjOffsets[i] + numLiveTris[i];
 	
-	// Build vertex and triangle structures
-	for( unsigned int i = 0; i < triGroup->count; i += 3 )
-	{
-		set< OptFace * >::iterator itr1 = faces.insert( faces.begin(), new OptFace() );
-		OptFace *face = (*itr1);
-		
-		face->verts[0] = &verts[indices[triGroup->first + i] - triGroup->vertRStart];
-		face->verts[1] = &verts[indices[triGroup->first + i + 1] - triGroup->vertRStart];
-		face->verts[2] = &verts[indices[triGroup->first + i + 2] - triGroup->vertRStart];
-		face->verts[0]->faces.insert( face );
-		face->verts[1]->faces.insert( face );
-		face->verts[2]->faces.insert( face );
-	}
-	for( unsigned int i = 0; i < verts.size(); ++i )
+	vector< unsigned int > adjFill( adjOffsets.begin(), adjOffsets.end() - 1 );
+	for( unsigned int i = 0; i < triGroup->count; ++i ) adjTris[adjFill[tris[i]]++] = i / 3;
+
+	// Calculate initial scores
+	vector< int > cachePos( numVerts, -1 );
+	vector< float > vertScores( numVerts );
+	for( unsigned int i = 0; i < numVerts; ++i ) vertScores[i] = calcVertexScore( -1, numLiveTris[i] );
+
+	vector< float > triScores( numTris );
+	vector< unsigned int > triBuckets( numTris );
+	vector< bool > triEmitted( numTris, false );
+	vector< vector< unsigned int > > buckets( numScoreBuckets );
+	int topBucket = -1;
+	
+	for( unsigned int i = 0; i < numTris; ++i )
 	{
-		verts[i].index = triGroup->vertRStart + i;
-		verts[i].updateScore( -1 );
+		triScores[i] = vertScores[tris[i * 3]] + vertScores[tris[i * 3 + 1]] + vertScores[tris[i * 3 + 2]];
+		triBuckets[i] = getScoreBucket( triScores[i] );
+		buckets[triBuckets[i]].push_back( i );
+		topBucket = max( topBucket, (int)triBuckets[i] );
 	}
 
 	// Main loop of algorithm
-	unsigned int curIndex = triGroup->first;
+	unsigned int cache[maxCacheSize + 3], newCache[maxCacheSize + 3];
+	unsigned int cacheSize = 0;
+	int bestTri = -1;
 	
-	while( !faces.empty() )
+	for( unsigned int curTri = 0; curTri < numTris; ++curTri )
 	{
-		OptFace *bestFace = 0x0;
-		float bestScore = -1.0f;
-		
-		// Try to find best scoring face in cache
-		list< OptVertex * >::iterator itr1 = cache.begin();
-		while( itr1 != cache.end() )
+		// If no triangle was found in cache, take the best one of the highest bucket; buckets
+		// may contain stale entries of emitted triangles or triangles whose score has changed
+		while( bestTri < 0 && topBucket >= 0 )
 		{
-			set< OptFace * >::iterator itr2 = (*itr1)->faces.begin();
-			while( itr2 != (*itr1)->faces.end() )
+			vector< unsigned int > &bucket = buckets[topBucket];
+			
+			while( !bucket.empty() )
 			{
-				if( (*itr2)->getScore() > bestScore )
+				unsigned int tri = bucket.back();
+				bucket.pop_back();
+				
+				if( !triEmitted[tri] && triBuckets[tri] == (unsigned int)topBucket )
 				{
-					bestFace = *itr2;
-					bestScore = bestFace->getScore();
+					bestTri = (int)tri;
+					break;
 				}
-				++itr2;
 			}
-			++itr1;
+			if( bestTri < 0 ) --topBucket;
 		}
+		ASSERT( bestTri >= 0 );
 
-		// If that didn't work find it in the complete list of triangles
-		if( bestFace == 0x0 )
+		// Emit triangle and remove it from the adjacency of its vertices
+		const unsigned int *triVerts = &tris[bestTri * 3];
+		triEmitted[bestTri] = true;
+		
+		for( unsigned int i = 0; i < 3; ++i )
 		{
-			set< OptFace * >::iterator itr2 = faces.begin();
-			while( itr2 != faces.end() )
+			unsigned int vert = triVerts[i];
+			groupIndices[curTri * 3 + i] = vert + triGroup->vertRStart;
+
+			unsigned int *adj = &adjTris[adjOffsets[vert]];
+			for( unsigned int j = 0; j < numLiveTris[vert]; ++j )
 			{
-				if( (*itr2)->getScore() > bestScore )
+				if( adj[j] == (unsigned int)bestTri )
 				{
-					bestFace = (*itr2);
-					bestScore = bestFace->getScore();
+					adj[j] = adj[numLiveTris[vert] - 1];
+					--numLiveTris[vert];
+					break;
 				}
-				++itr2;
 			}
 		}
-		ASSERT( bestFace != 0x0 );
-		
-		// Process vertices of best face
+
+		// Move vertices of triangle to head of cache
+		unsigned int newCacheSize = 0;
 		for( unsigned int i = 0; i < 3; ++i )
 		{
-			// Add vertex to draw list
-			indices[curIndex++] = bestFace->verts[i]->index;
+			if( i > 0 && triVerts[i] == triVerts[0] ) continue;
+			if( i > 1 && triVerts[i] == triVerts[1] ) continue;
+			newCache[newCacheSize++] = triVerts[i];
+		}
+		for( unsigned int i = 0; i < cacheSize; ++i )
+		{
+			unsigned int vert = cache[i];
+			if( vert != triVerts[0] && vert != triVerts[1] && vert != triVerts[2] )
+				newCache[newCacheSize++] = vert;
+		}
+
+		// Update scores of vertices in cache, including the ones that were just pushed out
+		for( unsigned int i = 0; i < newCacheSize; ++i )
+		{
+			unsigned int vert = newCache[i];
+			cachePos[vert] = i < (unsigned int)maxCacheSize ? (int)i : -1;
+			vertScores[vert] = calcVertexScore( cachePos[vert], numLiveTris[vert] );
+		}
+
+		// Update scores of affected triangles and find best triangle in cache
+		float bestScore = -1.0f;
+		bestTri = -1;
+		
+		for( unsigned int i = 0; i < newCacheSize; ++i )
+		{
+			unsigned int vert = newCache[i];
+			const unsigned int *adj = &adjTris[adjOffsets[vert]];
+			
+			for( unsigned int j = 0; j < numLiveTris[vert]; ++j )
+			{
+				unsigned int tri = adj[j];
+				float score = vertScores[tris[tri * 3]] + vertScores[tris[tri * 3 + 1]] +
+				              vertScores[tris[tri * 3 + 2]];
+				
+				if( score != triScores[tri] )
+				{
+					triScores[tri] = score;
+					unsigned int bucket = getScoreBucket( score );
+					if( bucket != triBuckets[tri] )
+					{
+						triBuckets[tri] = bucket;
+						buckets[bucket].push_back( tri );
+						topBucket = max( topBucket, (int)bucket );
+					}
+				}
+
+				if( cachePos[vert] >= 0 && score > bestScore )
+				{
+					bestTri = (int)tri;
+					bestScore = score;
+				}
+			}
+		}
+
+		// Trim cache
+		cacheSize = min( newCacheSize, (unsigned int)maxCacheSize );
+		for( unsigned int i = 0; i < cacheSize; ++i ) cache[i] = newCache[i];
+	}
+}
 
-			// Move vertex to head of cache
-			itr1 = find( cache.begin(), cache.end(), bestFace->verts[i] );
-			if( itr1 != cache.end() ) cache.erase( itr1 );
-			cache.push_front( bestFace->verts[i] );
 
-			// Remove face from vertex lists
-			bestFace->verts[i]->faces.erase( bestFace );
+static unsigned int simulateCache( const unsigned int *triVerts, vector< unsigned int > &cacheStamps,
+                                   unsigned int &cacheTime )
+{
+	// FIFO cache simulation with timestamps, a vertex is in the cache if it was inserted
+	// less than maxCacheSize misses ago
+	unsigned int misses = 0;
+	
+	for( unsigned int i = 0; i < 3; ++i )
+	{
+		if( cacheTime - cacheStamps[triVerts[i]] > (unsigned int)MeshOptimizer::maxCacheSize )
+		{
+			cacheStamps[triVerts[i]] = cacheTime++;
+			++misses;
 		}
+	}
+
+	return misses;
+}
+
 
-		// Remove best face
-		faces.erase( faces.find( bestFace ) );
-		delete bestFace;
+void MeshOptimizer::optimizeOverdraw( TriGroup *triGroup, const vector< Vertex > &vertices,
+                                      vector< unsigned int > &indices, float threshold )
+{
+	// Implementation of the clustering and sorting approach of Fast Triangle Reordering for Vertex
+	// Locality and Reduced Overdraw by Sander, Nehab and Barczak; expects a cache optimized index list
+	
+	if( triGroup->count == 0 ) return;
 
-		// Update scores of vertices in cache
-		unsigned int cacheIndex = 0;
-		for( itr1 = cache.begin(); itr1 != cache.end(); ++itr1 )
+	const unsigned int numVerts = triGroup->vertREnd - triGroup->vertRStart + 1;
+	const unsigned int numTris = triGroup->count / 3;
+	unsigned int *groupIndices = &indices[triGroup->first];
+
+	vector< unsigned int > tris( triGroup->count );
+	for( unsigned int i = 0; i < triGroup->count; ++i )
+		tris[i] = groupIndices[i] - triGroup->vertRStart;
+
+	vector< unsigned int > cacheStamps( numVerts, 0 );
+	unsigned int cacheTime = maxCacheSize + 1;
+
+	// Hard boundaries are at triangles where the cache got flushed by the optimizer
+	vector< unsigned int > hardClusters;
+	for( unsigned int i = 0; i < numTris; ++i )
+	{
+		if( simulateCache( &tris[i * 3], cacheStamps, cacheTime ) == 3 || i == 0 )
+			hardClusters.push_back( i );
+	}
+	hardClusters.push_back( numTris );
+
+	// Soft boundaries split hard clusters where the local ATVR is still close to the one of the
+	// whole cluster, so that splitting costs at most the given threshold
+	vector< unsigned int > clusters;
+	for( size_t c = 0; c + 1 < hardClusters.size(); ++c )
+	{
+		unsigned int start = hardClusters[c], end = hardClusters[c + 1];
+		
+		cacheTime += maxCacheSize + 1;
+		unsigned int clusterMisses = 0;
+		for( unsigned int i = start; i < end; ++i )
+			clusterMisses += simulateCache( &tris[i * 3], cacheStamps, cacheTime );
+
+		float clusterThreshold = threshold * (float)clusterMisses / (end - start);
+		
+		cacheTime += maxCacheSize + 1;
+		unsigned int misses = 0, softStart = start;
+		clusters.push_back( start );
+		
+		for( unsigned int i = start; i < end; ++i )
 		{
-			(*itr1)->updateScore( cacheIndex++ );
+			misses += simulateCache( &tris[i * 3], cacheStamps, cacheTime );
+			
+			if( i + 1 < end && (float)misses / (i + 1 - softStart) <= clusterThreshold )
+			{
+				softStart = i + 1;
+				clusters.push_back( softStart );
+				cacheTime += maxCacheSize + 1;
+				misses = 0;
+			}
 		}
+	}
+	clusters.push_back( numTris );
 
-		// Trim cache
-		for( int i = (int)cache.size(); i > maxCacheSize; --i )
+	// Calculate area weighted centroids and normals of mesh and clusters
+	const size_t numClusters = clusters.size() - 1;
+	vector< Vec3f > clusterCentroids( numClusters ), clusterNormals( numClusters );
+	Vec3f meshCentroid;
+	float meshArea = 0;
+	
+	for( size_t c = 0; c < numClusters; ++c )
+	{
+		float clusterArea = 0;
+		
+		for( unsigned int i = clusters[c]; i < clusters[c + 1]; ++i )
 		{
-			cache.pop_back();
+			const Vec3f &p0 = vertices[groupIndices[i * 3]].pos;
+			const Vec3f &p1 = vertices[groupIndices[i * 3 + 1]].pos;
+			const Vec3f &p2 = vertices[groupIndices[i * 3 + 2]].pos;
+
+			Vec3f normal = (p1 - p0).cross( p2 - p0 );
+			float area = normal.length();
+			
+			clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+			clusterNormals[c] += normal;
+			clusterArea += area;
 		}
+
+		meshCentroid += clusterCentroids[c];
+		meshArea += clusterArea;
+		
+		if( clusterArea > 0 ) clusterCentroids[c] = clusterCentroids[c] * (1.0f / clusterArea);
+		float normalLen = clusterNormals[c].length();
+		if( normalLen > 0 ) clusterNormals[c] = clusterNormals[c] * (1.0f / normalLen);
+	}
+	if( meshArea > 0 ) meshCentroid = meshCentroid * (1.0f / meshArea);
+
+	// Sort clusters so that the ones facing away from the mesh center are drawn first
+	vector< pair< float, unsigned int > > sortKeys( numClusters );
+	for( size_t c = 0; c < numClusters; ++c )
+	{
+		sortKeys[c].first = -(clusterCentroids[c] - meshCentroid).dot( clusterNormals[c] );
+		sortKeys[c].second = (unsigned int)c;
+	}
+	stable_sort( sortKeys.begin(), sortKeys.end() );
+
+	unsigned int curIndex = 0;
+	for( size_t c = 0; c < numClusters; ++c )
+	{
+		unsigned int cluster = sortKeys[c].second;
+		for( unsigned int i = clusters[cluster] * 3; i < clusters[cluster + 1] * 3; ++i )
+			groupIndices[curIndex++] = tris[i] + triGroup->vertRStart;
 	}
+}
 
 
+void MeshOptimizer::optimizeVertexFetch( TriGroup *triGroup, vector< Vertex > &vertices,
+                                         vector< unsigned int > &indices, vector< unsigned int > &vertMap )
+{
 	// Remap vertices to make access to them as linear as possible
+	
+	const unsigned int numVerts = triGroup->vertREnd - triGroup->vertRStart + 1;
 	vector< Vertex > oldVertices( vertices.begin() + triGroup->vertRStart,
 	                              vertices.begin() + triGroup->vertREnd + 1 );
-	vertMap.clear();
-	unsigned int curVertex = triGroup->vertRStart;
+	vertMap.assign( numVerts, invalidIndex );
+	unsigned int curVertex = 0;
 	
 	for( unsigned int i = triGroup->first; i < triGroup->first + triGroup->count; ++i )
 	{
-		map< unsigned int, unsigned int >::iterator itr1 = vertMap.find( indices[i] );
+		unsigned int &newIndex = vertMap[indices[i] - triGroup->vertRStart];
+		if( newIndex == invalidIndex ) newIndex = curVertex++;
 		
-		if( itr1 == vertMap.end() )
+		indices[i] = triGroup->vertRStart + newIndex;
+	}
+
+	for( unsigned int i = 0; i < numVerts; ++i )
+	{
+		if( vertMap[i] != invalidIndex )
+			vertices[triGroup->vertRStart + vertMap[i]] = oldVertices[i];
+	}
+}
+
+
+struct Quadric
+{
+	// Symmetric 4x4 matrix of the sum of squared distances to planes, and the sum of plane weights
+	double  a2, b2, c2, d2, ab, ac, ad, bc, bd, cd;
+	double  weight;
+
+	Quadric() : a2( 0 ), b2( 0 ), c2( 0 ), d2( 0 ), ab( 0 ), ac( 0 ), ad( 0 ), bc( 0 ), bd( 0 ), cd( 0 ), weight( 0 )
+	{
+	}
+
+	void addPlane( const Vec3f &n, float d, float w )
+	{
+		a2 += w * n.x * n.x; b2 += w * n.y * n.y; c2 += w * n.z * n.z; d2 += w * d * d;
+		ab += w * n.x * n.y; ac += w * n.x * n.z; ad += w * n.x * d;
+		bc += w * n.y * n.z; bd += w * n.y * d; cd += w * n.z * d;
+		weight += w;
+	}
+
+	void add( const Quadric &q )
+	{
+		a2 += q.a2; b2 += q.b2; c2 += q.c2; d2 += q.d2;
+		ab += q.ab; ac += q.ac; ad += q.ad; bc += q.bc; bd += q.bd; cd += q.cd;
+		weight += q.weight;
+	}
+
+	double eval( const Vec3f &p ) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double e = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+		           2 * (ab * x * y + ac * x * z + ad * x + bc * y * z + bd * y + cd * z);
+		return weight > 0 ? fabs( e ) / weight : 0;
+	}
+};
+
+
+struct VertexKinds
+{
+	enum List
+	{
+		Free,    // Interior position with a single set of attributes
+		Border,  // Position on an open border that may only move along the border
+		Seam,    // Position with two sets of attributes that may only move along the seam between them
+		Locked   // Corner or non-manifold position
+	};
+};
+
+
+static inline uint64 makeEdgeKey( unsigned int a, unsigned int b )
+{
+	return ((uint64)a << 32) | b;
+}
+
+
+float MeshOptimizer::simplify( const TriGroup *triGroup, const vector< Vertex > &vertices,
+                               const vector< unsigned int > &indices, unsigned int targetCount,
+                               vector< unsigned int > &result )
+{
+	// Edge collapse simplification driven by quadric error metrics (Garland and Heckbert); positions
+	// are only collapsed onto other existing positions, so that texture coordinates, normals and skin
+	// weights of the remaining vertices stay valid. Positions on a seam between two attribute sets
+	// move along the seam together with both their vertices, border positions only move along the border
+	
+	const unsigned int numVerts = triGroup->vertREnd - triGroup->vertRStart + 1;
+	const Vertex *verts = &vertices[triGroup->vertRStart];
+
+	vector< unsigned int > curIndices( triGroup->count );
+	for( unsigned int i = 0; i < triGroup->count; ++i )
+		curIndices[i] = indices[triGroup->first + i] - triGroup->vertRStart;
+
+	// Find vertices that share a position
+	vector< unsigned int > sortedVerts( numVerts ), posIds( numVerts );
+	unsigned int numPositions = 0;
+	for( unsigned int i = 0; i < numVerts; ++i ) sortedVerts[i] = i;
+	sort( sortedVerts.begin(), sortedVerts.end(), [verts]( unsigned int a, unsigned int b )
+	{
+		const Vec3f &pa = verts[a].pos, &pb = verts[b].pos;
+		return pa.x < pb.x || (pa.x == pb.x && (pa.y < pb.y || (pa.y == pb.y && pa.z < pb.z)));
+	} );
+	for( unsigned int i = 0; i < numVerts; ++i )
+	{
+		const Vec3f *prev = i > 0 ? &verts[sortedVerts[i - 1]].pos : 0x0, &cur = verts[sortedVerts[i]].pos;
+		if( prev == 0x0 || prev->x != cur.x || prev->y != cur.y || prev->z != cur.z ) ++numPositions;
+		posIds[sortedVerts[i]] = numPositions - 1;
+	}
+
+	// Accumulate area weighted triangle plane quadrics per position
+	vector< Quadric > quadrics( numPositions );
+	for( size_t i = 0; i < curIndices.size(); i += 3 )
+	{
+		const Vec3f &p0 = verts[curIndices[i]].pos;
+		Vec3f normal = (verts[curIndices[i + 1]].pos - p0).cross( verts[curIndices[i + 2]].pos - p0 );
+		float area = normal.length();
+		if( area <= 0 ) continue;
+		
+		normal = normal * (1.0f / area);
+		Quadric q;
+		q.addPlane( normal, -normal.dot( p0 ), area );
+		for( unsigned int k = 0; k < 3; ++k ) quadrics[posIds[curIndices[i + k]]].add( q );
+	}
+
+	vector< unsigned char > kinds( numPositions );
+	vector< unsigned int > remap( numVerts ), adjOffsets( numPositions + 1 ), adjTris;
+	vector< unsigned int > bestSources( numPositions ), bestTargets( numPositions );
+	vector< double > bestErrors( numPositions );
+	vector< bool > touched( numPositions ), usedVerts( numVerts );
+	vector< unsigned int > candidates;
+	unordered_map< uint64, unsigned int > edgeCounts;
+	unordered_map< uint64, uint64 > edgeVerts;  // Vertices of each edge between positions
+	unordered_set< uint64 > vertEdges;
+	bool borderQuadricsAdded = false;
+	double maxError = 0;
+	
+	while( curIndices.size() > targetCount )
+	{
+		// Classify positions by the topology of the position graph; an edge is on a seam if the
+		// position graph has the opposite edge but the vertex graph does not
+		edgeCounts.clear();
+		edgeVerts.clear();
+		vertEdges.clear();
+		for( size_t i = 0; i < curIndices.size(); i += 3 )
+		{
+			for( unsigned int k = 0; k < 3; ++k )
+			{
+				unsigned int va = curIndices[i + k], vb = curIndices[i + (k + 1) % 3];
+				uint64 key = makeEdgeKey( posIds[va], posIds[vb] );
+				++edgeCounts[key];
+				edgeVerts[key] = makeEdgeKey( va, vb );
+				vertEdges.insert( makeEdgeKey( va, vb ) );
+			}
+		}
+
+		vector< unsigned int > numBorderEdges( numPositions, 0 ), numSeamEdges( numPositions, 0 ), numWedges( numPositions, 0 );
+		vector< bool > nonManifold( numPositions, false );
+		fill( usedVerts.begin(), usedVerts.end(), false );
+		for( size_t i = 0; i < curIndices.size(); i += 3 )
 		{
-			vertMap[indices[i]] = curVertex;
-			indices[i] = curVertex++;
+			for( unsigned int k = 0; k < 3; ++k )
+			{
+				unsigned int va = curIndices[i + k], vb = curIndices[i + (k + 1) % 3];
+				unsigned int a = posIds[va], b = posIds[vb];
+				if( !usedVerts[va] )
+				{
+					usedVerts[va] = true;
+					++numWedges[a];
+				}
+				if( edgeCounts[makeEdgeKey( a, b )] > 1 ) nonManifold[a] = nonManifold[b] = true;
+				
+				if( edgeCounts.find( makeEdgeKey( b, a ) ) == edgeCounts.end() )
+				{
+					++numBorderEdges[a];
+					++numBorderEdges[b];
+
+					// Planes perpendicular to the border keep its shape; they are only added once
+					// for the initial border
+					if( !borderQuadricsAdded )
+					{
+						const Vec3f &p0 = verts[curIndices[i]].pos;
+						Vec3f normal = (verts[curIndices[i + 1]].pos - p0).cross( verts[curIndices[i + 2]].pos - p0 );
+						const Vec3f &pa = verts[va].pos;
+						Vec3f edge = verts[vb].pos - pa;
+						Vec3f borderNormal = edge.cross( normal );
+						float len = borderNormal.length();
+						if( len > 0 )
+						{
+							borderNormal = borderNormal * (1.0f / len);
+							Quadric q;
+							q.addPlane( borderNormal, -borderNormal.dot( pa ), edge.dot( edge ) * 10.0f );
+							quadrics[a].add( q );
+							quadrics[b].add( q );
+						}
+					}
+				}
+				else if( vertEdges.find( makeEdgeKey( vb, va ) ) == vertEdges.end() )
+				{
+					// Counted once from each side of the seam
+					++numSeamEdges[a];
+					++numSeamEdges[b];
+				}
+			}
 		}
-		else
+		borderQuadricsAdded = true;
+		
+		for( unsigned int i = 0; i < numPositions; ++i )
 		{
-			indices[i] = itr1->second;
+			if( nonManifold[i] || numBorderEdges[i] > 2 ) kinds[i] = VertexKinds::Locked;
+			else if( numBorderEdges[i] > 0 )
+				kinds[i] = numWedges[i] == 1 && numSeamEdges[i] == 0 ? VertexKinds::Border : VertexKinds::Locked;
+			else if( numSeamEdges[i] > 0 )
+				kinds[i] = numWedges[i] == 2 && numSeamEdges[i] == 4 ? VertexKinds::Seam : VertexKinds::Locked;
+			else kinds[i] = numWedges[i] > 1 ? VertexKinds::Locked : VertexKinds::Free;
 		}
+
+		// Find cheapest collapse for every position
+		fill( bestErrors.begin(), bestErrors.end(), -1.0 );
+		for( size_t i = 0; i < curIndices.size(); i += 3 )
+		{
+			// Consider both directions of each edge
+			for( unsigned int k = 0; k < 6; ++k )
+			{
+				unsigned int e0 = k % 3, e1 = (e0 + 1) % 3;
+				unsigned int v0 = curIndices[i + (k < 3 ? e0 : e1)], v1 = curIndices[i + (k < 3 ? e1 : e0)];
+				unsigned int p0 = posIds[v0], p1 = posIds[v1];
+				
+				if( kinds[p0] == VertexKinds::Locked || nonManifold[p1] ) continue;
+				if( kinds[p0] == VertexKinds::Border )
+				{
+					if( kinds[p1] != VertexKinds::Border && kinds[p1] != VertexKinds::Locked ) continue;
+					if( edgeCounts.find( makeEdgeKey( p1, p0 ) ) != edgeCounts.end() &&
+					    edgeCounts.find( makeEdgeKey( p0, p1 ) ) != edgeCounts.end() ) continue;
+				}
+				if( kinds[p0] == VertexKinds::Seam )
+				{
+					// Both vertices follow the seam to the vertices of the target on their side
+					if( kinds[p1] != VertexKinds::Seam && kinds[p1] != VertexKinds::Locked ) continue;
+					if( vertEdges.find( makeEdgeKey( v1, v0 ) ) != vertEdges.end() ||
+					    vertEdges.find( makeEdgeKey( v0, v1 ) ) == vertEdges.end() ||
+					    edgeVerts.find( makeEdgeKey( p1, p0 ) ) == edgeVerts.end() ) continue;
+				}
+
+				Quadric q = quadrics[p0];
+				q.add( quadrics[p1] );
+				double error = q.eval( verts[v1].pos );
+				
+				if( bestErrors[p0] < 0 || error < bestErrors[p0] )
+				{
+					bestErrors[p0] = error;
+					bestSources[p0] = v0;
+					bestTargets[p0] = v1;
+				}
+			}
+		}
+		
+		candidates.clear();
+		for( unsigned int i = 0; i < numPositions; ++i )
+		{
+			if( bestErrors[i] >= 0 ) candidates.push_back( i );
+		}
+		sort( candidates.begin(), candidates.end(), [&bestErrors]( unsigned int a, unsigned int b )
+		{
+			return bestErrors[a] < bestErrors[b];
+		} );
+
+		// Build position to triangle adjacency for the flip test
+		fill( adjOffsets.begin(), adjOffsets.end(), 0 );
+		for( size_t i = 0; i < curIndices.size(); ++i ) ++adjOffsets[posIds[curIndices[i]] + 1];
+		for( unsigned int i = 0; i < numPositions; ++i ) adjOffsets[i + 1] += adjOffsets[i];
+		adjTris.resize( curIndices.size() );
+		vector< unsigned int > adjFill( adjOffsets.begin(), adjOffsets.end() - 1 );
+		for( size_t i = 0; i < curIndices.size(); ++i ) adjTris[adjFill[posIds[curIndices[i]]]++] = (unsigned int)(i / 3);
+
+		// Collapse edges with the lowest error first; every position is only involved in one
+		// collapse per pass to keep the flip test valid
+		for( unsigned int i = 0; i < numVerts; ++i ) remap[i] = i;
+		fill( touched.begin(), touched.end(), false );
+		size_t numTris = curIndices.size() / 3, targetTris = targetCount / 3;
+		size_t maxCollapses = (numTris - targetTris) / 2 + 1, numCollapses = 0;
+		
+		for( size_t c = 0; c < candidates.size() && numCollapses < maxCollapses; ++c )
+		{
+			unsigned int p0 = candidates[c], v0 = bestSources[p0], v1 = bestTargets[p0], p1 = posIds[v1];
+			if( touched[p0] || touched[p1] ) continue;
+
+			// Reject collapse if a remaining triangle would flip
+			bool flipped = false;
+			for( unsigned int j = adjOffsets[p0]; j < adjOffsets[p0 + 1] && !flipped; ++j )
+			{
+				const unsigned int *tri = &curIndices[adjTris[j] * 3];
+				if( posIds[tri[0]] == p1 || posIds[tri[1]] == p1 || posIds[tri[2]] == p1 ) continue;
+				
+				Vec3f p[3], q[3];
+				for( unsigned int k = 0; k < 3; ++k )
+				{
+					p[k] = verts[tri[k]].pos;
+					q[k] = posIds[tri[k]] == p0 ? verts[v1].pos : p[k];
+				}
+				Vec3f nBefore = (p[1] - p[0]).cross( p[2] - p[0] );
+				Vec3f nAfter = (q[1] - q[0]).cross( q[2] - q[0] );
+				if( nBefore.dot( nAfter ) <= 0 ) flipped = true;
+			}
+			if( flipped ) continue;
+
+			remap[v0] = v1;
+			if( kinds[p0] == VertexKinds::Seam )
+			{
+				// Edge on the other side of the seam runs from p1 to p0
+				uint64 otherEdge = edgeVerts[makeEdgeKey( p1, p0 )];
+				remap[(unsigned int)otherEdge] = (unsigned int)(otherEdge >> 32);
+			}
+			quadrics[p1].add( quadrics[p0] );
+			maxError = max( maxError, bestErrors[p0] );
+			++numCollapses;
+			
+			for( unsigned int j = adjOffsets[p0]; j < adjOffsets[p0 + 1]; ++j )
+			{
+				const unsigned int *tri = &curIndices[adjTris[j] * 3];
+				touched[posIds[tri[0]]] = touched[posIds[tri[1]]] = touched[posIds[tri[2]]] = true;
+			}
+		}
+		if( numCollapses == 0 ) break;
+
+		// Apply collapses and remove degenerated triangles
+		size_t numIndices = 0;
+		for( size_t i = 0; i < curIndices.size(); i += 3 )
+		{
+			unsigned int a = remap[curIndices[i]], b = remap[curIndices[i + 1]], c = remap[curIndices[i + 2]];
+			if( posIds[a] == posIds[b] || posIds[b] == posIds[c] || posIds[a] == posIds[c] ) continue;
+			
+			curIndices[numIndices++] = a;
+			curIndices[numIndices++] = b;
+			curIndices[numIndices++] = c;
+		}
+		curIndices.resize( numIndices );
 	}
 
-	for( map< unsigned int, unsigned int >::iterator itr1 = vertMap.begin();
-	     itr1 != vertMap.end(); ++itr1 )
+	result.resize( curIndices.size() );
+	for( size_t i = 0; i < curIndices.size(); ++i ) result[i] = curIndices[i] + triGroup->vertRStart;
+
+	return (float)sqrt( maxError );
+}
+
+
+void MeshOptimizer::buildClusters( const TriGroup *triGroup, const vector< Vertex > &vertices,
+                                   const vector< unsigned int > &indices, unsigned int maxTriCount,
+                                   vector< MeshCluster > &clusters )
+{
+	// The optimized index order keeps neighbouring triangles close to each other, so consecutive
+	// ranges are spatially coherent and can be drawn without rewriting the index buffer
+	const unsigned int maxIndexCount = maxTriCount * 3;
+	vector< Vec3f > faceNormals;
+	
+	for( unsigned int first = triGroup->first; first < triGroup->first + triGroup->count; first += maxIndexCount )
 	{
-		vertices[itr1->second] = oldVertices[itr1->first - triGroup->vertRStart];
+		MeshCluster cluster;
+		cluster.firstIndex = first;
+		cluster.indexCount = std::min( maxIndexCount, triGroup->first + triGroup->count - first );
+
+		// Bounding sphere around the center of the bounding box
+		Vec3f bbMin( Math::MaxFloat, Math::MaxFloat, Math::MaxFloat );
+		Vec3f bbMax( -Math::MaxFloat, -Math::MaxFloat, -Math::MaxFloat );
+		for( unsigned int i = first; i < first + cluster.indexCount; ++i )
+		{
+			const Vec3f &pos = vertices[indices[i]].pos;
+			bbMin = Vec3f( std::min( bbMin.x, pos.x ), std::min( bbMin.y, pos.y ), std::min( bbMin.z, pos.z ) );
+			bbMax = Vec3f( std::max( bbMax.x, pos.x ), std::max( bbMax.y, pos.y ), std::max( bbMax.z, pos.z ) );
+		}
+		Vec3f center = (bbMin + bbMax) * 0.5f;
+		float radiusSq = 0;
+		for( unsigned int i = first; i < first + cluster.indexCount; ++i )
+		{
+			Vec3f diff = vertices[indices[i]].pos - center;
+			radiusSq = std::max( radiusSq, diff.dot( diff ) );
+		}
+
+		// Normal cone: the axis is the average face normal and the cutoff the smallest cosine
+		// between axis and face normals; degenerated triangles are ignored
+		faceNormals.clear();
+		Vec3f axis( 0, 0, 0 );
+		for( unsigned int i = first; i + 2 < first + cluster.indexCount; i += 3 )
+		{
+			const Vec3f &v0 = vertices[indices[i]].pos;
+			Vec3f normal = (vertices[indices[i + 1]].pos - v0).cross( vertices[indices[i + 2]].pos - v0 );
+			float length = normal.length();
+			if( length <= 0 ) continue;
+			
+			faceNormals.push_back( normal / length );
+			axis += faceNormals.back();
+		}
+		float cutoff = -1;
+		if( !faceNormals.empty() && axis.length() > 0 )
+		{
+			axis = axis.normalized();
+			cutoff = 1;
+			for( size_t i = 0; i < faceNormals.size(); ++i ) cutoff = std::min( cutoff, axis.dot( faceNormals[i] ) );
+		}
+
+		cluster.center[0] = center.x; cluster.center[1] = center.y; cluster.center[2] = center.z;
+		cluster.radius = sqrtf( radiusSq );
+		cluster.coneAxis[0] = axis.x; cluster.coneAxis[1] = axis.y; cluster.coneAxis[2] = axis.z;
+		cluster.coneCutoff = cutoff;
+		clusters.push_back( cluster );
 	}
 }
 
@@ -206,16 +809,21 @@ float MeshOptimizer::calcCacheEfficiency( TriGroup *triGroup, vector< unsigned i
                                           const unsigned int cacheSize )
 {	
 	// Measure efficiency of index array regarding post-transform vertex cache
+	// FIFO cache is simulated with timestamps: a vertex is cached if it was inserted less
+	// than cacheSize misses ago
 
+	if( triGroup->count == 0 ) return 1.0f;
+	
 	unsigned int misses = 0;
-	list< unsigned int > testCache;
+	unsigned int cacheTime = cacheSize + 1;
+	vector< unsigned int > cacheStamps( triGroup->vertREnd - triGroup->vertRStart + 1, 0 );
+	
 	for( unsigned int i = 0; i < triGroup->count; ++i )
 	{
-		unsigned int index = indices[triGroup->first + i];
-		if( find( testCache.begin(), testCache.end(), index ) == testCache.end() )
+		unsigned int &stamp = cacheStamps[indices[triGroup->first + i] - triGroup->vertRStart];
+		if( cacheTime - stamp > cacheSize )
 		{
-			testCache.push_back( index );
-			if( testCache.size() > cacheSize ) testCache.erase( testCache.begin() );
+			stamp = cacheTime++;
 			++misses;
 		}
 	}
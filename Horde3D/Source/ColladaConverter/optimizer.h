@@ -14,8 +14,6 @@
 #define _optimizer_H_
 
 #include <vector>
-#include <set>
-#include <map>
 
 namespace Horde3D {
 namespace ColladaConverter {
@@ -23,37 +21,47 @@ namespace ColladaConverter {
 
 struct TriGroup;
 struct Vertex;
-struct OptFace;
 
 
-struct OptVertex
+struct MeshCluster
 {
-	unsigned int           index;  // Index in vertex array
-	float                  score;
-	std::set< OptFace * >  faces;  // Faces that are using this vertex
-
-	void updateScore( int cacheIndex );
+	unsigned int  firstIndex, indexCount;
+	float         center[3], radius;
+	float         coneAxis[3], coneCutoff;  // Cosine of the cone angle, -1 if the cluster can't be cone culled
 };
 
-struct OptFace
-{
-	OptVertex  *verts[3];
-	
-	float getScore() const { return verts[0]->score + verts[1]->score + verts[2]->score; }
-};
 
 class MeshOptimizer
 {
 public:
 	static const int maxCacheSize = 16;
-	
+
 	static unsigned int removeDegeneratedTriangles( TriGroup *triGroup, std::vector< Vertex > &vertices,
 	                                                std::vector< unsigned int > &indices );
 	static float calcCacheEfficiency( TriGroup *triGroup, std::vector< unsigned int > &indices,
 	                                  const unsigned int cacheSize = maxCacheSize );
-	static void optimizeIndexOrder( TriGroup *triGroup, std::vector< Vertex > &vertices,
-	                                std::vector< unsigned int > &indices,
-	                                std::map< unsigned int, unsigned int > &vertMap );
+
+	// Reorders the triangles for the post-transform vertex cache
+	static void optimizeIndexOrder( TriGroup *triGroup, std::vector< unsigned int > &indices );
+	// Reorders clusters of a cache optimized index list so that triangles likely to occlude others are drawn
+	// first; threshold is the ATVR degradation that is accepted within a cluster (e.g. 1.05)
+	static void optimizeOverdraw( TriGroup *triGroup, const std::vector< Vertex > &vertices,
+	                              std::vector< unsigned int > &indices, float threshold );
+	// Reorders the vertices in the order of their first use; vertMap maps old to new vertex indices
+	// relative to vertRStart
+	static void optimizeVertexFetch( TriGroup *triGroup, std::vector< Vertex > &vertices,
+	                                 std::vector< unsigned int > &indices, std::vector< unsigned int > &vertMap );
+	// Reduces the triangles of a group to about targetCount indices by collapsing edges in order of
+	// their quadric error; the result references a subset of the vertices of the group and
+	// the maximum error is returned as distance
+	static float simplify( const TriGroup *triGroup, const std::vector< Vertex > &vertices,
+	                       const std::vector< unsigned int > &indices, unsigned int targetCount,
+	                       std::vector< unsigned int > &result );
+	// Splits the triangles of a group into consecutive clusters of at most maxTriCount triangles and
+	// computes a bounding sphere and a cone that contains the normals of all triangles for each
+	static void buildClusters( const TriGroup *triGroup, const std::vector< Vertex > &vertices,
+	                           const std::vector< unsigned int > &indices, unsigned int maxTriCount,
+	                           std::vector< MeshCluster > &clusters );
 };
 
 
@@ -0,0 +1,285 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#if defined( _MSC_VER )
+#	if _MSC_VER >= 1400
+#		define _CRT_SECURE_NO_DEPRECATE
+#	endif
+#endif
+
+#include "sceneCompiler.h"
+#include "utils.h"
+#include "utXML.h"
+#include "utEndian.h"
+#include "rapidxml_print.h"
+#include <cstdio>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+namespace Horde3D {
+namespace ColladaConverter {
+
+
+// Value types of node attributes, must match SceneGraphAttribTypes of the engine
+struct AttribTypes
+{
+	enum List
+	{
+		Int = 0,
+		Float,
+		String
+	};
+};
+
+
+struct AttribSchema
+{
+	const char        *nodeType;
+	const char        *name;
+	AttribTypes::List  type;
+};
+
+// Numeric attributes of the built-in node types; all other attributes are stored as strings
+static const AttribSchema attribSchemas[] = {
+	{ "Model", "lodDist1", AttribTypes::Float }, { "Model", "lodDist2", AttribTypes::Float },
+	{ "Model", "lodDist3", AttribTypes::Float }, { "Model", "lodDist4", AttribTypes::Float },
+	{ "Mesh", "batchStart", AttribTypes::Int }, { "Mesh", "batchCount", AttribTypes::Int },
+	{ "Mesh", "vertRStart", AttribTypes::Int }, { "Mesh", "vertREnd", AttribTypes::Int },
+	{ "Mesh", "lodLevel", AttribTypes::Int },
+	{ "Joint", "jointIndex", AttribTypes::Int },
+	{ "Light", "radius", AttribTypes::Float }, { "Light", "fov", AttribTypes::Float },
+	{ "Light", "col_R", AttribTypes::Float }, { "Light", "col_G", AttribTypes::Float },
+	{ "Light", "col_B", AttribTypes::Float }, { "Light", "colMult", AttribTypes::Float },
+	{ "Light", "shadowMapCount", AttribTypes::Int }, { "Light", "shadowSplitLambda", AttribTypes::Float },
+	{ "Light", "shadowMapBias", AttribTypes::Float },
+	{ "Camera", "outputBufferIndex", AttribTypes::Int },
+	{ "Camera", "leftPlane", AttribTypes::Float }, { "Camera", "rightPlane", AttribTypes::Float },
+	{ "Camera", "bottomPlane", AttribTypes::Float }, { "Camera", "topPlane", AttribTypes::Float },
+	{ "Camera", "nearPlane", AttribTypes::Float }, { "Camera", "farPlane", AttribTypes::Float },
+	{ "Emitter", "maxCount", AttribTypes::Int }, { "Emitter", "respawnCount", AttribTypes::Int },
+	{ "Emitter", "delay", AttribTypes::Float }, { "Emitter", "emissionRate", AttribTypes::Float },
+	{ "Emitter", "spreadAngle", AttribTypes::Float }, { "Emitter", "forceX", AttribTypes::Float },
+	{ "Emitter", "forceY", AttribTypes::Float }, { "Emitter", "forceZ", AttribTypes::Float },
+	{ "Compute", "elementsCount", AttribTypes::Int },
+	{ "Compute", "aabbMinX", AttribTypes::Float }, { "Compute", "aabbMinY", AttribTypes::Float },
+	{ "Compute", "aabbMinZ", AttribTypes::Float }, { "Compute", "aabbMaxX", AttribTypes::Float },
+	{ "Compute", "aabbMaxY", AttribTypes::Float }, { "Compute", "aabbMaxZ", AttribTypes::Float }
+};
+
+static const char *baseAttribNames[] = { "name", "tx", "ty", "tz", "rx", "ry", "rz", "sx", "sy", "sz" };
+
+
+static AttribTypes::List getAttribType( const char *nodeType, const char *name )
+{
+	for( size_t i = 0; i < sizeof( attribSchemas ) / sizeof( AttribSchema ); ++i )
+	{
+		if( strcmp( attribSchemas[i].nodeType, nodeType ) == 0 && strcmp( attribSchemas[i].name, name ) == 0 )
+			return attribSchemas[i].type;
+	}
+
+	return AttribTypes::String;
+}
+
+
+class SceneCompiler
+{
+public:
+	SceneCompiler( const set< string > &binaryScenes ) : _binaryScenes( binaryScenes ), _nodeCount( 0 ) {}
+
+	void compileNode( const XMLNode &xmlNode );
+	bool write( const string &fileName ) const;
+
+private:
+	unsigned int addString( const string &str );
+	void addFloat( float value );
+
+private:
+	const set< string >                      &_binaryScenes;
+
+	string                                   _stringData;
+	vector< unsigned int >                   _stringOffsets;
+	unordered_map< string, unsigned int >    _stringIndices;  // Strings are shared between nodes
+	vector< unsigned int >                   _nodeData;
+	unsigned int                             _nodeCount;
+};
+
+
+unsigned int SceneCompiler::addString( const string &str )
+{
+	unordered_map< string, unsigned int >::iterator itr = _stringIndices.find( str );
+	if( itr != _stringIndices.end() ) return itr->second;
+
+	unsigned int index = (unsigned int)_stringOffsets.size();
+	_stringOffsets.push_back( (unsigned int)_stringData.size() );
+	_stringData.append( str.c_str(), str.length() + 1 );
+	_stringIndices[str] = index;
+
+	return index;
+}
+
+
+void SceneCompiler::addFloat( float value )
+{
+	unsigned int bits;
+	memcpy( &bits, &value, 4 );
+	_nodeData.push_back( bits );
+}
+
+
+void SceneCompiler::compileNode( const XMLNode &xmlNode )
+{
+	// Node record: type, name, number of children, translation, rotation, scale, attachment and
+	// number of attributes, followed by name, value type and value of every attribute
+	const char *nodeType = xmlNode.getName();
+	_nodeData.push_back( addString( nodeType ) );
+	_nodeData.push_back( addString( xmlNode.getAttribute( "name", "" ) ) );
+
+	unsigned int childCount = 0;
+	for( XMLNode child = xmlNode.getFirstChild(); !child.isEmpty(); child = child.getNextSibling() )
+	{
+		if( child.getRapidXMLNode()->type() == rapidxml::node_element && strcmp( child.getName(), "Attachment" ) != 0 )
+			++childCount;
+	}
+	_nodeData.push_back( childCount );
+
+	for( unsigned int i = 1; i < 10; ++i )
+		addFloat( toFloat( xmlNode.getAttribute( baseAttribNames[i], i < 7 ? "0" : "1" ) ) );
+
+	XMLNode attachmentNode = xmlNode.getFirstChild( "Attachment" );
+	if( !attachmentNode.isEmpty() )
+	{
+		string attachment;
+		rapidxml::print( back_inserter( attachment ), *attachmentNode.getRapidXMLNode(), 0 );
+		_nodeData.push_back( addString( attachment ) );
+	}
+	else
+	{
+		_nodeData.push_back( 0xffffffff );
+	}
+
+	size_t attribCountPos = _nodeData.size();
+	_nodeData.push_back( 0 );
+	for( XMLAttribute attrib = xmlNode.getFirstAttrib(); !attrib.isEmpty(); attrib = attrib.getNextAttrib() )
+	{
+		bool baseAttrib = false;
+		for( unsigned int i = 0; i < 10; ++i ) baseAttrib |= strcmp( attrib.getName(), baseAttribNames[i] ) == 0;
+		if( baseAttrib ) continue;
+
+		// Values that can't be parsed completely are kept as string, the engine converts them when
+		// they are read
+		const char *value = attrib.getValue();
+		AttribTypes::List type = getAttribType( nodeType, attrib.getName() );
+		char *end = 0x0;
+		long intValue = 0;
+		float floatValue = 0;
+		if( type == AttribTypes::Int ) intValue = strtol( value, &end, 10 );
+		else if( type == AttribTypes::Float ) floatValue = strtof( value, &end );
+		if( end == value || (end != 0x0 && *end != '\0') ) type = AttribTypes::String;
+
+		_nodeData.push_back( addString( attrib.getName() ) );
+		_nodeData.push_back( type );
+		if( type == AttribTypes::Int )
+		{
+			_nodeData.push_back( (unsigned int)intValue );
+		}
+		else if( type == AttribTypes::Float )
+		{
+			addFloat( floatValue );
+		}
+		else
+		{
+			string str = value;
+			if( strcmp( nodeType, "Reference" ) == 0 && strcmp( attrib.getName(), "sceneGraph" ) == 0 &&
+			    _binaryScenes.find( str ) != _binaryScenes.end() )
+			{
+				str = getBinarySceneName( str );
+			}
+			_nodeData.push_back( addString( str ) );
+		}
+		++_nodeData[attribCountPos];
+	}
+	++_nodeCount;
+
+	for( XMLNode child = xmlNode.getFirstChild(); !child.isEmpty(); child = child.getNextSibling() )
+	{
+		if( child.getRapidXMLNode()->type() == rapidxml::node_element && strcmp( child.getName(), "Attachment" ) != 0 )
+			compileNode( child );
+	}
+}
+
+
+bool SceneCompiler::write( const string &fileName ) const
+{
+	FILE *f = fopen( fileName.c_str(), "wb" );
+	if( f == 0x0 )
+	{
+		log( "Failed to write " + fileName + " file" );
+		return false;
+	}
+
+	// Header: magic, version, number of strings, size of string data and number of nodes
+	vector< unsigned int > words;
+	words.push_back( 1 );
+	words.push_back( (unsigned int)_stringOffsets.size() );
+	words.push_back( (unsigned int)_stringData.size() );
+	words.push_back( _nodeCount );
+	words.insert( words.end(), _stringOffsets.begin(), _stringOffsets.end() );
+
+	vector< unsigned int > nodeData( _nodeData.size() );
+	elemcpy_le( words.data(), words.data(), words.size() );
+	if( !nodeData.empty() ) elemcpy_le( nodeData.data(), _nodeData.data(), nodeData.size() );
+
+	fwrite( "H3DS", 1, 4, f );
+	fwrite( words.data(), 4, words.size(), f );
+	fwrite( _stringData.data(), 1, _stringData.size(), f );
+	fwrite( nodeData.data(), 4, nodeData.size(), f );
+
+	bool result = ferror( f ) == 0;
+	fclose( f );
+
+	return result;
+}
+
+
+string getBinarySceneName( const string &xmlSceneName )
+{
+	const string xmlExt = ".scene.xml";
+	if( xmlSceneName.length() > xmlExt.length() &&
+	    _stricmp( xmlSceneName.c_str() + xmlSceneName.length() - xmlExt.length(), xmlExt.c_str() ) == 0 )
+	{
+		return xmlSceneName.substr( 0, xmlSceneName.length() - xmlExt.length() ) + ".scene.bin";
+	}
+
+	return xmlSceneName + ".bin";
+}
+
+
+bool compileSceneGraph( const string &sourceFile, const string &destFile, const set< string > &binaryScenes )
+{
+	XMLDoc doc;
+	if( !doc.parseFile( sourceFile.c_str() ) || doc.hasError() )
+	{
+		log( "Error: Failed to parse scene graph " + sourceFile );
+		return false;
+	}
+
+	SceneCompiler compiler( binaryScenes );
+	compiler.compileNode( doc.getRootNode() );
+
+	return compiler.write( destFile );
+}
+
+
+} // namespace ColladaConverter
+} // namespace Horde3D
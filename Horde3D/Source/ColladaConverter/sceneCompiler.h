@@ -0,0 +1,35 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _sceneCompiler_H_
+#define _sceneCompiler_H_
+
+#include <string>
+#include <set>
+
+namespace Horde3D {
+namespace ColladaConverter {
+
+
+// Converts an XML scene graph to the binary scene graph format of the engine; references to scene
+// graphs in binaryScenes are redirected to the binary files that are created for them
+bool compileSceneGraph( const std::string &sourceFile, const std::string &destFile,
+                        const std::set< std::string > &binaryScenes );
+
+// Name of the binary scene graph that is created for an XML scene graph
+std::string getBinarySceneName( const std::string &xmlSceneName );
+
+
+} // namespace ColladaConverter
+} // namespace Horde3D
+
+#endif // _sceneCompiler_H_
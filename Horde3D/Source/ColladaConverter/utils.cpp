@@ -14,6 +14,11 @@
 #include "utPlatform.h"
 #include <iostream>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #ifdef PLATFORM_WIN
 #   define WIN32_LEAN_AND_MEAN 1
@@ -24,6 +29,9 @@
 #	include <direct.h>
 #else
 #	include <sys/stat.h>  // For mkdir
+#	include <sys/mman.h>
+#	include <fcntl.h>
+#	include <unistd.h>
 #endif
 
 using namespace std;
@@ -116,17 +124,182 @@ string cleanPath( const string &path )
 }
 
 
-void log( const std::string &msg )
+struct LogGroup
 {
-	cout << msg << endl;
-	
+	mutex   groupMutex;
+	string  text;
+};
+
+static mutex logMutex;
+static thread_local LogGroup *curLogGroup = 0x0;
+
+
+static void writeLog( const string &text )
+{
+	lock_guard< mutex > lock( logMutex );
+	cout << text << flush;
+
 #ifdef PLATFORM_WIN
-	OutputDebugString( msg.c_str() );
-	OutputDebugString( "\r\n" );
+	OutputDebugString( text.c_str() );
 #endif
 }
 
 
+void log( const std::string &msg )
+{
+	if( curLogGroup != 0x0 )
+	{
+		lock_guard< mutex > lock( curLogGroup->groupMutex );
+		curLogGroup->text += msg;
+		curLogGroup->text += '\n';
+	}
+	else
+	{
+		writeLog( msg + '\n' );
+	}
+}
+
+
+void beginLogGroup()
+{
+	if( curLogGroup == 0x0 ) curLogGroup = new LogGroup();
+}
+
+
+void endLogGroup()
+{
+	if( curLogGroup == 0x0 ) return;
+
+	writeLog( curLogGroup->text );
+	delete curLogGroup; curLogGroup = 0x0;
+}
+
+
+// Workers of a single pool serve all parallel loops. The thread that starts a loop processes
+// indices as well, so nested loops progress even if all workers are busy and the number of
+// threads never exceeds the job count.
+struct ParallelLoop
+{
+	const function< void( unsigned int ) >  *func;
+	unsigned int                            count;
+	atomic< unsigned int >                  nextIndex;
+	unsigned int                            numWorkers;  // Guarded by pool mutex
+	LogGroup                                *logGroup;
+};
+
+
+class ThreadPool
+{
+public:
+	ThreadPool() : _shutdown( false ) {}
+
+	~ThreadPool()
+	{
+		{
+			lock_guard< mutex > lock( _mutex );
+			_shutdown = true;
+		}
+		_workCond.notify_all();
+		for( size_t i = 0; i < _workers.size(); ++i ) _workers[i].join();
+	}
+
+	void run( ParallelLoop &loop, unsigned int numThreads )
+	{
+		{
+			lock_guard< mutex > lock( _mutex );
+			while( _workers.size() + 1 < numThreads ) _workers.push_back( thread( &ThreadPool::workerLoop, this ) );
+			_loops.push_back( &loop );
+		}
+		_workCond.notify_all();
+
+		process( loop );
+
+		// All indices are taken, wait for the workers still processing some of them
+		unique_lock< mutex > lock( _mutex );
+		removeLoop( loop );
+		_doneCond.wait( lock, [&loop]() { return loop.numWorkers == 0; } );
+	}
+
+private:
+	static void process( ParallelLoop &loop )
+	{
+		for( unsigned int i = loop.nextIndex++; i < loop.count; i = loop.nextIndex++ ) (*loop.func)( i );
+	}
+
+	void removeLoop( ParallelLoop &loop )
+	{
+		vector< ParallelLoop * >::iterator itr = find( _loops.begin(), _loops.end(), &loop );
+		if( itr != _loops.end() ) _loops.erase( itr );
+	}
+
+	void workerLoop()
+	{
+		unique_lock< mutex > lock( _mutex );
+		for( ;; )
+		{
+			_workCond.wait( lock, [this]() { return _shutdown || !_loops.empty(); } );
+			if( _shutdown ) return;
+
+			// Innermost loops are started last and help their outer loop to finish
+			ParallelLoop &loop = *_loops.back();
+			++loop.numWorkers;
+			lock.unlock();
+
+			LogGroup *prevLogGroup = curLogGroup;
+			curLogGroup = loop.logGroup;
+			process( loop );
+			curLogGroup = prevLogGroup;
+
+			lock.lock();
+			removeLoop( loop );
+			if( --loop.numWorkers == 0 ) _doneCond.notify_all();
+		}
+	}
+
+private:
+	mutex                     _mutex;
+	condition_variable        _workCond, _doneCond;
+	vector< thread >          _workers;
+	vector< ParallelLoop * >  _loops;
+	bool                      _shutdown;
+};
+
+
+static unsigned int jobCount = 1;
+
+
+void setJobCount( unsigned int count )
+{
+	jobCount = count > 0 ? count : 1;
+}
+
+
+unsigned int getJobCount()
+{
+	return jobCount;
+}
+
+
+void parallelFor( unsigned int count, const function< void( unsigned int ) > &func )
+{
+	if( jobCount <= 1 || count <= 1 )
+	{
+		for( unsigned int i = 0; i < count; ++i ) func( i );
+		return;
+	}
+
+	static ThreadPool pool;
+
+	ParallelLoop loop;
+	loop.func = &func;
+	loop.count = count;
+	loop.nextIndex = 0;
+	loop.numWorkers = 0;
+	loop.logGroup = curLogGroup;
+	pool.run( loop, jobCount );
+}
+
+
 Matrix4f makeMatrix4f( float *floatArray16, bool y_up )
 {
 	Matrix4f mat( floatArray16 );
@@ -180,5 +353,202 @@ void createDirectories( const string &basePath, const string &newPath )
 }
 
 
+template< class T > static bool parseValue( char *&str, T &value );
+template<> bool parseValue( char *&str, float &value ) { return parseFloat( str, value ); }
+template<> bool parseValue( char *&str, int &value ) { return parseInt( str, value ); }
+
+
+// Returns false if parsing stopped at an invalid token before the end of the range
+template< class T > static bool parseRange( char *str, char *end, vector< T > &values )
+{
+	T value;
+	
+	for( ;; )
+	{
+		while( str < end && isWhitespace( *str ) ) ++str;
+		if( str >= end ) return true;
+		if( !parseValue( str, value ) ) return false;
+		
+		values.push_back( value );
+	}
+}
+
+
+template< class T > static void parseArray( char *str, vector< T > &values, size_t countHint )
+{
+	const size_t minChunkSize = 1 << 20;
+	
+	size_t len = strlen( str );
+	size_t numChunks = getJobCount() > 1 ? min( (size_t)getJobCount() * 4, len / minChunkSize ) : 0;
+
+	if( numChunks < 2 )
+	{
+		values.reserve( values.size() + countHint );
+		parseRange( str, str + len, values );
+		return;
+	}
+
+	// Split text at whitespace so that no number is cut
+	vector< char * > bounds( numChunks + 1 );
+	bounds[0] = str;
+	bounds[numChunks] = str + len;
+	for( size_t i = 1; i < numChunks; ++i )
+	{
+		char *bound = max( str + len * i / numChunks, bounds[i - 1] );
+		while( *bound && !isWhitespace( *bound ) ) ++bound;
+		bounds[i] = bound;
+	}
+	
+	vector< vector< T > > chunkValues( numChunks );
+	vector< char > chunkComplete( numChunks );
+	parallelFor( (unsigned int)numChunks, [&]( unsigned int i )
+	{
+		chunkValues[i].reserve( countHint / numChunks + 1 );
+		chunkComplete[i] = parseRange( bounds[i], bounds[i + 1], chunkValues[i] );
+	} );
+
+	// Values after an invalid token are dropped, as in a serial parse
+	size_t numValidChunks = numChunks;
+	for( size_t i = 0; i < numChunks; ++i )
+	{
+		if( !chunkComplete[i] )
+		{
+			numValidChunks = i + 1;
+			break;
+		}
+	}
+
+	size_t count = values.size();
+	for( size_t i = 0; i < numValidChunks; ++i ) count += chunkValues[i].size();
+	values.reserve( count );
+	for( size_t i = 0; i < numValidChunks; ++i )
+		values.insert( values.end(), chunkValues[i].begin(), chunkValues[i].end() );
+}
+
+
+void parseFloatArray( char *str, vector< float > &values, size_t countHint )
+{
+	parseArray( str, values, countHint );
+}
+
+
+void parseIntArray( char *str, vector< int > &values, size_t countHint )
+{
+	parseArray( str, values, countHint );
+}
+
+
+MappedFile::MappedFile() :
+	_data( 0x0 ), _size( 0 ), _mapped( false )
+{
+#ifdef PLATFORM_WIN
+	_mappingHandle = 0x0;
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+bool MappedFile::open( const string &fileName )
+{
+	close();
+
+	// The remainder of the last page of a mapping is zero, which terminates the text; files that
+	// end exactly at a page boundary are read instead
+#ifdef PLATFORM_WIN
+	HANDLE file = CreateFile( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0x0, OPEN_EXISTING,
+	                          FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0x0 );
+	if( file == INVALID_HANDLE_VALUE ) return false;
+
+	LARGE_INTEGER fileSize;
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo( &sysInfo );
+	GetFileSizeEx( file, &fileSize );
+	_size = (size_t)fileSize.QuadPart;
+	
+	if( _size > 0 && _size % sysInfo.dwPageSize != 0 )
+	{
+		_mappingHandle = CreateFileMapping( file, 0x0, PAGE_WRITECOPY, 0, 0, 0x0 );
+		if( _mappingHandle != 0x0 )
+		{
+			_data = (char *)MapViewOfFile( _mappingHandle, FILE_MAP_COPY, 0, 0, 0 );
+			if( _data != 0x0 ) _mapped = true;
+			else
+			{
+				CloseHandle( _mappingHandle );
+				_mappingHandle = 0x0;
+			}
+		}
+	}
+	CloseHandle( file );
+#else
+	int file = ::open( fileName.c_str(), O_RDONLY );
+	if( file < 0 ) return false;
+
+	struct stat fileStat;
+	if( fstat( file, &fileStat ) != 0 )
+	{
+		::close( file );
+		return false;
+	}
+	_size = (size_t)fileStat.st_size;
+	
+	if( _size > 0 && _size % (size_t)sysconf( _SC_PAGESIZE ) != 0 )
+	{
+		void *data = mmap( 0x0, _size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+		if( data != MAP_FAILED )
+		{
+			madvise( data, _size, MADV_SEQUENTIAL );
+			_data = (char *)data;
+			_mapped = true;
+		}
+	}
+	::close( file );
+#endif
+
+	if( !_mapped )
+	{
+		FILE *f = fopen( fileName.c_str(), "rb" );
+		if( f == 0x0 ) return false;
+
+		_data = new char[_size + 1];
+		_size = fread( _data, 1, _size, f );
+		_data[_size] = '\0';
+		fclose( f );
+	}
+
+	return true;
+}
+
+
+void MappedFile::close()
+{
+	if( _data == 0x0 ) return;
+	
+	if( _mapped )
+	{
+#ifdef PLATFORM_WIN
+		UnmapViewOfFile( _data );
+		CloseHandle( _mappingHandle );
+		_mappingHandle = 0x0;
+#else
+		munmap( _data, _size );
+#endif
+	}
+	else
+	{
+		delete[] _data;
+	}
+
+	_data = 0x0;
+	_size = 0;
+	_mapped = false;
+}
+
+
 } // namespace ColladaConverter
 } // namespace Horde3D
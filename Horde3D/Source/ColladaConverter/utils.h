@@ -18,6 +18,11 @@
 #include <cstring>
 #include <cstdlib>
 #include <string>
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
 
 namespace Horde3D {
 namespace ColladaConverter {
@@ -30,6 +35,16 @@ std::string extractFilePath( const std::string &fullPath );
 std::string cleanPath( const std::string &path );
 
 void log( const std::string &msg );
+// While a log group is active, the messages of the calling thread (and of parallelFor workers helping
+// it) are collected and written at once when the group ends
+void beginLogGroup();
+void endLogGroup();
+
+void setJobCount( unsigned int count );
+unsigned int getJobCount();
+// Calls func for all indices in [0, count) on the calling thread and the idle threads of a pool of
+// job count threads. Nested calls share the same pool.
+void parallelFor( unsigned int count, const std::function< void( unsigned int ) > &func );
 
 Matrix4f makeMatrix4f( float *floatArray16, bool y_up );
 
@@ -37,20 +52,25 @@ void createDirectories( const std::string &basePath, const std::string &newPath
 
 
 
+inline bool isWhitespace( char c )
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
 inline bool parseString( char *&str, std::string &token )
 {
 	token.clear();
 	token.reserve( 16 );
 	
 	// Skip whitespace
-	while( *str == ' ' || *str == '\t' || *str == '\n' || *str == '\r' )
+	while( isWhitespace( *str ) )
 	{
 		++str;
 	}
 	if( *str == '\0' ) return false;
 
 	// Copy token
-	while( *str && *str != ' ' && *str != '\t' && *str != '\n' && *str != '\r' )
+	while( *str && !isWhitespace( *str ) )
 	{
 		token += *str++;
 	}
@@ -60,22 +80,23 @@ inline bool parseString( char *&str, std::string &token )
 
 inline bool parseFloat( char *&str, float &f )
 {
-	float sign = 1.0f;
-	float value = 0.0f;
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
 	
 	// Skip whitespace
-	while( *str == ' ' || *str == '\t' || *str == '\n' || *str == '\r' )
+	while( isWhitespace( *str ) )
 	{
 		++str;
 	}
 	if( *str == '\0' ) return false;
 
 	char *firstChar = str;
+	bool negative = false;
 	
 	// Handle sign
 	if( *str == '-' )
 	{
-		sign = -1.0;
+		negative = true;
 		++str;
 	}
 	else if( *str == '+' )
@@ -83,47 +104,96 @@ inline bool parseFloat( char *&str, float &f )
 		++str;
 	}
 	
-	// Integral part
-	while( *str >= '0' && *str <= '9' )
+	// Collect up to 19 significant digits in an integer, further digits only change the exponent
+	uint64 mantissa = 0;
+	int exponent = 0, numDigits = 0;
+	bool hasDigits = false;
+	
+	for( ; *str >= '0' && *str <= '9'; ++str )
 	{
-		value = value * 10.0f + (*str++ - '0');
+		hasDigits = true;
+		if( numDigits < 19 )
+		{
+			mantissa = mantissa * 10 + (*str - '0');
+			if( mantissa != 0 ) ++numDigits;
+		}
+		else ++exponent;
 	}
-
-	// Fractional part
 	if( *str == '.' )
 	{
-		++str;
-		float pow10 = 0.1f;
-
-		while( *str >= '0' && *str <= '9' )
+		for( ++str; *str >= '0' && *str <= '9'; ++str )
 		{
-			value += (*str++ - '0') * pow10;
-			pow10 *= 0.1f;
+			hasDigits = true;
+			if( numDigits < 19 )
+			{
+				mantissa = mantissa * 10 + (*str - '0');
+				if( mantissa != 0 ) ++numDigits;
+				--exponent;
+			}
 		}
 	}
-	
-	// Exponent (use standard `toFloat` in this case)
-	if( *str == 'e' || *str == 'E')
+
+	// Exponent
+	if( hasDigits && (*str == 'e' || *str == 'E') )
 	{
-		while( *str && *str != ' ' && *str != '\t' && *str != '\n' && *str != '\r' )
+		char *expChar = str++;
+		bool negativeExp = false;
+		if( *str == '-' )
+		{
+			negativeExp = true;
 			++str;
-		
-		if( str - firstChar < 64 )
+		}
+		else if( *str == '+' )
 		{
-			char buf[64];
-			memcpy( buf, firstChar, str - firstChar );
-			buf[str - firstChar] = '\0';
+			++str;
+		}
 
-			f = toFloat( buf );
+		if( *str >= '0' && *str <= '9' )
+		{
+			int value = 0;
+			for( ; *str >= '0' && *str <= '9'; ++str )
+			{
+				if( value < 10000 ) value = value * 10 + (*str - '0');
+			}
+			exponent += negativeExp ? -value : value;
 		}
-		else
-			return false;
+		else str = expChar;
 	}
-	else
+	
+	// Leave special values like inf and nan to the standard conversion
+	if( !hasDigits || (*str != '\0' && !isWhitespace( *str )) )
+	{
+		while( *str && !isWhitespace( *str ) )
+			++str;
+		
+		f = toFloat( std::string( firstChar, str ).c_str() );
+		return true;
+	}
+
+	if( mantissa == 0 )
 	{
-		f = value * sign;
+		f = negative ? -0.0f : 0.0f;
+		return true;
 	}
 	
+	// Mantissa and power of ten are exact in double precision, so the result is the correctly
+	// rounded double; rounding that to float is only ambiguous if it lies exactly halfway between
+	// two floats (the lower 29 bits of the double mantissa are cut off)
+	if( mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22 )
+	{
+		double value = exponent >= 0 ? (double)mantissa * pow10[exponent] : (double)mantissa / pow10[-exponent];
+		uint64 bits;
+		memcpy( &bits, &value, sizeof( bits ) );
+		
+		if( value >= FLT_MIN && value <= FLT_MAX && (bits & 0x1FFFFFFF) != 0x10000000 )
+		{
+			f = (float)(negative ? -value : value);
+			return true;
+		}
+	}
+
+	// Long mantissas, large exponents and denormals
+	f = toFloat( std::string( firstChar, str ).c_str() );
 	return true;
 }
 
@@ -133,7 +203,7 @@ inline bool parseInt( char *&str, int &i )
 	int sign = 1;
 	
 	// Skip whitespace
-	while( *str == ' ' || *str == '\t' || *str == '\n' || *str == '\r' )
+	while( isWhitespace( *str ) )
 	{
 		++str;
 	}
@@ -151,6 +221,7 @@ inline bool parseInt( char *&str, int &i )
 	}
 	
 	// Value
+	if( *str < '0' || *str > '9' ) return false;
 	while( *str >= '0' && *str <= '9' )
 	{
 		value = (value * 10) + (*str++ - '0');
@@ -160,6 +231,35 @@ inline bool parseInt( char *&str, int &i )
 	return true;
 }
 
+// Parse whitespace separated lists of numbers; large lists are split at whitespace and
+// parsed in parallel. Like parseInt, parsing stops at the first token that is not a number.
+void parseFloatArray( char *str, std::vector< float > &values, size_t countHint = 0 );
+void parseIntArray( char *str, std::vector< int > &values, size_t countHint = 0 );
+
+
+// Private copy-on-write mapping of a file that is terminated with '\0', so it can be parsed
+// in place; files are read into memory if they cannot be mapped
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open( const std::string &fileName );
+	void close();
+
+	char *getData() const { return _data; }
+	size_t getSize() const { return _size; }
+
+private:
+	char    *_data;
+	size_t  _size;
+	bool    _mapped;
+#ifdef PLATFORM_WIN
+	void    *_mappingHandle;
+#endif
+};
+
 
 } // namespace ColladaConverter
 } // namespace Horde3D
@@ -53,49 +53,48 @@ MeshNode::~MeshNode()
 	for( uint32 i = 0; i < _occQueries.size(); ++i )
 	{
 		if( _occQueries[i] != 0 )
+		{
+			// Nodes and render proxies are deleted on the application thread
+			Modules::renderer().acquireRenderContext();
 			rdi->destroyQuery( _occQueries[i] );
+		}
 	}
 }
 
 
-SceneNodeTpl *MeshNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *MeshNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
+	int value;
 	MeshNodeTpl *meshTpl = new MeshNodeTpl( "", 0x0, MeshPrimType::TriangleList, 0, 0, 0, 0 );
 
-	itr = attribs.find( "material" );
-	if( itr != attribs.end() )
+	const char *material = attribs.getString( "material" );
+	if( material != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, material, 0, false );
 		if( res != 0 )
 			meshTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "batchStart" );
-	if( itr != attribs.end() ) meshTpl->batchStart = atoi( itr->second.c_str() );
+	if( attribs.getInt( "batchStart", value ) ) meshTpl->batchStart = value;
 	else result = false;
-	itr = attribs.find( "batchCount" );
-	if( itr != attribs.end() ) meshTpl->batchCount = atoi( itr->second.c_str() );
+	if( attribs.getInt( "batchCount", value ) ) meshTpl->batchCount = value;
 	else result = false;
-	itr = attribs.find( "vertRStart" );
-	if( itr != attribs.end() ) meshTpl->vertRStart = atoi( itr->second.c_str() );
+	if( attribs.getInt( "vertRStart", value ) ) meshTpl->vertRStart = value;
 	else result = false;
-	itr = attribs.find( "vertREnd" );
-	if( itr != attribs.end() ) meshTpl->vertREnd = atoi( itr->second.c_str() );
+	if( attribs.getInt( "vertREnd", value ) ) meshTpl->vertREnd = value;
 	else result = false;
 
-	itr = attribs.find( "lodLevel" );
-	if( itr != attribs.end() ) meshTpl->lodLevel = atoi( itr->second.c_str() );
+	if( attribs.getInt( "lodLevel", value ) ) meshTpl->lodLevel = value;
 
-	itr = attribs.find( "primType" );
-	if( itr != attribs.end() ) {
-		if (_stricmp(itr->second.c_str(), "TriangleList") == 0) {
+	const char *primType = attribs.getString( "primType" );
+	if( primType != 0x0 ) {
+		if (_stricmp(primType, "TriangleList") == 0) {
 			meshTpl->primType = MeshPrimType::TriangleList;
-		} else if (_stricmp(itr->second.c_str(), "LineList") == 0) {
+		} else if (_stricmp(primType, "LineList") == 0) {
 			meshTpl->primType = MeshPrimType::LineList;
-		} else if ( _stricmp( itr->second.c_str(), "Patches" ) == 0 ) {
+		} else if ( _stricmp( primType, "Patches" ) == 0 ) {
 			meshTpl->primType = MeshPrimType::Patches;
 		} else {
 			result = false;
@@ -277,6 +276,33 @@ void MeshNode::onPostUpdate()
 }
 
 
+SceneNode *MeshNode::createRenderProxy() const
+{
+	MeshNode *proxy = new MeshNode( *this );
+	proxy->_parentModel = 0x0;
+
+	return proxy;
+}
+
+
+void MeshNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	SceneNode::updateRenderProxy( proxy );
+
+	MeshNode &meshProxy = (MeshNode &)proxy;
+	meshProxy._materialRes = _materialRes;
+	meshProxy._primType = _primType;
+	meshProxy._batchStart = _batchStart;
+	meshProxy._batchCount = _batchCount;
+	meshProxy._vertRStart = _vertRStart;
+	meshProxy._vertREnd = _vertREnd;
+	meshProxy._lodLevel = _lodLevel;
+	meshProxy._localBBox = _localBBox;
+	meshProxy._parentModel = _parentModel != 0x0 ?
+		(ModelNode *)Modules::sceneMan().getRenderProxy( _parentModel->getHandle() ) : 0x0;
+}
+
+
 // *************************************************************************************************
 // Class JointNode
 // *************************************************************************************************
@@ -287,15 +313,14 @@ JointNode::JointNode( const JointNodeTpl &jointTpl ) :
 }
 
 
-SceneNodeTpl *JointNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *JointNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
+	int value;
 	JointNodeTpl *jointTpl = new JointNodeTpl( "", 0 );
 
-	itr = attribs.find( "jointIndex" );
-	if( itr != attribs.end() ) jointTpl->jointIndex = atoi( itr->second.c_str() );
+	if( attribs.getInt( "jointIndex", value ) ) jointTpl->jointIndex = value;
 	else result = false;
 
 	if( !result )
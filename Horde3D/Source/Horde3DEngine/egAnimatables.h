@@ -77,7 +77,7 @@ struct MeshNodeTpl : public SceneNodeTpl
 class MeshNode : public SceneNode, public IAnimatableNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	// IAnimatableNode
@@ -97,6 +97,9 @@ public:
 	void onDetach( SceneNode &parentNode );
 	void onPostUpdate();
 
+	SceneNode *createRenderProxy() const;
+	void updateRenderProxy( SceneNode &proxy ) const;
+
 	MaterialResource *getMaterialRes() const { return _materialRes; }
 	RDIPrimType getPrimType() { return _primType; }
 	uint32 getBatchStart() const { return _batchStart; }
@@ -156,7 +159,7 @@ struct JointNodeTpl : public SceneNodeTpl
 class JointNode : public SceneNode, public IAnimatableNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 	
 	// IAnimatableNode
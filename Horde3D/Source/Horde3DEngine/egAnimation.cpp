@@ -14,6 +14,7 @@
 #include "egAnimation.h"
 #include "egModules.h"
 #include "egCom.h"
+#include "egProfiler.h"
 #include <cstring>
 #include <algorithm>
 
@@ -64,6 +65,15 @@ void AnimationResource::release()
 }
 
 
+void AnimationResource::getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const
+{
+	cpuMem = _entities.capacity() * sizeof( AnimResEntity );
+	for( size_t i = 0; i < _entities.size(); ++i )
+		cpuMem += _entities[i].frames.capacity() * sizeof( Frame );
+	gpuMem = 0;
+}
+
+
 bool AnimationResource::raiseError( const string &msg )
 {
 	// Reset
@@ -384,6 +394,8 @@ bool AnimationController::animate()
 	Quaternion nodeRotQuat;
 	Vec3f nodeTransVec, nodeScaleVec;
 	
+	H3D_PROFILE_ZONE( "AnimationController::animate" );
+
 	Timer *timer = Modules::stats().getTimer( EngineStats::AnimationTime );
 	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
 	
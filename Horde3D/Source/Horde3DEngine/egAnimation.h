@@ -64,6 +64,7 @@ public:
 	
 	void initDefault();
 	void release();
+	void getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const;
 	bool load( const char *data, int size );
 
 	int getElemCount( int elem ) const;
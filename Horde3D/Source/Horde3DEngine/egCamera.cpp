@@ -45,60 +45,38 @@ CameraNode::~CameraNode()
 {
 	_pipelineRes = 0x0;
 	_outputTex = 0x0;
-	if( _occSet >= 0 ) Modules::renderer().unregisterOccSet( _occSet );
+	if( _occSet >= 0 && !_renderProxy ) Modules::renderer().unregisterOccSet( _occSet );
 }
 
 
-SceneNodeTpl *CameraNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *CameraNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
 	CameraNodeTpl *cameraTpl = new CameraNodeTpl( "", 0x0 );
 
-	itr = attribs.find( "pipeline" );
-	if( itr != attribs.end() )
+	const char *pipeline = attribs.getString( "pipeline" );
+	if( pipeline != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Pipeline, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Pipeline, pipeline, 0, false );
 		cameraTpl->pipeRes = (PipelineResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "outputTex" );
-	if( itr != attribs.end() )
+	const char *outputTex = attribs.getString( "outputTex" );
+	if( outputTex != 0x0 )
 	{	
 		cameraTpl->outputTex = (TextureResource *)Modules::resMan().findResource(
-			ResourceTypes::Texture, itr->second );
-	}
-	itr = attribs.find( "outputBufferIndex" );
-	if( itr != attribs.end() ) cameraTpl->outputBufferIndex = atoi( itr->second.c_str() );
-	itr = attribs.find( "leftPlane" );
-	if( itr != attribs.end() ) cameraTpl->leftPlane = toFloat( itr->second.c_str() );
-	itr = attribs.find( "rightPlane" );
-	if( itr != attribs.end() ) cameraTpl->rightPlane = toFloat( itr->second.c_str() );
-	itr = attribs.find( "bottomPlane" );
-	if( itr != attribs.end() ) cameraTpl->bottomPlane = toFloat( itr->second.c_str() );
-	itr = attribs.find( "topPlane" );
-	if( itr != attribs.end() ) cameraTpl->topPlane = toFloat( itr->second.c_str() );
-	itr = attribs.find( "nearPlane" );
-	if( itr != attribs.end() ) cameraTpl->nearPlane = toFloat( itr->second.c_str() );
-	itr = attribs.find( "farPlane" );
-	if( itr != attribs.end() ) cameraTpl->farPlane = toFloat( itr->second.c_str() );
-	itr = attribs.find( "orthographic" );
-	if( itr != attribs.end() ) 
-	{
-		if ( _stricmp( itr->second.c_str(), "true" ) == 0 || _stricmp( itr->second.c_str(), "1" ) == 0 )
-			cameraTpl->orthographic = true;
-		else
-			cameraTpl->orthographic = false;
-	}
-	itr = attribs.find( "occlusionCulling" );
-	if( itr != attribs.end() ) 
-	{
-		if ( _stricmp( itr->second.c_str(), "true" ) == 0 || _stricmp( itr->second.c_str(), "1" ) == 0 )
-			cameraTpl->occlusionCulling = true;
-		else
-			cameraTpl->occlusionCulling = false;
+			ResourceTypes::Texture, outputTex );
 	}
+	attribs.getInt( "outputBufferIndex", cameraTpl->outputBufferIndex );
+	attribs.getFloat( "leftPlane", cameraTpl->leftPlane );
+	attribs.getFloat( "rightPlane", cameraTpl->rightPlane );
+	attribs.getFloat( "bottomPlane", cameraTpl->bottomPlane );
+	attribs.getFloat( "topPlane", cameraTpl->topPlane );
+	attribs.getFloat( "nearPlane", cameraTpl->nearPlane );
+	attribs.getFloat( "farPlane", cameraTpl->farPlane );
+	attribs.getBool( "orthographic", cameraTpl->orthographic );
+	attribs.getBool( "occlusionCulling", cameraTpl->occlusionCulling );
 
 	if( !result )
 	{
@@ -186,6 +164,8 @@ void CameraNode::setParamI( int param, int value )
 		markDirty();
 		return;
 	case CameraNodeParams::OccCullingI:
+		// Occlusion sets are shared with the render proxy
+		Modules::renderer().syncRenderThread();
 		if( _occSet < 0 && value != 0 )
 		{		
 			_occSet = Modules::renderer().registerOccSet();
@@ -286,6 +266,34 @@ void CameraNode::setProjectionMatrix( float* projMat )
 }
 
 
+SceneNode *CameraNode::createRenderProxy() const
+{
+	return new CameraNode( *this );
+}
+
+
+void CameraNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	SceneNode::updateRenderProxy( proxy );
+
+	CameraNode &cam = (CameraNode &)proxy;
+	cam._pipelineRes = _pipelineRes;
+	cam._outputTex = _outputTex;
+	cam._viewMat = _viewMat;
+	cam._projMat = _projMat;
+	cam._frustum = _frustum;
+	cam._absPos = _absPos;
+	cam._vpX = _vpX; cam._vpY = _vpY; cam._vpWidth = _vpWidth; cam._vpHeight = _vpHeight;
+	cam._frustLeft = _frustLeft; cam._frustRight = _frustRight;
+	cam._frustBottom = _frustBottom; cam._frustTop = _frustTop;
+	cam._frustNear = _frustNear; cam._frustFar = _frustFar;
+	cam._outputBufferIndex = _outputBufferIndex;
+	cam._occSet = _occSet;
+	cam._orthographic = _orthographic;
+	cam._manualProjMat = _manualProjMat;
+}
+
+
 void CameraNode::onPostUpdate()
 {
 	// Get position
@@ -77,7 +77,7 @@ struct CameraNodeTpl : public SceneNodeTpl
 class CameraNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	~CameraNode();
@@ -100,6 +100,9 @@ public:
 	int getViewportWidth() const { return _vpWidth; }
 	int getViewportHeight() const { return _vpHeight; }
 
+	SceneNode *createRenderProxy() const;
+	void updateRenderProxy( SceneNode &proxy ) const;
+
 private:
 	CameraNode( const CameraNodeTpl &cameraTpl );
 	void onPostUpdate();
@@ -14,8 +14,11 @@
 #include "utMath.h"
 #include "egModules.h"
 #include "egRenderer.h"
+#include "egGeometry.h"
+#include "egJobs.h"
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "utDebug.h"
 
@@ -37,11 +40,14 @@ EngineConfig::EngineConfig()
 	fastAnimation = true;
 	shadowMapSize = 1024;
 	sampleCount = 0;
+	workerThreadCount = -1;
+	texStreamingBudget = 0;
 	wireframeMode = false;
 	debugViewMode = false;
 	dumpFailedShaders = false;
 	gatherTimeStats = true;
 	debugRenderBackend = false;
+	pipelinedRendering = false;
 }
 
 
@@ -79,6 +85,12 @@ float EngineConfig::getOption( EngineOptions::List param ) const
 		return gatherTimeStats ? 1.0f : 0.0f;
 	case EngineOptions::DebugRenderBackend:
 		return debugRenderBackend ? 1.0f : 0.0f;
+	case EngineOptions::WorkerThreadCount:
+		return (float)Modules::jobs().getWorkerCount();
+	case EngineOptions::PipelinedRendering:
+		return Modules::renderer().isPipelined() ? 1.0f : 0.0f;
+	case EngineOptions::TexStreamingBudget:
+		return (float)texStreamingBudget;
 	default:
 		Modules::setError( "Invalid param for h3dGetOption" );
 		return Math::NaN;
@@ -160,6 +172,17 @@ bool EngineConfig::setOption( EngineOptions::List param, float value )
 										   Modules::renderer().getRenderDevice()->disableDebugOutput();
 		return result;
 	}
+	case EngineOptions::WorkerThreadCount:
+		workerThreadCount = ftoi_r( value );
+		Modules::jobs().setWorkerCount( workerThreadCount );
+		return true;
+	case EngineOptions::PipelinedRendering:
+		if( !Modules::renderer().setPipelinedRendering( value != 0 ) ) return false;
+		pipelinedRendering = ( value != 0 );
+		return true;
+	case EngineOptions::TexStreamingBudget:
+		texStreamingBudget = std::max( ftoi_r( value ), 0 );
+		return true;
 	default:
 		Modules::setError( "Invalid param for h3dSetOption" );
 		return false;
@@ -181,43 +204,240 @@ void EngineLog::setMessageCallback(MessageCallback f)
 
 EngineLog::EngineLog()
 {
-	_timer.setEnabled( true );
+	_startTimeNS = Timer::getTimeNS();
 	_maxNumMessages = 512;
+
+	for( uint32 i = 0; i < LogRingSize; ++i )
+	{
+		_ring[i].sequence = i;
+		_ring[i].longText = 0x0;
+	}
+	_writePos = 0;
+	_readPos = 0;
+	_ownerThread = std::this_thread::get_id();
+	_droppedMessages = 0;
+
+	for( uint32 i = 0; i < LogRateLimitSlots; ++i )
+	{
+		_rateLimits[i].hash = 0;
+		_rateLimits[i].count = 0;
+		_rateLimits[i].ready = false;
+	}
+}
+
+
+EngineLog::~EngineLog()
+{
+	drain();
+}
+
+
+bool EngineLog::checkRateLimit( int level, const char *text )
+{
+	// FNV-1a hash of message text
+	uint64 hash = 14695981039346656037ULL;
+	for( const char *c = text; *c != '\0'; ++c )
+	{
+		hash = (hash ^ (uint8)*c) * 1099511628211ULL;
+	}
+	hash = (hash == 0) ? 1 : hash;
+
+	LogRateLimitEntry &entry = _rateLimits[hash % LogRateLimitSlots];
+	uint64 curHash = entry.hash.load( std::memory_order_acquire );
+	if( curHash == 0 && entry.hash.compare_exchange_strong( curHash, hash ) )
+	{
+		entry.level = level;
+		strncpy( entry.text, text, sizeof( entry.text ) - 1 );
+		entry.text[sizeof( entry.text ) - 1] = '\0';
+		entry.ready.store( true, std::memory_order_release );
+		curHash = hash;
+	}
+
+	// Messages that collide with a different message in the table are not limited
+	if( curHash != hash ) return true;
+
+	return entry.count.fetch_add( 1 ) < LogRateLimitPerDrain;
 }
 
 
 void EngineLog::pushMessage( int level, const char *msg, va_list args )
 {
-	float time = _timer.getElapsedTimeMS() / 1000.0f;
+	float time = (float)((double)(Timer::getTimeNS() - _startTimeNS) / 1000000000.0);
 
-	vsnprintf( _textBuf, 2048, msg, args );
+	// Format on the stack of the calling thread; only long messages need an allocation
+	char textBuf[LogRecordTextSize];
+	char *longText = 0x0;
+	
+	va_list argsCopy;
+	va_copy( argsCopy, args );
+	int len = vsnprintf( textBuf, LogRecordTextSize, msg, args );
+	if( len < 0 )
+	{
+		// Encoding error; the buffer contents are undefined
+		textBuf[0] = '\0';
+		len = 0;
+	}
+	else if( len >= (int)LogRecordTextSize )
+	{
+		longText = new char[len + 1];
+		vsnprintf( longText, len + 1, msg, argsCopy );
+	}
+	va_end( argsCopy );
 
+	if( !checkRateLimit( level, longText != 0x0 ? longText : textBuf ) )
+	{
+		delete[] longText;
+		return;
+	}
+
+	// Reserve a record in the ring buffer
+	uint32 pos = _writePos.load( std::memory_order_relaxed );
+	LogRecord *rec = 0x0;
+	for( ;; )
+	{
+		rec = &_ring[pos & (LogRingSize - 1)];
+		int32 diff = (int32)(rec->sequence.load( std::memory_order_acquire ) - pos);
+
+		if( diff == 0 )
+		{
+			if( _writePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) break;
+		}
+		else if( diff < 0 )
+		{
+			// Ring is full
+			_droppedMessages.fetch_add( 1 );
+			delete[] longText;
+			return;
+		}
+		else
+		{
+			pos = _writePos.load( std::memory_order_relaxed );
+		}
+	}
+
+	rec->level = level;
+	rec->time = time;
+	rec->longText = longText;
+	if( longText == 0x0 ) memcpy( rec->text, textBuf, std::min( (uint32)len + 1, LogRecordTextSize ) );
+	rec->sequence.store( pos + 1, std::memory_order_release );
+
+	// Messages of the owner thread are published right away, so the callback and the debugger output
+	// see them when they happen. Other threads leave this to the next drain, so that the callback is
+	// never invoked from job workers.
+	if( std::this_thread::get_id() == _ownerThread && _drainMutex.try_lock() )
+	{
+		std::vector< LogMessage > notifications;
+		drainRecords( notifications );
+		_drainMutex.unlock();
+
+		notify( notifications );
+	}
+}
+
+
+void EngineLog::publishMessage( int level, float time, const char *text, std::vector< LogMessage > &notifications )
+{
 	if( _messages.size() < _maxNumMessages - 1 )
 	{
-		_messages.push( LogMessage( _textBuf, level, time ) );
+		_messages.push( LogMessage( text, level, time ) );
 	}
 	else if( _messages.size() == _maxNumMessages - 1 )
 	{
 		_messages.push( LogMessage( "Message queue is full", 1, time ) );
 	}
 
-	if (_callback) {
-		_callback(level, _textBuf);
-	}
 #if defined( H3D_DEBUGGER_OUTPUT )
-	static const char *headers[6] = { "", "  [h3d-err] ", "  [h3d-warn] ", "[h3d] ", "  [h3d-dbg] ", "[h3d- ] "};
+	notifications.push_back( LogMessage( text, level, time ) );
+#else
+	if( _callback ) notifications.push_back( LogMessage( text, level, time ) );
+#endif
+}
+
+
+void EngineLog::notify( const std::vector< LogMessage > &notifications )
+{
+	for( size_t i = 0; i < notifications.size(); ++i )
+	{
+		int level = notifications[i].level;
+		const char *text = notifications[i].text.c_str();
+
+		if (_callback) {
+			_callback(level, text);
+		}
+#if defined( H3D_DEBUGGER_OUTPUT )
+		static const char *headers[6] = { "", "  [h3d-err] ", "  [h3d-warn] ", "[h3d] ", "  [h3d-dbg] ", "[h3d- ] "};
 #if defined( PLATFORM_WIN )
-	OutputDebugStringA( headers[std::min( (uint32)level, (uint32)5 )] );
-	OutputDebugStringA( _textBuf );
-	OutputDebugString( TEXT("\r\n") );
+		OutputDebugStringA( headers[std::min( (uint32)level, (uint32)5 )] );
+		OutputDebugStringA( text );
+		OutputDebugString( TEXT("\r\n") );
 #elif defined( PLATFORM_ANDROID )
-	__android_log_print( ANDROID_LOG_DEBUG, "h3d", "%s%s\n", headers[std::min( (uint32)level, (uint32)5 )], _textBuf );
+		__android_log_print( ANDROID_LOG_DEBUG, "h3d", "%s%s\n", headers[std::min( (uint32)level, (uint32)5 )], text );
 #else
-	fputs( headers[std::min( (uint32)level, (uint32)5 )], stderr );
-	fputs( _textBuf, stderr );
-	fputs( "\n", stderr );
+		fputs( headers[std::min( (uint32)level, (uint32)5 )], stderr );
+		fputs( text, stderr );
+		fputs( "\n", stderr );
 #endif
 #endif
+	}
+}
+
+
+void EngineLog::drainRecords( std::vector< LogMessage > &notifications )
+{
+	uint32 readPos = _readPos.load( std::memory_order_relaxed );
+	for( ;; )
+	{
+		LogRecord &rec = _ring[readPos & (LogRingSize - 1)];
+		if( rec.sequence.load( std::memory_order_acquire ) != readPos + 1 ) break;
+
+		publishMessage( rec.level, rec.time, rec.longText != 0x0 ? rec.longText : rec.text, notifications );
+		delete[] rec.longText; rec.longText = 0x0;
+
+		// Release record for the next round of writers
+		rec.sequence.store( readPos + LogRingSize, std::memory_order_release );
+		_readPos.store( ++readPos, std::memory_order_relaxed );
+	}
+}
+
+
+void EngineLog::drain()
+{
+	std::vector< LogMessage > notifications;
+	std::unique_lock< std::mutex > lock( _drainMutex );
+
+	drainRecords( notifications );
+
+	float time = (float)((double)(Timer::getTimeNS() - _startTimeNS) / 1000000000.0);
+	char textBuf[256];
+	
+	uint32 dropped = _droppedMessages.exchange( 0 );
+	if( dropped > 0 )
+	{
+		snprintf( textBuf, sizeof( textBuf ), "%u log messages were dropped because the log buffer was full", dropped );
+		publishMessage( 2, time, textBuf, notifications );
+	}
+
+	// Report suppressed repetitions and reset rate limits for next period
+	for( uint32 i = 0; i < LogRateLimitSlots; ++i )
+	{
+		LogRateLimitEntry &entry = _rateLimits[i];
+		if( !entry.ready.load( std::memory_order_acquire ) ) continue;
+
+		uint32 count = entry.count.exchange( 0 );
+		if( count > LogRateLimitPerDrain )
+		{
+			snprintf( textBuf, sizeof( textBuf ), "Message repeated %u more times: %s",
+			          count - LogRateLimitPerDrain, entry.text );
+			publishMessage( entry.level, time, textBuf, notifications );
+		}
+
+		entry.ready.store( false, std::memory_order_relaxed );
+		entry.hash.store( 0, std::memory_order_release );
+	}
+
+	// Callback may reenter the log (e.g. h3dGetMessage), so it must not run under the lock
+	lock.unlock();
+	notify( notifications );
 }
 
 
@@ -267,6 +487,9 @@ void EngineLog::writeDebugInfo( const char *msg, ... )
 
 bool EngineLog::getMessage( LogMessage &msg )
 {
+	drain();
+
+	std::lock_guard< std::mutex > lock( _drainMutex );
 	if( !_messages.empty() )
 	{
 		msg = _messages.front();
@@ -288,6 +511,12 @@ StatManager::StatManager() : _fwdLightsGPUTimer( 0 ), _defLightsGPUTimer( 0 ), _
 	_statTriCount = 0;
 	_statBatchCount = 0;
 	_statLightPassCount = 0;
+	_statCulledTriCount = 0;
+	_statTexStreamResidentMem = 0;
+	_statTexStreamRequestedMem = 0;
+	_statTexStreamEvictedMem = 0;
+	_statShaderCacheHits = 0;
+	_statShaderCacheMisses = 0;
 
 	_frameTime = 0;
 }
@@ -380,6 +609,32 @@ float StatManager::getStat( int param, bool reset )
 		value = _cullingTimer.getElapsedTimeMS();
 		if ( reset ) _cullingTimer.reset();
 		return value;
+	case EngineStats::CulledTriCount:
+		value = (float)_statCulledTriCount;
+		if( reset ) _statCulledTriCount = 0;
+		return value;
+	case EngineStats::TexStreamResidentMem:
+		return ( _statTexStreamResidentMem / 1024 ) / 1024.0f;
+	case EngineStats::TexStreamRequestedMem:
+		return ( _statTexStreamRequestedMem / 1024 ) / 1024.0f;
+	case EngineStats::TexStreamEvictedMem:
+		value = ( _statTexStreamEvictedMem / 1024 ) / 1024.0f;
+		if( reset ) _statTexStreamEvictedMem = 0;
+		return value;
+	case EngineStats::ShaderCacheHits:
+		value = (float)_statShaderCacheHits;
+		if( reset ) _statShaderCacheHits = 0;
+		return value;
+	case EngineStats::ShaderCacheMisses:
+		value = (float)_statShaderCacheMisses;
+		if( reset ) _statShaderCacheMisses = 0;
+		return value;
+	case EngineStats::ShaderCompileTime:
+		value = _shaderCompileTimer.getElapsedTimeMS();
+		if( reset ) _shaderCompileTimer.reset();
+		return value;
+	case EngineStats::GeometrySharedMem:
+		return ( GeometryResource::getSharedMem() / 1024 ) / 1024.0f;
 	default:
 		Modules::setError( "Invalid param for h3dGetStat" );
 		return Math::NaN;
@@ -400,6 +655,15 @@ void StatManager::incStat( int param, float value )
 	case EngineStats::LightPassCount:
 		_statLightPassCount += ftoi_r( value );
 		break;
+	case EngineStats::CulledTriCount:
+		_statCulledTriCount += ftoi_r( value );
+		break;
+	case EngineStats::ShaderCacheHits:
+		_statShaderCacheHits += ftoi_r( value );
+		break;
+	case EngineStats::ShaderCacheMisses:
+		_statShaderCacheMisses += ftoi_r( value );
+		break;
 	case EngineStats::FrameTime:
 		_frameTime += value;
 		break;
@@ -407,6 +671,14 @@ void StatManager::incStat( int param, float value )
 }
 
 
+void StatManager::updateTexStreamingStats( uint64 residentMem, uint64 requestedMem, uint64 evictedMem )
+{
+	_statTexStreamResidentMem = residentMem;
+	_statTexStreamRequestedMem = requestedMem;
+	_statTexStreamEvictedMem += evictedMem;
+}
+
+
 Timer *StatManager::getTimer( int param )
 {
 	switch( param )
@@ -421,6 +693,8 @@ Timer *StatManager::getTimer( int param )
 		return &_particleSimTimer;
 	case EngineStats::CullingTime:
 		return &_cullingTimer;
+	case EngineStats::ShaderCompileTime:
+		return &_shaderCompileTimer;
 	default:
 		return 0x0;
 	}
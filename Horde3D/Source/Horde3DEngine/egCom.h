@@ -17,6 +17,10 @@
 #include <string>
 #include <queue>
 #include <cstdarg>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "utTimer.h"
 
 
@@ -46,7 +50,10 @@ struct EngineOptions
 		DebugViewMode,
 		DumpFailedShaders,
 		GatherTimeStats,
-		DebugRenderBackend
+		DebugRenderBackend,
+		WorkerThreadCount,
+		PipelinedRendering,
+		TexStreamingBudget
 	};
 };
 
@@ -65,6 +72,8 @@ public:
 	int   maxAnisotropy;
 	int   shadowMapSize;
 	int   sampleCount;
+	int   workerThreadCount;
+	int   texStreamingBudget;
 	bool  texCompression;
 	bool  sRGBLinearization;
 	bool  loadTextures;
@@ -75,6 +84,7 @@ public:
 	bool  dumpFailedShaders;
 	bool  gatherTimeStats;
 	bool  debugRenderBackend;
+	bool  pipelinedRendering;
 };
 
 
@@ -100,6 +110,31 @@ struct LogMessage
 
 // =================================================================================================
 
+const uint32 LogRingSize = 1024;           // Must be a power of two
+const uint32 LogRecordTextSize = 512;      // Longer messages are allocated on the heap
+const uint32 LogRateLimitSlots = 64;
+const uint32 LogRateLimitPerDrain = 16;    // Repetitions of a message that are published per drain
+
+struct LogRecord
+{
+	std::atomic< uint32 >  sequence;
+	int                    level;
+	float                  time;
+	char                   *longText;
+	char                   text[LogRecordTextSize];
+};
+
+struct LogRateLimitEntry
+{
+	std::atomic< uint64 >  hash;   // Hash of the message text, 0 if unused
+	std::atomic< uint32 >  count;
+	std::atomic< bool >    ready;  // Set when level and text are written
+	int                    level;
+	char                   text[128];
+};
+
+// =================================================================================================
+
 class EngineLog
 {
 public:
@@ -108,27 +143,46 @@ public:
 	static void setMessageCallback(MessageCallback f);
 
 	EngineLog();
+	~EngineLog();
 
+	// Writing is lock-free and can be done from any thread. Messages of the thread that created the
+	// log are published immediately; messages of other threads are published by the next drain, which
+	// the engine does once per frame, or by the next message of the creating thread.
 	void writeError( const char *msg, ... );
 	void writeWarning( const char *msg, ... );
 	void writeInfo( const char *msg, ... );
 	void writeDebugInfo( const char *msg, ... );
 
+	// Publishes written messages to the message queue, the callback and the debugger output. The
+	// callback is invoked after the internal lock is released, so it may call getMessage.
+	void drain();
+
 	bool getMessage( LogMessage &msg );
 
 	uint32 getMaxNumMessages() const { return _maxNumMessages; }
 	void setMaxNumMessages( uint32 maxNumMessages ) { _maxNumMessages = maxNumMessages; }
 	
 protected:
-	void pushMessage( const std::string &text, uint32 level );
 	void pushMessage( int level, const char *msg, va_list ap );
+	bool checkRateLimit( int level, const char *text );
+	void publishMessage( int level, float time, const char *text, std::vector< LogMessage > &notifications );
+	void drainRecords( std::vector< LogMessage > &notifications );
+	void notify( const std::vector< LogMessage > &notifications );
 
 protected:
 	static MessageCallback    _callback;
 
-	Timer                     _timer;
-	char                      _textBuf[2048];
+	uint64                    _startTimeNS;
 	uint32                    _maxNumMessages;
+
+	LogRecord                 _ring[LogRingSize];
+	std::atomic< uint32 >     _writePos;
+	std::atomic< uint32 >     _readPos;     // Only advanced while holding _drainMutex
+	std::atomic< uint32 >     _droppedMessages;
+	LogRateLimitEntry         _rateLimits[LogRateLimitSlots];
+
+	std::mutex                _drainMutex;  // Only taken by consumers
+	std::thread::id           _ownerThread; // Only this thread drains from within write calls
 	std::queue< LogMessage >  _messages;
 };
 
@@ -155,7 +209,15 @@ struct EngineStats
 		TextureVMem,
 		GeometryVMem,
 		ComputeGPUTime,
-		CullingTime
+		CullingTime,
+		CulledTriCount,
+		TexStreamResidentMem,
+		TexStreamRequestedMem,
+		TexStreamEvictedMem,
+		ShaderCacheHits,
+		ShaderCacheMisses,
+		ShaderCompileTime,
+		GeometrySharedMem
 	};
 };
 
@@ -171,19 +233,28 @@ public:
 
 	float getStat( int param, bool reset );
 	void incStat( int param, float value );
+	void updateTexStreamingStats( uint64 residentMem, uint64 requestedMem, uint64 evictedMem );
 	Timer *getTimer( int param );
 	GPUTimer *getGPUTimer( int param ) const;
 
 protected:
-	uint32    _statTriCount;
-	uint32    _statBatchCount;
-	uint32    _statLightPassCount;
+	// Incremented by the render thread when rendering is pipelined
+	std::atomic< uint32 >  _statTriCount;
+	std::atomic< uint32 >  _statBatchCount;
+	std::atomic< uint32 >  _statLightPassCount;
+	std::atomic< uint32 >  _statCulledTriCount;
+	std::atomic< uint64 >  _statTexStreamResidentMem;
+	std::atomic< uint64 >  _statTexStreamRequestedMem;
+	std::atomic< uint64 >  _statTexStreamEvictedMem;
+	std::atomic< uint32 >  _statShaderCacheHits;
+	std::atomic< uint32 >  _statShaderCacheMisses;
 
 	Timer     _frameTimer;
 	Timer     _animTimer;
 	Timer     _geoUpdateTimer;
 	Timer     _particleSimTimer;
 	Timer	  _cullingTimer;
+	Timer     _shaderCompileTimer;
 
 	float     _frameTime;
 
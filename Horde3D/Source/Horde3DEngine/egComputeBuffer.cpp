@@ -146,6 +146,7 @@ bool ComputeBufferResource::load( const char *data, int size )
 		layout.offset = atoi( node1.getAttribute( "offset", "0" ) );
 		layout.size = atoi( node1.getAttribute( "size", "0" ) );
 		layout.vbSlot = 0;
+		layout.format = VAFMT_FLOAT;
 
 		int curAttribSlot = atoi( node1.getAttribute( "attribNumber" ) );
 		if ( curAttribSlot >= 0 && curAttribSlot <= totalBindingsCount )
@@ -420,6 +421,7 @@ void ComputeBufferResource::setElemParamI( int elem, int elemIdx, int param, int
 			VertexLayoutAttrib params;
 			params.vbSlot = 0; // always zero because only one buffer can be specified at a time
 			params.offset = params.size = 0;
+			params.format = VAFMT_FLOAT;
 
 			switch ( param )
 			{
@@ -510,6 +512,7 @@ void ComputeBufferResource::setElemParamStr( int elem, int elemIdx, int param, c
 					VertexLayoutAttrib params;
 					params.vbSlot = 0; // always zero because only one buffer can be specified at a time
 					params.offset = params.size = 0;
+					params.format = VAFMT_FLOAT;
 
 					if ( _vlBindingsData.empty() || elemIdx == _vlBindingsData.size() )
 					{
@@ -610,4 +613,11 @@ void ComputeBufferResource::unmapStream()
 	_mapped = false;
 }
 
+
+void ComputeBufferResource::getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const
+{
+	cpuMem = _vlBindingsData.capacity() * sizeof( VertexLayoutAttrib );
+	gpuMem = _bufferID != 0 ? _dataSize : 0;
+}
+
 } // namespace
@@ -74,6 +74,7 @@ public:
 
 	void *mapStream( int elem, int elemIdx, int stream, bool read, bool write );
 	void unmapStream();
+	void getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const;
 
 protected:
 
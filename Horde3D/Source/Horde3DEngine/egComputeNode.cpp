@@ -42,69 +42,51 @@ ComputeNode::~ComputeNode()
 }
 
 
-SceneNodeTpl *ComputeNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *ComputeNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 
-	map< string, string >::iterator itr;
+	int value;
     ComputeNodeTpl *computeTpl = new ComputeNodeTpl( "", 0x0, 0x0, 0, 0 );
 
-	itr = attribs.find( "computeBuffer" );
-	if ( itr != attribs.end() )
+	const char *computeBuffer = attribs.getString( "computeBuffer" );
+	if ( computeBuffer != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::ComputeBuffer, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::ComputeBuffer, computeBuffer, 0, false );
 		if ( res != 0 )
 			computeTpl->compBufRes = ( ComputeBufferResource * ) Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
 
-	itr = attribs.find( "material" );
-	if ( itr != attribs.end() )
+	const char *material = attribs.getString( "material" );
+	if ( material != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, material, 0, false );
 		if ( res != 0 )
 			computeTpl->matRes = ( MaterialResource * ) Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
 
-	itr = attribs.find( "drawType" );
-	if ( itr != attribs.end() )
+	const char *drawType = attribs.getString( "drawType" );
+	if ( drawType != 0x0 )
 	{
-		if ( _stricmp( itr->second.c_str(), "triangles" ) == 0 ) computeTpl->drawType = 0; // triangles
-		else if ( _stricmp( itr->second.c_str(), "lines" ) == 0 ) computeTpl->drawType = 1; // lines
-		else if ( _stricmp( itr->second.c_str(), "points" ) == 0 ) computeTpl->drawType = 2; // points
+		if ( _stricmp( drawType, "triangles" ) == 0 ) computeTpl->drawType = 0; // triangles
+		else if ( _stricmp( drawType, "lines" ) == 0 ) computeTpl->drawType = 1; // lines
+		else if ( _stricmp( drawType, "points" ) == 0 ) computeTpl->drawType = 2; // points
 		else result = false;
 	}
 	else result = false;
 	
-	itr = attribs.find( "elementsCount" );
-	if ( itr != attribs.end() ) computeTpl->elementsCount = atoi( itr->second.c_str() );
+	if ( attribs.getInt( "elementsCount", value ) ) computeTpl->elementsCount = value;
 	else result = false;
 	
 	// AABB
-	itr = attribs.find( "aabbMinX" );
-	if ( itr != attribs.end() ) computeTpl->aabbMin.x = toFloat( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMinY" );
-	if ( itr != attribs.end() ) computeTpl->aabbMin.y = toFloat( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMinZ" );
-	if ( itr != attribs.end() ) computeTpl->aabbMin.z = toFloat( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMaxX" );
-	if ( itr != attribs.end() ) computeTpl->aabbMax.x = toFloat( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMaxY" );
-	if ( itr != attribs.end() ) computeTpl->aabbMax.y = toFloat( itr->second.c_str() );
-	else result = false;
-
-	itr = attribs.find( "aabbMaxZ" );
-	if ( itr != attribs.end() ) computeTpl->aabbMax.z = toFloat( itr->second.c_str() );
-	else result = false;
+	if ( !attribs.getFloat( "aabbMinX", computeTpl->aabbMin.x ) ) result = false;
+	if ( !attribs.getFloat( "aabbMinY", computeTpl->aabbMin.y ) ) result = false;
+	if ( !attribs.getFloat( "aabbMinZ", computeTpl->aabbMin.z ) ) result = false;
+	if ( !attribs.getFloat( "aabbMaxX", computeTpl->aabbMax.x ) ) result = false;
+	if ( !attribs.getFloat( "aabbMaxY", computeTpl->aabbMax.y ) ) result = false;
+	if ( !attribs.getFloat( "aabbMaxZ", computeTpl->aabbMax.z ) ) result = false;
 
 	if ( !result )
 	{
@@ -259,4 +241,23 @@ void ComputeNode::setParamF( int param, int compIdx, float value )
 	SceneNode::setParamF( param, compIdx, value );
 }
 
+
+SceneNode *ComputeNode::createRenderProxy() const
+{
+	return new ComputeNode( *this );
+}
+
+
+void ComputeNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	SceneNode::updateRenderProxy( proxy );
+
+	ComputeNode &compute = (ComputeNode &)proxy;
+	compute._localBBox = _localBBox;
+	compute._materialRes = _materialRes;
+	compute._compBufferRes = _compBufferRes;
+	compute._elementsCount = _elementsCount;
+	compute._drawType = _drawType;
+}
+
 } // namespace
@@ -56,7 +56,7 @@ class ComputeNode : public SceneNode
 {
 public:
 
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	void onPostUpdate();
@@ -66,6 +66,9 @@ public:
 	float getParamF( int param, int compIdx ) const;
 	void setParamF( int param, int compIdx, float value );
 
+	SceneNode *createRenderProxy() const;
+	void updateRenderProxy( SceneNode &proxy ) const;
+
 	friend class Renderer;
 	friend class SceneManager;
 
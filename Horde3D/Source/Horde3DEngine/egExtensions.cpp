@@ -46,4 +46,13 @@ bool ExtensionManager::installExtension( IExtension *extension )
 	return _extensions.back()->init();
 }
 
+
+void ExtensionManager::onFrameSnapshot()
+{
+	for( uint32 i = 0; i < _extensions.size(); ++i )
+	{
+		_extensions[i]->onFrameSnapshot();
+	}
+}
+
 }  // namespace
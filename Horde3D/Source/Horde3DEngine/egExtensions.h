@@ -31,6 +31,9 @@ public:
 	virtual const char *getName() const = 0;
 	virtual bool init() = 0;
 	virtual void release() = 0;
+	
+	// Called at the frame sync point of pipelined rendering, before the render thread starts the frame
+	virtual void onFrameSnapshot() {}
 };
 
 
@@ -45,6 +48,7 @@ public:
 	
 	bool installExtension( IExtension *extension );
 	bool checkExtension( const std::string &name ) const;
+	void onFrameSnapshot();
 
 protected:
 	std::vector< IExtension * >  _extensions;
@@ -18,6 +18,7 @@
 #include "egCom.h"
 #include "egRenderer.h"
 #include <cstring>
+#include <algorithm>
 
 #include "utDebug.h"
 
@@ -30,6 +31,7 @@ using namespace std;
 uint32 GeometryResource::defVertBuffer = 0;
 uint32 GeometryResource::defIndexBuffer = 0;
 int GeometryResource::mappedWriteStream = -1;
+size_t GeometryResource::sharedMem = 0;
 
 
 void GeometryResource::initializationFunc()
@@ -61,38 +63,35 @@ GeometryResource::~GeometryResource()
 
 Resource *GeometryResource::clone()
 {
+	// Static geometry may only be stored in GPU buffers; clones need a CPU copy of its vertex data
+	if( _vertCount > 0 && (_vertTanData == 0x0 || _vertStaticData == 0x0) && !readBackVertData() )
+	{
+		Modules::log().writeError( "Geometry resource '%s': Cannot clone geometry without CPU copy of vertex data", _name.c_str() );
+		return 0x0;
+	}
+	
 	GeometryResource *res = new GeometryResource( "", _flags );
 
 	*res = *this;
 
-	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
-
-	// TODO: Check if elemcpy_le should be used
-	// Make a deep copy of the data
-	res->_indexData = new char[_indexCount * (_16BitIndices ? 2 : 4)];
+	// Only the streams that are modified by morphing and skinning are copied; index data, static
+	// vertex data and morph targets are shared with the owner of the data until they are modified
+	GeometryResource *owner = _sharedGeoRes != 0x0 ? (GeometryResource *)_sharedGeoRes : this;
+	res->_sharedGeoRes = owner;
+	owner->_sharingClones.push_back( res );
+	res->_sharingClones.clear();
+	res->_morphTargets.clear();
+	
 	res->_vertPosData = new Vec3f[_vertCount];
 	res->_vertTanData = new VertexDataTan[_vertCount];
-	res->_vertStaticData = new VertexDataStatic[_vertCount];
-	memcpy( res->_indexData, _indexData, _indexCount * (_16BitIndices ? 2 : 4) );
 	memcpy( res->_vertPosData, _vertPosData, _vertCount * sizeof( Vec3f ) );
 	memcpy( res->_vertTanData, _vertTanData, _vertCount * sizeof( VertexDataTan ) );
-	memcpy( res->_vertStaticData, _vertStaticData, _vertCount * sizeof( VertexDataStatic ) );
 
 	res->_16BitIndices = _16BitIndices;
-	res->_geoObj = rdi->beginCreatingGeometry( Modules::renderer().getDefaultVertexLayout( DefaultVertexLayouts::Model ) );
-
-	res->_indexBuf = rdi->createIndexBuffer( _indexCount * (_16BitIndices ? 2 : 4), _indexData );
-	res->_posVBuf = rdi->createVertexBuffer( _vertCount * sizeof( Vec3f ), _vertPosData );
-	res->_tanVBuf = rdi->createVertexBuffer( _vertCount * sizeof( VertexDataTan ), _vertTanData );
-	res->_staticVBuf = rdi->createVertexBuffer( _vertCount * sizeof( VertexDataStatic ), _vertStaticData );
-
-	rdi->setGeomVertexParams( res->_geoObj, res->_posVBuf, 0, 0, sizeof( Vec3f ) );
-	rdi->setGeomVertexParams( res->_geoObj, res->_tanVBuf, 1, 0, sizeof( VertexDataTan ) );
-	rdi->setGeomVertexParams( res->_geoObj, res->_tanVBuf, 2, sizeof( Vec3f ), sizeof( VertexDataTan ) );
-	rdi->setGeomVertexParams( res->_geoObj, res->_staticVBuf, 3, 0, sizeof( VertexDataStatic ) );
-	rdi->setGeomIndexParams( res->_geoObj, res->_indexBuf, _16BitIndices ? IDXFMT_16 : IDXFMT_32 );
-
-	rdi->finishCreatingGeometry( res->_geoObj );
+	res->_clusters.clear();  // Clones are deformed by morphing or skinning, so the bounds don't apply
+	res->createGeometry( res->_vertPosData, res->_vertTanData, res->_vertStaticData );
+	
+	sharedMem += res->getSharedDataSize();
 
 	return res;
 }
@@ -107,6 +106,7 @@ void GeometryResource::initDefault()
 	_vertTanData = 0x0;
 	_vertStaticData = 0x0;
 	_16BitIndices = false;
+	_quantizedVertData = false;
 	_indexBuf = defIndexBuffer;
 	_posVBuf = defVertBuffer;
 	_tanVBuf = defVertBuffer;
@@ -122,6 +122,27 @@ void GeometryResource::release()
 {
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
+	// Shared data must not be freed by a clone; if clones of this geometry are left, the first one
+	// takes over the data, so that nothing needs to be copied
+	unshareData();
+	if( !_sharingClones.empty() )
+	{
+		GeometryResource *newOwner = _sharingClones[0];
+		sharedMem -= newOwner->getSharedDataSize();
+		
+		newOwner->_morphTargets.swap( _morphTargets );
+		newOwner->_sharingClones.assign( _sharingClones.begin() + 1, _sharingClones.end() );
+		for( size_t i = 0; i < newOwner->_sharingClones.size(); ++i )
+			newOwner->_sharingClones[i]->_sharedGeoRes = newOwner;
+		newOwner->_sharedGeoRes = 0x0;
+		
+		_sharingClones.clear();
+		_indexData = 0x0;
+		_vertStaticData = 0x0;
+		_indexBuf = 0;
+		_staticVBuf = 0;
+	}
+
 	if ( _geoObj != 0 )
 		rdi->destroyGeometry( _geoObj, false );
 
@@ -142,6 +163,7 @@ void GeometryResource::release()
 	
 	_joints.clear();
 	_morphTargets.clear();
+	_clusters.clear();
 }
 
 
@@ -175,8 +197,17 @@ bool GeometryResource::load( const char *data, int size )
 
 	uint32 version;
 	pData = elemcpy_le(&version, (uint32*)(pData), 1);
-	if( version != 5 ) return raiseError( "Unsupported version of geometry file" );
+	if( version == 5 ) return loadV5( data );
+	if( version == 6 ) return loadV6( data, size );
+	
+	return raiseError( "Unsupported version of geometry file" );
+}
+
 
+bool GeometryResource::loadV5( const char *data )
+{
+	char *pData = (char *)data + 8;
+	
 	// Load joints
 	uint32 count;
 	pData = elemcpy_le(&count, (uint32*)(pData), 1);
@@ -448,6 +479,241 @@ bool GeometryResource::load( const char *data, int size )
 		}
 	}
 
+	initMorphAndSkeletonData();
+
+	// Upload data
+	if( _vertCount > 0 && _indexCount > 0 )
+		createGeometry( _vertPosData, _vertTanData, _vertStaticData );
+	
+	return true;
+}
+
+
+bool GeometryResource::loadV6( const char *data, int size )
+{
+	// Version 6 files store the vertex data in the layout of the runtime streams, so that it can be
+	// validated and uploaded without decoding. The header is followed by an index of 16 byte
+	// aligned sections
+	ASSERT_STATIC( sizeof( VertexDataTan ) == 28 && sizeof( VertexDataStatic ) == 48 && sizeof( MorphDiff ) == 40 );
+	ASSERT_STATIC( sizeof( VertexDataTanQuantized ) == 8 && sizeof( VertexDataStaticQuantized ) == 16 );
+	ASSERT_STATIC( sizeof( GeometryCluster ) == 40 );
+	
+	const uint32 headerSize = 32, sectionEntrySize = 12;
+	if( size < (int)headerSize ) return raiseError( "Invalid geometry resource" );
+
+	uint32 header[6];
+	elemcpy_le( header, (uint32 *)(data + 8), 6 );
+	uint32 flags = header[0], jointCount = header[1], vertCount = header[2];
+	uint32 indexCount = header[3], morphTargetCount = header[4], sectionCount = header[5];
+
+	if( (uint64)headerSize + (uint64)sectionCount * sectionEntrySize > (uint64)size )
+		return raiseError( "Invalid section index" );
+
+	const char *sections[GeometrySections::Count] = { 0x0 };
+	uint32 sectionSizes[GeometrySections::Count] = { 0 };
+	for( uint32 i = 0; i < sectionCount; ++i )
+	{
+		uint32 entry[3];  // id, offset, size
+		elemcpy_le( entry, (uint32 *)(data + headerSize + i * sectionEntrySize), 3 );
+		if( entry[1] % 16 != 0 || (uint64)entry[1] + entry[2] > (uint64)size )
+			return raiseError( "Invalid section index" );
+
+		if( entry[0] < GeometrySections::Count )
+		{
+			sections[entry[0]] = data + entry[1];
+			sectionSizes[entry[0]] = entry[2];
+		}
+		else
+		{
+			Modules::log().writeWarning( "Geometry resource '%s': Ignoring unsupported section", _name.c_str() );
+		}
+	}
+
+	// Validate section sizes against the header
+	_16BitIndices = (flags & 1) != 0;
+	bool quantized = (flags & 2) != 0;
+	if( _16BitIndices && vertCount > 65536 )
+		return raiseError( "Invalid index format" );
+	// Expected sizes are computed in 64 bits, so that large counts can't wrap around to a valid size
+	if( sectionSizes[GeometrySections::Joints] != (uint64)jointCount * 16 * sizeof( float ) ||
+	    sectionSizes[GeometrySections::VertPositions] != (uint64)vertCount * sizeof( Vec3f ) ||
+	    sectionSizes[GeometrySections::VertTangents] != (uint64)vertCount *
+	        (quantized ? sizeof( VertexDataTanQuantized ) : sizeof( VertexDataTan )) ||
+	    sectionSizes[GeometrySections::VertStatic] != (uint64)vertCount *
+	        (quantized ? sizeof( VertexDataStaticQuantized ) : sizeof( VertexDataStatic )) ||
+	    sectionSizes[GeometrySections::Indices] != (uint64)indexCount * (_16BitIndices ? 2 : 4) ||
+	    sectionSizes[GeometrySections::Clusters] % sizeof( GeometryCluster ) != 0 )
+		return raiseError( "Invalid section size" );
+	
+	if( jointCount > Modules::renderer().getRenderDevice()->getCaps().maxJointCount )
+	{
+		Modules::log().writeWarning( "Geometry resource '%s': Model has more than %d joints; this may cause defective behavior", _name.c_str(),
+									  Modules::renderer().getRenderDevice()->getCaps().maxJointCount );
+	}
+
+	// Load joints
+	_joints.resize( jointCount );
+	for( uint32 i = 0; i < jointCount; ++i )
+		elemcpy_le( _joints[i].invBindMat.x, (float *)sections[GeometrySections::Joints] + i * 16, 16 );
+
+	// Load triangle indices and make sure that they are in range
+	_vertCount = vertCount;
+	_indexCount = indexCount;
+	_indexData = new char[_indexCount * (_16BitIndices ? 2 : 4)];
+	uint32 maxIndex = 0;
+	if( _16BitIndices )
+	{
+		uint16 *pIndexData = (uint16 *)_indexData;
+		elemcpy_le( pIndexData, (uint16 *)sections[GeometrySections::Indices], _indexCount );
+		for( uint32 i = 0; i < _indexCount; ++i ) maxIndex = std::max( maxIndex, (uint32)pIndexData[i] );
+	}
+	else
+	{
+		uint32 *pIndexData = (uint32 *)_indexData;
+		elemcpy_le( pIndexData, (uint32 *)sections[GeometrySections::Indices], _indexCount );
+		for( uint32 i = 0; i < _indexCount; ++i ) maxIndex = std::max( maxIndex, pIndexData[i] );
+	}
+	if( _indexCount > 0 && maxIndex >= _vertCount )
+		return raiseError( "Vertex index out of range" );
+
+	// Load morph targets
+	const char *pMorphData = sections[GeometrySections::MorphTargets];
+	const char *pMorphEnd = pMorphData + sectionSizes[GeometrySections::MorphTargets];
+	_morphTargets.resize( morphTargetCount );
+	for( uint32 i = 0; i < morphTargetCount; ++i )
+	{
+		MorphTarget &mt = _morphTargets[i];
+		char name[256];
+		uint32 diffCount;
+
+		if( pMorphData == 0x0 || pMorphEnd - pMorphData < 260 )
+			return raiseError( "Invalid morph target section" );
+		memcpy( name, pMorphData, 256 ); pMorphData += 256;
+		name[255] = '\0';
+		mt.name = name;
+		pMorphData = elemcpy_le( &diffCount, (uint32 *)pMorphData, 1 );
+
+		// Diffs are stored in the runtime layout (index, position, normal and tangent difference)
+		if( (uint64)(pMorphEnd - pMorphData) < (uint64)diffCount * sizeof( MorphDiff ) )
+			return raiseError( "Invalid morph target section" );
+		mt.diffs.resize( diffCount );
+		if( diffCount > 0 )
+			pMorphData = elemcpy_le( (uint32 *)&mt.diffs[0], (uint32 *)pMorphData, diffCount * sizeof( MorphDiff ) / 4 );
+
+		for( uint32 j = 0; j < diffCount; ++j )
+		{
+			if( mt.diffs[j].vertIndex >= _vertCount ) return raiseError( "Vertex index out of range" );
+		}
+	}
+
+	// Load clusters; they must lie within the index data and must not overlap
+	_clusters.resize( sectionSizes[GeometrySections::Clusters] / sizeof( GeometryCluster ) );
+	if( !_clusters.empty() )
+	{
+		elemcpy_le( (uint32 *)&_clusters[0], (uint32 *)sections[GeometrySections::Clusters],
+		            sectionSizes[GeometrySections::Clusters] / 4 );
+	}
+	for( uint32 i = 0; i < _clusters.size(); ++i )
+	{
+		const GeometryCluster &cl = _clusters[i];
+		if( (uint64)cl.firstIndex + cl.indexCount > _indexCount || cl.indexCount % 3 != 0 ||
+		    (i > 0 && cl.firstIndex < _clusters[i - 1].firstIndex + _clusters[i - 1].indexCount) )
+			return raiseError( "Invalid cluster section" );
+	}
+
+	// Positions are always kept on the CPU for bounding boxes and ray queries; the other streams only
+	// if they are modified by morphing or software skinning, otherwise they are uploaded directly
+	// from the resource data. Quantized streams are decoded if they are modified on the CPU or
+	// the render device can't read them
+	bool keepVertexData = morphTargetCount > 0 || jointCount > 0;
+#if defined(PLATFORM_BIG_ENDIAN)
+	keepVertexData = true;
+#endif
+	bool decodeVertexData = quantized &&
+		(keepVertexData || !Modules::renderer().getRenderDevice()->getCaps().packedVertexAttribs);
+	_quantizedVertData = quantized && !decodeVertexData;
+	
+	_vertPosData = new Vec3f[_vertCount];
+	elemcpy_le( (float *)_vertPosData, (float *)sections[GeometrySections::VertPositions], _vertCount * 3 );
+
+	if( decodeVertexData )
+	{
+		decodeQuantizedVertData( sections[GeometrySections::VertTangents], sections[GeometrySections::VertStatic] );
+	}
+	else if( keepVertexData )
+	{
+		_vertTanData = new VertexDataTan[_vertCount];
+		_vertStaticData = new VertexDataStatic[_vertCount];
+		elemcpy_le( (float *)_vertTanData, (float *)sections[GeometrySections::VertTangents],
+		            _vertCount * sizeof( VertexDataTan ) / sizeof( float ) );
+		elemcpy_le( (float *)_vertStaticData, (float *)sections[GeometrySections::VertStatic],
+		            _vertCount * sizeof( VertexDataStatic ) / sizeof( float ) );
+	}
+
+	initMorphAndSkeletonData();
+
+	// Upload data
+	bool uploadCopies = keepVertexData || decodeVertexData;
+	if( _vertCount > 0 && _indexCount > 0 )
+	{
+		createGeometry( _vertPosData,
+		                uploadCopies ? (const void *)_vertTanData : sections[GeometrySections::VertTangents],
+		                uploadCopies ? (const void *)_vertStaticData : sections[GeometrySections::VertStatic] );
+	}
+	
+	// Decoded data is only needed for the upload of static geometry
+	if( !keepVertexData )
+	{
+		delete[] _vertTanData; _vertTanData = 0x0;
+		delete[] _vertStaticData; _vertStaticData = 0x0;
+	}
+
+	return true;
+}
+
+
+static inline float unpackSNorm( uint32 packed, uint32 shift, uint32 bits )
+{
+	// Sign extend component and map to [-1, 1]
+	int32 value = (int32)(packed << (32 - shift - bits)) >> (32 - bits);
+	return std::max( value / (float)((1 << (bits - 1)) - 1), -1.0f );
+}
+
+
+void GeometryResource::decodeQuantizedVertData( const char *tanData, const char *staticData )
+{
+	_vertTanData = new VertexDataTan[_vertCount];
+	_vertStaticData = new VertexDataStatic[_vertCount];
+
+	for( uint32 i = 0; i < _vertCount; ++i )
+	{
+		uint32 packed[2];
+		elemcpy_le( packed, (uint32 *)(tanData + i * sizeof( VertexDataTanQuantized )), 2 );
+		
+		VertexDataTan &tan = _vertTanData[i];
+		tan.normal = Vec3f( unpackSNorm( packed[0], 0, 10 ), unpackSNorm( packed[0], 10, 10 ), unpackSNorm( packed[0], 20, 10 ) );
+		tan.tangent = Vec3f( unpackSNorm( packed[1], 0, 10 ), unpackSNorm( packed[1], 10, 10 ), unpackSNorm( packed[1], 20, 10 ) );
+		tan.handedness = unpackSNorm( packed[1], 30, 2 );
+
+		const char *src = staticData + i * sizeof( VertexDataStaticQuantized );
+		uint16 uv[4];
+		elemcpy_le( uv, (uint16 *)src, 2 );
+		elemcpy_le( uv + 2, (uint16 *)(src + 12), 2 );
+		
+		VertexDataStatic &st = _vertStaticData[i];
+		st.u0 = uv[0] / 65535.0f; st.v0 = uv[1] / 65535.0f;
+		st.u1 = uv[2] / 65535.0f; st.v1 = uv[3] / 65535.0f;
+		for( uint32 j = 0; j < 4; ++j )
+		{
+			st.jointVec[j] = (float)(uint8)src[4 + j];
+			st.weightVec[j] = (uint8)src[8 + j] / 255.0f;
+		}
+	}
+}
+
+
+void GeometryResource::initMorphAndSkeletonData()
+{
 	// Find min/max morph target vertex indices
 	_minMorphIndex = (unsigned)_vertCount;
 	_maxMorphIndex = 0;
@@ -481,35 +747,108 @@ bool GeometryResource::load( const char *data, int size )
 	{
 		_joints.push_back( Joint() );
 	}
+}
 
-	// Upload data
-	if( _vertCount > 0 && _indexCount > 0 )
+
+bool GeometryResource::readBackVertData()
+{
+	if( _sharedGeoRes != 0x0 || _geoObj == 0 ) return false;
+	
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+	uint32 tanSize = _vertCount * (_quantizedVertData ? sizeof( VertexDataTanQuantized ) : sizeof( VertexDataTan ));
+	uint32 staticSize = _vertCount * (_quantizedVertData ? sizeof( VertexDataStaticQuantized ) : sizeof( VertexDataStatic ));
+	std::vector< char > tanData( tanSize ), staticData( staticSize );
+
+	void *mappedData = rdi->mapBuffer( _geoObj, _tanVBuf, 0, tanSize, Read );
+	if( mappedData == 0x0 ) return false;
+	memcpy( &tanData[0], mappedData, tanSize );
+	rdi->unmapBuffer( _geoObj, _tanVBuf );
+	
+	mappedData = rdi->mapBuffer( _geoObj, _staticVBuf, 0, staticSize, Read );
+	if( mappedData == 0x0 ) return false;
+	memcpy( &staticData[0], mappedData, staticSize );
+	rdi->unmapBuffer( _geoObj, _staticVBuf );
+
+	delete[] _vertTanData; _vertTanData = 0x0;
+	delete[] _vertStaticData; _vertStaticData = 0x0;
+	if( !_quantizedVertData )
 	{
-		RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+		_vertTanData = new VertexDataTan[_vertCount];
+		_vertStaticData = new VertexDataStatic[_vertCount];
+		memcpy( _vertTanData, &tanData[0], tanSize );
+		memcpy( _vertStaticData, &staticData[0], staticSize );
+		return true;
+	}
 
-		_geoObj = rdi->beginCreatingGeometry( Modules::renderer().getDefaultVertexLayout( DefaultVertexLayouts::Model ) );
+	// Clones update their tangent stream with unpacked data and share the static stream, so
+	// quantized buffers are replaced with unpacked ones
+	decodeQuantizedVertData( &tanData[0], &staticData[0] );
+	_quantizedVertData = false;
+	
+	rdi->destroyGeometry( _geoObj, false );
+	rdi->destroyBuffer( _indexBuf );
+	rdi->destroyBuffer( _posVBuf );
+	rdi->destroyBuffer( _tanVBuf );
+	rdi->destroyBuffer( _staticVBuf );
+	createGeometry( _vertPosData, _vertTanData, _vertStaticData );
 
-		// Upload indices
-		_indexBuf = rdi->createIndexBuffer( _indexCount * (_16BitIndices ? 2 : 4), _indexData );
-		
-		// Upload vertices
-		_posVBuf = rdi->createVertexBuffer(_vertCount * sizeof( Vec3f ), _vertPosData );
-		_tanVBuf = rdi->createVertexBuffer( _vertCount * sizeof( VertexDataTan ), _vertTanData );
-		_staticVBuf = rdi->createVertexBuffer( _vertCount * sizeof( VertexDataStatic ), _vertStaticData );
+	return true;
+}
 
-		rdi->setGeomVertexParams( _geoObj, _posVBuf, 0, 0, sizeof( Vec3f ) );
-		rdi->setGeomVertexParams( _geoObj, _tanVBuf, 1, 0, sizeof( VertexDataTan ) );
-		rdi->setGeomVertexParams( _geoObj, _tanVBuf, 2, sizeof( Vec3f ), sizeof( VertexDataTan ) );
-		rdi->setGeomVertexParams( _geoObj, _staticVBuf, 3, 0, sizeof( VertexDataStatic ) );
 
-		rdi->setGeomIndexParams( _geoObj, _indexBuf, _16BitIndices ? IDXFMT_16 : IDXFMT_32 );
+void GeometryResource::createGeometry( const void *posData, const void *tanData, const void *staticData )
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
-		rdi->finishCreatingGeometry( _geoObj );
-	}
+	_geoObj = rdi->beginCreatingGeometry( Modules::renderer().getDefaultVertexLayout(
+		_quantizedVertData ? DefaultVertexLayouts::ModelQuantized : DefaultVertexLayouts::Model ) );
+
+	// Upload indices; clones use the buffers of the geometry they share the data with
+	if( _sharedGeoRes == 0x0 )
+		_indexBuf = rdi->createIndexBuffer( _indexCount * (_16BitIndices ? 2 : 4), _indexData );
 	
-	return true;
+	// Upload vertices
+	uint32 tanStride = _quantizedVertData ? sizeof( VertexDataTanQuantized ) : sizeof( VertexDataTan );
+	uint32 tangentOffset = _quantizedVertData ? sizeof( uint32 ) : sizeof( Vec3f );
+	uint32 staticStride = _quantizedVertData ? sizeof( VertexDataStaticQuantized ) : sizeof( VertexDataStatic );
+	_posVBuf = rdi->createVertexBuffer( _vertCount * sizeof( Vec3f ), posData );
+	_tanVBuf = rdi->createVertexBuffer( _vertCount * tanStride, tanData );
+	if( _sharedGeoRes == 0x0 )
+		_staticVBuf = rdi->createVertexBuffer( _vertCount * staticStride, staticData );
+
+	rdi->setGeomVertexParams( _geoObj, _posVBuf, 0, 0, sizeof( Vec3f ) );
+	rdi->setGeomVertexParams( _geoObj, _tanVBuf, 1, 0, tanStride );
+	rdi->setGeomVertexParams( _geoObj, _tanVBuf, 2, tangentOffset, tanStride );
+	rdi->setGeomVertexParams( _geoObj, _staticVBuf, 3, 0, staticStride );
+
+	rdi->setGeomIndexParams( _geoObj, _indexBuf, _16BitIndices ? IDXFMT_16 : IDXFMT_32 );
+
+	rdi->finishCreatingGeometry( _geoObj );
+}
+
+
+bool GeometryResource::getClusterRange( uint32 batchStart, uint32 batchCount, uint32 &firstCluster,
+                                        uint32 &clusterCount ) const
+{
+	// Find the clusters of a batch; they are only usable if they cover the whole batch
+	struct FirstIndexLess
+	{
+		bool operator()( const GeometryCluster &cl, uint32 index ) const { return cl.firstIndex < index; }
+	};
+	
+	std::vector< GeometryCluster >::const_iterator itr =
+		std::lower_bound( _clusters.begin(), _clusters.end(), batchStart, FirstIndexLess() );
+	
+	uint32 nextIndex = batchStart;
+	firstCluster = (uint32)(itr - _clusters.begin());
+	for( ; itr != _clusters.end() && itr->firstIndex == nextIndex && nextIndex < batchStart + batchCount; ++itr )
+		nextIndex += itr->indexCount;
+	clusterCount = (uint32)(itr - _clusters.begin()) - firstCluster;
+
+	return clusterCount > 0 && nextIndex == batchStart + batchCount;
 }
 
+
 int GeometryResource::getElemCount( int elem ) const
 {
 	switch( elem )
@@ -550,20 +889,27 @@ void *GeometryResource::mapStream( int elem, int elemIdx, int stream, bool read,
 		switch( elem )
 		{
 		case GeometryResData::GeometryElem:
+			if( write && (stream == GeometryResData::GeoIndexStream || stream == GeometryResData::GeoVertStaticStream) )
+			{
+				// Copy shared data before it is modified
+				makeDataPrivate();
+				while( !_sharingClones.empty() ) _sharingClones.back()->makeDataPrivate();
+			}
+			
 			switch( stream )
 			{
 			case GeometryResData::GeoIndexStream:
 				if( write ) mappedWriteStream = GeometryResData::GeoIndexStream;
 				return _indexData;
 			case GeometryResData::GeoVertPosStream:
-				if( write ) mappedWriteStream = GeometryResData::GeoVertPosStream;
-				return _vertPosData != 0x0 ? _vertPosData : 0x0;
+				if( write && _vertPosData != 0x0 ) mappedWriteStream = GeometryResData::GeoVertPosStream;
+				return _vertPosData;
 			case GeometryResData::GeoVertTanStream:
-				if( write ) mappedWriteStream = GeometryResData::GeoVertTanStream;
-				return _vertTanData != 0x0 ? _vertTanData : 0x0;
+				if( write && _vertTanData != 0x0 ) mappedWriteStream = GeometryResData::GeoVertTanStream;
+				return _vertTanData;
 			case GeometryResData::GeoVertStaticStream:
-				if( write ) mappedWriteStream = GeometryResData::GeoVertStaticStream;
-				return _vertStaticData != 0x0 ? _vertStaticData : 0x0;
+				if( write && _vertStaticData != 0x0 ) mappedWriteStream = GeometryResData::GeoVertStaticStream;
+				return _vertStaticData;
 			}
 		}
 	}
@@ -583,10 +929,12 @@ void GeometryResource::unmapStream()
 		case GeometryResData::GeoIndexStream:
 			if( _indexData != 0x0 )
 				rdi->updateBufferData( _geoObj, _indexBuf, 0, _indexCount * (_16BitIndices ? 2 : 4), _indexData );
+			_clusters.clear();  // Cluster bounds are no longer valid
 			break;
 		case GeometryResData::GeoVertPosStream:
 			if( _vertPosData != 0x0 )
 				rdi->updateBufferData( _geoObj, _posVBuf, 0, _vertCount * sizeof( Vec3f ), _vertPosData );
+			_clusters.clear();
 			break;
 		case GeometryResData::GeoVertTanStream:
 			if( _vertTanData != 0x0 )
@@ -603,6 +951,92 @@ void GeometryResource::unmapStream()
 }
 
 
+void GeometryResource::getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const
+{
+	size_t indexSize = (size_t)_indexCount * (_16BitIndices ? 2 : 4);
+	
+	bool shared = _sharedGeoRes != 0x0;  // Shared data is accounted to its owner
+	
+	cpuMem = _joints.capacity() * sizeof( Joint ) + _clusters.capacity() * sizeof( GeometryCluster );
+	if( _indexData != 0x0 && !shared ) cpuMem += indexSize;
+	if( _vertPosData != 0x0 ) cpuMem += _vertCount * sizeof( Vec3f );
+	if( _vertTanData != 0x0 ) cpuMem += _vertCount * sizeof( VertexDataTan );
+	if( _vertStaticData != 0x0 && !shared ) cpuMem += _vertCount * sizeof( VertexDataStatic );
+	for( size_t i = 0; i < _morphTargets.size(); ++i )
+		cpuMem += _morphTargets[i].diffs.capacity() * sizeof( MorphDiff );
+
+	gpuMem = 0;
+	if( _geoObj != 0 )
+	{
+		size_t tanStride = _quantizedVertData ? sizeof( VertexDataTanQuantized ) : sizeof( VertexDataTan );
+		size_t staticStride = _quantizedVertData ? sizeof( VertexDataStaticQuantized ) : sizeof( VertexDataStatic );
+		gpuMem = _vertCount * (sizeof( Vec3f ) + tanStride);
+		if( !shared ) gpuMem += indexSize + _vertCount * staticStride;
+	}
+}
+
+
+size_t GeometryResource::getSharedDataSize() const
+{
+	if( _sharedGeoRes == 0x0 ) return 0;
+
+	// GPU buffers are always shared, CPU copies only if the geometry keeps them
+	size_t indexSize = (size_t)_indexCount * (_16BitIndices ? 2 : 4);
+	size_t staticStride = _quantizedVertData ? sizeof( VertexDataStaticQuantized ) : sizeof( VertexDataStatic );
+	size_t size = indexSize + _vertCount * staticStride;
+	if( _indexData != 0x0 ) size += indexSize;
+	if( _vertStaticData != 0x0 ) size += _vertCount * sizeof( VertexDataStatic );
+	for( size_t i = 0; i < _sharedGeoRes->_morphTargets.size(); ++i )
+		size += _sharedGeoRes->_morphTargets[i].diffs.size() * sizeof( MorphDiff );
+
+	return size;
+}
+
+
+void GeometryResource::makeDataPrivate()
+{
+	if( _sharedGeoRes == 0x0 ) return;
+
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+	
+	// Copy shared data
+	uint32 indexSize = _indexCount * (_16BitIndices ? 2 : 4);
+	char *indexData = new char[indexSize];
+	VertexDataStatic *staticData = new VertexDataStatic[_vertCount];
+	memcpy( indexData, _indexData, indexSize );
+	memcpy( staticData, _vertStaticData, _vertCount * sizeof( VertexDataStatic ) );
+	_morphTargets = _sharedGeoRes->_morphTargets;
+	
+	unshareData();
+	_indexData = indexData;
+	_vertStaticData = staticData;
+	
+	// Recreate geometry with own buffers
+	if( _geoObj != 0 ) rdi->destroyGeometry( _geoObj, false );
+	if( _posVBuf != 0 && _posVBuf != defVertBuffer ) rdi->destroyBuffer( _posVBuf );
+	if( _tanVBuf != 0 && _tanVBuf != defVertBuffer ) rdi->destroyBuffer( _tanVBuf );
+	createGeometry( _vertPosData, _vertTanData, _vertStaticData );
+}
+
+
+void GeometryResource::unshareData()
+{
+	if( _sharedGeoRes == 0x0 ) return;
+
+	sharedMem -= getSharedDataSize();
+	
+	std::vector< GeometryResource * > &clones = _sharedGeoRes->_sharingClones;
+	clones.erase( std::find( clones.begin(), clones.end(), this ) );
+	
+	// Shared data is owned by the source geometry
+	_indexData = 0x0;
+	_vertStaticData = 0x0;
+	_indexBuf = 0;
+	_staticVBuf = 0;
+	_sharedGeoRes = 0x0;
+}
+
+
 void GeometryResource::updateDynamicVertData()
 {
 	// Upload dynamic stream data
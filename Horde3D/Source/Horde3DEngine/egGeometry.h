@@ -42,6 +42,23 @@ struct GeometryResData
 
 // =================================================================================================
 
+struct GeometrySections		// Sections of version 6 geometry files
+{
+	enum List
+	{
+		Joints = 0,
+		VertPositions,
+		VertTangents,
+		VertStatic,
+		Indices,
+		MorphTargets,
+		Clusters,
+		Count
+	};
+};
+
+// =================================================================================================
+
 struct VertexDataTan
 {
 	Vec3f  normal;
@@ -58,6 +75,21 @@ struct VertexDataStatic		// Vertex data that is usally static
 };
 
 
+struct VertexDataTanQuantized	// Signed normalized 10_10_10_2, handedness in w of tangent
+{
+	uint32  normal;
+	uint32  tangent;
+};
+
+struct VertexDataStaticQuantized
+{
+	uint16  u0, v0;				// Unsigned normalized
+	uint8   jointVec[4];
+	uint8   weightVec[4];		// Unsigned normalized
+	uint16  u1, v1;				// Unsigned normalized
+};
+
+
 struct Joint
 {
 	Matrix4f  invBindMat;
@@ -78,6 +110,16 @@ struct MorphTarget
 	std::vector< MorphDiff >  diffs;
 };
 
+
+struct GeometryCluster		// Consecutive triangles of a batch with bounds in model space
+{
+	uint32  firstIndex, indexCount;
+	Vec3f   center;
+	float   radius;
+	Vec3f   coneAxis;
+	float   coneCutoff;		// Smallest cosine between axis and triangle normals
+};
+
 // =================================================================================================
 
 class GeometryResource : public Resource
@@ -100,6 +142,7 @@ public:
 	int getElemParamI( int elem, int elemIdx, int param ) const;
 	void *mapStream( int elem, int elemIdx, int stream, bool read, bool write );
 	void unmapStream();
+	void getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const;
 
 	void updateDynamicVertData();
 
@@ -114,21 +157,38 @@ public:
 	uint32 getStaticVBuf() const { return _staticVBuf; }
 	uint32 getIndexBuf() const { return _indexBuf; }
 	Matrix4f &getInvBindMat( uint32 jointIndex ) { return _joints[jointIndex].invBindMat; }
+	const std::vector< MorphTarget > &getMorphTargets() const
+		{ return _sharedGeoRes != 0x0 ? _sharedGeoRes->_morphTargets : _morphTargets; }
+	bool getClusterRange( uint32 batchStart, uint32 batchCount, uint32 &firstCluster, uint32 &clusterCount ) const;
+	const GeometryCluster *getClusters() const { return _clusters.empty() ? 0x0 : &_clusters[0]; }
+
+	static size_t getSharedMem() { return sharedMem; }
 
 public:
 	static uint32 defVertBuffer, defIndexBuffer;
 
 private:
 	bool raiseError( const std::string &msg );
+	bool loadV5( const char *data );
+	bool loadV6( const char *data, int size );
+	void initMorphAndSkeletonData();
+	void decodeQuantizedVertData( const char *tanData, const char *staticData );
+	bool readBackVertData();
+	void createGeometry( const void *posData, const void *tanData, const void *staticData );
+	size_t getSharedDataSize() const;
+	void makeDataPrivate();
+	void unshareData();
 
 private:
 	static int                  mappedWriteStream;
+	static size_t               sharedMem;  // Memory saved by clones sharing data with their source geometry
 	
 	uint32                      _indexBuf, _posVBuf, _tanVBuf, _staticVBuf;
 	uint32						_geoObj;
 
 	uint32                      _indexCount, _vertCount;
 	bool                        _16BitIndices;
+	bool                        _quantizedVertData;  // GPU buffers use the quantized model layout
 	char                        *_indexData;
 	Vec3f                       *_vertPosData;
 	VertexDataTan               *_vertTanData;
@@ -138,6 +198,12 @@ private:
 	BoundingBox                 _skelAABB;
 	std::vector< MorphTarget >  _morphTargets;
 	uint32                      _minMorphIndex, _maxMorphIndex;
+	std::vector< GeometryCluster >  _clusters;  // Sorted by first index
+
+	// Clones share the index data, static vertex data and morph targets with the geometry they were
+	// cloned from until one of them modifies the data (copy-on-write)
+	SmartResPtr< GeometryResource >    _sharedGeoRes;  // Owner of the shared data, NULL if data is owned
+	std::vector< GeometryResource * >  _sharingClones;  // Clones that share the data of this geometry
 
 	friend class Renderer;
 	friend class ModelNode;
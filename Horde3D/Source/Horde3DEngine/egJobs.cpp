@@ -0,0 +1,338 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "egJobs.h"
+#include "egModules.h"
+#include "egProfiler.h"
+#include <cstdio>
+
+#include "utDebug.h"
+
+
+namespace Horde3D {
+
+using namespace std;
+
+// Index of the queue owned by the current thread; all threads that are not workers share queue 0
+static thread_local uint32 _curQueueIndex = 0;
+
+
+// *************************************************************************************************
+// Class JobQueue
+// *************************************************************************************************
+
+void JobQueue::push( Job *job )
+{
+	lock_guard< mutex > lock( _mutex );
+	_jobs.push_back( job );
+}
+
+
+Job *JobQueue::pop()
+{
+	lock_guard< mutex > lock( _mutex );
+	if( _jobs.empty() ) return 0x0;
+
+	Job *job = _jobs.back();
+	_jobs.pop_back();
+	return job;
+}
+
+
+Job *JobQueue::steal()
+{
+	lock_guard< mutex > lock( _mutex );
+	if( _jobs.empty() ) return 0x0;
+
+	Job *job = _jobs.front();
+	_jobs.pop_front();
+	return job;
+}
+
+
+// *************************************************************************************************
+// Class JobManager
+// *************************************************************************************************
+
+JobManager::JobManager() : _queuedJobs( 0 ), _shutdown( false ), _extDispatchFunc( 0x0 ), _extUserData( 0x0 )
+{
+	_queues.push_back( new JobQueue() );
+}
+
+
+JobManager::~JobManager()
+{
+	stopWorkers();
+
+	for( size_t i = 0; i < _queues.size(); ++i ) delete _queues[i];
+	_queues.clear();
+}
+
+
+void JobManager::setWorkerCount( int count )
+{
+	if( count < 0 )
+	{
+		// Leave one hardware thread for the application thread
+		count = (int)thread::hardware_concurrency() - 1;
+	}
+	count = std::max( std::min( count, H3D_MAX_WORKER_THREADS ), 0 );
+
+	// Worker threads are not used when the application provides its own scheduler
+	if( _extDispatchFunc != 0x0 ) count = 0;
+
+	if( count == (int)_workers.size() ) return;
+
+	stopWorkers();
+	startWorkers( count );
+}
+
+
+void JobManager::setExternalScheduler( ExternalJobDispatchFunc dispatchFunc, void *userData )
+{
+	int prevCount = getWorkerCount();
+
+	stopWorkers();
+	_extDispatchFunc = dispatchFunc;
+	_extUserData = userData;
+
+	if( dispatchFunc == 0x0 ) startWorkers( prevCount > 0 ? prevCount : (int)thread::hardware_concurrency() - 1 );
+}
+
+
+void JobManager::startWorkers( int count )
+{
+	_shutdown = false;
+
+	// All queues must exist before the first worker starts, workers read the queue list without lock
+	for( int i = 0; i < count; ++i ) _queues.push_back( new JobQueue() );
+	for( int i = 0; i < count; ++i ) _workers.push_back( thread( &JobManager::workerLoop, this, (uint32)i + 1 ) );
+}
+
+
+void JobManager::stopWorkers()
+{
+	{
+		lock_guard< mutex > lock( _sleepMutex );
+		_shutdown = true;
+	}
+	_sleepCond.notify_all();
+
+	for( size_t i = 0; i < _workers.size(); ++i ) _workers[i].join();
+	_workers.clear();
+
+	// Move jobs that are left over to the shared queue
+	for( size_t i = 1; i < _queues.size(); ++i )
+	{
+		while( Job *job = _queues[i]->steal() ) _queues[0]->push( job );
+		delete _queues[i];
+	}
+	_queues.resize( 1 );
+}
+
+
+void JobManager::workerLoop( uint32 queueIndex )
+{
+	_curQueueIndex = queueIndex;
+
+	char name[32];
+	snprintf( name, sizeof( name ), "Worker %u", queueIndex );
+	Profiler::setThreadName( name );
+
+	while( !_shutdown.load( memory_order_relaxed ) )
+	{
+		Job *job = fetchJob( queueIndex );
+
+		// Spin shortly before going to sleep, jobs are often pushed in bursts
+		for( uint32 i = 0; job == 0x0 && i < 64; ++i )
+		{
+			this_thread::yield();
+			job = fetchJob( queueIndex );
+		}
+
+		if( job != 0x0 )
+		{
+			execute( job );
+		}
+		else
+		{
+			unique_lock< mutex > lock( _sleepMutex );
+			_sleepCond.wait( lock, [this]() { return _queuedJobs.load() > 0 || _shutdown.load(); } );
+		}
+	}
+}
+
+
+JobHandle JobManager::createJob( const function< void() > &func, JobHandle parent )
+{
+	Job *job = new Job();
+	job->func = func;
+	job->parent = parent;
+	job->unfinished = 1;
+	job->pendingDeps = 1;
+	job->refCount = 2;  // Handle of the caller and scheduling reference
+	job->finished = false;
+
+	if( parent != 0x0 ) parent->unfinished.fetch_add( 1 );
+
+	return job;
+}
+
+
+void JobManager::addDependency( JobHandle job, JobHandle dependency )
+{
+	ASSERT( job != dependency );
+
+	lock_guard< mutex > lock( dependency->contMutex );
+	if( !dependency->finished.load( memory_order_acquire ) )
+	{
+		job->pendingDeps.fetch_add( 1 );
+		dependency->continuations.push_back( job );
+	}
+}
+
+
+void JobManager::submit( JobHandle job )
+{
+	if( job->pendingDeps.fetch_sub( 1 ) == 1 ) enqueue( job );
+}
+
+
+void JobManager::wait( JobHandle job )
+{
+	while( !job->finished.load( memory_order_acquire ) )
+	{
+		Job *other = _extDispatchFunc == 0x0 ? fetchJob( _curQueueIndex ) : 0x0;
+
+		if( other != 0x0 ) execute( other );
+		else this_thread::yield();
+	}
+
+	release( job );
+}
+
+
+void JobManager::release( JobHandle job )
+{
+	releaseRef( job );
+}
+
+
+void JobManager::parallelFor( uint32 count, uint32 grainSize, const function< void( uint32, uint32 ) > &func )
+{
+	if( count == 0 ) return;
+	if( grainSize == 0 ) grainSize = 1;
+
+	uint32 numThreads = (uint32)_workers.size() + 1;
+	if( (numThreads == 1 && _extDispatchFunc == 0x0) || count <= grainSize )
+	{
+		func( 0, count );
+		return;
+	}
+
+	// Use a few more ranges than threads so that stealing can balance uneven workloads
+	uint32 numRanges = std::min( (count + grainSize - 1) / grainSize, numThreads * 4 );
+	uint32 rangeSize = (count + numRanges - 1) / numRanges;
+
+	JobHandle root = createJob( function< void() >() );
+	for( uint32 begin = 0; begin < count; begin += rangeSize )
+	{
+		uint32 end = std::min( begin + rangeSize, count );
+		JobHandle job = createJob( [&func, begin, end]() { func( begin, end ); }, root );
+		submit( job );
+		release( job );
+	}
+	submit( root );
+	wait( root );
+}
+
+
+void JobManager::enqueue( Job *job )
+{
+	if( _extDispatchFunc != 0x0 )
+	{
+		_extDispatchFunc( executeExternal, job, _extUserData );
+		return;
+	}
+
+	uint32 queueIndex = _curQueueIndex < _queues.size() ? _curQueueIndex : 0;
+	_queues[queueIndex]->push( job );
+	_queuedJobs.fetch_add( 1 );
+
+	if( !_workers.empty() )
+	{
+		// Lock guarantees that a worker checking the sleep condition does not miss the notification
+		{ lock_guard< mutex > lock( _sleepMutex ); }
+		_sleepCond.notify_one();
+	}
+}
+
+
+Job *JobManager::fetchJob( uint32 queueIndex )
+{
+	if( _queuedJobs.load( memory_order_relaxed ) <= 0 ) return 0x0;
+
+	Job *job = _queues[queueIndex]->pop();
+
+	// Steal from other queues, starting with the neighbor to spread thieves
+	for( size_t i = 1, s = _queues.size(); job == 0x0 && i < s; ++i )
+	{
+		job = _queues[(queueIndex + i) % s]->steal();
+	}
+
+	if( job != 0x0 ) _queuedJobs.fetch_sub( 1 );
+
+	return job;
+}
+
+
+void JobManager::execute( Job *job )
+{
+	if( job->func ) job->func();
+
+	if( job->unfinished.fetch_sub( 1 ) == 1 ) finish( job );
+}
+
+
+void JobManager::finish( Job *job )
+{
+	vector< Job * > continuations;
+	{
+		lock_guard< mutex > lock( job->contMutex );
+		job->finished.store( true, memory_order_release );
+		continuations.swap( job->continuations );
+	}
+
+	for( size_t i = 0; i < continuations.size(); ++i )
+	{
+		if( continuations[i]->pendingDeps.fetch_sub( 1 ) == 1 ) enqueue( continuations[i] );
+	}
+
+	Job *parent = job->parent;
+	releaseRef( job );
+
+	if( parent != 0x0 && parent->unfinished.fetch_sub( 1 ) == 1 ) finish( parent );
+}
+
+
+void JobManager::releaseRef( Job *job )
+{
+	if( job->refCount.fetch_sub( 1 ) == 1 ) delete job;
+}
+
+
+void JobManager::executeExternal( void *jobData )
+{
+	Modules::jobs().execute( (Job *)jobData );
+}
+
+}  // namespace
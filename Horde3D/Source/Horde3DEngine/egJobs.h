@@ -0,0 +1,116 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _egJobs_H_
+#define _egJobs_H_
+
+#include "egPrerequisites.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <functional>
+
+
+namespace Horde3D {
+
+// =================================================================================================
+// Job Manager
+// =================================================================================================
+
+typedef void (*ExternalJobExecuteFunc)( void *jobData );
+typedef void (*ExternalJobDispatchFunc)( ExternalJobExecuteFunc executeFunc, void *jobData, void *userData );
+
+struct Job
+{
+	std::function< void() >  func;
+	Job                      *parent;
+	std::vector< Job * >     continuations;  // Jobs that depend on this one
+	std::mutex               contMutex;
+	std::atomic< int32 >     unfinished;     // Job itself plus unfinished children
+	std::atomic< int32 >     pendingDeps;    // Unfinished dependencies plus one until submitted
+	std::atomic< int32 >     refCount;
+	std::atomic< bool >      finished;
+};
+
+typedef Job *JobHandle;
+
+// =================================================================================================
+
+class JobQueue
+{
+public:
+	void push( Job *job );
+	Job *pop();    // Owner side (LIFO)
+	Job *steal();  // Thief side (FIFO)
+
+private:
+	std::mutex           _mutex;
+	std::deque< Job * >  _jobs;
+};
+
+// =================================================================================================
+
+class JobManager
+{
+public:
+	JobManager();
+	~JobManager();
+
+	void setWorkerCount( int count );  // Negative value selects count based on hardware threads
+	int getWorkerCount() const { return (int)_workers.size(); }
+
+	void setExternalScheduler( ExternalJobDispatchFunc dispatchFunc, void *userData );
+
+	// Jobs are executed after submission and once all dependencies are finished. A job with a parent
+	// keeps the parent unfinished until it has finished itself. The handle stays valid until wait or
+	// release is called for it.
+	JobHandle createJob( const std::function< void() > &func, JobHandle parent = 0x0 );
+	void addDependency( JobHandle job, JobHandle dependency );
+	void submit( JobHandle job );
+	bool isFinished( JobHandle job ) const { return job->finished.load( std::memory_order_acquire ); }
+	void wait( JobHandle job );  // Calling thread executes pending jobs while waiting
+	void release( JobHandle job );
+
+	// Splits [0, count) into ranges of at least grainSize elements and blocks until all are processed
+	void parallelFor( uint32 count, uint32 grainSize, const std::function< void( uint32, uint32 ) > &func );
+
+private:
+	void startWorkers( int count );
+	void stopWorkers();
+	void workerLoop( uint32 queueIndex );
+
+	void enqueue( Job *job );
+	Job *fetchJob( uint32 queueIndex );
+	void execute( Job *job );
+	void finish( Job *job );
+	void releaseRef( Job *job );
+
+	static void executeExternal( void *jobData );
+
+private:
+	std::vector< std::thread >  _workers;
+	std::vector< JobQueue * >   _queues;  // Queue 0 is shared by all non-worker threads
+
+	std::mutex                  _sleepMutex;
+	std::condition_variable     _sleepCond;
+	std::atomic< int32 >        _queuedJobs;
+	std::atomic< bool >         _shutdown;
+
+	ExternalJobDispatchFunc     _extDispatchFunc;
+	void                        *_extUserData;
+};
+
+}
+#endif // _egJobs_H_
@@ -29,6 +29,8 @@ LightNode::LightNode( const LightNodeTpl &lightTpl ) :
 	_materialRes = lightTpl.matRes;
 	_lightingContext = lightTpl.lightingContext;
 	_shadowContext = lightTpl.shadowContext;
+	_lightingContextId = ShaderResource::getContextId( _lightingContext );
+	_shadowContextId = ShaderResource::getContextId( _shadowContext );
 	_radius = lightTpl.radius; _fov = lightTpl.fov;
 	_diffuseCol = Vec3f( lightTpl.col_R, lightTpl.col_G, lightTpl.col_B );
 	_diffuseColMult = lightTpl.colMult;
@@ -49,49 +51,44 @@ LightNode::~LightNode()
 	for( uint32 i = 0; i < _occQueries.size(); ++i )
 	{
 		if( _occQueries[i] != 0 )
+		{
+			// Nodes and render proxies are deleted on the application thread
+			Modules::renderer().acquireRenderContext();
 			rdi->destroyQuery( _occQueries[i] );
+		}
 	}
 }
 
 
-SceneNodeTpl *LightNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *LightNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
+	int value;
 	LightNodeTpl *lightTpl = new LightNodeTpl( "", 0x0, "", "" );
 
-	itr = attribs.find( "material" );
-	if( itr != attribs.end() )
+	const char *material = attribs.getString( "material" );
+	if( material != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, material, 0, false );
 		if( res != 0 )
 			lightTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
 	}
-	itr = attribs.find( "lightingContext" );
-	if( itr != attribs.end() ) lightTpl->lightingContext = itr->second;
+	const char *lightingContext = attribs.getString( "lightingContext" );
+	if( lightingContext != 0x0 ) lightTpl->lightingContext = lightingContext;
 	else result = false;
-	itr = attribs.find( "shadowContext" );
-	if( itr != attribs.end() ) lightTpl->shadowContext = itr->second;
+	const char *shadowContext = attribs.getString( "shadowContext" );
+	if( shadowContext != 0x0 ) lightTpl->shadowContext = shadowContext;
 	else result = false;
-	itr = attribs.find( "radius" );
-	if( itr != attribs.end() ) lightTpl->radius = toFloat( itr->second.c_str() );
-	itr = attribs.find( "fov" );
-	if( itr != attribs.end() ) lightTpl->fov = toFloat( itr->second.c_str() );
-	itr = attribs.find( "col_R" );
-	if( itr != attribs.end() ) lightTpl->col_R = toFloat( itr->second.c_str() );
-	itr = attribs.find( "col_G" );
-	if( itr != attribs.end() ) lightTpl->col_G = toFloat( itr->second.c_str() );
-	itr = attribs.find( "col_B" );
-	if( itr != attribs.end() ) lightTpl->col_B = toFloat( itr->second.c_str() );
-	itr = attribs.find( "colMult" );
-	if( itr != attribs.end() ) lightTpl->colMult = toFloat( itr->second.c_str() );
-	itr = attribs.find( "shadowMapCount" );
-	if( itr != attribs.end() ) lightTpl->shadowMapCount = atoi( itr->second.c_str() );
-	itr = attribs.find( "shadowSplitLambda" );
-	if( itr != attribs.end() ) lightTpl->shadowSplitLambda = toFloat( itr->second.c_str() );
-	itr = attribs.find( "shadowMapBias" );
-	if( itr != attribs.end() ) lightTpl->shadowMapBias = toFloat( itr->second.c_str() );
+	attribs.getFloat( "radius", lightTpl->radius );
+	attribs.getFloat( "fov", lightTpl->fov );
+	attribs.getFloat( "col_R", lightTpl->col_R );
+	attribs.getFloat( "col_G", lightTpl->col_G );
+	attribs.getFloat( "col_B", lightTpl->col_B );
+	attribs.getFloat( "colMult", lightTpl->colMult );
+	if( attribs.getInt( "shadowMapCount", value ) ) lightTpl->shadowMapCount = value;
+	attribs.getFloat( "shadowSplitLambda", lightTpl->shadowSplitLambda );
+	attribs.getFloat( "shadowMapBias", lightTpl->shadowMapBias );
 	
 	if( !result )
 	{
@@ -227,9 +224,11 @@ void LightNode::setParamStr( int param, const char *value )
 	{
 	case LightNodeParams::LightingContextStr:
 		_lightingContext = value;
+		_lightingContextId = ShaderResource::getContextId( _lightingContext );
 		return;
 	case LightNodeParams::ShadowContextStr:
 		_shadowContext = value;
+		_shadowContextId = ShaderResource::getContextId( _shadowContext );
 		return;
 	}
 
@@ -313,6 +312,36 @@ void LightNode::calcScreenSpaceAABB( const Matrix4f &mat, float &x, float &y, fl
 }
 
 
+SceneNode *LightNode::createRenderProxy() const
+{
+	return new LightNode( *this );
+}
+
+
+void LightNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	SceneNode::updateRenderProxy( proxy );
+	
+	LightNode &light = (LightNode &)proxy;
+	light._frustum = _frustum;
+	light._viewMat = _viewMat;
+	light._absPos = _absPos;
+	light._spotDir = _spotDir;
+	light._materialRes = _materialRes;
+	light._lightingContext = _lightingContext;
+	light._shadowContext = _shadowContext;
+	light._lightingContextId = _lightingContextId;
+	light._shadowContextId = _shadowContextId;
+	light._radius = _radius;
+	light._fov = _fov;
+	light._diffuseCol = _diffuseCol;
+	light._diffuseColMult = _diffuseColMult;
+	light._shadowMapCount = _shadowMapCount;
+	light._shadowSplitLambda = _shadowSplitLambda;
+	light._shadowMapBias = _shadowMapBias;
+}
+
+
 void LightNode::onPostUpdate()
 {
 	// Calculate view matrix
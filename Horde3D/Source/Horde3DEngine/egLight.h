@@ -68,7 +68,7 @@ struct LightNodeTpl : public SceneNodeTpl
 class LightNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map<std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 	
 	int getParamI( int param ) const;
@@ -83,6 +83,9 @@ public:
 	const Frustum &getFrustum() const { return _frustum; }
 	const Matrix4f &getViewMat() const { return _viewMat; }
 
+	SceneNode *createRenderProxy() const;
+	void updateRenderProxy( SceneNode &proxy ) const;
+
 private:
 	LightNode( const LightNodeTpl &lightTpl );
 	~LightNode();
@@ -96,6 +99,7 @@ private:
 
 	PMaterialResource      _materialRes;
 	std::string            _lightingContext, _shadowContext;
+	int                    _lightingContextId, _shadowContextId;  // Global ids of the context names
 	float                  _radius, _fov;
 	Vec3f                  _diffuseCol;
 	float                  _diffuseColMult;
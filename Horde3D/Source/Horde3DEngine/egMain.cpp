@@ -21,6 +21,10 @@
 #include "egTexture.h"
 #include "egComputeBuffer.h"
 #include "egComputeNode.h"
+#include "egProfiler.h"
+#include "egJobs.h"
+#include <algorithm>
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <string>
@@ -132,6 +136,7 @@ H3D_IMPL void h3dCompute( int materialRes, const char *context, int groupX, int
 		return;
 	}
 
+	Modules::renderer().acquireRenderContext();
 	Modules::renderer().dispatchCompute( ( MaterialResource * ) res, safeStr( context, 0 ), groupX, groupY, groupZ );
 }
 
@@ -141,7 +146,10 @@ H3D_IMPL void h3dRender( NodeHandle cameraNode )
 	SceneNode *sn = Modules::sceneMan().resolveNodeHandle( cameraNode );
 	APIFUNC_VALIDATE_NODE_TYPE( sn, SceneNodeTypes::Camera, "h3dRender", APIFUNC_RET_VOID );
 	
-	Modules::renderer().render( (CameraNode *)sn );
+	if( Modules::renderer().isPipelined() )
+		Modules::renderer().queueRender( (CameraNode *)sn );
+	else
+		Modules::renderer().render( (CameraNode *)sn );
 }
 
 
@@ -153,7 +161,10 @@ H3D_IMPL void h3dFinalizeFrame()
 
 H3D_IMPL void h3dClear()
 {
+	Modules::renderer().acquireRenderContext();
 	Modules::sceneMan().removeNode( Modules::sceneMan().getRootNode() );
+	// Render proxies of the removed nodes still reference resources
+	Modules::sceneMan().updateRenderProxies();
 	Modules::resMan().clear();
 	MaterialClassCollection::clear();
 }
@@ -193,10 +204,17 @@ H3D_IMPL float h3dGetOption( EngineOptions::List param )
 
 H3D_IMPL bool h3dSetOption( EngineOptions::List param, float value )
 {
+	Modules::renderer().acquireRenderContext();
 	return Modules::config().setOption( param, value );
 }
 
 
+H3D_IMPL void h3dSetRenderThreadCallback( void (*callback)( int event, void *userData ), void *userData )
+{
+	Modules::renderer().setRenderThreadCallback( callback, userData );
+}
+
+
 H3D_IMPL float h3dGetStat( EngineStats::List param, bool reset )
 {
 	return Modules::stats().getStat( param, reset );
@@ -209,6 +227,32 @@ H3D_IMPL float h3dGetDeviceCapabilities( RenderDeviceCapabilities::List param )
 }
 
 
+H3D_IMPL void h3dBeginProfileCapture()
+{
+	Profiler::setThreadName( "Main" );
+	Profiler::beginCapture();
+}
+
+
+H3D_IMPL bool h3dEndProfileCapture( const char *fileName )
+{
+	if( fileName == 0x0 || *fileName == '\0' )
+	{
+		Modules::setError( "Invalid file name in h3dEndProfileCapture" );
+		return false;
+	}
+
+	return Profiler::endCapture( fileName );
+}
+
+
+H3D_IMPL void h3dSetJobScheduler( void (*dispatchFunc)( void (*jobFunc)( void *jobData ), void *jobData, void *userData ),
+                                  void *userData )
+{
+	Modules::jobs().setExternalScheduler( dispatchFunc, userData );
+}
+
+
 // =================================================================================================
 // Resource functions
 // =================================================================================================
@@ -255,6 +299,7 @@ H3D_IMPL ResHandle h3dAddResource( int type, const char *name, int flags )
 
 H3D_IMPL ResHandle h3dCloneResource( ResHandle sourceRes, const char *name )
 {
+	Modules::renderer().acquireRenderContext();
 	Resource *resObj = Modules::resMan().resolveResHandle( sourceRes );
 	APIFUNC_VALIDATE_RES( resObj, "h3dCloneResource", 0 );
 	
@@ -264,6 +309,7 @@ H3D_IMPL ResHandle h3dCloneResource( ResHandle sourceRes, const char *name )
 
 H3D_IMPL int h3dRemoveResource( ResHandle res )
 {
+	Modules::renderer().syncRenderThread();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dRemoveResource", -1 );
 	
@@ -282,6 +328,7 @@ H3D_IMPL bool h3dIsResLoaded( ResHandle res )
 
 H3D_IMPL bool h3dLoadResource( ResHandle res, const char *data, int size )
 {
+	Modules::renderer().acquireRenderContext();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dLoadResource", false );
 	if( resObj->isLoaded() )
@@ -292,12 +339,31 @@ H3D_IMPL bool h3dLoadResource( ResHandle res, const char *data, int size )
 	}
 	else
 		Modules::log().writeInfo( "Loading resource '%s'", resObj->getName().c_str() );
-	return resObj->load( data, size );
+
+	H3D_PROFILE_ZONE_DETAIL( "h3dLoadResource", resObj->getName().c_str() );
+	return Modules::resMan().loadResource( *resObj, data, size );
+}
+
+
+H3D_IMPL int h3dGetResDependencies( ResHandle res, ResHandle *dependencies, int maxCount )
+{
+	Resource *resObj = Modules::resMan().resolveResHandle( res );
+	APIFUNC_VALIDATE_RES( resObj, "h3dGetResDependencies", 0 );
+
+	const std::vector< ResHandle > &deps = resObj->getDependencies();
+	if( dependencies != 0x0 )
+	{
+		for( int i = 0, s = std::min( maxCount, (int)deps.size() ); i < s; ++i )
+			dependencies[i] = deps[i];
+	}
+
+	return (int)deps.size();
 }
 
 
 H3D_IMPL void h3dUnloadResource( ResHandle res )
 {
+	Modules::renderer().acquireRenderContext();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dUnloadResource", APIFUNC_RET_VOID );
 
@@ -334,6 +400,7 @@ H3D_IMPL int h3dGetResParamI( ResHandle res, int elem, int elemIdx, int param )
 
 H3D_IMPL void h3dSetResParamI( ResHandle res, int elem, int elemIdx, int param, int value )
 {
+	Modules::renderer().syncRenderThread();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dSetResParamI", APIFUNC_RET_VOID );
 
@@ -352,6 +419,7 @@ H3D_IMPL float h3dGetResParamF( ResHandle res, int elem, int elemIdx, int param,
 
 H3D_IMPL void h3dSetResParamF( ResHandle res, int elem, int elemIdx, int param, int compIdx, float value )
 {
+	Modules::renderer().syncRenderThread();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dSetResParamF", APIFUNC_RET_VOID );
 
@@ -370,6 +438,7 @@ H3D_IMPL const char *h3dGetResParamStr( ResHandle res, int elem, int elemIdx, in
 
 H3D_IMPL void h3dSetResParamStr( ResHandle res, int elem, int elemIdx, int param, const char *value )
 {
+	Modules::renderer().syncRenderThread();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dSetResParamStr", APIFUNC_RET_VOID );
 	
@@ -379,15 +448,20 @@ H3D_IMPL void h3dSetResParamStr( ResHandle res, int elem, int elemIdx, int param
 
 H3D_IMPL void *h3dMapResStream( ResHandle res, int elem, int elemIdx, int stream, bool read, bool write )
 {
+	Modules::renderer().acquireRenderContext();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dMapResStream", 0x0 );
 
+	// Data written by the application cannot be restored by reloading the resource
+	if( write ) resObj->markModified();
+
 	return resObj->mapStream( elem, elemIdx, stream, read, write );
 }
 
 
 H3D_IMPL void h3dUnmapResStream( ResHandle res )
 {
+	Modules::renderer().acquireRenderContext();
 	Resource *resObj = Modules::resMan().resolveResHandle( res );
 	APIFUNC_VALIDATE_RES( resObj, "h3dUnmapResStream", APIFUNC_RET_VOID );
 
@@ -403,12 +477,54 @@ H3D_IMPL ResHandle h3dQueryUnloadedResource( int index )
 
 H3D_IMPL void h3dReleaseUnusedResources()
 {
+	Modules::renderer().acquireRenderContext();
 	Modules::resMan().releaseUnusedResources();
 }
 
 
+H3D_IMPL bool h3dSetResTypeMemoryBudget( int type, int budgetMb )
+{
+	Modules::renderer().syncRenderThread();
+	if( budgetMb < 0 ) return false;
+	
+	return Modules::resMan().setMemoryBudget( type, (size_t)budgetMb * 1024 * 1024 );
+}
+
+
+H3D_IMPL bool h3dGetResMemoryUsage( ResHandle res, int *cpuMem, int *gpuMem )
+{
+	Modules::renderer().syncRenderThread();
+	Resource *resObj = Modules::resMan().resolveResHandle( res );
+	APIFUNC_VALIDATE_RES( resObj, "h3dGetResMemoryUsage", false );
+
+	size_t cpu = 0, gpu = 0;
+	resObj->getMemoryUsage( cpu, gpu );
+	if( cpuMem != 0x0 ) *cpuMem = (int)std::min( cpu, (size_t)INT_MAX );
+	if( gpuMem != 0x0 ) *gpuMem = (int)std::min( gpu, (size_t)INT_MAX );
+
+	return true;
+}
+
+
+H3D_IMPL int h3dListResourcesBySize( int type, ResHandle *resources, int maxCount )
+{
+	Modules::renderer().syncRenderThread();
+	std::vector< Resource * > resList;
+	Modules::resMan().listResourcesBySize( type, resList );
+
+	if( resources != 0x0 )
+	{
+		for( int i = 0, s = std::min( maxCount, (int)resList.size() ); i < s; ++i )
+			resources[i] = resList[i]->getHandle();
+	}
+
+	return (int)resList.size();
+}
+
+
 H3D_IMPL ResHandle h3dCreateTexture( const char *name, int width, int height, int fmt, int flags )
 {
+	Modules::renderer().acquireRenderContext();
 	TextureResource *texRes = new TextureResource( safeStr( name, 0 ), (uint32)width,
 		(uint32)height, 1, (TextureFormats::List)fmt, flags );
 
@@ -423,16 +539,56 @@ H3D_IMPL ResHandle h3dCreateTexture( const char *name, int width, int height, in
 }
 
 
+H3D_IMPL void h3dSetTexStreamingReadFunc( bool (*readFunc)( const char *resName, int offset, int size, void *buffer,
+                                                            void *userData ), void *userData )
+{
+	Modules::renderer().syncRenderThread();
+	TextureResource::setStreamReadFunc( readFunc, userData );
+}
+
+
 H3D_IMPL void h3dSetShaderPreambles( const char *vertPreamble, const char *fragPreamble, const char *geomPreamble, 
                                     const char *tessControlPreamble, const char *tessEvalPreamble, const char *computePreamble )
 {
+	Modules::renderer().syncRenderThread();
 	ShaderResource::setPreambles( safeStr( vertPreamble, 0 ), safeStr( fragPreamble, 1 ), safeStr( geomPreamble, 2 ), 
 								  safeStr( tessControlPreamble, 3 ), safeStr( tessEvalPreamble, 4 ), safeStr( computePreamble, 5 ) );
 }
 
 
+H3D_IMPL void h3dSetShaderCachePath( const char *path )
+{
+	Modules::renderer().syncRenderThread();
+	Modules::renderer().getShaderCache().setPath( safeStr( path, 0 ) );
+}
+
+
+H3D_IMPL bool h3dPrecompileShaders( const ResHandle *materialResources, int count )
+{
+	Modules::renderer().acquireRenderContext();
+	if( materialResources == 0x0 || count < 0 )
+	{
+		Modules::setError( "Invalid pointer in h3dPrecompileShaders" );
+		return false;
+	}
+
+	std::vector< MaterialResource * > materials;
+	materials.reserve( count );
+	for( int i = 0; i < count; ++i )
+	{
+		Resource *resObj = Modules::resMan().resolveResHandle( materialResources[i] );
+		APIFUNC_VALIDATE_RES_TYPE( resObj, ResourceTypes::Material, "h3dPrecompileShaders", false );
+
+		materials.push_back( (MaterialResource *)resObj );
+	}
+
+	return Modules::renderer().precompileShaders( materials );
+}
+
+
 H3D_IMPL bool h3dSetMaterialUniform( ResHandle materialRes, const char *name, float a, float b, float c, float d )
 {
+	Modules::renderer().syncRenderThread();
 	Resource *resObj = Modules::resMan().resolveResHandle( materialRes );
 	APIFUNC_VALIDATE_RES_TYPE( resObj, ResourceTypes::Material, "h3dSetMaterialUniform", false );
 
@@ -442,6 +598,7 @@ H3D_IMPL bool h3dSetMaterialUniform( ResHandle materialRes, const char *name, fl
 
 H3D_IMPL void h3dResizePipelineBuffers( ResHandle pipeRes, int width, int height )
 {
+	Modules::renderer().acquireRenderContext();
 	Resource *resObj = Modules::resMan().resolveResHandle( pipeRes );
 	APIFUNC_VALIDATE_RES_TYPE( resObj, ResourceTypes::Pipeline, "h3dResizePipelineBuffers", APIFUNC_RET_VOID );
 
@@ -453,6 +610,7 @@ H3D_IMPL void h3dResizePipelineBuffers( ResHandle pipeRes, int width, int height
 H3D_IMPL bool h3dGetRenderTargetData( ResHandle pipelineRes, const char *targetName, int bufIndex,
                                       int *width, int *height, int *compCount, void *dataBuffer, int bufferSize )
 {
+	Modules::renderer().acquireRenderContext();
 	if( pipelineRes != 0 )
 	{
 		Resource *resObj = Modules::resMan().resolveResHandle( pipelineRes );
@@ -66,6 +66,8 @@ void MaterialResource::initDefault()
 	_combMask = 0;
 	_matLink = 0x0;
 	_classID = 0;
+	_shaderCombCache.clear();
+	_shaderCombCacheStamp = 0;
 }
 
 
@@ -150,6 +150,11 @@ private:
 	std::vector< std::string >  _shaderFlags;
 	PMaterialResource           _matLink;
 
+	// Shader context and combination for each global context id; valid as long as the stamp matches
+	// the contexts stamp of the shader
+	std::vector< std::pair< ShaderContext *, ShaderCombination * > >  _shaderCombCache;
+	uint32                      _shaderCombCacheStamp;
+
 	friend class ResourceManager;
 	friend class Renderer;
 	friend class MeshNode;
@@ -15,6 +15,7 @@
 #include "egModules.h"
 #include "egRenderer.h"
 #include "egCom.h"
+#include "egProfiler.h"
 #include <cstring>
 
 #include "utDebug.h"
@@ -44,37 +45,26 @@ ModelNode::~ModelNode()
 }
 
 
-SceneNodeTpl *ModelNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *ModelNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
 	ModelNodeTpl *modelTpl = new ModelNodeTpl( "", 0x0 );
 	
-	map< string, string >::iterator itr = attribs.find( "geometry" );
-	if( itr != attribs.end() )
+	const char *geometry = attribs.getString( "geometry" );
+	if( geometry != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Geometry, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Geometry, geometry, 0, false );
 		if( res != 0 )
 			modelTpl->geoRes = (GeometryResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "softwareSkinning" );
-	if( itr != attribs.end() ) 
-	{
-		if ( _stricmp( itr->second.c_str(), "true" ) == 0 || _stricmp( itr->second.c_str(), "1" ) == 0 )
-			modelTpl->softwareSkinning = true;
-		else
-			modelTpl->softwareSkinning = false;
-	}
+	attribs.getBool( "softwareSkinning", modelTpl->softwareSkinning );
 
-	itr = attribs.find( "lodDist1" );
-	if( itr != attribs.end() ) modelTpl->lodDist1 = toFloat( itr->second.c_str() );
-	itr = attribs.find( "lodDist2" );
-	if( itr != attribs.end() ) modelTpl->lodDist2 = toFloat( itr->second.c_str() );
-	itr = attribs.find( "lodDist3" );
-	if( itr != attribs.end() ) modelTpl->lodDist3 = toFloat( itr->second.c_str() );
-	itr = attribs.find( "lodDist4" );
-	if( itr != attribs.end() ) modelTpl->lodDist4 = toFloat( itr->second.c_str() );
+	attribs.getFloat( "lodDist1", modelTpl->lodDist1 );
+	attribs.getFloat( "lodDist2", modelTpl->lodDist2 );
+	attribs.getFloat( "lodDist3", modelTpl->lodDist3 );
+	attribs.getFloat( "lodDist4", modelTpl->lodDist4 );
 
 	if( !result )
 	{
@@ -231,18 +221,21 @@ void ModelNode::setGeometryRes( GeometryResource &geoRes )
 	}
 
 	// Copy morph targets
-	_morphers.resize( geoRes._morphTargets.size() );
+	const std::vector< MorphTarget > &morphTargets = geoRes.getMorphTargets();
+	_morphers.resize( morphTargets.size() );
 	for( uint32 i = 0; i < _morphers.size(); ++i )
 	{	
 		Morpher &morpher = _morphers[i]; 
 		
-		morpher.name = geoRes._morphTargets[i].name;
+		morpher.name = morphTargets[i].name;
 		morpher.index = i;
 		morpher.weight = 0;
 	}
 
-	if( !_morphers.empty() || _softwareSkinning )
+	// Geometry without CPU copy of the vertex data has no skinning data and can't be cloned
+	if( !_morphers.empty() || (_softwareSkinning && geoRes.getVertStaticData() != 0x0) )
 	{
+		Modules::renderer().acquireRenderContext();
 		Resource *clonedRes = Modules::resMan().resolveResHandle(
 			Modules::resMan().cloneResource( geoRes, "" ) );
 		_geometryRes = (GeometryResource *)clonedRes;
@@ -383,6 +376,8 @@ bool ModelNode::updateGeometry()
 	if( _geometryRes == 0x0 || _geometryRes->getVertPosData() == 0x0 ||
 		_geometryRes->getVertTanData() == 0x0 || _geometryRes->getVertStaticData() == 0x0 ) return false;
 	
+	H3D_PROFILE_ZONE( "ModelNode::updateGeometry" );
+
 	Timer *timer = Modules::stats().getTimer( EngineStats::GeoUpdateTime );
 	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
 	
@@ -403,12 +398,12 @@ bool ModelNode::updateGeometry()
 		{
 			if( _morphers[i].weight > Math::Epsilon )
 			{
-				MorphTarget &mt = _geometryRes->_morphTargets[_morphers[i].index];
+				const MorphTarget &mt = _geometryRes->getMorphTargets()[_morphers[i].index];
 				float weight = _morphers[i].weight;
 				
 				for( uint32 j = 0; j < mt.diffs.size(); ++j )
 				{
-					MorphDiff &md = mt.diffs[j];
+					const MorphDiff &md = mt.diffs[j];
 					
 					posData[md.vertIndex] += md.posDiff * weight;
 					tanData[md.vertIndex].normal += md.normDiff * weight;
@@ -469,6 +464,7 @@ bool ModelNode::updateGeometry()
 	_skinningDirty = false;
 	
 	// Upload geometry
+	Modules::renderer().acquireRenderContext();
 	_geometryRes->updateDynamicVertData();
 
 	timer->setEnabled( false );
@@ -498,6 +494,35 @@ void ModelNode::setCustomInstData( const float *data, uint32 count )
 }
 
 
+SceneNode *ModelNode::createRenderProxy() const
+{
+	ModelNode *proxy = new ModelNode( *this );
+
+	// Proxy only provides state for rendering the meshes, it is not animated
+	proxy->_baseGeoRes = 0x0;
+	proxy->_meshList.clear();
+	proxy->_jointList.clear();
+	proxy->_morphers.clear();
+
+	return proxy;
+}
+
+
+void ModelNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	SceneNode::updateRenderProxy( proxy );
+
+	ModelNode &modelProxy = (ModelNode &)proxy;
+	modelProxy._geometryRes = _geometryRes;
+	modelProxy._lodDist1 = _lodDist1;
+	modelProxy._lodDist2 = _lodDist2;
+	modelProxy._lodDist3 = _lodDist3;
+	modelProxy._lodDist4 = _lodDist4;
+	modelProxy._skinMatRows = _skinMatRows;
+	memcpy( modelProxy._customInstData, _customInstData, sizeof( _customInstData ) );
+}
+
+
 void ModelNode::onPostUpdate()
 {
 	if( _nodeListDirty ) recreateNodeList();
@@ -85,7 +85,7 @@ struct Morpher	// Morph modifier
 class ModelNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	~ModelNode();
@@ -107,6 +107,9 @@ public:
 
 	void setCustomInstData( const float *data, uint32 count );
 
+	SceneNode *createRenderProxy() const;
+	void updateRenderProxy( SceneNode &proxy ) const;
+
 	GeometryResource *getGeometryResource() const { return _geometryRes; }
 	bool jointExists( uint32 jointIndex ) const { return jointIndex < _skinMatRows.size() / 3; }
 	void setSkinningMat( uint32 index, const Matrix4f &mat )
@@ -24,6 +24,7 @@
 #include "egExtensions.h"
 #include "egComputeBuffer.h"
 #include "egComputeNode.h"
+#include "egJobs.h"
 
 
 // Extensions
@@ -45,6 +46,7 @@ ResourceManager						*Modules::_resourceManager = 0x0;
 Renderer							*Modules::_renderer = 0x0;
 ExtensionManager					*Modules::_extensionManager = 0x0;
 ExternalPipelineCommandsManager		*Modules::_extCmdPipeMan = 0x0;
+JobManager							*Modules::_jobManager = 0x0;
 
 void Modules::installExtensions()
 {
@@ -58,6 +60,7 @@ bool Modules::init( int backendType )
 	if( _extensionManager == 0x0 ) _extensionManager = new ExtensionManager();
 	if( _engineLog == 0x0 ) _engineLog = new EngineLog();
 	if( _engineConfig == 0x0 ) _engineConfig = new EngineConfig();
+	if( _jobManager == 0x0 ) _jobManager = new JobManager();
 	if( _sceneManager == 0x0 ) _sceneManager = new SceneManager();
 	if( _resourceManager == 0x0 ) _resourceManager = new ResourceManager();
 	if( _renderer == 0x0 ) _renderer = new Renderer();
@@ -65,6 +68,7 @@ bool Modules::init( int backendType )
 	if ( _extCmdPipeMan == 0x0 ) _extCmdPipeMan = new ExternalPipelineCommandsManager();
 
 	// Init modules
+	jobs().setWorkerCount( config().workerThreadCount );
 	if ( !renderer().init( ( RenderBackendType::List ) backendType ) ) return false;
 	if ( !stats().init() ) return false;
 
@@ -157,6 +161,9 @@ void Modules::release()
 	// Remove overlays since they reference resources and resource manager is removed before renderer
 //	if( _renderer ) _renderer->clearOverlays();
 	
+	// Stop the render thread before any module it uses is destroyed
+	if( _renderer ) _renderer->setPipelinedRendering( false );
+	
 	// Order of destruction is important
 	delete _extensionManager; _extensionManager = 0x0;
 	delete _extCmdPipeMan; _extCmdPipeMan = 0x0;
@@ -164,6 +171,7 @@ void Modules::release()
 	delete _resourceManager; _resourceManager = 0x0;
 	delete _renderer; _renderer = 0x0;
 	delete _statManager; _statManager = 0x0;
+	delete _jobManager; _jobManager = 0x0;
 	delete _engineLog; _engineLog = 0x0;
 	delete _engineConfig; _engineConfig = 0x0;
 }
@@ -27,6 +27,7 @@ class ResourceManager;
 class Renderer;
 class ExtensionManager;
 class ExternalPipelineCommandsManager;
+class JobManager;
 
 
 // =================================================================================================
@@ -50,6 +51,7 @@ public:
 	static Renderer &renderer() { return *_renderer; }
 	static ExtensionManager &extMan() { return *_extensionManager; }
 	static ExternalPipelineCommandsManager &pipeMan() { return *_extCmdPipeMan; }
+	static JobManager &jobs() { return *_jobManager; }
 public:
 	static const char *versionString;
 
@@ -67,6 +69,7 @@ private:
 	static Renderer							*_renderer;
 	static ExtensionManager					*_extensionManager;
 	static ExternalPipelineCommandsManager	*_extCmdPipeMan;
+	static JobManager						*_jobManager;
 
 };
 
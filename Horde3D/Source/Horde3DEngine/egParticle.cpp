@@ -14,8 +14,10 @@
 #include "egMaterial.h"
 #include "egModules.h"
 #include "egCom.h"
+#include "egProfiler.h"
 #include "egRenderer.h"
 #include "utXML.h"
+#include <cstring>
 
 #include "utDebug.h"
 
@@ -329,7 +331,11 @@ EmitterNode::~EmitterNode()
 	for( uint32 i = 0; i < _occQueries.size(); ++i )
 	{
 		if( _occQueries[i] != 0 )
+		{
+			// Nodes and render proxies are deleted on the application thread
+			Modules::renderer().acquireRenderContext();
 			rdi->destroyQuery( _occQueries[i] );
+		}
 	}
 	
 	delete[] _particles;
@@ -339,47 +345,39 @@ EmitterNode::~EmitterNode()
 }
 
 
-SceneNodeTpl *EmitterNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *EmitterNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
 	bool result = true;
 	
-	map< string, string >::iterator itr;
+	int value;
 	EmitterNodeTpl *emitterTpl = new EmitterNodeTpl( "", 0x0, 0x0, 0, 0 );
 
-	itr = attribs.find( "material" );
-	if( itr != attribs.end() )
+	const char *material = attribs.getString( "material" );
+	if( material != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::Material, material, 0, false );
 		if( res != 0 )
 			emitterTpl->matRes = (MaterialResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "particleEffect" );
-	if( itr != attribs.end() )
+	const char *particleEffect = attribs.getString( "particleEffect" );
+	if( particleEffect != 0x0 )
 	{
-		uint32 res = Modules::resMan().addResource( ResourceTypes::ParticleEffect, itr->second, 0, false );
+		uint32 res = Modules::resMan().addResource( ResourceTypes::ParticleEffect, particleEffect, 0, false );
 		if( res != 0 )
 			emitterTpl->effectRes = (ParticleEffectResource *)Modules::resMan().resolveResHandle( res );
 	}
 	else result = false;
-	itr = attribs.find( "maxCount" );
-	if( itr != attribs.end() ) emitterTpl->maxParticleCount = atoi( itr->second.c_str() );
+	if( attribs.getInt( "maxCount", value ) ) emitterTpl->maxParticleCount = value;
 	else result = false;
-	itr = attribs.find( "respawnCount" );
-	if( itr != attribs.end() ) emitterTpl->respawnCount = atoi( itr->second.c_str() );
+	if( attribs.getInt( "respawnCount", value ) ) emitterTpl->respawnCount = value;
 	else result = false;
-	itr = attribs.find( "delay" );
-	if( itr != attribs.end() ) emitterTpl->delay = toFloat( itr->second.c_str() );
-	itr = attribs.find( "emissionRate" );
-	if( itr != attribs.end() ) emitterTpl->emissionRate = toFloat( itr->second.c_str() );
-	itr = attribs.find( "spreadAngle" );
-	if( itr != attribs.end() ) emitterTpl->spreadAngle = toFloat( itr->second.c_str() );
-	itr = attribs.find( "forceX" );
-	if( itr != attribs.end() ) emitterTpl->fx = toFloat( itr->second.c_str() );
-	itr = attribs.find( "forceY" );
-	if( itr != attribs.end() ) emitterTpl->fy = toFloat( itr->second.c_str() );
-	itr = attribs.find( "forceZ" );
-	if( itr != attribs.end() ) emitterTpl->fz = toFloat( itr->second.c_str() );
+	attribs.getFloat( "delay", emitterTpl->delay );
+	attribs.getFloat( "emissionRate", emitterTpl->emissionRate );
+	attribs.getFloat( "spreadAngle", emitterTpl->spreadAngle );
+	attribs.getFloat( "forceX", emitterTpl->fx );
+	attribs.getFloat( "forceY", emitterTpl->fy );
+	attribs.getFloat( "forceZ", emitterTpl->fz );
 	
 	if( !result )
 	{
@@ -540,6 +538,8 @@ void EmitterNode::update( float timeDelta )
 	// Update absolute transformation
 	updateTree();
 	
+	H3D_PROFILE_ZONE( "EmitterNode::update" );
+
 	Timer *timer = Modules::stats().getTimer( EngineStats::ParticleSimTime );
 	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
 	
@@ -689,4 +689,35 @@ bool EmitterNode::hasFinished() const
 	return true;
 }
 
+
+SceneNode *EmitterNode::createRenderProxy() const
+{
+	EmitterNode *proxy = new EmitterNode( *this );
+	
+	// The proxy gets its own particle buffers
+	proxy->_particles = 0x0;
+	proxy->_parPositions = 0x0;
+	proxy->_parSizesANDRotations = 0x0;
+	proxy->_parColors = 0x0;
+	proxy->setMaxParticleCount( _particleCount );
+
+	return proxy;
+}
+
+
+void EmitterNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	SceneNode::updateRenderProxy( proxy );
+
+	EmitterNode &emitter = (EmitterNode &)proxy;
+	emitter._materialRes = _materialRes;
+	emitter._effectRes = _effectRes;
+	
+	if( emitter._particleCount != _particleCount ) emitter.setMaxParticleCount( _particleCount );
+	memcpy( emitter._particles, _particles, _particleCount * sizeof( ParticleData ) );
+	memcpy( emitter._parPositions, _parPositions, _particleCount * 3 * sizeof( float ) );
+	memcpy( emitter._parSizesANDRotations, _parSizesANDRotations, _particleCount * 2 * sizeof( float ) );
+	memcpy( emitter._parColors, _parColors, _particleCount * 4 * sizeof( float ) );
+}
+
 }  // namespace
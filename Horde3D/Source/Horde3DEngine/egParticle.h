@@ -154,7 +154,7 @@ struct ParticleData
 class EmitterNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	~EmitterNode();
@@ -167,6 +167,9 @@ public:
 	void update( float timeDelta );
 	bool hasFinished() const;
 
+	SceneNode *createRenderProxy() const;
+	void updateRenderProxy( SceneNode &proxy ) const;
+
 protected:
 	EmitterNode( const EmitterNodeTpl &emitterTpl );
 	void setMaxParticleCount( uint32 maxParticleCount );
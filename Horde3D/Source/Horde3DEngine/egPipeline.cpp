@@ -184,6 +184,7 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 			vector< PipeCmdParam > &params = stage.commands.back().params;
 			params.resize( 3 );			
 			params[0].setString( node1.getAttribute( "context" ) );
+			params[0].setInt( ShaderResource::getContextId( params[0].getString() ) );
 			params[1].setInt( MaterialClassCollection::addClass( node1.getAttribute( "class", "" ) ) );
 			params[2].setInt( order );
 		}
@@ -200,6 +201,7 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 			params.resize( 2 );
 			params[0].setResource( Modules::resMan().resolveResHandle( matRes ) );
 			params[1].setString( node1.getAttribute( "context" ) );
+			params[1].setInt( ShaderResource::getContextId( params[1].getString() ) );
 		}
 		else if( strcmp( node1.getName(), "DoForwardLightLoop" ) == 0 )
 		{
@@ -213,6 +215,7 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 			vector< PipeCmdParam > &params = stage.commands.back().params;
 			params.resize( 4 );
 			params[0].setString( node1.getAttribute( "context", "" ) );
+			params[0].setInt( ShaderResource::getContextId( params[0].getString() ) );
 			params[1].setInt( MaterialClassCollection::addClass( node1.getAttribute( "class", "" ) ) );
 			params[2].setBool( _stricmp( node1.getAttribute( "noShadows", "false" ), "true" ) == 0 );
 			params[3].setInt( order );
@@ -223,6 +226,7 @@ const string PipelineResource::parseStage( XMLNode &node, PipelineStage &stage )
 			vector< PipeCmdParam > &params = stage.commands.back().params;
 			params.resize( 2 );
 			params[0].setString( node1.getAttribute( "context", "" ) );
+			params[0].setInt( ShaderResource::getContextId( params[0].getString() ) );
 			params[1].setBool( _stricmp( node1.getAttribute( "noShadows", "false" ), "true" ) == 0 );
 		}
 // 		else if ( strcmp( node1.getName(), "DispatchComputeShader" ) == 0 )
@@ -56,6 +56,7 @@ void Frustum::buildViewFrustum( const Matrix4f &transMat, float left, float righ
 	_origin = transMat * Vec3f( 0, 0, 0 );
 	for( uint32 i = 0; i < 8; ++i )
 		_corners[i] = transMat * _corners[i];
+	_perspective = true;
 
 	// Build planes
 	_planes[0] = Plane( _origin, _corners[3], _corners[0] );		// Left
@@ -89,6 +90,7 @@ void Frustum::buildViewFrustum( const Matrix4f &viewMat, const Matrix4f &projMat
 						-(m.c[2][3] - m.c[2][2]), -(m.c[3][3] - m.c[3][2]) );	// Far
 
 	_origin = viewMat.inverted() * Vec3f( 0, 0, 0 );
+	_perspective = projMat.c[3][3] == 0;
 
 	// Calculate corners
 	Matrix4f mm = m.inverted();
@@ -130,6 +132,7 @@ void Frustum::buildBoxFrustum( const Matrix4f &transMat, float left, float right
 	_origin = transMat * Vec3f( 0, 0, 0 );
 	for( uint32 i = 0; i < 8; ++i )
 		_corners[i] = transMat * _corners[i];
+	_perspective = false;
 
 	// Build planes
 	_planes[0] = Plane( _corners[0], _corners[3], _corners[7] );	// Left
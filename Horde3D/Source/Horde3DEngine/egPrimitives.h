@@ -122,6 +122,7 @@ class Frustum
 public:
 	const Vec3f &getOrigin() const { return _origin; }
 	const Vec3f &getCorner( uint32 index ) const { return _corners[index]; }
+	bool isPerspective() const { return _perspective; }
 	
 	void buildViewFrustum( const Matrix4f &transMat, float fov, float aspect, float nearPlane, float farPlane );
 	void buildViewFrustum( const Matrix4f &transMat, float left, float right,
@@ -139,6 +140,7 @@ private:
 	Plane  _planes[6];  // Planes of frustum
 	Vec3f  _origin;
 	Vec3f  _corners[8];  // Corner points
+	bool   _perspective;  // All view rays start at the origin
 };
 
 }
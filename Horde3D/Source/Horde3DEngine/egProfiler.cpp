@@ -0,0 +1,174 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "egProfiler.h"
+#include "egModules.h"
+#include "egCom.h"
+#include <cstdio>
+#include <cstring>
+
+#include "utDebug.h"
+
+
+namespace Horde3D {
+
+using namespace std;
+
+std::atomic< bool >                           Profiler::_capturing( false );
+uint64                                        Profiler::_captureStartNS = 0;
+std::mutex                                    Profiler::_bufferListMutex;
+std::vector< std::unique_ptr< ProfThreadBuffer > > Profiler::_threadBuffers;
+
+// Buffers are owned by the profiler so that events of threads that already exited can still be written
+static thread_local ProfThreadBuffer *_curThreadBuffer = 0x0;
+
+
+static void writeJSONString( FILE *f, const char *str )
+{
+	fputc( '"', f );
+	for( const char *c = str; *c != '\0'; ++c )
+	{
+		if( *c == '"' || *c == '\\' ) { fputc( '\\', f ); fputc( *c, f ); }
+		else if( (unsigned char)*c < 0x20 ) fprintf( f, "\\u%04x", (unsigned char)*c );
+		else fputc( *c, f );
+	}
+	fputc( '"', f );
+}
+
+
+ProfThreadBuffer *Profiler::getThreadBuffer()
+{
+	if( _curThreadBuffer == 0x0 )
+	{
+		lock_guard< mutex > lock( _bufferListMutex );
+
+		_threadBuffers.emplace_back( new ProfThreadBuffer() );
+		_curThreadBuffer = _threadBuffers.back().get();
+		_curThreadBuffer->threadId = (uint32)_threadBuffers.size();
+		_curThreadBuffer->events.reserve( 4096 );
+	}
+
+	return _curThreadBuffer;
+}
+
+
+void Profiler::beginCapture()
+{
+	{
+		lock_guard< mutex > listLock( _bufferListMutex );
+
+		for( size_t i = 0; i < _threadBuffers.size(); ++i )
+		{
+			lock_guard< mutex > lock( _threadBuffers[i]->mutex );
+			_threadBuffers[i]->events.clear();
+		}
+	}
+
+	_captureStartNS = Timer::getTimeNS();
+	_capturing.store( true );
+}
+
+
+bool Profiler::endCapture( const char *fileName )
+{
+	if( !_capturing.exchange( false ) )
+	{
+		Modules::log().writeWarning( "Profiler: No capture in progress" );
+		return false;
+	}
+
+	FILE *f = fopen( fileName, "w" );
+	if( f == 0x0 )
+	{
+		Modules::log().writeError( "Profiler: Failed to open '%s' for writing", fileName );
+		return false;
+	}
+
+	uint32 numEvents = 0;
+
+	fputs( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f );
+
+	lock_guard< mutex > listLock( _bufferListMutex );
+	for( size_t i = 0; i < _threadBuffers.size(); ++i )
+	{
+		ProfThreadBuffer &buf = *_threadBuffers[i];
+		lock_guard< mutex > lock( buf.mutex );
+
+		// Thread names are written as metadata events
+		if( !buf.threadName.empty() )
+		{
+			fprintf( f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":",
+			         numEvents++ > 0 ? ",\n" : "", buf.threadId );
+			writeJSONString( f, buf.threadName.c_str() );
+			fputs( "}}", f );
+		}
+
+		for( size_t j = 0; j < buf.events.size(); ++j )
+		{
+			const ProfEvent &ev = buf.events[j];
+			if( ev.startNS < _captureStartNS ) continue;  // Zone was opened before capture started
+
+			fprintf( f, "%s{\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+			         numEvents++ > 0 ? ",\n" : "", buf.threadId,
+			         (double)(ev.startNS - _captureStartNS) / 1000.0, (double)ev.durationNS / 1000.0 );
+			writeJSONString( f, ev.name );
+			if( ev.detail[0] != '\0' )
+			{
+				fputs( ",\"args\":{\"detail\":", f );
+				writeJSONString( f, ev.detail );
+				fputc( '}', f );
+			}
+			fputc( '}', f );
+		}
+
+		buf.events.clear();
+	}
+
+	fputs( "\n]}\n", f );
+	fclose( f );
+
+	Modules::log().writeInfo( "Profiler: Wrote %u trace events to '%s'", numEvents, fileName );
+
+	return true;
+}
+
+
+void Profiler::setThreadName( const char *name )
+{
+	ProfThreadBuffer *buf = getThreadBuffer();
+
+	lock_guard< mutex > lock( buf->mutex );
+	buf->threadName = name != 0x0 ? name : "";
+}
+
+
+void Profiler::pushEvent( const char *name, const char *detail, uint64 startNS, uint64 endNS )
+{
+	ProfThreadBuffer *buf = getThreadBuffer();
+
+	ProfEvent ev;
+	ev.name = name;
+	ev.startNS = startNS;
+	ev.durationNS = endNS - startNS;
+	if( detail != 0x0 )
+	{
+		strncpy( ev.detail, detail, sizeof( ev.detail ) - 1 );
+		ev.detail[sizeof( ev.detail ) - 1] = '\0';
+	}
+	else
+		ev.detail[0] = '\0';
+
+	lock_guard< mutex > lock( buf->mutex );
+	buf->events.push_back( ev );
+}
+
+}  // namespace
@@ -0,0 +1,109 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _egProfiler_H_
+#define _egProfiler_H_
+
+#include "egPrerequisites.h"
+#include "utTimer.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <memory>
+
+
+namespace Horde3D {
+
+// =================================================================================================
+// Profiler
+// =================================================================================================
+
+struct ProfEvent
+{
+	const char  *name;     // Must be a string with static lifetime
+	char        detail[48];
+	uint64      startNS;
+	uint64      durationNS;
+};
+
+// =================================================================================================
+
+struct ProfThreadBuffer
+{
+	std::mutex                 mutex;  // Only contended while a capture is written
+	std::vector< ProfEvent >   events;
+	std::string                threadName;
+	uint32                     threadId;
+};
+
+// =================================================================================================
+
+class Profiler
+{
+public:
+	static bool isCapturing() { return _capturing.load( std::memory_order_relaxed ); }
+
+	static void beginCapture();
+	static bool endCapture( const char *fileName );
+
+	static void setThreadName( const char *name );
+	static void pushEvent( const char *name, const char *detail, uint64 startNS, uint64 endNS );
+
+private:
+	static ProfThreadBuffer *getThreadBuffer();
+
+private:
+	static std::atomic< bool >                                _capturing;
+	static uint64                                             _captureStartNS;
+
+	static std::mutex                                         _bufferListMutex;
+	static std::vector< std::unique_ptr< ProfThreadBuffer > > _threadBuffers;
+};
+
+// =================================================================================================
+
+class ProfSample
+{
+public:
+	ProfSample( const char *name, const char *detail = 0x0 ) : _name( 0x0 )
+	{
+		// Cost without active capture is a single relaxed load
+		if( Profiler::isCapturing() )
+		{
+			_name = name;
+			_detail = detail;
+			_startNS = Timer::getTimeNS();
+		}
+	}
+
+	~ProfSample()
+	{
+		if( _name != 0x0 ) Profiler::pushEvent( _name, _detail, _startNS, Timer::getTimeNS() );
+	}
+
+private:
+	const char  *_name;
+	const char  *_detail;
+	uint64      _startNS;
+};
+
+#define H3D_PROF_CONCAT_( a, b ) a##b
+#define H3D_PROF_CONCAT( a, b ) H3D_PROF_CONCAT_( a, b )
+
+// Opens a profiling zone that lasts until the end of the enclosing scope
+#define H3D_PROFILE_ZONE( name ) Horde3D::ProfSample H3D_PROF_CONCAT( __profSample, __LINE__ )( name )
+#define H3D_PROFILE_ZONE_DETAIL( name, detail ) \
+	Horde3D::ProfSample H3D_PROF_CONCAT( __profSample, __LINE__ )( name, detail )
+
+}
+#endif // _egProfiler_H_
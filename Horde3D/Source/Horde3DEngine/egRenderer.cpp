@@ -17,6 +17,9 @@
 #include "egModules.h"
 #include "egCom.h"
 #include "egComputeNode.h"
+#include "egExtensions.h"
+#include "egProfiler.h"
+#include "egJobs.h"
 #include <cstring>
 
 #include "utDebug.h"
@@ -35,6 +38,12 @@
 // Constants
 constexpr int defaultCameraView = 0;
 
+// Names of default pipeline commands, used for profiling zones
+static const char *pipeCmdProfNames[] = {
+	"SwitchTarget", "BindBuffer", "UnbindBuffers", "ClearTarget", "DrawGeometry",
+	"DrawQuad", "DoForwardLightLoop", "DoDeferredLightLoop", "SetUniform"
+};
+
 namespace Horde3D {
 
 using namespace std;
@@ -44,6 +53,7 @@ Renderer::Renderer()
 	_scratchBuf = 0x0;
 	_scratchBufSize = 0;
 	_frameID = 1;
+	_texStreamFrameID = 0;
 	_defShadowMap = 0;
 	_quadIdxBuf = 0;
 	_particleVBO = 0;
@@ -53,11 +63,13 @@ Renderer::Renderer()
 	_curRenderTarget = 0x0;
 	_curShaderUpdateStamp = 1;
 	_curStageMatLink = 0;
+	_texRequestMat = 0x0;
 	_maxAnisoMask = 0;
 	_smSize = 0;
 	_shadowRB = 0;
 	_vlPosOnly = 0;
 	_vlModel = 0;
+	_vlModelQuantized = 0;
 	_vlParticle = 0;
 
 	_particleGeo = 0;
@@ -112,11 +124,20 @@ Renderer::Renderer()
 	_uni.parColorArray = registerEngineUniform( "parColorArray" );
 
 	_renderDevice = 0x0;
+
+	_renderThreadCallback = 0x0;
+	_renderThreadUserData = 0x0;
+	_pipelined = false;
+	_frameInFlight = false;
+	_contextRequested = false;
+	_renderThreadExit = false;
 }
 
 
 Renderer::~Renderer()
 {
+	ASSERT( !_pipelined );
+	
 	if ( _renderDevice )
 	{
 		releaseShadowRB();
@@ -145,6 +166,17 @@ void Renderer::registerRenderFunc( int nodeType, RenderFunc rf )
 	RenderFuncListItem item;
 	item.nodeType = nodeType;
 	item.renderFunc = rf;
+	item.renderFuncByName = 0x0;
+	_renderFuncRegistry.push_back( item );
+}
+
+
+void Renderer::registerRenderFunc( int nodeType, RenderFuncByName rf )
+{
+	RenderFuncListItem item;
+	item.nodeType = nodeType;
+	item.renderFunc = 0x0;
+	item.renderFuncByName = rf;
 	_renderFuncRegistry.push_back( item );
 }
 
@@ -224,24 +256,36 @@ bool Renderer::init( RenderBackendType::List type )
 	
 	// Create vertex layouts
 	VertexLayoutAttrib attribsPosOnly[1] = {
-		{"vertPos", 0, 3, 0}
+		{"vertPos", 0, 3, 0, VAFMT_FLOAT}
 	};
 	_vlPosOnly = _renderDevice->registerVertexLayout( 1, attribsPosOnly );
 
 	VertexLayoutAttrib attribsModel[7] = {
-		{"vertPos", 0, 3, 0},
-		{"normal", 1, 3, 0},
-		{"tangent", 2, 4, 0},
-		{"joints", 3, 4, 8},
-		{"weights", 3, 4, 24},
-		{"texCoords0", 3, 2, 0},
-		{"texCoords1", 3, 2, 40}
+		{"vertPos", 0, 3, 0, VAFMT_FLOAT},
+		{"normal", 1, 3, 0, VAFMT_FLOAT},
+		{"tangent", 2, 4, 0, VAFMT_FLOAT},
+		{"joints", 3, 4, 8, VAFMT_FLOAT},
+		{"weights", 3, 4, 24, VAFMT_FLOAT},
+		{"texCoords0", 3, 2, 0, VAFMT_FLOAT},
+		{"texCoords1", 3, 2, 40, VAFMT_FLOAT}
 	};
 	_vlModel = _renderDevice->registerVertexLayout( 7, attribsModel );
 
+	// Same attributes as the model layout with packed tangent frame, texture coordinates and skinning data
+	VertexLayoutAttrib attribsModelQuantized[7] = {
+		{"vertPos", 0, 3, 0, VAFMT_FLOAT},
+		{"normal", 1, 4, 0, VAFMT_SNORM_10_10_10_2},
+		{"tangent", 2, 4, 0, VAFMT_SNORM_10_10_10_2},
+		{"joints", 3, 4, 4, VAFMT_UINT8},
+		{"weights", 3, 4, 8, VAFMT_UNORM8},
+		{"texCoords0", 3, 2, 0, VAFMT_UNORM16},
+		{"texCoords1", 3, 2, 12, VAFMT_UNORM16}
+	};
+	_vlModelQuantized = _renderDevice->registerVertexLayout( 7, attribsModelQuantized );
+
 	VertexLayoutAttrib attribsParticle[2] = {
-		{"texCoords0", 0, 2, 0},
-		{"parIdx", 0, 1, 8}
+		{"texCoords0", 0, 2, 0, VAFMT_FLOAT},
+		{"parIdx", 0, 1, 8, VAFMT_FLOAT}
 	};
 	_vlParticle = _renderDevice->registerVertexLayout( 2, attribsParticle );
 	
@@ -393,6 +437,9 @@ uint32 Renderer::getDefaultVertexLayout( DefaultVertexLayouts::List vl ) const
 		case DefaultVertexLayouts::Model:
 			return _vlModel;
 			break;
+		case DefaultVertexLayouts::ModelQuantized:
+			return _vlModelQuantized;
+			break;
 		default:
 			break;
 	}
@@ -533,6 +580,8 @@ void Renderer::drawCone( float height, float radius, const Matrix4f &transMat )
 
 void Renderer::prepareRenderViews()
 {
+	H3D_PROFILE_ZONE( "Renderer::prepareRenderViews" );
+
 	SceneManager &scm = Modules::sceneMan();
 
 	Timer *timer = Modules::stats().getTimer( EngineStats::CullingTime );
@@ -551,9 +600,10 @@ void Renderer::prepareRenderViews()
 	scm.addRenderView( RenderViewType::Camera, _curCamera, _curCamera->getFrustum() );
 
 	SceneNode *node = nullptr;
-	for ( size_t i = 0; i < scm._nodes.size(); ++i )
+	const std::vector< SceneNode * > &nodes = scm.getRenderNodes();
+	for ( size_t i = 0; i < nodes.size(); ++i )
 	{
-		node = scm._nodes[ i ];
+		node = nodes[ i ];
 		if ( !node || node->_type != SceneNodeTypes::Light ) continue;
 
 		// Ignore lights that do not cross the camera frustum and are disabled
@@ -624,11 +674,84 @@ void Renderer::prepareRenderViews()
 bool Renderer::createShaderComb( ShaderCombination &sc, const char *vertexShader, const char *fragmentShader, const char *geometryShader,
 								 const char *tessControlShader, const char *tessEvaluationShader, const char *computeShader )
 {
-	// Create shader program
-	uint32 shdObj = _renderDevice->createShader( vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader, computeShader );
-	if( shdObj == 0 ) return false;
+	beginCreatingShaderComb( sc, vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader, computeShader );
+
+	return finishCreatingShaderComb( sc );
+}
+
+
+bool Renderer::beginCreatingShaderComb( ShaderCombination &sc, const char *vertexShader, const char *fragmentShader, const char *geometryShader,
+										const char *tessControlShader, const char *tessEvaluationShader, const char *computeShader )
+{
+	Timer *timer = Modules::stats().getTimer( EngineStats::ShaderCompileTime );
+	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+
+	sc.shaderObj = 0;
+	sc.cacheKey = 0;
+	sc.pending = false;
+
+	// Try to load linked program from shader cache
+	if( _shaderCache.isEnabled() && _renderDevice->getCaps().shaderBinaries )
+	{
+		const char *code[6] = { vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader, computeShader };
+		uint64 key = ShaderCache::calcKey( _renderDevice->getDeviceInfo(), code );
+
+		uint32 format;
+		std::vector< char > data;
+		if( _shaderCache.load( key, format, data ) )
+			sc.shaderObj = _renderDevice->createShaderFromBinary( format, &data[0], (uint32)data.size() );
+
+		if( sc.shaderObj != 0 )
+		{
+			Modules::stats().incStat( EngineStats::ShaderCacheHits, 1 );
+		}
+		else
+		{
+			Modules::stats().incStat( EngineStats::ShaderCacheMisses, 1 );
+			sc.cacheKey = key;
+		}
+	}
+
+	// Start compiling program; the driver may continue in the background until finishCreatingShaderComb
+	if( sc.shaderObj == 0 )
+	{
+		sc.shaderObj = _renderDevice->beginCreatingShader( vertexShader, fragmentShader, geometryShader,
+														   tessControlShader, tessEvaluationShader, computeShader );
+		sc.pending = true;
+	}
+
+	timer->setEnabled( false );
+
+	return sc.shaderObj != 0;
+}
+
+
+bool Renderer::finishCreatingShaderComb( ShaderCombination &sc )
+{
+	Timer *timer = Modules::stats().getTimer( EngineStats::ShaderCompileTime );
+	if( Modules::config().gatherTimeStats ) timer->setEnabled( true );
+
+	if( sc.pending )
+	{
+		_renderDevice->finishCreatingShader( sc.shaderObj );
+
+		// Store program for next runs
+		uint32 format;
+		std::vector< char > data;
+		if( sc.shaderObj != 0 && sc.cacheKey != 0 && _renderDevice->getShaderBinary( sc.shaderObj, format, data ) )
+			_shaderCache.store( sc.cacheKey, format, data );
+
+		sc.cacheKey = 0;
+		sc.pending = false;
+	}
+
+	uint32 shdObj = sc.shaderObj;
+	if( shdObj == 0 )
+	{
+		timer->setEnabled( false );
+		return false;
+	}
 	
-	sc.shaderObj = shdObj;
 	_renderDevice->bindShader( shdObj );
 	
 	// Set standard uniforms
@@ -642,6 +765,8 @@ bool Renderer::createShaderComb( ShaderCombination &sc, const char *vertexShader
 		sc.uniLocs.emplace_back( _renderDevice->getShaderSamplerLoc( shdObj, _engineUniforms[ i ].uniformName.c_str() ) );
 	}
 
+	timer->setEnabled( false );
+
 // 	Misc general uniforms
 // 	sc.uni_frameBufSize = _renderDevice->getShaderConstLoc( shdObj, "frameBufSize" );
 // 	
@@ -686,6 +811,20 @@ void Renderer::releaseShaderComb( ShaderCombination &sc )
 }
 
 
+bool Renderer::precompileShaders( const std::vector< MaterialResource * > &materials )
+{
+	// Compiling is started for the combinations of all materials before waiting for the first one
+	std::vector< PendingShaderComb > batch;
+	for( size_t i = 0; i < materials.size(); ++i )
+	{
+		ShaderResource *shaderRes = materials[i]->_shaderRes;
+		if( shaderRes != 0x0 ) shaderRes->queueCombination( materials[i]->_combMask, batch );
+	}
+
+	return ShaderResource::compileBatch( batch );
+}
+
+
 void Renderer::setShaderComb( ShaderCombination *sc )
 {
 	if( _curShader != sc )
@@ -771,7 +910,7 @@ void Renderer::commitGeneralUniforms()
 }
 
 
-bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shaderContext,
+bool Renderer::setMaterialRec( MaterialResource *materialRes, int shaderContext,
                                ShaderResource *shaderRes )
 {
 	if( materialRes == 0x0 ) return false;
@@ -785,12 +924,31 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		shaderRes = materialRes->_shaderRes;
 		if( shaderRes == 0x0 ) return false;	
 	
-		// Find context
-		ShaderContext *context = shaderRes->findContext( shaderContext );
-		if( context == 0x0 ) return false;
+		// Find context and shader combination; both are cached in the material per context
+		if( materialRes->_shaderCombCacheStamp != shaderRes->getContextsStamp() )
+		{
+			materialRes->_shaderCombCache.clear();
+			materialRes->_shaderCombCacheStamp = shaderRes->getContextsStamp();
+		}
+		if( shaderContext < 0 ) return false;
+		if( shaderContext >= (int)materialRes->_shaderCombCache.size() )
+		{
+			materialRes->_shaderCombCache.resize( shaderContext + 1,
+				std::pair< ShaderContext *, ShaderCombination * >( 0x0, 0x0 ) );
+		}
+
+		std::pair< ShaderContext *, ShaderCombination * > &cachedComb = materialRes->_shaderCombCache[shaderContext];
+		if( cachedComb.second == 0x0 )
+		{
+			cachedComb.first = shaderRes->findContext( shaderContext );
+			if( cachedComb.first == 0x0 ) return false;
+			cachedComb.second = shaderRes->getCombination( *cachedComb.first, materialRes->_combMask );
+		}
 		
-		// Set shader combination
-		ShaderCombination *sc = shaderRes->getCombination( *context, materialRes->_combMask );
+		ShaderContext *context = cachedComb.first;
+		
+		// Set shader combination; context can get uncompiled when its code is changed
+		ShaderCombination *sc = context->compiled ? cachedComb.second : 0x0;
 		if( sc != _curShader ) setShaderComb( sc );
 		if( _curShader == 0x0 || _renderDevice->_curShaderId == 0 ) return false;
 
@@ -827,6 +985,7 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		
 		ShaderSampler &sampler = shaderRes->_samplers[i];
 		TextureResource *texRes = 0x0;
+		bool matTex = false;
 
 		// Use default texture
 		if( firstRec) texRes = sampler.defTex;
@@ -837,7 +996,10 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 			if( materialRes->_samplers[j].name == sampler.id )
 			{
 				if( materialRes->_samplers[j].texRes && materialRes->_samplers[j].texRes->isLoaded() )
+				{
 					texRes = materialRes->_samplers[j].texRes;
+					matTex = true;
+				}
 				break;
 			}
 		}
@@ -856,6 +1018,16 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 		{
 			if( texRes->getTexType() != sampler.type ) break;  // Wrong type
 			
+			texRes->markUsed( _frameID );
+
+			// Streamed textures that are not requested per mesh need all mip levels
+			if( texRes->isStreamed() )
+			{
+				MaterialResource *matRes = matTex ? _texRequestMat : 0x0;
+				while( matRes != 0x0 && matRes != materialRes ) matRes = matRes->_matLink;
+				if( matRes == 0x0 ) texRes->requestMip( 0, _frameID );
+			}
+			
 			if( texRes->getTexType() == TextureTypes::Tex2D )
 			{
 				if( texRes->getRBObject() == 0 )
@@ -977,7 +1149,7 @@ bool Renderer::setMaterialRec( MaterialResource *materialRes, const string &shad
 }
 
 
-bool Renderer::setMaterial( MaterialResource *materialRes, const string &shaderContext )
+bool Renderer::setMaterial( MaterialResource *materialRes, int shaderContext )
 {
 	if( materialRes == 0x0 )
 	{	
@@ -990,6 +1162,8 @@ bool Renderer::setMaterial( MaterialResource *materialRes, const string &shaderC
 		return false;
 	}
 
+	H3D_PROFILE_ZONE_DETAIL( "Renderer::setMaterial", Profiler::isCapturing() ? materialRes->getName().c_str() : 0x0 );
+
 	if( !setMaterialRec( materialRes, shaderContext, 0x0 ) )
 	{
 		_curShader = 0x0;
@@ -1249,6 +1423,8 @@ void Renderer::updateShadowMap()
 {
 	if ( _curLight == 0x0 || _curLight->_shadowRenderParamsID == -1 ) return;
 
+	H3D_PROFILE_ZONE( "Renderer::updateShadowMap" );
+
 	uint32 prevRendBuf = _renderDevice->_curRendBuf;
 	int prevVPX = _renderDevice->_vpX, prevVPY = _renderDevice->_vpY, prevVPWidth = _renderDevice->_vpWidth, prevVPHeight = _renderDevice->_vpHeight;
 
@@ -1300,7 +1476,7 @@ void Renderer::updateShadowMap()
 		// Render
 		Modules::sceneMan().setCurrentView( params.viewID[ i ] );
 		Frustum &f = Modules::sceneMan().getRenderViews()[ params.viewID[ i ] ].frustum;
-		drawRenderables( _curLight->_shadowContext, 0, false, &f, 0x0, RenderingOrder::None, -1 );
+		drawRenderables( _curLight->_shadowContextId, 0, false, &f, 0x0, RenderingOrder::None, -1 );
 	}
 
 	// Map from post-projective space [-1,1] to texture space [0,1]
@@ -1452,7 +1628,7 @@ void Renderer::clear( bool depth, bool buf0, bool buf1, bool buf2, bool buf3,
 }
 
 
-void Renderer::drawFSQuad( Resource *matRes, const string &shaderContext )
+void Renderer::drawFSQuad( Resource *matRes, int shaderContext )
 {
 	if( matRes == 0x0 || matRes->getType() != ResourceTypes::Material ) return;
 
@@ -1465,7 +1641,7 @@ void Renderer::drawFSQuad( Resource *matRes, const string &shaderContext )
 }
 
 
-void Renderer::drawGeometry( const string &shaderContext, int theClass,
+void Renderer::drawGeometry( int shaderContext, int theClass,
                              RenderingOrder::List order, int occSet )
 {
 	Modules::sceneMan().setCurrentView( defaultCameraView );
@@ -1476,7 +1652,7 @@ void Renderer::drawGeometry( const string &shaderContext, int theClass,
 }
 
 
-void Renderer::drawLightGeometry( const string &shaderContext, int theClass,
+void Renderer::drawLightGeometry( int shaderContext, int theClass,
                                   bool noShadows, RenderingOrder::List order, int occSet )
 {
 // 	Modules::sceneMan().updateQueues( _curCamera->getFrustum(), 0x0, RenderingOrder::None,
@@ -1563,7 +1739,7 @@ void Renderer::drawLightGeometry( const string &shaderContext, int theClass,
 // 		Modules::sceneMan().updateQueues( _curCamera->getFrustum(), &_curLight->getFrustum(),
 // 		                                  order, SceneNodeFlags::NoDraw, false, true );
 		setupViewMatrices( _curCamera->getViewMat(), _curCamera->getProjMat() );
-		drawRenderables( shaderContext.empty() ? _curLight->_lightingContext : shaderContext,
+		drawRenderables( shaderContext < 0 ? _curLight->_lightingContextId : shaderContext,
 		                 theClass, false, &_curCamera->getFrustum(),
 		                 &_curLight->getFrustum(), order, occSet );
 		Modules().stats().incStat( EngineStats::LightPassCount, 1 );
@@ -1585,7 +1761,7 @@ void Renderer::drawLightGeometry( const string &shaderContext, int theClass,
 }
 
 
-void Renderer::drawLightShapes( const string &shaderContext, bool noShadows, int occSet )
+void Renderer::drawLightShapes( int shaderContext, bool noShadows, int occSet )
 {
 	MaterialResource *curMatRes = 0x0;
 	
@@ -1663,7 +1839,7 @@ void Renderer::drawLightShapes( const string &shaderContext, bool noShadows, int
 		if( curMatRes != _curLight->_materialRes )
 		{
 			if( !setMaterial( _curLight->_materialRes,
-				              shaderContext.empty() ? _curLight->_lightingContext : shaderContext ) )
+				              shaderContext < 0 ? _curLight->_lightingContextId : shaderContext ) )
 			{
 				continue;
 			}
@@ -1724,7 +1900,7 @@ void Renderer::dispatchCompute( MaterialResource *materialRes, const std::string
 // Scene Node Rendering Functions
 // =================================================================================================
 
-void Renderer::drawRenderables( const string &shaderContext, int theClass, bool debugView,
+void Renderer::drawRenderables( int shaderContext, int theClass, bool debugView,
                                 const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
                                 int occSet )
 {
@@ -1755,8 +1931,14 @@ void Renderer::drawRenderables( const string &shaderContext, int theClass, bool
 		{
 			if( _renderFuncRegistry[i].nodeType == renderQueue[firstItem].type )
 			{
-				_renderFuncRegistry[i].renderFunc(
-					firstItem, lastItem, shaderContext, theClass, debugView, frust1, frust2, order, occSet );
+				H3D_PROFILE_ZONE_DETAIL( "Renderer::renderFunc", Profiler::isCapturing() ?
+					Modules::sceneMan().findType( renderQueue[firstItem].type )->typeString.c_str() : 0x0 );
+				if( _renderFuncRegistry[i].renderFunc != 0x0 )
+					_renderFuncRegistry[i].renderFunc(
+						firstItem, lastItem, shaderContext, theClass, debugView, frust1, frust2, order, occSet );
+				else
+					_renderFuncRegistry[i].renderFuncByName( firstItem, lastItem, ShaderResource::getContextName( shaderContext ),
+						theClass, debugView, frust1, frust2, order, occSet );
 				break;
 			}
 		}
@@ -1772,7 +1954,7 @@ void Renderer::drawRenderables( const string &shaderContext, int theClass, bool
 }
 
 
-void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, int theClass,
+void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, int shaderContext, int theClass,
                            bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
                            int occSet )
 {
@@ -1785,6 +1967,7 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const std::string
 	MaterialResource *curMatRes = 0x0;
 
 	DefaultShaderUniforms &uni = Modules::renderer()._uni;
+	bool texStreaming = Modules::config().texStreamingBudget > 0;
 
 	// Loop over mesh queue
 	for( size_t i = firstItem; i <= lastItem; ++i )
@@ -1841,6 +2024,7 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const std::string
 		{
 			curGeoRes = modelNode->getGeometryResource();
 			ASSERT( curGeoRes != 0x0 );
+			curGeoRes->markUsed( Modules::renderer().getFrameID() );
 		
 			rdi->setGeometry( curGeoRes->getGeometryInfo() );
 		}
@@ -1852,6 +2036,7 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const std::string
 			if( !meshNode->getMaterialRes()->isOfClass( theClass ) ) continue;
 			
 			// Set material
+			if( texStreaming ) Modules::renderer()._texRequestMat = meshNode->getMaterialRes();
 			if( curMatRes != meshNode->getMaterialRes() )
 			{
 				if( !Modules::renderer().setMaterial( meshNode->getMaterialRes(), shaderContext ) )
@@ -1861,6 +2046,8 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const std::string
 				}
 				curMatRes = meshNode->getMaterialRes();
 			}
+			
+			if( texStreaming ) Modules::renderer().requestTextureMips( curMatRes, meshNode->getBBox() );
 		}
 		else
 		{
@@ -1926,23 +2113,141 @@ void Renderer::drawMeshes( uint32 firstItem, uint32 lastItem, const std::string
 		if( queryObj )
 			rdi->beginQuery( queryObj );
 		
-		// Render
-		rdi->drawIndexed( meshNode->getPrimType(), meshNode->getBatchStart(), meshNode->getBatchCount(),
-		                  meshNode->getVertRStart(), meshNode->getVertREnd() - meshNode->getVertRStart() + 1 );
-		Modules::stats().incStat( EngineStats::BatchCount, 1 );
-		Modules::stats().incStat( EngineStats::TriCount, meshNode->getBatchCount() / 3.0f );
+		// Render; large static meshes are culled per cluster (skinned geometry has no cluster bounds)
+		uint32 firstCluster, clusterCount;
+		if( meshNode->getPrimType() == PRIM_TRILIST && curGeoRes->_joints.size() <= 1 &&
+		    curGeoRes->getClusterRange( meshNode->getBatchStart(), meshNode->getBatchCount(), firstCluster, clusterCount ) )
+		{
+			Modules::renderer().drawMeshClusters( meshNode, firstCluster, clusterCount, frust1, frust2 );
+		}
+		else
+		{
+			rdi->drawIndexed( meshNode->getPrimType(), meshNode->getBatchStart(), meshNode->getBatchCount(),
+			                  meshNode->getVertRStart(), meshNode->getVertREnd() - meshNode->getVertRStart() + 1 );
+			Modules::stats().incStat( EngineStats::BatchCount, 1 );
+			Modules::stats().incStat( EngineStats::TriCount, meshNode->getBatchCount() / 3.0f );
+		}
 
 		if( queryObj )
 			rdi->endQuery( queryObj );
 	}
 
+	Modules::renderer()._texRequestMat = 0x0;
+
 	// Draw occlusion proxies
 	if( occSet >= 0 )
 		Modules::renderer().drawOccProxies( OCCPROXYLIST_RENDERABLES );
 }
 
 
-void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, int theClass,
+void Renderer::drawMeshClusters( MeshNode *meshNode, uint32 firstCluster, uint32 clusterCount,
+                                 const Frustum *frust1, const Frustum *frust2 )
+{
+	const GeometryCluster *clusters = meshNode->getParentModel()->getGeometryResource()->getClusters() + firstCluster;
+	const Matrix4f &worldMat = meshNode->_absTrans;
+	
+	// Bounding spheres are transformed to world space and scaled by the largest axis scale
+	float scale = sqrtf( std::max( std::max(
+		Vec3f( worldMat.c[0][0], worldMat.c[0][1], worldMat.c[0][2] ).length_squared(),
+		Vec3f( worldMat.c[1][0], worldMat.c[1][1], worldMat.c[1][2] ).length_squared() ),
+		Vec3f( worldMat.c[2][0], worldMat.c[2][1], worldMat.c[2][2] ).length_squared() ) );
+
+	// Normal cones are only conclusive if back faces are culled and all view rays start at the
+	// viewer; mirroring transformations swap front and back faces. The test is done in model space
+	// where the cone axes are defined
+	RDICullMode cullMode;
+	_renderDevice->getCullMode( cullMode );
+	bool coneCulling = cullMode == RS_CULL_BACK && !Modules::config().wireframeMode &&
+	                   frust1->isPerspective() && worldMat.determinant() > 0;
+	Vec3f viewPos = coneCulling ? worldMat.inverted() * frust1->getOrigin() : Vec3f( 0, 0, 0 );
+
+	auto cullClusters = [&]( uint32 first, uint32 last )
+	{
+		for( uint32 i = first; i < last; ++i )
+		{
+			const GeometryCluster &cl = clusters[i];
+			bool visible = true;
+
+			// Culled if all triangles face away from the viewer: the angle between the view direction and
+			// any normal is at most the angle to the axis plus the cone angle and must stay below 90 degrees
+			// for all points of the sphere
+			if( coneCulling && cl.coneCutoff > 0 )
+			{
+				Vec3f dir = cl.center - viewPos;
+				float dist = dir.length();
+				float cosAxis = dist > 0 ? dir.dot( cl.coneAxis ) / dist : -1.0f;
+				if( cosAxis > 0 )
+				{
+					float sinAxis = sqrtf( std::max( 1 - cosAxis * cosAxis, 0.0f ) );
+					float sinCutoff = sqrtf( std::max( 1 - cl.coneCutoff * cl.coneCutoff, 0.0f ) );
+					visible = dist * (cosAxis * cl.coneCutoff - sinAxis * sinCutoff) <= cl.radius;
+				}
+			}
+			
+			if( visible )
+			{
+				Vec3f center = worldMat * cl.center;
+				float radius = cl.radius * scale;
+				visible = !frust1->cullSphere( center, radius ) && (frust2 == 0x0 || !frust2->cullSphere( center, radius ));
+			}
+			
+			_clusterVisibility[i] = visible ? 1 : 0;
+		}
+	};
+
+	_clusterVisibility.resize( std::max( (uint32)_clusterVisibility.size(), clusterCount ) );
+	const uint32 clustersPerJob = 256;
+	if( clusterCount >= clustersPerJob * 4 )
+		Modules::jobs().parallelFor( clusterCount, clustersPerJob, cullClusters );
+	else
+		cullClusters( 0, clusterCount );
+
+	// Merge consecutive visible clusters into ranges
+	uint32 culledIndices = 0;
+	for( uint32 i = 0; i < clusterCount; )
+	{
+		if( !_clusterVisibility[i] )
+		{
+			culledIndices += clusters[i++].indexCount;
+			continue;
+		}
+
+		uint32 first = clusters[i].firstIndex, count = 0;
+		for( ; i < clusterCount && _clusterVisibility[i]; ++i ) count += clusters[i].indexCount;
+		
+		_renderDevice->drawIndexed( PRIM_TRILIST, first, count, meshNode->getVertRStart(),
+		                            meshNode->getVertREnd() - meshNode->getVertRStart() + 1 );
+		Modules::stats().incStat( EngineStats::BatchCount, 1 );
+		Modules::stats().incStat( EngineStats::TriCount, count / 3.0f );
+	}
+	Modules::stats().incStat( EngineStats::CulledTriCount, culledIndices / 3.0f );
+}
+
+
+void Renderer::requestTextureMips( MaterialResource *materialRes, const BoundingBox &bBox )
+{
+	// Estimate the size of the bounding sphere on screen in pixels
+	const Matrix4f &projMat = _curCamera->getProjMat();
+	float radius = (bBox.max - bBox.min).length() * 0.5f;
+	float size = radius * projMat.c[1][1] * _curCamera->getViewportHeight();
+	if( projMat.c[3][3] == 0 )
+	{
+		float dist = ((bBox.min + bBox.max) * 0.5f - _curCamera->getAbsTrans().getTrans()).length();
+		size = dist > radius ? size / dist : Math::MaxFloat;
+	}
+
+	for( MaterialResource *matRes = materialRes; matRes != 0x0; matRes = matRes->_matLink )
+	{
+		for( size_t i = 0, si = matRes->_samplers.size(); i < si; ++i )
+		{
+			TextureResource *texRes = matRes->_samplers[i].texRes;
+			if( texRes != 0x0 && texRes->isStreamed() ) texRes->requestScreenSize( size, _frameID );
+		}
+	}
+}
+
+
+void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, int shaderContext, int theClass,
                               bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
                               int occSet )
 {
@@ -2103,7 +2408,7 @@ void Renderer::drawParticles( uint32 firstItem, uint32 lastItem, const std::stri
 }
 
 
-void Renderer::drawComputeResults( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, int theClass,
+void Renderer::drawComputeResults( uint32 firstItem, uint32 lastItem, int shaderContext, int theClass,
 								   bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order,
 								   int occSet )
 {
@@ -2212,6 +2517,8 @@ void Renderer::render( CameraNode *camNode )
 	_curCamera = camNode;
 	if( _curCamera == 0x0 ) return;
 
+	H3D_PROFILE_ZONE( "Renderer::render" );
+
 	// Build sampler anisotropy mask from anisotropy value
 	int maxAniso = Modules::config().maxAnisotropy;
 	if( maxAniso <= 1 ) _maxAnisoMask = SS_ANISO1;
@@ -2222,6 +2529,15 @@ void Renderer::render( CameraNode *camNode )
 	_renderDevice->beginRendering();
 	_renderDevice->setViewport( _curCamera->_vpX, _curCamera->_vpY, _curCamera->_vpWidth, _curCamera->_vpHeight );
 
+	// Load and reduce mip levels of streamed textures based on the requests of the last frame
+	if( _texStreamFrameID != _frameID )
+	{
+		H3D_PROFILE_ZONE( "TextureStreaming" );
+		
+		TextureResource::updateStreaming();
+		_texStreamFrameID = _frameID;
+	}
+
 	// Perform culling
 	prepareRenderViews();
 
@@ -2245,12 +2561,17 @@ void Renderer::render( CameraNode *camNode )
 		PipelineStage &stage = _curCamera->_pipelineRes->_stages[i];
 		if( !stage.enabled ) continue;
 		_curStageMatLink = stage.matLink;
+
+		H3D_PROFILE_ZONE_DETAIL( "PipelineStage", stage.id.c_str() );
 		
 		for( uint32 j = 0; j < stage.commands.size(); ++j )
 		{
 			PipelineCommand &pc = stage.commands[j];
 			RenderTarget *rt;
 
+			H3D_PROFILE_ZONE( pc.command < DefaultPipelineCommands::ExternalCommand ?
+			                  pipeCmdProfNames[pc.command] : "ExternalCommand" );
+
 			switch( pc.command )
 			{
 			case DefaultPipelineCommands::SwitchTarget:
@@ -2293,22 +2614,22 @@ void Renderer::render( CameraNode *camNode )
 				break;
 
 			case DefaultPipelineCommands::DrawGeometry:
-				drawGeometry( pc.params[0].getString(), pc.params[1].getInt(),
+				drawGeometry( pc.params[0].getInt(), pc.params[1].getInt(),
 				              (RenderingOrder::List)pc.params[2].getInt(), _curCamera->_occSet );
 				break;
 
 			case DefaultPipelineCommands::DrawQuad:
-				drawFSQuad( pc.params[0].getResource(), pc.params[1].getString() );
+				drawFSQuad( pc.params[0].getResource(), pc.params[1].getInt() );
 			break;
 
 			case DefaultPipelineCommands::DoForwardLightLoop:
-				drawLightGeometry( pc.params[0].getString(), pc.params[1].getInt(),
+				drawLightGeometry( pc.params[0].getInt(), pc.params[1].getInt(),
 				                   pc.params[2].getBool(), (RenderingOrder::List)pc.params[3].getInt(),
 								   _curCamera->_occSet );
 				break;
 
 			case DefaultPipelineCommands::DoDeferredLightLoop:
-				drawLightShapes( pc.params[0].getString(), pc.params[1].getBool(), _curCamera->_occSet );
+				drawLightShapes( pc.params[0].getInt(), pc.params[1].getBool(), _curCamera->_occSet );
 				break;
 
 			case DefaultPipelineCommands::SetUniform:
@@ -2337,7 +2658,13 @@ void Renderer::render( CameraNode *camNode )
 
 void Renderer::finalizeFrame()
 {
+	// Frame N must be finished before the render proxies are updated with frame N+1
+	syncRenderThread();
+	
 	++_frameID;
+
+	// Evict least recently used resources of types that exceed their memory budget
+	Modules::resMan().enforceMemoryBudgets( _frameID );
 	
 	// Reset frame timer
 	Timer *timer = Modules::stats().getTimer( EngineStats::FrameTime );
@@ -2345,6 +2672,188 @@ void Renderer::finalizeFrame()
 	Modules::stats().getStat( EngineStats::FrameTime, true );  // Reset
 	Modules::stats().incStat( EngineStats::FrameTime, timer->getElapsedTimeMS() );
 	timer->reset();
+
+	if( _pipelined )
+	{
+		Modules::sceneMan().updateRenderProxies();
+		Modules::extMan().onFrameSnapshot();
+		
+		// Hand the context over to the render thread if the application took it
+		if( rdiContextCurrent )
+		{
+			_renderThreadCallback( RenderThreadEvents::ReleaseContext, _renderThreadUserData );
+			rdiContextCurrent = false;
+		}
+
+		std::lock_guard< std::mutex > lock( _renderThreadMutex );
+		_renderCameras.swap( _queuedCameras );
+		_queuedCameras.resize( 0 );
+		_frameInFlight = true;
+		_renderThreadCond.notify_all();
+	}
+
+	// Deliver log messages that were queued during the frame
+	Modules::log().drain();
+}
+
+
+// =================================================================================================
+// Pipelined Rendering
+// =================================================================================================
+
+thread_local bool rdiContextCurrent = true;
+
+
+bool Renderer::setPipelinedRendering( bool enabled )
+{
+	if( enabled == _pipelined ) return true;
+
+	if( enabled )
+	{
+		if( _renderThreadCallback == 0x0 )
+		{
+			Modules::log().writeError( "Pipelined rendering requires a render thread callback" );
+			return false;
+		}
+
+		Modules::sceneMan().setRenderProxiesEnabled( true );
+		Modules::sceneMan().updateRenderProxies();
+		
+		_queuedCameras.resize( 0 );
+		_renderCameras.resize( 0 );
+		_frameInFlight = false;
+		_contextRequested = false;
+		_renderThreadExit = false;
+		_pipelined = true;
+		_renderThread = std::thread( &Renderer::renderThreadLoop, this );
+		
+		return true;
+	}
+	
+	syncRenderThread();
+	{
+		std::lock_guard< std::mutex > lock( _renderThreadMutex );
+		_renderThreadExit = true;
+		_renderThreadCond.notify_all();
+	}
+	_renderThread.join();
+	_pipelined = false;
+
+	// Continue on the application thread
+	if( !rdiContextCurrent )
+	{
+		_renderThreadCallback( RenderThreadEvents::AcquireContext, _renderThreadUserData );
+		rdiContextCurrent = true;
+	}
+
+	_queuedCameras.resize( 0 );
+	_renderCameras.resize( 0 );
+	Modules::sceneMan().setRenderProxiesEnabled( false );
+
+	return true;
+}
+
+
+void Renderer::setRenderThreadCallback( RenderThreadCallback callback, void *userData )
+{
+	syncRenderThread();
+	
+	_renderThreadCallback = callback;
+	_renderThreadUserData = userData;
+}
+
+
+void Renderer::queueRender( CameraNode *camNode )
+{
+	// Cameras are referenced by handle, since the render thread draws with their proxies
+	if( camNode != 0x0 ) _queuedCameras.push_back( camNode->getHandle() );
+}
+
+
+void Renderer::syncRenderThread()
+{
+	if( !_pipelined || std::this_thread::get_id() == _renderThread.get_id() ) return;
+	
+	std::unique_lock< std::mutex > lock( _renderThreadMutex );
+	_renderThreadCond.wait( lock, [this] { return !_frameInFlight; } );
+}
+
+
+void Renderer::acquireRenderContext()
+{
+	// The render thread is idle while another thread has the context
+	if( rdiContextCurrent ) return;
+	
+	if( _pipelined && std::this_thread::get_id() != _renderThread.get_id() )
+	{
+		H3D_PROFILE_ZONE( "Renderer::acquireRenderContext" );
+		
+		// Wait for the current frame and ask the render thread to give up the context
+		std::unique_lock< std::mutex > lock( _renderThreadMutex );
+		_renderThreadCond.wait( lock, [this] { return !_frameInFlight; } );
+		_contextRequested = true;
+		_renderThreadCond.notify_all();
+		_renderThreadCond.wait( lock, [this] { return !_contextRequested; } );
+		lock.unlock();
+
+		_renderThreadCallback( RenderThreadEvents::AcquireContext, _renderThreadUserData );
+	}
+
+	rdiContextCurrent = true;
+}
+
+
+void Renderer::renderThreadLoop()
+{
+	Profiler::setThreadName( "Render Thread" );
+	rdiContextCurrent = false;
+
+	std::unique_lock< std::mutex > lock( _renderThreadMutex );
+	
+	for(;;)
+	{
+		_renderThreadCond.wait( lock, [this] { return _frameInFlight || _contextRequested || _renderThreadExit; } );
+
+		if( _frameInFlight )
+		{
+			lock.unlock();
+
+			if( !rdiContextCurrent )
+			{
+				_renderThreadCallback( RenderThreadEvents::AcquireContext, _renderThreadUserData );
+				rdiContextCurrent = true;
+			}
+
+			SceneManager &scm = Modules::sceneMan();
+			for( size_t i = 0; i < _renderCameras.size(); ++i )
+			{
+				SceneNode *cam = scm.getRenderProxy( _renderCameras[i] );
+				if( cam != 0x0 && cam->getType() == SceneNodeTypes::Camera )
+					render( (CameraNode *)cam );
+			}
+			
+			_renderCameras.resize( 0 );
+			_curCamera = 0x0;
+			_curLight = 0x0;
+			_renderThreadCallback( RenderThreadEvents::PresentFrame, _renderThreadUserData );
+
+			lock.lock();
+			_frameInFlight = false;
+			_renderThreadCond.notify_all();
+			continue;
+		}
+		
+		// Give up the context when it is requested by another thread or when the thread exits
+		if( rdiContextCurrent )
+		{
+			_renderThreadCallback( RenderThreadEvents::ReleaseContext, _renderThreadUserData );
+			rdiContextCurrent = false;
+		}
+		_contextRequested = false;
+		_renderThreadCond.notify_all();
+
+		if( _renderThreadExit ) break;
+	}
 }
 
 
@@ -2367,7 +2876,7 @@ void Renderer::renderDebugView()
 
 	// Draw renderable nodes as wireframe
 	setupViewMatrices( _curCamera->getViewMat(), _curCamera->getProjMat() );
-	drawRenderables( "", 0, true, &_curCamera->getFrustum(), 0x0, RenderingOrder::None, -1 );
+	drawRenderables( -1, 0, true, &_curCamera->getFrustum(), 0x0, RenderingOrder::None, -1 );
 
 	// Draw bounding boxes
 	_renderDevice->setCullMode( RS_CULL_NONE );
@@ -21,6 +21,9 @@
 #include <algorithm>
 #include <string>
 #include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace Horde3D {
 
@@ -39,18 +42,41 @@ extern const char *vsOccBox;
 extern const char *fsOccBox;
 	
 
+// =================================================================================================
+// Pipelined Rendering
+// =================================================================================================
+
+struct RenderThreadEvents
+{
+	enum List
+	{
+		AcquireContext = 0,
+		ReleaseContext,
+		PresentFrame
+	};
+};
+
+typedef void (*RenderThreadCallback)( int event, void *userData );
+
 // =================================================================================================
 // Renderer
 // =================================================================================================
 
-typedef void (*RenderFunc)( uint32 firstItem, uint32 lastItem, const std::string &shaderContext,
+// The shader context is passed as global context id (see ShaderResource::getContextId)
+typedef void (*RenderFunc)( uint32 firstItem, uint32 lastItem, int shaderContext,
                             int theClass, bool debugView, const Frustum *frust1,
                             const Frustum *frust2, RenderingOrder::List order, int occSet );
 
+// Previous signature with the context name, still accepted for existing extensions
+typedef void (*RenderFuncByName)( uint32 firstItem, uint32 lastItem, const std::string &shaderContext,
+                                  int theClass, bool debugView, const Frustum *frust1,
+                                  const Frustum *frust2, RenderingOrder::List order, int occSet );
+
 struct RenderFuncListItem
 {
-	int         nodeType;
-	RenderFunc  renderFunc;
+	int               nodeType;
+	RenderFunc        renderFunc;
+	RenderFuncByName  renderFuncByName;
 };
 
 struct RenderBackendType
@@ -135,7 +161,8 @@ struct DefaultVertexLayouts
 	{
 		Position = 0,
 		Particle,
-		Model
+		Model,
+		ModelQuantized
 	};
 };
 
@@ -159,6 +186,7 @@ public:
 	void initStates();
 
 	void registerRenderFunc( int nodeType, RenderFunc rf );
+	void registerRenderFunc( int nodeType, RenderFuncByName rf );
 
 	unsigned char *useScratchBuf( uint32 minSize, uint32 alignment );
 	void setupViewMatrices( const Matrix4f &viewMat, const Matrix4f &projMat );
@@ -172,10 +200,17 @@ public:
 	// Shader & material handling
 	bool createShaderComb( ShaderCombination &sc, const char *vertexShader, const char *fragmentShader, const char *geometryShader,
 						   const char *tessControlShader, const char *tessEvaluationShader, const char *computeShader );
+	bool beginCreatingShaderComb( ShaderCombination &sc, const char *vertexShader, const char *fragmentShader, const char *geometryShader,
+								  const char *tessControlShader, const char *tessEvaluationShader, const char *computeShader );
+	bool finishCreatingShaderComb( ShaderCombination &sc );
+	bool precompileShaders( const std::vector< MaterialResource * > &materials );
+	ShaderCache &getShaderCache() { return _shaderCache; }
 	void releaseShaderComb( ShaderCombination &sc );
 	void setShaderComb( ShaderCombination *sc );
 	void commitGeneralUniforms();
-	bool setMaterial( MaterialResource *materialRes, const std::string &shaderContext );
+	bool setMaterial( MaterialResource *materialRes, int shaderContext );
+	bool setMaterial( MaterialResource *materialRes, const std::string &shaderContext )
+		{ return setMaterial( materialRes, ShaderResource::getContextId( shaderContext ) ); }
 	
 	bool createShadowRB( uint32 width, uint32 height );
 	void releaseShadowRB();
@@ -192,16 +227,24 @@ public:
 	void drawSphere( const Vec3f &pos, float radius );
 	void drawCone( float height, float fov, const Matrix4f &transMat );
 
-	static void drawMeshes( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, int theClass,
+	static void drawMeshes( uint32 firstItem, uint32 lastItem, int shaderContext, int theClass,
 		bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
-	static void drawParticles( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, int theClass,
+	static void drawParticles( uint32 firstItem, uint32 lastItem, int shaderContext, int theClass,
 		bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
-	static void drawComputeResults( uint32 firstItem, uint32 lastItem, const std::string &shaderContext, int theClass, 
+	static void drawComputeResults( uint32 firstItem, uint32 lastItem, int shaderContext, int theClass, 
 									bool debugView, const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
 
 	void render( CameraNode *camNode );
 	void finalizeFrame();
 
+	// Pipelined rendering
+	bool setPipelinedRendering( bool enabled );
+	bool isPipelined() const { return _pipelined; }
+	void setRenderThreadCallback( RenderThreadCallback callback, void *userData );
+	void queueRender( CameraNode *camNode );
+	void syncRenderThread();
+	void acquireRenderContext();  // Syncs as well; required before device calls outside of rendering
+
 	void dispatchCompute( MaterialResource *materialRes, const std::string &context, uint32 groups_x, uint32 groups_y, uint32 groups_z );
 
 	// Getters
@@ -220,7 +263,7 @@ protected:
 	
 	void createPrimitives();
 	
-	bool setMaterialRec( MaterialResource *materialRes, const std::string &shaderContext, ShaderResource *shaderRes );
+	bool setMaterialRec( MaterialResource *materialRes, int shaderContext, ShaderResource *shaderRes );
 	
 	void prepareRenderViews();
 
@@ -238,19 +281,24 @@ protected:
 	// Drawing functions
 	void bindPipeBuffer( uint32 rbObj, const std::string &sampler, uint32 bufIndex );
 	void clear( bool depth, bool buf0, bool buf1, bool buf2, bool buf3, float r, float g, float b, float a );
-	void drawFSQuad( Resource *matRes, const std::string &shaderContext );
-	void drawGeometry( const std::string &shaderContext, int theClass,
+	void drawFSQuad( Resource *matRes, int shaderContext );
+	void drawGeometry( int shaderContext, int theClass,
 	                   RenderingOrder::List order, int occSet );
-	void drawLightGeometry( const std::string &shaderContext, int theClass,
+	void drawLightGeometry( int shaderContext, int theClass,
 	                        bool noShadows, RenderingOrder::List order, int occSet );
-	void drawLightShapes( const std::string &shaderContext, bool noShadows, int occSet );
+	void drawLightShapes( int shaderContext, bool noShadows, int occSet );
 	
-	void drawRenderables( const std::string &shaderContext, int theClass, bool debugView,
+	void drawRenderables( int shaderContext, int theClass, bool debugView,
 		const Frustum *frust1, const Frustum *frust2, RenderingOrder::List order, int occSet );
+	void drawMeshClusters( MeshNode *meshNode, uint32 firstCluster, uint32 clusterCount,
+		const Frustum *frust1, const Frustum *frust2 );
+	void requestTextureMips( MaterialResource *materialRes, const BoundingBox &bBox );
 	
 	void renderDebugView();
 	void finishRendering();
 
+	void renderThreadLoop();
+
 	RenderDeviceInterface	*createRenderDevice( int type );
 	void					releaseRenderDevice();
 
@@ -265,6 +313,7 @@ protected:
 	std::vector< PipeSamplerBinding >  _pipeSamplerBindings;
 	std::vector< char >                _occSets;  // Actually bool
 	std::vector< OccProxy >            _occProxies[2];  // 0: renderables, 1: lights
+	std::vector< char >                _clusterVisibility;  // Actually bool
 
 	std::vector< EngineUniform >	   _engineUniforms; // uniforms, that are used internally by the engine and extensions
 	std::vector< ShadowParameters >	   _shadowParams; // shadow lightmaps and project matrices
@@ -283,11 +332,13 @@ protected:
 
 	uint32                             _shadowRB;
 	uint32                             _frameID;
+	uint32                             _texStreamFrameID;  // Frame of last texture streaming update
 	uint32                             _defShadowMap;
 	uint32                             _quadIdxBuf;
 	uint32                             _particleVBO;
 
 	MaterialResource                   *_curStageMatLink;
+	MaterialResource                   *_texRequestMat;  // Material whose textures are requested per mesh
 	CameraNode                         *_curCamera;
 	LightNode                          *_curLight;
 	ShaderCombination                  *_curShader;
@@ -300,15 +351,28 @@ protected:
 	float                              _splitPlanes[5];
 	Matrix4f                           _lightMats[4];
 
-	uint32                             _vlPosOnly, _vlModel, _vlParticle;
+	uint32                             _vlPosOnly, _vlModel, _vlModelQuantized, _vlParticle;
 	ShaderCombination                  _defColorShader;
 	int                                _defColShader_color;  // Uniform location
+	ShaderCache                        _shaderCache;
 	
 	uint32                             _vbCube, _ibCube, _vbSphere, _ibSphere;
 	uint32                             _vbCone, _ibCone, _vbFSPoly;
 	
 	int									_renderDeviceType;
 
+	// Pipelined rendering; the render thread draws frame N while the application updates frame N+1
+	std::thread                        _renderThread;
+	std::mutex                         _renderThreadMutex;
+	std::condition_variable            _renderThreadCond;
+	std::vector< NodeHandle >          _queuedCameras, _renderCameras;
+	RenderThreadCallback               _renderThreadCallback;
+	void                               *_renderThreadUserData;
+	bool                               _pipelined;
+	bool                               _frameInFlight;
+	bool                               _contextRequested;
+	bool                               _renderThreadExit;
+
 };
 
 }
@@ -24,6 +24,13 @@ namespace Horde3D {
 
 // =================================================================================================
 
+// False for threads that do not have the render context current. Only used when rendering is
+// pipelined; functions that can reach the device from the application thread acquire the context
+// first (see Renderer::acquireRenderContext), which is checked for each device call in debug builds.
+extern thread_local bool rdiContextCurrent;
+
+// =================================================================================================
+
 //
 // Delegate interface inspired by works of marcmo (github.com/marcmo/delegates) 
 // and Stefan Reinalter (https://blog.molecular-matters.com/)
@@ -58,6 +65,7 @@ public:
 
 	R invoke( Params... args )
 	{
+		ASSERT( rdiContextCurrent );
 		return stub.second( stub.first, args...  );
 	}
 private:
@@ -184,6 +192,8 @@ struct DeviceCaps
 	bool	texETC2;
 	bool	texASTC;
 	bool	texBPTC;
+	bool	packedVertexAttribs;	// Half float and 10_10_10_2 vertex attributes
+	bool	shaderBinaries;			// Linked shader programs can be retrieved and reloaded as binaries
 };
 
 
@@ -191,12 +201,23 @@ struct DeviceCaps
 // Vertex layout
 // ---------------------------------------------------------
 
+enum RDIVertexAttribFormat
+{
+	VAFMT_FLOAT = 0,			// 32 bit float
+	VAFMT_HALF,					// 16 bit float
+	VAFMT_SNORM_10_10_10_2,		// Signed normalized components packed into 32 bit; size must be 4
+	VAFMT_UNORM16,				// Unsigned normalized 16 bit integer
+	VAFMT_UNORM8,				// Unsigned normalized 8 bit integer
+	VAFMT_UINT8					// 8 bit integer converted to float
+};
+
 struct VertexLayoutAttrib
 {
-	std::string  semanticName;
-	uint32       vbSlot;
-	uint32       size;
-	uint32       offset;
+	std::string            semanticName;
+	uint32                 vbSlot;
+	uint32                 size;
+	uint32                 offset;
+	RDIVertexAttribFormat  format;
 };
 
 struct RDIVertexLayout
@@ -525,7 +546,10 @@ protected:
 	RDIDelegate< bool ( uint32, int, int, void * ) >					_delegate_getTextureData;
 	RDIDelegate< void ( uint32, void * ) >								_delegate_bindImageToTexture;
 
-	RDIDelegate< uint32 ( const char *, const char *, const char *, const char *, const char *, const char * ) > _delegate_createShader;
+	RDIDelegate< uint32 ( const char *, const char *, const char *, const char *, const char *, const char * ) > _delegate_beginCreatingShader;
+	RDIDelegate< bool ( uint32 & ) >									_delegate_finishCreatingShader;
+	RDIDelegate< uint32 ( uint32, const void *, uint32 ) >				_delegate_createShaderFromBinary;
+	RDIDelegate< bool ( uint32, uint32 &, std::vector< char > & ) >		_delegate_getShaderBinary;
 	RDIDelegate< void ( uint32 & ) >									_delegate_destroyShader;
 	RDIDelegate< void ( uint32 ) >										_delegate_bindShader;
 	RDIDelegate< int ( uint32, const char * ) >							_delegate_getShaderConstLoc;
@@ -769,8 +793,31 @@ public:
 	uint32 createShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc, 
 						 const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc ) 
 	{
-		return _delegate_createShader.invoke( vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, 
-											  tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc );
+		uint32 shaderId = beginCreatingShader( vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, 
+											   tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc );
+		finishCreatingShader( shaderId );
+		return shaderId;
+	}
+	// Shader creation is split so that the driver can compile several programs in parallel; the status
+	// is only queried when finishing, which destroys the shader and sets the id to 0 if it failed
+	uint32 beginCreatingShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc, 
+								const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc ) 
+	{
+		return _delegate_beginCreatingShader.invoke( vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, 
+													 tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc );
+	}
+	bool finishCreatingShader( uint32 &shaderId )
+	{
+		return _delegate_finishCreatingShader.invoke( shaderId );
+	}
+	// Program binaries are only valid for the device and driver version they were retrieved from
+	uint32 createShaderFromBinary( uint32 format, const void *data, uint32 size )
+	{
+		return _delegate_createShaderFromBinary.invoke( format, data, size );
+	}
+	bool getShaderBinary( uint32 shaderId, uint32 &format, std::vector< char > &data )
+	{
+		return _delegate_getShaderBinary.invoke( shaderId, format, data );
 	}
 	void destroyShader( uint32& shaderId )
 	{
@@ -784,6 +831,10 @@ public:
 	{
 		return _shaderLog; 
 	}
+	const std::string &getDeviceInfo() const
+	{
+		return _deviceInfo;
+	}
 	int getShaderConstLoc( uint32 shaderId, const char *name ) 
 	{ 
 		return _delegate_getShaderConstLoc.invoke( shaderId, name );
@@ -999,6 +1050,7 @@ protected:
 	RDIDrawBarriers				_memBarriers;
 
 	std::string					_shaderLog;
+	std::string					_deviceInfo;  // Backend and driver identification, used for invalidating shader binaries
 	uint32						_depthFormat;
 	int							_vpX, _vpY, _vpWidth, _vpHeight;
 	int							_scX, _scY, _scWidth, _scHeight;
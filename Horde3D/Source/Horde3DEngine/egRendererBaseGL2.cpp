@@ -53,6 +53,10 @@ static const uint32 textureTypes[ 3 ] = { GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTU
 
 static const uint32 bufferMappingTypes[ 3 ] = { GL_READ_ONLY, GL_WRITE_ONLY, GL_READ_WRITE };
 
+static const uint32 vertexAttribTypes[ 6 ] = { GL_FLOAT, GL_HALF_FLOAT, GL_INT_2_10_10_10_REV, GL_UNSIGNED_SHORT, GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE };
+
+static const GLboolean vertexAttribNormalized[ 6 ] = { GL_FALSE, GL_FALSE, GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE };
+
 // Texture formats mapping to supported non compressed GL texture formats
 struct GLTextureFormatAndType
 {
@@ -275,7 +279,10 @@ void RenderDeviceGL2::initRDIFuncs()
 	_delegate_getTextureData.bind< RenderDeviceGL2, &RenderDeviceGL2::getTextureData >( this );
 	_delegate_bindImageToTexture.bind< RenderDeviceGL2, &RenderDeviceGL2::bindImageToTexture >( this );
 
-	_delegate_createShader.bind< RenderDeviceGL2, &RenderDeviceGL2::createShader >( this );
+	_delegate_beginCreatingShader.bind< RenderDeviceGL2, &RenderDeviceGL2::beginCreatingShader >( this );
+	_delegate_finishCreatingShader.bind< RenderDeviceGL2, &RenderDeviceGL2::finishCreatingShader >( this );
+	_delegate_createShaderFromBinary.bind< RenderDeviceGL2, &RenderDeviceGL2::createShaderFromBinary >( this );
+	_delegate_getShaderBinary.bind< RenderDeviceGL2, &RenderDeviceGL2::getShaderBinary >( this );
 	_delegate_destroyShader.bind< RenderDeviceGL2, &RenderDeviceGL2::destroyShader >( this );
 	_delegate_bindShader.bind< RenderDeviceGL2, &RenderDeviceGL2::bindShader >( this );
 	_delegate_getShaderConstLoc.bind< RenderDeviceGL2, &RenderDeviceGL2::getShaderConstLoc >( this );
@@ -406,6 +413,13 @@ bool RenderDeviceGL2::init()
 	_caps.texETC2 = false;
 	_caps.texBPTC = glExt::ARB_texture_compression_bptc;
 	_caps.texASTC = false;
+	_caps.packedVertexAttribs = false;
+	_caps.shaderBinaries = false;
+
+	_deviceInfo = std::string( "GL2|" ) + vendor + "|" + renderer + "|" + version;
+
+	// Let the driver compile shaders that are created in a batch on its own threads
+	if( glExt::KHR_parallel_shader_compile ) glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
 
 	// Init states before creating test render buffer, to
 	// ensure binding the current FBO again
@@ -933,94 +947,87 @@ void RenderDeviceGL2::bindImageToTexture(uint32 texObj, void *eglImage)
 
 uint32 RenderDeviceGL2::createShaderProgram( const char *vertexShaderSrc, const char *fragmentShaderSrc )
 {
-	int infologLength = 0;
-	int charsWritten = 0;
-	char *infoLog = 0x0;
-	int status;
-
-	_shaderLog = "";
-
-	// Vertex shader
+	// Compile status is not queried here, since that would wait for the compiler; errors
+	// are collected in checkShaderProgram after linking
 	uint32 vs = glCreateShader( GL_VERTEX_SHADER );
 	glShaderSource( vs, 1, &vertexShaderSrc, 0x0 );
 	glCompileShader( vs );
-	glGetShaderiv( vs, GL_COMPILE_STATUS, &status );
-	if( !status )
-	{	
-		// Get info
-		glGetShaderiv( vs, GL_INFO_LOG_LENGTH, &infologLength );
-		if( infologLength > 1 )
-		{
-			infoLog = new char[infologLength];
-			glGetShaderInfoLog( vs, infologLength, &charsWritten, infoLog );
-			_shaderLog = _shaderLog + "[Vertex Shader]\n" + infoLog;
-			delete[] infoLog; infoLog = 0x0;
-		}
 
-		glDeleteShader( vs );
-		return 0;
-	}
-
-	// Fragment shader
 	uint32 fs = glCreateShader( GL_FRAGMENT_SHADER );
 	glShaderSource( fs, 1, &fragmentShaderSrc, 0x0 );
 	glCompileShader( fs );
-	glGetShaderiv( fs, GL_COMPILE_STATUS, &status );
-	if( !status )
-	{	
-		glGetShaderiv( fs, GL_INFO_LOG_LENGTH, &infologLength );
-		if( infologLength > 1 )
-		{
-			infoLog = new char[infologLength];
-			glGetShaderInfoLog( fs, infologLength, &charsWritten, infoLog );
-			_shaderLog = _shaderLog + "[Fragment Shader]\n" + infoLog;
-			delete[] infoLog; infoLog = 0x0;
-		}
-
-		glDeleteShader( vs );
-		glDeleteShader( fs );
-		return 0;
-	}
 
 	// Shader program
 	uint32 program = glCreateProgram();
 	glAttachShader( program, vs );
 	glAttachShader( program, fs );
-	glDeleteShader( vs );
+	glDeleteShader( vs );  // Deleted when detached from program
 	glDeleteShader( fs );
 
+	glLinkProgram( program );
+
 	return program;
 }
 
 
-bool RenderDeviceGL2::linkShaderProgram( uint32 programObj )
+bool RenderDeviceGL2::checkShaderProgram( uint32 programObj )
 {
 	int infologLength = 0;
 	int charsWritten = 0;
 	char *infoLog = 0x0;
-	int status;
+	int status, linkStatus;
 
 	_shaderLog = "";
-	
-	glLinkProgram( programObj );
-	glGetProgramiv( programObj, GL_INFO_LOG_LENGTH, &infologLength );
-	if( infologLength > 1 )
+
+	glGetProgramiv( programObj, GL_LINK_STATUS, &linkStatus );
+
+	uint32 shaders[ 2 ];
+	int shaderCount = 0;
+	bool compiled = true;
+	glGetAttachedShaders( programObj, 2, &shaderCount, shaders );
+
+	for( int i = 0; i < shaderCount; ++i )
 	{
-		infoLog = new char[infologLength];
-		glGetProgramInfoLog( programObj, infologLength, &charsWritten, infoLog );
-		_shaderLog = _shaderLog + "[Linking]\n" + infoLog;
-		delete[] infoLog; infoLog = 0x0;
+		if( !linkStatus )
+		{
+			glGetShaderiv( shaders[ i ], GL_COMPILE_STATUS, &status );
+			glGetShaderiv( shaders[ i ], GL_INFO_LOG_LENGTH, &infologLength );
+			if( !status && infologLength > 1 )
+			{
+				int type;
+				glGetShaderiv( shaders[ i ], GL_SHADER_TYPE, &type );
+				_shaderLog += type == GL_VERTEX_SHADER ? "[Vertex Shader]\n" : "[Fragment Shader]\n";
+
+				infoLog = new char[ infologLength ];
+				glGetShaderInfoLog( shaders[ i ], infologLength, &charsWritten, infoLog );
+				_shaderLog += infoLog;
+				delete[] infoLog; infoLog = 0x0;
+			}
+			compiled &= status != 0;
+		}
+
+		// Frees the shader object
+		glDetachShader( programObj, shaders[ i ] );
 	}
-	
-	glGetProgramiv( programObj, GL_LINK_STATUS, &status );
-	if( !status ) return false;
 
-	return true;
+	if( compiled )
+	{
+		glGetProgramiv( programObj, GL_INFO_LOG_LENGTH, &infologLength );
+		if( infologLength > 1 )
+		{
+			infoLog = new char[infologLength];
+			glGetProgramInfoLog( programObj, infologLength, &charsWritten, infoLog );
+			_shaderLog = _shaderLog + "[Linking]\n" + infoLog;
+			delete[] infoLog; infoLog = 0x0;
+		}
+	}
+
+	return linkStatus != 0;
 }
 
 
-uint32 RenderDeviceGL2::createShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
-                                      const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc )
+uint32 RenderDeviceGL2::beginCreatingShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
+                                             const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc )
 {
 	H3D_UNUSED_VAR( geometryShaderSrc );
 	H3D_UNUSED_VAR( tessControlShaderSrc );
@@ -1030,11 +1037,25 @@ uint32 RenderDeviceGL2::createShader( const char *vertexShaderSrc, const char *f
 	// Compile and link shader
 	uint32 programObj = createShaderProgram( vertexShaderSrc, fragmentShaderSrc );
 	if( programObj == 0 ) return 0;
-	if( !linkShaderProgram( programObj ) ) return 0;
-	
+
 	uint32 shaderId = _shaders.add( RDIShaderGL2() );
+	_shaders.getRef( shaderId ).oglProgramObj = programObj;
+
+	return shaderId;
+}
+
+
+bool RenderDeviceGL2::finishCreatingShader( uint32 &shaderId )
+{
+	if( shaderId == 0 ) return false;
+
 	RDIShaderGL2 &shader = _shaders.getRef( shaderId );
-	shader.oglProgramObj = programObj;
+	uint32 programObj = shader.oglProgramObj;
+	if( !checkShaderProgram( programObj ) )
+	{
+		destroyShader( shaderId );
+		return false;
+	}
 	
 	int attribCount;
 	glGetProgramiv( programObj, GL_ACTIVE_ATTRIBUTES, &attribCount );
@@ -1073,7 +1094,28 @@ uint32 RenderDeviceGL2::createShader( const char *vertexShaderSrc, const char *f
 		shader.inputLayouts[i].valid = allAttribsFound;
 	}
 
-	return shaderId;
+	return true;
+}
+
+
+uint32 RenderDeviceGL2::createShaderFromBinary( uint32 format, const void *data, uint32 size )
+{
+	H3D_UNUSED_VAR( format );
+	H3D_UNUSED_VAR( data );
+	H3D_UNUSED_VAR( size );
+
+	// Program binaries are not supported by the legacy backend
+	return 0;
+}
+
+
+bool RenderDeviceGL2::getShaderBinary( uint32 shaderId, uint32 &format, std::vector< char > &data )
+{
+	H3D_UNUSED_VAR( shaderId );
+	H3D_UNUSED_VAR( format );
+	H3D_UNUSED_VAR( data );
+
+	return false;
 }
 
 
@@ -1626,7 +1668,7 @@ bool RenderDeviceGL2::applyVertexLayout( const RDIGeometryInfoGL2 &geo )
 						_buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).type == GL_ARRAY_BUFFER );
 				
 				glBindBuffer( GL_ARRAY_BUFFER, _buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).glObj );
-				glVertexAttribPointer( attribIndex, attrib.size, GL_FLOAT, GL_FALSE,
+				glVertexAttribPointer( attribIndex, attrib.size, vertexAttribTypes[ attrib.format ], vertexAttribNormalized[ attrib.format ],
 									   vbSlot.stride, (char *)0 + vbSlot.offset + attrib.offset );
 
 				newVertexAttribMask |= 1 << attribIndex;
@@ -60,6 +60,10 @@ static const uint32 memoryBarrierType[ 3 ] = { GL_BUFFER_UPDATE_BARRIER_BIT | GL
 
 static const uint32 bufferMappingTypes[ 3 ] = { GL_MAP_READ_BIT, GL_MAP_WRITE_BIT, GL_MAP_READ_BIT | GL_MAP_WRITE_BIT };
 
+static const uint32 vertexAttribTypes[ 6 ] = { GL_FLOAT, GL_HALF_FLOAT, GL_INT_2_10_10_10_REV, GL_UNSIGNED_SHORT, GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE };
+
+static const GLboolean vertexAttribNormalized[ 6 ] = { GL_FALSE, GL_FALSE, GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE };
+
 // Texture formats mapping to supported non compressed GL texture formats
 struct GLTextureFormatAndType
 {
@@ -315,7 +319,10 @@ void RenderDeviceGL4::initRDIFuncs()
 	_delegate_getTextureData.bind< RenderDeviceGL4, &RenderDeviceGL4::getTextureData >( this );
 	_delegate_bindImageToTexture.bind< RenderDeviceGL4, &RenderDeviceGL4::bindImageToTexture >( this );
 
-	_delegate_createShader.bind< RenderDeviceGL4, &RenderDeviceGL4::createShader >( this );
+	_delegate_beginCreatingShader.bind< RenderDeviceGL4, &RenderDeviceGL4::beginCreatingShader >( this );
+	_delegate_finishCreatingShader.bind< RenderDeviceGL4, &RenderDeviceGL4::finishCreatingShader >( this );
+	_delegate_createShaderFromBinary.bind< RenderDeviceGL4, &RenderDeviceGL4::createShaderFromBinary >( this );
+	_delegate_getShaderBinary.bind< RenderDeviceGL4, &RenderDeviceGL4::getShaderBinary >( this );
 	_delegate_destroyShader.bind< RenderDeviceGL4, &RenderDeviceGL4::destroyShader >( this );
 	_delegate_bindShader.bind< RenderDeviceGL4, &RenderDeviceGL4::bindShader >( this );
 	_delegate_getShaderConstLoc.bind< RenderDeviceGL4, &RenderDeviceGL4::getShaderConstLoc >( this );
@@ -437,6 +444,17 @@ bool RenderDeviceGL4::init()
 	_caps.texETC2 = glExt::ARB_ES3_compatibility;
 	_caps.texBPTC = glExt::ARB_texture_compression_bptc;
 	_caps.texASTC = glExt::KHR_texture_compression_astc;
+	_caps.packedVertexAttribs = true;
+
+	// Some drivers expose the entry points without supporting any binary format
+	GLint binaryFormatCount = 0;
+	if( glExt::ARB_get_program_binary ) glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormatCount );
+	_caps.shaderBinaries = binaryFormatCount > 0;
+
+	_deviceInfo = std::string( "GL4|" ) + vendor + "|" + renderer + "|" + version;
+
+	// Let the driver compile shaders that are created in a batch on its own threads
+	if( glExt::KHR_parallel_shader_compile ) glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
 
 	// Find maximum number of storage buffers in compute shader
 	glGetIntegerv( GL_MAX_COMPUTE_SHADER_STORAGE_BLOCKS, (GLint *) &_maxComputeBufferAttachments );
@@ -562,7 +580,7 @@ void RenderDeviceGL4::finishCreatingGeometry( uint32 geoObj )
 					buf.type == GL_SHADER_STORAGE_BUFFER ); // special case for compute buffer
 
 			glBindBuffer( GL_ARRAY_BUFFER, buf.glObj );
-			glVertexAttribPointer( i, attrib.size, GL_FLOAT, GL_FALSE,
+			glVertexAttribPointer( i, attrib.size, vertexAttribTypes[ attrib.format ], vertexAttribNormalized[ attrib.format ],
 								   vbSlot.stride, ( char * ) 0 + vbSlot.offset + attrib.offset );
 
 			newVertexAttribMask |= 1 << i;
@@ -1102,247 +1120,104 @@ void RenderDeviceGL4::bindImageToTexture( uint32 texObj, void *eglImage )
 uint32 RenderDeviceGL4::createShaderProgram( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc, 
 											 const char *tessControlShaderSrc, const char *tessEvalShaderSrc, const char *computeShaderSrc )
 {
-	int infologLength = 0;
-	int charsWritten = 0;
-	char *infoLog = 0x0;
-	int status;
+	const char *sources[ 6 ] = { vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, 
+								 tessControlShaderSrc, tessEvalShaderSrc, computeShaderSrc };
+	const uint32 types[ 6 ] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER, 
+								GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_COMPUTE_SHADER };
 
-	_shaderLog = "";
-	
-	uint32 vs, fs, gs, tsC, tsE, cs;
-	vs = fs = gs = tsC = tsE = cs = 0;
-
-	// Vertex shader
-	if ( vertexShaderSrc )
+	// Compile status is not queried here, since that would wait for the compiler; errors
+	// are collected in checkShaderProgram after linking
+	uint32 program = glCreateProgram();
+	for( int i = 0; i < 6; ++i )
 	{
-		vs = glCreateShader( GL_VERTEX_SHADER );
-		glShaderSource( vs, 1, &vertexShaderSrc, 0x0 );
-		glCompileShader( vs );
-		glGetShaderiv( vs, GL_COMPILE_STATUS, &status );
-		if ( !status )
-		{
-			// Get info
-			glGetShaderiv( vs, GL_INFO_LOG_LENGTH, &infologLength );
-			if ( infologLength > 1 )
-			{
-				infoLog = new char[ infologLength ];
-				glGetShaderInfoLog( vs, infologLength, &charsWritten, infoLog );
-				_shaderLog = _shaderLog + "[Vertex Shader]\n" + infoLog;
-				delete[] infoLog; infoLog = 0x0;
-			}
+		if( sources[ i ] == 0x0 ) continue;
 
-			glDeleteShader( vs );
-			return 0;
-		}
+		uint32 shader = glCreateShader( types[ i ] );
+		glShaderSource( shader, 1, &sources[ i ], 0x0 );
+		glCompileShader( shader );
+		glAttachShader( program, shader );
+		glDeleteShader( shader );  // Deleted when detached from program
 	}
-	
-	// Fragment shader
-	if ( fragmentShaderSrc )
-	{
-		fs = glCreateShader( GL_FRAGMENT_SHADER );
-		glShaderSource( fs, 1, &fragmentShaderSrc, 0x0 );
-		glCompileShader( fs );
-		glGetShaderiv( fs, GL_COMPILE_STATUS, &status );
-		if ( !status )
-		{
-			glGetShaderiv( fs, GL_INFO_LOG_LENGTH, &infologLength );
-			if ( infologLength > 1 )
-			{
-				infoLog = new char[ infologLength ];
-				glGetShaderInfoLog( fs, infologLength, &charsWritten, infoLog );
-				_shaderLog = _shaderLog + "[Fragment Shader]\n" + infoLog;
-				delete[] infoLog; infoLog = 0x0;
-			}
 
-			glDeleteShader( vs );
-			glDeleteShader( fs );
-			return 0;
-		}
-	}
-	
-	// Geometry shader
-	if ( geometryShaderSrc )
-	{
-		gs = glCreateShader( GL_GEOMETRY_SHADER );
-		glShaderSource( gs, 1, &geometryShaderSrc, 0x0 );
-		glCompileShader( gs );
-		glGetShaderiv( gs, GL_COMPILE_STATUS, &status );
-		if ( !status )
-		{
-			glGetShaderiv( gs, GL_INFO_LOG_LENGTH, &infologLength );
-			if ( infologLength > 1 )
-			{
-				infoLog = new char[ infologLength ];
-				glGetShaderInfoLog( gs, infologLength, &charsWritten, infoLog );
-				_shaderLog = _shaderLog + "[Geometry Shader]\n" + infoLog;
-				delete[] infoLog; infoLog = 0x0;
-			}
+	if( _caps.shaderBinaries )
+		glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
 
-			glDeleteShader( vs );
-			glDeleteShader( fs );
-			glDeleteShader( gs );
-			return 0;
-		}
-	}
-	
-	// Tesselation control shader
-	if ( tessControlShaderSrc )
-	{
-		tsC = glCreateShader( GL_TESS_CONTROL_SHADER );
-		glShaderSource( tsC, 1, &tessControlShaderSrc, 0x0 );
-		glCompileShader( tsC );
-		glGetShaderiv( tsC, GL_COMPILE_STATUS, &status );
-		if ( !status )
-		{
-			glGetShaderiv( tsC, GL_INFO_LOG_LENGTH, &infologLength );
-			if ( infologLength > 1 )
-			{
-				infoLog = new char[ infologLength ];
-				glGetShaderInfoLog( tsC, infologLength, &charsWritten, infoLog );
-				_shaderLog = _shaderLog + "[Tesselation Control Shader]\n" + infoLog;
-				delete[] infoLog; infoLog = 0x0;
-			}
+	glLinkProgram( program );
 
-			glDeleteShader( vs );
-			glDeleteShader( fs );
-			if ( gs ) glDeleteShader( gs );
-			glDeleteShader( tsC );
-			return 0;
-		}
-	}
+	return program;
+}
 
-	// Tesselation evaluation shader
-	if ( tessEvalShaderSrc )
-	{
-		tsE = glCreateShader( GL_TESS_EVALUATION_SHADER );
-		glShaderSource( tsE, 1, &tessEvalShaderSrc, 0x0 );
-		glCompileShader( tsE );
-		glGetShaderiv( tsE, GL_COMPILE_STATUS, &status );
-		if ( !status )
-		{
-			glGetShaderiv( tsE, GL_INFO_LOG_LENGTH, &infologLength );
-			if ( infologLength > 1 )
-			{
-				infoLog = new char[ infologLength ];
-				glGetShaderInfoLog( tsE, infologLength, &charsWritten, infoLog );
-				_shaderLog = _shaderLog + "[Tesselation Evaluation Shader]\n" + infoLog;
-				delete[] infoLog; infoLog = 0x0;
-			}
 
-			glDeleteShader( vs );
-			glDeleteShader( fs );
-			if ( gs ) glDeleteShader( gs );
-			glDeleteShader( tsC );
-			glDeleteShader( tsE );
-			return 0;
-		}
-	}
+bool RenderDeviceGL4::checkShaderProgram( uint32 programObj )
+{
+	int infologLength = 0;
+	int charsWritten = 0;
+	char *infoLog = 0x0;
+	int status, linkStatus;
 
-	// Compute shader
-	if ( computeShaderSrc )
+	_shaderLog = "";
+
+	glGetProgramiv( programObj, GL_LINK_STATUS, &linkStatus );
+
+	uint32 shaders[ 6 ];
+	int shaderCount = 0;
+	bool compiled = true;
+	glGetAttachedShaders( programObj, 6, &shaderCount, shaders );
+
+	for( int i = 0; i < shaderCount; ++i )
 	{
-		cs = glCreateShader( GL_COMPUTE_SHADER );
-		glShaderSource( cs, 1, &computeShaderSrc, 0x0 );
-		glCompileShader( cs );
-		glGetShaderiv( cs, GL_COMPILE_STATUS, &status );
-		if ( !status )
+		if( !linkStatus )
 		{
-			glGetShaderiv( cs, GL_INFO_LOG_LENGTH, &infologLength );
-			if ( infologLength > 1 )
+			glGetShaderiv( shaders[ i ], GL_COMPILE_STATUS, &status );
+			glGetShaderiv( shaders[ i ], GL_INFO_LOG_LENGTH, &infologLength );
+			if( !status && infologLength > 1 )
 			{
+				int type;
+				glGetShaderiv( shaders[ i ], GL_SHADER_TYPE, &type );
+				switch( type )
+				{
+				case GL_VERTEX_SHADER: _shaderLog += "[Vertex Shader]\n"; break;
+				case GL_FRAGMENT_SHADER: _shaderLog += "[Fragment Shader]\n"; break;
+				case GL_GEOMETRY_SHADER: _shaderLog += "[Geometry Shader]\n"; break;
+				case GL_TESS_CONTROL_SHADER: _shaderLog += "[Tesselation Control Shader]\n"; break;
+				case GL_TESS_EVALUATION_SHADER: _shaderLog += "[Tesselation Evaluation Shader]\n"; break;
+				case GL_COMPUTE_SHADER: _shaderLog += "[Compute Shader]\n"; break;
+				}
+
 				infoLog = new char[ infologLength ];
-				glGetShaderInfoLog( cs, infologLength, &charsWritten, infoLog );
-				_shaderLog = _shaderLog + "[Compute Shader]\n" + infoLog;
+				glGetShaderInfoLog( shaders[ i ], infologLength, &charsWritten, infoLog );
+				_shaderLog += infoLog;
 				delete[] infoLog; infoLog = 0x0;
 			}
-
-			// other shader types should not be present in compute context, but better check
-			if ( vs ) glDeleteShader( vs );
-			if ( fs ) glDeleteShader( fs );
-			if ( gs ) glDeleteShader( gs );
-			if ( tsC ) glDeleteShader( tsC );
-			if ( tsE ) glDeleteShader( tsE );
-			glDeleteShader( cs );
-			return 0;
+			compiled &= status != 0;
 		}
-	}
 
-	// Shader program
-	uint32 program = glCreateProgram();
-	if ( vs && fs )
-	{
-		glAttachShader( program, vs );
-		glAttachShader( program, fs );
-
-		glDeleteShader( vs );
-		glDeleteShader( fs );
-	}
-
-	if ( gs )
-	{
-		glAttachShader( program, gs );
-		glDeleteShader( gs );
-	}
-	if ( tsC )
-	{
-		glAttachShader( program, tsC );
-		glDeleteShader( tsC );
-	}
-	if ( tsE )
-	{
-		glAttachShader( program, tsE );
-		glDeleteShader( tsE );
-	}
-	if ( cs )
-	{
-		glAttachShader( program, cs );
-		glDeleteShader( cs );
+		// Frees the shader object
+		glDetachShader( programObj, shaders[ i ] );
 	}
 
-	return program;
-}
-
-
-bool RenderDeviceGL4::linkShaderProgram( uint32 programObj )
-{
-	int infologLength = 0;
-	int charsWritten = 0;
-	char *infoLog = 0x0;
-	int status;
-
-	_shaderLog = "";
-	
-	glLinkProgram( programObj );
-	glGetProgramiv( programObj, GL_INFO_LOG_LENGTH, &infologLength );
-	if( infologLength > 1 )
+	if( compiled )
 	{
-		infoLog = new char[infologLength];
-		glGetProgramInfoLog( programObj, infologLength, &charsWritten, infoLog );
-		_shaderLog = _shaderLog + "[Linking]\n" + infoLog;
-		delete[] infoLog; infoLog = 0x0;
+		glGetProgramiv( programObj, GL_INFO_LOG_LENGTH, &infologLength );
+		if( infologLength > 1 )
+		{
+			infoLog = new char[ infologLength ];
+			glGetProgramInfoLog( programObj, infologLength, &charsWritten, infoLog );
+			_shaderLog = _shaderLog + "[Linking]\n" + infoLog;
+			delete[] infoLog; infoLog = 0x0;
+		}
 	}
-	
-	glGetProgramiv( programObj, GL_LINK_STATUS, &status );
-	if( !status ) return false;
 
-	return true;
+	return linkStatus != 0;
 }
 
 
-uint32 RenderDeviceGL4::createShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
-									  const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc )
+void RenderDeviceGL4::setupShaderInputLayouts( RDIShaderGL4 &shader )
 {
-	// Compile and link shader
-	uint32 programObj = createShaderProgram( vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc );
-	if( programObj == 0 ) return 0;
-	if( !linkShaderProgram( programObj ) ) return 0;
+	uint32 programObj = shader.oglProgramObj;
 
 //	int loc = glGetFragDataLocation( programObj, "fragColor" );
 
-	uint32 shaderId = _shaders.add( RDIShaderGL4() );
-	RDIShaderGL4 &shader = _shaders.getRef( shaderId );
-	shader.oglProgramObj = programObj;
-	
 	int attribCount;
 	glGetProgramiv( programObj, GL_ACTIVE_ATTRIBUTES, &attribCount );
 	
@@ -1379,11 +1254,84 @@ uint32 RenderDeviceGL4::createShader( const char *vertexShaderSrc, const char *f
 
 		shader.inputLayouts[i].valid = allAttribsFound;
 	}
+}
+
+
+uint32 RenderDeviceGL4::beginCreatingShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
+											 const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc )
+{
+	// Compile and link shader
+	uint32 programObj = createShaderProgram( vertexShaderSrc, fragmentShaderSrc, geometryShaderSrc, tessControlShaderSrc, tessEvaluationShaderSrc, computeShaderSrc );
+	if( programObj == 0 ) return 0;
+
+	uint32 shaderId = _shaders.add( RDIShaderGL4() );
+	_shaders.getRef( shaderId ).oglProgramObj = programObj;
 
 	return shaderId;
 }
 
 
+bool RenderDeviceGL4::finishCreatingShader( uint32 &shaderId )
+{
+	if( shaderId == 0 ) return false;
+
+	RDIShaderGL4 &shader = _shaders.getRef( shaderId );
+	if( !checkShaderProgram( shader.oglProgramObj ) )
+	{
+		destroyShader( shaderId );
+		return false;
+	}
+
+	setupShaderInputLayouts( shader );
+
+	return true;
+}
+
+
+uint32 RenderDeviceGL4::createShaderFromBinary( uint32 format, const void *data, uint32 size )
+{
+	if( !_caps.shaderBinaries ) return 0;
+
+	_shaderLog = "";
+
+	uint32 programObj = glCreateProgram();
+	glProgramBinary( programObj, format, data, (int)size );
+
+	// Drivers reject binaries of other driver versions
+	int status;
+	glGetProgramiv( programObj, GL_LINK_STATUS, &status );
+	if( !status )
+	{
+		glDeleteProgram( programObj );
+		return 0;
+	}
+
+	uint32 shaderId = _shaders.add( RDIShaderGL4() );
+	RDIShaderGL4 &shader = _shaders.getRef( shaderId );
+	shader.oglProgramObj = programObj;
+	setupShaderInputLayouts( shader );
+
+	return shaderId;
+}
+
+
+bool RenderDeviceGL4::getShaderBinary( uint32 shaderId, uint32 &format, std::vector< char > &data )
+{
+	if( !_caps.shaderBinaries || shaderId == 0 ) return false;
+
+	RDIShaderGL4 &shader = _shaders.getRef( shaderId );
+	int size = 0;
+	glGetProgramiv( shader.oglProgramObj, GL_PROGRAM_BINARY_LENGTH, &size );
+	if( size <= 0 ) return false;
+
+	data.resize( size );
+	glGetProgramBinary( shader.oglProgramObj, size, &size, &format, &data[ 0 ] );
+	data.resize( size );
+
+	return size > 0;
+}
+
+
 void RenderDeviceGL4::destroyShader( uint32& shaderId )
 {
 	if( shaderId == 0 )
@@ -1935,7 +1883,7 @@ bool RenderDeviceGL4::applyVertexLayout( RDIGeometryInfoGL4 &geo )
 					_buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).type == GL_ARRAY_BUFFER );
 					
 			glBindBuffer( GL_ARRAY_BUFFER, _buffers.getRef( geo.vertexBufInfo[ attrib.vbSlot ].vbObj ).glObj );
-			glVertexAttribPointer( attribIndex, attrib.size, GL_FLOAT, GL_FALSE,
+			glVertexAttribPointer( attribIndex, attrib.size, vertexAttribTypes[ attrib.format ], vertexAttribNormalized[ attrib.format ],
 									vbSlot.stride, (char *)0 + vbSlot.offset + attrib.offset );
 
 			newVertexAttribMask |= 1 << attribIndex;
@@ -227,8 +227,11 @@ public:
 	void bindImageToTexture( uint32 texObj, void* eglImage );
 
 	// Shaders
-	uint32 createShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
-						 const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc );
+	uint32 beginCreatingShader( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc,
+								const char *tessControlShaderSrc, const char *tessEvaluationShaderSrc, const char *computeShaderSrc );
+	bool finishCreatingShader( uint32 &shaderId );
+	uint32 createShaderFromBinary( uint32 format, const void *data, uint32 size );
+	bool getShaderBinary( uint32 shaderId, uint32 &format, std::vector< char > &data );
 	void destroyShader( uint32 &shaderId );
 	void bindShader( uint32 shaderId );
 	std::string getShaderLog() const { return _shaderLog; }
@@ -305,7 +308,8 @@ protected:
 
 	uint32 createShaderProgram( const char *vertexShaderSrc, const char *fragmentShaderSrc, const char *geometryShaderSrc, 
 								const char *tessControlShaderSrc, const char *tessEvalShaderSrc, const char *computeShaderSrc );
-	bool linkShaderProgram( uint32 programObj );
+	bool checkShaderProgram( uint32 programObj );
+	void setupShaderInputLayouts( RDIShaderGLES3 &shader );
 	void resolveRenderBuffer( uint32 rbObj );
 
 	void checkError();
@@ -12,9 +12,11 @@
 
 #include "egResource.h"
 #include "egModules.h"
+#include "egRenderer.h"
 #include "egCom.h"
 #include <sstream>
 #include <cstring>
+#include <algorithm>
 
 #include "utDebug.h"
 
@@ -27,14 +29,19 @@ using namespace std;
 // Class Resource
 // **********************************************************************************
 
+vector< Resource * > *Resource::_releaseList = 0x0;
+
+
 Resource::Resource( int type, const string &name, int flags )
 {
 	_type = type;
 	_name = name;
 	_handle = 0;
 	_loaded = false;
+	_reloadable = false;
 	_refCount = 0;
 	_userRefCount = 0;
+	_lastUseFrame = 0;
 	_flags = flags;
 	
 	if( (flags & ResourceFlags::NoQuery) == ResourceFlags::NoQuery ) _noQuery = true;
@@ -80,6 +87,7 @@ bool Resource::load( const char *data, int size )
 	}
 
 	_loaded = true;
+	_reloadable = true;
 	
 	return true;
 }
@@ -184,12 +192,19 @@ void Resource::unmapStream()
 	Modules::setError( "Invalid operation by h3dUnmapResStream" );
 }
 
+void Resource::getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const
+{
+	cpuMem = 0;
+	gpuMem = 0;
+}
+
 
 // **********************************************************************************
 // Class ResourceManager
 // **********************************************************************************
 
-ResourceManager::ResourceManager()
+ResourceManager::ResourceManager() :
+	_loadingRes( 0x0 )
 {
 	_resources.reserve( 100 );
 }
@@ -219,6 +234,7 @@ void ResourceManager::registerResType( int resType, const string &typeString, Re
 	entry.initializationFunc = inf;
 	entry.releaseFunc = rf;
 	entry.factoryFunc = ff;
+	entry.memoryBudget = 0;
 	_registry[resType] = entry;
 
 	// Initialize resource type
@@ -283,30 +299,41 @@ ResHandle ResourceManager::addResource( int type, const string &name, int flags,
 		return 0;
 	}
 	
+	ResHandle handle = 0;
+	
 	// Check if resource is already in list and return index
-	for( uint32 i = 0; i < _resources.size(); ++i )
+	for( uint32 i = 0; i < _resources.size() && handle == 0; ++i )
 	{
 		if( _resources[i] != 0x0 && _resources[i]->_name == name )
 		{
 			if( _resources[i]->_type == type )
 			{
 				if( userCall ) ++_resources[i]->_userRefCount;
-				return i + 1;
+				handle = i + 1;
 			}
 		}
 	}
 	
-	// Create resource
-	Resource *resource = 0x0;
-	map< int, ResourceRegEntry >::iterator itr = _registry.find( type );
-	if( itr != _registry.end() ) resource = (*itr->second.factoryFunc)( name, flags );
-	if( resource == 0x0 ) return 0;
+	if( handle == 0 )
+	{
+		// Create resource
+		Resource *resource = 0x0;
+		map< int, ResourceRegEntry >::iterator itr = _registry.find( type );
+		if( itr != _registry.end() ) resource = (*itr->second.factoryFunc)( name, flags );
+		if( resource == 0x0 ) return 0;
+
+		if( userCall ) resource->_userRefCount = 1;
+		handle = addResource( *resource );
+	}
 
-	//Modules::log().writeInfo( "Adding %s resource '%s'", itr->second.typeString.c_str(), name.c_str() );
-	
-	if( userCall ) resource->_userRefCount = 1;
+	// Record dependencies of the resource that is being loaded
+	if( !userCall && _loadingRes != 0x0 )
+	{
+		vector< ResHandle > &deps = _loadingRes->_dependencies;
+		if( find( deps.begin(), deps.end(), handle ) == deps.end() ) deps.push_back( handle );
+	}
 	
-	return addResource( *resource );
+	return handle;
 }
 
 
@@ -346,6 +373,7 @@ ResHandle ResourceManager::cloneResource( Resource &sourceRes, const string &nam
 	newRes->_name = name != "" ? name : "|tmp|";
 	newRes->_userRefCount = 1;
 	newRes->_refCount = 0;
+	newRes->_reloadable = false;  // Data can't be loaded again under the new name
 	int handle = addResource( *newRes );
 	
 	if( name == "" )
@@ -404,31 +432,133 @@ ResHandle ResourceManager::queryUnloadedResource( int index ) const
 }
 
 
-void ResourceManager::releaseUnusedResources()
+bool ResourceManager::loadResource( Resource &resource, const char *data, int size )
 {
-	vector< uint32 > killList;
+	// Resources added by the loader are recorded as dependencies, so that applications can
+	// prefetch the data of all dependencies at once the next time
+	Resource *prevLoadingRes = _loadingRes;
+	_loadingRes = &resource;
+	if( !resource._loaded ) resource._dependencies.clear();
+	
+	bool result = resource.load( data, size );
 	
-	// Find unused resources and release dependencies
+	_loadingRes = prevLoadingRes;
+	return result;
+}
+
+
+void ResourceManager::releaseUnusedResources()
+{
+	// Releasing a resource removes its references to other resources; resources that become unused
+	// by that are added to the work list by Resource::subRef, so only the initial search is a full scan
+	vector< Resource * > workList;
 	for( uint32 i = 0; i < _resources.size(); ++i )
 	{
+		Resource *res = _resources[i];
+		if( res != 0x0 && res->_userRefCount == 0 && res->_refCount == 0 ) workList.push_back( res );
+	}
+
+	Resource::_releaseList = &workList;
+
+	while( !workList.empty() )
+	{
+		Resource *res = workList.back();
+		workList.pop_back();
+
+		// Skip resources that were already deleted or got referenced again
+		uint32 index = res->_handle - 1;
+		if( index >= _resources.size() || _resources[index] != res ) continue;
+		if( res->_userRefCount != 0 || res->_refCount != 0 ) continue;
+
+		Modules::log().writeInfo( "Removed resource '%s'", res->_name.c_str() );
+		res->release();
+		_resources[index] = 0x0;
+		delete res;
+	}
 
-        Resource* res = _resources[i];
-        if( res != 0x0 && res->_userRefCount == 0 && res->_refCount == 0 )
+	Resource::_releaseList = 0x0;
+}
+
+
+bool ResourceManager::setMemoryBudget( int resType, size_t budget )
+{
+	map< int, ResourceRegEntry >::iterator itr = _registry.find( resType );
+	if( itr == _registry.end() ) return false;
+
+	itr->second.memoryBudget = budget;
+
+	return true;
+}
+
+
+void ResourceManager::enforceMemoryBudgets( uint32 frameID )
+{
+	for( map< int, ResourceRegEntry >::const_iterator itr = _registry.begin(); itr != _registry.end(); ++itr )
+	{
+		if( itr->second.memoryBudget == 0 ) continue;
+
+		// Resources can be evicted if the application has no handle to them and they were not used in
+		// the last frame; referenced resources only if the type can deal with unloaded dependencies
+		vector< pair< Resource *, size_t > > candidates;
+		size_t totalMem = 0;
+
+		for( uint32 i = 0; i < _resources.size(); ++i )
+		{
+			Resource *res = _resources[i];
+			if( res == 0x0 || res->_type != itr->first || !res->_loaded ) continue;
+
+			size_t cpuMem, gpuMem;
+			res->getMemoryUsage( cpuMem, gpuMem );
+			totalMem += cpuMem + gpuMem;
+
+			if( res->_reloadable && res->_userRefCount == 0 && res->_lastUseFrame + 1 < frameID &&
+			    (res->_refCount == 0 || res->canUnloadWhileReferenced()) )
+			{
+				candidates.push_back( pair< Resource *, size_t >( res, cpuMem + gpuMem ) );
+			}
+		}
+
+		if( totalMem <= itr->second.memoryBudget ) continue;
+
+		// Evict least recently used resources first
+		std::sort( candidates.begin(), candidates.end(),
+			[]( const pair< Resource *, size_t > &a, const pair< Resource *, size_t > &b )
+			{ return a.first->_lastUseFrame < b.first->_lastUseFrame; } );
+
+		for( size_t i = 0; i < candidates.size() && totalMem > itr->second.memoryBudget; ++i )
 		{
-			killList.push_back( i );
-            res->release();
+			Resource *res = candidates[i].first;
+			Modules::log().writeInfo( "Evicted resource '%s' to stay within %s memory budget",
+				res->_name.c_str(), itr->second.typeString.c_str() );
+
+			// Unloaded resources are returned by queryUnloadedResource again, so they are loaded on demand
+			Modules::renderer().acquireRenderContext();
+			res->unload();
+			totalMem -= candidates[i].second;
 		}
 	}
-	
-	// Delete unused resources
-	for( uint32 i = 0; i < killList.size(); ++i )
+}
+
+
+void ResourceManager::listResourcesBySize( int resType, vector< Resource * > &resources ) const
+{
+	vector< pair< Resource *, size_t > > sizes;
+	for( uint32 i = 0; i < _resources.size(); ++i )
 	{
-		Modules::log().writeInfo( "Removed resource '%s'", _resources[killList[i]]->_name.c_str() );
-		delete _resources[killList[i]]; _resources[killList[i]] = 0x0;
+		Resource *res = _resources[i];
+		if( res == 0x0 || (resType != ResourceTypes::Undefined && res->_type != resType) ) continue;
+
+		size_t cpuMem, gpuMem;
+		res->getMemoryUsage( cpuMem, gpuMem );
+		sizes.push_back( pair< Resource *, size_t >( res, cpuMem + gpuMem ) );
 	}
 
-	// Releasing a resource can remove dependencies from other resources which can also be released
-	if( !killList.empty() ) releaseUnusedResources();
+	std::stable_sort( sizes.begin(), sizes.end(),
+		[]( const pair< Resource *, size_t > &a, const pair< Resource *, size_t > &b ) { return a.second > b.second; } );
+
+	resources.clear();
+	resources.reserve( sizes.size() );
+	for( size_t i = 0; i < sizes.size(); ++i ) resources.push_back( sizes[i].first );
 }
 
 }  // namespace
@@ -83,14 +83,24 @@ public:
 	virtual void setElemParamStr( int elem, int elemIdx, int param, const char *value );
 	virtual void *mapStream( int elem, int elemIdx, int stream, bool read, bool write );
 	virtual void unmapStream();
+	virtual void getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const;
+	virtual bool canUnloadWhileReferenced() const { return false; }
 
 	int getType() const { return _type; }
 	int getFlags() const { return _flags; }
 	const std::string &getName() const { return _name; }
 	ResHandle getHandle() const { return _handle; }
 	bool isLoaded() const { return _loaded; }
+	const std::vector< ResHandle > &getDependencies() const { return _dependencies; }
+	uint32 getLastUseFrame() const { return _lastUseFrame; }
+	void markUsed( uint32 frameID ) { _lastUseFrame = frameID; }
+	void markModified() { _reloadable = false; }
 	void addRef() { ++_refCount; }
-    void subRef() { ASSERT(_refCount > 0 ); --_refCount; }
+	void subRef()
+	{
+		ASSERT( _refCount > 0 );
+		if( --_refCount == 0 && _userRefCount == 0 && _releaseList != 0x0 ) _releaseList->push_back( this );
+	}
 
 protected:
 	int                  _type;
@@ -100,9 +110,15 @@ protected:
 	
 	uint32               _refCount;  // Number of other objects referencing this resource
 	uint32               _userRefCount;  // Number of handles created by user
+	uint32               _lastUseFrame;  // Frame in which the resource was used for rendering the last time
+	std::vector< ResHandle >  _dependencies;  // Resources added while loading this resource
 
 	bool                 _loaded;
 	bool                 _noQuery;
+	bool                 _reloadable;  // Data was loaded and not modified, so the resource can be evicted
+
+	// Collects resources that become unused while ResourceManager::releaseUnusedResources is running
+	static std::vector< Resource * >  *_releaseList;
 
 	friend class ResourceManager;
 };
@@ -155,6 +171,7 @@ struct ResourceRegEntry
 	ResTypeInitializationFunc  initializationFunc;  // Called when type is registered
 	ResTypeReleaseFunc         releaseFunc;  // Called when type is unregistered
 	ResTypeFactoryFunc         factoryFunc;  // Factory to create resource object
+	size_t                     memoryBudget;  // Memory that loaded resources of the type may use, 0 if unlimited
 };
 
 // =================================================================================================
@@ -176,8 +193,14 @@ public:
 	int removeResource( Resource &resource, bool userCall );
 	void clear();
 	ResHandle queryUnloadedResource( int index ) const;
+	bool loadResource( Resource &resource, const char *data, int size );
 	void releaseUnusedResources();
 
+	// Memory budgets
+	bool setMemoryBudget( int resType, size_t budget );
+	void enforceMemoryBudgets( uint32 frameID );
+	void listResourcesBySize( int resType, std::vector< Resource * > &resources ) const;
+
 	Resource *resolveResHandle( ResHandle handle ) const
 		{ return (handle != 0 && (unsigned)(handle - 1) < _resources.size()) ? _resources[handle - 1] : 0x0; }
 
@@ -189,6 +212,7 @@ protected:
 protected:
 	std::vector < Resource * >         _resources;
 	std::map< int, ResourceRegEntry >  _registry;  // Registry of resource types
+	Resource                           *_loadingRes;  // Resource whose data is currently parsed
 };
 
 }
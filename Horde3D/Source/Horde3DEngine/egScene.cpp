@@ -18,6 +18,8 @@
 #include "egModules.h"
 #include "egCom.h"
 #include "egRenderer.h"
+#include "egProfiler.h"
+#include "egJobs.h"
 
 #include "utDebug.h"
 
@@ -33,7 +35,7 @@ using namespace std;
 SceneNode::SceneNode( const SceneNodeTpl &tpl ) :
 	_name( tpl.name ), _attachment( tpl.attachmentString ), _parent( 0x0 ), _type( tpl.type ),
 	_handle( 0 ), _sgHandle( 0 ), _flags( 0 ), _sortKey( 0 ), _dirty( true ), _transformed( true ),
-	_renderable( false ), _lodSupported( false ), _occlusionCullingSupported( false )
+	_renderable( false ), _lodSupported( false ), _occlusionCullingSupported( false ), _renderProxy( false )
 {
 	_relTrans = Matrix4f::ScaleMat( tpl.scale.x, tpl.scale.y, tpl.scale.z );
 	_relTrans.rotate( degToRad( tpl.rot.x ), degToRad( tpl.rot.y ), degToRad( tpl.rot.z ) );
@@ -195,6 +197,16 @@ bool SceneNode::canAttach( SceneNode &/*parent*/ ) const
 }
 
 
+void SceneNode::updateRenderProxy( SceneNode &proxy ) const
+{
+	proxy._relTrans = _relTrans;
+	proxy._absTrans = _absTrans;
+	proxy._bBox = _bBox;
+	proxy._flags = _flags;
+	proxy._sortKey = _sortKey;
+}
+
+
 void SceneNode::markChildrenDirty()
 {	
 	for( vector< SceneNode * >::iterator itr = _children.begin(),
@@ -268,9 +280,8 @@ GroupNode::GroupNode( const GroupNodeTpl &groupTpl ) :
 }
 
 
-SceneNodeTpl *GroupNode::parsingFunc( map< string, string > &attribs )
+SceneNodeTpl *GroupNode::parsingFunc( const SceneNodeAttribs &attribs )
 {
-	map< string, string >::iterator itr;
 	GroupNodeTpl *groupTpl = new GroupNodeTpl( "" );
 	
 	return groupTpl;
@@ -368,8 +379,6 @@ struct RenderQueueItemCompFunc
 void SpatialGraph::updateQueues( const Frustum &frustum1, const Frustum *frustum2, RenderingOrder::List order,
                                  uint32 filterIgnore, bool lightQueue, bool renderQueue )
 {
-	Modules::sceneMan().updateNodes();
-	
 	Vec3f camPos( frustum1.getOrigin() );
 	if( Modules::renderer().getCurCamera() != 0x0 )
 		camPos = Modules::renderer().getCurCamera()->getAbsPos();
@@ -450,8 +459,6 @@ void SpatialGraph::updateQueues( uint32 filterIgnore, bool forceUpdateAllViews /
 		}
 	}
 
-	Modules::sceneMan().updateNodes();
-
 	Vec3f camPos;
 	if ( Modules::renderer().getCurCamera() != 0x0 )
 		camPos = Modules::renderer().getCurCamera()->getAbsPos();
@@ -468,47 +475,19 @@ void SpatialGraph::updateQueues( uint32 filterIgnore, bool forceUpdateAllViews /
 	// Clear without affecting capacity
 	_lightQueue.resize( 0 );
 
-	RenderView *v = nullptr;
 	RenderView *cameraView = &_views[ 0 ];
 
-	// Culling
-	for ( size_t i = 0, s = _nodes.size(); i < s; ++i )
+	// Culling, views are independent of each other and are processed in parallel
+	Modules::jobs().parallelFor( _totalViews, 1, [&]( uint32 firstView, uint32 lastView )
 	{
-		SceneNode *node = _nodes[ i ];
-		if ( node == 0x0 || ( node->_flags & filterIgnore ) || !node->_renderable ) continue;
-
-		for ( size_t view = 0; view < _totalViews; ++view )
+		for ( size_t view = firstView; view < lastView; ++view )
 		{
-			v = &_views[ view ];
-
 			// Skip views that are already updated
-			if ( !v->updated && !v->frustum.cullBox( node->_bBox ) )
-			{
-				if ( v != cameraView ) 
-				{
-					// View can have a linked view. If it does, perform additional culling with the frustum of that view
-					if ( v->linkedView != -1 && _views[ v->linkedView ].frustum.cullBox( node->_bBox ) ) continue;
-				}
-// 				else
-// 				{
-// 					// Check lod only for first view (camera)
-// 				}
-
-				if ( node->_lodSupported )
-				{
-					uint32 curLod = node->calcLodLevel( camPos );
-					if ( !node->checkLodCorrectness( curLod ) ) continue;
-				}
-
-				// Calculate bounding box for all objects in the view
-				v->objectsAABB.makeUnion( node->_bBox );
-				if ( v->auxFilter && !( node->_flags & v->auxFilter ) ) v->auxObjectsAABB.makeUnion( node->_bBox );
-
-				// sortKey will be computed in the sorting function basing on requested sorting algorithm
-				v->objects.emplace_back( RenderQueueItem( node->_type, 0, node ) );
-			}
+			if ( _views[ view ].updated ) continue;
+			
+			cullView( &_views[ view ], cameraView, filterIgnore, camPos );
 		}
-	}
+	} );
 
 	// Post culling actions
 	for ( size_t i = 0; i < _totalViews; ++i )
@@ -519,6 +498,38 @@ void SpatialGraph::updateQueues( uint32 filterIgnore, bool forceUpdateAllViews /
 }
 
 
+void SpatialGraph::cullView( RenderView *v, RenderView *cameraView, uint32 filterIgnore, const Vec3f &camPos )
+{
+	H3D_PROFILE_ZONE( "SpatialGraph::cullView" );
+
+	for ( size_t i = 0, s = _nodes.size(); i < s; ++i )
+	{
+		SceneNode *node = _nodes[ i ];
+		if ( node == 0x0 || ( node->_flags & filterIgnore ) || !node->_renderable ) continue;
+		if ( v->frustum.cullBox( node->_bBox ) ) continue;
+
+		if ( v != cameraView ) 
+		{
+			// View can have a linked view. If it does, perform additional culling with the frustum of that view
+			if ( v->linkedView != -1 && _views[ v->linkedView ].frustum.cullBox( node->_bBox ) ) continue;
+		}
+
+		if ( node->_lodSupported )
+		{
+			uint32 curLod = node->calcLodLevel( camPos );
+			if ( !node->checkLodCorrectness( curLod ) ) continue;
+		}
+
+		// Calculate bounding box for all objects in the view
+		v->objectsAABB.makeUnion( node->_bBox );
+		if ( v->auxFilter && !( node->_flags & v->auxFilter ) ) v->auxObjectsAABB.makeUnion( node->_bBox );
+
+		// sortKey will be computed in the sorting function basing on requested sorting algorithm
+		v->objects.emplace_back( RenderQueueItem( node->_type, 0, node ) );
+	}
+}
+
+
 void SpatialGraph::clearViews()
 {
 	for ( size_t i = 0; i < _views.size(); ++i )
@@ -621,11 +632,24 @@ void SpatialGraph::setCurrentView( int viewID )
 	else _currentView = viewID;
 }
 
+// *************************************************************************************************
+// Class SceneNodeAttribs
+// *************************************************************************************************
+
+bool SceneNodeAttribs::getBool( const char *name, bool &value ) const
+{
+	const char *str = getString( name );
+	if( str == 0x0 ) return false;
+
+	value = _stricmp( str, "true" ) == 0 || _stricmp( str, "1" ) == 0;
+	return true;
+}
+
 // *************************************************************************************************
 // Class SceneManager
 // *************************************************************************************************
 
-SceneManager::SceneManager() : _rayNum( 0 ), _spatialGraph( nullptr )
+SceneManager::SceneManager() : _rayNum( 0 ), _spatialGraph( nullptr ), _proxyGraph( nullptr )
 {
 	SceneNode *rootNode = GroupNode::factoryFunc( GroupNodeTpl( "RootNode" ) );
 	rootNode->_handle = RootNode;
@@ -643,6 +667,7 @@ SceneManager::SceneManager() : _rayNum( 0 ), _spatialGraph( nullptr )
 
 SceneManager::~SceneManager()
 {
+	setRenderProxiesEnabled( false );
 	delete _spatialGraph;
 
 	for( uint32 i = 0; i < _nodes.size(); ++i )
@@ -665,6 +690,19 @@ void SceneManager::registerNodeType( int nodeType, const string &typeString, Nod
 	NodeRegEntry entry;
 	entry.typeString = typeString;
 	entry.parsingFunc = pf;
+	entry.attribParsingFunc = 0x0;
+	entry.factoryFunc = ff;
+	_registry[nodeType] = entry;
+}
+
+
+void SceneManager::registerNodeType( int nodeType, const string &typeString, NodeTypeAttribParsingFunc pf,
+                                     NodeTypeFactoryFunc ff )
+{
+	NodeRegEntry entry;
+	entry.typeString = typeString;
+	entry.parsingFunc = 0x0;
+	entry.attribParsingFunc = pf;
 	entry.factoryFunc = ff;
 	_registry[nodeType] = entry;
 }
@@ -696,6 +734,8 @@ NodeRegEntry *SceneManager::findType( const string &typeString )
 
 void SceneManager::updateNodes()
 {
+	H3D_PROFILE_ZONE( "SceneManager::updateNodes" );
+
 	getRootNode().updateTree();
 }
 
@@ -703,25 +743,34 @@ void SceneManager::updateNodes()
 void SceneManager::updateQueues( const Frustum &frustum1, const Frustum *frustum2, RenderingOrder::List order,
                                  uint32 filterIgnore, bool lightQueue, bool renderableQueue )
 {
-	_spatialGraph->updateQueues( frustum1, frustum2, order, filterIgnore, lightQueue, renderableQueue );
+	H3D_PROFILE_ZONE( "SceneManager::updateQueues" );
+	
+	// Render proxies are updated at the frame sync point
+	if( _proxyGraph == 0x0 ) updateNodes();
+	
+	getRenderGraph()->updateQueues( frustum1, frustum2, order, filterIgnore, lightQueue, renderableQueue );
 }
 
 
 void SceneManager::updateQueues( uint32 filterIgnore, bool forceUpdateAllViews /* = false */ )
 {
-	_spatialGraph->updateQueues( filterIgnore, forceUpdateAllViews );
+	H3D_PROFILE_ZONE( "SceneManager::updateViewQueues" );
+
+	if( _proxyGraph == 0x0 ) updateNodes();
+
+	getRenderGraph()->updateQueues( filterIgnore, forceUpdateAllViews );
 }
 
 
 void SceneManager::sortViewObjects( int viewID, RenderingOrder::List order )
 {
-	_spatialGraph->sortViewObjects( viewID, order );
+	getRenderGraph()->sortViewObjects( viewID, order );
 }
 
 
 void SceneManager::sortViewObjects( RenderingOrder::List order )
 {
-	_spatialGraph->sortViewObjects( order );
+	getRenderGraph()->sortViewObjects( order );
 }
 
 NodeHandle SceneManager::parseNode( SceneNodeTpl &tpl, SceneNode *parent )
@@ -1003,7 +1052,16 @@ int SceneManager::checkNodeVisibility( SceneNode &node, CameraNode &cam, bool ch
 	// Check occlusion
 	if( checkOcclusion && cam._occSet >= 0 && node.checkOcclusionSupported() )
 	{
-		uint32 query = node.getOcclusionResult( cam._occSet );
+		// Occlusion queries are owned by the render proxy when rendering is pipelined
+		SceneNode *occNode = &node;
+		if( _proxyGraph != 0x0 )
+		{
+			Modules::renderer().acquireRenderContext();
+			occNode = getRenderProxy( node._handle );
+			if( occNode == 0x0 ) occNode = &node;
+		}
+		
+		uint32 query = occNode->getOcclusionResult( cam._occSet );
 		if ( query != Math::MaxUInt32 && rdi->getQueryResult( query ) < 1 ) // Math::MaxUInt32 means incorrect result
 			return -1;
 	}
@@ -1018,21 +1076,95 @@ int SceneManager::checkNodeVisibility( SceneNode &node, CameraNode &cam, bool ch
 }
 
 
+void SceneManager::setRenderProxiesEnabled( bool enabled )
+{
+	if( enabled == (_proxyGraph != 0x0) ) return;
+
+	if( enabled )
+	{
+		_proxyGraph = new SpatialGraph();
+		return;
+	}
+
+	for( size_t i = 0; i < _renderProxies.size(); ++i ) delete _renderProxies[i];
+	_renderProxies.clear();
+	_proxySources.clear();
+
+	delete _proxyGraph; _proxyGraph = 0x0;
+}
+
+
+void SceneManager::updateRenderProxies()
+{
+	if( _proxyGraph == 0x0 ) return;
+	
+	H3D_PROFILE_ZONE( "SceneManager::updateRenderProxies" );
+
+	updateNodes();
+
+	_renderProxies.resize( _nodes.size(), 0x0 );
+	_proxySources.resize( _nodes.size(), 0x0 );
+
+	// Create proxies for new nodes first, so that proxies can reference each other when they are updated
+	for( size_t i = 0, s = _nodes.size(); i < s; ++i )
+	{
+		SceneNode *node = _nodes[i];
+		SceneNode *proxy = _renderProxies[i];
+		
+		if( proxy != 0x0 && (node != _proxySources[i] || node->_type != proxy->_type) )
+		{
+			// Node was removed or the slot was reused; proxies are only deleted while the render thread
+			// is idle, since resource reference counts are not thread-safe
+			_proxyGraph->removeNode( proxy->_sgHandle );
+			delete proxy;
+			_renderProxies[i] = 0x0;
+			_proxySources[i] = 0x0;
+		}
+
+		if( node != 0x0 && _renderProxies[i] == 0x0 )
+		{
+			proxy = node->createRenderProxy();
+			if( proxy == 0x0 ) continue;
+
+			// Proxies are not part of the scene tree and have their own occlusion queries
+			proxy->_children.clear();
+			proxy->_parent = 0x0;
+			proxy->_occQueries.clear();
+			proxy->_occQueriesLastVisited.clear();
+			proxy->_sgHandle = 0;
+			proxy->_renderProxy = true;
+			
+			_renderProxies[i] = proxy;
+			_proxySources[i] = node;
+			_proxyGraph->addNode( *proxy );
+		}
+	}
+
+	for( size_t i = 0, s = _nodes.size(); i < s; ++i )
+	{
+		if( _renderProxies[i] == 0x0 ) continue;
+
+		_nodes[i]->updateRenderProxy( *_renderProxies[i] );
+		_proxyGraph->updateNode( _renderProxies[i]->_sgHandle );
+	}
+}
+
+
 int SceneManager::addRenderView( RenderViewType type, SceneNode *node, const Frustum &f, int link /*= -1*/, uint32 additionalFilter /* = 0 */ )
 {
-	return _spatialGraph->addView( type, node, f, link, additionalFilter );
+	return getRenderGraph()->addView( type, node, f, link, additionalFilter );
 }
 
 
 void SceneManager::clearRenderViews()
 {
-	_spatialGraph->clearViews();
+	getRenderGraph()->clearViews();
 }
 
 
 void SceneManager::setCurrentView( int viewID )
 {
-	_spatialGraph->setCurrentView( viewID );
+	getRenderGraph()->setCurrentView( viewID );
 }
 
 }  // namespace
@@ -25,6 +25,7 @@ namespace Horde3D {
 struct SceneNodeTpl;
 class CameraNode;
 class SceneGraphResource;
+class SceneNodeAttribs;
 
 
 const int RootNode = 1;
@@ -129,6 +130,10 @@ public:
 
 	virtual void setCustomInstData( const float *data, uint32 count ) {}
 
+	// Render proxies are copies of the node state that are used by the render thread when rendering is pipelined
+	virtual SceneNode *createRenderProxy() const { return 0x0; }
+	virtual void updateRenderProxy( SceneNode &proxy ) const;
+
 	int getType() const { return _type; };
 	NodeHandle getHandle() const { return _handle; }
 	SceneNode *getParent() const { return _parent; }
@@ -172,6 +177,7 @@ protected:
 	bool                        _renderable;
 	bool						_lodSupported;
 	bool						_occlusionCullingSupported;
+	bool                        _renderProxy;  // Node is a snapshot that does not own shared data
 
 	friend class SceneManager;
 	friend class SpatialGraph;
@@ -196,7 +202,7 @@ struct GroupNodeTpl : public SceneNodeTpl
 class GroupNode : public SceneNode
 {
 public:
-	static SceneNodeTpl *parsingFunc( std::map< std::string, std::string > &attribs );
+	static SceneNodeTpl *parsingFunc( const SceneNodeAttribs &attribs );
 	static SceneNode *factoryFunc( const SceneNodeTpl &nodeTpl );
 
 	friend class Renderer;
@@ -286,6 +292,9 @@ public:
 
 	std::vector< SceneNode * > &getLightQueue() { return _lightQueue; }
 	RenderQueue &getRenderQueue();
+protected:
+	void cullView( RenderView *view, RenderView *cameraView, uint32 filterIgnore, const Vec3f &camPos );
+
 protected:
 	std::vector< SceneNode * >     _nodes;		// Renderable nodes and lights
 	std::vector< uint32 >          _freeList;
@@ -304,14 +313,29 @@ protected:
 // Scene Manager
 // =================================================================================================
 
+// Read access to the type specific attributes of a node in a scene graph resource, independent of
+// the file format; values are converted if they are stored with a different type
+class SceneNodeAttribs
+{
+public:
+	virtual ~SceneNodeAttribs() {}
+	
+	virtual const char *getString( const char *name ) const = 0;  // Returns 0x0 if missing
+	virtual bool getInt( const char *name, int &value ) const = 0;
+	virtual bool getFloat( const char *name, float &value ) const = 0;
+	bool getBool( const char *name, bool &value ) const;
+};
+
 typedef SceneNodeTpl *(*NodeTypeParsingFunc)( std::map< std::string, std::string > &attribs );
+typedef SceneNodeTpl *(*NodeTypeAttribParsingFunc)( const SceneNodeAttribs &attribs );
 typedef SceneNode *(*NodeTypeFactoryFunc)( const SceneNodeTpl &tpl );
 
 struct NodeRegEntry
 {
-	std::string          typeString;
-	NodeTypeParsingFunc  parsingFunc;
-	NodeTypeFactoryFunc  factoryFunc;
+	std::string                typeString;
+	NodeTypeParsingFunc        parsingFunc;        // Receives all attributes as strings
+	NodeTypeAttribParsingFunc  attribParsingFunc;  // Used instead of parsingFunc if set
+	NodeTypeFactoryFunc        factoryFunc;
 };
 
 struct CastRayResult
@@ -333,6 +357,8 @@ public:
 
 	void registerNodeType( int nodeType, const std::string &typeString, NodeTypeParsingFunc pf,
 	                       NodeTypeFactoryFunc ff );
+	void registerNodeType( int nodeType, const std::string &typeString, NodeTypeAttribParsingFunc pf,
+	                       NodeTypeFactoryFunc ff );
 	NodeRegEntry *findType( int type );
 	NodeRegEntry *findType( const std::string &typeString );
 	
@@ -352,6 +378,15 @@ public:
 
 	int checkNodeVisibility( SceneNode &node, CameraNode &cam, bool checkOcclusion, bool calcLod );
 
+	//
+	// Render proxy functions
+	//
+	void setRenderProxiesEnabled( bool enabled );
+	void updateRenderProxies();
+	SceneNode *getRenderProxy( NodeHandle handle ) const
+		{ return (handle != 0 && (unsigned)(handle - 1) < _renderProxies.size()) ? _renderProxies[handle - 1] : 0x0; }
+	const std::vector< SceneNode * > &getRenderNodes() const { return _proxyGraph != 0x0 ? _renderProxies : _nodes; }
+
 	SceneNode &getRootNode() const { return *_nodes[0]; }
 	SceneNode &getDefCamNode() const { return *_nodes[1]; }
 	
@@ -359,9 +394,10 @@ public:
 		{ return (handle != 0 && (unsigned)(handle - 1) < _nodes.size()) ? _nodes[handle - 1] : 0x0; }
 
 	//
-	// Spatial graph related functions
+	// Spatial graph related functions (renderer side, these use the graph of render proxies if enabled)
 	//
 	void updateSpatialNode( uint32 sgHandle ) { _spatialGraph->updateNode( sgHandle ); }
+	SpatialGraph *getRenderGraph() const { return _proxyGraph != 0x0 ? _proxyGraph : _spatialGraph; }
 
 	void updateQueues( uint32 filterIgnore, bool forceUpdateAllViews = false );
 	void updateQueues( const Frustum &frustum1, const Frustum *frustum2,
@@ -371,13 +407,13 @@ public:
 	void sortViewObjects( int viewID, RenderingOrder::List order );
 
 	int addRenderView( RenderViewType type, SceneNode *node, const Frustum &f, int link = -1, uint32 additionalFilter = 0 );
-	std::vector< RenderView > &getRenderViews() const { return _spatialGraph->getRenderViews(); }
+	std::vector< RenderView > &getRenderViews() const { return getRenderGraph()->getRenderViews(); }
 	void clearRenderViews();
-	int getActiveRenderViewCount() { return _spatialGraph->getRenderViewCount(); }
+	int getActiveRenderViewCount() { return getRenderGraph()->getRenderViewCount(); }
 
 	void setCurrentView( int viewID );
-	std::vector< SceneNode * > &getLightQueue() const { return _spatialGraph->getLightQueue(); }
-	RenderQueue &getRenderQueue() const { return _spatialGraph->getRenderQueue(); }
+	std::vector< SceneNode * > &getLightQueue() const { return getRenderGraph()->getLightQueue(); }
+	RenderQueue &getRenderQueue() const { return getRenderGraph()->getRenderQueue(); }
 
 protected:
 	NodeHandle parseNode( SceneNodeTpl &tpl, SceneNode *parent );
@@ -392,6 +428,10 @@ protected:
 	std::vector< CastRayResult >   _castRayResults;
 	SpatialGraph                   *_spatialGraph;
 
+	std::vector< SceneNode * >     _renderProxies;  // Indexed like _nodes
+	std::vector< SceneNode * >     _proxySources;   // Nodes the proxies were created from
+	SpatialGraph                   *_proxyGraph;
+
 	std::map< int, NodeRegEntry >  _registry;  // Registry of node types
 
 	Vec3f                          _rayOrigin;  // Don't put these values on the stack during recursive search
@@ -14,8 +14,10 @@
 #include "egModules.h"
 #include "egCom.h"
 #include "utXML.h"
+#include "utEndian.h"
 #include "rapidxml_print.h"
 #include <iterator>
+#include <cstdio>
 
 #include "utDebug.h"
 
@@ -24,6 +26,144 @@ namespace Horde3D {
 
 using namespace std;
 
+// Attribute access for the different scene graph formats
+
+class XMLSceneNodeAttribs : public SceneNodeAttribs
+{
+public:
+	XMLSceneNodeAttribs( XMLNode &xmlNode ) : _xmlNode( xmlNode ) {}
+
+	const char *getString( const char *name ) const { return _xmlNode.getAttribute( name, 0x0 ); }
+	
+	bool getInt( const char *name, int &value ) const
+	{
+		const char *str = getString( name );
+		if( str != 0x0 ) value = atoi( str );
+		return str != 0x0;
+	}
+
+	bool getFloat( const char *name, float &value ) const
+	{
+		const char *str = getString( name );
+		if( str != 0x0 ) value = toFloat( str );
+		return str != 0x0;
+	}
+
+private:
+	XMLNode  &_xmlNode;
+};
+
+
+class BinarySceneNodeAttribs : public SceneNodeAttribs
+{
+public:
+	// Attributes are triples of name, value type and value; names and strings are indices into
+	// the validated string table
+	BinarySceneNodeAttribs( const char *attribData, uint32 attribCount, const char *const *strings ) :
+		_attribData( attribData ), _attribCount( attribCount ), _strings( strings ) {}
+
+	uint32 getCount() const { return _attribCount; }
+	const char *getName( uint32 index ) const { return _strings[getAttrib( index, 0 )]; }
+	
+	const char *getString( uint32 index ) const
+	{
+		uint32 value = getAttrib( index, 2 );
+		switch( getAttrib( index, 1 ) )
+		{
+		case SceneGraphAttribTypes::Int:
+			sprintf( _convBuf, "%i", (int)value );
+			return _convBuf;
+		case SceneGraphAttribTypes::Float:
+			sprintf( _convBuf, "%.9g", asFloat( value ) );
+			return _convBuf;
+		default:
+			return _strings[value];
+		}
+	}
+	
+	const char *getString( const char *name ) const
+	{
+		uint32 index = find( name );
+		return index < _attribCount ? getString( index ) : 0x0;
+	}
+
+	bool getInt( const char *name, int &value ) const
+	{
+		uint32 index = find( name );
+		if( index >= _attribCount ) return false;
+		
+		switch( getAttrib( index, 1 ) )
+		{
+		case SceneGraphAttribTypes::Int: value = (int)getAttrib( index, 2 ); break;
+		case SceneGraphAttribTypes::Float: value = (int)asFloat( getAttrib( index, 2 ) ); break;
+		default: value = atoi( _strings[getAttrib( index, 2 )] ); break;
+		}
+		return true;
+	}
+
+	bool getFloat( const char *name, float &value ) const
+	{
+		uint32 index = find( name );
+		if( index >= _attribCount ) return false;
+		
+		switch( getAttrib( index, 1 ) )
+		{
+		case SceneGraphAttribTypes::Int: value = (float)(int)getAttrib( index, 2 ); break;
+		case SceneGraphAttribTypes::Float: value = asFloat( getAttrib( index, 2 ) ); break;
+		default: value = toFloat( _strings[getAttrib( index, 2 )] ); break;
+		}
+		return true;
+	}
+
+private:
+	uint32 getAttrib( uint32 index, uint32 field ) const
+	{
+		uint32 value;
+		elemcpy_le( &value, (uint32 *)(_attribData + (index * 3 + field) * 4), 1 );
+		return value;
+	}
+
+	static float asFloat( uint32 bits )
+	{
+		float value;
+		memcpy( &value, &bits, 4 );
+		return value;
+	}
+
+	uint32 find( const char *name ) const
+	{
+		for( uint32 i = 0; i < _attribCount; ++i )
+		{
+			if( strcmp( getName( i ), name ) == 0 ) return i;
+		}
+		return _attribCount;
+	}
+
+private:
+	const char         *_attribData;
+	uint32             _attribCount;
+	const char *const  *_strings;
+	mutable char       _convBuf[32];
+};
+
+
+struct BinarySceneGraphReader
+{
+	const char                    *pos, *end;
+	std::vector< const char * >   strings;
+	std::vector< NodeRegEntry * > typeEntries;   // Node type of strings that are used as type names
+	std::vector< char >           typeResolved;  // Actually bool
+	uint32                        nodeCount;
+};
+
+struct BinarySceneNodeFrame
+{
+	SceneNodeTpl  *nodeTpl;  // 0x0 if the node could not be created, its children are skipped
+	uint32        remainingChildren;
+};
+
+// =================================================================================================
+
 
 SceneGraphResource::SceneGraphResource( const string &name, int flags ) :
 	Resource( ResourceTypes::SceneGraph, name, flags )
@@ -103,7 +243,11 @@ bool SceneGraphResource::parseNode( XMLNode &xmlNode, SceneNodeTpl *parentTpl )
 		else
 		{
 			NodeRegEntry *entry = Modules::sceneMan().findType( xmlNode.getName() );
-			if( entry != 0x0 )
+			if( entry != 0x0 && entry->attribParsingFunc != 0x0 )
+			{
+				nodeTpl = (*entry->attribParsingFunc)( XMLSceneNodeAttribs( xmlNode ) );
+			}
+			else if( entry != 0x0 )
 			{
 				map< string, string > attribs;
 				
@@ -170,9 +314,178 @@ bool SceneGraphResource::parseNode( XMLNode &xmlNode, SceneNodeTpl *parentTpl )
 }
 
 
+bool SceneGraphResource::parseBinaryNode( BinarySceneGraphReader &reader, SceneNodeTpl *parentTpl, bool skip,
+                                          SceneNodeTpl *&nodeTpl, uint32 &childCount )
+{
+	// Node record: type, name, number of children, translation, rotation, scale, attachment and
+	// number of attributes, followed by the attributes
+	const uint32 recordSize = 14 * 4, attribSize = 3 * 4;
+	const uint32 stringCount = (uint32)reader.strings.size();
+	
+	uint32 record[14];
+	if( reader.end - reader.pos < (ptrdiff_t)recordSize ) return raiseError( "Unexpected end of node data" );
+	reader.pos = elemcpy_le( record, (uint32 *)reader.pos, 14 );
+	
+	uint32 type = record[0], name = record[1];
+	childCount = record[2];
+	uint32 attachment = record[12], attribCount = record[13];
+	if( type >= stringCount || name >= stringCount || (attachment != 0xffffffff && attachment >= stringCount) ||
+	    (uint64)(reader.end - reader.pos) < (uint64)attribCount * attribSize )
+		return raiseError( "Invalid node record" );
+
+	BinarySceneNodeAttribs attribs( reader.pos, attribCount, &reader.strings[0] );
+	for( uint32 i = 0; i < attribCount; ++i )
+	{
+		uint32 attrib[3];  // Name, value type, value
+		reader.pos = elemcpy_le( attrib, (uint32 *)reader.pos, 3 );
+		if( attrib[0] >= stringCount || attrib[1] > SceneGraphAttribTypes::String ||
+		    (attrib[1] == SceneGraphAttribTypes::String && attrib[2] >= stringCount) )
+			return raiseError( "Invalid node attribute" );
+	}
+	++reader.nodeCount;
+
+	nodeTpl = 0x0;
+	if( !skip )
+	{
+		const char *typeName = reader.strings[type];
+		if( strcmp( typeName, "Reference" ) == 0 )
+		{
+			const char *sceneGraph = attribs.getString( "sceneGraph" );
+			if( sceneGraph != 0x0 && *sceneGraph != '\0' )
+			{
+				Resource *res = Modules::resMan().resolveResHandle( Modules::resMan().addResource(
+					ResourceTypes::SceneGraph, sceneGraph, 0, false ) );
+				if( res != 0x0 ) nodeTpl = new ReferenceNodeTpl( "", (SceneGraphResource *)res );
+			}
+		}
+		else
+		{
+			// Type names are shared by many nodes, so the registry is only searched once per name
+			if( !reader.typeResolved[type] )
+			{
+				reader.typeEntries[type] = Modules::sceneMan().findType( typeName );
+				reader.typeResolved[type] = 1;
+			}
+			
+			NodeRegEntry *entry = reader.typeEntries[type];
+			if( entry != 0x0 && entry->attribParsingFunc != 0x0 )
+			{
+				nodeTpl = (*entry->attribParsingFunc)( attribs );
+			}
+			else if( entry != 0x0 )
+			{
+				map< string, string > attribMap;
+				for( uint32 i = 0; i < attribCount; ++i )
+					attribMap[attribs.getName( i )] = attribs.getString( i );
+				
+				nodeTpl = (*entry->parsingFunc)( attribMap );
+			}
+		}
+
+		if( nodeTpl != 0x0 )
+		{
+			float transform[9];
+			memcpy( transform, &record[3], sizeof( transform ) );
+			nodeTpl->name = reader.strings[name];
+			nodeTpl->trans = Vec3f( transform[0], transform[1], transform[2] );
+			nodeTpl->rot = Vec3f( transform[3], transform[4], transform[5] );
+			nodeTpl->scale = Vec3f( transform[6], transform[7], transform[8] );
+			if( attachment != 0xffffffff ) nodeTpl->attachmentString = reader.strings[attachment];
+
+			if( parentTpl != 0x0 )
+			{
+				parentTpl->children.push_back( nodeTpl );
+			}
+			else
+			{	
+				delete _rootNode;	// Delete default root
+				_rootNode = nodeTpl;
+			}
+		}
+		else
+		{
+			Modules::log().writeWarning( "SceneGraph resource '%s': Unknown node type or missing attribute for '%s'",
+			                             _name.c_str(), typeName );
+		}
+	}
+
+	return true;
+}
+
+
+bool SceneGraphResource::loadBinary( const char *data, int size )
+{
+	// Header: magic, version, number of strings, size of string data and number of nodes; the
+	// header is followed by the string offsets, the string data and the node records in depth-first order
+	const uint32 headerSize = 20;
+	if( size < (int)headerSize ) return raiseError( "Invalid binary scene graph" );
+
+	uint32 header[4];
+	elemcpy_le( header, (uint32 *)(data + 4), 4 );
+	uint32 version = header[0], stringCount = header[1], stringDataSize = header[2], nodeCount = header[3];
+	if( version != 1 ) return raiseError( "Unsupported version of binary scene graph" );
+
+	// Validate string table
+	uint64 nodeDataOffset = (uint64)headerSize + (uint64)stringCount * 4 + stringDataSize;
+	if( nodeDataOffset > (uint64)size || stringCount == 0 || stringDataSize == 0 )
+		return raiseError( "Invalid string table" );
+	const char *stringData = data + headerSize + stringCount * 4;
+	if( stringData[stringDataSize - 1] != '\0' ) return raiseError( "Invalid string table" );
+
+	BinarySceneGraphReader reader;
+	reader.strings.resize( stringCount );
+	reader.typeEntries.resize( stringCount, 0x0 );
+	reader.typeResolved.resize( stringCount, 0 );
+	reader.nodeCount = 0;
+	for( uint32 i = 0; i < stringCount; ++i )
+	{
+		uint32 offset;
+		elemcpy_le( &offset, (uint32 *)(data + headerSize + i * 4), 1 );
+		if( offset >= stringDataSize ) return raiseError( "Invalid string table" );
+		reader.strings[i] = stringData + offset;
+	}
+	
+	// Parse nodes
+	reader.pos = data + nodeDataOffset;
+	reader.end = data + size;
+	if( nodeCount == 0 ) return raiseError( "Empty scene graph" );
+
+	// Nodes are parsed with an explicit stack, so that deep hierarchies in malformed files can't
+	// exhaust the call stack
+	vector< BinarySceneNodeFrame > stack;
+	BinarySceneNodeFrame frame;
+	if( !parseBinaryNode( reader, 0x0, false, frame.nodeTpl, frame.remainingChildren ) ) return false;
+	stack.push_back( frame );
+	
+	while( !stack.empty() )
+	{
+		if( stack.back().remainingChildren == 0 )
+		{
+			stack.pop_back();
+			continue;
+		}
+		--stack.back().remainingChildren;
+		if( reader.nodeCount >= nodeCount ) return raiseError( "Invalid node count" );
+
+		// Children of nodes that could not be created are skipped
+		SceneNodeTpl *parentTpl = stack.back().nodeTpl;
+		if( !parseBinaryNode( reader, parentTpl, parentTpl == 0x0, frame.nodeTpl, frame.remainingChildren ) )
+			return false;
+		stack.push_back( frame );
+	}
+	if( reader.nodeCount != nodeCount ) return raiseError( "Invalid node count" );
+
+	return true;
+}
+
+
 bool SceneGraphResource::load( const char *data, int size )
 {
 	if( !Resource::load( data, size ) ) return false;
+
+	// Binary scene graphs are converted offline from XML by ColladaConv
+	if( size >= 4 && memcmp( data, "H3DS", 4 ) == 0 )
+		return loadBinary( data, size );
 	
 	XMLDoc doc;
 	doc.parseBuffer( data, size );
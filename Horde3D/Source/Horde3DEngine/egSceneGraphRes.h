@@ -22,12 +22,25 @@
 namespace Horde3D {
 
 class XMLNode;
+struct BinarySceneGraphReader;
 
 
 // =================================================================================================
 // SceneGraph Resource
 // =================================================================================================
 
+struct SceneGraphAttribTypes	// Value types of node attributes in binary scene graph files
+{
+	enum List
+	{
+		Int = 0,
+		Float,
+		String
+	};
+};
+
+// =================================================================================================
+
 class SceneGraphResource : public Resource
 {
 public:
@@ -47,6 +60,9 @@ private:
 	bool raiseError( const std::string &msg );
 	void parseBaseAttributes( XMLNode &xmlNode, SceneNodeTpl &nodeTpl );
 	bool parseNode( XMLNode &xmlNode, SceneNodeTpl *parentTpl );
+	bool loadBinary( const char *data, int size );
+	bool parseBinaryNode( BinarySceneGraphReader &reader, SceneNodeTpl *parentTpl, bool skip,
+	                      SceneNodeTpl *&nodeTpl, uint32 &childCount );
 
 private:
 	SceneNodeTpl	*_rootNode;
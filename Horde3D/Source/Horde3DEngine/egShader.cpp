@@ -16,6 +16,8 @@
 #include "egRenderer.h"
 #include <fstream>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
 
 #include "utDebug.h"
 
@@ -28,8 +30,8 @@ using namespace std;
 // Code Resource
 // =================================================================================================
 
-CodeResource::CodeResource( const string &name, int flags ) :
-	Resource( ResourceTypes::Code, name, flags )
+CodeResource::CodeResource( const string &name, int flags, ShaderResource *ownerShader ) :
+	Resource( ResourceTypes::Code, name, flags ), _ownerShader( ownerShader )
 {
 	initDefault();
 }
@@ -46,6 +48,14 @@ Resource *CodeResource::clone()
 	CodeResource *res = new CodeResource( "", _flags );
 
 	*res = *this;
+
+	// Nothing includes the clone yet
+	res->_includers.clear();
+	res->_shaderUsers.clear();
+	for( uint32 i = 0; i < res->_includes.size(); ++i )
+	{
+		res->linkInclude( res->_includes[i].first );
+	}
 	
 	return res;
 }
@@ -55,13 +65,21 @@ void CodeResource::initDefault()
 {
 	_flagMask = 0;
 	_code.clear();
+	_assembledCode.clear();
+	_assembledCodeValid = false;
 }
 
 
 void CodeResource::release()
 {
+	// Code including this resource has to be assembled again
+	std::vector< CodeResource * > visited;
+	std::vector< ShaderResource * > shaders;
+	collectDependents( visited, shaders );
+	
 	for( uint32 i = 0; i < _includes.size(); ++i )
 	{
+		unlinkInclude( _includes[i].first );
 		_includes[i].first = 0x0;
 	}
 	_includes.clear();
@@ -140,6 +158,7 @@ bool CodeResource::load( const char *data, int size )
 						ResourceTypes::Code, resName, 0, false );
 					CodeResource *codeRes = (CodeResource *)Modules::resMan().resolveResHandle( res );
 					_includes.push_back( std::pair< PCodeResource, size_t >( codeRes, pCode - code ) );
+					linkInclude( codeRes );
 				}
 				else
 				{
@@ -210,54 +229,117 @@ bool CodeResource::tryLinking( uint32 *flagMask )
 }
 
 
-std::string CodeResource::assembleCode() const
+const std::string &CodeResource::assembleCode() const
+{
+	if( _assembledCodeValid ) return _assembledCode;
+	
+	_assembledCode.clear();
+	if( _loaded )
+	{
+		// Insert included code at the recorded locations (which are in ascending order)
+		size_t pos = 0;
+		for( uint32 i = 0; i < _includes.size(); ++i )
+		{
+			const std::string &depCode = _includes[i].first->assembleCode();
+			_assembledCode.append( _code, pos, _includes[i].second - pos );
+			_assembledCode.append( depCode );
+			pos = _includes[i].second;
+		}
+		_assembledCode.append( _code, pos, std::string::npos );
+	}
+	_assembledCodeValid = true;
+
+	return _assembledCode;
+}
+
+
+void CodeResource::linkInclude( CodeResource *codeRes )
+{
+	if( codeRes == 0x0 ) return;
+
+	if( _ownerShader != 0x0 )
+		codeRes->_shaderUsers.push_back( _ownerShader );
+	else
+		codeRes->_includers.push_back( this );
+}
+
+
+void CodeResource::unlinkInclude( CodeResource *codeRes )
+{
+	if( codeRes == 0x0 ) return;
+
+	// Remove only one entry, a shader is listed once for each of its sections including the code
+	if( _ownerShader != 0x0 )
+	{
+		std::vector< ShaderResource * >::iterator itr =
+			std::find( codeRes->_shaderUsers.begin(), codeRes->_shaderUsers.end(), _ownerShader );
+		if( itr != codeRes->_shaderUsers.end() ) codeRes->_shaderUsers.erase( itr );
+	}
+	else
+	{
+		std::vector< CodeResource * >::iterator itr =
+			std::find( codeRes->_includers.begin(), codeRes->_includers.end(), this );
+		if( itr != codeRes->_includers.end() ) codeRes->_includers.erase( itr );
+	}
+}
+
+
+void CodeResource::collectDependents( std::vector< CodeResource * > &visited, std::vector< ShaderResource * > &shaders )
 {
-	if( !_loaded ) return "";
+	// Visited list guards against include cycles
+	if( std::find( visited.begin(), visited.end(), this ) != visited.end() ) return;
+	visited.push_back( this );
 
-	std::string finalCode = _code;
-	uint32 offset = 0;
+	_assembledCodeValid = false;
 	
-	for( uint32 i = 0; i < _includes.size(); ++i )
+	for( uint32 i = 0; i < _shaderUsers.size(); ++i )
 	{
-		std::string depCode = _includes[i].first->assembleCode();
-		finalCode.insert( _includes[i].second + offset, depCode );
-		offset += (uint32)depCode.length();
+		ShaderResource *shaderRes = _shaderUsers[i];
+		if( std::find( shaders.begin(), shaders.end(), shaderRes ) != shaders.end() ) continue;
+		
+		shaders.push_back( shaderRes );
+		for( uint32 j = 0; j < shaderRes->getCodeCount(); ++j )
+		{
+			shaderRes->getCode( j )->invalidateAssembledCode();
+		}
 	}
 
-	return finalCode;
+	for( uint32 i = 0; i < _includers.size(); ++i )
+	{
+		_includers[i]->collectDependents( visited, shaders );
+	}
 }
 
 
 void CodeResource::updateShaders()
 {
-	auto resources = Modules::resMan().getResources();
-	for( uint32 i = 0; i < resources.size(); ++i )
-	{
-		Resource *res = resources[ i ];
+	// Only shaders that include this code directly or indirectly are affected
+	std::vector< CodeResource * > visited;
+	std::vector< ShaderResource * > shaders;
+	collectDependents( visited, shaders );
 
-		if( res != 0x0 && res->getType() == ResourceTypes::Shader )
+	for( uint32 i = 0; i < shaders.size(); ++i )
+	{
+		ShaderResource *shaderRes = shaders[i];
+			
+		// Mark shaders using this code as uncompiled
+		for( uint32 j = 0; j < shaderRes->getContexts().size(); ++j )
 		{
-			ShaderResource *shaderRes = (ShaderResource *)res;
+			ShaderContext &context = shaderRes->getContexts()[j];
 			
-			// Mark shaders using this code as uncompiled
-			for( uint32 j = 0; j < shaderRes->getContexts().size(); ++j )
+			if ( ( context.vertCodeIdx >= 0 && shaderRes->getCode( context.vertCodeIdx )->hasDependency( this ) ) ||
+				 ( context.fragCodeIdx >= 0 && shaderRes->getCode( context.fragCodeIdx )->hasDependency( this ) ) ||
+				 ( context.geomCodeIdx >= 0 && shaderRes->getCode( context.geomCodeIdx )->hasDependency( this ) ) ||
+				 ( context.computeCodeIdx >= 0 && shaderRes->getCode( context.computeCodeIdx )->hasDependency( this ) ) ||
+				 ( context.tessCtlCodeIdx >= 0 && shaderRes->getCode( context.tessCtlCodeIdx )->hasDependency( this ) ) ||
+				 ( context.tessEvalCodeIdx >= 0 && shaderRes->getCode( context.tessEvalCodeIdx )->hasDependency( this ) ) )
 			{
-				ShaderContext &context = shaderRes->getContexts()[j];
-				
-				if ( ( context.vertCodeIdx >= 0 && shaderRes->getCode( context.vertCodeIdx )->hasDependency( this ) ) ||
-					 ( context.fragCodeIdx >= 0 && shaderRes->getCode( context.fragCodeIdx )->hasDependency( this ) ) ||
-					 ( context.geomCodeIdx >= 0 && shaderRes->getCode( context.geomCodeIdx )->hasDependency( this ) ) ||
-					 ( context.computeCodeIdx >= 0 && shaderRes->getCode( context.computeCodeIdx )->hasDependency( this ) ) ||
-					 ( context.tessCtlCodeIdx >= 0 && shaderRes->getCode( context.tessCtlCodeIdx )->hasDependency( this ) ) ||
-					 ( context.tessEvalCodeIdx >= 0 && shaderRes->getCode( context.tessEvalCodeIdx )->hasDependency( this ) ) )
-				{
-					context.compiled = false;
-				}
+				context.compiled = false;
 			}
-			
-			// Recompile shaders
-			shaderRes->compileContexts();
 		}
+		
+		// Recompile shaders
+		shaderRes->compileContexts();
 	}
 }
 
@@ -396,6 +478,10 @@ string ShaderResource::_tmpCodeGS = "";
 string ShaderResource::_tmpCodeCS = "";
 string ShaderResource::_tmpCodeTSCtl = "";
 string ShaderResource::_tmpCodeTSEval = "";
+std::unordered_map< std::string, int > ShaderResource::_contextIds;
+std::deque< std::string > ShaderResource::_contextNames;
+std::mutex ShaderResource::_contextIdsMutex;
+uint32 ShaderResource::_contextsStampCounter = 0;
 
 // Parsing constants
 static const char *identifier = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_";
@@ -453,7 +539,8 @@ void ShaderResource::initializationFunc()
 
 void ShaderResource::initDefault()
 {
-	
+	_contextIndices.clear();
+	_contextsStamp = ++_contextsStampCounter;
 }
 
 
@@ -470,6 +557,8 @@ void ShaderResource::release()
 	}
 
 	_contexts.clear();
+	_contextIndices.clear();
+	_contextsStamp = ++_contextsStampCounter;
 	_samplers.clear();
 	_uniforms.clear();
 	//_preLoadList.clear();
@@ -1072,7 +1161,7 @@ bool ShaderResource::load( const char *data, int size )
 			{
 				// Add section as private code resource which is not managed by resource manager
 				_tmpCodeVS.assign( sectionNameStart, sectionNameEnd );
-				_codeSections.push_back( CodeResource( _tmpCodeVS, 0 ) );
+				_codeSections.push_back( CodeResource( _tmpCodeVS, 0, this ) );
  				_tmpCodeVS.assign( sectionContentStart, sectionContentEnd );
 				tempCodeSections.push_back( _tmpCodeVS );
 				// 				_codeSections.back().load( _tmpCodeVS.c_str(), (uint32)_tmpCodeVS.length() );
@@ -1087,6 +1176,14 @@ bool ShaderResource::load( const char *data, int size )
 	delete[] fxCode; fxCode = 0x0;
 	if( !result ) return false;
 
+	// Map global context ids to contexts for fast lookup when rendering
+	for( uint32 i = 0; i < _contexts.size(); ++i )
+	{
+		int contextId = getContextId( _contexts[i].id );
+		if( contextId >= (int)_contextIndices.size() ) _contextIndices.resize( contextId + 1, -1 );
+		_contextIndices[contextId] = (int)i;
+	}
+
 	// Load only code sections that are required for contexts
 	for ( size_t i = 0; i < _contexts.size(); ++i )
 	{
@@ -1117,146 +1214,138 @@ bool ShaderResource::load( const char *data, int size )
 
 void ShaderResource::preLoadCombination( uint32 combMask )
 {
+	std::vector< PendingShaderComb > batch;
+	queueCombination( combMask, batch );
+	compileBatch( batch );
+}
+
+
+void ShaderResource::queueCombination( uint32 combMask, std::vector< PendingShaderComb > &batch )
+{
+	// Combinations are compiled together with the contexts when the shader gets loaded
 	if( !_loaded )
 	{
 		_preLoadList.insert( combMask );
+		return;
 	}
-	else
+
+	for( uint32 i = 0; i < _contexts.size(); ++i )
 	{
-		for( uint32 i = 0; i < _contexts.size(); ++i )
+		ShaderContext &context = _contexts[i];
+		if( !context.compiled )
+		{
+			_preLoadList.insert( combMask );
+			continue;
+		}
+
+		uint32 contextCombMask = combMask & context.flagMask;
+
+		if( findCombination( context, contextCombMask ) == 0x0 )
 		{
-			if( getCombination( _contexts[i], combMask ) == 0x0 )
-				_preLoadList.insert( combMask );
+			addCombination( context, contextCombMask );
+			beginCompilingCombination( i, (uint32)context.shaderCombs.size() - 1, batch );
 		}
 	}
 }
 
 
-bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombination &sc )
+bool ShaderResource::compileBatch( std::vector< PendingShaderComb > &batch )
+{
+	bool result = true;
+	for( size_t i = 0; i < batch.size(); ++i )
+	{
+		result &= batch[i].shaderRes->finishCompilingCombination( batch[i] );
+	}
+	batch.clear();
+
+	return result;
+}
+
+
+void ShaderResource::beginCompilingCombination( uint32 contextIdx, uint32 combIdx, std::vector< PendingShaderComb > &batch )
 {
+	ShaderContext &context = _contexts[contextIdx];
+	ShaderCombination &sc = context.shaderCombs[combIdx];
 	uint32 combMask = sc.combMask;
-	
-	// Add preamble
-	_tmpCodeVS = _vertPreamble;
-	_tmpCodeFS = _fragPreamble;
-	_tmpCodeGS = _geomPreamble;
-	_tmpCodeCS = _computePreamble;
-	_tmpCodeTSCtl = _tessCtlPreamble;
-	_tmpCodeTSEval = _tessEvalPreamble;
-
-	// Insert defines for flags
+
+	batch.push_back( PendingShaderComb() );
+	PendingShaderComb &pending = batch.back();
+	pending.shaderRes = this;
+	pending.contextIdx = contextIdx;
+	pending.combIdx = combIdx;
+
+	// Insert defines for flags; the same block is used for all stages
+	std::string flagDefines;
 	if( combMask != 0 )
 	{
-		_tmpCodeVS += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeFS += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeGS += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeTSCtl += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeTSEval += "\r\n// ---- Flags ----\r\n";
-		_tmpCodeCS += "\r\n// ---- Flags ----\r\n";
+		char defineLine[] = "#define _F00_\r\n";
+		const size_t defineLen = sizeof( defineLine ) - 1;
+		
+		flagDefines.reserve( 64 + 32 * defineLen );
+		flagDefines = "\r\n// ---- Flags ----\r\n";
 
 		for( uint32 i = 1; i <= 32; ++i )
 		{
 			if( combMask & (1 << (i-1)) )
 			{
-				_tmpCodeVS += "#define _F";
-				_tmpCodeVS += ( char ) ( 48 + i / 10 );
-				_tmpCodeVS += ( char ) ( 48 + i % 10 );
-				_tmpCodeVS += "_\r\n";
-
-				_tmpCodeFS += "#define _F";
-				_tmpCodeFS += ( char ) ( 48 + i / 10 );
-				_tmpCodeFS += ( char ) ( 48 + i % 10 );
-				_tmpCodeFS += "_\r\n";
-				
-				// geometry
-				_tmpCodeGS += "#define _F";
-				_tmpCodeGS += ( char ) ( 48 + i / 10 );
-				_tmpCodeGS += ( char ) ( 48 + i % 10 );
-				_tmpCodeGS += "_\r\n";
-
-				// tessellation
-				_tmpCodeTSCtl += "#define _F";
-				_tmpCodeTSCtl += ( char ) ( 48 + i / 10 );
-				_tmpCodeTSCtl += ( char ) ( 48 + i % 10 );
-				_tmpCodeTSCtl += "_\r\n";
-
-				_tmpCodeTSEval += "#define _F";
-				_tmpCodeTSEval += ( char ) ( 48 + i / 10 );
-				_tmpCodeTSEval += ( char ) ( 48 + i % 10 );
-				_tmpCodeTSEval += "_\r\n";
-
-				// compute
-				_tmpCodeCS += "#define _F";
-				_tmpCodeCS += ( char ) ( 48 + i / 10 );
-				_tmpCodeCS += ( char ) ( 48 + i % 10 );
-				_tmpCodeCS += "_\r\n";
+				defineLine[10] = (char)( 48 + i / 10 );
+				defineLine[11] = (char)( 48 + i % 10 );
+				flagDefines.append( defineLine, defineLen );
 			}
 		}
 
-		_tmpCodeVS += "// ---------------\r\n";
-		_tmpCodeFS += "// ---------------\r\n";
-		_tmpCodeGS += "// ---------------\r\n";
-		_tmpCodeTSCtl += "// ---------------\r\n";
-		_tmpCodeTSEval += "// ---------------\r\n";
-		_tmpCodeCS += "// ---------------\r\n";
+		flagDefines += "// ---------------\r\n";
 	}
 
-	// Add actual shader code
-	bool vsAvailable, fsAvailable, csAvailable, gsAvailable, tscAvailable, tseAvailable;
-	vsAvailable = fsAvailable = csAvailable = gsAvailable = tscAvailable = tseAvailable = false;
+	// Add preamble, flags and actual shader code of all stages (vertex, fragment, geometry,
+	// tessellation control, tessellation evaluation, compute)
+	const std::string *preambles[6] = { &_vertPreamble, &_fragPreamble, &_geomPreamble,
+										&_tessCtlPreamble, &_tessEvalPreamble, &_computePreamble };
+	const int codeIndices[6] = { context.vertCodeIdx, context.fragCodeIdx, context.geomCodeIdx,
+								 context.tessCtlCodeIdx, context.tessEvalCodeIdx, context.computeCodeIdx };
+	const char *code[6];
 
-	if ( context.vertCodeIdx >= 0 )
-	{
-		_tmpCodeVS += getCode( context.vertCodeIdx )->assembleCode();
-		vsAvailable = true;
-	}
-	if ( context.fragCodeIdx >= 0 )
-	{
-		_tmpCodeFS += getCode( context.fragCodeIdx )->assembleCode();
-		fsAvailable = true;
-	}
-	if ( context.geomCodeIdx >= 0 )
-	{
-		_tmpCodeGS += getCode( context.geomCodeIdx )->assembleCode();
-		gsAvailable = true;
-	}
-	if ( context.tessCtlCodeIdx >= 0 )
-	{
-		_tmpCodeTSCtl += getCode( context.tessCtlCodeIdx )->assembleCode();
-		tscAvailable = true;
-	}
-	if ( context.tessEvalCodeIdx >= 0 )
-	{
-		_tmpCodeTSEval += getCode( context.tessEvalCodeIdx )->assembleCode();
-		tseAvailable = true;
-	}
-	if ( context.computeCodeIdx >= 0 )
+	for( int i = 0; i < 6; ++i )
 	{
-		_tmpCodeCS += getCode( context.computeCodeIdx )->assembleCode();
-		csAvailable = true;
+		code[i] = 0x0;
+		if( codeIndices[i] < 0 ) continue;
+
+		const std::string &assembledCode = getCode( codeIndices[i] )->assembleCode();
+		std::string &stageCode = pending.code[i];
+		stageCode.reserve( preambles[i]->length() + flagDefines.length() + assembledCode.length() );
+		stageCode.append( *preambles[i] ).append( flagDefines ).append( assembledCode );
+		code[i] = stageCode.c_str();
 	}
 
 	Modules::log().writeInfo( "---- C O M P I L I N G  . S H A D E R . %s@%s[%i] ----",
 		_name.c_str(), context.id.c_str(), sc.combMask );
 	
-	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
-
 	// Unload shader if necessary
 	if( sc.shaderObj != 0 )
 	{
-		rdi->destroyShader( sc.shaderObj );
+		Modules::renderer().getRenderDevice()->destroyShader( sc.shaderObj );
 		sc.shaderObj = 0;
 	}
+	sc.samplersLocs.clear();
+	sc.uniLocs.clear();
+	sc.bufferLocs.clear();
 	
-	// Compile shader
-	bool compiled = Modules::renderer().createShaderComb( sc, 
-														  vsAvailable ? _tmpCodeVS.c_str() : 0,
-														  fsAvailable ? _tmpCodeFS.c_str() : 0,  
-														  gsAvailable ? _tmpCodeGS.c_str() : 0,
-														  tscAvailable ? _tmpCodeTSCtl.c_str() : 0,
-														  tseAvailable ? _tmpCodeTSEval.c_str() : 0,
-														  csAvailable ? _tmpCodeCS.c_str() : 0
-														  );
+	// Start compiling shader
+	Modules::renderer().beginCreatingShaderComb( sc, code[0], code[1], code[2], code[3], code[4], code[5] );
+}
+
+
+bool ShaderResource::finishCompilingCombination( PendingShaderComb &pending )
+{
+	ShaderContext &context = _contexts[pending.contextIdx];
+	ShaderCombination &sc = context.shaderCombs[pending.combIdx];
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+
+	// Programs from the shader cache don't have a log
+	bool compiledFromCode = sc.pending;
+
+	// Wait for compiler
+	bool compiled = Modules::renderer().finishCreatingShaderComb( sc );
 	if( !compiled )
 	{
 		Modules::log().writeError( "Shader resource '%s': Failed to compile shader context '%s' (comb %i)",
@@ -1264,34 +1353,15 @@ bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombinati
 
 		if( Modules::config().dumpFailedShaders )
 		{
-			bool shaderAvailability[ 6 ] = { vsAvailable, fsAvailable, gsAvailable, tscAvailable, tseAvailable, csAvailable };
-			std::string dumpFileName;
-			std::string *output;
+			const char *dumpFileNames[6] = { "shdDumpVS.txt", "shdDumpFS.txt", "shdDumpGS.txt",
+											 "shdDumpTSC.txt", "shdDumpTSE.txt", "shdDumpCS.txt" };
 
 			for ( size_t i = 0; i < 6; ++i )
 			{
-				if ( shaderAvailability[ i ] == true )
+				if ( !pending.code[ i ].empty() )
 				{
-					switch ( i )
-					{
-						case 0 : // vertex shader
-							dumpFileName = "shdDumpVS.txt"; output = &_tmpCodeVS; break;
-						case 1:  // fragment shader
-							dumpFileName = "shdDumpFS.txt"; output = &_tmpCodeFS; break;
-						case 2:  // geometry shader
-							dumpFileName = "shdDumpGS.txt"; output = &_tmpCodeGS; break;
-						case 3:  // tessellation control shader
-							dumpFileName = "shdDumpTSC.txt"; output = &_tmpCodeTSCtl; break;
-						case 4:  // tessellation evaluation shader
-							dumpFileName = "shdDumpTSE.txt"; output = &_tmpCodeTSEval; break;
-						case 5:  // compute shader
-							dumpFileName = "shdDumpCS.txt"; output = &_tmpCodeCS; break;
-						default:
-							break;
-					}
-
-                    std::ofstream out( dumpFileName.c_str(), ios::binary );
-					if ( out.good() ) out << *output;
+					std::ofstream out( dumpFileNames[ i ], ios::binary );
+					if ( out.good() ) out << pending.code[ i ];
 					out.close();
 				}
 			}
@@ -1333,7 +1403,7 @@ bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombinati
 	rdi->bindShader( 0 );
 
 	// Output shader log
-	if( rdi->getShaderLog() != "" )
+	if( compiledFromCode && rdi->getShaderLog() != "" )
 		Modules::log().writeInfo( "Shader resource '%s': ShaderLog: %s", _name.c_str(), rdi->getShaderLog().c_str() );
 
 	return compiled;
@@ -1342,6 +1412,8 @@ bool ShaderResource::compileCombination( ShaderContext &context, ShaderCombinati
 
 void ShaderResource::compileContexts()
 {
+	std::vector< PendingShaderComb > batch;
+
 	for( uint32 i = 0; i < _contexts.size(); ++i )
 	{
 		ShaderContext &context = _contexts[i];
@@ -1368,30 +1440,24 @@ void ShaderResource::compileContexts()
 			uint32 combMask = *itr & context.flagMask;
 				
 			// Check if combination already exists
-			bool found = false;
-			for( size_t j = 0; j < context.shaderCombs.size(); ++j )
-			{
-				if( context.shaderCombs[j].combMask == combMask )
-				{
-					found = true;
-					break;
-				}
-			}
-
-			if( !found )
-			{	
-				context.shaderCombs.push_back( ShaderCombination() );
-				context.shaderCombs.back().combMask = combMask;
-			}
+			if( findCombination( context, combMask ) == 0x0 )
+				addCombination( context, combMask );
 		}
 			
-		bool combinationsCompileStatus = true;
 		for( size_t j = 0; j < context.shaderCombs.size(); ++j )
 		{
-			combinationsCompileStatus &= compileCombination( context, context.shaderCombs[j] );
+			beginCompilingCombination( i, (uint32)j, batch );
 		}
 
-		context.compiled = combinationsCompileStatus;
+		context.compiled = true;
+	}
+
+	// The combinations of all contexts are compiled in parallel, a context is only usable if all
+	// of its combinations compiled
+	for( size_t i = 0; i < batch.size(); ++i )
+	{
+		if( !finishCompilingCombination( batch[i] ) )
+			_contexts[batch[i].contextIdx].compiled = false;
 	}
 }
 
@@ -1404,18 +1470,55 @@ ShaderCombination *ShaderResource::getCombination( ShaderContext &context, uint3
 	combMask &= context.flagMask;
 	
 	// Try to find combination
-	std::vector< ShaderCombination > &combs = context.shaderCombs;
-	for( size_t i = 0, s = combs.size(); i < s; ++i )
-	{
-		if( combs[i].combMask == combMask ) return &combs[i];
-	}
+	ShaderCombination *sc = findCombination( context, combMask );
+	if( sc != 0x0 ) return sc;
 
 	// Add combination
-	combs.push_back( ShaderCombination() );
-	combs.back().combMask = combMask;
-	compileCombination( context, combs.back() );
+	sc = addCombination( context, combMask );
+
+	std::vector< PendingShaderComb > batch;
+	beginCompilingCombination( (uint32)(&context - &_contexts[0]), (uint32)context.shaderCombs.size() - 1, batch );
+	compileBatch( batch );
+
+	return sc;
+}
+
+
+ShaderCombination *ShaderResource::addCombination( ShaderContext &context, uint32 combMask )
+{
+	context.combIndices[combMask] = (uint32)context.shaderCombs.size();
+	context.shaderCombs.push_back( ShaderCombination() );
+	context.shaderCombs.back().combMask = combMask;
+
+	return &context.shaderCombs.back();
+}
+
+
+int ShaderResource::getContextId( const std::string &name )
+{
+	if( name.empty() ) return -1;
+	
+	// Ids are shared by all shaders, new names are registered on first use
+	std::lock_guard< std::mutex > lock( _contextIdsMutex );
+	
+	std::unordered_map< std::string, int >::const_iterator itr = _contextIds.find( name );
+	if( itr != _contextIds.end() ) return itr->second;
+
+	int contextId = (int)_contextIds.size();
+	_contextIds[name] = contextId;
+	_contextNames.push_back( name );
+
+	return contextId;
+}
 
-	return &combs.back();
+
+const std::string &ShaderResource::getContextName( int contextId )
+{
+	static const std::string emptyName;
+	
+	std::lock_guard< std::mutex > lock( _contextIdsMutex );
+	
+	return contextId >= 0 && contextId < (int)_contextNames.size() ? _contextNames[contextId] : emptyName;
 }
 
 
@@ -1570,4 +1673,134 @@ const char *ShaderResource::getElemParamStr( int elem, int elemIdx, int param )
 	return Resource::getElemParamStr( elem, elemIdx, param );
 }
 
+
+// =================================================================================================
+// Shader Cache
+// =================================================================================================
+
+struct ShaderCacheHeader
+{
+	char    magic[4];  // 'H3DP'
+	uint32  version;
+	uint64  key;
+	uint32  format;
+	uint32  size;
+};
+
+static const uint32 ShaderCacheVersion = 1;
+
+
+void ShaderCache::setPath( const std::string &path )
+{
+	_path = path;
+	if( !_path.empty() && _path[_path.length() - 1] != '/' && _path[_path.length() - 1] != '\\' )
+		_path += '/';
+}
+
+
+uint64 ShaderCache::calcKey( const std::string &deviceInfo, const char *const code[6] )
+{
+	// FNV-1a hash of device info and code of all stages; stages are terminated with their
+	// null character so that moving code between stages changes the key
+	uint64 hash = 14695981039346656037ULL;
+	for( size_t i = 0; i <= deviceInfo.length(); ++i )
+	{
+		hash = (hash ^ (uint8)deviceInfo.c_str()[i]) * 1099511628211ULL;
+	}
+	for( int i = 0; i < 6; ++i )
+	{
+		hash = (hash ^ (uint8)(code[i] != 0x0 ? 1 : 0)) * 1099511628211ULL;
+		if( code[i] == 0x0 ) continue;
+
+		const char *c = code[i];
+		do
+		{
+			hash = (hash ^ (uint8)*c) * 1099511628211ULL;
+		} while( *c++ != '\0' );
+	}
+
+	// 0 marks combinations that are not cached
+	return hash != 0 ? hash : 1;
+}
+
+
+std::string ShaderCache::getFileName( uint64 key ) const
+{
+	char name[32];
+	snprintf( name, sizeof( name ), "%08x%08x.h3dprog", (uint32)(key >> 32), (uint32)key );
+
+	return _path + name;
+}
+
+
+bool ShaderCache::load( uint64 key, uint32 &format, std::vector< char > &data ) const
+{
+	if( _path.empty() ) return false;
+
+	std::ifstream in( getFileName( key ).c_str(), ios::binary );
+	if( !in.good() ) return false;
+
+	ShaderCacheHeader header;
+	in.read( (char *)&header, sizeof( ShaderCacheHeader ) );
+	if( !in.good() || strncmp( header.magic, "H3DP", 4 ) != 0 || header.version != ShaderCacheVersion ||
+		header.key != key || header.size == 0 )
+	{
+		return false;
+	}
+
+	data.resize( header.size );
+	in.read( &data[0], header.size );
+	if( (uint32)in.gcount() != header.size ) return false;
+
+	format = header.format;
+
+	return true;
+}
+
+
+bool ShaderCache::store( uint64 key, uint32 format, const std::vector< char > &data ) const
+{
+	if( _path.empty() || data.empty() ) return false;
+
+	// Write to a temporary file first, so that no other instance reads a partial binary
+	std::string fileName = getFileName( key );
+	std::string tmpFileName = fileName + ".tmp";
+
+	ShaderCacheHeader header;
+	memcpy( header.magic, "H3DP", 4 );
+	header.version = ShaderCacheVersion;
+	header.key = key;
+	header.format = format;
+	header.size = (uint32)data.size();
+
+	std::ofstream out( tmpFileName.c_str(), ios::binary );
+	if( !out.good() )
+	{
+		Modules::log().writeWarning( "Shader cache: Failed to write '%s'", tmpFileName.c_str() );
+		return false;
+	}
+	out.write( (const char *)&header, sizeof( ShaderCacheHeader ) );
+	out.write( &data[0], data.size() );
+	out.close();
+
+	if( out.fail() )
+	{
+		remove( tmpFileName.c_str() );
+		return false;
+	}
+
+	if( rename( tmpFileName.c_str(), fileName.c_str() ) != 0 )
+	{
+		// Windows does not replace existing files
+		remove( fileName.c_str() );
+		if( rename( tmpFileName.c_str(), fileName.c_str() ) != 0 )
+		{
+			remove( tmpFileName.c_str() );
+			return false;
+		}
+	}
+
+	return true;
+}
+
 }  // namespace
@@ -18,7 +18,10 @@
 #include "egTexture.h"
 #include <set>
 #include <vector>
+#include <deque>
 #include <string>
+#include <unordered_map>
+#include <mutex>
 
 namespace Horde3D {
 
@@ -31,6 +34,7 @@ class Tokenizer;
 
 class CodeResource;
 typedef SmartResPtr< CodeResource > PCodeResource;
+class ShaderResource;
 
 class CodeResource : public Resource
 {
@@ -38,7 +42,7 @@ public:
 	static Resource *factoryFunc( const std::string &name, int flags )
 		{ return new CodeResource( name, flags ); }
 	
-	CodeResource( const std::string &name, int flags );
+	CodeResource( const std::string &name, int flags, ShaderResource *ownerShader = 0x0 );
 	~CodeResource();
 	Resource *clone();
 	
@@ -48,19 +52,34 @@ public:
 
 	bool hasDependency( CodeResource *codeRes ) const;
 	bool tryLinking( uint32 *flagMask );
-	std::string assembleCode() const;
+	const std::string &assembleCode() const;
+	void invalidateAssembledCode() { _assembledCodeValid = false; }
+	void getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const
+		{ cpuMem = _code.capacity() + _assembledCode.capacity(); gpuMem = 0; }
 
 	bool isLoaded() const { return _loaded; }
 	const std::string &getCode() const { return _code; }
 
 private:
 	bool raiseError( const std::string &msg );
+	void linkInclude( CodeResource *codeRes );
+	void unlinkInclude( CodeResource *codeRes );
+	void collectDependents( std::vector< CodeResource * > &visited, std::vector< ShaderResource * > &shaders );
 	void updateShaders();
 
 private:
 	uint32                                             _flagMask;
 	std::string                                        _code;
 	std::vector< std::pair< PCodeResource, size_t > >  _includes;	// Pair: Included res and location in _code
+	
+	// Reverse dependencies: code resources including this one directly and shaders having a code
+	// section that includes it directly (a shader is listed once per including section)
+	std::vector< CodeResource * >                      _includers;
+	std::vector< ShaderResource * >                    _shaderUsers;
+	ShaderResource                                     *_ownerShader;  // Set for code sections of shaders
+
+	mutable std::string                                _assembledCode;  // Code with all includes inserted
+	mutable bool                                       _assembledCodeValid;
 
 	friend class Renderer;
 };
@@ -149,9 +168,13 @@ struct ShaderCombination
 	std::vector< int >  uniLocs;
 	std::vector< int >  bufferLocs;
 
+	// State while the program is being created by Renderer::beginCreatingShaderComb
+	uint64              cacheKey;  // Key for storing the linked program in the shader cache, 0 if not cached
+	bool                pending;   // Program is still compiled by the driver
+
 
 	ShaderCombination() :
-		combMask( 0 ), shaderObj( 0 ), lastUpdateStamp( 0 ) 
+		combMask( 0 ), shaderObj( 0 ), lastUpdateStamp( 0 ), cacheKey( 0 ), pending( false ) 
 // 		uni_frameBufSize( -1 ), uni_viewMat( -1 ), uni_viewMatInv( -1 ), uni_projMat( -1 ), uni_viewProjMat( -1 ), 
 // 		uni_viewProjMatInv( -1 ), uni_viewerPos( -1 ), uni_worldMat( -1 ), uni_worldNormalMat( -1 ), uni_nodeId( -1 ), uni_customInstData( -1 ),
 // 		uni_skinMatRows( -1 ), uni_lightPos( -1 ), uni_lightDir( -1 ), uni_lightColor( -1 ), uni_shadowSplitDists( -1 ), uni_shadowMats( -1 ), 
@@ -177,8 +200,9 @@ struct ShaderContext
 	bool                              alphaToCoverage;
 	bool                              blendingEnabled;
 	
-	// Shaders
-	std::vector< ShaderCombination >  shaderCombs;
+	// Shaders; a deque keeps the addresses of combinations stable when new ones are added
+	std::deque< ShaderCombination >   shaderCombs;
+	std::unordered_map< uint32, uint32 >  combIndices;  // Maps combMask to index in shaderCombs
 	int                               vertCodeIdx, fragCodeIdx, geomCodeIdx, tessCtlCodeIdx, tessEvalCodeIdx, computeCodeIdx;
 	bool                              compiled;
 
@@ -219,6 +243,15 @@ struct ShaderUniform
 	unsigned char  size;
 };
 
+// Combinations are compiled in batches: compiling is started for all of them before the result of the
+// first one is queried, so that the driver can work on several programs in parallel
+struct PendingShaderComb
+{
+	ShaderResource  *shaderRes;
+	uint32          contextIdx, combIdx;
+	std::string     code[6];  // Assembled code of all stages, kept for dumping failed shaders
+};
+
 class ShaderResource : public Resource
 {
 public:
@@ -256,6 +289,8 @@ public:
 	bool load( const char *data, int size );
 
 	void preLoadCombination( uint32 combMask );
+	void queueCombination( uint32 combMask, std::vector< PendingShaderComb > &batch );
+	static bool compileBatch( std::vector< PendingShaderComb > &batch );
 	void compileContexts();
 	ShaderCombination *getCombination( ShaderContext &context, uint32 combMask );
 
@@ -265,16 +300,32 @@ public:
 	void setElemParamF( int elem, int elemIdx, int param, int compIdx, float value );
 	const char *getElemParamStr( int elem, int elemIdx, int param ) const;
 
-	ShaderContext *findContext( const std::string &name )
+	static int getContextId( const std::string &name );
+	static const std::string &getContextName( int contextId );
+
+	ShaderContext *findContext( int contextId )
 	{
-		for( uint32 i = 0; i < _contexts.size(); ++i )
-			if( _contexts[i].id == name ) return &_contexts[i];
+		if( contextId < 0 || contextId >= (int)_contextIndices.size() || _contextIndices[contextId] < 0 ) return 0x0;
 		
-		return 0x0;
+		return &_contexts[_contextIndices[contextId]];
 	}
 
+	ShaderContext *findContext( const std::string &name ) { return findContext( getContextId( name ) ); }
+	
+	ShaderCombination *findCombination( ShaderContext &context, uint32 combMask )
+	{
+		std::unordered_map< uint32, uint32 >::const_iterator itr = context.combIndices.find( combMask );
+		
+		return itr != context.combIndices.end() ? &context.shaderCombs[itr->second] : 0x0;
+	}
+
+	// Changes whenever the contexts are released, so that pointers to contexts and combinations
+	// cached outside of the shader can be validated
+	uint32 getContextsStamp() const { return _contextsStamp; }
+
 	std::vector< ShaderContext > &getContexts() { return _contexts; }
 	CodeResource *getCode( uint32 index ) { return &_codeSections[index]; }
+	uint32 getCodeCount() const { return (uint32)_codeSections.size(); }
 
 private:
 	bool raiseError( const std::string &msg, int line = -1 );
@@ -282,12 +333,18 @@ private:
 
 	bool parseFXSectionContext( Tokenizer &tok, const char * identifier, int targetRenderBackend );
 
-	bool compileCombination( ShaderContext &context, ShaderCombination &sc );
+	ShaderCombination *addCombination( ShaderContext &context, uint32 combMask );
+	void beginCompilingCombination( uint32 contextIdx, uint32 combIdx, std::vector< PendingShaderComb > &batch );
+	bool finishCompilingCombination( PendingShaderComb &pending );
 	
 private:
 	static std::string            _vertPreamble, _fragPreamble, _geomPreamble, _tessCtlPreamble, _tessEvalPreamble, _computePreamble;
 	static std::string            _tmpCodeVS, _tmpCodeFS, _tmpCodeGS, _tmpCodeCS, _tmpCodeTSCtl, _tmpCodeTSEval;
 	static bool					  _defaultPreambleSet;
+	static std::unordered_map< std::string, int >  _contextIds;  // Global ids of context names
+	static std::deque< std::string >  _contextNames;  // Names by id; references stay valid when names are added
+	static std::mutex             _contextIdsMutex;
+	static uint32                 _contextsStampCounter;
 
 	std::vector< ShaderContext >  _contexts;
 	std::vector< ShaderSampler >  _samplers;
@@ -295,10 +352,35 @@ private:
 	std::vector< ShaderBuffer >   _buffers;
 	std::vector< CodeResource >   _codeSections;
 	std::set< uint32 >            _preLoadList;
+	std::vector< int >            _contextIndices;  // Global context id -> index in _contexts, -1 if missing
+	uint32                        _contextsStamp;
 
 	friend class Renderer;
 };
 
+// =================================================================================================
+// Shader Cache
+// =================================================================================================
+
+// Keeps linked program binaries on disk, so that shader combinations don't need to be compiled
+// again in later runs; binaries are identified by their code and the backend and driver version
+class ShaderCache
+{
+public:
+	void setPath( const std::string &path );
+	bool isEnabled() const { return !_path.empty(); }
+
+	static uint64 calcKey( const std::string &deviceInfo, const char *const code[6] );
+	bool load( uint64 key, uint32 &format, std::vector< char > &data ) const;
+	bool store( uint64 key, uint32 format, const std::vector< char > &data ) const;
+
+private:
+	std::string getFileName( uint64 key ) const;
+
+private:
+	std::string  _path;
+};
+
 typedef SmartResPtr< ShaderResource > PShaderResource;
 
 }
@@ -16,11 +16,13 @@
 #include "egCom.h"
 #include "egRenderer.h"
 #include "utImage.h"
+#include "utPixel.h"
 #include <cstring>
 
 #include "utDebug.h"
 #include <array>
 #include <tuple>
+#include <limits>
 
 
 namespace Horde3D {
@@ -147,6 +149,23 @@ uint32 TextureResource::defTex2DObject = 0;
 uint32 TextureResource::defTex3DObject = 0;
 uint32 TextureResource::defTexCubeObject = 0;
 bool TextureResource::bgraSwizzleRequired = true;
+vector< TextureResource * > TextureResource::streamedTextures;
+bool (*TextureResource::streamReadFunc)( const char *, int, int, void *, void * ) = 0x0;
+void *TextureResource::streamReadUserData = 0x0;
+
+const int streamLowResSize = 64;                        // Size of the mip level that is always resident
+const uint64 streamUploadLimit = 16 * 1024 * 1024;      // Bytes that are uploaded per frame
+
+struct StreamConversions
+{
+	enum List
+	{
+		None,
+		Pixels24To32,
+		Pixels32,
+		Pixels32Opaque
+	};
+};
 
 void TextureResource::initializationFunc()
 {
@@ -194,6 +213,9 @@ void TextureResource::releaseFunc()
 	rdi->destroyTexture( defTex2DObject );
 	rdi->destroyTexture( defTex3DObject );
 	rdi->destroyTexture( defTexCubeObject );
+
+	streamReadFunc = 0x0;
+	streamReadUserData = 0x0;
 }
 
 
@@ -208,7 +230,8 @@ TextureResource::TextureResource( const string &name, int flags ) :
 TextureResource::TextureResource( const string &name, uint32 width, uint32 height, uint32 depth,
                                   TextureFormats::List fmt, int flags ) :
 	Resource( ResourceTypes::Texture, name, flags ),
-	_width( width ), _height( height ), _depth( depth ), _rbObj( 0 )
+	_width( width ), _height( height ), _depth( depth ), _rbObj( 0 ),
+	_residentMip( 0 ), _lowResMip( 0 ), _requestedMip( 0 ), _streamConv( StreamConversions::None ), _streamSwapRB( false )
 {	
 	_loaded = true;
 	_texFormat = fmt;
@@ -265,6 +288,9 @@ void TextureResource::initDefault()
 	_width = 0; _height = 0; _depth = 0;
 	_sRGB = false;
 	_maxMipLevel = 0;
+	_residentMip = 0; _lowResMip = 0; _requestedMip = 0;
+	_streamConv = StreamConversions::None; _streamSwapRB = false;
+	_lastUseFrame = 0;
 	
 	if( _texType == TextureTypes::TexCube )
 		_texObject = defTexCubeObject;
@@ -290,6 +316,13 @@ void TextureResource::release()
 	}
 
 	_texObject = 0;
+
+	if( isStreamed() )
+	{
+		streamedTextures.erase( std::find( streamedTextures.begin(), streamedTextures.end(), this ) );
+		_streamData.clear(); _streamData.shrink_to_fit();
+		_streamImages.clear(); _streamImages.shrink_to_fit();
+	}
 }
 
 
@@ -454,20 +487,38 @@ bool TextureResource::loadDDS( const char *data, int size )
 
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
-	// Create texture
-	_texObject = rdi->createTexture( _texType, _width, _height, _depth, _texFormat,
-	                                 _maxMipLevel, false, false, _sRGB );
+	// Create texture; streamed textures are created after all images are stored
+	bool streamed = initStreaming();
+	if( !streamed )
+	{
+		_texObject = rdi->createTexture( _texType, _width, _height, _depth, _texFormat,
+		                                 _maxMipLevel, false, false, _sRGB );
 	
-	if ( _texObject == 0 ) return raiseError( "Failed to create DDS texture" );
+		if ( _texObject == 0 ) return raiseError( "Failed to create DDS texture" );
+	}
 
 	// Upload texture subresources
 	int numSlices = _texType == TextureTypes::TexCube ? 6 : 1;
 	unsigned char *pixels =  dx10HeaderAvailable ? ( unsigned char * ) ( data + 128 + 20 ) : ( unsigned char * )( data + 128 );
 
+	// 8 bit formats that differ from the channel order of the render device are converted into a
+	// scratch buffer which is large enough for the first mip level and reused for all images
+	bool swapRB = (pixFmt == pfRGB || pixFmt == pfRGBX || pixFmt == pfRGBA) == bgraSwizzleRequired;
+	unsigned char *dstBuf = 0x0;
+	if( _texFormat == TextureFormats::BGRA8 && ((pixFmt != pfBGRA && pixFmt != pfRGBA) || swapRB) )
+	{
+		dstBuf = new unsigned char[(size_t)_width * _height * _depth * 4];
+		
+		// Streamed levels are converted again when they are read
+		if( pixFmt == pfBGR || pixFmt == pfRGB ) _streamConv = StreamConversions::Pixels24To32;
+		else if( pixFmt == pfBGRX || pixFmt == pfRGBX ) _streamConv = StreamConversions::Pixels32Opaque;
+		else _streamConv = StreamConversions::Pixels32;
+		_streamSwapRB = swapRB;
+	}
+
 	for( int i = 0; i < numSlices; ++i )
 	{
 		int width = _width, height = _height, depth = _depth;
-		uint32 *dstBuf = 0x0;
 
 		for( int j = 0; j < mipCount; ++j )
 		{
@@ -475,37 +526,27 @@ bool TextureResource::loadDDS( const char *data, int size )
 			                 depth * bytesPerBlock;
 			
 			if( pixels + mipSize > (unsigned char *)data + size )
+			{
+				delete[] dstBuf;
 				return raiseError( "Corrupt DDS" );
+			}
 
-			if( _texFormat == TextureFormats::BGRA8 && pixFmt != pfBGRA )
+			if( dstBuf != 0x0 )
 			{
-				// Convert 8 bit DDS formats to BGRA
-				uint32 pixCount = width * height * depth;
-				if( dstBuf == 0x0 ) dstBuf = new uint32[pixCount * 4];
-				uint32 *p = dstBuf;
-
-				if( pixFmt == pfBGR )
-					for( uint32 k = 0; k < pixCount * 3; k += 3 )
-						*p++ = pixels[k+0] | pixels[k+1]<<8 | pixels[k+2]<<16 | 0xFF000000;
-				else if( pixFmt == pfBGRX )
-					for( uint32 k = 0; k < pixCount * 4; k += 4 )
-						*p++ = pixels[k+0] | pixels[k+1]<<8 | pixels[k+2]<<16 | 0xFF000000;
-				else if( pixFmt == pfRGB )
-					for( uint32 k = 0; k < pixCount * 3; k += 3 )
-						*p++ = pixels[k+2] | pixels[k+1]<<8 | pixels[k+0]<<16 | 0xFF000000;
-				else if( pixFmt == pfRGBX )
-					for( uint32 k = 0; k < pixCount * 4; k += 4 )
-						*p++ = pixels[k+2] | pixels[k+1]<<8 | pixels[k+0]<<16 | 0xFF000000;
-				else if( pixFmt == pfRGBA )
-					for( uint32 k = 0; k < pixCount * 4; k += 4 )
-						*p++ = pixels[k+2] | pixels[k+1]<<8 | pixels[k+0]<<16 | pixels[k+3]<<24;
+				size_t pixCount = (size_t)width * height * depth;
+				if( pixFmt == pfBGR || pixFmt == pfRGB )
+					convertPixels24To32( pixels, dstBuf, pixCount, swapRB );
+				else
+					convertPixels32( pixels, dstBuf, pixCount, swapRB, pixFmt == pfBGRX || pixFmt == pfRGBX );
 				
-				rdi->uploadTextureData( _texObject, i, j, dstBuf );
+				if( streamed ) storeStreamImage( i, j, pixels - (unsigned char *)data, mipSize, dstBuf );
+				else rdi->uploadTextureData( _texObject, i, j, dstBuf );
 			}
 			else
 			{
 				// Upload DDS data directly
-				rdi->uploadTextureData( _texObject, i, j, pixels );
+				if( streamed ) storeStreamImage( i, j, pixels - (unsigned char *)data, mipSize, pixels );
+				else rdi->uploadTextureData( _texObject, i, j, pixels );
 			}
 
 			pixels += mipSize;
@@ -513,12 +554,14 @@ bool TextureResource::loadDDS( const char *data, int size )
 			if( height > 1 ) height >>= 1;
 			if( depth > 1 ) depth >>= 1;
 		}
-
-		if( dstBuf != 0x0 ) delete[] dstBuf;
 	}
 
+	delete[] dstBuf;
+
 	ASSERT( pixels == (unsigned char *)data + size );
 
+	if( streamed && !setResidentMip( _lowResMip ) ) return raiseError( "Failed to create DDS texture" );
+
 	return true;
 }
 
@@ -594,17 +637,31 @@ bool TextureResource::loadKTX( const char *data, int size )
 	
 	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
-	// Create texture
-	_texObject = rdi->createTexture( _texType, _width, _height, _depth, _texFormat,
-		_maxMipLevel, false, false, _sRGB );
+	// Create texture; streamed textures are created after all images are stored
+	bool streamed = initStreaming();
+	if( !streamed )
+	{
+		_texObject = rdi->createTexture( _texType, _width, _height, _depth, _texFormat,
+			_maxMipLevel, false, false, _sRGB );
 
-	if ( _texObject == 0 ) return raiseError( "Failed to create KTX texture" );
+		if ( _texObject == 0 ) return raiseError( "Failed to create KTX texture" );
+	}
 
 	//uint32 sliceCount = _texType == TextureTypes::TexCube ? 6 : 1;
 	unsigned char *pixels = ( unsigned char * ) ( data + sizeof( KTXHeader ) + ktxHeader.bytesOfKeyValueData );
 
 	int width = _width, height = _height, depth = _depth;
-	uint32 *dstBuf = 0x0;
+
+	// 8 bit formats that differ from the channel order of the render device are converted into a
+	// reused scratch buffer
+	bool swapRB = ( ktxHeader.glInternalFormat != 0x80E1 ) == bgraSwizzleRequired; // GL_BGRA
+	unsigned char *dstBuf = 0x0;
+	if ( _texFormat == TextureFormats::BGRA8 && ( ktxHeader.glInternalFormat == 0x8051 || swapRB ) ) // GL_RGB8
+	{
+		dstBuf = new unsigned char[ ( size_t ) _width * _height * _depth * 4 ];
+		_streamConv = ktxHeader.glInternalFormat == 0x8051 ? StreamConversions::Pixels24To32 : StreamConversions::Pixels32;
+		_streamSwapRB = swapRB;
+	}
 
 	for ( uint32 mip = 0; mip < mipCount; ++mip )
 	{
@@ -612,7 +669,10 @@ bool TextureResource::loadKTX( const char *data, int size )
 		pixels = (unsigned char *) elemcpy_le( &mipSize, ( uint32* ) ( pixels ), 1 );
 
 		if ( pixels + mipSize > ( unsigned char * )data + size )
+		{
+			delete[] dstBuf;
 			return raiseError( "Corrupt KTX" );
+		}
 
 		for ( uint32 element = 0; element < ktxHeader.numberOfArrayElements; ++element ) 
 		{
@@ -620,26 +680,22 @@ bool TextureResource::loadKTX( const char *data, int size )
 			{
 				if ( element == 0 )
 				{	// using only first element of array now
-					if ( _texFormat == TextureFormats::BGRA8 && ktxHeader.glInternalFormat != 0x80E1 ) // GL_BGRA
+					if ( dstBuf != 0x0 )
 					{
-						// Convert 8 bit KTX formats to BGRA
-						uint32 pixCount = width * height * depth;
-						if ( dstBuf == 0x0 ) dstBuf = new uint32[ pixCount * 4 ];
-						uint32 *p = dstBuf;
-
+						size_t pixCount = ( size_t ) width * height * depth;
 						if ( ktxHeader.glInternalFormat == 0x8051 ) // GL_RGB8
-							for ( uint32 k = 0; k < pixCount * 3; k += 3 )
-								*p++ = pixels[ k + 2 ] | pixels[ k + 1 ] << 8 | pixels[ k + 0 ] << 16 | 0xFF000000;
-						else if ( ktxHeader.glInternalFormat == 0x8058 && bgraSwizzleRequired ) // GL_RGBA8
-							for ( uint32 k = 0; k < pixCount * 4; k += 4 )
-								*p++ = pixels[ k + 2 ] | pixels[ k + 1 ] << 8 | pixels[ k + 0 ] << 16 | pixels[ k + 3 ] << 24;
+							convertPixels24To32( pixels, dstBuf, pixCount, swapRB );
+						else
+							convertPixels32( pixels, dstBuf, pixCount, swapRB, false );
 
-						rdi->uploadTextureData( _texObject, slice, mip, dstBuf );
+						if ( streamed ) storeStreamImage( slice, mip, pixels - ( unsigned char * )data, mipSize, dstBuf );
+						else rdi->uploadTextureData( _texObject, slice, mip, dstBuf );
 					}
 					else
 					{
 						// Upload KTX data directly
-						rdi->uploadTextureData( _texObject, slice, mip, pixels );
+						if ( streamed ) storeStreamImage( slice, mip, pixels - ( unsigned char * )data, mipSize, pixels );
+						else rdi->uploadTextureData( _texObject, slice, mip, pixels );
 					}
 				}
 
@@ -652,9 +708,11 @@ bool TextureResource::loadKTX( const char *data, int size )
 		if ( depth > 1 ) depth >>= 1;
 	}
 
-	if ( dstBuf != 0x0 ) delete[] dstBuf;
+	delete[] dstBuf;
 
 	ASSERT( pixels == ( unsigned char * ) data + size );
+
+	if ( streamed && !setResidentMip( _lowResMip ) ) return raiseError( "Failed to create KTX texture" );
 	return true;
 }
 
@@ -674,16 +732,12 @@ bool TextureResource::loadSTBI( const char *data, int size )
 	if( pixels == 0x0 )
 		return raiseError( "Invalid image format (" + string( stbi_failure_reason() ) + ")" );
 
-	// Swizzle RGBA -> BGRA if required
-	if ( bgraSwizzleRequired )
-	{
-		uint32 *ptr = ( uint32 * ) pixels;
-		for ( uint32 i = 0, si = _width * _height; i < si; ++i )
-		{
-			uint32 col = *ptr;
-			*ptr++ = ( col & 0xFF00FF00 ) | ( ( col & 0x000000FF ) << 16 ) | ( ( col & 0x00FF0000 ) >> 16 );
-		}
-	}
+	// Float data is uploaded as RGBA16F, 8 bit data is swizzled RGBA -> BGRA if required; both
+	// conversions are done in place
+	if ( hdr )
+		convertFloatToHalf( ( float * ) pixels, ( uint16 * ) pixels, ( size_t ) _width * _height * 4 );
+	else if ( bgraSwizzleRequired )
+		convertPixels32( ( unsigned char * ) pixels, ( unsigned char * ) pixels, ( size_t ) _width * _height, true, false );
 	
 	_depth = 1;
 	_texType = TextureTypes::Tex2D;
@@ -723,6 +777,237 @@ uint32_t TextureResource::getMaxAtMipFullLevel() const
 }
 
 
+bool TextureResource::initStreaming()
+{
+	// Finer levels can only be streamed if they can be read again
+	if( Modules::config().texStreamingBudget <= 0 || streamReadFunc == 0x0 || _maxMipLevel == 0 ||
+	    (_texType != TextureTypes::Tex2D && _texType != TextureTypes::TexCube) )
+	{
+		return false;
+	}
+
+	_lowResMip = 0;
+	while( _lowResMip < _maxMipLevel && std::max( _width >> _lowResMip, _height >> _lowResMip ) > streamLowResSize )
+		++_lowResMip;
+	_residentMip = _lowResMip;
+	_requestedMip = _lowResMip;
+
+	// Only the levels that stay resident are kept in upload format
+	int numSlices = _texType == TextureTypes::TexCube ? 6 : 1;
+	_streamImages.resize( numSlices * (_maxMipLevel + 1) );
+	_streamData.reserve( (size_t)getStreamMemSize( _lowResMip ) );
+
+	streamedTextures.push_back( this );
+	
+	return true;
+}
+
+
+void TextureResource::storeStreamImage( int slice, int mipLevel, size_t dataOffset, size_t dataSize, const void *pixels )
+{
+	StreamImage &image = _streamImages[slice * (_maxMipLevel + 1) + mipLevel];
+	image.dataOffset = (uint32)dataOffset;
+	image.dataSize = (uint32)dataSize;
+	image.lowResOffset = (uint32)_streamData.size();
+
+	if( (uint32)mipLevel >= _lowResMip )
+	{
+		RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+		size_t size = rdi->calcTextureSize( _texFormat, std::max( _width >> mipLevel, 1 ), std::max( _height >> mipLevel, 1 ), 1 );
+		_streamData.insert( _streamData.end(), (const unsigned char *)pixels, (const unsigned char *)pixels + size );
+	}
+}
+
+
+bool TextureResource::readStreamImage( int slice, int mipLevel, unsigned char *buffer, vector< unsigned char > &readBuf ) const
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+	const StreamImage &image = _streamImages[slice * (_maxMipLevel + 1) + mipLevel];
+	int width = std::max( _width >> mipLevel, 1 ), height = std::max( _height >> mipLevel, 1 );
+
+	if( (uint32)mipLevel >= _lowResMip )
+	{
+		memcpy( buffer, &_streamData[image.lowResOffset], rdi->calcTextureSize( _texFormat, width, height, 1 ) );
+		return true;
+	}
+
+	if( streamReadFunc == 0x0 ) return false;
+	
+	if( _streamConv == StreamConversions::None )
+		return streamReadFunc( _name.c_str(), (int)image.dataOffset, (int)image.dataSize, buffer, streamReadUserData );
+
+	readBuf.resize( image.dataSize );
+	if( !streamReadFunc( _name.c_str(), (int)image.dataOffset, (int)image.dataSize, readBuf.data(), streamReadUserData ) )
+		return false;
+	
+	size_t pixCount = (size_t)width * height;
+	if( _streamConv == StreamConversions::Pixels24To32 )
+		convertPixels24To32( readBuf.data(), buffer, pixCount, _streamSwapRB );
+	else
+		convertPixels32( readBuf.data(), buffer, pixCount, _streamSwapRB, _streamConv == StreamConversions::Pixels32Opaque );
+	
+	return true;
+}
+
+
+uint64 TextureResource::getStreamMemSize( uint32 mipLevel ) const
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+
+	uint64 size = rdi->calcTextureSize( _texFormat, std::max( _width >> mipLevel, 1 ), std::max( _height >> mipLevel, 1 ),
+	                                    1, _maxMipLevel - mipLevel );
+	return _texType == TextureTypes::TexCube ? size * 6 : size;
+}
+
+
+bool TextureResource::setResidentMip( uint32 mipLevel )
+{
+	RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+
+	// The texture is recreated with the new mip chain, since the memory of immutable textures
+	// can't be changed
+	uint32 texObject = rdi->createTexture( _texType, std::max( _width >> mipLevel, 1 ), std::max( _height >> mipLevel, 1 ),
+	                                       1, _texFormat, _maxMipLevel - mipLevel, false, false, _sRGB );
+	if( texObject == 0 ) return false;
+
+	// Levels finer than the low resolution level are read from the resource data
+	vector< unsigned char > pixels( rdi->calcTextureSize( _texFormat, std::max( _width >> mipLevel, 1 ),
+	                                                      std::max( _height >> mipLevel, 1 ), 1 ) );
+	vector< unsigned char > readBuf;
+	int numSlices = _texType == TextureTypes::TexCube ? 6 : 1;
+	for( int i = 0; i < numSlices; ++i )
+	{
+		for( uint32 j = mipLevel; j <= _maxMipLevel; ++j )
+		{
+			if( !readStreamImage( i, j, pixels.data(), readBuf ) )
+			{
+				Modules::log().writeWarning( "Texture resource '%s': Failed to read mip level %i", _name.c_str(), j );
+				rdi->destroyTexture( texObject );
+				return false;
+			}
+			rdi->uploadTextureData( texObject, i, j - mipLevel, pixels.data() );
+		}
+	}
+
+	if( _texObject != 0 ) rdi->destroyTexture( _texObject );
+	_texObject = texObject;
+	_residentMip = mipLevel;
+
+	return true;
+}
+
+
+void TextureResource::requestScreenSize( float size, uint32 frameID )
+{
+	// The texture is assumed to be mapped once onto the screen area, so the finest mip level that
+	// is needed has at least as many texels as pixels are covered
+	float texels = (float)std::max( _width, _height );
+	uint32 mipLevel = 0;
+	while( mipLevel < _lowResMip && texels * 0.5f >= size )
+	{
+		texels *= 0.5f;
+		++mipLevel;
+	}
+
+	requestMip( mipLevel, frameID );
+}
+
+
+bool TextureResource::stopStreaming()
+{
+	if( !isStreamed() ) return true;
+
+	// Load all levels before the copies in system memory are dropped
+	if( _residentMip != 0 && !setResidentMip( 0 ) ) return false;
+
+	streamedTextures.erase( std::find( streamedTextures.begin(), streamedTextures.end(), this ) );
+	_streamData.clear(); _streamData.shrink_to_fit();
+	_streamImages.clear(); _streamImages.shrink_to_fit();
+	_lowResMip = 0; _requestedMip = 0;
+
+	return true;
+}
+
+
+void TextureResource::updateStreaming()
+{
+	// Budget 0 means that streaming was disabled after textures were loaded, in that case all
+	// requests are served
+	uint64 budget = Modules::config().texStreamingBudget > 0 ?
+		(uint64)Modules::config().texStreamingBudget * 1024 * 1024 : std::numeric_limits< uint64 >::max();
+	uint64 residentMem = 0, requestedMem = 0, evictedMem = 0;
+	
+	// Textures that were not used in the last frame only request their low resolution level
+	vector< TextureResource * > upgrades, evictions;
+	for( size_t i = 0; i < streamedTextures.size(); ++i )
+	{
+		TextureResource *tex = streamedTextures[i];
+		residentMem += tex->getStreamMemSize( tex->_residentMip );
+		requestedMem += tex->getStreamMemSize( tex->_requestedMip );
+
+		if( tex->_requestedMip < tex->_residentMip ) upgrades.push_back( tex );
+		else if( tex->_requestedMip > tex->_residentMip ) evictions.push_back( tex );
+	}
+
+	if( !upgrades.empty() || residentMem > budget )
+	{
+		// Textures are recreated, so the old objects must not stay bound
+		RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+		for( uint32 i = 0; i < 16; ++i ) rdi->setTexture( i, 0, 0, 0 );
+
+		// Textures with the largest difference to the requested level are loaded first, least
+		// recently used textures are reduced first
+		std::sort( upgrades.begin(), upgrades.end(), []( const TextureResource *a, const TextureResource *b )
+			{ return a->_residentMip - a->_requestedMip > b->_residentMip - b->_requestedMip; } );
+		std::sort( evictions.begin(), evictions.end(), []( const TextureResource *a, const TextureResource *b )
+			{ return a->_lastUseFrame < b->_lastUseFrame; } );
+
+		size_t nextEviction = 0;
+		auto reduceMem = [&]( uint64 limit )
+		{
+			while( residentMem > limit && nextEviction < evictions.size() )
+			{
+				TextureResource *tex = evictions[nextEviction++];
+				uint64 memSize = tex->getStreamMemSize( tex->_residentMip );
+				if( tex->setResidentMip( tex->_requestedMip ) )
+				{
+					uint64 freedMem = memSize - tex->getStreamMemSize( tex->_residentMip );
+					residentMem -= freedMem;
+					evictedMem += freedMem;
+				}
+			}
+		};
+
+		uint64 uploadedMem = 0;
+		for( size_t i = 0; i < upgrades.size() && uploadedMem < streamUploadLimit; ++i )
+		{
+			TextureResource *tex = upgrades[i];
+			uint64 memSize = tex->getStreamMemSize( tex->_residentMip );
+			uint64 addedMem = tex->getStreamMemSize( tex->_requestedMip ) - memSize;
+			if( residentMem + addedMem > budget ) reduceMem( budget > addedMem ? budget - addedMem : 0 );
+			
+			// Load as many levels as fit into the budget
+			uint32 mipLevel = tex->_requestedMip;
+			while( mipLevel < tex->_residentMip && residentMem + tex->getStreamMemSize( mipLevel ) - memSize > budget )
+				++mipLevel;
+			if( mipLevel < tex->_residentMip && tex->setResidentMip( mipLevel ) )
+			{
+				residentMem += tex->getStreamMemSize( mipLevel ) - memSize;
+				uploadedMem += tex->getStreamMemSize( mipLevel );
+			}
+		}
+
+		// Budget may have been lowered
+		reduceMem( budget );
+	}
+
+	for( size_t i = 0; i < streamedTextures.size(); ++i )
+		streamedTextures[i]->_requestedMip = streamedTextures[i]->_lowResMip;
+
+	Modules::stats().updateTexStreamingStats( residentMem, requestedMem, evictedMem );
+}
+
+
 int TextureResource::getElemCount( int elem ) const
 {
 	switch( elem )
@@ -784,6 +1069,10 @@ void *TextureResource::mapStream( int elem, int elemIdx, int stream, bool read,
 		{
 			RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 
+			// Written textures must have all levels in video memory, since the changes can't be
+			// stored in the resource data
+			if( write && !stopStreaming() ) return Resource::mapStream( elem, elemIdx, stream, read, write );
+
 			mappedData = Modules::renderer().useScratchBuf(
 				rdi->calcTextureSize( _texFormat, _width, _height, _depth ), 16 ); // 16 byte aligned
 			
@@ -791,7 +1080,18 @@ void *TextureResource::mapStream( int elem, int elemIdx, int stream, bool read,
 			{	
 				int slice = elemIdx / (_maxMipLevel + 1);
 				int mipLevel = elemIdx % (_maxMipLevel + 1);
-				rdi->getTextureData( _texObject, slice, mipLevel, mappedData );
+				
+				// Streamed textures may not have the level in video memory
+				vector< unsigned char > readBuf;
+				if( isStreamed() && (uint32)mipLevel < _residentMip )
+				{
+					if( !readStreamImage( slice, mipLevel, mappedData, readBuf ) )
+						Modules::log().writeWarning( "Texture resource '%s': Failed to read mip level %i", _name.c_str(), mipLevel );
+				}
+				else
+				{
+					rdi->getTextureData( _texObject, slice, isStreamed() ? mipLevel - _residentMip : mipLevel, mappedData );
+				}
 			}
 
 			if( write )
@@ -813,9 +1113,10 @@ void TextureResource::unmapStream()
 	{
 		if( mappedWriteImage >= 0 )
 		{
+			RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
 			int slice = mappedWriteImage / (_maxMipLevel + 1);
 			int mipLevel = mappedWriteImage % (_maxMipLevel + 1);
-			Modules::renderer().getRenderDevice()->updateTextureData( _texObject, slice, mipLevel, mappedData );
+			rdi->updateTextureData( _texObject, slice, mipLevel, mappedData );
 			mappedWriteImage = -1;
 		}
 		
@@ -826,4 +1127,26 @@ void TextureResource::unmapStream()
 	Resource::unmapStream();
 }
 
+
+void TextureResource::getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const
+{
+	cpuMem = _streamData.capacity() + _streamImages.capacity() * sizeof( StreamImage );
+	gpuMem = 0;
+
+	// Default textures are shared
+	if( _texObject == 0 || _texObject == defTex2DObject || _texObject == defTex3DObject || _texObject == defTexCubeObject )
+		return;
+
+	if( isStreamed() )
+	{
+		gpuMem = (size_t)getStreamMemSize( _residentMip );
+	}
+	else
+	{
+		RenderDeviceInterface *rdi = Modules::renderer().getRenderDevice();
+		gpuMem = rdi->calcTextureSize( _texFormat, _width, _height, _depth, _maxMipLevel );
+		if( _texType == TextureTypes::TexCube ) gpuMem *= 6;
+	}
+}
+
 }  // namespace
@@ -48,6 +48,9 @@ class TextureResource : public Resource
 public:
 	static void initializationFunc();
 	static void releaseFunc();
+	static void updateStreaming();
+	static void setStreamReadFunc( bool (*readFunc)( const char *, int, int, void *, void * ), void *userData )
+		{ streamReadFunc = readFunc; streamReadUserData = userData; }
 	static Resource *factoryFunc( const std::string &name, int flags )
 		{ return new TextureResource( name, flags ); }
 	
@@ -64,6 +67,8 @@ public:
 	int getElemParamI( int elem, int elemIdx, int param ) const;
 	void *mapStream( int elem, int elemIdx, int stream, bool read, bool write );
 	void unmapStream();
+	void getMemoryUsage( size_t &cpuMem, size_t &gpuMem ) const;
+	bool canUnloadWhileReferenced() const { return true; }  // Materials use default textures instead
 
 	TextureTypes::List getTexType() const { return _texType; }
 	TextureFormats::List getTexFormat() const { return _texFormat; }
@@ -74,6 +79,13 @@ public:
 	uint32 getRBObject() const { return _rbObj; }
 	uint32 getMaxMipLevel() const { return _maxMipLevel; }
 
+	// Streamed textures only have the mip levels from the resident level on in video memory
+	bool isStreamed() const { return !_streamImages.empty(); }
+	void requestMip( uint32 mipLevel, uint32 frameID )
+		{ _requestedMip = std::min( _requestedMip, mipLevel ); _lastUseFrame = frameID; }
+	void requestScreenSize( float size, uint32 frameID );
+	bool stopStreaming();
+
 public:
 	static uint32	defTex2DObject;
 	static uint32	defTex3DObject;
@@ -88,10 +100,18 @@ protected:
 	bool loadDDS( const char *data, int size );
 	bool loadSTBI( const char *data, int size );
     uint32 getMaxAtMipFullLevel() const;
+	bool initStreaming();
+	void storeStreamImage( int slice, int mipLevel, size_t dataOffset, size_t dataSize, const void *pixels );
+	bool readStreamImage( int slice, int mipLevel, unsigned char *buffer, std::vector< unsigned char > &readBuf ) const;
+	uint64 getStreamMemSize( uint32 mipLevel ) const;
+	bool setResidentMip( uint32 mipLevel );
 
 protected:
 	static unsigned char  *mappedData;
 	static int            mappedWriteImage;
+	static std::vector< TextureResource * >  streamedTextures;
+	static bool           (*streamReadFunc)( const char *resName, int offset, int size, void *buffer, void *userData );
+	static void           *streamReadUserData;
 	
 	TextureTypes::List    _texType;
 	TextureFormats::List  _texFormat;
@@ -101,6 +121,21 @@ protected:
 	uint32                _maxMipLevel;     // number of mip levels = _maxMipLevel + 1
 	bool                  _sRGB;
 
+	// Texture streaming; images of the finer levels are read again from the resource data
+	struct StreamImage
+	{
+		uint32  dataOffset, dataSize;  // Position in the resource data
+		uint32  lowResOffset;          // Position in _streamData for levels that stay resident
+	};
+	
+	std::vector< StreamImage >    _streamImages;   // Indexed by slice * mip count + mip level
+	std::vector< unsigned char >  _streamData;     // Upload data of the levels that stay resident
+	uint8                         _streamConv;     // Conversion of the resource data into upload data
+	bool                          _streamSwapRB;
+	uint32                        _residentMip;    // Finest mip level in video memory
+	uint32                        _lowResMip;      // Mip level that stays resident
+	uint32                        _requestedMip;   // Finest mip level requested since the last update
+
 	friend class ResourceManager;
 };
 
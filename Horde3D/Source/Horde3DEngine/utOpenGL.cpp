@@ -31,6 +31,8 @@ namespace glExt
 	bool ARB_texture_rg = false;
 	bool KHR_texture_compression_astc = false;
 	bool KHR_debug = false;
+	bool ARB_get_program_binary = false;
+	bool KHR_parallel_shader_compile = false;
 
 	int	majorVersion = 1, minorVersion = 0;
 }
@@ -562,6 +564,9 @@ PFNGLDEBUGMESSAGECONTROLKHRPROC glDebugMessageControlKHR = 0x0;
 PFNGLDEBUGMESSAGEINSERTKHRPROC glDebugMessageInsertKHR = 0x0;
 PFNGLDEBUGMESSAGECALLBACKKHRPROC glDebugMessageCallbackKHR = 0x0;
 PFNGLGETDEBUGMESSAGELOGKHRPROC glGetDebugMessageLogKHR = 0x0;
+
+// GL_KHR_parallel_shader_compile
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR = 0x0;
 }  // namespace h3dGL
 
 
@@ -766,6 +771,16 @@ void initModernExtensions( bool &r )
 		r &= ( glDebugMessageInsertKHR = ( PFNGLDEBUGMESSAGEINSERTKHRPROC ) platGetProcAddress( "glDebugMessageInsert" ) ) != 0x0;
 		r &= ( glGetDebugMessageLogKHR = ( PFNGLGETDEBUGMESSAGELOGKHRPROC ) platGetProcAddress( "glGetDebugMessageLog" ) ) != 0x0;
 	}
+
+	// Core since GL 4.1, entry points are already loaded in that case
+	glExt::ARB_get_program_binary = isExtensionSupported( "GL_ARB_get_program_binary" ) ||
+									glExt::majorVersion * 10 + glExt::minorVersion >= 41;
+	if ( glExt::ARB_get_program_binary && glGetProgramBinary == 0x0 )
+	{
+		r &= ( glGetProgramBinary = ( PFNGLGETPROGRAMBINARYPROC ) platGetProcAddress( "glGetProgramBinary" ) ) != 0x0;
+		r &= ( glProgramBinary = ( PFNGLPROGRAMBINARYPROC ) platGetProcAddress( "glProgramBinary" ) ) != 0x0;
+		r &= ( glProgramParameteri = ( PFNGLPROGRAMPARAMETERIPROC ) platGetProcAddress( "glProgramParameteri" ) ) != 0x0;
+	}
 }
 
 bool initOpenGLExtensions( bool forceLegacyFuncs )
@@ -1309,6 +1324,13 @@ bool initOpenGLExtensions( bool forceLegacyFuncs )
 
 	glExt::EXT_texture_compression_s3tc = isExtensionSupported( "GL_EXT_texture_compression_s3tc" ) || isExtensionSupported( "GL_S3_s3tc" );
 
+	// Optional, shaders are compiled serially by the driver if the entry point is missing
+	if ( isExtensionSupported( "GL_KHR_parallel_shader_compile" ) )
+		glMaxShaderCompilerThreadsKHR = ( PFNGLMAXSHADERCOMPILERTHREADSKHRPROC ) platGetProcAddress( "glMaxShaderCompilerThreadsKHR" );
+	else if ( isExtensionSupported( "GL_ARB_parallel_shader_compile" ) )
+		glMaxShaderCompilerThreadsKHR = ( PFNGLMAXSHADERCOMPILERTHREADSKHRPROC ) platGetProcAddress( "glMaxShaderCompilerThreadsARB" );
+	glExt::KHR_parallel_shader_compile = glMaxShaderCompilerThreadsKHR != 0x0;
+
 	return r;
 }
 
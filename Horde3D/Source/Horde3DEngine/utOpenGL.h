@@ -67,6 +67,8 @@ namespace glExt
 	extern bool ARB_texture_rg;
 	extern bool KHR_texture_compression_astc;
 	extern bool KHR_debug;
+	extern bool ARB_get_program_binary;
+	extern bool KHR_parallel_shader_compile;
 
 	extern int  majorVersion, minorVersion;
 }
@@ -2975,6 +2977,17 @@ extern PFNGLDEBUGMESSAGEINSERTKHRPROC glDebugMessageInsertKHR;
 extern PFNGLDEBUGMESSAGECALLBACKKHRPROC glDebugMessageCallbackKHR;
 extern PFNGLGETDEBUGMESSAGELOGKHRPROC glGetDebugMessageLogKHR;
 
+#endif
+
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_KHR_parallel_shader_compile 1
+
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR          0x91B1
+typedef void ( GLAPIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC ) ( GLuint count );
+
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+
 #endif
 }  // namespace h3dGL
 
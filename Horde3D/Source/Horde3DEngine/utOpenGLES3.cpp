@@ -54,6 +54,7 @@ namespace glESExt
 
 	bool OES_EGL_image_external = false;
 	bool KHR_debug = false;
+	bool KHR_parallel_shader_compile = false;
 	
 	int	majorVersion = 1, minorVersion = 0;
 }
@@ -66,6 +67,8 @@ namespace h3dGLES
 	PFNGLGETQUERYOBJECTIVEXTPROC glGetQueryObjectivEXT = 0x0;
 	PFNGLGETQUERYOBJECTUI64VEXTPROC glGetQueryObjectui64vEXT = 0x0;
 
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR = 0x0;
+
 	PFNGLTEXPARAMETERIIVEXTPROC glTexParameterIivEXT = 0x0;
 	PFNGLTEXPARAMETERIUIVEXTPROC glTexParameterIuivEXT = 0x0;
 	PFNGLGETTEXPARAMETERIIVEXTPROC glGetTexParameterIivEXT = 0x0;
@@ -170,6 +173,11 @@ bool initOpenGLExtensions()
 		r &= ( glGetQueryObjectui64vEXT = ( PFNGLGETQUERYOBJECTUI64VEXTPROC ) platformGetProcAddress( "glGetQueryObjectui64vEXT" ) ) != 0x0;
 	}
 
+	// Optional, shaders are compiled serially by the driver if the entry point is missing
+	if ( checkExtensionSupported( "GL_KHR_parallel_shader_compile" ) )
+		glMaxShaderCompilerThreadsKHR = ( PFNGLMAXSHADERCOMPILERTHREADSKHRPROC ) platformGetProcAddress( "glMaxShaderCompilerThreadsKHR" );
+	glESExt::KHR_parallel_shader_compile = glMaxShaderCompilerThreadsKHR != 0x0;
+
 	glESExt::EXT_tessellation_shader = checkExtensionSupported( "GL_EXT_tessellation_shader" );
 	if ( glESExt::EXT_tessellation_shader )
 	{
@@ -70,6 +70,7 @@ namespace glESExt
 	extern bool OES_EGL_image_external;
 
 	extern bool KHR_debug;
+	extern bool KHR_parallel_shader_compile;
 
 	extern int  majorVersion, minorVersion;
 }
@@ -166,6 +167,19 @@ extern PFNGLFRAMEBUFFERTEXTURE3DOESPROC glFramebufferTexture3DOES;
 
 #endif
 
+// KHR_parallel_shader_compile
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_KHR_parallel_shader_compile 1
+
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR              0x91B0
+#define GL_COMPLETION_STATUS_KHR                        0x91B1
+
+typedef void ( GLAPIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC ) ( GLuint count );
+
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+
+#endif	//GL_KHR_parallel_shader_compile
+
 // EXT_disjoint_timer_query
 #ifndef GL_EXT_disjoint_timer_query
 #define GL_EXT_disjoint_timer_query 1
@@ -0,0 +1,262 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "utPixel.h"
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || (defined( _M_IX86_FP ) && _M_IX86_FP >= 2)
+#	define H3D_PIXEL_SSE2
+#	include <emmintrin.h>
+#	if defined( __SSSE3__ )
+#		define H3D_PIXEL_SSSE3
+#		include <tmmintrin.h>
+#	endif
+#elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#	define H3D_PIXEL_NEON
+#	include <arm_neon.h>
+#endif
+
+
+namespace Horde3D {
+
+static inline uint16 floatToHalf( float value )
+{
+	const uint32 f16Max = (127 + 16) << 23, f32Infinity = 255 << 23;
+	const uint32 denormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+
+	uint32 bits;
+	memcpy( &bits, &value, 4 );
+	uint32 sign = (bits >> 16) & 0x8000;
+	bits &= 0x7fffffff;
+
+	uint32 result;
+	if( bits >= f16Max )
+	{
+		// Overflow, infinity or NaN
+		result = bits > f32Infinity ? 0x7e00 : 0x7c00;
+	}
+	else if( bits < (113 << 23) )
+	{
+		// Denormalized half; the float addition rounds the mantissa
+		float f, magic;
+		memcpy( &f, &bits, 4 );
+		memcpy( &magic, &denormMagic, 4 );
+		f += magic;
+		memcpy( &bits, &f, 4 );
+		result = bits - denormMagic;
+	}
+	else
+	{
+		// Rebias exponent and round to nearest even
+		uint32 mantOdd = (bits >> 13) & 1;
+		bits += ((uint32)(15 - 127) << 23) + 0xfff + mantOdd;
+		result = bits >> 13;
+	}
+
+	return (uint16)(result | sign);
+}
+
+
+#if defined( H3D_PIXEL_SSE2 )
+// Same as floatToHalf for four values; the halfs are returned in the low bits of 32 bit lanes
+static inline __m128i floatToHalf4( __m128 value )
+{
+	const __m128i f16Max = _mm_set1_epi32( (127 + 16) << 23 );
+	const __m128i minNormal = _mm_set1_epi32( 113 << 23 );
+	const __m128i denormMagic = _mm_set1_epi32( ((127 - 15) + (23 - 10) + 1) << 23 );
+	const __m128i normalBias = _mm_set1_epi32( 0xfff - ((127 - 15) << 23) );
+
+	__m128 sign = _mm_and_ps( value, _mm_set1_ps( -0.0f ) );
+	__m128 absValue = _mm_xor_ps( value, sign );
+	__m128i absBits = _mm_castps_si128( absValue );
+
+	__m128i isNaN = _mm_castps_si128( _mm_cmpunord_ps( absValue, absValue ) );
+	__m128i special = _mm_or_si128( _mm_and_si128( isNaN, _mm_set1_epi32( 0x200 ) ), _mm_set1_epi32( 0x7c00 ) );
+	__m128i isRegular = _mm_cmpgt_epi32( f16Max, absBits );
+	__m128i isDenorm = _mm_cmpgt_epi32( minNormal, absBits );
+
+	__m128i denorm = _mm_sub_epi32( _mm_castps_si128( _mm_add_ps( absValue, _mm_castsi128_ps( denormMagic ) ) ), denormMagic );
+	__m128i mantOdd = _mm_srai_epi32( _mm_slli_epi32( absBits, 31 - 13 ), 31 );
+	__m128i normal = _mm_srli_epi32( _mm_sub_epi32( _mm_add_epi32( absBits, normalBias ), mantOdd ), 13 );
+
+	__m128i result = _mm_or_si128( _mm_and_si128( isDenorm, denorm ), _mm_andnot_si128( isDenorm, normal ) );
+	result = _mm_or_si128( _mm_and_si128( isRegular, result ), _mm_andnot_si128( isRegular, special ) );
+
+	return _mm_or_si128( result, _mm_srli_epi32( _mm_castps_si128( sign ), 16 ) );
+}
+
+
+// Packs the low 16 bits of 32 bit lanes; values are sign extended first, so that the saturation
+// of the pack instruction does not change them
+static inline __m128i pack16( __m128i a, __m128i b )
+{
+	a = _mm_srai_epi32( _mm_slli_epi32( a, 16 ), 16 );
+	b = _mm_srai_epi32( _mm_slli_epi32( b, 16 ), 16 );
+	return _mm_packs_epi32( a, b );
+}
+
+
+// Swaps the first and third channel of four 32 bit pixels by swapping the 16 bit words of the
+// masked first and third channel
+static inline __m128i swapRB4( __m128i v )
+{
+	const __m128i maskRB = _mm_set1_epi32( 0x00ff00ff );
+	__m128i rb = _mm_and_si128( v, maskRB );
+	rb = _mm_shufflehi_epi16( _mm_shufflelo_epi16( rb, _MM_SHUFFLE( 2, 3, 0, 1 ) ), _MM_SHUFFLE( 2, 3, 0, 1 ) );
+	return _mm_or_si128( _mm_andnot_si128( maskRB, v ), rb );
+}
+#endif
+
+
+void convertPixels32( const unsigned char *src, unsigned char *dest, size_t pixelCount, bool swapRB, bool opaque )
+{
+	if( !swapRB && !opaque )
+	{
+		if( src != dest ) memcpy( dest, src, pixelCount * 4 );
+		return;
+	}
+
+	if( !opaque )
+	{
+		// Compilers vectorize this loop (also in place); explicit SIMD code is not faster
+		for( size_t i = 0; i < pixelCount; ++i )
+		{
+			uint32 col;
+			memcpy( &col, src + i * 4, 4 );
+			col = (col & 0xff00ff00) | ((col & 0xff) << 16) | ((col >> 16) & 0xff);
+			memcpy( dest + i * 4, &col, 4 );
+		}
+		return;
+	}
+
+	size_t i = 0;
+#if defined( H3D_PIXEL_SSE2 )
+	const __m128i alpha = _mm_set1_epi32( (int)0xff000000 );
+	for( ; i + 4 <= pixelCount; i += 4 )
+	{
+		__m128i v = _mm_loadu_si128( (const __m128i *)(src + i * 4) );
+		if( swapRB ) v = swapRB4( v );
+		_mm_storeu_si128( (__m128i *)(dest + i * 4), _mm_or_si128( v, alpha ) );
+	}
+#elif defined( H3D_PIXEL_NEON )
+	for( ; i + 16 <= pixelCount; i += 16 )
+	{
+		uint8x16x4_t v = vld4q_u8( src + i * 4 );
+		if( swapRB )
+		{
+			uint8x16_t r = v.val[0];
+			v.val[0] = v.val[2];
+			v.val[2] = r;
+		}
+		v.val[3] = vdupq_n_u8( 255 );
+		vst4q_u8( dest + i * 4, v );
+	}
+#endif
+
+	for( ; i < pixelCount; ++i )
+	{
+		unsigned char c0 = src[i * 4 + 0], c2 = src[i * 4 + 2];
+		dest[i * 4 + 0] = swapRB ? c2 : c0;
+		dest[i * 4 + 1] = src[i * 4 + 1];
+		dest[i * 4 + 2] = swapRB ? c0 : c2;
+		dest[i * 4 + 3] = 255;
+	}
+}
+
+
+void convertPixels24To32( const unsigned char *src, unsigned char *dest, size_t pixelCount, bool swapRB )
+{
+	size_t i = 0;
+#if defined( H3D_PIXEL_SSSE3 )
+	// Each iteration reads 16 bytes but uses only 12 of them, so the last pixels are left to the scalar loop
+	const __m128i shuffle = swapRB ?
+		_mm_setr_epi8( 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 ) :
+		_mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+	const __m128i alpha = _mm_set1_epi32( (int)0xff000000 );
+	for( ; i + 6 <= pixelCount; i += 4 )
+	{
+		__m128i v = _mm_loadu_si128( (const __m128i *)(src + i * 3) );
+		_mm_storeu_si128( (__m128i *)(dest + i * 4), _mm_or_si128( _mm_shuffle_epi8( v, shuffle ), alpha ) );
+	}
+#elif defined( H3D_PIXEL_SSE2 )
+	// Without byte shuffles, the pixels are moved to their 32 bit lanes by whole register byte shifts;
+	// the loads are the same as above
+	const __m128i mask = _mm_setr_epi32( 0xffffff, 0, 0, 0 );
+	const __m128i alpha = _mm_set1_epi32( (int)0xff000000 );
+	for( ; i + 6 <= pixelCount; i += 4 )
+	{
+		__m128i v = _mm_loadu_si128( (const __m128i *)(src + i * 3) );
+		__m128i p01 = _mm_or_si128( _mm_and_si128( v, mask ),
+		                            _mm_and_si128( _mm_slli_si128( v, 1 ), _mm_slli_si128( mask, 4 ) ) );
+		__m128i p23 = _mm_or_si128( _mm_and_si128( _mm_slli_si128( v, 2 ), _mm_slli_si128( mask, 8 ) ),
+		                            _mm_and_si128( _mm_slli_si128( v, 3 ), _mm_slli_si128( mask, 12 ) ) );
+		v = _mm_or_si128( p01, p23 );
+		if( swapRB ) v = swapRB4( v );
+		_mm_storeu_si128( (__m128i *)(dest + i * 4), _mm_or_si128( v, alpha ) );
+	}
+#elif defined( H3D_PIXEL_NEON )
+	for( ; i + 16 <= pixelCount; i += 16 )
+	{
+		uint8x16x3_t v = vld3q_u8( src + i * 3 );
+		uint8x16x4_t result;
+		result.val[0] = swapRB ? v.val[2] : v.val[0];
+		result.val[1] = v.val[1];
+		result.val[2] = swapRB ? v.val[0] : v.val[2];
+		result.val[3] = vdupq_n_u8( 255 );
+		vst4q_u8( dest + i * 4, result );
+	}
+#endif
+
+	for( ; i < pixelCount; ++i )
+	{
+		dest[i * 4 + 0] = src[i * 3 + (swapRB ? 2 : 0)];
+		dest[i * 4 + 1] = src[i * 3 + 1];
+		dest[i * 4 + 2] = src[i * 3 + (swapRB ? 0 : 2)];
+		dest[i * 4 + 3] = 255;
+	}
+}
+
+
+void decodePixels16( const unsigned char *src, uint16 *dest, size_t pixelCount, int hiChannel, int loChannel )
+{
+	// Compilers vectorize this loop; it is faster than explicit SSE2 code
+	for( size_t i = 0; i < pixelCount; ++i )
+		dest[i] = (uint16)(src[i * 4 + hiChannel] * 256 + src[i * 4 + loChannel]);
+}
+
+
+void convertFloatToHalf( const float *src, uint16 *dest, size_t count )
+{
+	// Halfs are written behind the floats that are still to be read, which allows in place conversion
+	size_t i = 0;
+#if defined( H3D_PIXEL_SSE2 )
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m128i h0 = floatToHalf4( _mm_loadu_ps( src + i ) );
+		__m128i h1 = floatToHalf4( _mm_loadu_ps( src + i + 4 ) );
+		_mm_storeu_si128( (__m128i *)(dest + i), pack16( h0, h1 ) );
+	}
+#elif defined( H3D_PIXEL_NEON ) && defined( __aarch64__ )
+	for( ; i + 4 <= count; i += 4 )
+		vst1_u16( dest + i, vreinterpret_u16_f16( vcvt_f16_f32( vld1q_f32( src + i ) ) ) );
+#endif
+
+	for( ; i < count; ++i )
+	{
+		float value;
+		memcpy( &value, src + i, 4 );
+		uint16 half = floatToHalf( value );
+		memcpy( dest + i, &half, 2 );
+	}
+}
+
+}  // namespace
@@ -0,0 +1,40 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _utPixel_H_
+#define _utPixel_H_
+
+#include "utPlatform.h"
+#include <cstddef>
+
+
+namespace Horde3D {
+
+// Pixel conversions for texture loading; SSE2 (SSSE3 if enabled) and NEON are used where they are
+// faster than the loops that compilers vectorize themselves.
+// Conversions that do not change the pixel size can be done in place (src == dest).
+
+// Copies 32 bit pixels, optionally swapping the first and third channel (RGBA <-> BGRA) and setting
+// alpha to 255 (for X8 formats)
+void convertPixels32( const unsigned char *src, unsigned char *dest, size_t pixelCount, bool swapRB, bool opaque );
+
+// Expands 24 bit pixels to 32 bit with alpha 255, optionally swapping the first and third channel
+void convertPixels24To32( const unsigned char *src, unsigned char *dest, size_t pixelCount, bool swapRB );
+
+// Decodes 16 bit values stored in two channels of 32 bit pixels (hiChannel * 256 + loChannel)
+void decodePixels16( const unsigned char *src, uint16 *dest, size_t pixelCount, int hiChannel, int loChannel );
+
+// Converts floats to half floats with round to nearest even; can be done in place
+void convertFloatToHalf( const float *src, uint16 *dest, size_t count );
+
+}
+#endif // _utPixel_H_
@@ -21,10 +21,10 @@
 #		define NOMINMAX
 #	endif
 #   include <windows.h>
-#else
-#	include <sys/time.h>
 #endif
 
+#include <chrono>
+
 
 namespace Horde3D {
 
@@ -83,6 +83,13 @@ public:
 		return (float)_elapsedTime;
 	}
 
+	// Monotonic clock with nanosecond resolution, shared by all threads
+	static uint64 getTimeNS()
+	{
+		return (uint64)std::chrono::duration_cast< std::chrono::nanoseconds >(
+			std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
 protected:
 
 	double getTime() const
@@ -100,9 +107,7 @@ protected:
 
 		return (double)curTick.QuadPart / (double)_timerFreq.QuadPart * 1000.0;
 	#else
-		timeval tv;
-		gettimeofday( &tv, 0x0 );
-		return (double)tv.tv_sec * 1000.0 + (double)tv.tv_usec / 1000.0;
+		return (double)getTimeNS() / 1000000.0;
 	#endif
 	}
 
@@ -22,15 +22,27 @@
 #		define NOMINMAX
 #	endif
 #	include <windows.h>
+#else
+#	include <dirent.h>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
 #endif
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <map>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <climits>
 #include <fstream>
 #include <iomanip>
+#include <thread>
 
 using namespace Horde3D;
 using namespace std;
@@ -70,6 +82,578 @@ string cleanPath( string path )
 	return path;
 }
 
+
+vector< string > splitContentDirs( const char *contentDir )
+{
+	string dir;
+	vector< string > dirs;
+
+	// Split path string
+	const char *c = contentDir != 0x0 ? contentDir : "";
+	do
+	{
+		if( *c != '|' && *c != '\0' )
+			dir += *c;
+		else
+		{
+			dir = cleanPath( dir );
+			if( dir != "" ) dir += '/';
+			dirs.push_back( dir );
+			dir = "";
+		}
+	} while( *c++ != '\0' );
+
+	return dirs;
+}
+
+
+// =================================================================================================
+// Pack files
+// =================================================================================================
+
+// Pack file layout (all values little endian):
+//   PackHeader
+//   file data, each entry aligned to packAlignment bytes
+//   PackEntry array sorted by name (aligned to packAlignment bytes)
+//   names of the entries (not null-terminated)
+// Entry names are the file paths relative to the content directory, so that a resource is found
+// under the same name in a pack as in the directory the pack was built from.
+
+const char    packMagic[4] = { 'H', '3', 'D', 'P' };
+const uint32  packVersion = 1;
+const uint32  packAlignment = 64;
+
+struct PackCompression
+{
+	enum List
+	{
+		None = 0  // Other values are reserved for compressed entries
+	};
+};
+
+struct PackHeader
+{
+	char    magic[4];
+	uint32  version;
+	uint32  entryCount;
+	uint32  alignment;
+	uint32  indexOffsetLo, indexOffsetHi;
+	uint32  namesOffsetLo, namesOffsetHi;
+};
+
+struct PackEntry
+{
+	uint32  offsetLo, offsetHi;
+	uint32  size;
+	uint32  nameOffset, nameLength;
+	uint32  compression;
+	uint32  uncompressedSize;
+	uint32  reserved;
+};
+
+struct PackFile
+{
+	string           fileName;
+	char             *data;
+	size_t           size;
+	bool             mapped;
+	const PackEntry  *entries;
+	const char       *names;
+	uint32           entryCount;
+#ifdef PLATFORM_WIN
+	HANDLE           mappingHandle;
+#endif
+};
+
+vector< PackFile >  packFiles;
+
+
+inline uint32 getLE( const uint32 &value )
+{
+	uint32 result;
+	elemcpy_le( &result, &value, 1 );
+	return result;
+}
+
+inline void setLE( uint32 &dest, uint32 value )
+{
+	elemcpy_le( &dest, &value, 1 );
+}
+
+inline uint64 getLE64( const uint32 &lo, const uint32 &hi )
+{
+	return (uint64)getLE( lo ) | ((uint64)getLE( hi ) << 32);
+}
+
+
+string normalizePackName( const string &name )
+{
+	string result;
+	result.reserve( name.length() );
+	
+	for( size_t i = 0; i < name.length(); ++i )
+	{
+		char c = name[i] == '\\' ? '/' : name[i];
+		
+		if( c == '/' )
+		{
+			// Skip leading and duplicate slashes
+			if( result.empty() || result[result.length() - 1] == '/' ) continue;
+		}
+		else if( c == '.' && (result.empty() || result[result.length() - 1] == '/') &&
+		         (i + 1 == name.length() || name[i + 1] == '/' || name[i + 1] == '\\') )
+		{
+			// Skip "./"
+			++i;
+			continue;
+		}
+
+		result += c;
+	}
+
+	return result;
+}
+
+
+void listPackFiles( const string &basePath, const string &path, vector< string > &fileList )
+{
+	vector< string >  directories;
+	vector< string >  files;
+	
+	// Find all files and subdirectories in current search path
+#ifdef PLATFORM_WIN
+	string searchString( basePath + path + "*" );
+	
+	WIN32_FIND_DATAA fdat;
+	HANDLE h = FindFirstFileA( searchString.c_str(), &fdat );
+	if( h == INVALID_HANDLE_VALUE ) return;
+	do
+	{
+		// Ignore hidden files
+		if( strcmp( fdat.cFileName, "." ) == 0 || strcmp( fdat.cFileName, ".." ) == 0 ||
+		    fdat.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN )
+		{	
+			continue;
+		}
+		
+		if( fdat.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+			directories.push_back( fdat.cFileName );
+		else
+			files.push_back( fdat.cFileName );
+	} while( FindNextFileA( h, &fdat ) );
+	FindClose( h );
+#else
+	dirent *dirEnt;
+	struct stat fileStat;
+	string finalPath = basePath + path;
+	DIR *dir = opendir( finalPath != "" ? finalPath.c_str() : "." );
+	if( dir == 0x0 ) return;
+
+	while( (dirEnt = readdir( dir )) != 0x0 )
+	{
+		if( dirEnt->d_name[0] == '.' ) continue;  // Ignore hidden files
+
+		if( stat( (finalPath + dirEnt->d_name).c_str(), &fileStat ) != 0 ) continue;
+		
+		if( S_ISDIR( fileStat.st_mode ) )
+			directories.push_back( dirEnt->d_name );
+		else if( S_ISREG( fileStat.st_mode ) )
+			files.push_back( dirEnt->d_name );
+	}
+
+	closedir( dir );
+#endif
+
+	for( size_t i = 0; i < files.size(); ++i )
+		fileList.push_back( path + files[i] );
+	
+	for( size_t i = 0; i < directories.size(); ++i )
+		listPackFiles( basePath, path + directories[i] + "/", fileList );
+}
+
+
+void closePackFile( PackFile &pack )
+{
+	if( pack.data == 0x0 ) return;
+	
+	if( pack.mapped )
+	{
+#ifdef PLATFORM_WIN
+		UnmapViewOfFile( pack.data );
+		CloseHandle( pack.mappingHandle );
+#else
+		munmap( pack.data, pack.size );
+#endif
+	}
+	else
+	{
+		delete[] pack.data;
+	}
+
+	pack.data = 0x0;
+	pack.size = 0;
+}
+
+
+bool openPackFile( const string &fileName, PackFile &pack )
+{
+	pack.fileName = fileName;
+	pack.data = 0x0;
+	pack.size = 0;
+	pack.mapped = false;
+	pack.entries = 0x0;
+	pack.names = 0x0;
+	pack.entryCount = 0;
+
+	// Map the whole pack once; resources are loaded directly from the mapped memory
+#ifdef PLATFORM_WIN
+	pack.mappingHandle = 0x0;
+	HANDLE file = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0x0, OPEN_EXISTING,
+	                           FILE_ATTRIBUTE_NORMAL, 0x0 );
+	if( file == INVALID_HANDLE_VALUE ) return false;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx( file, &fileSize );
+	pack.size = (size_t)fileSize.QuadPart;
+
+	if( pack.size > 0 )
+	{
+		pack.mappingHandle = CreateFileMappingA( file, 0x0, PAGE_READONLY, 0, 0, 0x0 );
+		if( pack.mappingHandle != 0x0 )
+		{
+			pack.data = (char *)MapViewOfFile( pack.mappingHandle, FILE_MAP_READ, 0, 0, 0 );
+			if( pack.data != 0x0 ) pack.mapped = true;
+			else
+			{
+				CloseHandle( pack.mappingHandle );
+				pack.mappingHandle = 0x0;
+			}
+		}
+	}
+	CloseHandle( file );
+#else
+	int file = open( fileName.c_str(), O_RDONLY );
+	if( file < 0 ) return false;
+
+	struct stat fileStat;
+	if( fstat( file, &fileStat ) != 0 )
+	{
+		close( file );
+		return false;
+	}
+	pack.size = (size_t)fileStat.st_size;
+
+	if( pack.size > 0 )
+	{
+		void *data = mmap( 0x0, pack.size, PROT_READ, MAP_PRIVATE, file, 0 );
+		if( data != MAP_FAILED )
+		{
+			pack.data = (char *)data;
+			pack.mapped = true;
+		}
+	}
+	close( file );
+#endif
+
+	// Fall back to reading the pack if it cannot be mapped
+	if( !pack.mapped )
+	{
+		ifstream inf( fileName.c_str(), ios::binary );
+		if( !inf.good() ) return false;
+
+		pack.data = new char[pack.size];
+		inf.read( pack.data, pack.size );
+		if( (size_t)inf.gcount() != pack.size )
+		{
+			closePackFile( pack );
+			return false;
+		}
+	}
+
+	// Validate header and index
+	bool valid = pack.size >= sizeof( PackHeader );
+	if( valid )
+	{
+		const PackHeader &header = *(const PackHeader *)pack.data;
+		uint64 indexOffset = getLE64( header.indexOffsetLo, header.indexOffsetHi );
+		uint64 namesOffset = getLE64( header.namesOffsetLo, header.namesOffsetHi );
+		pack.entryCount = getLE( header.entryCount );
+		
+		// Offsets are compared before sizes are subtracted from them, so that corrupt values can't
+		// wrap around
+		valid = memcmp( header.magic, packMagic, 4 ) == 0 && getLE( header.version ) == packVersion &&
+		        indexOffset % sizeof( uint32 ) == 0 &&
+		        indexOffset <= namesOffset && namesOffset <= pack.size &&
+		        pack.entryCount <= (namesOffset - indexOffset) / sizeof( PackEntry );
+		
+		if( valid )
+		{
+			pack.entries = (const PackEntry *)(pack.data + indexOffset);
+			pack.names = pack.data + namesOffset;
+			uint64 namesSize = pack.size - namesOffset;
+			
+			for( uint32 i = 0; i < pack.entryCount && valid; ++i )
+			{
+				const PackEntry &entry = pack.entries[i];
+				uint64 offset = getLE64( entry.offsetLo, entry.offsetHi );
+				uint32 size = getLE( entry.size ), nameOffset = getLE( entry.nameOffset );
+				valid = offset <= pack.size && size <= pack.size - offset && size <= INT_MAX &&
+				        nameOffset <= namesSize && getLE( entry.nameLength ) <= namesSize - nameOffset;
+			}
+		}
+	}
+
+	if( !valid )
+	{
+		closePackFile( pack );
+		return false;
+	}
+
+	return true;
+}
+
+
+bool findPackEntry( const string &name, const char *&data, int &size )
+{
+	for( size_t i = 0; i < packFiles.size(); ++i )
+	{
+		const PackFile &pack = packFiles[i];
+		
+		// Binary search in sorted index
+		uint32 first = 0, last = pack.entryCount;
+		while( first < last )
+		{
+			uint32 mid = first + (last - first) / 2;
+			const PackEntry &entry = pack.entries[mid];
+			int cmp = name.compare( 0, string::npos, pack.names + getLE( entry.nameOffset ), getLE( entry.nameLength ) );
+			
+			if( cmp > 0 ) first = mid + 1;
+			else if( cmp < 0 ) last = mid;
+			else
+			{
+				if( getLE( entry.compression ) != PackCompression::None ) return false;
+				
+				data = pack.data + getLE64( entry.offsetLo, entry.offsetHi );
+				size = (int)getLE( entry.size );
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+bool writePadding( ofstream &outf, uint64 &offset )
+{
+	static const char zeros[packAlignment] = { 0 };
+	
+	uint64 padding = (packAlignment - offset % packAlignment) % packAlignment;
+	outf.write( zeros, (streamsize)padding );
+	offset += padding;
+
+	return outf.good();
+}
+
+
+// =================================================================================================
+// Prefetch manifest
+// =================================================================================================
+
+// Dependencies recorded when loading resources, so that the data of a resource and all resources it
+// depends on can be read at once instead of one level after the other; resources are identified
+// by "<type> <name>"
+map< string, vector< string > >  manifest;
+map< string, vector< char > >    prefetchCache;  // Data read ahead for resources that are not loaded yet
+int                              prefetchedFiles = 0;
+int                              eliminatedWaves = 0;
+
+
+string getResKey( int type, const string &name )
+{
+	stringstream ss;
+	ss << type << ' ' << name;
+	return ss.str();
+}
+
+
+bool parseResKey( const string &key, int &type, string &name )
+{
+	size_t pos = key.find( ' ' );
+	if( pos == string::npos || pos == 0 ) return false;
+	
+	type = atoi( key.c_str() );
+	name = key.substr( pos + 1 );
+	return true;
+}
+
+
+void recordDependencies( H3DRes res )
+{
+	string key = getResKey( h3dGetResType( res ), h3dGetResName( res ) );
+	int count = h3dGetResDependencies( res, 0x0, 0 );
+	if( count == 0 )
+	{
+		manifest.erase( key );
+		return;
+	}
+	
+	vector< H3DRes > deps( count );
+	h3dGetResDependencies( res, &deps[0], count );
+
+	vector< string > &depKeys = manifest[key];
+	depKeys.clear();
+	for( int i = 0; i < count; ++i )
+		depKeys.push_back( getResKey( h3dGetResType( deps[i] ), h3dGetResName( deps[i] ) ) );
+}
+
+
+bool readFile( const vector< string > &dirs, const string &fileName, vector< char > &data )
+{
+	for( size_t i = 0; i < dirs.size(); ++i )
+	{
+		ifstream inf( (dirs[i] + fileName).c_str(), ios::binary );
+		if( !inf.good() ) continue;
+
+		inf.seekg( 0, ios::end );
+		size_t fileSize = (size_t)inf.tellg();
+		data.resize( fileSize );
+		inf.seekg( 0 );
+		if( fileSize > 0 ) inf.read( &data[0], fileSize );
+		
+		return (size_t)inf.gcount() == fileSize;
+	}
+
+	return false;
+}
+
+
+void prefetchDependencies( const string &rootKey, const vector< string > &dirs )
+{
+	vector< string > keys, fileNames;
+	set< string > visited;
+	vector< string > level( 1, rootKey );
+	int depth = 0, maxDepth = 0;
+	
+	// Collect the transitive dependencies level by level; without prefetching, each level would be
+	// read only after the previous one was parsed
+	visited.insert( rootKey );
+	while( !level.empty() )
+	{
+		vector< string > nextLevel;
+		
+		for( size_t i = 0; i < level.size(); ++i )
+		{
+			int type;
+			string name;
+			if( !parseResKey( level[i], type, name ) ) continue;
+
+			// Only data that is not loaded yet and not available from a mounted pack needs to be read
+			string fileName = resourcePaths[type] + "/" + name;
+			H3DRes res = h3dFindResource( type, name.c_str() );
+			const char *packData;
+			int packDataSize;
+			
+			if( (res == 0 || !h3dIsResLoaded( res )) && prefetchCache.find( level[i] ) == prefetchCache.end() &&
+			    !findPackEntry( normalizePackName( fileName ), packData, packDataSize ) )
+			{
+				keys.push_back( level[i] );
+				fileNames.push_back( fileName );
+				maxDepth = depth;
+			}
+
+			map< string, vector< string > >::iterator itr = manifest.find( level[i] );
+			if( itr == manifest.end() ) continue;
+			
+			for( size_t j = 0; j < itr->second.size(); ++j )
+			{
+				if( visited.insert( itr->second[j] ).second ) nextLevel.push_back( itr->second[j] );
+			}
+		}
+		
+		level.swap( nextLevel );
+		++depth;
+	}
+
+	if( keys.empty() ) return;
+
+	// Read all files in parallel
+	vector< vector< char > > data( keys.size() );
+	vector< char > found( keys.size(), 0 );
+	atomic< size_t > nextFile( 0 );
+	
+	auto readFiles = [&]()
+	{
+		for( size_t i = nextFile++; i < keys.size(); i = nextFile++ )
+			found[i] = readFile( dirs, fileNames[i], data[i] ) ? 1 : 0;
+	};
+
+	size_t numThreads = std::min( (size_t)std::max( thread::hardware_concurrency(), 1u ), (size_t)8 );
+	numThreads = std::min( numThreads, keys.size() );
+	vector< thread > threads;
+	for( size_t i = 1; i < numThreads; ++i )
+		threads.push_back( thread( readFiles ) );
+	readFiles();
+	for( size_t i = 0; i < threads.size(); ++i )
+		threads[i].join();
+
+	for( size_t i = 0; i < keys.size(); ++i )
+	{
+		if( !found[i] ) continue;
+		
+		prefetchCache[keys[i]].swap( data[i] );
+		++prefetchedFiles;
+	}
+	eliminatedWaves += maxDepth;
+}
+
+
+// =================================================================================================
+// Texture streaming
+// =================================================================================================
+
+// Finer mip levels of streamed textures are read from the files the textures were loaded from,
+// using the content directories of the last h3dutLoadResourcesFromDisk call
+vector< string >  texStreamingDirs;
+
+
+bool readStreamedTexture( const char *resName, int offset, int size, void *buffer, void * )
+{
+	if( offset < 0 || size < 0 ) return false;
+	
+	map< int, string >::const_iterator path = resourcePaths.find( H3DResTypes::Texture );
+	string fileName = (path != resourcePaths.end() ? path->second : string()) + "/" + resName;
+
+	const char *packData = 0x0;
+	int packDataSize = 0;
+	if( findPackEntry( normalizePackName( fileName ), packData, packDataSize ) )
+	{
+		if( offset > packDataSize - size ) return false;
+		memcpy( buffer, packData + offset, size );
+		return true;
+	}
+
+	for( size_t i = 0; i < texStreamingDirs.size(); ++i )
+	{
+		ifstream inf( (texStreamingDirs[i] + fileName).c_str(), ios::binary );
+		if( !inf.good() ) continue;
+
+		inf.seekg( offset );
+		inf.read( (char *)buffer, size );
+		return inf.gcount() == size;
+	}
+
+	return false;
+}
+
+
+// The read function is called on the render thread; setting it waits until the render thread is
+// idle, so that search paths and pack files can be changed safely
+void syncTexStreaming()
+{
+	if( !texStreamingDirs.empty() ) h3dSetTexStreamingReadFunc( readStreamedTexture, 0x0 );
+}
+
 }  // namespace
 
 
@@ -97,23 +681,7 @@ H3D_IMPL void h3dutSetResourcePath( int type, const char *path )
 H3D_IMPL bool h3dutLoadResourcesFromDisk( const char *contentDir )
 {
 	bool result = true;
-	string dir;
-	vector< string > dirs;
-
-	// Split path string
-	char *c = (char *)contentDir;
-	do
-	{
-		if( *c != '|' && *c != '\0' )
-			dir += *c;
-		else
-		{
-			dir = cleanPath( dir );
-			if( dir != "" ) dir += '/';
-			dirs.push_back( dir );
-			dir = "";
-		}
-	} while( *c++ != '\0' );
+	vector< string > dirs = splitContentDirs( contentDir );
 	
 	// Get the first resource that needs to be loaded
 	int res = h3dQueryUnloadedResource( 0 );
@@ -121,8 +689,53 @@ H3D_IMPL bool h3dutLoadResourcesFromDisk( const char *contentDir )
 	char *dataBuf = 0;
 	size_t bufSize = 0;
 
+	prefetchCache.clear();
+	prefetchedFiles = 0;
+	eliminatedWaves = 0;
+
+	h3dSetTexStreamingReadFunc( 0x0, 0x0 );
+	texStreamingDirs = dirs;
+	h3dSetTexStreamingReadFunc( readStreamedTexture, 0x0 );
+
 	while( res != 0 )
 	{
+		// Try mounted pack files first; data is passed to the engine without copying it
+		if( !packFiles.empty() )
+		{
+			const char *packData = 0x0;
+			int packDataSize = 0;
+			
+			if( findPackEntry( normalizePackName( resourcePaths[h3dGetResType( res )] + "/" + h3dGetResName( res ) ),
+			                   packData, packDataSize ) )
+			{
+				result &= h3dLoadResource( res, packData, packDataSize );
+				recordDependencies( res );
+				res = h3dQueryUnloadedResource( 0 );
+				continue;
+			}
+		}
+
+		// Read the data of the resource and all its recorded dependencies at once
+		string resKey = getResKey( h3dGetResType( res ), h3dGetResName( res ) );
+		map< string, vector< char > >::iterator cached = prefetchCache.find( resKey );
+		if( cached == prefetchCache.end() && manifest.find( resKey ) != manifest.end() )
+		{
+			prefetchDependencies( resKey, dirs );
+			cached = prefetchCache.find( resKey );
+		}
+
+		if( cached != prefetchCache.end() )
+		{
+			if( !cached->second.empty() )
+				result &= h3dLoadResource( res, &cached->second[0], (int)cached->second.size() );
+			else
+				result &= h3dLoadResource( res, 0x0, 0 );
+			prefetchCache.erase( cached );
+			recordDependencies( res );
+			res = h3dQueryUnloadedResource( 0 );
+			continue;
+		}
+		
 		ifstream inf;
 		
 		// Loop over search paths and try to open files
@@ -158,6 +771,7 @@ H3D_IMPL bool h3dutLoadResourcesFromDisk( const char *contentDir )
 			inf.close();
 			// Send resource data to engine
 			result &= h3dLoadResource( res, dataBuf, ( int ) fileSize );
+			recordDependencies( res );
 		}
 		else // Resource file not found
 		{
@@ -169,11 +783,217 @@ H3D_IMPL bool h3dutLoadResourcesFromDisk( const char *contentDir )
 		res = h3dQueryUnloadedResource( 0 );
 	}
 	delete[] dataBuf;
+	prefetchCache.clear();
 
 	return result;
 }
 
 
+H3D_IMPL bool h3dutLoadPrefetchManifest( const char *fileName )
+{
+	if( fileName == 0x0 ) return false;
+	
+	ifstream inf( fileName );
+	if( !inf.good() ) return false;
+
+	string line;
+	vector< string > *deps = 0x0;
+	while( getline( inf, line ) )
+	{
+		if( !line.empty() && line[line.length() - 1] == '\r' ) line.erase( line.length() - 1 );
+		if( line.length() < 2 || line[1] != ' ' ) continue;
+
+		// "R <type> <name>" starts the dependency list of a resource, "D <type> <name>" adds a dependency
+		int type;
+		string name;
+		if( !parseResKey( line.substr( 2 ), type, name ) ) continue;
+		
+		if( line[0] == 'R' )
+		{
+			deps = &manifest[getResKey( type, name )];
+			deps->clear();
+		}
+		else if( line[0] == 'D' && deps != 0x0 )
+		{
+			deps->push_back( getResKey( type, name ) );
+		}
+	}
+
+	return true;
+}
+
+
+H3D_IMPL bool h3dutSavePrefetchManifest( const char *fileName )
+{
+	if( fileName == 0x0 ) return false;
+	
+	ofstream outf( fileName, ios::out | ios::trunc );
+	if( !outf.good() ) return false;
+
+	for( map< string, vector< string > >::iterator itr = manifest.begin(); itr != manifest.end(); ++itr )
+	{
+		outf << "R " << itr->first << "\n";
+		for( size_t i = 0; i < itr->second.size(); ++i )
+			outf << "D " << itr->second[i] << "\n";
+	}
+
+	return outf.good();
+}
+
+
+H3D_IMPL void h3dutGetPrefetchStats( int *prefetchedFileCount, int *eliminatedWaveCount )
+{
+	if( prefetchedFileCount != 0x0 ) *prefetchedFileCount = prefetchedFiles;
+	if( eliminatedWaveCount != 0x0 ) *eliminatedWaveCount = eliminatedWaves;
+}
+
+
+H3D_IMPL bool h3dutCreatePackFile( const char *contentDir, const char *packFileName )
+{
+	if( packFileName == 0x0 || *packFileName == '\0' ) return false;
+	
+	vector< string > dirs = splitContentDirs( contentDir );
+	string packName = normalizePackName( packFileName );
+
+	// Collect files; earlier search paths take precedence like in h3dutLoadResourcesFromDisk
+	map< string, string > files;
+	for( size_t i = 0; i < dirs.size(); ++i )
+	{
+		vector< string > fileList;
+		listPackFiles( dirs[i], "", fileList );
+
+		for( size_t j = 0; j < fileList.size(); ++j )
+		{
+			string fileName = dirs[i] + fileList[j];
+			if( normalizePackName( fileName ) == packName ) continue;  // Don't pack an old version of the pack
+			
+			files.insert( make_pair( normalizePackName( fileList[j] ), fileName ) );
+		}
+	}
+
+	ofstream outf( packFileName, ios::out | ios::binary | ios::trunc );
+	if( !outf.good() ) return false;
+
+	PackHeader header;
+	memset( &header, 0, sizeof( PackHeader ) );
+	outf.write( (const char *)&header, sizeof( PackHeader ) );
+	
+	uint64 offset = sizeof( PackHeader );
+	bool result = writePadding( outf, offset );
+
+	// Write file data; map is sorted by name, so the index is sorted as well
+	vector< PackEntry > entries;
+	string names;
+	vector< char > dataBuf;
+	
+	for( map< string, string >::iterator itr = files.begin(); itr != files.end() && result; ++itr )
+	{
+		ifstream inf( itr->second.c_str(), ios::binary );
+		if( !inf.good() )
+		{
+			result = false;
+			break;
+		}
+
+		inf.seekg( 0, ios::end );
+		size_t fileSize = (size_t)inf.tellg();
+		if( fileSize > INT_MAX )
+		{
+			result = false;
+			break;
+		}
+		dataBuf.resize( fileSize );
+		inf.seekg( 0 );
+		if( fileSize > 0 ) inf.read( &dataBuf[0], fileSize );
+		if( (size_t)inf.gcount() != fileSize )
+		{
+			result = false;
+			break;
+		}
+		
+		PackEntry entry;
+		setLE( entry.offsetLo, (uint32)offset );
+		setLE( entry.offsetHi, (uint32)(offset >> 32) );
+		setLE( entry.size, (uint32)fileSize );
+		setLE( entry.nameOffset, (uint32)names.length() );
+		setLE( entry.nameLength, (uint32)itr->first.length() );
+		setLE( entry.compression, PackCompression::None );
+		setLE( entry.uncompressedSize, (uint32)fileSize );
+		setLE( entry.reserved, 0 );
+		entries.push_back( entry );
+		names += itr->first;
+
+		if( fileSize > 0 ) outf.write( &dataBuf[0], fileSize );
+		offset += fileSize;
+		result = writePadding( outf, offset );
+	}
+
+	if( result )
+	{
+		// Write index and names
+		uint64 indexOffset = offset;
+		if( !entries.empty() ) outf.write( (const char *)&entries[0], entries.size() * sizeof( PackEntry ) );
+		offset += entries.size() * sizeof( PackEntry );
+		uint64 namesOffset = offset;
+		outf.write( names.data(), names.length() );
+
+		memcpy( header.magic, packMagic, 4 );
+		setLE( header.version, packVersion );
+		setLE( header.entryCount, (uint32)entries.size() );
+		setLE( header.alignment, packAlignment );
+		setLE( header.indexOffsetLo, (uint32)indexOffset );
+		setLE( header.indexOffsetHi, (uint32)(indexOffset >> 32) );
+		setLE( header.namesOffsetLo, (uint32)namesOffset );
+		setLE( header.namesOffsetHi, (uint32)(namesOffset >> 32) );
+		outf.seekp( 0 );
+		outf.write( (const char *)&header, sizeof( PackHeader ) );
+		result = outf.good();
+	}
+
+	outf.close();
+	if( !result ) remove( packFileName );
+	
+	return result;
+}
+
+
+H3D_IMPL bool h3dutMountPackFile( const char *packFileName )
+{
+	if( packFileName == 0x0 ) return false;
+	
+	for( size_t i = 0; i < packFiles.size(); ++i )
+	{
+		if( packFiles[i].fileName == packFileName ) return true;
+	}
+	
+	PackFile pack;
+	if( !openPackFile( packFileName, pack ) ) return false;
+
+	syncTexStreaming();
+	packFiles.push_back( pack );
+	return true;
+}
+
+
+H3D_IMPL bool h3dutUnmountPackFile( const char *packFileName )
+{
+	if( packFileName == 0x0 ) return false;
+	
+	for( size_t i = 0; i < packFiles.size(); ++i )
+	{
+		if( packFiles[i].fileName == packFileName )
+		{
+			syncTexStreaming();
+			closePackFile( packFiles[i] );
+			packFiles.erase( packFiles.begin() + i );
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 H3D_IMPL bool h3dutDumpMessages()
 {
 	if( !outf.is_open() )
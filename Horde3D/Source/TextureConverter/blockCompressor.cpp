@@ -0,0 +1,653 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "blockCompressor.h"
+#include "utPlatform.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+namespace Horde3D {
+namespace TextureConverter {
+
+
+static inline int clampInt( int v, int minValue, int maxValue )
+{
+	return v < minValue ? minValue : (v > maxValue ? maxValue : v);
+}
+
+
+// Computes mean and principal axis of the first numComps components of the block pixels
+static void calcPrincipalAxis( const unsigned char *pixels, int numComps, float *mean, float *axis )
+{
+	float minValues[4] = { 255, 255, 255, 255 }, maxValues[4] = { 0, 0, 0, 0 };
+	for( int c = 0; c < numComps; ++c )
+	{
+		mean[c] = 0;
+		for( int i = 0; i < 16; ++i )
+		{
+			float v = pixels[i * 4 + c];
+			mean[c] += v;
+			minValues[c] = min( minValues[c], v );
+			maxValues[c] = max( maxValues[c], v );
+		}
+		mean[c] /= 16.0f;
+	}
+
+	float cov[4][4] = { { 0 } };
+	for( int i = 0; i < 16; ++i )
+	{
+		float d[4];
+		for( int c = 0; c < numComps; ++c ) d[c] = pixels[i * 4 + c] - mean[c];
+		for( int a = 0; a < numComps; ++a )
+			for( int b = 0; b < numComps; ++b ) cov[a][b] += d[a] * d[b];
+	}
+
+	// Power iteration starting with the diagonal of the bounding box
+	float len = 0;
+	for( int c = 0; c < numComps; ++c )
+	{
+		axis[c] = maxValues[c] - minValues[c];
+		len += axis[c] * axis[c];
+	}
+	if( len == 0 )
+	{
+		for( int c = 0; c < numComps; ++c ) axis[c] = 1;
+		len = (float)numComps;
+	}
+	for( int c = 0; c < numComps; ++c ) axis[c] /= sqrtf( len );
+
+	for( int iter = 0; iter < 8; ++iter )
+	{
+		float v[4] = { 0, 0, 0, 0 };
+		for( int a = 0; a < numComps; ++a )
+			for( int b = 0; b < numComps; ++b ) v[a] += cov[a][b] * axis[b];
+
+		len = 0;
+		for( int c = 0; c < numComps; ++c ) len += v[c] * v[c];
+		if( len < 1e-6f ) break;
+		for( int c = 0; c < numComps; ++c ) axis[c] = v[c] / sqrtf( len );
+	}
+}
+
+
+// Endpoints of the block along the principal axis
+static void calcAxisEndpoints( const unsigned char *pixels, int numComps, float *e0, float *e1 )
+{
+	float mean[4], axis[4];
+	calcPrincipalAxis( pixels, numComps, mean, axis );
+
+	float tMin = 1e10f, tMax = -1e10f;
+	for( int i = 0; i < 16; ++i )
+	{
+		float t = 0;
+		for( int c = 0; c < numComps; ++c ) t += (pixels[i * 4 + c] - mean[c]) * axis[c];
+		tMin = min( tMin, t );
+		tMax = max( tMax, t );
+	}
+
+	for( int c = 0; c < numComps; ++c )
+	{
+		e0[c] = mean[c] + axis[c] * tMax;
+		e1[c] = mean[c] + axis[c] * tMin;
+	}
+}
+
+
+// Least squares fit of two endpoints to the pixels, given the weight of e0 for every pixel
+static bool fitEndpoints( const unsigned char *pixels, int numComps, const float *weights, float *e0, float *e1 )
+{
+	float aa = 0, ab = 0, bb = 0;
+	float ax[4] = { 0 }, bx[4] = { 0 };
+	for( int i = 0; i < 16; ++i )
+	{
+		float a = weights[i], b = 1.0f - a;
+		aa += a * a; ab += a * b; bb += b * b;
+		for( int c = 0; c < numComps; ++c )
+		{
+			ax[c] += a * pixels[i * 4 + c];
+			bx[c] += b * pixels[i * 4 + c];
+		}
+	}
+
+	float det = aa * bb - ab * ab;
+	if( fabsf( det ) < 1e-6f ) return false;
+	for( int c = 0; c < numComps; ++c )
+	{
+		e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+		e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+	}
+
+	return true;
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// BC1 and BC3
+// -------------------------------------------------------------------------------------------------
+
+static uint16 packRGB565( const float *color )
+{
+	int r = clampInt( (int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31 );
+	int g = clampInt( (int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63 );
+	int b = clampInt( (int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31 );
+
+	return (uint16)((r << 11) | (g << 5) | b);
+}
+
+
+static void unpackRGB565( uint16 value, int *color )
+{
+	int r = value >> 11, g = (value >> 5) & 63, b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+
+static int selectBC1Indices( const unsigned char *pixels, uint16 c0, uint16 c1, unsigned char *indices )
+{
+	int palette[4][3];
+	unpackRGB565( c0, palette[0] );
+	unpackRGB565( c1, palette[1] );
+	for( int c = 0; c < 3; ++c )
+	{
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	int error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		int bestError = INT_MAX;
+		for( int k = 0; k < 4; ++k )
+		{
+			int e = 0;
+			for( int c = 0; c < 3; ++c )
+			{
+				int d = palette[k][c] - pixels[i * 4 + c];
+				e += d * d;
+			}
+			if( e < bestError )
+			{
+				bestError = e;
+				indices[i] = (unsigned char)k;
+			}
+		}
+		error += bestError;
+	}
+
+	return error;
+}
+
+
+static void encodeColorBlock( const unsigned char *pixels, unsigned char *dest )
+{
+	float e0[3], e1[3];
+	calcAxisEndpoints( pixels, 3, e0, e1 );
+
+	uint16 c0 = packRGB565( e0 ), c1 = packRGB565( e1 );
+	unsigned char indices[16];
+	int error = selectBC1Indices( pixels, c0, c1, indices );
+
+	// Refine endpoints for the selected palette entries
+	static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	for( int iter = 0; iter < 2 && error > 0; ++iter )
+	{
+		float pixelWeights[16];
+		for( int i = 0; i < 16; ++i ) pixelWeights[i] = weights[indices[i]];
+		if( !fitEndpoints( pixels, 3, pixelWeights, e0, e1 ) ) break;
+
+		uint16 newC0 = packRGB565( e0 ), newC1 = packRGB565( e1 );
+		unsigned char newIndices[16];
+		int newError = selectBC1Indices( pixels, newC0, newC1, newIndices );
+		if( newError >= error ) break;
+
+		c0 = newC0; c1 = newC1;
+		error = newError;
+		memcpy( indices, newIndices, 16 );
+	}
+
+	// The four color mode requires c0 > c1
+	if( c0 < c1 )
+	{
+		swap( c0, c1 );
+		for( int i = 0; i < 16; ++i ) indices[i] ^= 1;
+	}
+	else if( c0 == c1 )
+	{
+		memset( indices, 0, 16 );
+	}
+
+	uint32 indexBits = 0;
+	for( int i = 0; i < 16; ++i ) indexBits |= (uint32)indices[i] << (2 * i);
+
+	dest[0] = (unsigned char)(c0 & 0xff); dest[1] = (unsigned char)(c0 >> 8);
+	dest[2] = (unsigned char)(c1 & 0xff); dest[3] = (unsigned char)(c1 >> 8);
+	for( int i = 0; i < 4; ++i ) dest[4 + i] = (unsigned char)(indexBits >> (8 * i));
+}
+
+
+static void encodeAlphaBlock( const unsigned char *pixels, unsigned char *dest )
+{
+	int aMin = 255, aMax = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		aMin = min( aMin, (int)pixels[i * 4 + 3] );
+		aMax = max( aMax, (int)pixels[i * 4 + 3] );
+	}
+
+	// Eight value mode (a0 > a1); all indices are 0 for constant blocks
+	int values[8] = { aMax, aMin };
+	for( int k = 2; k < 8; ++k ) values[k] = ((8 - k) * aMax + (k - 1) * aMin + 3) / 7;
+
+	uint64 indexBits = 0;
+	for( int i = 0; i < 16 && aMax > aMin; ++i )
+	{
+		int a = pixels[i * 4 + 3], best = 0;
+		for( int k = 1; k < 8; ++k )
+		{
+			if( abs( values[k] - a ) < abs( values[best] - a ) ) best = k;
+		}
+		indexBits |= (uint64)best << (3 * i);
+	}
+
+	dest[0] = (unsigned char)aMax;
+	dest[1] = (unsigned char)aMin;
+	for( int i = 0; i < 6; ++i ) dest[2 + i] = (unsigned char)(indexBits >> (8 * i));
+}
+
+
+void encodeBC1Block( const unsigned char *pixels, unsigned char *dest )
+{
+	encodeColorBlock( pixels, dest );
+}
+
+
+void encodeBC3Block( const unsigned char *pixels, unsigned char *dest )
+{
+	encodeAlphaBlock( pixels, dest );
+	encodeColorBlock( pixels, dest + 8 );
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// BC7
+// -------------------------------------------------------------------------------------------------
+
+static const int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+struct BC7Endpoints
+{
+	int  q0[4], q1[4];  // 7 bit values
+	int  p0, p1;        // P-bits
+};
+
+
+static int selectBC7Indices( const unsigned char *pixels, const BC7Endpoints &ep, unsigned char *indices )
+{
+	int palette[16][4];
+	for( int c = 0; c < 4; ++c )
+	{
+		int e0 = (ep.q0[c] << 1) | ep.p0, e1 = (ep.q1[c] << 1) | ep.p1;
+		for( int k = 0; k < 16; ++k )
+			palette[k][c] = ((64 - bc7Weights[k]) * e0 + bc7Weights[k] * e1 + 32) >> 6;
+	}
+
+	int error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		int bestError = INT_MAX;
+		for( int k = 0; k < 16; ++k )
+		{
+			int e = 0;
+			for( int c = 0; c < 4; ++c )
+			{
+				int d = palette[k][c] - pixels[i * 4 + c];
+				e += d * d;
+			}
+			if( e < bestError )
+			{
+				bestError = e;
+				indices[i] = (unsigned char)k;
+			}
+		}
+		error += bestError;
+	}
+
+	return error;
+}
+
+
+// Quantizes the endpoints with the best combination of P-bits
+static int quantizeBC7Endpoints( const unsigned char *pixels, const float *e0, const float *e1,
+                                 BC7Endpoints &ep, unsigned char *indices )
+{
+	int bestError = INT_MAX;
+	for( int p = 0; p < 4; ++p )
+	{
+		BC7Endpoints cand;
+		cand.p0 = p & 1;
+		cand.p1 = p >> 1;
+		for( int c = 0; c < 4; ++c )
+		{
+			cand.q0[c] = clampInt( (int)floorf( (e0[c] - cand.p0) * 0.5f + 0.5f ), 0, 127 );
+			cand.q1[c] = clampInt( (int)floorf( (e1[c] - cand.p1) * 0.5f + 0.5f ), 0, 127 );
+		}
+
+		unsigned char candIndices[16];
+		int error = selectBC7Indices( pixels, cand, candIndices );
+		if( error < bestError )
+		{
+			bestError = error;
+			ep = cand;
+			memcpy( indices, candIndices, 16 );
+		}
+	}
+
+	return bestError;
+}
+
+
+struct BitWriter
+{
+	unsigned char  *data;
+	uint32         pos;
+
+	BitWriter( unsigned char *data ) : data( data ), pos( 0 ) {}
+
+	void write( uint32 value, uint32 numBits )
+	{
+		for( uint32 i = 0; i < numBits; ++i, ++pos )
+			data[pos >> 3] |= (unsigned char)(((value >> i) & 1) << (pos & 7));
+	}
+};
+
+
+void encodeBC7Block( const unsigned char *pixels, unsigned char *dest )
+{
+	float e0[4], e1[4];
+	calcAxisEndpoints( pixels, 4, e0, e1 );
+
+	BC7Endpoints ep;
+	unsigned char indices[16];
+	int error = quantizeBC7Endpoints( pixels, e0, e1, ep, indices );
+
+	// Refine endpoints for the selected interpolation weights
+	if( error > 0 )
+	{
+		float pixelWeights[16];
+		for( int i = 0; i < 16; ++i ) pixelWeights[i] = 1.0f - bc7Weights[indices[i]] / 64.0f;
+		if( fitEndpoints( pixels, 4, pixelWeights, e0, e1 ) )
+		{
+			BC7Endpoints newEp;
+			unsigned char newIndices[16];
+			if( quantizeBC7Endpoints( pixels, e0, e1, newEp, newIndices ) < error )
+			{
+				ep = newEp;
+				memcpy( indices, newIndices, 16 );
+			}
+		}
+	}
+
+	// The most significant index bit of the first pixel is implicitly 0
+	if( indices[0] & 8 )
+	{
+		for( int c = 0; c < 4; ++c ) swap( ep.q0[c], ep.q1[c] );
+		swap( ep.p0, ep.p1 );
+		for( int i = 0; i < 16; ++i ) indices[i] = (unsigned char)(15 - indices[i]);
+	}
+
+	memset( dest, 0, 16 );
+	BitWriter bits( dest );
+	bits.write( 1 << 6, 7 );  // Mode 6
+	for( int c = 0; c < 4; ++c )
+	{
+		bits.write( ep.q0[c], 7 );
+		bits.write( ep.q1[c], 7 );
+	}
+	bits.write( ep.p0, 1 );
+	bits.write( ep.p1, 1 );
+	bits.write( indices[0], 3 );
+	for( int i = 1; i < 16; ++i ) bits.write( indices[i], 4 );
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// ETC2
+// -------------------------------------------------------------------------------------------------
+
+static const int etcModifiers[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int eacModifiers[16][8] = {
+	{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+	{ -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+	{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+	{ -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+	{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+	{ -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+	{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+	{ -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+
+// Selects the modifier table and the pixel indices for the 8 pixels of a sub-block
+static int fitETCSubBlock( const unsigned char *pixels, const int *subPixels, const int *base,
+                           int &table, int *indices )
+{
+	int bestError = INT_MAX;
+	for( int t = 0; t < 8; ++t )
+	{
+		// Pixel index 0: +a, 1: +b, 2: -a, 3: -b
+		const int mods[4] = { etcModifiers[t][0], etcModifiers[t][1], -etcModifiers[t][0], -etcModifiers[t][1] };
+		int error = 0, tableIndices[8];
+		for( int i = 0; i < 8 && error < bestError; ++i )
+		{
+			const unsigned char *pixel = &pixels[subPixels[i] * 4];
+			int pixelError = INT_MAX;
+			for( int k = 0; k < 4; ++k )
+			{
+				int e = 0;
+				for( int c = 0; c < 3; ++c )
+				{
+					int d = clampInt( base[c] + mods[k], 0, 255 ) - pixel[c];
+					e += d * d;
+				}
+				if( e < pixelError )
+				{
+					pixelError = e;
+					tableIndices[i] = k;
+				}
+			}
+			error += pixelError;
+		}
+
+		if( error < bestError )
+		{
+			bestError = error;
+			table = t;
+			memcpy( indices, tableIndices, sizeof( tableIndices ) );
+		}
+	}
+
+	return bestError;
+}
+
+
+static void writeBigEndian( uint64 value, unsigned char *dest )
+{
+	for( int i = 0; i < 8; ++i ) dest[i] = (unsigned char)(value >> (56 - 8 * i));
+}
+
+
+void encodeETC2Block( const unsigned char *pixels, unsigned char *dest )
+{
+	int bestError = INT_MAX;
+	uint64 bestBlock = 0;
+
+	for( int flip = 0; flip < 2; ++flip )
+	{
+		// Sub-blocks are 2x4 pixels side by side or 4x2 pixels on top of each other
+		int subPixels[2][8], subPos[2][8];
+		float avg[2][3] = { { 0 } };
+		for( int s = 0; s < 2; ++s )
+		{
+			for( int i = 0; i < 8; ++i )
+			{
+				int x = flip ? i % 4 : s * 2 + i % 2;
+				int y = flip ? s * 2 + i / 4 : i / 2;
+				subPixels[s][i] = y * 4 + x;
+				subPos[s][i] = x * 4 + y;  // Pixels are stored column by column
+				for( int c = 0; c < 3; ++c ) avg[s][c] += pixels[subPixels[s][i] * 4 + c] / 8.0f;
+			}
+		}
+
+		for( int diff = 0; diff < 2; ++diff )
+		{
+			int q[2][3], base[2][3];
+			for( int c = 0; c < 3; ++c )
+			{
+				if( diff )
+				{
+					// Base color with 5 bits and second color as 3 bit offset
+					q[0][c] = clampInt( (int)(avg[0][c] * 31.0f / 255.0f + 0.5f), 0, 31 );
+					q[1][c] = clampInt( (int)(avg[1][c] * 31.0f / 255.0f + 0.5f), 0, 31 );
+					q[1][c] = q[0][c] + clampInt( q[1][c] - q[0][c], -4, 3 );
+					base[0][c] = (q[0][c] << 3) | (q[0][c] >> 2);
+					base[1][c] = (q[1][c] << 3) | (q[1][c] >> 2);
+				}
+				else
+				{
+					q[0][c] = clampInt( (int)(avg[0][c] * 15.0f / 255.0f + 0.5f), 0, 15 );
+					q[1][c] = clampInt( (int)(avg[1][c] * 15.0f / 255.0f + 0.5f), 0, 15 );
+					base[0][c] = q[0][c] * 17;
+					base[1][c] = q[1][c] * 17;
+				}
+			}
+
+			int tables[2], indices[2][8];
+			int error = fitETCSubBlock( pixels, subPixels[0], base[0], tables[0], indices[0] );
+			if( error >= bestError ) continue;
+			error += fitETCSubBlock( pixels, subPixels[1], base[1], tables[1], indices[1] );
+			if( error >= bestError ) continue;
+
+			bestError = error;
+			uint32 hi = 0, lo = 0;
+			if( diff )
+			{
+				hi = (q[0][0] << 27) | (((q[1][0] - q[0][0]) & 7) << 24) |
+				     (q[0][1] << 19) | (((q[1][1] - q[0][1]) & 7) << 16) |
+				     (q[0][2] << 11) | (((q[1][2] - q[0][2]) & 7) << 8);
+			}
+			else
+			{
+				hi = (q[0][0] << 28) | (q[1][0] << 24) | (q[0][1] << 20) | (q[1][1] << 16) |
+				     (q[0][2] << 12) | (q[1][2] << 8);
+			}
+			hi |= (tables[0] << 5) | (tables[1] << 2) | (diff << 1) | flip;
+
+			for( int s = 0; s < 2; ++s )
+			{
+				for( int i = 0; i < 8; ++i )
+				{
+					lo |= (uint32)(indices[s][i] >> 1) << (16 + subPos[s][i]);
+					lo |= (uint32)(indices[s][i] & 1) << subPos[s][i];
+				}
+			}
+			bestBlock = ((uint64)hi << 32) | lo;
+		}
+	}
+
+	writeBigEndian( bestBlock, dest );
+}
+
+
+static int fitEACAlpha( const unsigned char *pixels, int base, int mul, int table, int *indices )
+{
+	int error = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		int a = pixels[i * 4 + 3], pixelError = INT_MAX;
+		for( int k = 0; k < 8; ++k )
+		{
+			int d = clampInt( base + eacModifiers[table][k] * mul, 0, 255 ) - a;
+			if( d * d < pixelError )
+			{
+				pixelError = d * d;
+				if( indices != 0x0 ) indices[i] = k;
+			}
+		}
+		error += pixelError;
+	}
+
+	return error;
+}
+
+
+void encodeETC2EACBlock( const unsigned char *pixels, unsigned char *dest )
+{
+	int aMin = 255, aMax = 0;
+	for( int i = 0; i < 16; ++i )
+	{
+		aMin = min( aMin, (int)pixels[i * 4 + 3] );
+		aMax = max( aMax, (int)pixels[i * 4 + 3] );
+	}
+
+	// Table 13 contains 0, so constant blocks are exact
+	int bestBase = aMin, bestMul = 1, bestTable = 13;
+	if( aMax > aMin )
+	{
+		int bestError = INT_MAX;
+		for( int t = 0; t < 16; ++t )
+		{
+			int tMin = *min_element( eacModifiers[t], eacModifiers[t] + 8 );
+			int tMax = *max_element( eacModifiers[t], eacModifiers[t] + 8 );
+			int mul0 = (int)((float)(aMax - aMin) / (tMax - tMin) + 0.5f);
+
+			for( int mul = max( mul0 - 1, 1 ); mul <= min( mul0 + 1, 15 ); ++mul )
+			{
+				int base0 = (int)((aMin + aMax) * 0.5f - (tMin + tMax) * mul * 0.5f + 0.5f);
+				for( int base = max( base0 - 1, 0 ); base <= min( base0 + 1, 255 ); ++base )
+				{
+					int error = fitEACAlpha( pixels, base, mul, t, 0x0 );
+					if( error < bestError )
+					{
+						bestError = error;
+						bestBase = base; bestMul = mul; bestTable = t;
+					}
+				}
+			}
+		}
+	}
+
+	int indices[16];
+	fitEACAlpha( pixels, bestBase, bestMul, bestTable, indices );
+
+	uint64 block = ((uint64)bestBase << 56) | ((uint64)bestMul << 52) | ((uint64)bestTable << 48);
+	for( int y = 0; y < 4; ++y )
+	{
+		for( int x = 0; x < 4; ++x )
+			block |= (uint64)indices[y * 4 + x] << (45 - 3 * (x * 4 + y));
+	}
+	writeBigEndian( block, dest );
+
+	encodeETC2Block( pixels, dest + 8 );
+}
+
+
+} // namespace TextureConverter
+} // namespace Horde3D
@@ -0,0 +1,37 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _blockCompressor_H_
+#define _blockCompressor_H_
+
+namespace Horde3D {
+namespace TextureConverter {
+
+
+// All encoders take a block of 4x4 RGBA pixels in row order (64 bytes)
+
+// BC1 (DXT1) color block without alpha, 8 bytes
+void encodeBC1Block( const unsigned char *pixels, unsigned char *dest );
+// BC3 (DXT5) block with interpolated alpha, 16 bytes
+void encodeBC3Block( const unsigned char *pixels, unsigned char *dest );
+// BC7 block in mode 6 (single RGBA endpoint pair with 16 interpolation steps), 16 bytes
+void encodeBC7Block( const unsigned char *pixels, unsigned char *dest );
+// ETC2 RGB block using the ETC1 compatible individual and differential modes, 8 bytes
+void encodeETC2Block( const unsigned char *pixels, unsigned char *dest );
+// ETC2 RGBA block with EAC alpha, 16 bytes
+void encodeETC2EACBlock( const unsigned char *pixels, unsigned char *dest );
+
+
+} // namespace TextureConverter
+} // namespace Horde3D
+
+#endif // _blockCompressor_H_
@@ -0,0 +1,321 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "textureCompiler.h"
+#include "cache.h"
+#include "utils.h"
+#include "utPlatform.h"
+#include <algorithm>
+#include <sstream>
+#include <atomic>
+#include <thread>
+
+#ifdef PLATFORM_WIN
+#   define WIN32_LEAN_AND_MEAN 1
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <windows.h>
+#	include <direct.h>
+#else
+#   include <unistd.h>
+#   define _chdir chdir
+#	include <sys/stat.h>
+#	include <dirent.h>
+#endif
+
+using namespace std;
+using namespace Horde3D;
+using namespace ColladaConverter;
+using namespace TextureConverter;
+
+
+static const char *imageExtensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".hdr" };
+
+
+bool isImageFile( const string &fileName )
+{
+	size_t len = fileName.length();
+	for( size_t i = 0; i < sizeof( imageExtensions ) / sizeof( char * ); ++i )
+	{
+		size_t extLen = strlen( imageExtensions[i] );
+		if( len > extLen && _stricmp( fileName.c_str() + (len - extLen), imageExtensions[i] ) == 0 )
+			return true;
+	}
+
+	return false;
+}
+
+
+void createAssetList( const string &basePath, const string &assetPath, vector< string > &assetList )
+{
+	vector< string >  directories;
+	vector< string >  files;
+
+// Find all files and subdirectories in current search path
+#ifdef PLATFORM_WIN
+	string searchString( basePath + assetPath + "*" );
+
+	WIN32_FIND_DATA fdat;
+	HANDLE h = FindFirstFile( searchString.c_str(), &fdat );
+	if( h == INVALID_HANDLE_VALUE ) return;
+	do
+	{
+		// Ignore hidden files
+		if( strcmp( fdat.cFileName, "." ) == 0 || strcmp( fdat.cFileName, ".." ) == 0 ||
+		    fdat.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN )
+		{
+			continue;
+		}
+
+		if( fdat.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY )
+			directories.push_back( fdat.cFileName );
+		else
+			files.push_back( fdat.cFileName );
+	} while( FindNextFile( h, &fdat ) );
+#else
+	dirent *dirEnt;
+	struct stat fileStat;
+	string finalPath = basePath + assetPath;
+	DIR *dir = opendir( finalPath.c_str() );
+	if( dir == 0x0 ) return;
+
+	while( (dirEnt = readdir( dir )) != 0x0 )
+	{
+		if( dirEnt->d_name[0] == '.' ) continue;  // Ignore hidden files
+
+		lstat( (finalPath + dirEnt->d_name).c_str(), &fileStat );
+
+		if( S_ISDIR( fileStat.st_mode ) )
+			directories.push_back( dirEnt->d_name );
+		else if( S_ISREG( fileStat.st_mode ) )
+			files.push_back( dirEnt->d_name );
+	}
+
+	closedir( dir );
+
+	sort( directories.begin(), directories.end() );
+	sort( files.begin(), files.end() );
+#endif
+
+	// Check file extensions
+	for( unsigned int i = 0; i < files.size(); ++i )
+	{
+		if( isImageFile( files[i] ) ) assetList.push_back( assetPath + files[i] );
+	}
+
+	// Search in subdirectories
+	for( unsigned int i = 0; i < directories.size(); ++i )
+	{
+		createAssetList( basePath, assetPath + directories[i] + "/", assetList );
+	}
+}
+
+
+void printHelp()
+{
+	log( "Usage:" );
+	log( "TextureConv input [optional arguments]" );
+	log( "" );
+	log( "input             image file or directory to be processed (png, jpg, tga, bmp, psd, hdr)" );
+	log( "-base path        base path where the repository root is located" );
+	log( "-dest path        existing destination path where output is written" );
+	log( "-format fmt       auto|bc1|bc3|bc7|etc2|bgra8 (default: auto, BC1 or BC3 depending on alpha);" );
+	log( "                  etc2 is written as KTX for OpenGL ES 3, all other formats as DDS" );
+	log( "-mipFilter filter box|kaiser (default: box)" );
+	log( "-noMips           do not generate mip levels" );
+	log( "-srgb             image contains sRGB colors, mips are filtered in linear space" );
+	log( "-wrap             filter across image borders for tiling textures" );
+	log( "-jobs count       number of threads used for conversion (default: 1, 0: all cores)" );
+	log( "-force            convert all images even if they are up to date" );
+}
+
+
+int main( int argc, char **argv )
+{
+	log( "Horde3D TextureConv - 1.0.0" );
+	log( "" );
+
+	if( argc < 2 )
+	{
+		printHelp();
+		return 1;
+	}
+
+	// =============================================================================================
+	// Parse arguments
+	// =============================================================================================
+
+	vector< string > assetList;
+	string input = argv[1], basePath = "./", outPath = "./";
+	TextureOptions options;
+	bool force = false;
+
+	// Make sure that first argument ist not an option
+	if( argv[1][0] == '-' )
+	{
+		log( "Missing input file or dir; use . for repository root" );
+		return 1;
+	}
+
+	// Check optional arguments
+	for( int i = 2; i < argc; ++i )
+	{
+		std::string arg = argv[i];
+		arg.erase(remove_if(arg.begin(), arg.end(), ::isspace), arg.end());
+
+		if( _stricmp( arg.c_str(), "-base" ) == 0 && argc > i + 1 )
+		{
+			basePath = cleanPath( argv[++i] ) + "/";
+		}
+		else if( _stricmp( arg.c_str(), "-dest" ) == 0 && argc > i + 1 )
+		{
+			outPath = cleanPath( argv[++i] ) + "/";
+		}
+		else if( _stricmp( arg.c_str(), "-format" ) == 0 && argc > i + 1 )
+		{
+			const char *format = argv[++i];
+			if( _stricmp( format, "auto" ) == 0 ) options.format = OutputFormats::Auto;
+			else if( _stricmp( format, "bc1" ) == 0 ) options.format = OutputFormats::BC1;
+			else if( _stricmp( format, "bc3" ) == 0 ) options.format = OutputFormats::BC3;
+			else if( _stricmp( format, "bc7" ) == 0 ) options.format = OutputFormats::BC7;
+			else if( _stricmp( format, "etc2" ) == 0 ) options.format = OutputFormats::ETC2;
+			else if( _stricmp( format, "bgra8" ) == 0 ) options.format = OutputFormats::BGRA8;
+			else
+			{
+				log( std::string( "Unsupported format: '" ) + format + std::string( "'" ) );
+				return 1;
+			}
+		}
+		else if( _stricmp( arg.c_str(), "-mipFilter" ) == 0 && argc > i + 1 )
+		{
+			options.mipFilter = _stricmp( argv[++i], "kaiser" ) == 0 ? MipFilters::Kaiser : MipFilters::Box;
+		}
+		else if( _stricmp( arg.c_str(), "-noMips" ) == 0 )
+		{
+			options.mips = false;
+		}
+		else if( _stricmp( arg.c_str(), "-srgb" ) == 0 )
+		{
+			options.sRGB = true;
+		}
+		else if( _stricmp( arg.c_str(), "-wrap" ) == 0 )
+		{
+			options.wrap = true;
+		}
+		else if( _stricmp( arg.c_str(), "-jobs" ) == 0 && argc > i + 1 )
+		{
+			int jobs = atoi( argv[++i] );
+			if( jobs <= 0 ) jobs = (int)thread::hardware_concurrency();
+			setJobCount( (unsigned int)max( jobs, 1 ) );
+		}
+		else if( _stricmp( arg.c_str(), "-force" ) == 0 )
+		{
+			force = true;
+		}
+		else
+		{
+			log( std::string( "Invalid arguments: '" ) + arg.c_str() + std::string( "'" ) );
+			printHelp();
+			return 1;
+		}
+	}
+
+	// Check whether input is single file or directory and create asset input list
+	if( isImageFile( input ) )
+	{
+		// Check if it's an absolute path
+		if( input[0] == '/' || input[1] == ':' || input[0] == '\\' )
+		{
+			size_t index = input.find_last_of( "\\/" );
+			_chdir( input.substr( 0, index ).c_str() );
+			input = input.substr( index + 1, input.length() - index );
+		}
+		assetList.push_back ( input );
+	}
+	else
+	{
+		if( input == "." ) input = "";
+		else input = cleanPath( input ) + "/";
+		createAssetList( basePath, input, assetList );
+	}
+
+	// =============================================================================================
+	// Batch conversion
+	// =============================================================================================
+
+	log( "Processing TEXTURES - Path: " + input );
+	log( "" );
+
+	// Images are skipped if source and options did not change since the last conversion
+	// into the same destination
+	ConversionCache cache( outPath + ".textureconv.cache" );
+	if( !force ) cache.load();
+
+	stringstream optionsStr;
+	optionsStr << "TextureConv 1.0.0|" << options.format << "|" << options.mipFilter << "|"
+	           << options.mips << options.sRGB << options.wrap;
+	uint64 optionsHash = hashString( optionsStr.str() );
+
+	// Images are converted in parallel, the remaining job budget is used for the blocks of each image
+	atomic< bool > failed( false );
+	atomic< unsigned int > numUpToDate( 0 ), numConverted( 0 );
+
+	parallelFor( (unsigned int)assetList.size(), [&]( unsigned int i )
+	{
+		if( failed ) return;
+
+		beginLogGroup();
+
+		string assetPath = cleanPath( extractFilePath( assetList[i] ) );
+		if( !assetPath.empty() ) assetPath += "/";
+		string destName = getCompiledTextureName( assetList[i], options );
+
+		uint64 key = hashString( assetList[i], optionsHash );
+		bool keyValid = hashFile( basePath + assetList[i], key );
+
+		if( keyValid && !force && cache.isUpToDate( assetList[i], key ) )
+		{
+			++numUpToDate;
+			endLogGroup();
+			return;
+		}
+
+		log( "Compiling texture '" + assetList[i] + "'..." );
+		createDirectories( outPath, assetPath );
+		if( compileTexture( basePath + assetList[i], outPath + destName, options ) )
+		{
+			vector< string > outputs( 1, outPath + destName );
+			if( keyValid ) cache.update( assetList[i], key, outputs );
+			else cache.remove( assetList[i] );
+			++numConverted;
+		}
+		else
+		{
+			cache.remove( assetList[i] );
+			failed = true;
+		}
+
+		log( "" );
+		endLogGroup();
+	} );
+
+	cache.save();
+
+	stringstream summary;
+	summary << "Converted " << numConverted << " textures, skipped " << numUpToDate << " up-to-date textures";
+	log( summary.str() );
+
+	if( failed ) return 1;
+
+	return 0;
+}
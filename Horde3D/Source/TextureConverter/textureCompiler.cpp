@@ -0,0 +1,540 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#if defined( _MSC_VER )
+#	if _MSC_VER >= 1400
+#		define _CRT_SECURE_NO_DEPRECATE
+#	endif
+#endif
+
+#include "textureCompiler.h"
+#include "blockCompressor.h"
+#include "utils.h"
+#include "utEndian.h"
+#include "utImage.h"
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+namespace Horde3D {
+namespace TextureConverter {
+
+using namespace ColladaConverter;
+
+
+// DDS and KTX constants, see TextureResource of the engine
+#define FOURCC( c0, c1, c2, c3 ) ((c0) | (c1<<8) | (c2<<16) | (c3<<24))
+
+#define DDSD_CAPS             0x00000001
+#define DDSD_HEIGHT           0x00000002
+#define DDSD_WIDTH            0x00000004
+#define DDSD_PITCH            0x00000008
+#define DDSD_PIXELFORMAT      0x00001000
+#define DDSD_MIPMAPCOUNT      0x00020000
+#define DDSD_LINEARSIZE       0x00080000
+
+#define DDPF_ALPHAPIXELS      0x00000001
+#define DDPF_FOURCC           0x00000004
+#define DDPF_RGB              0x00000040
+
+#define DDSCAPS_COMPLEX       0x00000008
+#define DDSCAPS_TEXTURE       0x00001000
+#define DDSCAPS_MIPMAP        0x00400000
+
+#define D3DFMT_A16B16G16R16F  113
+#define DXGI_FORMAT_BC7       98
+#define DXGI_FORMAT_BC7_SRGB  99
+
+#define GL_RGB                         0x1907
+#define GL_RGBA                        0x1908
+#define GL_COMPRESSED_RGB8_ETC2        0x9274
+#define GL_COMPRESSED_SRGB8_ETC2       0x9275
+#define GL_COMPRESSED_RGBA8_ETC2_EAC   0x9278
+#define GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC  0x9279
+
+static const unsigned char ktxIdentifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+
+struct Image
+{
+	int              width, height;
+	vector< float >  pixels;  // RGBA, color in linear space for sRGB images
+};
+
+struct FilterTap
+{
+	int    index;
+	float  weight;
+};
+
+
+static float srgbToLinear( float c )
+{
+	return c <= 0.04045f ? c / 12.92f : powf( (c + 0.055f) / 1.055f, 2.4f );
+}
+
+
+static float linearToSrgb( float c )
+{
+	return c <= 0.0031308f ? c * 12.92f : 1.055f * powf( c, 1.0f / 2.4f ) - 0.055f;
+}
+
+
+static uint16 floatToHalf( float value )
+{
+	uint32 bits;
+	memcpy( &bits, &value, 4 );
+
+	uint32 sign = (bits >> 16) & 0x8000;
+	uint32 mantissa = bits & 0x7fffff;
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+
+	if( ((bits >> 23) & 0xff) == 0xff ) return (uint16)(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+	if( exponent >= 31 ) return (uint16)(sign | 0x7c00);
+	if( exponent <= 0 )
+	{
+		// Denormalized half or zero
+		if( exponent < -10 ) return (uint16)sign;
+		return (uint16)(sign | ((mantissa | 0x800000) >> (14 - exponent)));
+	}
+
+	return (uint16)(sign | (exponent << 10) | (mantissa >> 13));
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// Mip generation
+// -------------------------------------------------------------------------------------------------
+
+static float bessel0( float x )
+{
+	// Series expansion of the modified Bessel function of the first kind
+	float sum = 1, term = 1, halfX = x * 0.5f;
+	for( int k = 1; k < 32 && term > sum * 1e-8f; ++k )
+	{
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+
+// Filter kernels in units of destination pixels
+static float getFilterRadius( MipFilters::List filter )
+{
+	return filter == MipFilters::Kaiser ? 3.0f : 0.5f;
+}
+
+
+static float evalFilter( MipFilters::List filter, float x )
+{
+	if( filter == MipFilters::Box ) return fabsf( x ) <= 0.5f ? 1.0f : 0.0f;
+
+	// Kaiser windowed sinc with alpha 4
+	const float radius = getFilterRadius( filter ), alpha = 4.0f;
+	float t = x / radius;
+	if( t * t >= 1.0f ) return 0;
+
+	float sinc = fabsf( x ) < 1e-5f ? 1.0f : sinf( Math::Pi * x ) / (Math::Pi * x);
+	return sinc * bessel0( alpha * sqrtf( 1.0f - t * t ) ) / bessel0( alpha );
+}
+
+
+static void calcFilterTaps( int srcSize, int destSize, MipFilters::List filter, bool wrap,
+                            vector< vector< FilterTap > > &taps )
+{
+	float scale = (float)srcSize / (float)destSize;
+	float radius = getFilterRadius( filter ) * scale;
+
+	taps.resize( destSize );
+	for( int i = 0; i < destSize; ++i )
+	{
+		float center = (i + 0.5f) * scale, weightSum = 0;
+		int first = (int)floorf( center - radius ), last = (int)ceilf( center + radius );
+
+		for( int j = first; j <= last; ++j )
+		{
+			float weight = evalFilter( filter, (j + 0.5f - center) / scale );
+			if( weight == 0 ) continue;
+
+			FilterTap tap;
+			tap.index = wrap ? ((j % srcSize) + srcSize) % srcSize : min( max( j, 0 ), srcSize - 1 );
+			tap.weight = weight;
+			taps[i].push_back( tap );
+			weightSum += weight;
+		}
+
+		if( taps[i].empty() || weightSum == 0 )
+		{
+			FilterTap tap = { min( (int)center, srcSize - 1 ), 1.0f };
+			taps[i].assign( 1, tap );
+		}
+		else
+		{
+			for( size_t j = 0; j < taps[i].size(); ++j ) taps[i][j].weight /= weightSum;
+		}
+	}
+}
+
+
+// Separable resampling, first horizontally and then vertically
+static void resampleImage( const Image &src, Image &dest, MipFilters::List filter, bool wrap )
+{
+	vector< vector< FilterTap > > tapsX, tapsY;
+	calcFilterTaps( src.width, dest.width, filter, wrap, tapsX );
+	calcFilterTaps( src.height, dest.height, filter, wrap, tapsY );
+
+	vector< float > temp( (size_t)dest.width * src.height * 4 );
+	parallelFor( (unsigned int)src.height, [&]( unsigned int y )
+	{
+		const float *srcRow = &src.pixels[(size_t)y * src.width * 4];
+		float *destRow = &temp[(size_t)y * dest.width * 4];
+		for( int x = 0; x < dest.width; ++x )
+		{
+			float color[4] = { 0, 0, 0, 0 };
+			for( size_t i = 0; i < tapsX[x].size(); ++i )
+			{
+				const float *pixel = &srcRow[tapsX[x][i].index * 4];
+				for( int c = 0; c < 4; ++c ) color[c] += pixel[c] * tapsX[x][i].weight;
+			}
+			memcpy( &destRow[x * 4], color, sizeof( color ) );
+		}
+	} );
+
+	dest.pixels.resize( (size_t)dest.width * dest.height * 4 );
+	parallelFor( (unsigned int)dest.height, [&]( unsigned int y )
+	{
+		float *destRow = &dest.pixels[(size_t)y * dest.width * 4];
+		memset( destRow, 0, dest.width * 4 * sizeof( float ) );
+		for( size_t i = 0; i < tapsY[y].size(); ++i )
+		{
+			const float *srcRow = &temp[(size_t)tapsY[y][i].index * dest.width * 4];
+			float weight = tapsY[y][i].weight;
+			for( int x = 0; x < dest.width * 4; ++x ) destRow[x] += srcRow[x] * weight;
+		}
+	} );
+}
+
+
+// -------------------------------------------------------------------------------------------------
+// Encoding
+// -------------------------------------------------------------------------------------------------
+
+static void convertToRGBA8( const Image &image, bool sRGB, vector< unsigned char > &dest )
+{
+	dest.resize( (size_t)image.width * image.height * 4 );
+	parallelFor( (unsigned int)image.height, [&]( unsigned int y )
+	{
+		size_t offset = (size_t)y * image.width * 4;
+		for( size_t i = offset; i < offset + (size_t)image.width * 4; ++i )
+		{
+			float v = clamp( image.pixels[i], 0.0f, 1.0f );
+			if( sRGB && (i & 3) != 3 ) v = linearToSrgb( v );
+			dest[i] = (unsigned char)(v * 255.0f + 0.5f);
+		}
+	} );
+}
+
+
+typedef void (*BlockEncoder)( const unsigned char *pixels, unsigned char *dest );
+
+static void encodeBlocks( const vector< unsigned char > &pixels, int width, int height, BlockEncoder encoder,
+                          size_t blockBytes, vector< unsigned char > &dest )
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t offset = dest.size();
+	dest.resize( offset + (size_t)blocksX * blocksY * blockBytes );
+	unsigned char *blocks = &dest[offset];
+
+	// Blocks are independent, rows of blocks are encoded in parallel
+	parallelFor( (unsigned int)blocksY, [&]( unsigned int by )
+	{
+		unsigned char block[64];
+		for( int bx = 0; bx < blocksX; ++bx )
+		{
+			// Border pixels are repeated for partial blocks
+			for( int y = 0; y < 4; ++y )
+			{
+				for( int x = 0; x < 4; ++x )
+				{
+					int sx = min( bx * 4 + x, width - 1 ), sy = min( (int)by * 4 + y, height - 1 );
+					memcpy( &block[(y * 4 + x) * 4], &pixels[((size_t)sy * width + sx) * 4], 4 );
+				}
+			}
+			encoder( block, blocks + ((size_t)by * blocksX + bx) * blockBytes );
+		}
+	} );
+}
+
+
+static bool writeFile( const string &fileName, const vector< uint32 > &header, const vector< unsigned char > &data )
+{
+	FILE *f = fopen( fileName.c_str(), "wb" );
+	if( f == 0x0 )
+	{
+		log( "Failed to write " + fileName + " file" );
+		return false;
+	}
+
+	vector< uint32 > words( header.size() );
+	elemcpy_le( words.data(), header.data(), words.size() );
+	fwrite( words.data(), 4, words.size(), f );
+	if( !data.empty() ) fwrite( data.data(), 1, data.size(), f );
+
+	bool result = ferror( f ) == 0;
+	fclose( f );
+
+	return result;
+}
+
+
+static bool writeDDS( const string &fileName, int width, int height, size_t numMips, OutputFormats::List format,
+                      bool hdr, bool sRGB, const vector< unsigned char > &data )
+{
+	bool compressed = !hdr && format != OutputFormats::BGRA8;
+
+	vector< uint32 > header( 32, 0 );
+	header[0] = FOURCC( 'D', 'D', 'S', ' ' );
+	header[1] = 124;
+	header[2] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT |
+	            (compressed ? DDSD_LINEARSIZE : DDSD_PITCH);
+	header[3] = height;
+	header[4] = width;
+	header[7] = (uint32)numMips;
+
+	// Pixel format
+	header[19] = 32;
+	if( hdr )
+	{
+		header[5] = width * 8;
+		header[20] = DDPF_FOURCC;
+		header[21] = D3DFMT_A16B16G16R16F;
+	}
+	else if( format == OutputFormats::BGRA8 )
+	{
+		header[5] = width * 4;
+		header[20] = DDPF_RGB | DDPF_ALPHAPIXELS;
+		header[22] = 32;
+		header[23] = 0x00ff0000; header[24] = 0x0000ff00; header[25] = 0x000000ff; header[26] = 0xff000000;
+	}
+	else
+	{
+		size_t blockBytes = format == OutputFormats::BC1 ? 8 : 16;
+		header[5] = (uint32)(((width + 3) / 4) * ((height + 3) / 4) * blockBytes);
+		header[20] = DDPF_FOURCC;
+		if( format == OutputFormats::BC1 ) header[21] = FOURCC( 'D', 'X', 'T', '1' );
+		else if( format == OutputFormats::BC3 ) header[21] = FOURCC( 'D', 'X', 'T', '5' );
+		else header[21] = FOURCC( 'D', 'X', '1', '0' );
+	}
+
+	header[27] = DDSCAPS_TEXTURE | (numMips > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+	if( header[21] == FOURCC( 'D', 'X', '1', '0' ) )
+	{
+		// DX10 header: format, 2D resource dimension, flags, array size and additional flags
+		header.push_back( sRGB ? DXGI_FORMAT_BC7_SRGB : DXGI_FORMAT_BC7 );
+		header.push_back( 3 );
+		header.push_back( 0 );
+		header.push_back( 1 );
+		header.push_back( 0 );
+	}
+
+	return writeFile( fileName, header, data );
+}
+
+
+static bool writeKTX( const string &fileName, int width, int height, const vector< size_t > &mipSizes,
+                      bool alpha, bool sRGB, const vector< unsigned char > &data )
+{
+	vector< uint32 > header( 16, 0 );
+	memcpy( header.data(), ktxIdentifier, 12 );
+	header[3] = 0x04030201;
+	header[5] = 1;
+	if( alpha ) header[7] = sRGB ? GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC : GL_COMPRESSED_RGBA8_ETC2_EAC;
+	else header[7] = sRGB ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2;
+	header[8] = alpha ? GL_RGBA : GL_RGB;
+	header[9] = width;
+	header[10] = height;
+	header[13] = 1;
+	header[14] = (uint32)mipSizes.size();
+
+	// Every mip level is preceded by its size; block sizes are multiples of 4, so no padding is needed
+	vector< unsigned char > levels;
+	levels.reserve( data.size() + mipSizes.size() * 4 );
+	size_t offset = 0;
+	for( size_t i = 0; i < mipSizes.size(); ++i )
+	{
+		uint32 size = (uint32)mipSizes[i];
+		unsigned char sizeBytes[4];
+		elemcpy_le( (uint32 *)sizeBytes, &size, 1 );
+		levels.insert( levels.end(), sizeBytes, sizeBytes + 4 );
+		levels.insert( levels.end(), data.begin() + offset, data.begin() + offset + mipSizes[i] );
+		offset += mipSizes[i];
+	}
+
+	return writeFile( fileName, header, levels );
+}
+
+
+string getCompiledTextureName( const string &sourceName, const TextureOptions &options )
+{
+	size_t extPos = sourceName.find_last_of( '.' );
+	size_t pathPos = sourceName.find_last_of( "\\/" );
+	string baseName = sourceName;
+	bool hdr = false;
+	if( extPos != string::npos && (pathPos == string::npos || extPos > pathPos) )
+	{
+		hdr = _stricmp( sourceName.c_str() + extPos, ".hdr" ) == 0;
+		baseName = sourceName.substr( 0, extPos );
+	}
+
+	return baseName + (options.format == OutputFormats::ETC2 && !hdr ? ".ktx" : ".dds");
+}
+
+
+bool compileTexture( const string &sourceFile, const string &destFile, const TextureOptions &options )
+{
+	vector< unsigned char > fileData;
+	FILE *f = fopen( sourceFile.c_str(), "rb" );
+	if( f != 0x0 )
+	{
+		fseek( f, 0, SEEK_END );
+		long size = ftell( f );
+		fseek( f, 0, SEEK_SET );
+		if( size > 0 )
+		{
+			fileData.resize( size );
+			if( fread( fileData.data(), 1, size, f ) != (size_t)size ) fileData.clear();
+		}
+		fclose( f );
+	}
+	if( fileData.empty() )
+	{
+		log( "Error: Failed to read image " + sourceFile );
+		return false;
+	}
+
+	// Load image as float RGBA, so that filtering happens with full precision
+	int width = 0, height = 0, comps = 0;
+	bool hdr = stbi_is_hdr_from_memory( fileData.data(), (int)fileData.size() ) > 0;
+	bool alpha = false;
+	Image image;
+
+	if( hdr )
+	{
+		float *pixels = stbi_loadf_from_memory( fileData.data(), (int)fileData.size(), &width, &height, &comps, 4 );
+		if( pixels != 0x0 ) image.pixels.assign( pixels, pixels + (size_t)width * height * 4 );
+		stbi_image_free( pixels );
+	}
+	else
+	{
+		unsigned char *pixels = stbi_load_from_memory( fileData.data(), (int)fileData.size(), &width, &height, &comps, 4 );
+		if( pixels != 0x0 )
+		{
+			float toLinear[256];
+			for( int i = 0; i < 256; ++i ) toLinear[i] = options.sRGB ? srgbToLinear( i / 255.0f ) : i / 255.0f;
+
+			image.pixels.resize( (size_t)width * height * 4 );
+			for( size_t i = 0; i < image.pixels.size(); ++i )
+			{
+				image.pixels[i] = (i & 3) == 3 ? pixels[i] / 255.0f : toLinear[pixels[i]];
+				if( (i & 3) == 3 && pixels[i] < 255 ) alpha = true;
+			}
+		}
+		stbi_image_free( pixels );
+	}
+
+	if( image.pixels.empty() )
+	{
+		log( "Error: Failed to load image " + sourceFile + " (" + stbi_failure_reason() + ")" );
+		return false;
+	}
+	image.width = width;
+	image.height = height;
+
+	OutputFormats::List format = options.format;
+	if( hdr && format != OutputFormats::Auto ) log( "HDR image is written as RGBA16F" );
+	if( format == OutputFormats::Auto ) format = alpha ? OutputFormats::BC3 : OutputFormats::BC1;
+
+	// Build mip chain down to 1x1
+	vector< Image > mips( 1 );
+	mips[0].width = width;
+	mips[0].height = height;
+	mips[0].pixels.swap( image.pixels );
+	while( options.mips && (mips.back().width > 1 || mips.back().height > 1) )
+	{
+		Image mip;
+		mip.width = max( mips.back().width / 2, 1 );
+		mip.height = max( mips.back().height / 2, 1 );
+		resampleImage( mips.back(), mip, options.mipFilter, options.wrap );
+		mips.push_back( mip );
+	}
+
+	// Encode all mip levels in the order the engine uploads them
+	vector< unsigned char > data;
+	vector< size_t > mipSizes;
+	vector< unsigned char > pixels;
+	for( size_t i = 0; i < mips.size(); ++i )
+	{
+		size_t offset = data.size();
+		const Image &mip = mips[i];
+
+		if( hdr )
+		{
+			data.resize( offset + mip.pixels.size() * 2 );
+			vector< uint16 > halfs( mip.pixels.size() );
+			for( size_t j = 0; j < mip.pixels.size(); ++j ) halfs[j] = floatToHalf( mip.pixels[j] );
+			elemcpy_le( (uint16 *)&data[offset], halfs.data(), halfs.size() );
+		}
+		else
+		{
+			convertToRGBA8( mip, options.sRGB, pixels );
+			switch( format )
+			{
+			case OutputFormats::BC1:
+				encodeBlocks( pixels, mip.width, mip.height, encodeBC1Block, 8, data );
+				break;
+			case OutputFormats::BC3:
+				encodeBlocks( pixels, mip.width, mip.height, encodeBC3Block, 16, data );
+				break;
+			case OutputFormats::BC7:
+				encodeBlocks( pixels, mip.width, mip.height, encodeBC7Block, 16, data );
+				break;
+			case OutputFormats::ETC2:
+				if( alpha ) encodeBlocks( pixels, mip.width, mip.height, encodeETC2EACBlock, 16, data );
+				else encodeBlocks( pixels, mip.width, mip.height, encodeETC2Block, 8, data );
+				break;
+			default:
+				data.resize( offset + pixels.size() );
+				for( size_t j = 0; j < pixels.size(); j += 4 )
+				{
+					data[offset + j + 0] = pixels[j + 2];
+					data[offset + j + 1] = pixels[j + 1];
+					data[offset + j + 2] = pixels[j + 0];
+					data[offset + j + 3] = pixels[j + 3];
+				}
+				break;
+			}
+		}
+		mipSizes.push_back( data.size() - offset );
+	}
+
+	if( format == OutputFormats::ETC2 && !hdr )
+		return writeKTX( destFile, width, height, mipSizes, alpha, options.sRGB, data );
+	else
+		return writeDDS( destFile, width, height, mips.size(), format, hdr, options.sRGB, data );
+}
+
+
+} // namespace TextureConverter
+} // namespace Horde3D
@@ -0,0 +1,70 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _textureCompiler_H_
+#define _textureCompiler_H_
+
+#include <string>
+
+namespace Horde3D {
+namespace TextureConverter {
+
+
+struct OutputFormats
+{
+	enum List
+	{
+		Auto = 0,  // BC1 for opaque images, BC3 for images with alpha
+		BC1,
+		BC3,
+		BC7,
+		ETC2,      // ETC2 RGB for opaque images, ETC2 with EAC alpha otherwise; written as KTX
+		BGRA8
+	};
+};
+
+struct MipFilters
+{
+	enum List
+	{
+		Box = 0,
+		Kaiser
+	};
+};
+
+
+struct TextureOptions
+{
+	OutputFormats::List  format;
+	MipFilters::List     mipFilter;
+	bool                 mips;
+	bool                 sRGB;  // Color data is filtered in linear space
+	bool                 wrap;  // Filter across image borders for tiling textures
+
+	TextureOptions() : format( OutputFormats::Auto ), mipFilter( MipFilters::Box ), mips( true ),
+		sRGB( false ), wrap( false ) {}
+};
+
+
+// Name of the DDS or KTX file that is written for a source image
+std::string getCompiledTextureName( const std::string &sourceName, const TextureOptions &options );
+
+// Loads a PNG, JPEG, TGA, BMP, PSD or HDR image, builds the mip chain and writes it in the GPU
+// format of the options, so that the engine can upload every mip level directly; HDR images are
+// written as RGBA16F
+bool compileTexture( const std::string &sourceFile, const std::string &destFile, const TextureOptions &options );
+
+
+} // namespace TextureConverter
+} // namespace Horde3D
+
+#endif // _textureCompiler_H_
@@ -0,0 +1,106 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures the time to load (and upload) static and skinned geometry from memory for the
+// geometry file versions written by ColladaConv
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include "Horde3D.h"
+#include <cstdio>
+#include <string>
+
+
+namespace {
+
+double measureLoad( const std::string &data, int iterations )
+{
+	H3DRes res = h3dAddResource( H3DResTypes::Geometry, "benchGeometry", 0 );
+
+	double t0 = Horde3DTest::getTimeMS();
+	for( int i = 0; i < iterations; ++i )
+	{
+		h3dUnloadResource( res );
+		H3D_CHECK( h3dLoadResource( res, data.data(), (int)data.size() ) );
+	}
+	double ms = (Horde3DTest::getTimeMS() - t0) / iterations;
+
+	h3dRemoveResource( res );
+	h3dReleaseUnusedResources();
+	return ms;
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: benchGeometryLoad <ColladaConv executable> [--quick]\n" );
+		return 1;
+	}
+	bool quick = Horde3DTest::quickMode( argc, argv );
+	int gridSize = quick ? 32 : 256;
+	int iterations = quick ? 2 : 20;
+	std::string converter = argv[1];
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/geometryLoad";
+
+	Horde3DTest::removeDirectory( dir );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/src" ) );
+
+	Horde3DTest::ColladaSample sample;
+	sample.gridSize = gridSize;
+	sample.build();
+	H3D_CHECK( sample.write( dir + "/src/static.dae" ) );
+	sample.jointCount = 4;
+	sample.weightsPerVertex = 4;
+	sample.build();
+	H3D_CHECK( sample.write( dir + "/src/skinned.dae" ) );
+
+	const char *versions[3][2] = { { "v5", "" }, { "v6", "-geoVersion 6" }, { "v6q", "-quantize" } };
+	for( int i = 0; i < 3; ++i )
+	{
+		std::string outDir = dir + "/" + versions[i][0];
+		H3D_CHECK( Horde3DTest::createDirectory( outDir ) );
+		H3D_CHECK( Horde3DTest::runColladaConv( converter, ". -base \"" + dir + "/src\" -dest \"" + outDir +
+			"\" " + versions[i][1] ) );
+	}
+
+	if( !Horde3DTest::initEngine() )
+	{
+		Horde3DTest::removeDirectory( dir );
+		return Horde3DTest::TestSkipped;
+	}
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+
+	printf( "Grid of %i x %i quads, %i iterations\n", gridSize, gridSize, iterations );
+	const char *assets[2] = { "static", "skinned" };
+	for( int i = 0; i < 2; ++i )
+	{
+		for( int j = 0; j < 3; ++j )
+		{
+			std::string data;
+			if( !H3D_CHECK( Horde3DTest::readFile( dir + "/" + versions[j][0] + "/" + assets[i] + ".geo", data ) ) )
+				continue;
+
+			measureLoad( data, 1 );  // Warm up
+			double ms = measureLoad( data, iterations );
+			printf( "%-8s %-4s %8.1f KB %8.3f ms %8.1f MB/s\n", assets[i], versions[j][0],
+			        data.size() / 1024.0, ms, data.size() / (ms * 1000.0) );
+		}
+	}
+
+	Horde3DTest::releaseEngine();
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "benchGeometryLoad" );
+}
@@ -0,0 +1,156 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Compares the work-stealing JobManager with the previous dispatch strategies: running everything
+// serially on the calling thread (as the engine did before) and spawning one thread per worker and
+// parallel region (as the converter does).
+
+#include "testCommon.h"
+#include "egJobs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace Horde3D;
+
+
+namespace {
+
+typedef std::function< void( uint32, uint32 ) > RangeFunc;
+
+void serialFor( uint32 count, const RangeFunc &func )
+{
+	func( 0, count );
+}
+
+
+void spawnFor( uint32 count, uint32 threadCount, const RangeFunc &func )
+{
+	std::vector< std::thread > threads;
+	uint32 chunk = (count + threadCount - 1) / threadCount;
+	for( uint32 i = 0; i < threadCount; ++i )
+	{
+		uint32 begin = i * chunk, end = std::min( begin + chunk, count );
+		if( begin >= end ) break;
+		threads.push_back( std::thread( func, begin, end ) );
+	}
+	for( size_t i = 0; i < threads.size(); ++i ) threads[i].join();
+}
+
+
+// Workload resembling frustum culling: per-item cost varies strongly between items
+float itemCost( uint32 item, uint32 skew )
+{
+	uint32 iterations = 8 + ((item * 2654435761u) >> 24) % skew;
+	float v = (float)item;
+	for( uint32 i = 0; i < iterations; ++i ) v = std::sqrt( v * 1.0001f + 1.0f );
+	return v;
+}
+
+
+struct Result
+{
+	double  ms;
+	double  checksum;
+};
+
+template< typename ForFunc > Result runRegions( uint32 regions, uint32 items, uint32 skew, ForFunc forFunc )
+{
+	std::vector< float > out( items );
+	RangeFunc body = [&out, skew]( uint32 begin, uint32 end ) {
+		for( uint32 i = begin; i < end; ++i ) out[i] = itemCost( i, skew );
+	};
+
+	Result r = { 0, 0 };
+	double t0 = Horde3DTest::getTimeMS();
+	for( uint32 i = 0; i < regions; ++i ) forFunc( items, body );
+	r.ms = (Horde3DTest::getTimeMS() - t0) / regions;
+	for( uint32 i = 0; i < items; ++i ) r.checksum += out[i];
+	return r;
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	bool quick = Horde3DTest::quickMode( argc, argv );
+	uint32 hwThreads = std::max( std::thread::hardware_concurrency(), 1u );
+	uint32 regions = quick ? 4 : 200;
+
+	JobManager jobs;
+	jobs.setWorkerCount( -1 );
+	printf( "Hardware threads: %u, job workers: %i\n\n", hwThreads, jobs.getWorkerCount() );
+
+	// Parallel regions of different size, repeated like per-frame work
+	const uint32 sizes[] = { 256, 4096, 65536 };
+	const uint32 skews[] = { 1, 256 };
+	printf( "%-8s %-6s %12s %12s %12s\n", "items", "skew", "serial ms", "spawn ms", "jobs ms" );
+	for( uint32 s = 0; s < sizeof( sizes ) / sizeof( sizes[0] ); ++s )
+	{
+		for( uint32 k = 0; k < sizeof( skews ) / sizeof( skews[0] ); ++k )
+		{
+			uint32 items = sizes[s], skew = skews[k];
+			Result serial = runRegions( regions, items, skew, []( uint32 count, const RangeFunc &f ) {
+				serialFor( count, f ); } );
+			Result spawn = runRegions( regions, items, skew, [hwThreads]( uint32 count, const RangeFunc &f ) {
+				spawnFor( count, hwThreads, f ); } );
+			Result pooled = runRegions( regions, items, skew, [&jobs]( uint32 count, const RangeFunc &f ) {
+				jobs.parallelFor( count, 64, f ); } );
+
+			H3D_CHECK( serial.checksum == spawn.checksum );
+			H3D_CHECK( serial.checksum == pooled.checksum );
+			printf( "%-8u %-6u %12.4f %12.4f %12.4f\n", items, skew, serial.ms, spawn.ms, pooled.ms );
+		}
+	}
+
+	// Overhead of many tiny jobs attached to one parent
+	uint32 jobCount = quick ? 1000 : 100000;
+	std::atomic< uint32 > counter( 0 );
+	double t0 = Horde3DTest::getTimeMS();
+	JobHandle root = jobs.createJob( []() {} );
+	for( uint32 i = 0; i < jobCount; ++i )
+	{
+		JobHandle job = jobs.createJob( [&counter]() { counter.fetch_add( 1, std::memory_order_relaxed ); }, root );
+		jobs.submit( job );
+		jobs.release( job );
+	}
+	jobs.submit( root );
+	jobs.wait( root );
+	double jobNs = (Horde3DTest::getTimeMS() - t0) * 1e6 / jobCount;
+	H3D_CHECK( counter.load() == jobCount );
+	printf( "\nTiny jobs: %u, %.1f ns per job\n", jobCount, jobNs );
+
+	// Dependency chain: each job waits for the previous one
+	uint32 chainLength = quick ? 100 : 10000;
+	std::vector< JobHandle > chain( chainLength );
+	std::vector< uint32 > order;
+	order.reserve( chainLength );
+	t0 = Horde3DTest::getTimeMS();
+	for( uint32 i = 0; i < chainLength; ++i )
+	{
+		chain[i] = jobs.createJob( [&order, i]() { order.push_back( i ); } );
+		if( i > 0 ) jobs.addDependency( chain[i], chain[i - 1] );
+	}
+	for( uint32 i = chainLength; i-- > 0; ) jobs.submit( chain[i] );
+	jobs.wait( chain[chainLength - 1] );
+	double chainNs = (Horde3DTest::getTimeMS() - t0) * 1e6 / chainLength;
+	for( uint32 i = 0; i < chainLength - 1; ++i ) jobs.release( chain[i] );
+	bool ordered = order.size() == chainLength;
+	for( uint32 i = 0; ordered && i < chainLength; ++i ) ordered = order[i] == i;
+	H3D_CHECK( ordered );
+	printf( "Dependency chain: %u, %.1f ns per job\n", chainLength, chainNs );
+
+	return Horde3DTest::finish( "benchJobs" );
+}
@@ -0,0 +1,177 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures material switches between materials that share a shader with different flags. The
+// lookup of the shader combination by linear searches for the context name and combination mask,
+// as done before, is compared with the lookup by context id and hash index. Full setMaterial calls,
+// which use the combination cached in the material, are measured with the context id and with the
+// context name that existing extensions still pass.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "egModules.h"
+#include "egMaterial.h"
+#include "egRenderer.h"
+#include "egShader.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace Horde3D;
+
+
+namespace {
+
+const char *ShaderFlags[5] = { "_F01_Skinning", "_F02_NormalMapping", "_F03_ParallaxMapping",
+                               "_F04_EnvMapping", "_F05_AlphaTest" };
+
+struct MaterialEntry
+{
+	MaterialResource  *material;
+	ShaderResource    *shader;
+	uint32            combMask;
+};
+
+
+// Previous lookup: linear search for the context name and the combination mask
+ShaderCombination *findLinear( ShaderResource *shader, const std::string &contextName, uint32 combMask )
+{
+	std::vector< ShaderContext > &contexts = shader->getContexts();
+	for( size_t i = 0; i < contexts.size(); ++i )
+	{
+		if( contexts[i].id != contextName ) continue;
+
+		for( size_t j = 0; j < contexts[i].shaderCombs.size(); ++j )
+		{
+			if( contexts[i].shaderCombs[j].combMask == combMask ) return &contexts[i].shaderCombs[j];
+		}
+		return 0x0;
+	}
+	return 0x0;
+}
+
+
+ShaderCombination *findById( ShaderResource *shader, int contextId, uint32 combMask )
+{
+	ShaderContext *context = shader->findContext( contextId );
+	return context != 0x0 ? shader->findCombination( *context, combMask ) : 0x0;
+}
+
+
+template< typename Func > double measureNs( uint32 switches, Func func )
+{
+	func( 1000u );  // Warm up
+	double t0 = Horde3DTest::getTimeMS();
+	func( switches );
+	return (Horde3DTest::getTimeMS() - t0) * 1e6 / switches;
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	bool quick = Horde3DTest::quickMode( argc, argv );
+	uint32 switches = quick ? 10000 : 2000000;
+
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+
+	// One material for every combination of the model shader flags
+	const int materialCount = 1 << 5;
+	std::vector< H3DRes > matHandles;
+	for( int i = 0; i < materialCount; ++i )
+	{
+		std::string xml = "<Material>\n\t<Shader source=\"shaders/model.shader\"/>\n";
+		for( int j = 0; j < 5; ++j )
+		{
+			if( i & (1 << j) ) xml += std::string( "\t<ShaderFlag name=\"" ) + ShaderFlags[j] + "\"/>\n";
+		}
+		xml += "</Material>\n";
+
+		std::string name = "benchMaterial" + std::to_string( i ) + ".material.xml";
+		H3DRes res = h3dAddResource( H3DResTypes::Material, name.c_str(), 0 );
+		h3dLoadResource( res, xml.c_str(), (int)xml.size() );
+		matHandles.push_back( res );
+	}
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+
+	const std::string contextName = "LIGHTING";
+	const int contextId = ShaderResource::getContextId( contextName );
+	std::vector< MaterialEntry > materials;
+	for( int i = 0; i < materialCount; ++i )
+	{
+		MaterialEntry entry;
+		entry.material = (MaterialResource *)Modules::resMan().resolveResHandle( matHandles[i] );
+		entry.shader = (ShaderResource *)Modules::resMan().resolveResHandle(
+			h3dGetResParamI( matHandles[i], H3DMatRes::MaterialElem, 0, H3DMatRes::MatShaderI ) );
+		entry.combMask = 0;
+
+		if( !H3D_CHECK( entry.material != 0x0 && entry.shader != 0x0 ) ) return Horde3DTest::finish( "benchMaterialSwitch" );
+		materials.push_back( entry );
+	}
+
+	// All lookups must find the combination that setMaterial selects; the combination mask only
+	// contains the flags that are used by the code of the context
+	Renderer &renderer = Modules::renderer();
+	int mismatches = 0;
+	for( int i = 0; i < materialCount; ++i )
+	{
+		MaterialEntry &m = materials[i];
+		if( !renderer.setMaterial( m.material, contextId ) || renderer.getCurShader() == 0x0 )
+		{
+			++mismatches;
+			continue;
+		}
+		m.combMask = renderer.getCurShader()->combMask;
+		if( findLinear( m.shader, contextName, m.combMask ) != renderer.getCurShader() ||
+		    findById( m.shader, contextId, m.combMask ) != renderer.getCurShader() )
+		{
+			++mismatches;
+		}
+	}
+	H3D_CHECK( mismatches == 0 );
+
+	// Switch to a different material each time, so that no state is shared between switches
+	volatile uintptr_t sink = 0;
+	double linearNs = measureNs( switches, [&]( uint32 count ) {
+		for( uint32 i = 0; i < count; ++i )
+		{
+			const MaterialEntry &m = materials[(i * 7) % materialCount];
+			sink = sink + (uintptr_t)findLinear( m.shader, contextName, m.combMask );
+		}
+	} );
+	double idNs = measureNs( switches, [&]( uint32 count ) {
+		for( uint32 i = 0; i < count; ++i )
+		{
+			const MaterialEntry &m = materials[(i * 7) % materialCount];
+			sink = sink + (uintptr_t)findById( m.shader, contextId, m.combMask );
+		}
+	} );
+	double setByIdNs = measureNs( switches, [&]( uint32 count ) {
+		for( uint32 i = 0; i < count; ++i ) renderer.setMaterial( materials[(i * 7) % materialCount].material, contextId );
+	} );
+	double setByNameNs = measureNs( switches, [&]( uint32 count ) {
+		for( uint32 i = 0; i < count; ++i ) renderer.setMaterial( materials[(i * 7) % materialCount].material, contextName );
+	} );
+	renderer.setMaterial( 0x0, contextId );
+
+	printf( "%i materials sharing one shader, %u switches\n", materialCount, switches );
+	printf( "%-40s %10.1f ns\n", "Lookup by name, linear search", linearNs );
+	printf( "%-40s %10.1f ns\n", "Lookup by context id and hash index", idNs );
+	printf( "%-40s %10.1f ns\n", "setMaterial with context id", setByIdNs );
+	printf( "%-40s %10.1f ns\n", "setMaterial with context name", setByNameNs );
+
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "benchMaterialSwitch" );
+}
@@ -0,0 +1,144 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures the time to load the sample content from the content directory and from a pack file.
+// Cold loads start with a new engine after the files were dropped from the page cache (where the
+// system supports it), warm loads reload all resources with the files in the page cache.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <ftw.h>
+#include <unistd.h>
+
+
+namespace {
+
+struct SampleResource
+{
+	int         type;
+	const char  *name;
+};
+
+const SampleResource SampleResources[] = {
+	{ H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml" },
+	{ H3DResTypes::SceneGraph, "models/knight/knight.scene.xml" },
+	{ H3DResTypes::SceneGraph, "models/man/man.scene.xml" },
+	{ H3DResTypes::SceneGraph, "models/platform/platform.scene.xml" },
+	{ H3DResTypes::SceneGraph, "models/skybox/skybox.scene.xml" },
+	{ H3DResTypes::SceneGraph, "models/sphere/sphere.scene.xml" },
+	{ H3DResTypes::SceneGraph, "particles/particleSys1/particleSys1.scene.xml" },
+	{ H3DResTypes::Animation, "animations/knight_order.anim" },
+	{ H3DResTypes::Animation, "animations/knight_attack.anim" },
+	{ H3DResTypes::Animation, "animations/man.anim" }
+};
+
+
+int dropFromPageCache( const char *path, const struct stat *, int type, struct FTW * )
+{
+#ifdef POSIX_FADV_DONTNEED
+	if( type == FTW_F )
+	{
+		int file = open( path, O_RDONLY );
+		if( file >= 0 )
+		{
+			posix_fadvise( file, 0, 0, POSIX_FADV_DONTNEED );
+			close( file );
+		}
+	}
+#else
+	(void)path; (void)type;
+#endif
+	return 0;
+}
+
+
+void addSampleResources()
+{
+	for( size_t i = 0; i < sizeof( SampleResources ) / sizeof( SampleResource ); ++i )
+		h3dAddResource( SampleResources[i].type, SampleResources[i].name, 0 );
+}
+
+
+double loadSampleResources()
+{
+	double t0 = Horde3DTest::getTimeMS();
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+	return Horde3DTest::getTimeMS() - t0;
+}
+
+
+bool measureLoads( const std::string &packName, int warmIterations, double &coldMS, double &warmMS )
+{
+	nftw( Horde3DTest::contentDir(), dropFromPageCache, 16, FTW_PHYS );
+	if( !packName.empty() ) dropFromPageCache( packName.c_str(), 0x0, FTW_F, 0x0 );
+
+	if( !Horde3DTest::initEngine() ) return false;
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+
+	// Mounting is part of a cold load
+	double t0 = Horde3DTest::getTimeMS();
+	if( !packName.empty() ) H3D_CHECK( h3dutMountPackFile( packName.c_str() ) );
+	addSampleResources();
+	coldMS = Horde3DTest::getTimeMS() - t0 + loadSampleResources();
+
+	warmMS = 0;
+	for( int i = 0; i < warmIterations; ++i )
+	{
+		H3DRes res = 0;
+		while( (res = h3dGetNextResource( H3DResTypes::Undefined, res )) != 0 )
+		{
+			if( h3dGetResName( res )[0] != '$' ) h3dUnloadResource( res );  // Keep engine defaults
+		}
+		warmMS += loadSampleResources();
+	}
+	warmMS /= warmIterations;
+
+	if( !packName.empty() ) h3dutUnmountPackFile( packName.c_str() );
+	Horde3DTest::releaseEngine();
+	return true;
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	bool quick = Horde3DTest::quickMode( argc, argv );
+	int warmIterations = quick ? 1 : 10;
+
+	std::string packName = std::string( Horde3DTest::tempDir() ) + "/sampleContent.h3dpack";
+	if( !H3D_CHECK( h3dutCreatePackFile( Horde3DTest::contentDir(), packName.c_str() ) ) )
+		return Horde3DTest::finish( "benchPackLoad" );
+
+	double dirCold, dirWarm, packCold, packWarm;
+	if( !measureLoads( "", warmIterations, dirCold, dirWarm ) )
+	{
+		remove( packName.c_str() );
+		return Horde3DTest::TestSkipped;
+	}
+	measureLoads( packName, warmIterations, packCold, packWarm );
+	remove( packName.c_str() );
+
+#ifndef POSIX_FADV_DONTNEED
+	printf( "Files can't be dropped from the page cache on this system, cold loads are warm\n" );
+#endif
+	printf( "%-10s %12s %12s\n", "source", "cold ms", "warm ms" );
+	printf( "%-10s %12.2f %12.2f\n", "directory", dirCold, dirWarm );
+	printf( "%-10s %12.2f %12.2f\n", "pack", packCold, packWarm );
+
+	return Horde3DTest::finish( "benchPackLoad" );
+}
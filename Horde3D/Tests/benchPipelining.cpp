@@ -0,0 +1,155 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures frame times with and without pipelined rendering. Each frame the application animates a
+// crowd of skinned knights, changes a terrain and spends a fixed time on simulated game logic, which
+// overlaps with rendering of the previous frame when pipelining is enabled.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "Horde3DTerrain.h"
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+
+namespace {
+
+const int ImageSize = 256;
+
+struct Scene
+{
+	H3DNode                 camera;
+	H3DNode                 terrain;
+	H3DRes                  heightMap;
+	H3DRes                  outputTex;
+	std::vector< H3DNode >  knights;
+};
+
+void simulateGameLogic( double ms )
+{
+	double end = Horde3DTest::getTimeMS() + ms;
+	volatile float v = 1.0f;
+	while( Horde3DTest::getTimeMS() < end ) v = sqrtf( v + 1.0f );
+}
+
+
+double runFrames( Scene &scene, int frameCount, double logicMS )
+{
+	double t0 = Horde3DTest::getTimeMS();
+	for( int frame = 0; frame < frameCount; ++frame )
+	{
+		for( size_t i = 0; i < scene.knights.size(); ++i )
+		{
+			h3dSetModelAnimParams( scene.knights[i], 0, (float)(frame + i), 1.0f );
+			h3dUpdateModel( scene.knights[i], H3DModelUpdateFlags::Animation | H3DModelUpdateFlags::Geometry );
+		}
+		h3dSetNodeParamF( scene.terrain, H3DEXTTerrain::MeshQualityF, 0, 40.0f + (frame % 8) );
+		simulateGameLogic( logicMS );
+
+		h3dRender( scene.camera );
+		h3dFinalizeFrame();
+	}
+
+	// Read back the last frame so that both modes measure the same work
+	h3dMapResStream( scene.outputTex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, true, false );
+	h3dUnmapResStream( scene.outputTex );
+	return (Horde3DTest::getTimeMS() - t0) / frameCount;
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	bool quick = Horde3DTest::quickMode( argc, argv );
+	int frameCount = quick ? 5 : 200;
+	int knightCount = quick ? 4 : 32;
+	const double logicMS = 2.0;
+
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+
+	Scene scene;
+	H3DRes pipeline = h3dAddResource( H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml", 0 );
+	H3DRes knightRes = h3dAddResource( H3DResTypes::SceneGraph, "models/knight/knight.scene.xml", 0 );
+	H3DRes animRes = h3dAddResource( H3DResTypes::Animation, "animations/knight_order.anim", 0 );
+	H3DRes lightMat = h3dAddResource( H3DResTypes::Material, "materials/light.material.xml", 0 );
+
+	scene.heightMap = h3dCreateTexture( "benchHeightMap", 128, 128, H3DFormats::TEX_BGRA8, H3DResFlags::NoTexMipmaps );
+	unsigned char *pixels = (unsigned char *)h3dMapResStream(
+		scene.heightMap, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, false, true );
+	for( int i = 0; i < 128 * 128; ++i )
+	{
+		pixels[i * 4 + 0] = 0; pixels[i * 4 + 1] = 0;
+		pixels[i * 4 + 2] = (unsigned char)(128 + 100 * sinf( (i % 128) * 0.1f ) * cosf( (i / 128) * 0.1f ));
+		pixels[i * 4 + 3] = 255;
+	}
+	h3dUnmapResStream( scene.heightMap );
+
+	const char *matXml =
+		"<Material>\n"
+		"	<Shader source=\"shaders/terrain.shader\"/>\n"
+		"	<Sampler name=\"heightNormMap\" map=\"benchHeightMap\" />\n"
+		"	<Sampler name=\"detailMap\" map=\"benchHeightMap\" />\n"
+		"	<Uniform name=\"sunDir\" a=\"1.0\" b=\"-1.0\" c=\"0.0\" />\n"
+		"</Material>\n";
+	H3DRes terrainMat = h3dAddResource( H3DResTypes::Material, "benchTerrain.material.xml", 0 );
+	h3dLoadResource( terrainMat, matXml, (int)strlen( matXml ) );
+
+	if( !H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "benchPipelining" );
+	}
+
+	scene.outputTex = h3dCreateTexture( "benchOutput", ImageSize, ImageSize, H3DFormats::TEX_BGRA8,
+	                                    H3DResFlags::TexRenderable | H3DResFlags::NoTexMipmaps );
+	scene.camera = h3dAddCameraNode( H3DRootNode, "Camera", pipeline );
+	h3dSetNodeParamI( scene.camera, H3DCamera::ViewportWidthI, ImageSize );
+	h3dSetNodeParamI( scene.camera, H3DCamera::ViewportHeightI, ImageSize );
+	h3dSetNodeParamI( scene.camera, H3DCamera::OutTexResI, scene.outputTex );
+	h3dSetupCameraView( scene.camera, 60.0f, 1.0f, 0.5f, 500.0f );
+	h3dSetNodeTransform( scene.camera, 0, 20, 30, -30, 0, 0, 1, 1, 1 );
+	h3dResizePipelineBuffers( pipeline, ImageSize, ImageSize );
+
+	scene.terrain = h3dextAddTerrainNode( H3DRootNode, "Terrain", scene.heightMap, terrainMat );
+	h3dSetNodeTransform( scene.terrain, -50, -5, -50, 0, 0, 0, 100, 10, 100 );
+
+	for( int i = 0; i < knightCount; ++i )
+	{
+		H3DNode knight = h3dAddNodes( H3DRootNode, knightRes );
+		h3dSetNodeTransform( knight, (float)(i % 8) * 3 - 12, 0, -(float)(i / 8) * 3, 0, 0, 0, 0.1f, 0.1f, 0.1f );
+		h3dSetupModelAnimStage( knight, 0, animRes, 0, "", false );
+		scene.knights.push_back( knight );
+	}
+
+	H3DNode light = h3dAddLightNode( H3DRootNode, "Light", lightMat, "LIGHTING", "SHADOWMAP" );
+	h3dSetNodeTransform( light, 0, 30, 20, -60, 0, 0, 1, 1, 1 );
+	h3dSetNodeParamF( light, H3DLight::RadiusF, 0, 100.0f );
+
+	runFrames( scene, 2, logicMS );  // Warm up
+	double serialMS = runFrames( scene, frameCount, logicMS );
+
+	H3D_CHECK( Horde3DTest::enablePipelinedRendering( true ) );
+	runFrames( scene, 2, logicMS );
+	double pipelinedMS = runFrames( scene, frameCount, logicMS );
+	Horde3DTest::enablePipelinedRendering( false );
+
+	printf( "Knights: %i, frames: %i, game logic: %.1f ms per frame\n", knightCount, frameCount, logicMS );
+	printf( "Serial:    %8.3f ms per frame\n", serialMS );
+	printf( "Pipelined: %8.3f ms per frame (%.2fx)\n", pipelinedMS, serialMS / pipelinedMS );
+
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "benchPipelining" );
+}
@@ -0,0 +1,213 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures the throughput of the pixel conversions used by texture loading and terrain height
+// decoding in GB/s of source data and compares the results with the scalar loops they replaced
+
+#include "testCommon.h"
+#include "utPixel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+using namespace Horde3D;
+
+
+namespace {
+
+// Scalar reference conversions as done per pixel before
+
+void refPixels32( const unsigned char *src, unsigned char *dest, size_t pixelCount, bool swapRB, bool opaque )
+{
+	for( size_t i = 0; i < pixelCount; ++i )
+	{
+		unsigned char r = src[i * 4 + 0], g = src[i * 4 + 1], b = src[i * 4 + 2], a = src[i * 4 + 3];
+		dest[i * 4 + 0] = swapRB ? b : r;
+		dest[i * 4 + 1] = g;
+		dest[i * 4 + 2] = swapRB ? r : b;
+		dest[i * 4 + 3] = opaque ? 255 : a;
+	}
+}
+
+
+void refPixels24To32( const unsigned char *src, unsigned char *dest, size_t pixelCount, bool swapRB )
+{
+	for( size_t i = 0; i < pixelCount; ++i )
+	{
+		dest[i * 4 + 0] = src[i * 3 + (swapRB ? 2 : 0)];
+		dest[i * 4 + 1] = src[i * 3 + 1];
+		dest[i * 4 + 2] = src[i * 3 + (swapRB ? 0 : 2)];
+		dest[i * 4 + 3] = 255;
+	}
+}
+
+
+void refPixels16( const unsigned char *src, uint16 *dest, size_t pixelCount, int hiChannel, int loChannel )
+{
+	for( size_t i = 0; i < pixelCount; ++i )
+		dest[i] = (uint16)(src[i * 4 + hiChannel] * 256 + src[i * 4 + loChannel]);
+}
+
+
+uint16 refHalf( float value )
+{
+	uint32 bits;
+	memcpy( &bits, &value, 4 );
+	uint16 sign = (uint16)((bits >> 16) & 0x8000);
+	if( std::isnan( value ) ) return sign | 0x7e00;
+
+	// Scaled values are exact in double precision, so nearbyint rounds to nearest even
+	double absValue = std::fabs( (double)value );
+	if( absValue >= 65520.0 ) return sign | 0x7c00;  // Rounds to infinity
+	if( absValue < std::ldexp( 1.0, -14 ) ) return sign | (uint16)std::nearbyint( absValue * std::ldexp( 1.0, 24 ) );
+
+	int exponent;
+	double mantissa = std::frexp( absValue, &exponent ) * 2048.0;  // [1024, 2048)
+	uint32 rounded = (uint32)std::nearbyint( mantissa );
+	if( rounded == 2048 ) { rounded = 1024; ++exponent; }
+	return sign | (uint16)(((exponent + 14) << 10) | (rounded - 1024));
+}
+
+
+void refFloatToHalf( const float *src, uint16 *dest, size_t count )
+{
+	for( size_t i = 0; i < count; ++i ) dest[i] = refHalf( src[i] );
+}
+
+
+// Returns GB/s of source data of the fastest of five batches
+double measure( size_t srcSize, int iterations, const std::function< void() > &func )
+{
+	func();  // Warm up
+	double bestMS = 1e30;
+	for( int batch = 0; batch < 5; ++batch )
+	{
+		double t0 = Horde3DTest::getTimeMS();
+		for( int i = 0; i < iterations; ++i ) func();
+		bestMS = std::min( bestMS, (Horde3DTest::getTimeMS() - t0) / iterations );
+	}
+	return srcSize / (bestMS * 1e6);
+}
+
+
+void report( const char *name, double simd, double scalar )
+{
+	printf( "%-26s %8.2f GB/s %8.2f GB/s %6.1fx\n", name, simd, scalar, simd / scalar );
+}
+
+void benchmark( size_t pixelCount, int iterations )
+{
+	std::mt19937 rng( 42 );
+	std::vector< unsigned char > src( pixelCount * 4 );
+	for( size_t i = 0; i < src.size(); ++i ) src[i] = (unsigned char)rng();
+	std::vector< unsigned char > dest( pixelCount * 4 ), ref( pixelCount * 4 );
+
+	printf( "\n%zu pixels, %i iterations\n", pixelCount, iterations );
+	printf( "%-26s %13s %13s %7s\n", "conversion", "utPixel", "scalar", "speedup" );
+
+	// 32 bit swizzles into a separate buffer and in place
+	const char *names32[3] = { "RGBA -> BGRA", "BGRX -> BGRA", "RGBX -> BGRA" };
+	const bool swaps[3] = { true, false, true }, opaques[3] = { false, true, true };
+	for( int i = 0; i < 3; ++i )
+	{
+		convertPixels32( &src[0], &dest[0], pixelCount, swaps[i], opaques[i] );
+		refPixels32( &src[0], &ref[0], pixelCount, swaps[i], opaques[i] );
+		H3D_CHECK( dest == ref );
+
+		double simd = measure( src.size(), iterations,
+			[&]() { convertPixels32( &src[0], &dest[0], pixelCount, swaps[i], opaques[i] ); } );
+		double scalar = measure( src.size(), iterations,
+			[&]() { refPixels32( &src[0], &ref[0], pixelCount, swaps[i], opaques[i] ); } );
+		report( names32[i], simd, scalar );
+	}
+
+	dest = src;
+	convertPixels32( &dest[0], &dest[0], pixelCount, true, false );
+	refPixels32( &src[0], &ref[0], pixelCount, true, false );
+	H3D_CHECK( dest == ref );
+	double simdInPlace = measure( src.size(), iterations,
+		[&]() { convertPixels32( &dest[0], &dest[0], pixelCount, true, false ); } );
+	double scalarInPlace = measure( src.size(), iterations,
+		[&]() { refPixels32( &ref[0], &ref[0], pixelCount, true, false ); } );
+	report( "RGBA -> BGRA in place", simdInPlace, scalarInPlace );
+
+	// 24 to 32 bit expansion
+	const size_t srcSize24 = pixelCount * 3;
+	for( int i = 0; i < 2; ++i )
+	{
+		bool swapRB = i == 0;
+		convertPixels24To32( &src[0], &dest[0], pixelCount, swapRB );
+		refPixels24To32( &src[0], &ref[0], pixelCount, swapRB );
+		H3D_CHECK( dest == ref );
+
+		double simd = measure( srcSize24, iterations, [&]() { convertPixels24To32( &src[0], &dest[0], pixelCount, swapRB ); } );
+		double scalar = measure( srcSize24, iterations, [&]() { refPixels24To32( &src[0], &ref[0], pixelCount, swapRB ); } );
+		report( swapRB ? "RGB -> BGRA" : "BGR -> BGRA", simd, scalar );
+	}
+
+	// 16 bit heights as decoded by the terrain
+	std::vector< uint16 > heights( pixelCount ), refHeights( pixelCount );
+	decodePixels16( &src[0], &heights[0], pixelCount, 2, 1 );
+	refPixels16( &src[0], &refHeights[0], pixelCount, 2, 1 );
+	H3D_CHECK( heights == refHeights );
+	report( "16 bit heights",
+		measure( src.size(), iterations, [&]() { decodePixels16( &src[0], &heights[0], pixelCount, 2, 1 ); } ),
+		measure( src.size(), iterations, [&]() { refPixels16( &src[0], &refHeights[0], pixelCount, 2, 1 ); } ) );
+
+	// Float to half with values over the whole half range, including denormals and special values
+	const size_t floatCount = pixelCount * 4;
+	std::vector< float > floats( floatCount );
+	std::uniform_real_distribution< float > mantissa( -1.0f, 1.0f );
+	std::uniform_int_distribution< int > exponent( -26, 18 );
+	for( size_t i = 0; i < floatCount; ++i ) floats[i] = std::ldexp( mantissa( rng ), exponent( rng ) );
+	const float specials[] = { 0.0f, -0.0f, INFINITY, -INFINITY, NAN, 65504.0f, 65520.0f, 65519.0f,
+	                           6.1035156e-05f, 5.9604645e-08f, 2.9802322e-08f, 2.9802326e-08f, 1.0009766f, 1.0004883f };
+	for( size_t i = 0; i < sizeof( specials ) / sizeof( float ); ++i ) floats[i] = specials[i];
+
+	std::vector< uint16 > halfs( floatCount ), refHalfs( floatCount );
+	convertFloatToHalf( &floats[0], &halfs[0], floatCount );
+	refFloatToHalf( &floats[0], &refHalfs[0], floatCount );
+	H3D_CHECK( halfs == refHalfs );
+
+	std::vector< float > inPlace = floats;
+	convertFloatToHalf( &inPlace[0], (uint16 *)&inPlace[0], floatCount );
+	H3D_CHECK( memcmp( &inPlace[0], &refHalfs[0], floatCount * sizeof( uint16 ) ) == 0 );
+
+	report( "float -> half",
+		measure( floatCount * sizeof( float ), iterations, [&]() { convertFloatToHalf( &floats[0], &halfs[0], floatCount ); } ),
+		measure( floatCount * sizeof( float ), iterations, [&]() { refFloatToHalf( &floats[0], &refHalfs[0], floatCount ); } ) );
+
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	// Images that fit into the L2 cache show the cost of the conversions, larger images are limited
+	// by memory bandwidth; the odd count in quick mode covers the tails
+	if( Horde3DTest::quickMode( argc, argv ) )
+	{
+		benchmark( 64 * 64 + 7, 1 );
+	}
+	else
+	{
+		benchmark( 256 * 256, 200 );
+		benchmark( 1024 * 1024, 20 );
+	}
+
+	return Horde3DTest::finish( "benchPixel" );
+}
@@ -0,0 +1,149 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures the time spent in h3dRender and h3dFinalizeFrame for a large terrain when the block
+// heights are filled and uploaded on the CPU (engine content shader) and when they are fetched from
+// the height map in the vertex shader (terrain sample shader). The viewport is tiny, so that pixel
+// work hardly counts with a software rasterizer.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "Horde3DTerrain.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+
+namespace {
+
+const int ImageSize = 32;
+
+
+std::string readFile( const std::string &fileName )
+{
+	std::ifstream file( fileName.c_str(), std::ios::binary );
+	std::stringstream data;
+	data << file.rdbuf();
+	return data.str();
+}
+
+
+H3DRes createHeightMap( int size )
+{
+	H3DRes tex = h3dCreateTexture( "benchHeightMap", size, size, H3DFormats::TEX_BGRA8, H3DResFlags::NoTexMipmaps );
+	unsigned char *pixels = (unsigned char *)h3dMapResStream(
+		tex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, false, true );
+	for( int y = 0; y < size; ++y )
+	{
+		for( int x = 0; x < size; ++x )
+		{
+			unsigned short h = (unsigned short)(32768 + 30000 * sinf( x * 0.02f ) * cosf( y * 0.03f ));
+			unsigned char *p = &pixels[(y * size + x) * 4];
+			p[0] = 0; p[1] = (unsigned char)(h & 0xFF); p[2] = (unsigned char)(h >> 8); p[3] = 255;
+		}
+	}
+	h3dUnmapResStream( tex );
+	return tex;
+}
+
+
+H3DRes loadMaterial( const char *name, const char *shader )
+{
+	std::string xml = std::string( "<Material>\n" ) +
+		"	<Shader source=\"" + shader + "\"/>\n"
+		"	<Sampler name=\"heightNormMap\" map=\"benchHeightMap\" />\n"
+		"	<Sampler name=\"detailMap\" map=\"benchHeightMap\" />\n"
+		"	<Uniform name=\"sunDir\" a=\"1.0\" b=\"-1.0\" c=\"0.0\" />\n"
+		"</Material>\n";
+	H3DRes mat = h3dAddResource( H3DResTypes::Material, name, 0 );
+	h3dLoadResource( mat, xml.c_str(), (int)xml.size() );
+	return mat;
+}
+
+
+// Camera flies over the terrain, so that the block selection changes every frame
+double runFrames( H3DNode camera, int frameCount, float &batches )
+{
+	h3dGetStat( H3DStats::BatchCount, true );
+	double t0 = Horde3DTest::getTimeMS();
+	for( int frame = 0; frame < frameCount; ++frame )
+	{
+		float angle = frame * 0.05f;
+		h3dSetNodeTransform( camera, 60 * sinf( angle ), 30, 60 * cosf( angle ), -25, angle * 57.3f, 0, 1, 1, 1 );
+		h3dRender( camera );
+		h3dFinalizeFrame();
+	}
+	double ms = (Horde3DTest::getTimeMS() - t0) / frameCount;
+	batches = h3dGetStat( H3DStats::BatchCount, true ) / frameCount;
+	return ms;
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	bool quick = Horde3DTest::quickMode( argc, argv );
+	int frameCount = quick ? 5 : 200;
+	int hmapSize = quick ? 256 : 2048;
+
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+
+	H3DRes heightMap = createHeightMap( hmapSize );
+	std::string gpuShaderCode = readFile( std::string( Horde3DTest::terrainContentDir() ) + "/shaders/terrain.shader" );
+	H3DRes gpuShader = h3dAddResource( H3DResTypes::Shader, "shaders/terrainGpu.shader", 0 );
+	h3dLoadResource( gpuShader, gpuShaderCode.c_str(), (int)gpuShaderCode.size() );
+	H3DRes cpuMat = loadMaterial( "benchTerrainCpu.material.xml", "shaders/terrain.shader" );
+	H3DRes gpuMat = loadMaterial( "benchTerrainGpu.material.xml", "shaders/terrainGpu.shader" );
+	H3DRes pipeline = h3dAddResource( H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml", 0 );
+	std::string contentDirs = std::string( Horde3DTest::contentDir() ) + "|" + Horde3DTest::terrainContentDir();
+	if( !H3D_CHECK( h3dutLoadResourcesFromDisk( contentDirs.c_str() ) ) ||
+	    !H3D_CHECK( h3dIsResLoaded( cpuMat ) && h3dIsResLoaded( gpuMat ) && h3dIsResLoaded( gpuShader ) ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "benchTerrain" );
+	}
+
+	H3DRes outputTex = h3dCreateTexture( "benchOutput", ImageSize, ImageSize, H3DFormats::TEX_BGRA8,
+	                                     H3DResFlags::TexRenderable | H3DResFlags::NoTexMipmaps );
+	H3DNode camera = h3dAddCameraNode( H3DRootNode, "Camera", pipeline );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportWidthI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportHeightI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::OutTexResI, outputTex );
+	h3dSetupCameraView( camera, 60.0f, 1.0f, 0.5f, 1000.0f );
+	h3dResizePipelineBuffers( pipeline, ImageSize, ImageSize );
+
+	H3DNode terrain = h3dextAddTerrainNode( H3DRootNode, "Terrain", heightMap, cpuMat );
+	h3dSetNodeTransform( terrain, -200, 0, -200, 0, 0, 0, 400, 20, 400 );
+	h3dSetNodeParamF( terrain, H3DEXTTerrain::MeshQualityF, 0, 100.0f );
+
+	float cpuBatches, gpuBatches;
+	runFrames( camera, 2, cpuBatches );  // Warm up
+	double cpuMS = runFrames( camera, frameCount, cpuBatches );
+
+	h3dSetNodeParamI( terrain, H3DEXTTerrain::MatResI, gpuMat );
+	runFrames( camera, 2, gpuBatches );
+	double gpuMS = runFrames( camera, frameCount, gpuBatches );
+
+	// Both shaders draw the same blocks
+	H3D_CHECK( cpuBatches == gpuBatches && cpuBatches > 0 );
+
+	printf( "Height map: %ix%i, frames: %i, batches: %.0f per frame\n", hmapSize, hmapSize, frameCount, cpuBatches );
+	printf( "CPU heights: %8.3f ms per frame\n", cpuMS );
+	printf( "GPU heights: %8.3f ms per frame (%.2fx)\n", gpuMS, cpuMS / gpuMS );
+
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "benchTerrain" );
+}
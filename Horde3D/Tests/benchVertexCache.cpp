@@ -0,0 +1,149 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Measures the conversion time of large meshes with and without the vertex cache and overdraw
+// optimization and the ACMR (average cache miss ratio, transformed vertices per triangle) of the
+// written index order. The triangles of the source meshes are shuffled, so that the optimizer has
+// to do all the work.
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const unsigned int CacheSize = 16;  // Same as MeshOptimizer::maxCacheSize
+
+
+template< class T > bool read( const std::string &data, size_t &pos, T *values, size_t count )
+{
+	if( pos + sizeof( T ) * count > data.size() ) return false;
+	memcpy( values, &data[pos], sizeof( T ) * count );
+	pos += sizeof( T ) * count;
+	return true;
+}
+
+
+bool loadIndices( const std::string &fileName, std::vector< unsigned int > &indices, unsigned int &numVerts )
+{
+	std::string data;
+	size_t pos = 4;
+	unsigned int version, count, numStreams;
+	if( !Horde3DTest::readFile( fileName, data ) || data.compare( 0, 4, "H3DG" ) != 0 ) return false;
+	if( !read( data, pos, &version, 1 ) || version != 5 || !read( data, pos, &count, 1 ) ) return false;
+	pos += count * 16 * sizeof( float );
+	if( !read( data, pos, &numStreams, 1 ) || !read( data, pos, &numVerts, 1 ) ) return false;
+
+	for( unsigned int i = 0; i < numStreams; ++i )
+	{
+		unsigned int streamID, elemSize;
+		if( !read( data, pos, &streamID, 1 ) || !read( data, pos, &elemSize, 1 ) ) return false;
+		pos += (size_t)elemSize * numVerts;
+	}
+
+	if( !read( data, pos, &count, 1 ) ) return false;
+	indices.resize( count );
+	return count == 0 || read( data, pos, &indices[0], count );
+}
+
+
+// Vertices transformed per triangle with a FIFO cache
+float calcAcmr( const std::vector< unsigned int > &indices, unsigned int numVerts )
+{
+	std::vector< unsigned int > timestamps( numVerts, 0 );
+	unsigned int time = CacheSize + 1, misses = 0;
+	for( size_t i = 0; i < indices.size(); ++i )
+	{
+		if( time - timestamps[indices[i]] > CacheSize )
+		{
+			timestamps[indices[i]] = time++;
+			++misses;
+		}
+	}
+	return indices.empty() ? 0.0f : misses / (indices.size() / 3.0f);
+}
+
+
+// Brings the triangles of the sample into a random order
+void shuffleTriangles( Horde3DTest::ColladaSample &sample )
+{
+	const size_t triSize = 9;  // Position, normal and texcoord index of three corners
+	size_t numTris = sample.cornerIndices.size() / triSize;
+	unsigned int seed = 12345;
+	for( size_t i = numTris - 1; i > 0; --i )
+	{
+		seed = seed * 1664525u + 1013904223u;
+		size_t j = seed % (i + 1);
+		for( size_t k = 0; k < triSize; ++k )
+			std::swap( sample.cornerIndices[i * triSize + k], sample.cornerIndices[j * triSize + k] );
+	}
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: benchVertexCache <ColladaConv executable> [--quick]\n" );
+		return 1;
+	}
+	bool quick = Horde3DTest::quickMode( argc, argv );
+	std::string converter = argv[1];
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/vertexCache";
+
+	const int gridSizes[2] = { quick ? 32 : 256, quick ? 64 : 724 };
+	const char *modes[3][2] = { { "none", "-noGeoOpt" }, { "cache", "" }, { "overdraw", "-optOverdraw" } };
+
+	printf( "%-10s %-9s %10s %8s\n", "Triangles", "Opt", "Time (ms)", "ACMR" );
+	for( int i = 0; i < 2; ++i )
+	{
+		Horde3DTest::removeDirectory( dir );
+		H3D_CHECK( Horde3DTest::createDirectory( dir + "/src" ) );
+
+		Horde3DTest::ColladaSample sample;
+		sample.gridSize = gridSizes[i];
+		sample.build();
+		shuffleTriangles( sample );
+		H3D_CHECK( sample.write( dir + "/src/mesh.dae" ) );
+
+		float acmr[3] = { 0, 0, 0 };
+		for( int j = 0; j < 3; ++j )
+		{
+			std::string outDir = dir + "/" + modes[j][0];
+			H3D_CHECK( Horde3DTest::createDirectory( outDir ) );
+
+			double t0 = Horde3DTest::getTimeMS();
+			H3D_CHECK( Horde3DTest::runColladaConv( converter, ". -base \"" + dir + "/src\" -dest \"" + outDir +
+				"\" " + modes[j][1] ) );
+			double ms = Horde3DTest::getTimeMS() - t0;
+
+			std::vector< unsigned int > indices;
+			unsigned int numVerts = 0;
+			if( !H3D_CHECK( loadIndices( outDir + "/mesh.geo", indices, numVerts ) ) ) continue;
+
+			acmr[j] = calcAcmr( indices, numVerts );
+			printf( "%-10i %-9s %10.1f %8.3f\n", (int)indices.size() / 3, modes[j][0], ms, acmr[j] );
+		}
+
+		H3D_CHECK( acmr[1] < acmr[0] * 0.5f && acmr[2] < acmr[0] * 0.5f );
+	}
+
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "benchVertexCache" );
+}
@@ -0,0 +1,229 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "blockDecoder.h"
+
+
+namespace Horde3DTest {
+
+namespace {
+
+int clampByte( int v )
+{
+	return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+
+void unpack565( unsigned int value, int *color )
+{
+	int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+
+// BC2 and BC3 color blocks always use four colors, BC1 blocks only if c0 > c1
+void decodeColors( const unsigned char *block, unsigned char *pixels, bool fourColors )
+{
+	unsigned int c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+	fourColors |= c0 > c1;
+	int palette[4][4];
+	unpack565( c0, palette[0] );
+	unpack565( c1, palette[1] );
+	for( int c = 0; c < 3; ++c )
+	{
+		if( fourColors )
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = fourColors ? 255 : 0;
+
+	for( int i = 0; i < 16; ++i )
+	{
+		int index = (block[4 + i / 4] >> (2 * (i % 4))) & 3;
+		for( int c = 0; c < 4; ++c ) pixels[i * 4 + c] = (unsigned char)palette[index][c];
+	}
+}
+
+
+unsigned long long readBigEndian( const unsigned char *data )
+{
+	unsigned long long value = 0;
+	for( int i = 0; i < 8; ++i ) value = (value << 8) | data[i];
+	return value;
+}
+
+
+int signExtend3( int value )
+{
+	return value >= 4 ? value - 8 : value;
+}
+
+}  // namespace
+
+
+bool decodeBC1Block( const unsigned char *block, unsigned char *pixels )
+{
+	decodeColors( block, pixels, false );
+	return true;
+}
+
+
+bool decodeBC3Block( const unsigned char *block, unsigned char *pixels )
+{
+	decodeColors( block + 8, pixels, true );
+
+	int a0 = block[0], a1 = block[1], values[8] = { a0, a1 };
+	for( int k = 2; k < 8; ++k )
+	{
+		if( a0 > a1 ) values[k] = ((8 - k) * a0 + (k - 1) * a1) / 7;
+		else values[k] = k < 6 ? ((6 - k) * a0 + (k - 1) * a1) / 5 : (k == 6 ? 0 : 255);
+	}
+
+	unsigned long long indexBits = 0;
+	for( int i = 0; i < 6; ++i ) indexBits |= (unsigned long long)block[2 + i] << (8 * i);
+	for( int i = 0; i < 16; ++i ) pixels[i * 4 + 3] = (unsigned char)values[(indexBits >> (3 * i)) & 7];
+
+	return true;
+}
+
+
+bool decodeBC7Block( const unsigned char *block, unsigned char *pixels )
+{
+	// Mode 6: mode bits 0000001, 7 bit RGBA endpoints, two P-bits and 4 bit indices
+	if( (block[0] & 0x7F) != 0x40 ) return false;
+
+	unsigned int pos = 7;
+	auto read = [&]( unsigned int numBits )
+	{
+		unsigned int value = 0;
+		for( unsigned int i = 0; i < numBits; ++i, ++pos )
+			value |= ((block[pos >> 3] >> (pos & 7)) & 1u) << i;
+		return value;
+	};
+
+	int e[2][4];
+	for( int c = 0; c < 4; ++c )
+	{
+		e[0][c] = read( 7 ) << 1;
+		e[1][c] = read( 7 ) << 1;
+	}
+	int p0 = read( 1 ), p1 = read( 1 );
+	for( int c = 0; c < 4; ++c )
+	{
+		e[0][c] |= p0;
+		e[1][c] |= p1;
+	}
+
+	static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	for( int i = 0; i < 16; ++i )
+	{
+		int w = weights[read( i == 0 ? 3 : 4 )];
+		for( int c = 0; c < 4; ++c )
+			pixels[i * 4 + c] = (unsigned char)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+	}
+
+	return true;
+}
+
+
+bool decodeETC2Block( const unsigned char *block, unsigned char *pixels )
+{
+	static const int modifiers[8][2] = {
+		{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+	};
+
+	unsigned long long bits = readBigEndian( block );
+	unsigned int hi = (unsigned int)(bits >> 32), lo = (unsigned int)bits;
+	bool diff = (hi >> 1) & 1, flip = hi & 1;
+
+	int base[2][3];
+	for( int c = 0; c < 3; ++c )
+	{
+		int shift = 24 - 8 * c;
+		if( diff )
+		{
+			int b0 = (hi >> (shift + 3)) & 31;
+			int b1 = b0 + signExtend3( (hi >> shift) & 7 );
+
+			// Overflowing colors select the T, H and planar modes of ETC2
+			if( b1 < 0 || b1 > 31 ) return false;
+			base[0][c] = (b0 << 3) | (b0 >> 2);
+			base[1][c] = (b1 << 3) | (b1 >> 2);
+		}
+		else
+		{
+			base[0][c] = ((hi >> (shift + 4)) & 15) * 17;
+			base[1][c] = ((hi >> shift) & 15) * 17;
+		}
+	}
+	int tables[2] = { (int)(hi >> 5) & 7, (int)(hi >> 2) & 7 };
+
+	for( int y = 0; y < 4; ++y )
+	{
+		for( int x = 0; x < 4; ++x )
+		{
+			int s = flip ? (y >= 2) : (x >= 2);
+			int j = x * 4 + y;
+			int msb = (lo >> (16 + j)) & 1, lsb = (lo >> j) & 1;
+			int modifier = modifiers[tables[s]][lsb];
+			if( msb ) modifier = -modifier;
+
+			unsigned char *pixel = &pixels[(y * 4 + x) * 4];
+			for( int c = 0; c < 3; ++c ) pixel[c] = (unsigned char)clampByte( base[s][c] + modifier );
+			pixel[3] = 255;
+		}
+	}
+
+	return true;
+}
+
+
+bool decodeETC2EACBlock( const unsigned char *block, unsigned char *pixels )
+{
+	static const int modifiers[16][8] = {
+		{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+		{ -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+		{ -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+		{ -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+		{ -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+	};
+
+	if( !decodeETC2Block( block + 8, pixels ) ) return false;
+
+	unsigned long long bits = readBigEndian( block );
+	int base = (int)(bits >> 56), mul = (int)(bits >> 52) & 15, table = (int)(bits >> 48) & 15;
+	for( int y = 0; y < 4; ++y )
+	{
+		for( int x = 0; x < 4; ++x )
+		{
+			int index = (int)(bits >> (45 - 3 * (x * 4 + y))) & 7;
+			pixels[(y * 4 + x) * 4 + 3] = (unsigned char)clampByte( base + modifiers[table][index] * mul );
+		}
+	}
+
+	return true;
+}
+
+}
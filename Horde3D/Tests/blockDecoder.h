@@ -0,0 +1,30 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _blockDecoder_H_
+#define _blockDecoder_H_
+
+// Reference decoders for the block formats written by TextureConv, implemented from the format
+// specifications independently of the encoders. All decoders write a block of 4x4 RGBA pixels in
+// row order (64 bytes) and return false for block modes that TextureConv never writes.
+
+namespace Horde3DTest {
+
+bool decodeBC1Block( const unsigned char *block, unsigned char *pixels );
+bool decodeBC3Block( const unsigned char *block, unsigned char *pixels );
+bool decodeBC7Block( const unsigned char *block, unsigned char *pixels );
+bool decodeETC2Block( const unsigned char *block, unsigned char *pixels );
+bool decodeETC2EACBlock( const unsigned char *block, unsigned char *pixels );
+
+}
+
+#endif // _blockDecoder_H_
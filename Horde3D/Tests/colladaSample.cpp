@@ -0,0 +1,219 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "colladaSample.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+
+namespace Horde3DTest {
+
+ColladaSample::ColladaSample() :
+	materialName( "material" ), gridSize( 8 ), jointCount( 0 ), weightsPerVertex( 6 ), seamNormalOffset( 1e-4f )
+{
+	diffuseColor[0] = diffuseColor[1] = diffuseColor[2] = 0.8f;
+}
+
+
+void ColladaSample::build()
+{
+	int side = gridSize + 1;
+	positions.clear(); normals.clear(); texCoords.clear(); cornerIndices.clear(); weights.clear();
+
+	for( int z = 0; z < side; ++z )
+	{
+		for( int x = 0; x < side; ++x )
+		{
+			positions.push_back( (float)x ); positions.push_back( 0.1f * ((x * 7 + z * 3) % 5) );
+			positions.push_back( (float)z );
+
+			// Two normal sets; the second one is used by the right half of the grid
+			normals.push_back( 0.0f ); normals.push_back( 1.0f ); normals.push_back( 0.0f );
+
+			// Two texcoord ranges within [0, 1] (so that they can be quantized); the second one is
+			// used by the back half of the grid
+			texCoords.push_back( 0.5f * x / gridSize ); texCoords.push_back( (float)z / gridSize );
+		}
+	}
+	for( int i = 0; i < side * side; ++i )
+	{
+		normals.push_back( seamNormalOffset ); normals.push_back( 1.0f ); normals.push_back( 0.0f );
+		texCoords.push_back( texCoords[i * 2] + 0.5f ); texCoords.push_back( texCoords[i * 2 + 1] );
+	}
+
+	for( int z = 0; z < gridSize; ++z )
+	{
+		for( int x = 0; x < gridSize; ++x )
+		{
+			int normalSet = x >= gridSize / 2 ? side * side : 0;
+			int texSet = z >= gridSize / 2 ? side * side : 0;
+			int quad[4] = { z * side + x, (z + 1) * side + x, (z + 1) * side + x + 1, z * side + x + 1 };
+			int corners[6] = { 0, 1, 2, 0, 2, 3 };
+			for( int i = 0; i < 6; ++i )
+			{
+				int pos = quad[corners[i]];
+				cornerIndices.push_back( pos );
+				cornerIndices.push_back( pos + normalSet );
+				cornerIndices.push_back( pos + texSet );
+			}
+		}
+	}
+
+	if( jointCount > 0 )
+	{
+		// Weights of a vertex are a rotation of a pattern with ties
+		static const float pattern[] = { 0.1f, 0.25f, 0.1f, 0.25f, 0.05f, 0.25f, 0.1f, 0.15f };
+		const int patternSize = sizeof( pattern ) / sizeof( pattern[0] );
+		for( int i = 0; i < side * side; ++i )
+		{
+			for( int j = 0; j < weightsPerVertex; ++j )
+			{
+				weights.push_back( (float)((i + j) % jointCount) );
+				weights.push_back( pattern[(i * 3 + j) % patternSize] );
+			}
+		}
+	}
+}
+
+
+static void writeFloats( std::ostream &out, const std::vector< float > &values )
+{
+	for( size_t i = 0; i < values.size(); ++i ) out << (i > 0 ? " " : "") << values[i];
+}
+
+
+bool ColladaSample::write( const std::string &fileName ) const
+{
+	std::ofstream out( fileName.c_str() );
+	if( !out.good() ) return false;
+	out << std::setprecision( 9 );
+
+	int side = gridSize + 1;
+	out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+	out << "<COLLADA xmlns=\"http://www.collada.org/2005/11/COLLADASchema\" version=\"1.4.1\">\n";
+	out << "<asset><up_axis>Y_UP</up_axis></asset>\n";
+
+	out << "<library_effects><effect id=\"fx\"><profile_COMMON><technique sid=\"common\"><phong>";
+	out << "<diffuse><color>" << diffuseColor[0] << " " << diffuseColor[1] << " " << diffuseColor[2] << " 1</color></diffuse>";
+	out << "</phong></technique></profile_COMMON></effect></library_effects>\n";
+	out << "<library_materials><material id=\"mat\" name=\"" << materialName << "\">";
+	out << "<instance_effect url=\"#fx\"/></material></library_materials>\n";
+
+	out << "<library_geometries><geometry id=\"grid\" name=\"grid\"><mesh>\n";
+	out << "<source id=\"grid-pos\"><float_array id=\"grid-pos-array\" count=\"" << positions.size() << "\">";
+	writeFloats( out, positions );
+	out << "</float_array><technique_common><accessor source=\"#grid-pos-array\" count=\"" << positions.size() / 3;
+	out << "\" stride=\"3\"><param name=\"X\" type=\"float\"/><param name=\"Y\" type=\"float\"/>";
+	out << "<param name=\"Z\" type=\"float\"/></accessor></technique_common></source>\n";
+	out << "<source id=\"grid-nrm\"><float_array id=\"grid-nrm-array\" count=\"" << normals.size() << "\">";
+	writeFloats( out, normals );
+	out << "</float_array><technique_common><accessor source=\"#grid-nrm-array\" count=\"" << normals.size() / 3;
+	out << "\" stride=\"3\"><param name=\"X\" type=\"float\"/><param name=\"Y\" type=\"float\"/>";
+	out << "<param name=\"Z\" type=\"float\"/></accessor></technique_common></source>\n";
+	out << "<source id=\"grid-uv\"><float_array id=\"grid-uv-array\" count=\"" << texCoords.size() << "\">";
+	writeFloats( out, texCoords );
+	out << "</float_array><technique_common><accessor source=\"#grid-uv-array\" count=\"" << texCoords.size() / 2;
+	out << "\" stride=\"2\"><param name=\"S\" type=\"float\"/><param name=\"T\" type=\"float\"/>";
+	out << "</accessor></technique_common></source>\n";
+	out << "<vertices id=\"grid-vtx\"><input semantic=\"POSITION\" source=\"#grid-pos\"/></vertices>\n";
+	out << "<triangles material=\"mat\" count=\"" << cornerIndices.size() / 9 << "\">";
+	out << "<input semantic=\"VERTEX\" source=\"#grid-vtx\" offset=\"0\"/>";
+	out << "<input semantic=\"NORMAL\" source=\"#grid-nrm\" offset=\"1\"/>";
+	out << "<input semantic=\"TEXCOORD\" source=\"#grid-uv\" offset=\"2\" set=\"0\"/><p>";
+	for( size_t i = 0; i < cornerIndices.size(); ++i ) out << (i > 0 ? " " : "") << cornerIndices[i];
+	out << "</p></triangles>\n</mesh></geometry></library_geometries>\n";
+
+	if( jointCount > 0 )
+	{
+		int numVerts = side * side;
+		out << "<library_controllers><controller id=\"skin\"><skin source=\"#grid\">";
+		out << "<bind_shape_matrix>1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1</bind_shape_matrix>\n";
+		out << "<source id=\"skin-joints\"><Name_array id=\"skin-joints-array\" count=\"" << jointCount << "\">";
+		for( int i = 0; i < jointCount; ++i ) out << (i > 0 ? " " : "") << "joint" << i;
+		out << "</Name_array><technique_common><accessor source=\"#skin-joints-array\" count=\"" << jointCount;
+		out << "\" stride=\"1\"><param name=\"JOINT\" type=\"name\"/></accessor></technique_common></source>\n";
+		out << "<source id=\"skin-bind\"><float_array id=\"skin-bind-array\" count=\"" << jointCount * 16 << "\">";
+		for( int i = 0; i < jointCount; ++i )
+			out << (i > 0 ? " " : "") << "1 0 0 0 0 1 0 " << -i << " 0 0 1 0 0 0 0 1";
+		out << "</float_array><technique_common><accessor source=\"#skin-bind-array\" count=\"" << jointCount;
+		out << "\" stride=\"16\"><param name=\"TRANSFORM\" type=\"float4x4\"/></accessor></technique_common></source>\n";
+		out << "<source id=\"skin-weights\"><float_array id=\"skin-weights-array\" count=\"" << weights.size() / 2 << "\">";
+		for( size_t i = 1; i < weights.size(); i += 2 ) out << (i > 1 ? " " : "") << weights[i];
+		out << "</float_array><technique_common><accessor source=\"#skin-weights-array\" count=\"" << weights.size() / 2;
+		out << "\" stride=\"1\"><param name=\"WEIGHT\" type=\"float\"/></accessor></technique_common></source>\n";
+		out << "<joints><input semantic=\"JOINT\" source=\"#skin-joints\"/>";
+		out << "<input semantic=\"INV_BIND_MATRIX\" source=\"#skin-bind\"/></joints>\n";
+		out << "<vertex_weights count=\"" << numVerts << "\"><input semantic=\"JOINT\" source=\"#skin-joints\" offset=\"0\"/>";
+		out << "<input semantic=\"WEIGHT\" source=\"#skin-weights\" offset=\"1\"/><vcount>";
+		for( int i = 0; i < numVerts; ++i ) out << (i > 0 ? " " : "") << weightsPerVertex;
+		out << "</vcount><v>";
+		for( int i = 0; i < numVerts * weightsPerVertex; ++i )
+			out << (i > 0 ? " " : "") << (int)weights[i * 2] << " " << i;
+		out << "</v></vertex_weights></skin></controller></library_controllers>\n";
+	}
+
+	out << "<library_visual_scenes><visual_scene id=\"scene\">\n";
+	for( int i = 0; i < jointCount; ++i )
+	{
+		out << "<node id=\"joint" << i << "\" sid=\"joint" << i << "\" name=\"joint" << i << "\" type=\"JOINT\">";
+		out << "<matrix>1 0 0 0 0 1 0 " << (i > 0 ? 1 : 0) << " 0 0 1 0 0 0 0 1</matrix>";
+	}
+	for( int i = 0; i < jointCount; ++i ) out << "</node>";
+	if( jointCount > 0 ) out << "\n";
+	out << "<node id=\"gridNode\" name=\"gridNode\">";
+	if( jointCount > 0 ) out << "<instance_controller url=\"#skin\"><skeleton>#joint0</skeleton>";
+	else out << "<instance_geometry url=\"#grid\">";
+	out << "<bind_material><technique_common><instance_material symbol=\"mat\" target=\"#mat\"/>";
+	out << "</technique_common></bind_material>";
+	out << (jointCount > 0 ? "</instance_controller>" : "</instance_geometry>") << "</node>\n";
+	out << "</visual_scene></library_visual_scenes>\n";
+	out << "<scene><instance_visual_scene url=\"#scene\"/></scene>\n</COLLADA>\n";
+
+	return out.good();
+}
+
+
+bool runColladaConv( const std::string &converter, const std::string &arguments )
+{
+	std::string command = "\"" + converter + "\" " + arguments + " > /dev/null";
+	return system( command.c_str() ) == 0;
+}
+
+
+bool readFile( const std::string &fileName, std::string &data )
+{
+	std::ifstream in( fileName.c_str(), std::ios::binary );
+	if( !in.good() ) return false;
+	std::stringstream ss;
+	ss << in.rdbuf();
+	data = ss.str();
+	return true;
+}
+
+
+bool removeDirectory( const std::string &path )
+{
+	std::string command = "rm -rf \"" + path + "\"";
+	return system( command.c_str() ) == 0;
+}
+
+
+bool createDirectory( const std::string &path )
+{
+	std::string command = "mkdir -p \"" + path + "\"";
+	return system( command.c_str() ) == 0;
+}
+
+}
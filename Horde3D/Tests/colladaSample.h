@@ -0,0 +1,52 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _colladaSample_H_
+#define _colladaSample_H_
+
+#include <string>
+#include <vector>
+
+// Generates COLLADA files for converter tests: a grid in the XZ plane whose right half uses
+// slightly different normals and whose back half uses a second texture coordinate range, so that
+// vertices on the two seams are only welded with a weld epsilon. Skinned grids are bound to a
+// joint chain with more than four, partly equal, weights per vertex.
+
+namespace Horde3DTest {
+
+struct ColladaSample
+{
+	std::string  materialName;
+	float        diffuseColor[3];
+	int          gridSize;          // Number of quads per side
+	int          jointCount;        // 0 writes a static mesh
+	int          weightsPerVertex;
+	float        seamNormalOffset;  // Difference of the normals on both sides of the normal seam
+
+	// Data as referenced by the COLLADA triangles (position, normal and texcoord index per corner)
+	std::vector< float >  positions, normals, texCoords;
+	std::vector< int >    cornerIndices;
+	std::vector< float >  weights;  // Per position: weightsPerVertex pairs of (joint, weight)
+
+	ColladaSample();
+	void build();
+	bool write( const std::string &fileName ) const;
+};
+
+bool runColladaConv( const std::string &converter, const std::string &arguments );
+bool readFile( const std::string &fileName, std::string &data );
+bool removeDirectory( const std::string &path );
+bool createDirectory( const std::string &path );
+
+}
+
+#endif // _colladaSample_H_
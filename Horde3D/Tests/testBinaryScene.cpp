@@ -0,0 +1,303 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Scene graphs compiled to the binary format by ColladaConv must create the same nodes with the
+// same parameters as their XML source, including referenced scene graphs that were compiled in the
+// same run. Binary files with deep hierarchies or node counts that don't match their data must not
+// crash the loader.
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+std::string dir;
+
+const char *SampleScenes[] = {
+	"models/knight/knight.scene.xml",
+	"models/man/man.scene.xml",
+	"models/sphere/sphere.scene.xml",
+	"particles/particleSys1/particleSys1.scene.xml"
+};
+
+const char *TestScene =
+	"<Group name=\"Root\" tx=\"1\" ty=\"2\" tz=\"3\" rx=\"10\" ry=\"20\" rz=\"30\" sx=\"1\" sy=\"2\" sz=\"3\">\n"
+	"	<Attachment type=\"Test\" value=\"attached\" />\n"
+	"	<Reference name=\"Knight\" sceneGraph=\"models/knight/knight.scene.xml\" tx=\"5\" />\n"
+	"	<Reference sceneGraph=\"models/man/man.scene.xml\" rx=\"90\" sy=\"0.5\" />\n"
+	"	<Light name=\"Light\" lightingContext=\"LIGHTING\" shadowContext=\"SHADOWMAP\" radius=\"50\" fov=\"80\"\n"
+	"		col_R=\"0.5\" col_G=\"0.6\" col_B=\"0.7\" colMult=\"2\" shadowMapCount=\"2\" shadowSplitLambda=\"0.8\"\n"
+	"		shadowMapBias=\"0.01\" />\n"
+	"	<Camera name=\"Camera\" pipeline=\"pipelines/forward.pipeline.xml\" leftPlane=\"-0.1\" rightPlane=\"0.1\"\n"
+	"		bottomPlane=\"-0.2\" topPlane=\"0.2\" nearPlane=\"0.3\" farPlane=\"500\" orthographic=\"true\" />\n"
+	"	<Group name=\"Nested\" ry=\"45\">\n"
+	"		<Reference sceneGraph=\"models/sphere/sphere.scene.xml\" />\n"
+	"		<Reference sceneGraph=\"particles/particleSys1/particleSys1.scene.xml\" tz=\"-4\" />\n"
+	"		<Group name=\"Empty\" />\n"
+	"	</Group>\n"
+	"</Group>\n";
+
+// Parameters that are compared for each node type: i = int, f = float, v = float vector, s = string
+struct NodeParam
+{
+	int   nodeType;
+	int   param;
+	char  kind;
+};
+
+const NodeParam NodeParams[] = {
+	{ H3DNodeTypes::Undefined, H3DNodeParams::NameStr, 's' },
+	{ H3DNodeTypes::Undefined, H3DNodeParams::AttachmentStr, 's' },
+	{ H3DNodeTypes::Model, H3DModel::GeoResI, 'i' },
+	{ H3DNodeTypes::Model, H3DModel::SWSkinningI, 'i' },
+	{ H3DNodeTypes::Model, H3DModel::LodDist1F, 'f' },
+	{ H3DNodeTypes::Model, H3DModel::LodDist2F, 'f' },
+	{ H3DNodeTypes::Model, H3DModel::LodDist3F, 'f' },
+	{ H3DNodeTypes::Model, H3DModel::LodDist4F, 'f' },
+	{ H3DNodeTypes::Mesh, H3DMesh::MatResI, 'i' },
+	{ H3DNodeTypes::Mesh, H3DMesh::BatchStartI, 'i' },
+	{ H3DNodeTypes::Mesh, H3DMesh::BatchCountI, 'i' },
+	{ H3DNodeTypes::Mesh, H3DMesh::VertRStartI, 'i' },
+	{ H3DNodeTypes::Mesh, H3DMesh::VertREndI, 'i' },
+	{ H3DNodeTypes::Mesh, H3DMesh::LodLevelI, 'i' },
+	{ H3DNodeTypes::Joint, H3DJoint::JointIndexI, 'i' },
+	{ H3DNodeTypes::Light, H3DLight::MatResI, 'i' },
+	{ H3DNodeTypes::Light, H3DLight::RadiusF, 'f' },
+	{ H3DNodeTypes::Light, H3DLight::FovF, 'f' },
+	{ H3DNodeTypes::Light, H3DLight::ColorF3, 'v' },
+	{ H3DNodeTypes::Light, H3DLight::ColorMultiplierF, 'f' },
+	{ H3DNodeTypes::Light, H3DLight::ShadowMapCountI, 'i' },
+	{ H3DNodeTypes::Light, H3DLight::ShadowSplitLambdaF, 'f' },
+	{ H3DNodeTypes::Light, H3DLight::ShadowMapBiasF, 'f' },
+	{ H3DNodeTypes::Light, H3DLight::LightingContextStr, 's' },
+	{ H3DNodeTypes::Light, H3DLight::ShadowContextStr, 's' },
+	{ H3DNodeTypes::Camera, H3DCamera::PipeResI, 'i' },
+	{ H3DNodeTypes::Camera, H3DCamera::OutBufIndexI, 'i' },
+	{ H3DNodeTypes::Camera, H3DCamera::LeftPlaneF, 'f' },
+	{ H3DNodeTypes::Camera, H3DCamera::RightPlaneF, 'f' },
+	{ H3DNodeTypes::Camera, H3DCamera::BottomPlaneF, 'f' },
+	{ H3DNodeTypes::Camera, H3DCamera::TopPlaneF, 'f' },
+	{ H3DNodeTypes::Camera, H3DCamera::NearPlaneF, 'f' },
+	{ H3DNodeTypes::Camera, H3DCamera::FarPlaneF, 'f' },
+	{ H3DNodeTypes::Camera, H3DCamera::OrthoI, 'i' },
+	{ H3DNodeTypes::Camera, H3DCamera::OccCullingI, 'i' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::MatResI, 'i' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::PartEffResI, 'i' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::MaxCountI, 'i' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::RespawnCountI, 'i' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::DelayF, 'f' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::EmissionRateF, 'f' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::SpreadAngleF, 'f' },
+	{ H3DNodeTypes::Emitter, H3DEmitter::ForceF3, 'v' }
+};
+
+
+bool writeFile( const std::string &fileName, const std::string &data )
+{
+	std::ofstream out( fileName.c_str(), std::ios::binary );
+	out.write( data.data(), data.size() );
+	return out.good();
+}
+
+
+bool equalNodes( H3DNode a, H3DNode b, int &nodeCount )
+{
+	++nodeCount;
+	int type = h3dGetNodeType( a );
+	if( !H3D_CHECK( type == h3dGetNodeType( b ) ) ) return false;
+
+	float ta[9], tb[9];
+	h3dGetNodeTransform( a, &ta[0], &ta[1], &ta[2], &ta[3], &ta[4], &ta[5], &ta[6], &ta[7], &ta[8] );
+	h3dGetNodeTransform( b, &tb[0], &tb[1], &tb[2], &tb[3], &tb[4], &tb[5], &tb[6], &tb[7], &tb[8] );
+	for( int i = 0; i < 9; ++i )
+	{
+		if( !H3D_CHECK( fabsf( ta[i] - tb[i] ) < 1e-4f ) ) return false;
+	}
+
+	for( size_t i = 0; i < sizeof( NodeParams ) / sizeof( NodeParam ); ++i )
+	{
+		const NodeParam &p = NodeParams[i];
+		if( p.nodeType != H3DNodeTypes::Undefined && p.nodeType != type ) continue;
+
+		bool equal = true;
+		switch( p.kind )
+		{
+		case 'i':
+			equal = h3dGetNodeParamI( a, p.param ) == h3dGetNodeParamI( b, p.param );
+			break;
+		case 'f':
+			equal = h3dGetNodeParamF( a, p.param, 0 ) == h3dGetNodeParamF( b, p.param, 0 );
+			break;
+		case 'v':
+			for( int j = 0; j < 3; ++j ) equal &= h3dGetNodeParamF( a, p.param, j ) == h3dGetNodeParamF( b, p.param, j );
+			break;
+		case 's':
+			equal = strcmp( h3dGetNodeParamStr( a, p.param ), h3dGetNodeParamStr( b, p.param ) ) == 0;
+			break;
+		}
+		if( !equal )
+		{
+			printf( "Parameter %i of node '%s' differs\n", p.param, h3dGetNodeParamStr( a, H3DNodeParams::NameStr ) );
+			H3D_CHECK( equal );
+			return false;
+		}
+	}
+
+	int childCount = 0;
+	while( h3dGetNodeChild( a, childCount ) != 0 ) ++childCount;
+	if( !H3D_CHECK( h3dGetNodeChild( b, childCount ) == 0 && (childCount == 0 || h3dGetNodeChild( b, childCount - 1 ) != 0) ) )
+		return false;
+
+	for( int i = 0; i < childCount; ++i )
+	{
+		if( !equalNodes( h3dGetNodeChild( a, i ), h3dGetNodeChild( b, i ), nodeCount ) ) return false;
+	}
+	return true;
+}
+
+
+void compareScene( const std::string &xmlName )
+{
+	std::string binName = xmlName.substr( 0, xmlName.length() - 4 ) + ".bin";
+	H3DRes xmlRes = h3dAddResource( H3DResTypes::SceneGraph, xmlName.c_str(), 0 );
+	H3DRes binRes = h3dAddResource( H3DResTypes::SceneGraph, binName.c_str(), 0 );
+	H3D_CHECK( h3dutLoadResourcesFromDisk( (dir + "/bin|" + dir + "/src|" + Horde3DTest::contentDir()).c_str() ) );
+	if( !H3D_CHECK( h3dIsResLoaded( xmlRes ) && h3dIsResLoaded( binRes ) ) ) return;
+
+	H3DNode xmlNode = h3dAddNodes( H3DRootNode, xmlRes );
+	H3DNode binNode = h3dAddNodes( H3DRootNode, binRes );
+	int nodeCount = 0;
+	if( H3D_CHECK( xmlNode != 0 && binNode != 0 ) )
+	{
+		H3D_CHECK( equalNodes( xmlNode, binNode, nodeCount ) );
+		printf( "%s: %i nodes\n", xmlName.c_str(), nodeCount );
+	}
+	h3dRemoveNode( xmlNode );
+	h3dRemoveNode( binNode );
+}
+
+
+// Binary scene graph with the given node records (type, name, number of children, transformation,
+// attachment and number of attributes) without attributes
+std::string buildBinaryScene( const std::vector< unsigned int > &records, unsigned int nodeCount )
+{
+	const char strings[] = "Group\0Unknown\0Node";
+	unsigned int offsets[3] = { 0, 6, 14 };
+	unsigned int header[5] = { 0, 1, 3, sizeof( strings ), nodeCount };
+	memcpy( &header[0], "H3DS", 4 );
+
+	std::string data( (const char *)header, sizeof( header ) );
+	data.append( (const char *)offsets, sizeof( offsets ) );
+	data.append( strings, sizeof( strings ) );
+	if( !records.empty() ) data.append( (const char *)&records[0], records.size() * sizeof( unsigned int ) );
+	return data;
+}
+
+
+void appendRecord( std::vector< unsigned int > &records, unsigned int type, unsigned int childCount )
+{
+	const float one = 1.0f;
+	unsigned int oneBits;
+	memcpy( &oneBits, &one, 4 );
+	unsigned int record[14] = { type, 2, childCount, 0, 0, 0, 0, 0, 0, oneBits, oneBits, oneBits, 0xffffffff, 0 };
+	records.insert( records.end(), record, record + 14 );
+}
+
+
+bool loadBinaryScene( const std::string &data )
+{
+	static int counter = 0;
+	std::string name = "malformed" + std::to_string( counter++ ) + ".scene.bin";
+	H3DRes res = h3dAddResource( H3DResTypes::SceneGraph, name.c_str(), 0 );
+	bool result = h3dLoadResource( res, data.data(), (int)data.size() );
+	h3dRemoveResource( res );
+	h3dReleaseUnusedResources();
+	return result;
+}
+
+
+void testMalformed()
+{
+	// Chain of nodes deeper than any call stack; nodes of unknown types are skipped with their children
+	const unsigned int depth = 1000000;
+	std::vector< unsigned int > records;
+	appendRecord( records, 0, 1 );
+	for( unsigned int i = 0; i < depth; ++i ) appendRecord( records, 1, i + 1 < depth ? 1 : 0 );
+	H3D_CHECK( loadBinaryScene( buildBinaryScene( records, depth + 1 ) ) );
+
+	// Node count in header does not match records
+	H3D_CHECK( !loadBinaryScene( buildBinaryScene( records, depth ) ) );
+	H3D_CHECK( !loadBinaryScene( buildBinaryScene( records, depth + 2 ) ) );
+
+	// More children than records
+	records.clear();
+	appendRecord( records, 0, 0xffffffff );
+	appendRecord( records, 0, 0 );
+	H3D_CHECK( !loadBinaryScene( buildBinaryScene( records, 0xffffffff ) ) );
+	H3D_CHECK( !loadBinaryScene( buildBinaryScene( records, 2 ) ) );
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: testBinaryScene <ColladaConv executable>\n" );
+		return 1;
+	}
+	std::string converter = argv[1];
+	dir = std::string( Horde3DTest::tempDir() ) + "/binaryScene";
+
+	// Sample scene graphs and a scene that references them are compiled in one run
+	Horde3DTest::removeDirectory( dir );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/bin" ) );
+	for( size_t i = 0; i < sizeof( SampleScenes ) / sizeof( const char * ); ++i )
+	{
+		std::string name = SampleScenes[i], data;
+		H3D_CHECK( Horde3DTest::createDirectory( dir + "/src/" + name.substr( 0, name.find_last_of( '/' ) ) ) );
+		H3D_CHECK( Horde3DTest::readFile( std::string( Horde3DTest::contentDir() ) + "/" + name, data ) );
+		H3D_CHECK( writeFile( dir + "/src/" + name, data ) );
+	}
+	H3D_CHECK( writeFile( dir + "/src/test.scene.xml", TestScene ) );
+	H3D_CHECK( Horde3DTest::runColladaConv( converter, ". -type scene -base \"" + dir + "/src\" -dest \"" + dir + "/bin\"" ) );
+
+	if( !Horde3DTest::initEngine() )
+	{
+		Horde3DTest::removeDirectory( dir );
+		return Horde3DTest::TestSkipped;
+	}
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+
+	for( size_t i = 0; i < sizeof( SampleScenes ) / sizeof( const char * ); ++i ) compareScene( SampleScenes[i] );
+	compareScene( "test.scene.xml" );
+
+	// References in the binary scene point to the compiled scenes
+	H3DRes knightBin = h3dFindResource( H3DResTypes::SceneGraph, "models/knight/knight.scene.bin" );
+	H3D_CHECK( knightBin != 0 && h3dIsResLoaded( knightBin ) );
+
+	testMalformed();
+
+	Horde3DTest::releaseEngine();
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "testBinaryScene" );
+}
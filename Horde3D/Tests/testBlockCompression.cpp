@@ -0,0 +1,137 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Blocks encoded by the TextureConv block compressors and decoded by independent reference decoders
+// must stay within error bounds: constant blocks are only off by the quantization of the base
+// colors, gradients between random colors must be approximated closely and noise must be
+// approximated better than by the mean color of the block (RMSE of about 74).
+
+#include "testCommon.h"
+#include "blockDecoder.h"
+#include "blockCompressor.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace Horde3D::TextureConverter;
+
+
+namespace {
+
+enum BlockTypes { Constant, Gradient, Noise, BlockTypeCount };
+const char *BlockTypeNames[BlockTypeCount] = { "constant", "gradient", "noise" };
+
+struct Format
+{
+	const char  *name;
+	void        (*encode)( const unsigned char *, unsigned char * );
+	bool        (*decode)( const unsigned char *, unsigned char * );
+	int         numComps;  // Compared components, alpha is 255 for RGB formats
+
+	// Bounds of the maximum error of constant blocks and of the RMSE of gradient and noise blocks
+	float       bounds[BlockTypeCount];
+};
+
+const Format Formats[] = {
+	{ "BC1", encodeBC1Block, Horde3DTest::decodeBC1Block, 3, { 4, 10, 60 } },
+	{ "BC3", encodeBC3Block, Horde3DTest::decodeBC3Block, 4, { 4, 10, 60 } },
+	{ "BC7", encodeBC7Block, Horde3DTest::decodeBC7Block, 4, { 1, 2.5f, 60 } },
+	{ "ETC2", encodeETC2Block, Horde3DTest::decodeETC2Block, 3, { 6, 22, 60 } },
+	{ "ETC2 EAC", encodeETC2EACBlock, Horde3DTest::decodeETC2EACBlock, 4, { 6, 20, 60 } }
+};
+
+unsigned int seed = 1;
+
+int nextRandom( int range )
+{
+	seed = seed * 1664525u + 1013904223u;
+	return (int)((seed >> 8) % (unsigned int)range);
+}
+
+
+void makeBlock( int type, int numComps, unsigned char *pixels )
+{
+	int c0[4], c1[4];
+	for( int c = 0; c < 4; ++c )
+	{
+		c0[c] = nextRandom( 256 );
+		c1[c] = nextRandom( 256 );
+	}
+
+	for( int i = 0; i < 16; ++i )
+	{
+		for( int c = 0; c < 4; ++c )
+		{
+			int v = c0[c];
+			if( type == Gradient ) v = c0[c] + (c1[c] - c0[c]) * ((i % 4) + (i / 4)) / 6;
+			else if( type == Noise ) v = nextRandom( 256 );
+			pixels[i * 4 + c] = (unsigned char)(c < numComps ? v : 255);
+		}
+	}
+}
+
+
+void testFormat( const Format &format )
+{
+	const int blockCount = 4000;
+	for( int type = 0; type < BlockTypeCount; ++type )
+	{
+		int maxError = 0, invalidBlocks = 0;
+		double squaredError = 0;
+		for( int b = 0; b < blockCount; ++b )
+		{
+			unsigned char pixels[64], block[16], decoded[64];
+			makeBlock( type, format.numComps, pixels );
+			format.encode( pixels, block );
+			if( !format.decode( block, decoded ) )
+			{
+				++invalidBlocks;
+				continue;
+			}
+
+			for( int i = 0; i < 16; ++i )
+			{
+				for( int c = 0; c < 4; ++c )
+				{
+					int d = abs( decoded[i * 4 + c] - pixels[i * 4 + c] );
+					maxError = d > maxError ? d : maxError;
+					squaredError += d * d;
+				}
+			}
+		}
+
+		float rmse = (float)sqrt( squaredError / (blockCount * 16 * format.numComps) );
+		printf( "%-9s %-9s max error %3i, RMSE %6.2f\n", format.name, BlockTypeNames[type], maxError, rmse );
+		H3D_CHECK( invalidBlocks == 0 );
+		H3D_CHECK( (type == Constant ? (float)maxError : rmse) <= format.bounds[type] );
+	}
+}
+
+}  // namespace
+
+
+int main()
+{
+	for( size_t i = 0; i < sizeof( Formats ) / sizeof( Format ); ++i )
+		testFormat( Formats[i] );
+
+	// Alpha of RGB formats is opaque
+	unsigned char pixels[64], block[16], decoded[64];
+	makeBlock( Noise, 3, pixels );
+	encodeBC1Block( pixels, block );
+	Horde3DTest::decodeBC1Block( block, decoded );
+	bool opaque = true;
+	for( int i = 0; i < 16; ++i ) opaque &= decoded[i * 4 + 3] == 255;
+	H3D_CHECK( opaque );
+
+	return Horde3DTest::finish( "testBlockCompression" );
+}
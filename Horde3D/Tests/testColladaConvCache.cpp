@@ -0,0 +1,155 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// ColladaConv skips assets whose source and options did not change since they were converted into
+// the same destination. Outputs are replaced by marker text to see whether an asset was converted
+// again: it must be converted when the source, an option or the set of scene graphs compiled in
+// the same run changes, when one of its outputs including the materials is missing and when
+// materials are to be overwritten.
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+
+namespace {
+
+const char *Marker = "marker";
+
+std::string converter, srcDir, outDir;
+
+
+bool writeFile( const std::string &fileName, const std::string &data )
+{
+	std::ofstream out( fileName.c_str(), std::ios::binary );
+	out.write( data.data(), data.size() );
+	return out.good();
+}
+
+
+bool isMarked( const std::string &fileName )
+{
+	std::string data;
+	return Horde3DTest::readFile( outDir + "/" + fileName, data ) && data == Marker;
+}
+
+
+bool convert( const std::string &input, const std::string &options = "" )
+{
+	return Horde3DTest::runColladaConv( converter, input + " -base \"" + srcDir + "\" -dest \"" + outDir + "\" " + options );
+}
+
+
+bool writeModel( int gridSize )
+{
+	Horde3DTest::ColladaSample sample;
+	sample.materialName = "mat";
+	sample.gridSize = gridSize;
+	sample.build();
+	return sample.write( srcDir + "/models/a.dae" );
+}
+
+
+void testModels()
+{
+	H3D_CHECK( writeModel( 4 ) );
+	H3D_CHECK( convert( "models" ) );
+	std::string data;
+	H3D_CHECK( Horde3DTest::readFile( outDir + "/.colladaconv.cache", data ) && !data.empty() );
+
+	// Unchanged
+	H3D_CHECK( writeFile( outDir + "/models/a.geo", Marker ) );
+	H3D_CHECK( convert( "models" ) );
+	H3D_CHECK( isMarked( "models/a.geo" ) );
+
+	// Deleted material
+	H3D_CHECK( remove( (outDir + "/models/mat.material.xml").c_str() ) == 0 );
+	H3D_CHECK( convert( "models" ) );
+	H3D_CHECK( Horde3DTest::readFile( outDir + "/models/mat.material.xml", data ) && !data.empty() );
+	H3D_CHECK( !isMarked( "models/a.geo" ) );
+
+	// Existing materials are only replaced with -overwriteMats
+	H3D_CHECK( writeFile( outDir + "/models/mat.material.xml", Marker ) );
+	H3D_CHECK( convert( "models" ) );
+	H3D_CHECK( isMarked( "models/mat.material.xml" ) );
+	H3D_CHECK( convert( "models", "-overwriteMats" ) );
+	H3D_CHECK( !isMarked( "models/mat.material.xml" ) );
+
+	// Changed option
+	H3D_CHECK( writeFile( outDir + "/models/a.geo", Marker ) );
+	H3D_CHECK( convert( "models", "-noGeoOpt" ) );
+	H3D_CHECK( !isMarked( "models/a.geo" ) );
+
+	// Changed source
+	H3D_CHECK( writeFile( outDir + "/models/a.geo", Marker ) );
+	H3D_CHECK( writeModel( 6 ) );
+	H3D_CHECK( convert( "models", "-noGeoOpt" ) );
+	H3D_CHECK( !isMarked( "models/a.geo" ) );
+
+	// -force
+	H3D_CHECK( writeFile( outDir + "/models/a.geo", Marker ) );
+	H3D_CHECK( convert( "models", "-noGeoOpt -force" ) );
+	H3D_CHECK( !isMarked( "models/a.geo" ) );
+}
+
+
+void testScenes()
+{
+	H3D_CHECK( writeFile( srcDir + "/scenes/main.scene.xml",
+		"<Group name=\"Main\">\n	<Reference sceneGraph=\"scenes/part.scene.xml\" />\n</Group>\n" ) );
+	H3D_CHECK( writeFile( srcDir + "/scenes/part.scene.xml", "<Group name=\"Part\" />\n" ) );
+
+	// The reference points to the binary file of the part only if both are compiled together
+	std::string data;
+	H3D_CHECK( convert( "scenes", "-type scene" ) );
+	H3D_CHECK( Horde3DTest::readFile( outDir + "/scenes/main.scene.bin", data ) );
+	H3D_CHECK( data.find( "scenes/part.scene.bin" ) != std::string::npos );
+
+	H3D_CHECK( convert( "scenes/main.scene.xml", "-type scene" ) );
+	H3D_CHECK( Horde3DTest::readFile( outDir + "/scenes/main.scene.bin", data ) );
+	H3D_CHECK( data.find( "scenes/part.scene.xml" ) != std::string::npos );
+
+	H3D_CHECK( writeFile( outDir + "/scenes/main.scene.bin", Marker ) );
+	H3D_CHECK( convert( "scenes/main.scene.xml", "-type scene" ) );
+	H3D_CHECK( isMarked( "scenes/main.scene.bin" ) );
+	H3D_CHECK( convert( "scenes", "-type scene" ) );
+	H3D_CHECK( !isMarked( "scenes/main.scene.bin" ) );
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: testColladaConvCache <ColladaConv executable>\n" );
+		return 1;
+	}
+	converter = argv[1];
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/colladaConvCache";
+	srcDir = dir + "/src";
+	outDir = dir + "/out";
+
+	Horde3DTest::removeDirectory( dir );
+	H3D_CHECK( Horde3DTest::createDirectory( srcDir + "/models" ) );
+	H3D_CHECK( Horde3DTest::createDirectory( srcDir + "/scenes" ) );
+	H3D_CHECK( Horde3DTest::createDirectory( outDir ) );
+
+	testModels();
+	testScenes();
+
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "testColladaConvCache" );
+}
@@ -0,0 +1,110 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Converting with several jobs must write the same files as a serial conversion. In particular,
+// when assets share a material name, the material of the first asset in input order is written,
+// or that of the last asset when materials are overwritten.
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include <cstdio>
+#include <string>
+
+
+namespace {
+
+const int AssetCount = 6;
+const char *AssetNames[AssetCount] = { "a", "b", "c", "d", "e", "f" };
+
+// Converts into a new output directory unless materials are overwritten
+bool convert( const std::string &converter, const std::string &dir, int jobs, bool overwriteMats = false )
+{
+	std::string dest = dir + "/out" + std::to_string( jobs );
+	if( !overwriteMats )
+	{
+		Horde3DTest::removeDirectory( dest );
+		Horde3DTest::createDirectory( dest );
+	}
+	return Horde3DTest::runColladaConv( converter, "models -base \"" + dir + "/src\" -dest \"" + dest +
+		"\" -jobs " + std::to_string( jobs ) + (overwriteMats ? " -overwriteMats" : "") );
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: testColladaConvJobs <ColladaConv executable>\n" );
+		return 1;
+	}
+	std::string converter = argv[1];
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/colladaConvJobs";
+
+	Horde3DTest::removeDirectory( dir );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/src/models" ) );
+	for( int i = 0; i < AssetCount; ++i )
+	{
+		Horde3DTest::ColladaSample sample;
+		sample.materialName = "shared";
+		sample.diffuseColor[0] = 0.1f * (i + 1);
+		sample.gridSize = i == 0 ? 96 : 8;  // First asset finishes last
+		sample.jointCount = i % 2 == 0 ? 0 : 3;
+		sample.build();
+		H3D_CHECK( sample.write( dir + "/src/models/" + AssetNames[i] + ".dae" ) );
+	}
+
+	// Serial references with a material written only from the first asset or, when overwriting,
+	// from the last one
+	H3D_CHECK( convert( converter, dir, 1 ) );
+	std::string serialMat;
+	H3D_CHECK( Horde3DTest::readFile( dir + "/out1/models/shared.material.xml", serialMat ) );
+	H3D_CHECK( serialMat.find( "a=\"0.1" ) != std::string::npos );
+	std::string serialReplacedMat;
+	H3D_CHECK( convert( converter, dir, 1, true ) );
+	H3D_CHECK( Horde3DTest::readFile( dir + "/out1/models/shared.material.xml", serialReplacedMat ) );
+	H3D_CHECK( serialReplacedMat.find( "a=\"0.6" ) != std::string::npos );
+
+	// Parallel conversions repeatedly, as ownership used to depend on which job finished first
+	for( int run = 0; run < 4; ++run )
+	{
+		int jobs = 2 + run;
+		H3D_CHECK( convert( converter, dir, jobs ) );
+		std::string outDir = dir + "/out" + std::to_string( jobs );
+
+		std::string mat;
+		H3D_CHECK( Horde3DTest::readFile( outDir + "/models/shared.material.xml", mat ) );
+		H3D_CHECK( mat == serialMat );
+
+		// Overwriting replaces it by the material of the last asset
+		H3D_CHECK( convert( converter, dir, jobs, true ) );
+		H3D_CHECK( Horde3DTest::readFile( outDir + "/models/shared.material.xml", mat ) );
+		H3D_CHECK( mat == serialReplacedMat );
+
+		for( int i = 0; i < AssetCount; ++i )
+		{
+			const char *exts[2] = { ".geo", ".scene.xml" };
+			for( int j = 0; j < 2; ++j )
+			{
+				std::string serial, parallel;
+				std::string name = std::string( "/models/" ) + AssetNames[i] + exts[j];
+				H3D_CHECK( Horde3DTest::readFile( dir + "/out1" + name, serial ) );
+				H3D_CHECK( Horde3DTest::readFile( outDir + name, parallel ) );
+				H3D_CHECK( !serial.empty() && serial == parallel );
+			}
+		}
+	}
+
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "testColladaConvJobs" );
+}
@@ -0,0 +1,318 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Generates LODs for a tessellated box with hard edges. Every face has its own normals and texture
+// coordinates, so all box edges are seams. Positions on the seams must be collapsed along the seam
+// with the vertices of both faces, so that the box can be reduced to few triangles while every
+// triangle still uses the attributes of a single face and the shape of the box is kept.
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const int GridSize = 8;  // Quads per face side
+const int NumTris = 6 * GridSize * GridSize * 2;
+
+struct GeoVertex
+{
+	float  pos[3];
+	float  texCoords[2];
+};
+
+
+// Texture coordinates of every face lie in their own cell of a 3x2 atlas
+void faceTexCoords( int face, float u, float v, float *texCoords )
+{
+	texCoords[0] = ((face % 3) + 0.05f + 0.9f * u) / 3;
+	texCoords[1] = ((face / 3) + 0.05f + 0.9f * v) / 2;
+}
+
+
+int texCoordsFace( const float *texCoords )
+{
+	return (int)(texCoords[0] * 3) + 3 * (int)(texCoords[1] * 2);
+}
+
+
+// Axis and direction of the normal of a face
+void faceNormal( int face, int &axis, float &sign )
+{
+	axis = face % 3;
+	sign = face < 3 ? 1.0f : -1.0f;
+}
+
+
+bool writeBox( const std::string &fileName )
+{
+	std::ofstream out( fileName.c_str() );
+	if( !out.good() ) return false;
+
+	std::vector< float > positions, normals, texCoords;
+	std::vector< int > corners;
+	const int side = GridSize + 1;
+	for( int face = 0; face < 6; ++face )
+	{
+		int axis; float sign;
+		faceNormal( face, axis, sign );
+		int t1 = (axis + 1) % 3, t2 = (axis + 2) % 3;
+		for( int j = 0; j < side; ++j )
+		{
+			for( int i = 0; i < side; ++i )
+			{
+				float pos[3];
+				pos[axis] = sign;
+				pos[t1] = -1.0f + 2.0f * i / GridSize;
+				pos[t2] = -1.0f + 2.0f * j / GridSize;
+				positions.insert( positions.end(), pos, pos + 3 );
+
+				float tex[2];
+				faceTexCoords( face, (float)i / GridSize, (float)j / GridSize, tex );
+				texCoords.insert( texCoords.end(), tex, tex + 2 );
+			}
+		}
+		float normal[3] = { 0, 0, 0 };
+		normal[axis] = sign;
+		normals.insert( normals.end(), normal, normal + 3 );
+
+		// t1 x t2 is the normal axis, so negative faces are wound the other way
+		int base = face * side * side;
+		for( int j = 0; j < GridSize; ++j )
+		{
+			for( int i = 0; i < GridSize; ++i )
+			{
+				int quad[4] = { j * side + i, j * side + i + 1, (j + 1) * side + i + 1, (j + 1) * side + i };
+				int order[6] = { 0, 1, 2, 0, 2, 3 };
+				for( int k = 0; k < 6; ++k )
+				{
+					int index = base + quad[order[sign > 0 ? k : 5 - k]];
+					corners.push_back( index );
+					corners.push_back( face );
+					corners.push_back( index );
+				}
+			}
+		}
+	}
+
+	out.precision( 9 );
+	out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+	out << "<COLLADA xmlns=\"http://www.collada.org/2005/11/COLLADASchema\" version=\"1.4.1\">\n";
+	out << "<asset><up_axis>Y_UP</up_axis></asset>\n";
+	out << "<library_effects><effect id=\"fx\"><profile_COMMON><technique sid=\"common\"><phong>";
+	out << "<diffuse><color>0.8 0.8 0.8 1</color></diffuse></phong></technique></profile_COMMON></effect></library_effects>\n";
+	out << "<library_materials><material id=\"mat\" name=\"material\"><instance_effect url=\"#fx\"/></material></library_materials>\n";
+	out << "<library_geometries><geometry id=\"box\" name=\"box\"><mesh>\n";
+
+	const char *sourceNames[3] = { "pos", "nrm", "uv" };
+	const std::vector< float > *sources[3] = { &positions, &normals, &texCoords };
+	for( int i = 0; i < 3; ++i )
+	{
+		int stride = i < 2 ? 3 : 2;
+		out << "<source id=\"box-" << sourceNames[i] << "\"><float_array id=\"box-" << sourceNames[i] << "-array\" count=\"";
+		out << sources[i]->size() << "\">";
+		for( size_t j = 0; j < sources[i]->size(); ++j ) out << (j > 0 ? " " : "") << (*sources[i])[j];
+		out << "</float_array><technique_common><accessor source=\"#box-" << sourceNames[i] << "-array\" count=\"";
+		out << sources[i]->size() / stride << "\" stride=\"" << stride << "\">";
+		for( int j = 0; j < stride; ++j ) out << "<param name=\"" << "XYZ"[j] << "\" type=\"float\"/>";
+		out << "</accessor></technique_common></source>\n";
+	}
+	out << "<vertices id=\"box-vtx\"><input semantic=\"POSITION\" source=\"#box-pos\"/></vertices>\n";
+	out << "<triangles material=\"mat\" count=\"" << corners.size() / 9 << "\">";
+	out << "<input semantic=\"VERTEX\" source=\"#box-vtx\" offset=\"0\"/>";
+	out << "<input semantic=\"NORMAL\" source=\"#box-nrm\" offset=\"1\"/>";
+	out << "<input semantic=\"TEXCOORD\" source=\"#box-uv\" offset=\"2\" set=\"0\"/><p>";
+	for( size_t i = 0; i < corners.size(); ++i ) out << (i > 0 ? " " : "") << corners[i];
+	out << "</p></triangles>\n</mesh></geometry></library_geometries>\n";
+
+	out << "<library_visual_scenes><visual_scene id=\"scene\">\n";
+	out << "<node id=\"boxNode\" name=\"boxNode\"><instance_geometry url=\"#box\"><bind_material><technique_common>";
+	out << "<instance_material symbol=\"mat\" target=\"#mat\"/></technique_common></bind_material></instance_geometry></node>\n";
+	out << "</visual_scene></library_visual_scenes>\n";
+	out << "<scene><instance_visual_scene url=\"#scene\"/></scene>\n</COLLADA>\n";
+
+	return out.good();
+}
+
+
+template< class T > bool read( const std::string &data, size_t &pos, T *values, size_t count )
+{
+	if( pos + sizeof( T ) * count > data.size() ) return false;
+	memcpy( values, &data[pos], sizeof( T ) * count );
+	pos += sizeof( T ) * count;
+	return true;
+}
+
+
+bool loadGeo( const std::string &fileName, std::vector< GeoVertex > &vertices, std::vector< unsigned int > &indices )
+{
+	std::string data;
+	size_t pos = 4;
+	unsigned int version, count, numStreams, numVerts;
+	if( !Horde3DTest::readFile( fileName, data ) || data.compare( 0, 4, "H3DG" ) != 0 ) return false;
+	if( !read( data, pos, &version, 1 ) || version != 5 || !read( data, pos, &count, 1 ) ) return false;
+	pos += count * 16 * sizeof( float );
+	if( !read( data, pos, &numStreams, 1 ) || !read( data, pos, &numVerts, 1 ) ) return false;
+
+	vertices.assign( numVerts, GeoVertex() );
+	for( unsigned int i = 0; i < numStreams; ++i )
+	{
+		unsigned int streamID, elemSize;
+		if( !read( data, pos, &streamID, 1 ) || !read( data, pos, &elemSize, 1 ) ) return false;
+		for( unsigned int j = 0; j < numVerts; ++j )
+		{
+			bool ok = true;
+			if( streamID == 0 ) ok = read( data, pos, vertices[j].pos, 3 );
+			else if( streamID == 6 ) ok = read( data, pos, vertices[j].texCoords, 2 );
+			else pos += elemSize;
+			if( !ok ) return false;
+		}
+	}
+
+	if( !read( data, pos, &count, 1 ) ) return false;
+	indices.resize( count );
+	return count == 0 || read( data, pos, &indices[0], count );
+}
+
+
+int getAttrib( const std::string &tag, const char *name )
+{
+	size_t pos = tag.find( std::string( " " ) + name + "=\"" );
+	return pos != std::string::npos ? atoi( tag.c_str() + pos + strlen( name ) + 3 ) : -1;
+}
+
+
+// Finds the index range of the mesh with the given LOD level in the scene file
+bool findLod( const std::string &scene, int lodLevel, int &batchStart, int &batchCount )
+{
+	for( size_t pos = scene.find( "<Mesh " ); pos != std::string::npos; pos = scene.find( "<Mesh ", pos + 1 ) )
+	{
+		std::string tag = scene.substr( pos, scene.find( '>', pos ) - pos );
+		if( std::max( getAttrib( tag, "lodLevel" ), 0 ) != lodLevel ) continue;
+
+		batchStart = getAttrib( tag, "batchStart" );
+		batchCount = getAttrib( tag, "batchCount" );
+		return batchStart >= 0 && batchCount >= 0;
+	}
+	return false;
+}
+
+
+// Max error of a level as logged by the converter
+float findLodError( const std::string &log, int lodLevel )
+{
+	char prefix[32];
+	sprintf( prefix, "Generated LOD %i:", lodLevel );
+	size_t pos = log.find( prefix );
+	if( pos == std::string::npos ) return -1;
+	pos = log.find( "max error ", pos );
+	return pos != std::string::npos ? (float)atof( log.c_str() + pos + 10 ) : -1;
+}
+
+
+// Checks that the triangles of a level form a closed box and use the attributes of the face they lie on
+void checkLod( const std::vector< GeoVertex > &vertices, const std::vector< unsigned int > &indices,
+               int batchStart, int batchCount )
+{
+	int wrongFaces = 0, offPlane = 0, flipped = 0;
+	double volume = 0;
+	for( int i = batchStart; i + 2 < batchStart + batchCount; i += 3 )
+	{
+		const GeoVertex *v[3] = { &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]] };
+		int face = texCoordsFace( v[0]->texCoords );
+		if( texCoordsFace( v[1]->texCoords ) != face || texCoordsFace( v[2]->texCoords ) != face ) ++wrongFaces;
+
+		int axis; float sign;
+		faceNormal( face, axis, sign );
+		for( int k = 0; k < 3; ++k )
+		{
+			if( fabsf( v[k]->pos[axis] - sign ) > 1e-5f ) ++offPlane;
+		}
+
+		const float *p0 = v[0]->pos, *p1 = v[1]->pos, *p2 = v[2]->pos;
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+		if( normal[axis] * sign <= 0 ) ++flipped;
+
+		// Signed volume of the tetrahedron with the origin
+		volume += (p0[0] * (p1[1] * p2[2] - p1[2] * p2[1]) - p0[1] * (p1[0] * p2[2] - p1[2] * p2[0]) +
+		           p0[2] * (p1[0] * p2[1] - p1[1] * p2[0])) / 6.0;
+	}
+	H3D_CHECK( wrongFaces == 0 );
+	H3D_CHECK( offPlane == 0 );
+	H3D_CHECK( flipped == 0 );
+	H3D_CHECK( fabs( volume - 8.0 ) < 1e-3 );
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: testColladaConvLod <ColladaConv executable>\n" );
+		return 1;
+	}
+	std::string converter = argv[1];
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/colladaConvLod";
+
+	Horde3DTest::removeDirectory( dir );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/src" ) );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/out" ) );
+	H3D_CHECK( writeBox( dir + "/src/box.dae" ) );
+
+	// Output is kept to read the errors of the levels
+	std::string command = "\"" + converter + "\" . -base \"" + dir + "/src\" -dest \"" + dir +
+		"/out\" -noGeoOpt -autoLod 0.5,0.01 > \"" + dir + "/convert.log\"";
+	std::string log, scene;
+	std::vector< GeoVertex > vertices;
+	std::vector< unsigned int > indices;
+	if( !H3D_CHECK( system( command.c_str() ) == 0 ) ||
+	    !H3D_CHECK( Horde3DTest::readFile( dir + "/convert.log", log ) ) ||
+	    !H3D_CHECK( Horde3DTest::readFile( dir + "/out/box.scene.xml", scene ) ) ||
+	    !H3D_CHECK( loadGeo( dir + "/out/box.geo", vertices, indices ) ) )
+	{
+		Horde3DTest::removeDirectory( dir );
+		return Horde3DTest::finish( "testColladaConvLod" );
+	}
+
+	// Hard edges must not keep the box from being reduced to about the requested triangle count;
+	// all collapses are within the faces or along the edges, so the error stays zero
+	const int maxTris[3] = { NumTris, NumTris / 2, 24 };
+	for( int level = 0; level <= 2; ++level )
+	{
+		int batchStart, batchCount;
+		if( !H3D_CHECK( findLod( scene, level, batchStart, batchCount ) ) ) continue;
+
+		printf( "LOD %i: %i triangles\n", level, batchCount / 3 );
+		H3D_CHECK( batchCount / 3 <= maxTris[level] && batchCount >= 12 * 3 );
+		checkLod( vertices, indices, batchStart, batchCount );
+		if( level > 0 )
+		{
+			float error = findLodError( log, level );
+			H3D_CHECK( error >= 0 && error < 1e-4f );
+		}
+	}
+
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "testColladaConvLod" );
+}
@@ -0,0 +1,239 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Converts a skinned grid with seams and tied weights and compares the welded vertices and the
+// four most significant skin weights with a reference implementation of the original converter
+// code, which searched all vertices with the same position index and sorted all weights
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+struct GeoVertex
+{
+	float          pos[3];
+	float          texCoords[2];
+	unsigned char  joints[4];
+	unsigned char  weights[4];
+};
+
+struct GeoData
+{
+	std::vector< GeoVertex >     vertices;
+	std::vector< unsigned int >  indices;
+};
+
+
+// Floats as the converter reads them from the COLLADA text
+std::vector< float > roundTrip( const std::vector< float > &values )
+{
+	std::vector< float > result( values.size() );
+	for( size_t i = 0; i < values.size(); ++i )
+	{
+		std::ostringstream ss;
+		ss.precision( 9 );
+		ss << values[i];
+		result[i] = strtof( ss.str().c_str(), 0x0 );
+	}
+	return result;
+}
+
+
+GeoData buildReference( const Horde3DTest::ColladaSample &sample, bool weldNormals )
+{
+	std::vector< float > normals = roundTrip( sample.normals );
+	std::vector< float > texCoords = roundTrip( sample.texCoords );
+	GeoData geo;
+
+	// Original welding: linear search over the vertices with the same position index
+	std::vector< std::vector< unsigned int > > posIndexToVertices( sample.positions.size() / 3 );
+	std::vector< int > vertNormals;
+	for( size_t k = 0; k < sample.cornerIndices.size(); k += 3 )
+	{
+		int posIndex = sample.cornerIndices[k];
+		const float *n = &normals[sample.cornerIndices[k + 1] * 3];
+		const float *t = &texCoords[sample.cornerIndices[k + 2] * 2];
+
+		std::vector< unsigned int > &vertList = posIndexToVertices[posIndex];
+		unsigned int index = (unsigned int)geo.vertices.size();
+		for( size_t l = 0; l < vertList.size(); ++l )
+		{
+			const GeoVertex &v = geo.vertices[vertList[l]];
+			const float *vn = &normals[vertNormals[vertList[l]] * 3];
+			if( (weldNormals || (vn[0] == n[0] && vn[1] == n[1] && vn[2] == n[2])) &&
+			    v.texCoords[0] == t[0] && v.texCoords[1] == t[1] )
+			{
+				index = vertList[l];
+				break;
+			}
+		}
+		geo.indices.push_back( index );
+		if( index < geo.vertices.size() ) continue;
+
+		GeoVertex v;
+		memset( &v, 0, sizeof( v ) );
+		memcpy( v.pos, &sample.positions[posIndex * 3], sizeof( v.pos ) );
+		v.texCoords[0] = t[0]; v.texCoords[1] = t[1];
+
+		// Original weight selection: sort all weights, take the first four and normalize them
+		if( sample.jointCount > 0 )
+		{
+			std::vector< float > vertWeights( &sample.weights[posIndex * sample.weightsPerVertex * 2],
+				&sample.weights[(posIndex + 1) * sample.weightsPerVertex * 2] );
+			std::vector< float > rounded = roundTrip( vertWeights );
+			for( size_t i = 1; i < vertWeights.size(); i += 2 ) vertWeights[i] = rounded[i];
+
+			for( size_t xx = 0; xx < vertWeights.size() / 2; ++xx )
+			{
+				for( size_t yy = 0; yy < xx; ++yy )
+				{
+					if( vertWeights[xx * 2 + 1] > vertWeights[yy * 2 + 1] )
+					{
+						std::swap( vertWeights[xx * 2], vertWeights[yy * 2] );
+						std::swap( vertWeights[xx * 2 + 1], vertWeights[yy * 2 + 1] );
+					}
+				}
+			}
+
+			float weights[4] = { 0, 0, 0, 0 };
+			for( size_t l = 0; l < 4 && l < vertWeights.size() / 2; ++l )
+			{
+				weights[l] = vertWeights[l * 2 + 1];
+				v.joints[l] = (unsigned char)(vertWeights[l * 2] + 1);  // First joint is identity
+			}
+			float weightSum = weights[0] + weights[1] + weights[2] + weights[3];
+			for( int l = 0; l < 4; ++l ) v.weights[l] = (unsigned char)(weights[l] / weightSum * 255);
+		}
+
+		vertList.push_back( index );
+		vertNormals.push_back( sample.cornerIndices[k + 1] );
+		geo.vertices.push_back( v );
+	}
+
+	return geo;
+}
+
+
+template< class T > bool read( const std::string &data, size_t &pos, T *values, size_t count )
+{
+	if( pos + sizeof( T ) * count > data.size() ) return false;
+	memcpy( values, &data[pos], sizeof( T ) * count );
+	pos += sizeof( T ) * count;
+	return true;
+}
+
+
+bool loadGeo( const std::string &fileName, GeoData &geo )
+{
+	std::string data;
+	size_t pos = 4;
+	unsigned int version, count, numStreams, numVerts;
+	if( !Horde3DTest::readFile( fileName, data ) || data.compare( 0, 4, "H3DG" ) != 0 ) return false;
+	if( !read( data, pos, &version, 1 ) || version != 5 || !read( data, pos, &count, 1 ) ) return false;
+	pos += count * 16 * sizeof( float );
+	if( !read( data, pos, &numStreams, 1 ) || !read( data, pos, &numVerts, 1 ) ) return false;
+
+	geo.vertices.assign( numVerts, GeoVertex() );
+	for( unsigned int i = 0; i < numStreams; ++i )
+	{
+		unsigned int streamID, elemSize;
+		if( !read( data, pos, &streamID, 1 ) || !read( data, pos, &elemSize, 1 ) ) return false;
+		for( unsigned int j = 0; j < numVerts; ++j )
+		{
+			GeoVertex &v = geo.vertices[j];
+			bool ok = true;
+			switch( streamID )
+			{
+			case 0: ok = read( data, pos, v.pos, 3 ); break;
+			case 4: ok = read( data, pos, v.joints, 4 ); break;
+			case 5: ok = read( data, pos, v.weights, 4 ); break;
+			case 6: ok = read( data, pos, v.texCoords, 2 ); break;
+			default: pos += elemSize;
+			}
+			if( !ok ) return false;
+		}
+	}
+
+	if( !read( data, pos, &count, 1 ) ) return false;
+	geo.indices.resize( count );
+	return count == 0 || read( data, pos, &geo.indices[0], count );
+}
+
+
+bool compare( const GeoData &ref, const GeoData &geo )
+{
+	if( !H3D_CHECK( ref.vertices.size() == geo.vertices.size() ) ) return false;
+	if( !H3D_CHECK( ref.indices == geo.indices ) ) return false;
+
+	int mismatches = 0;
+	for( size_t i = 0; i < ref.vertices.size(); ++i )
+	{
+		const GeoVertex &a = ref.vertices[i], &b = geo.vertices[i];
+		for( int j = 0; j < 3; ++j ) if( fabsf( a.pos[j] - b.pos[j] ) > 1e-4f ) ++mismatches;
+		if( a.texCoords[0] != b.texCoords[0] || a.texCoords[1] != b.texCoords[1] ) ++mismatches;
+		if( memcmp( a.joints, b.joints, 4 ) != 0 || memcmp( a.weights, b.weights, 4 ) != 0 ) ++mismatches;
+	}
+	return H3D_CHECK( mismatches == 0 );
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: testColladaConvWelding <ColladaConv executable>\n" );
+		return 1;
+	}
+	std::string converter = argv[1];
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/colladaConvWelding";
+
+	Horde3DTest::removeDirectory( dir );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/src" ) );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/out" ) );
+
+	Horde3DTest::ColladaSample sample;
+	sample.gridSize = 12;
+	sample.jointCount = 5;
+	sample.weightsPerVertex = 7;
+	sample.build();
+	H3D_CHECK( sample.write( dir + "/src/skinned.dae" ) );
+
+	// Exact welding as before
+	GeoData geo;
+	H3D_CHECK( Horde3DTest::runColladaConv( converter, ". -base \"" + dir + "/src\" -dest \"" + dir +
+		"/out\" -noGeoOpt -force" ) );
+	if( H3D_CHECK( loadGeo( dir + "/out/skinned.geo", geo ) ) ) compare( buildReference( sample, false ), geo );
+
+	// A weld epsilon larger than the normal seam merges the vertices on it, but not the texture seam
+	H3D_CHECK( Horde3DTest::runColladaConv( converter, ". -base \"" + dir + "/src\" -dest \"" + dir +
+		"/out\" -noGeoOpt -force -weldEps 0.001" ) );
+	GeoData refWelded = buildReference( sample, true );
+	if( H3D_CHECK( loadGeo( dir + "/out/skinned.geo", geo ) ) )
+	{
+		H3D_CHECK( refWelded.vertices.size() < buildReference( sample, false ).vertices.size() );
+		compare( refWelded, geo );
+	}
+
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "testColladaConvWelding" );
+}
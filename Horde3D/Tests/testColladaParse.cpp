@@ -0,0 +1,154 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// The number parsers of the COLLADA converter must give the same floats as strtof and the same
+// arrays no matter whether they are parsed serially or in parallel
+
+#include "testCommon.h"
+#include "utils.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Horde3D::ColladaConverter;
+
+
+namespace {
+
+bool sameFloat( float a, float b )
+{
+	return memcmp( &a, &b, sizeof( float ) ) == 0;
+}
+
+
+float parse( const std::string &text )
+{
+	std::vector< char > buf( text.begin(), text.end() );
+	buf.push_back( '\0' );
+	char *str = &buf[0];
+	float f = 1.0f;
+	parseFloat( str, f );
+	return f;
+}
+
+
+void testSpecialValues()
+{
+	// Zero mantissas stay zero for any exponent and keep their sign
+	H3D_CHECK( sameFloat( parse( "0e400" ), 0.0f ) );
+	H3D_CHECK( sameFloat( parse( "-0e400" ), -0.0f ) );
+	H3D_CHECK( sameFloat( parse( "0.000e-400" ), 0.0f ) );
+	H3D_CHECK( sameFloat( parse( "-0.0" ), -0.0f ) );
+
+	H3D_CHECK( parse( "1e400" ) == INFINITY );
+	H3D_CHECK( parse( "-1e99999999999" ) == -INFINITY );
+	H3D_CHECK( sameFloat( parse( "1e-400" ), 0.0f ) );
+	H3D_CHECK( sameFloat( parse( "1e-40" ), strtof( "1e-40", 0x0 ) ) );  // Denormal
+
+	// Nearest double lies exactly halfway between two floats, but the value is slightly above
+	H3D_CHECK( sameFloat( parse( "1.000000059604645" ), strtof( "1.000000059604645", 0x0 ) ) );
+	H3D_CHECK( parse( "1.000000059604645" ) > 1.0f );
+
+	// Long mantissas
+	const char *longValue = "3.14159265358979323846264338327950288419716939937510582097494459";
+	H3D_CHECK( sameFloat( parse( longValue ), strtof( longValue, 0x0 ) ) );
+}
+
+
+void testRandomValues()
+{
+	std::mt19937 rng( 1234 );
+	std::uniform_int_distribution< int > digit( 0, 9 ), length( 1, 30 ), exponent( -50, 50 );
+	const char *formats[] = { "%.6g", "%.9g", "%.17g", "%f" };
+
+	int mismatches = 0;
+	for( int i = 0; i < 200000; ++i )
+	{
+		char text[128];
+		if( i % 2 == 0 )
+		{
+			// Formatted floats as written by exporters
+			float value = std::ldexp( std::uniform_real_distribution< float >( -1.0f, 1.0f )( rng ), exponent( rng ) );
+			snprintf( text, sizeof( text ), formats[(i / 2) % 4], value );
+		}
+		else
+		{
+			// Random digit strings
+			int len = length( rng ), pos = 0, dot = len > 1 ? digit( rng ) % len : len;
+			if( i % 3 == 0 ) text[pos++] = '-';
+			for( int j = 0; j < len; ++j )
+			{
+				if( j == dot ) text[pos++] = '.';
+				text[pos++] = (char)('0' + digit( rng ));
+			}
+			snprintf( text + pos, sizeof( text ) - pos, "e%i", exponent( rng ) );
+		}
+
+		if( !sameFloat( parse( text ), strtof( text, 0x0 ) ) )
+		{
+			if( mismatches++ < 10 ) printf( "Mismatch for %s\n", text );
+		}
+	}
+	H3D_CHECK( mismatches == 0 );
+}
+
+
+// The way index lists are read when only one job is used
+void parseSerially( std::string text, std::vector< int > &values )
+{
+	char *str = &text[0];
+	int value;
+	while( parseInt( str, value ) ) values.push_back( value );
+}
+
+
+void testArrays()
+{
+	// Large enough to be split into chunks, with an invalid token in a later chunk
+	std::string text;
+	for( int i = 0; i < 600000; ++i )
+	{
+		text += std::to_string( i % 1000 ) + (i % 7 == 0 ? "\n" : " ");
+		if( i == 400000 ) text += "x ";
+	}
+
+	std::vector< int > serial, parallel, singleJob;
+	parseSerially( text, serial );
+	H3D_CHECK( serial.size() == 400001 );
+
+	std::string copy = text;
+	setJobCount( 1 );
+	parseIntArray( &copy[0], singleJob );
+	copy = text;
+	setJobCount( 4 );
+	parseIntArray( &copy[0], parallel );
+	setJobCount( 1 );
+
+	H3D_CHECK( singleJob == serial );
+	H3D_CHECK( parallel == serial );
+}
+
+}  // namespace
+
+
+int main()
+{
+	testSpecialValues();
+	testRandomValues();
+	testArrays();
+
+	return Horde3DTest::finish( "testColladaParse" );
+}
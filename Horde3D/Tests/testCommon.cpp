@@ -0,0 +1,181 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifdef H3D_TEST_EGL
+#	include <EGL/egl.h>
+#	include <EGL/eglext.h>
+#endif
+
+
+namespace Horde3DTest {
+
+static int _checks = 0;
+static int _failures = 0;
+
+bool check( bool condition, const char *expr, const char *file, int line )
+{
+	++_checks;
+	if( !condition )
+	{
+		++_failures;
+		printf( "%s:%i: check failed: %s\n", file, line, expr );
+	}
+	return condition;
+}
+
+
+int finish( const char *name )
+{
+	printf( "%s: %i checks, %i failures\n", name, _checks, _failures );
+	return _failures == 0 ? 0 : 1;
+}
+
+
+bool quickMode( int argc, char **argv )
+{
+	for( int i = 1; i < argc; ++i )
+	{
+		if( strcmp( argv[i], "--quick" ) == 0 ) return true;
+	}
+	return false;
+}
+
+
+double getTimeMS()
+{
+	return std::chrono::duration< double, std::milli >(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+const char *contentDir()
+{
+	return H3D_TEST_CONTENT_DIR;
+}
+
+
+const char *terrainContentDir()
+{
+	return H3D_TEST_TERRAIN_CONTENT_DIR;
+}
+
+
+const char *tempDir()
+{
+	return H3D_TEST_TEMP_DIR;
+}
+
+// =================================================================================================
+// Headless context
+// =================================================================================================
+
+#ifdef H3D_TEST_EGL
+
+static EGLDisplay _display = EGL_NO_DISPLAY;
+static EGLContext _context = EGL_NO_CONTEXT;
+
+static bool createContext()
+{
+	// Surfaceless platform does not need a window system (llvmpipe works as well)
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+	if( getPlatformDisplay == 0x0 ) return false;
+
+	_display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0x0 );
+	if( _display == EGL_NO_DISPLAY ) return false;
+
+	EGLint major, minor;
+	if( !eglInitialize( _display, &major, &minor ) || !eglBindAPI( EGL_OPENGL_API ) ) return false;
+
+	const EGLint attribs[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+	_context = eglCreateContext( _display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs );
+	if( _context == EGL_NO_CONTEXT ) return false;
+
+	return eglMakeCurrent( _display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context ) == EGL_TRUE;
+}
+
+
+static void renderThreadCallback( int event, void *userData )
+{
+	(void)userData;
+
+	// Surfaceless contexts have nothing to present
+	if( event == H3DRenderThreadEvents::AcquireContext )
+		eglMakeCurrent( _display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context );
+	else if( event == H3DRenderThreadEvents::ReleaseContext )
+		eglMakeCurrent( _display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+}
+
+
+static void destroyContext()
+{
+	if( _display == EGL_NO_DISPLAY ) return;
+
+	eglMakeCurrent( _display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+	if( _context != EGL_NO_CONTEXT ) eglDestroyContext( _display, _context );
+	eglTerminate( _display );
+	_display = EGL_NO_DISPLAY;
+	_context = EGL_NO_CONTEXT;
+}
+
+#else
+
+static bool createContext() { return false; }
+static void destroyContext() {}
+static void renderThreadCallback( int event, void *userData ) { (void)event; (void)userData; }
+
+#endif
+
+
+bool initEngine()
+{
+	if( !createContext() )
+	{
+		printf( "No headless OpenGL context available, skipping\n" );
+		destroyContext();
+		return false;
+	}
+
+	if( !h3dInit( H3DRenderDevice::OpenGL4 ) )
+	{
+		h3dutDumpMessages();
+		printf( "Engine initialization failed, skipping\n" );
+		destroyContext();
+		return false;
+	}
+
+	return true;
+}
+
+
+void releaseEngine()
+{
+	h3dRelease();
+	destroyContext();
+}
+
+
+bool enablePipelinedRendering( bool enabled )
+{
+	h3dSetRenderThreadCallback( renderThreadCallback, 0x0 );
+	return h3dSetOption( H3DOptions::PipelinedRendering, enabled ? 1.0f : 0.0f );
+}
+
+}  // namespace
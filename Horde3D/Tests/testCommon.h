@@ -0,0 +1,42 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+#ifndef _testCommon_H_
+#define _testCommon_H_
+
+// Minimal helpers shared by the regression tests and benchmarks. Tests return TestSkipped when
+// no headless OpenGL context can be created so that ctest reports them as skipped.
+
+namespace Horde3DTest {
+
+const int TestSkipped = 77;
+
+bool check( bool condition, const char *expr, const char *file, int line );
+int finish( const char *name );  // Prints summary, returns process exit code
+
+// Benchmarks run a reduced number of iterations when started with --quick (as done by ctest)
+bool quickMode( int argc, char **argv );
+double getTimeMS();
+
+// Creates a headless OpenGL 4.3 core context and initializes the engine with it
+bool initEngine();
+void releaseEngine();
+bool enablePipelinedRendering( bool enabled );
+const char *contentDir();
+const char *terrainContentDir();  // Content of the terrain sample, which overrides the terrain shader
+const char *tempDir();
+
+}
+
+#define H3D_CHECK( cond ) Horde3DTest::check( (cond), #cond, __FILE__, __LINE__ )
+
+#endif // _testCommon_H_
@@ -0,0 +1,137 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Geometry clones share index and static vertex data with the geometry they were cloned from.
+// Writing these streams copies the data first, so that no other geometry sees the change. When the
+// owner of the data is unloaded while clones are alive, the first clone takes the data over.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "egGeometry.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace Horde3D;
+
+
+namespace {
+
+size_t indexSize, staticSize;
+
+const void *mapIndices( H3DRes res, bool write = false )
+{
+	const void *data = h3dMapResStream( res, H3DGeoRes::GeometryElem, 0, H3DGeoRes::GeoIndexStream, true, write );
+	if( !write ) h3dUnmapResStream( res );
+	return data;
+}
+
+
+std::string readIndices( H3DRes res )
+{
+	const char *data = (const char *)mapIndices( res );
+	return data != 0x0 ? std::string( data, indexSize ) : std::string();
+}
+
+
+// Changes the first index, so that the change is visible in the data of the geometry
+void writeFirstIndex( H3DRes res, int stream )
+{
+	char *data = (char *)h3dMapResStream( res, H3DGeoRes::GeometryElem, 0, stream, true, true );
+	if( H3D_CHECK( data != 0x0 ) ) data[0] ^= 1;
+	h3dUnmapResStream( res );
+}
+
+}  // namespace
+
+
+int main()
+{
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+
+	H3DRes owner = h3dAddResource( H3DResTypes::Geometry, "models/sphere/sphere.geo", 0 );
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+	if( !H3D_CHECK( h3dIsResLoaded( owner ) ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "testGeometrySharing" );
+	}
+
+	int indexCount = h3dGetResParamI( owner, H3DGeoRes::GeometryElem, 0, H3DGeoRes::GeoIndexCountI );
+	int vertCount = h3dGetResParamI( owner, H3DGeoRes::GeometryElem, 0, H3DGeoRes::GeoVertexCountI );
+	bool indices16 = h3dGetResParamI( owner, H3DGeoRes::GeometryElem, 0, H3DGeoRes::GeoIndices16I ) != 0;
+	indexSize = indexCount * (indices16 ? 2 : 4);
+	staticSize = vertCount * sizeof( VertexDataStatic );
+	std::string indices = readIndices( owner );
+
+	// Each clone saves the CPU copy and the GPU buffer of the indices and static vertex data
+	const size_t sharedSize = 2 * (indexSize + staticSize);
+	size_t baseMem = GeometryResource::getSharedMem();
+	H3DRes cloneA = h3dCloneResource( owner, "cloneA" );
+	H3DRes cloneB = h3dCloneResource( owner, "cloneB" );
+	H3DRes cloneC = h3dCloneResource( cloneA, "cloneC" );  // Shares the data of the owner as well
+	if( !H3D_CHECK( cloneA != 0 && cloneB != 0 && cloneC != 0 ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "testGeometrySharing" );
+	}
+	H3D_CHECK( GeometryResource::getSharedMem() - baseMem == 3 * sharedSize );
+	H3D_CHECK( mapIndices( cloneA ) == mapIndices( owner ) && mapIndices( cloneB ) == mapIndices( owner ) &&
+	           mapIndices( cloneC ) == mapIndices( owner ) );
+
+	// Shared data is accounted to the owner
+	int ownerCpu, ownerGpu, cloneCpu, cloneGpu;
+	h3dGetResMemoryUsage( owner, &ownerCpu, &ownerGpu );
+	h3dGetResMemoryUsage( cloneA, &cloneCpu, &cloneGpu );
+	H3D_CHECK( ownerCpu - cloneCpu == (int)(indexSize + staticSize) );
+	H3D_CHECK( ownerGpu - cloneGpu == (int)(indexSize + staticSize) );
+
+	// Tangents are private to each clone
+	writeFirstIndex( cloneC, H3DGeoRes::GeoVertTanStream );
+	H3D_CHECK( GeometryResource::getSharedMem() - baseMem == 3 * sharedSize );
+
+	// Owner is unloaded while its clones are alive; the first clone takes over the data
+	const void *sharedIndices = mapIndices( owner );
+	h3dUnloadResource( owner );
+	h3dRemoveResource( owner );
+	h3dReleaseUnusedResources();
+	H3D_CHECK( GeometryResource::getSharedMem() - baseMem == 2 * sharedSize );
+	H3D_CHECK( mapIndices( cloneA ) == sharedIndices && mapIndices( cloneB ) == sharedIndices &&
+	           mapIndices( cloneC ) == sharedIndices );
+	H3D_CHECK( readIndices( cloneA ) == indices );
+	h3dGetResMemoryUsage( cloneA, &cloneCpu, &cloneGpu );
+	H3D_CHECK( cloneCpu == ownerCpu && cloneGpu == ownerGpu );
+
+	// Writing a clone copies the data for this clone only
+	writeFirstIndex( cloneB, H3DGeoRes::GeoIndexStream );
+	H3D_CHECK( GeometryResource::getSharedMem() - baseMem == sharedSize );
+	H3D_CHECK( mapIndices( cloneB ) != sharedIndices && readIndices( cloneB ) != indices );
+	H3D_CHECK( mapIndices( cloneC ) == sharedIndices && readIndices( cloneA ) == indices );
+
+	// Writing the owner copies the data for all clones that share it
+	writeFirstIndex( cloneA, H3DGeoRes::GeoVertStaticStream );
+	H3D_CHECK( GeometryResource::getSharedMem() == baseMem );
+	H3D_CHECK( mapIndices( cloneC ) != mapIndices( cloneA ) && readIndices( cloneC ) == indices );
+	writeFirstIndex( cloneA, H3DGeoRes::GeoIndexStream );
+	H3D_CHECK( readIndices( cloneA ) != indices && readIndices( cloneC ) == indices );
+
+	h3dRemoveResource( cloneA );
+	h3dRemoveResource( cloneB );
+	h3dRemoveResource( cloneC );
+	h3dReleaseUnusedResources();
+	H3D_CHECK( GeometryResource::getSharedMem() == baseMem );
+
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "testGeometrySharing" );
+}
@@ -0,0 +1,180 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Loads geometry of version 6: static geometry without CPU copies of its vertex data can be
+// cloned, skinned geometry keeps its data for software skinning and section sizes that only
+// match because of a 32 bit overflow are rejected
+
+#include "testCommon.h"
+#include "colladaSample.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+
+namespace {
+
+std::string dir;
+
+H3DRes loadGeometry( const std::string &fileName, const std::string &resName )
+{
+	std::string data;
+	if( !Horde3DTest::readFile( dir + "/" + fileName, data ) ) return 0;
+
+	H3DRes res = h3dAddResource( H3DResTypes::Geometry, resName.c_str(), 0 );
+	if( !h3dLoadResource( res, data.data(), (int)data.size() ) )
+	{
+		h3dRemoveResource( res );
+		return 0;
+	}
+	return res;
+}
+
+
+// Returns a copy of a stream or an empty string if the stream has no CPU copy
+std::string readStream( H3DRes res, int stream, int elemSize )
+{
+	int count = h3dGetResParamI( res, H3DGeoRes::GeometryElem, 0, H3DGeoRes::GeoVertexCountI );
+	const char *data = (const char *)h3dMapResStream( res, H3DGeoRes::GeometryElem, 0, stream, true, false );
+	std::string result = data != 0x0 ? std::string( data, count * elemSize ) : std::string();
+	h3dUnmapResStream( res );
+	return result;
+}
+
+
+bool similar( const std::string &a, const std::string &b, int firstFloat, int numFloats, int stride, float tolerance )
+{
+	if( a.size() != b.size() || a.empty() ) return false;
+
+	for( size_t i = 0; i < a.size(); i += stride * sizeof( float ) )
+	{
+		for( int j = firstFloat; j < firstFloat + numFloats; ++j )
+		{
+			float fa, fb;
+			memcpy( &fa, &a[i + j * sizeof( float )], sizeof( float ) );
+			memcpy( &fb, &b[i + j * sizeof( float )], sizeof( float ) );
+			if( fabsf( fa - fb ) > tolerance ) return false;
+		}
+	}
+	return true;
+}
+
+
+void testClone( H3DRes reference, const std::string &fileName, bool quantized )
+{
+	const int tanSize = 7 * sizeof( float ), staticSize = 12 * sizeof( float );
+	H3DRes res = loadGeometry( fileName, fileName );
+	if( !H3D_CHECK( res != 0 ) ) return;
+	H3D_CHECK( readStream( res, H3DGeoRes::GeoVertTanStream, tanSize ).empty() );
+
+	H3DRes clone = h3dCloneResource( res, "" );
+	if( !H3D_CHECK( clone != 0 ) ) return;
+
+	// Clones get the vertex data as stored in the file, so it matches version 5 up to its precision
+	std::string refTan = readStream( reference, H3DGeoRes::GeoVertTanStream, tanSize );
+	std::string refStatic = readStream( reference, H3DGeoRes::GeoVertStaticStream, staticSize );
+	std::string cloneTan = readStream( clone, H3DGeoRes::GeoVertTanStream, tanSize );
+	std::string cloneStatic = readStream( clone, H3DGeoRes::GeoVertStaticStream, staticSize );
+	H3D_CHECK( similar( refTan, cloneTan, 0, 7, 7, quantized ? 4e-3f : 1e-4f ) );
+	if( !quantized ) H3D_CHECK( similar( refStatic, cloneStatic, 0, 12, 12, 0.0f ) );
+	else H3D_CHECK( similar( refStatic, cloneStatic, 2, 8, 12, 4e-3f ) );  // Skinning data
+
+	// The source shares its data with the clone now
+	H3D_CHECK( readStream( res, H3DGeoRes::GeoVertTanStream, tanSize ) == cloneTan );
+	H3D_CHECK( h3dGetStat( H3DStats::GeometrySharedMem, false ) > 0 );
+
+	h3dRemoveResource( clone );
+	h3dRemoveResource( res );
+	h3dReleaseUnusedResources();
+}
+
+
+void testSectionSizeOverflow( const std::string &fileName )
+{
+	std::string data;
+	if( !H3D_CHECK( Horde3DTest::readFile( dir + "/" + fileName, data ) ) ) return;
+
+	// Joint count of 2^28 needs 2^34 bytes, which is 0 in 32 bits like the empty joint section
+	std::string corrupt = data;
+	unsigned int value = 0x10000000;
+	memcpy( &corrupt[12], &value, 4 );
+	H3DRes res = h3dAddResource( H3DResTypes::Geometry, "corruptJoints", 0 );
+	H3D_CHECK( !h3dLoadResource( res, corrupt.data(), (int)corrupt.size() ) );
+
+	// 2^31 16 bit indices with an empty index section
+	corrupt = data;
+	value = 0x80000000;
+	memcpy( &corrupt[20], &value, 4 );
+	value = 0;
+	memcpy( &corrupt[32 + 4 * 12 + 8], &value, 4 );
+	res = h3dAddResource( H3DResTypes::Geometry, "corruptIndices", 0 );
+	H3D_CHECK( !h3dLoadResource( res, corrupt.data(), (int)corrupt.size() ) );
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: testGeometryV6 <ColladaConv executable>\n" );
+		return 1;
+	}
+	std::string converter = argv[1];
+	dir = std::string( Horde3DTest::tempDir() ) + "/geometryV6";
+
+	Horde3DTest::removeDirectory( dir );
+	H3D_CHECK( Horde3DTest::createDirectory( dir + "/src" ) );
+
+	Horde3DTest::ColladaSample sample;
+	sample.gridSize = 16;
+	sample.build();
+	H3D_CHECK( sample.write( dir + "/src/static.dae" ) );
+	sample.jointCount = 1;
+	sample.weightsPerVertex = 1;
+	sample.build();
+	H3D_CHECK( sample.write( dir + "/src/skinned.dae" ) );
+
+	const char *versions[3][2] = { { "v5", "" }, { "v6", "-geoVersion 6" }, { "v6q", "-quantize" } };
+	for( int i = 0; i < 3; ++i )
+	{
+		std::string outDir = dir + "/" + versions[i][0];
+		H3D_CHECK( Horde3DTest::createDirectory( outDir ) );
+		H3D_CHECK( Horde3DTest::runColladaConv( converter, ". -base \"" + dir + "/src\" -dest \"" + outDir +
+			"\" " + versions[i][1] ) );
+	}
+
+	if( !Horde3DTest::initEngine() )
+	{
+		Horde3DTest::removeDirectory( dir );
+		return Horde3DTest::TestSkipped;
+	}
+
+	H3DRes reference = loadGeometry( "v5/static.geo", "v5/static.geo" );
+	H3D_CHECK( reference != 0 );
+	testClone( reference, "v6/static.geo", false );
+	testClone( reference, "v6q/static.geo", true );
+
+	// Skinning needs the vertex data even with a single joint
+	H3DRes skinned = loadGeometry( "v6/skinned.geo", "v6/skinned.geo" );
+	H3D_CHECK( skinned != 0 && !readStream( skinned, H3DGeoRes::GeoVertTanStream, 7 * sizeof( float ) ).empty() );
+
+	testSectionSizeOverflow( "v6/static.geo" );
+
+	Horde3DTest::releaseEngine();
+	Horde3DTest::removeDirectory( dir );
+	return Horde3DTest::finish( "testGeometryV6" );
+}
@@ -0,0 +1,160 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// With pipelined rendering a frame must be lit and shadowed by the lights as they were when the
+// frame was finalized, even if the application moves, changes or removes them while the frame is
+// rendered.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+const int ImageSize = 128;
+
+H3DRes lightMat, outputTex;
+H3DNode camera, light;
+
+
+void addLight()
+{
+	light = h3dAddLightNode( H3DRootNode, "Light", lightMat, "LIGHTING", "SHADOWMAP" );
+}
+
+
+// The states differ in transformation, color, radius and cone; everything else is reset
+void applyState( int state )
+{
+	if( state == 0 )
+	{
+		h3dSetNodeTransform( light, -3, 6, 3, -60, -30, 0, 1, 1, 1 );
+		h3dSetNodeParamF( light, H3DLight::ColorF3, 0, 1.0f );
+		h3dSetNodeParamF( light, H3DLight::ColorF3, 1, 0.8f );
+		h3dSetNodeParamF( light, H3DLight::ColorF3, 2, 0.6f );
+		h3dSetNodeParamF( light, H3DLight::RadiusF, 0, 20 );
+		h3dSetNodeParamF( light, H3DLight::FovF, 0, 90 );
+	}
+	else
+	{
+		h3dSetNodeTransform( light, 3, 5, -1, -70, 120, 0, 1, 1, 1 );
+		h3dSetNodeParamF( light, H3DLight::ColorF3, 0, 0.3f );
+		h3dSetNodeParamF( light, H3DLight::ColorF3, 1, 0.6f );
+		h3dSetNodeParamF( light, H3DLight::ColorF3, 2, 1.0f );
+		h3dSetNodeParamF( light, H3DLight::RadiusF, 0, 12 );
+		h3dSetNodeParamF( light, H3DLight::FovF, 0, 60 );
+	}
+	h3dSetNodeParamF( light, H3DLight::ColorMultiplierF, 0, 1.0f );
+	h3dSetNodeParamI( light, H3DLight::ShadowMapCountI, 1 );
+}
+
+
+void renderFrame()
+{
+	h3dRender( camera );
+	h3dFinalizeFrame();
+}
+
+
+std::vector< unsigned char > readImage()
+{
+	std::vector< unsigned char > image( ImageSize * ImageSize * 4 );
+	const void *pixels = h3dMapResStream( outputTex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, true, false );
+	if( pixels != 0x0 ) memcpy( &image[0], pixels, image.size() );
+	h3dUnmapResStream( outputTex );
+	return image;
+}
+
+}  // namespace
+
+
+int main()
+{
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+
+	H3DRes pipeline = h3dAddResource( H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml", 0 );
+	lightMat = h3dAddResource( H3DResTypes::Material, "materials/light.material.xml", 0 );
+	H3DRes platformRes = h3dAddResource( H3DResTypes::SceneGraph, "models/platform/platform.scene.xml", 0 );
+	H3DRes sphereRes = h3dAddResource( H3DResTypes::SceneGraph, "models/sphere/sphere.scene.xml", 0 );
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+
+	outputTex = h3dCreateTexture( "lightOutput", ImageSize, ImageSize, H3DFormats::TEX_BGRA8,
+	                              H3DResFlags::TexRenderable | H3DResFlags::NoTexMipmaps );
+	camera = h3dAddCameraNode( H3DRootNode, "Camera", pipeline );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportWidthI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportHeightI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::OutTexResI, outputTex );
+	h3dSetupCameraView( camera, 60.0f, 1.0f, 0.5f, 100.0f );
+	h3dSetNodeTransform( camera, 0, 4, 8, -25, 0, 0, 1, 1, 1 );
+	h3dResizePipelineBuffers( pipeline, ImageSize, ImageSize );
+
+	// Sphere casting a shadow on the platform
+	H3DNode platform = h3dAddNodes( H3DRootNode, platformRes );
+	h3dSetNodeTransform( platform, 0, 0, 0, 0, 0, 0, 0.5f, 0.5f, 0.5f );
+	H3DNode sphere = h3dAddNodes( H3DRootNode, sphereRes );
+	h3dSetNodeTransform( sphere, 0, 1.5f, 0, 0, 0, 0, 1, 1, 1 );
+	addLight();
+
+	// Reference images rendered without pipelining (first frame differs slightly, so render twice)
+	std::vector< unsigned char > reference[2];
+	for( int i = 0; i < 4; ++i )
+	{
+		applyState( i % 2 );
+		renderFrame();
+		reference[i % 2] = readImage();
+	}
+	H3D_CHECK( reference[0] != reference[1] );
+
+	if( !H3D_CHECK( Horde3DTest::enablePipelinedRendering( true ) ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "testLightPipelining" );
+	}
+
+	int mismatches = 0;
+	for( int frame = 0; frame < 24; ++frame )
+	{
+		int current = frame % 2;
+		applyState( current );
+		renderFrame();
+
+		// Modify the light while the frame is in flight
+		switch( frame % 4 )
+		{
+		case 0:
+			h3dRemoveNode( light );
+			addLight();
+			applyState( 1 - current );
+			break;
+		case 1:
+			applyState( 1 - current );
+			break;
+		case 2:
+			h3dSetNodeParamF( light, H3DLight::ColorMultiplierF, 0, 0.0f );
+			break;
+		case 3:
+			h3dSetNodeParamI( light, H3DLight::ShadowMapCountI, 0 );
+			break;
+		}
+
+		if( readImage() != reference[current] ) ++mismatches;
+	}
+	H3D_CHECK( mismatches == 0 );
+
+	Horde3DTest::enablePipelinedRendering( false );
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "testLightPipelining" );
+}
@@ -0,0 +1,93 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Message callback may reenter the log and is only invoked on the thread that initialized the engine.
+// Messages of that thread reach the callback right away, messages that fail to format are empty.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "egModules.h"
+#include "egCom.h"
+#include <atomic>
+#include <clocale>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Horde3D;
+
+
+namespace {
+
+std::thread::id mainThread;
+std::atomic< int > callbackCount( 0 );
+std::atomic< int > foreignThreadCalls( 0 );
+int reentrantMessages = 0;
+std::string lastMessage;
+
+void messageCallback( int level, const char *message )
+{
+	(void)level; (void)message;
+
+	++callbackCount;
+	if( std::this_thread::get_id() != mainThread ) ++foreignThreadCalls;
+	else lastMessage = message;
+
+	// Used to deadlock since the log lock was held while invoking the callback
+	int msgLevel;
+	float msgTime;
+	while( *h3dGetMessage( &msgLevel, &msgTime ) != '\0' ) ++reentrantMessages;
+}
+
+}  // namespace
+
+
+int main()
+{
+	mainThread = std::this_thread::get_id();
+	h3dSetMessageCallback( messageCallback );
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+
+	h3dFinalizeFrame();
+	H3D_CHECK( callbackCount > 0 );
+
+	// Messages of the main thread don't wait for the next frame
+	int before = callbackCount;
+	Modules::log().writeWarning( "Immediate message %i", 1 );
+	H3D_CHECK( callbackCount == before + 1 && lastMessage == "Immediate message 1" );
+
+	// A wide character that can't be represented in the C locale makes formatting fail
+	setlocale( LC_CTYPE, "C" );
+	Modules::log().writeWarning( "Unencodable %ls", L"\u00e4" );
+	H3D_CHECK( callbackCount == before + 2 && lastMessage.empty() );
+
+	// Enough messages from several threads to overflow the ring buffer
+	before = callbackCount;
+	std::vector< std::thread > writers;
+	for( int t = 0; t < 4; ++t )
+	{
+		writers.push_back( std::thread( [t]() {
+			for( int i = 0; i < 1000; ++i ) Modules::log().writeInfo( "Writer %i message %i", t, i );
+		} ) );
+	}
+	for( int i = 0; i < 1000; ++i ) Modules::log().writeInfo( "Main thread message %i", i );
+	for( size_t t = 0; t < writers.size(); ++t ) writers[t].join();
+	h3dFinalizeFrame();
+
+	H3D_CHECK( callbackCount > before );
+	H3D_CHECK( foreignThreadCalls == 0 );
+	H3D_CHECK( reentrantMessages > 0 );
+
+	Horde3DTest::releaseEngine();
+	h3dSetMessageCallback( 0x0 );
+	return Horde3DTest::finish( "testLog" );
+}
@@ -0,0 +1,158 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// With pipelined rendering a frame must show models and meshes as they were when the frame was
+// finalized, even if the application moves, changes or removes them while the frame is rendered.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+const int ImageSize = 128;
+
+H3DRes sceneRes, materials[2], outputTex;
+H3DNode camera, model, mesh;
+
+
+void addModel()
+{
+	model = h3dAddNodes( H3DRootNode, sceneRes );
+	h3dFindNodes( model, "Sphere01", H3DNodeTypes::Mesh );
+	mesh = h3dGetNodeFindResult( 0 );
+}
+
+
+// The states differ in transformation and material; everything else is reset
+void applyState( int state )
+{
+	if( state == 0 ) h3dSetNodeTransform( model, -1.5f, 0, 0, 0, 0, 0, 1, 1, 1 );
+	else h3dSetNodeTransform( model, 1.5f, 0.5f, 0, 0, 45, 0, 1.2f, 1.2f, 1.2f );
+	h3dSetNodeParamI( mesh, H3DMesh::MatResI, materials[state] );
+	h3dSetNodeParamI( mesh, H3DMesh::LodLevelI, 0 );
+	h3dSetNodeFlags( model, 0, true );
+}
+
+
+void renderFrame()
+{
+	h3dRender( camera );
+	h3dFinalizeFrame();
+}
+
+
+std::vector< unsigned char > readImage()
+{
+	std::vector< unsigned char > image( ImageSize * ImageSize * 4 );
+	const void *pixels = h3dMapResStream( outputTex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, true, false );
+	if( pixels != 0x0 ) memcpy( &image[0], pixels, image.size() );
+	h3dUnmapResStream( outputTex );
+	return image;
+}
+
+}  // namespace
+
+
+int main()
+{
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+
+	H3DRes pipeline = h3dAddResource( H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml", 0 );
+	H3DRes lightMat = h3dAddResource( H3DResTypes::Material, "materials/light.material.xml", 0 );
+	sceneRes = h3dAddResource( H3DResTypes::SceneGraph, "models/sphere/sphere.scene.xml", 0 );
+	materials[0] = h3dAddResource( H3DResTypes::Material, "models/sphere/stones.material.xml", 0 );
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+
+	// Second material with a plain red albedo map
+	H3DRes redTex = h3dCreateTexture( "red", 4, 4, H3DFormats::TEX_BGRA8, H3DResFlags::NoTexMipmaps );
+	unsigned char *red = (unsigned char *)h3dMapResStream( redTex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, false, true );
+	for( int i = 0; i < 4 * 4; ++i ) { red[i * 4] = 0; red[i * 4 + 1] = 0; red[i * 4 + 2] = 255; red[i * 4 + 3] = 255; }
+	h3dUnmapResStream( redTex );
+	materials[1] = h3dCloneResource( materials[0], "stonesRed" );
+	int sampler = h3dFindResElem( materials[1], H3DMatRes::SamplerElem, H3DMatRes::SampNameStr, "albedoMap" );
+	h3dSetResParamI( materials[1], H3DMatRes::SamplerElem, sampler, H3DMatRes::SampTexResI, redTex );
+
+	outputTex = h3dCreateTexture( "meshOutput", ImageSize, ImageSize, H3DFormats::TEX_BGRA8,
+	                              H3DResFlags::TexRenderable | H3DResFlags::NoTexMipmaps );
+	camera = h3dAddCameraNode( H3DRootNode, "Camera", pipeline );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportWidthI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportHeightI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::OutTexResI, outputTex );
+	h3dSetNodeParamI( camera, H3DCamera::OccCullingI, 1 );
+	h3dSetupCameraView( camera, 60.0f, 1.0f, 0.5f, 100.0f );
+	h3dSetNodeTransform( camera, 0, 1, 6, -10, 0, 0, 1, 1, 1 );
+	h3dResizePipelineBuffers( pipeline, ImageSize, ImageSize );
+
+	H3DNode light = h3dAddLightNode( H3DRootNode, "Light", lightMat, "LIGHTING", "SHADOWMAP" );
+	h3dSetNodeTransform( light, 0, 6, 4, -50, 0, 0, 1, 1, 1 );
+	h3dSetNodeParamF( light, H3DLight::RadiusF, 0, 30 );
+	h3dSetNodeParamF( light, H3DLight::FovF, 0, 90 );
+	h3dSetNodeParamI( light, H3DLight::ShadowMapCountI, 0 );
+
+	addModel();
+
+	// Reference images rendered without pipelining (first frame differs slightly, so render twice)
+	std::vector< unsigned char > reference[2];
+	for( int i = 0; i < 4; ++i )
+	{
+		applyState( i % 2 );
+		renderFrame();
+		reference[i % 2] = readImage();
+	}
+	H3D_CHECK( reference[0] != reference[1] );
+
+	if( !H3D_CHECK( Horde3DTest::enablePipelinedRendering( true ) ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "testMeshPipelining" );
+	}
+
+	int mismatches = 0;
+	for( int frame = 0; frame < 24; ++frame )
+	{
+		int current = frame % 2;
+		applyState( current );
+		renderFrame();
+
+		// Modify the model and its mesh while the frame is in flight
+		switch( frame % 4 )
+		{
+		case 0:
+			h3dRemoveNode( model );
+			addModel();
+			applyState( 1 - current );
+			break;
+		case 1:
+			applyState( 1 - current );
+			break;
+		case 2:
+			// Meshes of other LOD levels are not drawn
+			h3dSetNodeParamI( mesh, H3DMesh::LodLevelI, 1 );
+			break;
+		case 3:
+			h3dSetNodeFlags( model, H3DNodeFlags::Inactive, true );
+			break;
+		}
+
+		if( readImage() != reference[current] ) ++mismatches;
+	}
+	H3D_CHECK( mismatches == 0 );
+
+	Horde3DTest::enablePipelinedRendering( false );
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "testMeshPipelining" );
+}
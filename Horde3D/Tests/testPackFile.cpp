@@ -0,0 +1,120 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Pack files with offsets and sizes that only fit into the file because their sum wraps around
+// must be rejected when they are mounted
+
+#include "testCommon.h"
+#include "Horde3DUtils.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+
+namespace {
+
+// Header fields
+const size_t EntryCountPos = 8, IndexOffsetPos = 16, NamesOffsetPos = 24;
+// Entry fields relative to the entry
+const size_t EntryOffsetPos = 0, EntrySizePos = 8, EntryNameOffsetPos = 12, EntryNameLengthPos = 16;
+
+std::string packData;
+
+
+template< class T > T readValue( const std::string &data, size_t pos )
+{
+	T value;
+	memcpy( &value, &data[pos], sizeof( T ) );
+	return value;
+}
+
+
+template< class T > void writeValue( std::string &data, size_t pos, T value )
+{
+	memcpy( &data[pos], &value, sizeof( T ) );
+}
+
+
+bool mountCopy( const std::string &data )
+{
+	std::string fileName = std::string( Horde3DTest::tempDir() ) + "/corrupt.h3dpack";
+	std::ofstream outf( fileName.c_str(), std::ios::binary );
+	outf.write( data.data(), data.size() );
+	outf.close();
+
+	bool mounted = h3dutMountPackFile( fileName.c_str() );
+	h3dutUnmountPackFile( fileName.c_str() );
+	remove( fileName.c_str() );
+	return mounted;
+}
+
+}  // namespace
+
+
+int main()
+{
+	// Pack with a few small files
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/packContent";
+	std::string packName = std::string( Horde3DTest::tempDir() ) + "/test.h3dpack";
+	H3D_CHECK( system( ("rm -rf \"" + dir + "\" && mkdir -p \"" + dir + "\"").c_str() ) == 0 );
+	for( int i = 0; i < 3; ++i )
+	{
+		std::ofstream outf( (dir + "/file" + std::to_string( i ) + ".txt").c_str() );
+		outf << "Content of file " << i << "\n";
+	}
+	H3D_CHECK( h3dutCreatePackFile( dir.c_str(), packName.c_str() ) );
+
+	std::ifstream inf( packName.c_str(), std::ios::binary );
+	packData.assign( std::istreambuf_iterator< char >( inf ), std::istreambuf_iterator< char >() );
+	inf.close();
+	if( !H3D_CHECK( packData.size() > 32 && readValue< unsigned int >( packData, EntryCountPos ) == 3 ) )
+		return Horde3DTest::finish( "testPackFile" );
+
+	H3D_CHECK( mountCopy( packData ) );
+
+	size_t entryPos = (size_t)readValue< unsigned long long >( packData, IndexOffsetPos );
+	unsigned long long namesOffset = readValue< unsigned long long >( packData, NamesOffsetPos );
+
+	// Index offset close to 2^64, so that the end of the index wraps around to the start of the file
+	std::string corrupt = packData;
+	writeValue< unsigned long long >( corrupt, IndexOffsetPos, 0ull - 64 );
+	H3D_CHECK( !mountCopy( corrupt ) );
+
+	// More entries than fit between index and names
+	corrupt = packData;
+	writeValue< unsigned int >( corrupt, EntryCountPos, (unsigned int)((namesOffset - entryPos) / 32 + 1) );
+	H3D_CHECK( !mountCopy( corrupt ) );
+
+	// Entry data behind the end of the file with an end that wraps around
+	corrupt = packData;
+	writeValue< unsigned long long >( corrupt, entryPos + EntryOffsetPos, 0ull - 8 );
+	H3D_CHECK( !mountCopy( corrupt ) );
+
+	// Entry data that starts in the file but ends behind it
+	corrupt = packData;
+	writeValue< unsigned int >( corrupt, entryPos + EntrySizePos, (unsigned int)packData.size() );
+	H3D_CHECK( !mountCopy( corrupt ) );
+
+	// Names behind the end of the file
+	corrupt = packData;
+	writeValue< unsigned int >( corrupt, entryPos + EntryNameOffsetPos, 0xFFFFFFF0u );
+	H3D_CHECK( !mountCopy( corrupt ) );
+	corrupt = packData;
+	writeValue< unsigned int >( corrupt, entryPos + EntryNameLengthPos, 0xFFFFFFF0u );
+	H3D_CHECK( !mountCopy( corrupt ) );
+
+	remove( packName.c_str() );
+	H3D_CHECK( system( ("rm -rf \"" + dir + "\"").c_str() ) == 0 );
+	return Horde3DTest::finish( "testPackFile" );
+}
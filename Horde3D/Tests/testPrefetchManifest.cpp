@@ -0,0 +1,176 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Loading the knight sample must record its dependencies in the prefetch manifest. After the manifest
+// was saved and read back by a new engine instance, loading the knight again must read its whole
+// dependency closure at once, eliminating one load wave per dependency level, and load the same
+// resources as without the manifest.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const char *SceneName = "models/knight/knight.scene.xml";
+
+typedef std::map< std::string, std::vector< std::string > > Manifest;
+
+
+std::string getResKey( int type, const std::string &name )
+{
+	std::stringstream ss;
+	ss << type << ' ' << name;
+	return ss.str();
+}
+
+
+bool readManifest( const std::string &fileName, Manifest &manifest, std::string &text )
+{
+	std::ifstream in( fileName.c_str() );
+	if( !in.good() ) return false;
+
+	std::stringstream ss;
+	ss << in.rdbuf();
+	text = ss.str();
+
+	std::string line;
+	std::vector< std::string > *deps = 0x0;
+	while( getline( ss, line ) )
+	{
+		if( line.compare( 0, 2, "R " ) == 0 ) deps = &manifest[line.substr( 2 )];
+		else if( line.compare( 0, 2, "D " ) == 0 && deps != 0x0 ) deps->push_back( line.substr( 2 ) );
+		else return false;
+	}
+	return true;
+}
+
+
+// Number of resources and of dependency levels below the root
+void getClosure( const Manifest &manifest, const std::string &root, int &resCount, int &levelCount )
+{
+	std::set< std::string > visited;
+	std::vector< std::string > level( 1, root );
+	visited.insert( root );
+	resCount = 0;
+	levelCount = -1;
+	while( !level.empty() )
+	{
+		std::vector< std::string > nextLevel;
+		for( size_t i = 0; i < level.size(); ++i )
+		{
+			Manifest::const_iterator itr = manifest.find( level[i] );
+			if( itr == manifest.end() ) continue;
+			for( size_t j = 0; j < itr->second.size(); ++j )
+			{
+				if( visited.insert( itr->second[j] ).second ) nextLevel.push_back( itr->second[j] );
+			}
+		}
+		resCount += (int)level.size();
+		++levelCount;
+		level.swap( nextLevel );
+	}
+}
+
+
+// Loads the knight into a new engine instance and returns the loaded resources
+bool loadKnight( std::set< std::string > &loaded, int &prefetchedFiles, int &eliminatedWaves )
+{
+	if( !Horde3DTest::initEngine() ) return false;
+
+	h3dAddResource( H3DResTypes::SceneGraph, SceneName, 0 );
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+	h3dutGetPrefetchStats( &prefetchedFiles, &eliminatedWaves );
+
+	loaded.clear();
+	for( H3DRes res = h3dGetNextResource( H3DResTypes::Undefined, 0 ); res != 0;
+	     res = h3dGetNextResource( H3DResTypes::Undefined, res ) )
+	{
+		if( h3dIsResLoaded( res ) ) loaded.insert( getResKey( h3dGetResType( res ), h3dGetResName( res ) ) );
+	}
+
+	Horde3DTest::releaseEngine();
+	return true;
+}
+
+}  // namespace
+
+
+int main()
+{
+	std::string fileName = std::string( Horde3DTest::tempDir() ) + "/knight.prefetch";
+	std::string sceneKey = getResKey( H3DResTypes::SceneGraph, SceneName );
+	remove( fileName.c_str() );
+
+	// Without a manifest, dependencies are discovered while loading
+	std::set< std::string > coldLoaded, loaded;
+	int prefetchedFiles = -1, eliminatedWaves = -1;
+	if( !loadKnight( coldLoaded, prefetchedFiles, eliminatedWaves ) ) return Horde3DTest::TestSkipped;
+	H3D_CHECK( prefetchedFiles == 0 && eliminatedWaves == 0 );
+
+	// Write
+	Manifest manifest;
+	std::string text;
+	H3D_CHECK( h3dutSavePrefetchManifest( fileName.c_str() ) );
+	if( !H3D_CHECK( readManifest( fileName, manifest, text ) ) ) return Horde3DTest::finish( "testPrefetchManifest" );
+
+	const std::vector< std::string > &sceneDeps = manifest[sceneKey];
+	std::set< std::string > deps( sceneDeps.begin(), sceneDeps.end() );
+	H3D_CHECK( deps.count( getResKey( H3DResTypes::Geometry, "models/knight/knight.geo" ) ) == 1 );
+	H3D_CHECK( deps.count( getResKey( H3DResTypes::Material, "models/knight/knight.material.xml" ) ) == 1 );
+
+	int resCount, levelCount;
+	getClosure( manifest, sceneKey, resCount, levelCount );
+	printf( "Knight: %i resources in %i load waves\n", resCount, levelCount + 1 );
+	H3D_CHECK( levelCount >= 2 );
+
+	// Reading a manifest replaces the dependencies of its resources; without those of the scene
+	// graph, only the dependencies of the materials can be read ahead
+	{
+		std::ofstream out( fileName.c_str() );
+		out << "R " << sceneKey << "\n";
+	}
+	H3D_CHECK( h3dutLoadPrefetchManifest( fileName.c_str() ) );
+	H3D_CHECK( loadKnight( loaded, prefetchedFiles, eliminatedWaves ) );
+	printf( "Without scene graph dependencies: %i prefetched files, %i eliminated load waves\n",
+	        prefetchedFiles, eliminatedWaves );
+	H3D_CHECK( prefetchedFiles < resCount && eliminatedWaves < levelCount );
+	H3D_CHECK( loaded == coldLoaded );
+
+	// Read and replay the complete manifest
+	{
+		std::ofstream out( fileName.c_str() );
+		out << text;
+	}
+	H3D_CHECK( h3dutLoadPrefetchManifest( fileName.c_str() ) );
+	H3D_CHECK( loadKnight( loaded, prefetchedFiles, eliminatedWaves ) );
+	printf( "Replay: %i prefetched files, %i eliminated load waves\n", prefetchedFiles, eliminatedWaves );
+	H3D_CHECK( prefetchedFiles == resCount && eliminatedWaves == levelCount );
+	H3D_CHECK( loaded == coldLoaded );
+
+	// Recording the same dependencies again writes the same manifest
+	Manifest savedAgain;
+	std::string textAgain;
+	H3D_CHECK( h3dutSavePrefetchManifest( fileName.c_str() ) );
+	H3D_CHECK( readManifest( fileName, savedAgain, textAgain ) && textAgain == text );
+
+	remove( fileName.c_str() );
+	return Horde3DTest::finish( "testPrefetchManifest" );
+}
@@ -0,0 +1,326 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Releasing unused resources also releases the resources they were the last users of. Types over
+// their memory budget evict least recently used resources at the end of a frame; only resources that
+// were loaded from data, have no user handles and were not used in the last frame are evicted, and
+// evicted resources are returned by h3dQueryUnloadedResource again. Terrain height maps are bound
+// without a material and must not be evicted while the terrain uses them.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "Horde3DTerrain.h"
+#include "egModules.h"
+#include "egRenderer.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Horde3D;
+
+
+namespace {
+
+const int MB = 1024 * 1024;
+
+
+// Texture loaded from an uncompressed TGA image, so it can be evicted; a size of 512 uses 1 MB
+H3DRes loadTexture( const char *name, int size )
+{
+	std::vector< unsigned char > data( 18 + size * size * 4, 0 );
+	data[2] = 2;  // Uncompressed true color
+	data[12] = (unsigned char)(size & 0xFF); data[13] = (unsigned char)(size >> 8);
+	data[14] = (unsigned char)(size & 0xFF); data[15] = (unsigned char)(size >> 8);
+	data[16] = 32;
+	data[17] = 0x28;  // Top-left origin with 8 alpha bits
+	for( int i = 0; i < size * size; ++i )
+	{
+		data[18 + i * 4 + 1] = (unsigned char)(i * 7);
+		data[18 + i * 4 + 2] = (unsigned char)(i / size);
+		data[18 + i * 4 + 3] = 255;
+	}
+
+	H3DRes tex = h3dAddResource( H3DResTypes::Texture, name, H3DResFlags::NoTexMipmaps );
+	h3dLoadResource( tex, (const char *)&data[0], (int)data.size() );
+	return tex;
+}
+
+
+H3DRes loadMaterial( const char *name, const char *xml )
+{
+	H3DRes mat = h3dAddResource( H3DResTypes::Material, name, 0 );
+	h3dLoadResource( mat, xml, (int)strlen( xml ) );
+	return mat;
+}
+
+
+bool exists( H3DRes res ) { return h3dGetResType( res ) != H3DResTypes::Undefined; }
+
+
+int memoryUsage( H3DRes res )
+{
+	int cpuMem = 0, gpuMem = 0;
+	h3dGetResMemoryUsage( res, &cpuMem, &gpuMem );
+	return cpuMem + gpuMem;
+}
+
+
+bool isQueried( H3DRes res )
+{
+	for( int i = 0; h3dQueryUnloadedResource( i ) != 0; ++i )
+	{
+		if( h3dQueryUnloadedResource( i ) == res ) return true;
+	}
+	return false;
+}
+
+
+// Records a use of the resource in the current frame, as the renderer does when binding it
+void markUsed( H3DRes res )
+{
+	Modules::resMan().resolveResHandle( res )->markUsed( Modules::renderer().getFrameID() );
+}
+
+
+void removeAll( const H3DRes *resources, int count )
+{
+	for( int i = 0; i < count; ++i ) h3dRemoveResource( resources[i] );
+	h3dReleaseUnusedResources();
+}
+
+
+void testRelease()
+{
+	// Each resource is only referenced by a resource that is added after it, so a single pass over
+	// the resource list would not find the resources that become unused
+	H3DRes tex = loadTexture( "releaseTex.tga", 4 );
+	H3DRes linked = loadMaterial( "releaseLinked.material.xml",
+		"<Material><Sampler name=\"albedoMap\" map=\"releaseTex.tga\" /></Material>" );
+	H3DRes mat = loadMaterial( "release.material.xml", "<Material link=\"releaseLinked.material.xml\" />" );
+
+	// Resources that are still in use by a resource with a user handle are kept
+	H3DRes keptTex = loadTexture( "keptTex.tga", 4 );
+	H3DRes keptMat = loadMaterial( "kept.material.xml",
+		"<Material><Sampler name=\"albedoMap\" map=\"keptTex.tga\" /></Material>" );
+	if( !H3D_CHECK( h3dIsResLoaded( mat ) && h3dIsResLoaded( linked ) && h3dIsResLoaded( keptMat ) ) ) return;
+
+	h3dRemoveResource( tex );
+	h3dRemoveResource( linked );
+	h3dRemoveResource( mat );
+	h3dRemoveResource( keptTex );
+	h3dReleaseUnusedResources();
+	H3D_CHECK( !exists( mat ) && !exists( linked ) && !exists( tex ) );
+	H3D_CHECK( exists( keptTex ) && exists( keptMat ) );
+
+	h3dRemoveResource( keptMat );
+	h3dReleaseUnusedResources();
+	H3D_CHECK( !exists( keptMat ) && !exists( keptTex ) );
+}
+
+
+void testEvictionOrder()
+{
+	H3DRes textures[3] = { loadTexture( "lruA.tga", 512 ), loadTexture( "lruB.tga", 512 ), loadTexture( "lruC.tga", 512 ) };
+	if( !H3D_CHECK( h3dIsResLoaded( textures[0] ) && h3dIsResLoaded( textures[1] ) && h3dIsResLoaded( textures[2] ) ) )
+		return;
+	H3D_CHECK( memoryUsage( textures[0] ) == MB );
+
+	// B is used first, then A, then C
+	markUsed( textures[1] );
+	h3dFinalizeFrame();
+	markUsed( textures[0] );
+	h3dFinalizeFrame();
+	markUsed( textures[2] );
+	for( int i = 0; i < 3; ++i ) h3dRemoveResource( textures[i] );
+
+	// Built-in textures use a bit of memory as well, so one texture is evicted per lowered megabyte;
+	// C was used in the last frame and is never evicted
+	h3dSetResTypeMemoryBudget( H3DResTypes::Texture, 3 );
+	h3dFinalizeFrame();
+	H3D_CHECK( h3dIsResLoaded( textures[0] ) && !h3dIsResLoaded( textures[1] ) && h3dIsResLoaded( textures[2] ) );
+	H3D_CHECK( memoryUsage( textures[1] ) == 0 );
+
+	h3dSetResTypeMemoryBudget( H3DResTypes::Texture, 2 );
+	h3dFinalizeFrame();
+	H3D_CHECK( !h3dIsResLoaded( textures[0] ) && h3dIsResLoaded( textures[2] ) );
+
+	h3dSetResTypeMemoryBudget( H3DResTypes::Texture, 1 );
+	h3dFinalizeFrame();
+	H3D_CHECK( !h3dIsResLoaded( textures[2] ) );
+
+	// Evicted resources are queried again, so that the application loads them on demand
+	H3D_CHECK( isQueried( textures[0] ) && isQueried( textures[1] ) && isQueried( textures[2] ) );
+	h3dSetResTypeMemoryBudget( H3DResTypes::Texture, 0 );
+	h3dRemoveResource( loadTexture( "lruB.tga", 512 ) );
+	H3D_CHECK( h3dIsResLoaded( textures[1] ) && !isQueried( textures[1] ) );
+
+	h3dReleaseUnusedResources();
+	H3D_CHECK( !exists( textures[0] ) && !exists( textures[1] ) && !exists( textures[2] ) );
+}
+
+
+void testReloadable()
+{
+	// Geometry that is well over a budget of 1 MB
+	const int numVerts = 40000;
+	std::vector< float > positions( numVerts * 3, 0.0f );
+	std::vector< unsigned int > indices( numVerts );
+	for( int i = 0; i < numVerts; ++i )
+	{
+		positions[i * 3] = (float)i;
+		indices[i] = i;
+	}
+	H3DRes geos[4];
+	const char *names[4] = { "budgetGeo", "budgetGeoSource", "budgetGeoMapped", "budgetGeoOwned" };
+	for( int i = 0; i < 4; ++i )
+		geos[i] = h3dutCreateGeometryRes( names[i], numVerts, numVerts, &positions[0], &indices[0], 0, 0, 0, 0, 0 );
+	H3DRes geo = geos[0], source = geos[1], mapped = geos[2], owned = geos[3];
+	H3DRes clone = h3dCloneResource( source, "budgetGeoClone" );
+	if( !H3D_CHECK( h3dIsResLoaded( geo ) && h3dIsResLoaded( mapped ) && h3dIsResLoaded( owned ) && clone != 0 ) )
+		return;
+	H3D_CHECK( memoryUsage( geo ) > MB );
+
+	// Data written by the application can't be loaded again
+	float *pos = (float *)h3dMapResStream( mapped, H3DGeoRes::GeometryElem, 0, H3DGeoRes::GeoVertPosStream, true, true );
+	if( H3D_CHECK( pos != 0x0 ) ) pos[1] = 1.0f;
+	h3dUnmapResStream( mapped );
+
+	// The clone shares the data of its source and keeps it alive; when the source is gone, the clone
+	// owns the data, which can't be loaded again under the name of the clone
+	h3dRemoveResource( source );
+	h3dReleaseUnusedResources();
+	H3D_CHECK( h3dGetResType( source ) == H3DResTypes::Geometry && memoryUsage( clone ) < memoryUsage( source ) );
+
+	h3dRemoveResource( geo );
+	h3dRemoveResource( clone );
+	h3dRemoveResource( mapped );
+	h3dSetResTypeMemoryBudget( H3DResTypes::Geometry, 1 );
+	h3dFinalizeFrame();
+	h3dFinalizeFrame();
+
+	// Only the geometry that was loaded from data and has no other users is evicted
+	H3D_CHECK( !h3dIsResLoaded( geo ) && isQueried( geo ) );
+	H3D_CHECK( h3dIsResLoaded( source ) && h3dIsResLoaded( clone ) && !isQueried( clone ) );
+	H3D_CHECK( h3dIsResLoaded( mapped ) && h3dIsResLoaded( owned ) );
+
+	h3dSetResTypeMemoryBudget( H3DResTypes::Geometry, 0 );
+	h3dRemoveResource( owned );
+	h3dReleaseUnusedResources();
+	H3D_CHECK( !exists( geo ) && !exists( source ) && !exists( clone ) && !exists( mapped ) && !exists( owned ) );
+}
+
+
+void testListBySize()
+{
+	H3DRes mat = loadMaterial( "size.material.xml", "<Material />" );
+	H3DRes small = loadTexture( "sizeSmall.tga", 128 );
+	H3DRes large = loadTexture( "sizeLarge.tga", 512 );
+	H3DRes medium = loadTexture( "sizeMedium.tga", 256 );
+
+	int count = h3dListResourcesBySize( H3DResTypes::Texture, 0x0, 0 );
+	std::vector< H3DRes > textures( count + 1, 0 );
+	H3D_CHECK( h3dListResourcesBySize( H3DResTypes::Texture, &textures[0], count + 1 ) == count );
+	H3D_CHECK( textures[count] == 0 );
+
+	int smallPos = -1, largePos = -1, mediumPos = -1, unsorted = 0;
+	for( int i = 0; i < count; ++i )
+	{
+		H3D_CHECK( h3dGetResType( textures[i] ) == H3DResTypes::Texture );
+		if( i > 0 && memoryUsage( textures[i] ) > memoryUsage( textures[i - 1] ) ) ++unsorted;
+		if( textures[i] == small ) smallPos = i;
+		if( textures[i] == large ) largePos = i;
+		if( textures[i] == medium ) mediumPos = i;
+	}
+	H3D_CHECK( unsorted == 0 );
+	H3D_CHECK( largePos == 0 && mediumPos == 1 && smallPos == 2 );
+
+	// Only as many handles as requested are written
+	H3DRes largest[2] = { 0, 0 };
+	H3D_CHECK( h3dListResourcesBySize( H3DResTypes::Texture, largest, 1 ) == count );
+	H3D_CHECK( largest[0] == large && largest[1] == 0 );
+
+	// All types are listed together
+	int typeCounts = 0;
+	for( int type = H3DResTypes::SceneGraph; type <= H3DResTypes::ComputeBuffer; ++type )
+		typeCounts += h3dListResourcesBySize( type, 0x0, 0 );
+	H3D_CHECK( h3dListResourcesBySize( H3DResTypes::Undefined, 0x0, 0 ) == typeCounts && typeCounts > count );
+
+	H3DRes resources[] = { mat, small, large, medium };
+	removeAll( resources, 4 );
+}
+
+
+void testHeightMapBudget()
+{
+	H3DRes detailTex = h3dCreateTexture( "detailMap", 4, 4, H3DFormats::TEX_BGRA8, H3DResFlags::NoTexMipmaps );
+	const char *matXml =
+		"<Material>\n"
+		"	<Shader source=\"shaders/terrain.shader\"/>\n"
+		"	<Sampler name=\"heightNormMap\" map=\"heightMapFile.tga\" />\n"
+		"	<Sampler name=\"detailMap\" map=\"detailMap\" />\n"
+		"</Material>\n";
+	H3DRes heightMap = loadTexture( "heightMapFile.tga", 512 );
+	H3DRes terrainMat = loadMaterial( "terrainBudget.material.xml", matXml );
+	H3DRes pipeline = h3dAddResource( H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml", 0 );
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+	if( !H3D_CHECK( h3dIsResLoaded( heightMap ) && h3dIsResLoaded( terrainMat ) ) ) return;
+
+	const int imageSize = 64;
+	H3DRes outputTex = h3dCreateTexture( "budgetOutput", imageSize, imageSize, H3DFormats::TEX_BGRA8,
+	                                     H3DResFlags::TexRenderable | H3DResFlags::NoTexMipmaps );
+	H3DNode camera = h3dAddCameraNode( H3DRootNode, "Camera", pipeline );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportWidthI, imageSize );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportHeightI, imageSize );
+	h3dSetNodeParamI( camera, H3DCamera::OutTexResI, outputTex );
+	h3dSetupCameraView( camera, 60.0f, 1.0f, 0.5f, 500.0f );
+	h3dSetNodeTransform( camera, 0, 60, 60, -40, 0, 0, 1, 1, 1 );
+	h3dResizePipelineBuffers( pipeline, imageSize, imageSize );
+
+	H3DNode terrain = h3dextAddTerrainNode( H3DRootNode, "BudgetTerrain", heightMap, terrainMat );
+	h3dSetNodeTransform( terrain, -50, 0, -50, 0, 0, 0, 100, 30, 100 );
+	h3dRemoveResource( heightMap );  // Only referenced by the terrain and its material now
+	h3dSetResTypeMemoryBudget( H3DResTypes::Texture, 1 );
+
+	for( int i = 0; i < 4; ++i )
+	{
+		h3dRender( camera );
+		h3dFinalizeFrame();
+	}
+	H3D_CHECK( h3dIsResLoaded( heightMap ) );
+
+	h3dSetResTypeMemoryBudget( H3DResTypes::Texture, 0 );
+	h3dRemoveNode( terrain );
+	h3dRemoveNode( camera );
+	H3DRes resources[] = { terrainMat, pipeline, outputTex, detailTex };
+	removeAll( resources, 4 );
+	H3D_CHECK( !exists( heightMap ) );
+}
+
+}  // namespace
+
+
+int main()
+{
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+
+	testRelease();
+	testEvictionOrder();
+	testReloadable();
+	testListBySize();
+	testHeightMapBudget();
+
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "testResourceManager" );
+}
@@ -0,0 +1,264 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Program binaries are identified by the device and the code of all stages. Binaries stored in one
+// run are used in the next one, binaries that are corrupt or belong to other code are rejected and
+// the shader is compiled from source again. Files are written under a temporary name and renamed,
+// so that no partial files are left behind.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "egModules.h"
+#include "egShader.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <dirent.h>
+
+using namespace Horde3D;
+
+
+namespace {
+
+const size_t HeaderSize = 24;  // Magic, version, key, format and size
+const size_t HeaderKeyPos = 8;
+
+std::string cacheDir;
+
+struct RunStats
+{
+	int   hits, misses;
+	int   compiledCombs, failedCombs;
+};
+
+
+std::vector< std::string > listFiles( const std::string &dir, const char *suffix )
+{
+	std::vector< std::string > files;
+	DIR *d = opendir( dir.c_str() );
+	if( d == 0x0 ) return files;
+
+	size_t suffixLen = strlen( suffix );
+	while( dirent *entry = readdir( d ) )
+	{
+		std::string name = entry->d_name;
+		if( name.length() > suffixLen && name.compare( name.length() - suffixLen, suffixLen, suffix ) == 0 )
+			files.push_back( dir + "/" + name );
+	}
+	closedir( d );
+	return files;
+}
+
+
+std::string readFile( const std::string &fileName )
+{
+	std::ifstream inf( fileName.c_str(), std::ios::binary );
+	return std::string( std::istreambuf_iterator< char >( inf ), std::istreambuf_iterator< char >() );
+}
+
+
+void writeFile( const std::string &fileName, const std::string &data )
+{
+	std::ofstream outf( fileName.c_str(), std::ios::binary | std::ios::trunc );
+	outf.write( data.data(), data.size() );
+}
+
+
+// Loads the model shader with the cache enabled and counts the combinations that were created
+bool runEngine( RunStats &stats )
+{
+	memset( &stats, 0, sizeof( RunStats ) );
+	if( !Horde3DTest::initEngine() ) return false;
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+	h3dSetShaderCachePath( cacheDir.c_str() );
+	h3dGetStat( H3DStats::ShaderCacheHits, true );
+	h3dGetStat( H3DStats::ShaderCacheMisses, true );
+
+	// Combinations that are requested before loading are compiled with the contexts
+	H3DRes res = h3dAddResource( H3DResTypes::Shader, "shaders/model.shader", 0 );
+	ShaderResource *shader = (ShaderResource *)Modules::resMan().resolveResHandle( res );
+	const char *flags[3] = { "_F01_Skinning", "_F02_NormalMapping", "_F05_AlphaTest" };
+	for( int i = 0; i < 8 && shader != 0x0; ++i )
+	{
+		std::vector< std::string > combFlags;
+		for( int j = 0; j < 3; ++j )
+		{
+			if( i & (1 << j) ) combFlags.push_back( flags[j] );
+		}
+		shader->preLoadCombination( ShaderResource::calcCombMask( combFlags ) );
+	}
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+
+	if( H3D_CHECK( shader != 0x0 && h3dIsResLoaded( res ) ) )
+	{
+		std::vector< ShaderContext > &contexts = shader->getContexts();
+		for( size_t i = 0; i < contexts.size(); ++i )
+		{
+			for( size_t j = 0; j < contexts[i].shaderCombs.size(); ++j )
+			{
+				if( contexts[i].shaderCombs[j].shaderObj != 0 ) ++stats.compiledCombs;
+				else ++stats.failedCombs;
+			}
+		}
+	}
+
+	stats.hits = (int)h3dGetStat( H3DStats::ShaderCacheHits, true );
+	stats.misses = (int)h3dGetStat( H3DStats::ShaderCacheMisses, true );
+
+	Horde3DTest::releaseEngine();
+	return true;
+}
+
+
+void testKeys()
+{
+	const char *code[6] = { "vs", "fs", 0x0, 0x0, 0x0, 0x0 };
+	uint64 key = ShaderCache::calcKey( "GL4|vendor|renderer|1.0", code );
+	H3D_CHECK( key == ShaderCache::calcKey( "GL4|vendor|renderer|1.0", code ) );
+	H3D_CHECK( key != 0 );
+
+	// Other driver version
+	H3D_CHECK( key != ShaderCache::calcKey( "GL4|vendor|renderer|1.1", code ) );
+	H3D_CHECK( key != ShaderCache::calcKey( "", code ) );
+
+	// Changed, added and removed stages
+	const char *sources[2] = { "code", "" };
+	for( int stage = 0; stage < 6; ++stage )
+	{
+		for( int i = 0; i < 2; ++i )
+		{
+			const char *changed[6] = { "vs", "fs", 0x0, 0x0, 0x0, 0x0 };
+			changed[stage] = sources[i];
+			H3D_CHECK( key != ShaderCache::calcKey( "GL4|vendor|renderer|1.0", changed ) );
+		}
+	}
+	const char *noFragment[6] = { "vs", 0x0, 0x0, 0x0, 0x0, 0x0 };
+	H3D_CHECK( key != ShaderCache::calcKey( "GL4|vendor|renderer|1.0", noFragment ) );
+
+	// Same code in other stages
+	const char *moved[6] = { "vsf", "s", 0x0, 0x0, 0x0, 0x0 };
+	H3D_CHECK( key != ShaderCache::calcKey( "GL4|vendor|renderer|1.0", moved ) );
+	const char *swapped[6] = { "fs", "vs", 0x0, 0x0, 0x0, 0x0 };
+	H3D_CHECK( key != ShaderCache::calcKey( "GL4|vendor|renderer|1.0", swapped ) );
+}
+
+
+void testStoreLoad()
+{
+	ShaderCache cache;
+	std::vector< char > data( 100, 'x' ), loaded;
+	uint32 format = 0;
+
+	// Disabled cache
+	H3D_CHECK( !cache.store( 1234, 5, data ) );
+	H3D_CHECK( !cache.load( 1234, format, loaded ) );
+
+	cache.setPath( cacheDir );
+	H3D_CHECK( cache.store( 1234, 5, data ) );
+	H3D_CHECK( cache.load( 1234, format, loaded ) && format == 5 && loaded == data );
+	H3D_CHECK( !cache.load( 4321, format, loaded ) );
+
+	// Replacing an existing binary
+	data.assign( 50, 'y' );
+	H3D_CHECK( cache.store( 1234, 6, data ) );
+	H3D_CHECK( cache.load( 1234, format, loaded ) && format == 6 && loaded == data );
+	H3D_CHECK( listFiles( cacheDir, ".h3dprog" ).size() == 1 );
+	H3D_CHECK( listFiles( cacheDir, ".tmp" ).empty() );
+
+	// Truncated binary
+	std::string fileName = listFiles( cacheDir, ".h3dprog" )[0];
+	std::string file = readFile( fileName );
+	writeFile( fileName, file.substr( 0, file.size() - 1 ) );
+	H3D_CHECK( !cache.load( 1234, format, loaded ) );
+	writeFile( fileName, file.substr( 0, HeaderSize - 1 ) );
+	H3D_CHECK( !cache.load( 1234, format, loaded ) );
+
+	// Binary of other code stored under this name
+	std::string foreign = file;
+	foreign[HeaderKeyPos] ^= 1;
+	writeFile( fileName, foreign );
+	H3D_CHECK( !cache.load( 1234, format, loaded ) );
+
+	// Directory that can't be written leaves no files
+	ShaderCache missing;
+	missing.setPath( cacheDir + "/missing" );
+	H3D_CHECK( !missing.store( 1234, 5, data ) );
+	H3D_CHECK( listFiles( cacheDir, ".tmp" ).empty() );
+
+	remove( fileName.c_str() );
+}
+
+
+void testEngine()
+{
+	RunStats stats;
+
+	// Empty cache: everything is compiled and stored
+	if( !runEngine( stats ) ) return;
+	H3D_CHECK( stats.compiledCombs > 0 && stats.failedCombs == 0 );
+	if( stats.hits == 0 && stats.misses == 0 )
+	{
+		printf( "Device does not support program binaries, skipping engine checks\n" );
+		return;
+	}
+	H3D_CHECK( stats.hits == 0 && stats.misses == stats.compiledCombs );
+	std::vector< std::string > files = listFiles( cacheDir, ".h3dprog" );
+	H3D_CHECK( (int)files.size() == stats.compiledCombs );
+	H3D_CHECK( listFiles( cacheDir, ".tmp" ).empty() );
+	int combCount = stats.compiledCombs;
+
+	// Everything comes from the cache
+	if( !H3D_CHECK( runEngine( stats ) ) ) return;
+	H3D_CHECK( stats.hits == combCount && stats.misses == 0 && stats.failedCombs == 0 );
+
+	// Corrupt program data, binaries of other code and truncated files are compiled from source again
+	if( !H3D_CHECK( files.size() >= 3 ) ) return;
+	std::string data0 = readFile( files[0] ), data1 = readFile( files[1] ), data2 = readFile( files[2] );
+	for( size_t i = HeaderSize; i < data0.size(); i += 7 ) data0[i] ^= 0x5a;
+	writeFile( files[0], data0 );
+	writeFile( files[1], data2 );
+	writeFile( files[2], data2.substr( 0, data2.size() / 2 ) );
+
+	if( !H3D_CHECK( runEngine( stats ) ) ) return;
+	H3D_CHECK( stats.hits == combCount - 3 && stats.misses == 3 );
+	H3D_CHECK( stats.compiledCombs == combCount && stats.failedCombs == 0 );
+	H3D_CHECK( listFiles( cacheDir, ".tmp" ).empty() );
+
+	// Rejected binaries were replaced
+	if( !H3D_CHECK( runEngine( stats ) ) ) return;
+	H3D_CHECK( stats.hits == combCount && stats.misses == 0 );
+}
+
+}  // namespace
+
+
+int main()
+{
+	cacheDir = std::string( Horde3DTest::tempDir() ) + "/shaderCache";
+	H3D_CHECK( system( ("rm -rf \"" + cacheDir + "\" && mkdir -p \"" + cacheDir + "\"").c_str() ) == 0 );
+
+	testKeys();
+
+	// Cache writes warnings to the engine log
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+	testStoreLoad();
+	Horde3DTest::releaseEngine();
+	testEngine();
+
+	H3D_CHECK( system( ("rm -rf \"" + cacheDir + "\"").c_str() ) == 0 );
+	return Horde3DTest::finish( "testShaderCache" );
+}
@@ -0,0 +1,197 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Terrain shaders can take the block heights from a vertex stream that is filled on the CPU or
+// fetch them from the height map in the vertex shader. Both must pick the same texels, so that they
+// render the same image, and the heights used for the block bounds must round the same way.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "Horde3DTerrain.h"
+#include "egModules.h"
+#include "egScene.h"
+#include "terrain.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Horde3D;
+
+
+namespace {
+
+const int ImageSize = 128;
+const int HeightMapSize = 128;
+
+unsigned short heights[HeightMapSize][HeightMapSize];
+
+
+// Neighboring texels differ a lot, so that picking the wrong texel changes the image
+H3DRes createHeightMap()
+{
+	H3DRes tex = h3dCreateTexture( "heightMap", HeightMapSize, HeightMapSize, H3DFormats::TEX_BGRA8, H3DResFlags::NoTexMipmaps );
+	unsigned char *pixels = (unsigned char *)h3dMapResStream(
+		tex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, false, true );
+	for( int y = 0; y < HeightMapSize; ++y )
+	{
+		for( int x = 0; x < HeightMapSize; ++x )
+		{
+			heights[y][x] = (unsigned short)(((x * 7 + y * 13) % 17) * 3855 + x * 3);
+
+			// Terrain decodes the high byte from red and the low byte from green
+			unsigned char *p = &pixels[(y * HeightMapSize + x) * 4];
+			p[0] = 0; p[1] = (unsigned char)(heights[y][x] & 0xFF); p[2] = (unsigned char)(heights[y][x] >> 8); p[3] = 255;
+		}
+	}
+	h3dUnmapResStream( tex );
+	return tex;
+}
+
+
+// Both shaders write the object space height as color, so that only the geometry is compared
+const char *shaderFx =
+	"[[FX]]\n"
+	"context AMBIENT { VertexShader = compile GLSL VS_HEIGHTS; PixelShader = compile GLSL FS_HEIGHTS; }\n"
+	"OpenGL4 { context AMBIENT { VertexShader = compile GLSL VS_HEIGHTS; PixelShader = compile GLSL FS_HEIGHTS; } }\n"
+	"[[FS_HEIGHTS]]\n"
+	"in float height;\n"
+	"out vec4 fragColor;\n"
+	"void main() { fragColor = vec4( height, fract( height * 255.0 ), 0.0, 1.0 ); }\n"
+	"[[VS_HEIGHTS]]\n";
+
+const char *vsMain =
+	"uniform mat4 viewProjMat, worldMat;\n"
+	"layout( location = 0 ) in vec3 vertPos;\n"
+	"out float height;\n"
+	"void main() {\n"
+	"	height = fetchHeight( vertPos );\n"
+	"	gl_Position = viewProjMat * worldMat * vec4( vertPos.x * terBlockParams.z + terBlockParams.x, height,\n"
+	"	                                             vertPos.z * terBlockParams.z + terBlockParams.y, 1.0 );\n"
+	"}\n";
+
+// Height stream filled by the terrain node
+const char *vsCpuHeights =
+	"uniform vec4 terBlockParams;\n"
+	"layout( location = 1 ) in float terHeight;\n"
+	"float fetchHeight( vec3 gridPos ) { return terHeight; }\n";
+
+// Height map fetch of the terrain sample shader
+const char *vsGpuHeights =
+	"#include \"shaders/utilityLib/vertTerrain.glsl\"\n";
+
+
+H3DRes loadMaterial( const char *name, const char *vsHeights )
+{
+	std::string shaderName = std::string( "shaders/" ) + name + ".shader";
+	std::string code = std::string( shaderFx ) + vsHeights + vsMain;
+	H3DRes shader = h3dAddResource( H3DResTypes::Shader, shaderName.c_str(), 0 );
+	h3dLoadResource( shader, code.c_str(), (int)code.size() );
+
+	std::string xml = "<Material>\n	<Shader source=\"" + shaderName + "\"/>\n</Material>\n";
+	H3DRes mat = h3dAddResource( H3DResTypes::Material, (std::string( name ) + ".material.xml").c_str(), 0 );
+	h3dLoadResource( mat, xml.c_str(), (int)xml.size() );
+	return mat;
+}
+
+
+std::vector< unsigned char > renderImage( H3DNode camera, H3DRes outputTex )
+{
+	for( int i = 0; i < 2; ++i )
+	{
+		h3dRender( camera );
+		h3dFinalizeFrame();
+	}
+
+	std::vector< unsigned char > image( ImageSize * ImageSize * 4 );
+	const void *pixels = h3dMapResStream( outputTex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, true, false );
+	if( pixels != 0x0 ) memcpy( &image[0], pixels, image.size() );
+	h3dUnmapResStream( outputTex );
+	return image;
+}
+
+
+void checkBlockHeights( H3DNode terrain )
+{
+	// Half texels round up like the block vertices do
+	Horde3DTerrain::TerrainNode *node = (Horde3DTerrain::TerrainNode *)Modules::sceneMan().resolveNodeHandle( terrain );
+	int mismatches = 0;
+	for( int y = 0; y < HeightMapSize; ++y )
+	{
+		for( int x = 0; x < HeightMapSize; ++x )
+		{
+			float u = (x + 0.5f) / HeightMapSize, v = (y + 0.5f) / HeightMapSize;
+			unsigned short expected = heights[std::min( y + 1, HeightMapSize - 1 )][std::min( x + 1, HeightMapSize - 1 )];
+			if( node->getHeight( u, v ) != expected / 65535.0f ) ++mismatches;
+			if( node->getHeight( x / (float)HeightMapSize, v ) !=
+			    heights[std::min( y + 1, HeightMapSize - 1 )][x] / 65535.0f ) ++mismatches;
+		}
+	}
+	H3D_CHECK( mismatches == 0 );
+}
+
+}  // namespace
+
+
+int main()
+{
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+	h3dSetOption( H3DOptions::MaxLogLevel, 2 );
+
+	H3DRes heightMap = createHeightMap();
+	H3DRes cpuMat = loadMaterial( "terrainCpu", vsCpuHeights );
+	H3DRes gpuMat = loadMaterial( "terrainGpu", vsGpuHeights );
+	H3DRes pipeline = h3dAddResource( H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml", 0 );
+	std::string contentDirs = std::string( Horde3DTest::contentDir() ) + "|" + Horde3DTest::terrainContentDir();
+	H3D_CHECK( h3dutLoadResourcesFromDisk( contentDirs.c_str() ) );
+	if( !H3D_CHECK( h3dIsResLoaded( cpuMat ) && h3dIsResLoaded( gpuMat ) ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "testTerrainHeights" );
+	}
+
+	H3DRes outputTex = h3dCreateTexture( "terrainOutput", ImageSize, ImageSize, H3DFormats::TEX_BGRA8,
+	                                     H3DResFlags::TexRenderable | H3DResFlags::NoTexMipmaps );
+	H3DNode camera = h3dAddCameraNode( H3DRootNode, "Camera", pipeline );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportWidthI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportHeightI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::OutTexResI, outputTex );
+	h3dSetupCameraView( camera, 60.0f, 1.0f, 0.5f, 500.0f );
+	h3dSetNodeTransform( camera, 0, 40, 45, -40, 0, 0, 1, 1, 1 );
+	h3dResizePipelineBuffers( pipeline, ImageSize, ImageSize );
+
+	H3DNode terrain = h3dextAddTerrainNode( H3DRootNode, "Terrain", heightMap, cpuMat );
+	h3dSetNodeTransform( terrain, -50, 0, -50, 0, 0, 0, 100, 20, 100 );
+	h3dSetNodeParamF( terrain, H3DEXTTerrain::MeshQualityF, 0, 100.0f );
+	checkBlockHeights( terrain );
+
+	// Rasterization may differ slightly, as the heights are decoded with other float operations
+	std::vector< unsigned char > cpuImage = renderImage( camera, outputTex );
+	h3dSetNodeParamI( terrain, H3DEXTTerrain::MatResI, gpuMat );
+	std::vector< unsigned char > gpuImage = renderImage( camera, outputTex );
+	int differentPixels = 0, terrainPixels = 0;
+	for( int i = 0; i < ImageSize * ImageSize; ++i )
+	{
+		const unsigned char *c = &cpuImage[i * 4], *g = &gpuImage[i * 4];
+		if( c[3] != 0 ) ++terrainPixels;
+		if( abs( c[0] - g[0] ) > 8 || abs( c[1] - g[1] ) > 8 || abs( c[2] - g[2] ) > 8 ) ++differentPixels;
+	}
+	printf( "%i of %i terrain pixels differ\n", differentPixels, terrainPixels );
+	H3D_CHECK( terrainPixels > ImageSize * ImageSize / 2 );
+	H3D_CHECK( differentPixels <= terrainPixels / 1000 );
+
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "testTerrainHeights" );
+}
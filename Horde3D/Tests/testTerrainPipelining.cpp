@@ -0,0 +1,170 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// With pipelined rendering a frame must show the terrain as it was when the frame was finalized,
+// even if the application changes or removes the terrain while the frame is being rendered.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DUtils.h"
+#include "Horde3DTerrain.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+const int ImageSize = 128;
+const int HeightMapSize = 64;
+
+H3DRes heightMaps[2];
+H3DRes terrainMat, outputTex;
+H3DNode camera;
+
+H3DRes createHeightMap( const char *name, int variant )
+{
+	H3DRes tex = h3dCreateTexture( name, HeightMapSize, HeightMapSize, H3DFormats::TEX_BGRA8, H3DResFlags::NoTexMipmaps );
+	unsigned char *pixels = (unsigned char *)h3dMapResStream(
+		tex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, false, true );
+	for( int y = 0; y < HeightMapSize; ++y )
+	{
+		for( int x = 0; x < HeightMapSize; ++x )
+		{
+			float h = variant == 0 ? (float)x / HeightMapSize :
+				0.5f + 0.5f * sinf( x * 0.3f ) * cosf( y * 0.2f );
+			int height = (int)(h * 65535.0f);
+
+			// Terrain decodes the high byte from red and the low byte from green
+			unsigned char *p = &pixels[(y * HeightMapSize + x) * 4];
+			p[0] = 0; p[1] = (unsigned char)(height & 0xFF); p[2] = (unsigned char)(height >> 8); p[3] = 255;
+		}
+	}
+	h3dUnmapResStream( tex );
+	return tex;
+}
+
+
+H3DNode addTerrain( int heightMap )
+{
+	H3DNode terrain = h3dextAddTerrainNode( H3DRootNode, "Terrain", heightMaps[heightMap], terrainMat );
+	h3dSetNodeTransform( terrain, -50, 0, -50, 0, 0, 0, 100, 30, 100 );
+	return terrain;
+}
+
+
+void renderFrame()
+{
+	h3dRender( camera );
+	h3dFinalizeFrame();
+}
+
+
+std::vector< unsigned char > readImage()
+{
+	std::vector< unsigned char > image( ImageSize * ImageSize * 4 );
+	const void *pixels = h3dMapResStream( outputTex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, true, false );
+	if( pixels != 0x0 ) memcpy( &image[0], pixels, image.size() );
+	h3dUnmapResStream( outputTex );
+	return image;
+}
+
+
+}  // namespace
+
+
+int main()
+{
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+
+	heightMaps[0] = createHeightMap( "heightMapA", 0 );
+	heightMaps[1] = createHeightMap( "heightMapB", 1 );
+	H3DRes detailTex = h3dCreateTexture( "detailMap", 4, 4, H3DFormats::TEX_BGRA8, H3DResFlags::NoTexMipmaps );
+	unsigned char *detail = (unsigned char *)h3dMapResStream(
+		detailTex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, false, true );
+	memset( detail, 200, 4 * 4 * 4 );
+	h3dUnmapResStream( detailTex );
+
+	const char *matXml =
+		"<Material>\n"
+		"	<Shader source=\"shaders/terrain.shader\"/>\n"
+		"	<Sampler name=\"heightNormMap\" map=\"heightMapA\" />\n"
+		"	<Sampler name=\"detailMap\" map=\"detailMap\" />\n"
+		"	<Uniform name=\"sunDir\" a=\"1.0\" b=\"-1.0\" c=\"0.0\" />\n"
+		"</Material>\n";
+	terrainMat = h3dAddResource( H3DResTypes::Material, "terrainTest.material.xml", 0 );
+	h3dLoadResource( terrainMat, matXml, (int)strlen( matXml ) );
+	H3DRes pipeline = h3dAddResource( H3DResTypes::Pipeline, "pipelines/forward.pipeline.xml", 0 );
+	H3D_CHECK( h3dutLoadResourcesFromDisk( Horde3DTest::contentDir() ) );
+
+	outputTex = h3dCreateTexture( "terrainOutput", ImageSize, ImageSize, H3DFormats::TEX_BGRA8,
+	                              H3DResFlags::TexRenderable | H3DResFlags::NoTexMipmaps );
+	camera = h3dAddCameraNode( H3DRootNode, "Camera", pipeline );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportWidthI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::ViewportHeightI, ImageSize );
+	h3dSetNodeParamI( camera, H3DCamera::OutTexResI, outputTex );
+	h3dSetupCameraView( camera, 60.0f, 1.0f, 0.5f, 500.0f );
+	h3dSetNodeTransform( camera, 0, 60, 60, -40, 0, 0, 1, 1, 1 );
+	h3dResizePipelineBuffers( pipeline, ImageSize, ImageSize );
+
+	// Reference images rendered without pipelining (first frame differs slightly, so render twice)
+	std::vector< unsigned char > reference[2];
+	H3DNode terrain = addTerrain( 0 );
+	for( int i = 0; i < 4; ++i )
+	{
+		h3dSetNodeParamI( terrain, H3DEXTTerrain::HeightTexResI, heightMaps[i % 2] );
+		renderFrame();
+		reference[i % 2] = readImage();
+	}
+	H3D_CHECK( reference[0] != reference[1] );
+
+	if( !H3D_CHECK( Horde3DTest::enablePipelinedRendering( true ) ) )
+	{
+		Horde3DTest::releaseEngine();
+		return Horde3DTest::finish( "testTerrainPipelining" );
+	}
+
+	int mismatches = 0;
+	for( int frame = 0; frame < 24; ++frame )
+	{
+		int current = frame % 2;
+		h3dSetNodeParamI( terrain, H3DEXTTerrain::HeightTexResI, heightMaps[current] );
+		renderFrame();
+
+		// Modify shared terrain state while the frame is in flight
+		switch( frame % 4 )
+		{
+		case 0:
+			h3dRemoveNode( terrain );
+			terrain = addTerrain( 1 - current );
+			break;
+		case 1:
+			h3dSetNodeParamI( terrain, H3DEXTTerrain::HeightTexResI, heightMaps[1 - current] );
+			break;
+		case 2:
+			h3dSetNodeParamI( terrain, H3DEXTTerrain::BlockSizeI, 33 );
+			h3dSetNodeParamI( terrain, H3DEXTTerrain::BlockSizeI, 17 );
+			break;
+		case 3:
+			h3dextCreateTerrainGeoRes( terrain, "terrainGeo", 10.0f );
+			break;
+		}
+
+		if( readImage() != reference[current] ) ++mismatches;
+	}
+	H3D_CHECK( mismatches == 0 );
+
+	Horde3DTest::enablePipelinedRendering( false );
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "testTerrainPipelining" );
+}
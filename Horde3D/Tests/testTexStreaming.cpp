@@ -0,0 +1,363 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// Streamed textures only keep their small mip levels in system memory and read finer levels with
+// the read function of the application when they are requested. Each frame uploads a limited
+// amount of data, least recently used textures are reduced when the budget is exceeded and the
+// streaming stats report the resident, requested and evicted memory. Textures that need all
+// levels, like terrain height maps, stop streaming.
+
+#include "testCommon.h"
+#include "Horde3D.h"
+#include "Horde3DTerrain.h"
+#include "egModules.h"
+#include "egTexture.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace Horde3D;
+
+
+namespace {
+
+const size_t LowResSize = (64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1) * 4;  // Levels from 64x64 on
+
+std::map< std::string, std::vector< unsigned char > >  files;
+size_t  bytesRead = 0;
+bool    failReads = false;
+uint32  frameID = 0;
+
+
+bool readTexture( const char *resName, int offset, int size, void *buffer, void *userData )
+{
+	H3D_CHECK( userData == &files );
+	std::map< std::string, std::vector< unsigned char > >::const_iterator file = files.find( resName );
+	if( failReads || file == files.end() || offset < 0 || offset + size > (int)file->second.size() ) return false;
+
+	memcpy( buffer, &file->second[offset], size );
+	bytesRead += size;
+	return true;
+}
+
+
+// Value of the pixels in a mip level, so that the data of every level can be told apart
+unsigned char levelValue( int mipLevel ) { return (unsigned char)(10 + mipLevel * 20); }
+
+
+// DDS with a full mip chain in BGRA or BGR format
+std::vector< unsigned char > createDDS( int size, bool alpha )
+{
+	unsigned int header[32] = { 0 };
+	memcpy( &header[0], "DDS ", 4 );
+	header[1] = 124;
+	header[2] = 0x0002100F;  // Caps, height, width, pitch, pixel format and mipmap count
+	header[3] = size; header[4] = size; header[5] = size * (alpha ? 4 : 3);
+	header[7] = 1 + (int)log2( (double)size );
+	header[19] = 32;
+	header[20] = alpha ? 0x41 : 0x40;  // RGB, with alpha
+	header[22] = alpha ? 32 : 24;
+	header[23] = 0x00ff0000; header[24] = 0x0000ff00; header[25] = 0x000000ff; header[26] = alpha ? 0xff000000 : 0;
+	header[27] = 0x00401008;  // Complex, texture and mipmap
+
+	std::vector< unsigned char > data( (unsigned char *)header, (unsigned char *)header + sizeof( header ) );
+	for( int mipSize = size, level = 0; mipSize > 0; mipSize /= 2, ++level )
+		data.insert( data.end(), (size_t)mipSize * mipSize * (alpha ? 4 : 3), levelValue( level ) );
+	return data;
+}
+
+
+H3DRes loadTexture( const char *name, int size, bool alpha = true )
+{
+	files[name] = createDDS( size, alpha );
+	H3DRes res = h3dAddResource( H3DResTypes::Texture, name, 0 );
+	h3dLoadResource( res, (const char *)&files[name][0], (int)files[name].size() );
+	return res;
+}
+
+
+size_t fullSize( int size )
+{
+	size_t mem = 0;
+	for( ; size > 0; size /= 2 ) mem += (size_t)size * size * 4;
+	return mem;
+}
+
+
+int getCpuMem( H3DRes res )
+{
+	int cpuMem = 0, gpuMem = 0;
+	h3dGetResMemoryUsage( res, &cpuMem, &gpuMem );
+	return cpuMem;
+}
+
+
+int getGpuMem( H3DRes res )
+{
+	int cpuMem = 0, gpuMem = 0;
+	h3dGetResMemoryUsage( res, &cpuMem, &gpuMem );
+	return gpuMem;
+}
+
+
+TextureResource *getTexture( H3DRes res )
+{
+	return (TextureResource *)Modules::resMan().resolveResHandle( res );
+}
+
+
+// Requests the base level of the given textures like rendering does and updates streaming
+void streamFrame( const std::vector< H3DRes > &requested )
+{
+	++frameID;
+	for( size_t i = 0; i < requested.size(); ++i ) getTexture( requested[i] )->requestMip( 0, frameID );
+	TextureResource::updateStreaming();
+}
+
+
+bool statEquals( H3DStats::List stat, size_t bytes )
+{
+	return fabsf( h3dGetStat( stat, false ) - (bytes / 1024) / 1024.0f ) < 0.001f;
+}
+
+
+void removeTextures( const std::vector< H3DRes > &textures )
+{
+	for( size_t i = 0; i < textures.size(); ++i ) h3dRemoveResource( textures[i] );
+	h3dReleaseUnusedResources();
+	files.clear();
+}
+
+
+void testWithoutReader()
+{
+	// Textures can't be streamed if the finer levels can't be read again
+	h3dSetTexStreamingReadFunc( 0x0, 0x0 );
+	H3DRes tex = loadTexture( "noReader.dds", 256 );
+	H3D_CHECK( h3dIsResLoaded( tex ) && !getTexture( tex )->isStreamed() );
+	H3D_CHECK( getCpuMem( tex ) == 0 && getGpuMem( tex ) == (int)fullSize( 256 ) );
+	removeTextures( std::vector< H3DRes >( 1, tex ) );
+	h3dSetTexStreamingReadFunc( readTexture, &files );
+}
+
+
+void testLoad()
+{
+	// Only the low resolution levels are resident and kept in system memory
+	bytesRead = 0;
+	H3DRes tex = loadTexture( "load.dds", 1024 );
+	H3D_CHECK( h3dIsResLoaded( tex ) && getTexture( tex )->isStreamed() );
+	H3D_CHECK( getGpuMem( tex ) == (int)LowResSize );
+	H3D_CHECK( getCpuMem( tex ) >= (int)LowResSize && getCpuMem( tex ) < (int)LowResSize + 1024 );
+	H3D_CHECK( bytesRead == 0 );
+
+	// Finer levels are read when they are requested
+	streamFrame( std::vector< H3DRes >( 1, tex ) );
+	H3D_CHECK( getGpuMem( tex ) == (int)fullSize( 1024 ) );
+	H3D_CHECK( bytesRead == fullSize( 1024 ) - LowResSize );
+	H3D_CHECK( getCpuMem( tex ) < (int)LowResSize + 1024 );
+	removeTextures( std::vector< H3DRes >( 1, tex ) );
+}
+
+
+void testUploadLimit()
+{
+	// The base level of a 2048x2048 texture alone exceeds the upload limit of 16 Mb per frame,
+	// so one texture is loaded per frame
+	std::vector< H3DRes > textures;
+	textures.push_back( loadTexture( "limitA.dds", 2048 ) );
+	textures.push_back( loadTexture( "limitB.dds", 2048 ) );
+	textures.push_back( loadTexture( "limitC.dds", 2048 ) );
+
+	for( int frame = 1; frame <= 3; ++frame )
+	{
+		streamFrame( textures );
+		int loaded = 0;
+		for( size_t i = 0; i < textures.size(); ++i )
+		{
+			if( getGpuMem( textures[i] ) == (int)fullSize( 2048 ) ) ++loaded;
+			else H3D_CHECK( getGpuMem( textures[i] ) == (int)LowResSize );
+		}
+		H3D_CHECK( loaded == frame );
+		H3D_CHECK( statEquals( H3DStats::TexStreamResidentMem, frame * fullSize( 2048 ) + (3 - frame) * LowResSize ) );
+		H3D_CHECK( statEquals( H3DStats::TexStreamRequestedMem, 3 * fullSize( 2048 ) ) );
+	}
+
+	// Several small textures are loaded in one frame
+	removeTextures( textures );
+	textures.clear();
+	for( int i = 0; i < 3; ++i )
+	{
+		char name[32];
+		sprintf( name, "limitSmall%i.dds", i );
+		textures.push_back( loadTexture( name, 512 ) );
+	}
+	streamFrame( textures );
+	for( size_t i = 0; i < textures.size(); ++i ) H3D_CHECK( getGpuMem( textures[i] ) == (int)fullSize( 512 ) );
+	removeTextures( textures );
+}
+
+
+void testBudget()
+{
+	// Two textures with all levels fit into the budget, three don't
+	h3dSetOption( H3DOptions::TexStreamingBudget, 12 );
+	std::vector< H3DRes > textures;
+	textures.push_back( loadTexture( "budgetA.dds", 1024 ) );
+	textures.push_back( loadTexture( "budgetB.dds", 1024 ) );
+	textures.push_back( loadTexture( "budgetC.dds", 1024 ) );
+	const size_t evictedSize = fullSize( 1024 ) - LowResSize;
+	h3dGetStat( H3DStats::TexStreamEvictedMem, true );
+
+	// Unused textures are only reduced when memory is needed
+	streamFrame( std::vector< H3DRes >( 1, textures[0] ) );
+	streamFrame( std::vector< H3DRes >( 1, textures[1] ) );
+	H3D_CHECK( getGpuMem( textures[0] ) == (int)fullSize( 1024 ) && getGpuMem( textures[1] ) == (int)fullSize( 1024 ) );
+	H3D_CHECK( h3dGetStat( H3DStats::TexStreamEvictedMem, false ) == 0 );
+	H3D_CHECK( statEquals( H3DStats::TexStreamRequestedMem, fullSize( 1024 ) + 2 * LowResSize ) );
+
+	// Least recently used texture is reduced first
+	streamFrame( std::vector< H3DRes >( 1, textures[2] ) );
+	H3D_CHECK( getGpuMem( textures[0] ) == (int)LowResSize );
+	H3D_CHECK( getGpuMem( textures[1] ) == (int)fullSize( 1024 ) && getGpuMem( textures[2] ) == (int)fullSize( 1024 ) );
+	H3D_CHECK( statEquals( H3DStats::TexStreamEvictedMem, evictedSize ) );
+	H3D_CHECK( statEquals( H3DStats::TexStreamResidentMem, 2 * fullSize( 1024 ) + LowResSize ) );
+
+	// Reduced texture is read again
+	bytesRead = 0;
+	streamFrame( std::vector< H3DRes >( 1, textures[0] ) );
+	H3D_CHECK( getGpuMem( textures[0] ) == (int)fullSize( 1024 ) && bytesRead == evictedSize );
+	H3D_CHECK( getGpuMem( textures[1] ) == (int)LowResSize && getGpuMem( textures[2] ) == (int)fullSize( 1024 ) );
+	H3D_CHECK( statEquals( H3DStats::TexStreamEvictedMem, 2 * evictedSize ) );
+
+	// Evicted memory is accumulated until the stat is reset
+	h3dGetStat( H3DStats::TexStreamEvictedMem, true );
+	H3D_CHECK( h3dGetStat( H3DStats::TexStreamEvictedMem, false ) == 0 );
+
+	// Textures in use are not reduced, requests only get the levels that fit into the budget
+	streamFrame( textures );
+	const size_t partialSize = fullSize( 512 );
+	H3D_CHECK( getGpuMem( textures[0] ) == (int)fullSize( 1024 ) && getGpuMem( textures[2] ) == (int)fullSize( 1024 ) );
+	H3D_CHECK( getGpuMem( textures[1] ) == (int)partialSize );
+	H3D_CHECK( statEquals( H3DStats::TexStreamResidentMem, 2 * fullSize( 1024 ) + partialSize ) );
+	H3D_CHECK( statEquals( H3DStats::TexStreamRequestedMem, 3 * fullSize( 1024 ) ) );
+
+	// Lowered budget reduces textures that are no longer used
+	h3dSetOption( H3DOptions::TexStreamingBudget, 4 );
+	streamFrame( std::vector< H3DRes >( 1, textures[2] ) );
+	H3D_CHECK( getGpuMem( textures[0] ) == (int)LowResSize && getGpuMem( textures[1] ) == (int)LowResSize );
+	H3D_CHECK( getGpuMem( textures[2] ) == (int)fullSize( 1024 ) );
+	H3D_CHECK( statEquals( H3DStats::TexStreamEvictedMem, evictedSize + partialSize - LowResSize ) );
+
+	h3dSetOption( H3DOptions::TexStreamingBudget, 128 );
+	removeTextures( textures );
+}
+
+
+void testReadFailure()
+{
+	H3DRes tex = loadTexture( "failure.dds", 512 );
+	std::vector< H3DRes > textures( 1, tex );
+
+	// Texture keeps its levels if the data can't be read
+	failReads = true;
+	streamFrame( textures );
+	H3D_CHECK( getGpuMem( tex ) == (int)LowResSize && getTexture( tex )->isStreamed() );
+
+	failReads = false;
+	streamFrame( textures );
+	H3D_CHECK( getGpuMem( tex ) == (int)fullSize( 512 ) );
+	removeTextures( textures );
+}
+
+
+void testMapStream()
+{
+	// Levels that are not resident are read for mapping, 24 bit data is converted like for uploads
+	H3DRes tex = loadTexture( "map.dds", 256, false );
+	if( !H3D_CHECK( getTexture( tex )->isStreamed() ) ) return;
+
+	for( int level = 0; level <= 8; level += 4 )
+	{
+		bytesRead = 0;
+		const unsigned char *pixels = (const unsigned char *)h3dMapResStream(
+			tex, H3DTexRes::ImageElem, level, H3DTexRes::ImgPixelStream, true, false );
+		if( H3D_CHECK( pixels != 0x0 ) )
+		{
+			H3D_CHECK( pixels[0] == levelValue( level ) && pixels[1] == levelValue( level ) && pixels[3] == 255 );
+			int mipSize = 256 >> level;
+			H3D_CHECK( bytesRead == (level < 2 ? (size_t)mipSize * mipSize * 3 : 0) );
+		}
+		h3dUnmapResStream( tex );
+	}
+	H3D_CHECK( getGpuMem( tex ) == (int)LowResSize );
+
+	// Written textures get all levels and are no longer streamed
+	unsigned char *pixels = (unsigned char *)h3dMapResStream(
+		tex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, true, true );
+	if( H3D_CHECK( pixels != 0x0 ) )
+	{
+		H3D_CHECK( pixels[0] == levelValue( 0 ) );
+		pixels[0] = 1;
+	}
+	h3dUnmapResStream( tex );
+	H3D_CHECK( !getTexture( tex )->isStreamed() );
+	H3D_CHECK( getCpuMem( tex ) == 0 && getGpuMem( tex ) == (int)fullSize( 256 ) );
+
+	pixels = (unsigned char *)h3dMapResStream( tex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgPixelStream, true, false );
+	H3D_CHECK( pixels != 0x0 && pixels[0] == 1 && pixels[4] == levelValue( 0 ) );
+	h3dUnmapResStream( tex );
+	removeTextures( std::vector< H3DRes >( 1, tex ) );
+}
+
+
+void testHeightMap()
+{
+	// Terrain fetches exact texels from the base level, so its height map stops streaming
+	H3DRes heightMap = loadTexture( "heightMapStreamed.dds", 256 );
+	H3DRes material = h3dAddResource( H3DResTypes::Material, "terrainStreaming.material.xml", 0 );
+	if( !H3D_CHECK( getTexture( heightMap )->isStreamed() && getCpuMem( heightMap ) > 0 ) ) return;
+
+	H3DNode terrain = h3dextAddTerrainNode( H3DRootNode, "StreamedTerrain", heightMap, material );
+	H3D_CHECK( terrain != 0 && !getTexture( heightMap )->isStreamed() );
+	H3D_CHECK( getCpuMem( heightMap ) == 0 && getGpuMem( heightMap ) == (int)fullSize( 256 ) );
+
+	h3dRemoveNode( terrain );
+	h3dRemoveResource( material );
+	removeTextures( std::vector< H3DRes >( 1, heightMap ) );
+}
+
+}  // namespace
+
+
+int main()
+{
+	if( !Horde3DTest::initEngine() ) return Horde3DTest::TestSkipped;
+	h3dSetOption( H3DOptions::MaxLogLevel, 1 );
+	h3dSetOption( H3DOptions::TexStreamingBudget, 128 );
+
+	testWithoutReader();
+	testLoad();
+	testUploadLimit();
+	testBudget();
+	testReadFailure();
+	testMapStream();
+	testHeightMap();
+
+	h3dSetOption( H3DOptions::TexStreamingBudget, 0 );
+	h3dSetTexStreamingReadFunc( 0x0, 0x0 );
+	Horde3DTest::releaseEngine();
+	return Horde3DTest::finish( "testTexStreaming" );
+}
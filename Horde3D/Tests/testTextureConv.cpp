@@ -0,0 +1,261 @@
+// *************************************************************************************************
+//
+// Horde3D
+//   Next-Generation Graphics Engine
+// --------------------------------------
+// Copyright (C) 2006-2021 Nicolas Schulz and Horde3D team
+//
+// This software is distributed under the terms of the Eclipse Public License v1.0.
+// A copy of the license may be obtained at: http://www.eclipse.org/legal/epl-v10.html
+//
+// *************************************************************************************************
+
+// TextureConv must write DDS and KTX files with the complete mip chain of the requested format,
+// whose top level decodes to the source image, and the engine must load them with the same format,
+// size and number of mip levels.
+
+#include "testCommon.h"
+#include "blockDecoder.h"
+#include "Horde3D.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+const int Width = 64, Height = 48, MipCount = 7;
+
+std::string converter, srcDir, outDir;
+
+struct Conversion
+{
+	const char  *format;
+	bool        alpha;
+	const char  *ext;
+	int         engineFormat;
+	int         blockBytes;   // 0 for BGRA8
+	bool        (*decode)( const unsigned char *, unsigned char * );
+	float       maxRmse;      // Of the top level
+};
+
+const Conversion Conversions[] = {
+	{ "auto", false, ".dds", H3DFormats::TEX_DXT1, 8, Horde3DTest::decodeBC1Block, 4 },
+	{ "auto", true, ".dds", H3DFormats::TEX_DXT5, 16, Horde3DTest::decodeBC3Block, 4 },
+	{ "bc7", true, ".dds", H3DFormats::TEX_BC7, 16, Horde3DTest::decodeBC7Block, 3 },
+	{ "etc2", false, ".ktx", H3DFormats::TEX_RGB8_ETC2, 8, Horde3DTest::decodeETC2Block, 4 },
+	{ "etc2", true, ".ktx", H3DFormats::TEX_RGBA8_ETC2, 16, Horde3DTest::decodeETC2EACBlock, 4 },
+	{ "bgra8", true, ".dds", H3DFormats::TEX_BGRA8, 0, 0x0, 0 }
+};
+
+
+// Smooth colors with a sharp edge; alpha images have an alpha gradient
+void makeImage( bool alpha, std::vector< unsigned char > &pixels )
+{
+	pixels.resize( Width * Height * 4 );
+	for( int y = 0; y < Height; ++y )
+	{
+		for( int x = 0; x < Width; ++x )
+		{
+			unsigned char *p = &pixels[(y * Width + x) * 4];
+			p[0] = (unsigned char)(x * 4);
+			p[1] = (unsigned char)(y * 5);
+			p[2] = (unsigned char)(x < 24 ? 40 : 200);
+			p[3] = (unsigned char)(alpha ? 255 - x * 3 : 255);
+		}
+	}
+}
+
+
+bool writeTGA( const std::string &fileName, const std::vector< unsigned char > &pixels )
+{
+	// Uncompressed true color with 8 alpha bits and top-left origin
+	unsigned char header[18] = { 0, 0, 2 };
+	header[12] = Width & 0xFF; header[13] = Width >> 8;
+	header[14] = Height & 0xFF; header[15] = Height >> 8;
+	header[16] = 32;
+	header[17] = 0x28;
+
+	std::ofstream out( fileName.c_str(), std::ios::binary );
+	out.write( (const char *)header, sizeof( header ) );
+	for( size_t i = 0; i < pixels.size(); i += 4 )
+	{
+		char bgra[4] = { (char)pixels[i + 2], (char)pixels[i + 1], (char)pixels[i], (char)pixels[i + 3] };
+		out.write( bgra, 4 );
+	}
+	return out.good();
+}
+
+
+bool readFile( const std::string &fileName, std::string &data )
+{
+	std::ifstream in( fileName.c_str(), std::ios::binary );
+	if( !in.good() ) return false;
+	std::stringstream ss;
+	ss << in.rdbuf();
+	data = ss.str();
+	return true;
+}
+
+
+unsigned int readUInt( const std::string &data, size_t pos )
+{
+	unsigned int value = 0;
+	if( pos + 4 <= data.size() ) memcpy( &value, &data[pos], 4 );
+	return value;
+}
+
+
+size_t getLevelSize( const Conversion &conv, int level )
+{
+	int w = std::max( Width >> level, 1 ), h = std::max( Height >> level, 1 );
+	if( conv.blockBytes == 0 ) return (size_t)w * h * 4;
+	return (size_t)((w + 3) / 4) * ((h + 3) / 4) * conv.blockBytes;
+}
+
+
+// Checks the header and the level sizes and returns the offset of the top level
+size_t checkFile( const Conversion &conv, const std::string &data )
+{
+	size_t offset = 0, dataSize = 0;
+	if( strcmp( conv.ext, ".ktx" ) == 0 )
+	{
+		if( !H3D_CHECK( data.size() > 64 && data.compare( 1, 3, "KTX" ) == 0 ) ) return 0;
+		H3D_CHECK( readUInt( data, 36 ) == Width && readUInt( data, 40 ) == Height );
+		H3D_CHECK( readUInt( data, 56 ) == MipCount );
+
+		// Levels are preceded by their size
+		offset = 64 + readUInt( data, 60 ) + 4;
+		size_t pos = offset - 4;
+		for( int i = 0; i < MipCount; ++i )
+		{
+			H3D_CHECK( readUInt( data, pos ) == getLevelSize( conv, i ) );
+			pos += 4 + getLevelSize( conv, i );
+		}
+		dataSize = pos;
+	}
+	else
+	{
+		if( !H3D_CHECK( data.size() > 128 && data.compare( 0, 4, "DDS " ) == 0 ) ) return 0;
+		H3D_CHECK( readUInt( data, 12 ) == Height && readUInt( data, 16 ) == Width );
+		H3D_CHECK( readUInt( data, 28 ) == MipCount );
+		offset = data.compare( 84, 4, "DX10" ) == 0 ? 148 : 128;
+
+		dataSize = offset;
+		for( int i = 0; i < MipCount; ++i ) dataSize += getLevelSize( conv, i );
+	}
+	H3D_CHECK( data.size() == dataSize );
+
+	return offset;
+}
+
+
+float calcTopLevelRmse( const Conversion &conv, const std::string &data, size_t offset,
+                        const std::vector< unsigned char > &source )
+{
+	std::vector< unsigned char > decoded( Width * Height * 4 );
+	const unsigned char *level = (const unsigned char *)&data[offset];
+	bool valid = true;
+	if( conv.blockBytes == 0 )
+	{
+		for( int i = 0; i < Width * Height; ++i )
+		{
+			decoded[i * 4 + 0] = level[i * 4 + 2]; decoded[i * 4 + 1] = level[i * 4 + 1];
+			decoded[i * 4 + 2] = level[i * 4 + 0]; decoded[i * 4 + 3] = level[i * 4 + 3];
+		}
+	}
+	else
+	{
+		for( int by = 0; by < Height / 4; ++by )
+		{
+			for( int bx = 0; bx < Width / 4; ++bx )
+			{
+				unsigned char block[64];
+				valid &= conv.decode( level + (by * (Width / 4) + bx) * conv.blockBytes, block );
+				for( int y = 0; y < 4; ++y )
+					memcpy( &decoded[((by * 4 + y) * Width + bx * 4) * 4], &block[y * 16], 16 );
+			}
+		}
+	}
+	H3D_CHECK( valid );
+
+	double squaredError = 0;
+	for( size_t i = 0; i < decoded.size(); ++i )
+	{
+		double d = (double)decoded[i] - source[i];
+		squaredError += d * d;
+	}
+	return (float)sqrt( squaredError / decoded.size() );
+}
+
+
+bool checkEngineTexture( const Conversion &conv, const std::string &name, const std::string &data )
+{
+	H3DRes tex = h3dAddResource( H3DResTypes::Texture, name.c_str(), 0 );
+	h3dLoadResource( tex, data.data(), (int)data.size() );
+	if( !H3D_CHECK( h3dIsResLoaded( tex ) ) ) return false;
+
+	H3D_CHECK( h3dGetResParamI( tex, H3DTexRes::TextureElem, 0, H3DTexRes::TexFormatI ) == conv.engineFormat );
+	H3D_CHECK( h3dGetResElemCount( tex, H3DTexRes::ImageElem ) == MipCount );
+	H3D_CHECK( h3dGetResParamI( tex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgWidthI ) == Width );
+	H3D_CHECK( h3dGetResParamI( tex, H3DTexRes::ImageElem, 0, H3DTexRes::ImgHeightI ) == Height );
+	return true;
+}
+
+}  // namespace
+
+
+int main( int argc, char **argv )
+{
+	if( argc < 2 )
+	{
+		printf( "Usage: testTextureConv <TextureConv executable>\n" );
+		return 1;
+	}
+	converter = argv[1];
+	std::string dir = std::string( Horde3DTest::tempDir() ) + "/textureConv";
+	srcDir = dir + "/src";
+	outDir = dir + "/out";
+
+	std::vector< unsigned char > images[2];
+	system( ("rm -rf \"" + dir + "\" && mkdir -p \"" + srcDir + "\"").c_str() );
+	for( int alpha = 0; alpha < 2; ++alpha )
+	{
+		makeImage( alpha != 0, images[alpha] );
+		H3D_CHECK( writeTGA( srcDir + (alpha ? "/alpha.tga" : "/opaque.tga"), images[alpha] ) );
+	}
+
+	// The engine part is skipped without a GL context
+	bool engine = Horde3DTest::initEngine();
+
+	for( size_t i = 0; i < sizeof( Conversions ) / sizeof( Conversion ); ++i )
+	{
+		const Conversion &conv = Conversions[i];
+		std::string imageName = conv.alpha ? "alpha" : "opaque";
+		std::string dest = outDir + "/" + conv.format;
+		std::string command = "mkdir -p \"" + dest + "\" && \"" + converter + "\" " + imageName + ".tga -base \"" +
+			srcDir + "\" -dest \"" + dest + "\" -format " + conv.format + " > /dev/null";
+		if( !H3D_CHECK( system( command.c_str() ) == 0 ) ) continue;
+
+		std::string data;
+		if( !H3D_CHECK( readFile( dest + "/" + imageName + conv.ext, data ) ) ) continue;
+		size_t offset = checkFile( conv, data );
+		if( offset == 0 ) continue;
+
+		float rmse = calcTopLevelRmse( conv, data, offset, images[conv.alpha] );
+		printf( "%-6s %-7s RMSE %5.2f\n", conv.format, imageName.c_str(), rmse );
+		H3D_CHECK( rmse <= conv.maxRmse );
+
+		if( engine ) checkEngineTexture( conv, dest + "/" + imageName + conv.ext, data );
+	}
+
+	if( engine ) Horde3DTest::releaseEngine();
+	system( ("rm -rf \"" + dir + "\"").c_str() );
+	return Horde3DTest::finish( "testTextureConv" );
+}